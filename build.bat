@@ -1,9 +1,15 @@
 @echo off
 echo Building Terminal Application...
-gcc src/simple_gui_terminal.c -mwindows -lgdi32 -o build/terminal.exe
+gcc src/simple_gui_terminal.c src/gui_win32.c src/platform_win32.c src/hash.c src/gitread.c src/json.c src/match.c -mwindows -lgdi32 -o build/terminal.exe
 if %ERRORLEVEL% == 0 (
     echo Build successful! Executable created: build/terminal.exe
 ) else (
     echo Build failed! Check for errors above.
 )
+gcc src/simple_gui_terminal.c src/cli_main.c src/platform_win32.c src/hash.c src/gitread.c src/json.c src/match.c -o build/nexus-cli.exe
+if %ERRORLEVEL% == 0 (
+    echo Build successful! Executable created: build/nexus-cli.exe
+) else (
+    echo Build failed! Check for errors above.
+)
 pause
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Headless build for Linux and other POSIX systems: nexus-cli only, the
+# window front end needs Windows.
+echo "Building nexus-cli..."
+mkdir -p build
+if gcc -std=gnu99 -O2 src/simple_gui_terminal.c src/cli_main.c src/platform_posix.c src/hash.c src/gitread.c src/json.c src/match.c -lpthread -o build/nexus-cli; then
+    echo "Build successful! Executable created: build/nexus-cli"
+else
+    echo "Build failed! Check for errors above."
+    exit 1
+fi
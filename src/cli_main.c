@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "engine.h"
+
+// Headless front end (nexus-cli): reads commands one per line from a file or
+// stdin, runs them through process_command and writes the output to stdout.
+// Same engine as the window, so scripted workloads, load tests and profiling
+// runs exercise exactly the code users do.
+static BOOL g_interactive = FALSE;
+
+// ---------------- Output sink ----------------
+// The engine ends lines with "\r\n" for the edit control; a stream wants "\n"
+static void cli_write(const char* text) {
+    const char* start = text;
+    for (const char* p = text; *p; p++) {
+        if (*p != '\r') continue;
+        if (p > start) fwrite(start, 1, (size_t)(p - start), stdout);
+        start = p + 1;
+    }
+    fputs(start, stdout);
+}
+
+static void cli_flush(void) {
+    fflush(stdout);
+}
+
+static void cli_prompt(void) {
+    if (!g_interactive) return;
+    gui_print_prompt();
+    gui_flush();
+    fflush(stdout);
+}
+
+// No event loop: clear, colours and the status line mean nothing on a
+// stream, and background jobs run inline.
+static const OutputSink g_cliSink = {
+    cli_write,
+    NULL,
+    cli_prompt,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    cli_flush
+};
+
+static void print_usage(void) {
+    fputs("Usage: nexus-cli [--echo] [file]\n"
+          "       nexus-cli --script <file> [--time] [--keep-going]\n"
+          "Runs terminal commands read from file, or from stdin when it is\n"
+          "missing or \"-\", and prints the results to stdout.\n"
+          "  --echo        print each command after its prompt, like a transcript\n"
+          "  --script      run file as SOURCE does and exit; the exit status is 1\n"
+          "                if a command failed\n"
+          "  --time        with --script: show each command's latency and the total\n"
+          "  --keep-going  with --script: list errors at the end instead of stopping\n", stderr);
+}
+
+int main(int argc, char** argv) {
+    const char* script = NULL;
+    const char* batch = NULL;
+    int batch_flags = 0;
+    BOOL echo = FALSE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--echo") == 0) {
+            echo = TRUE;
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            batch = argv[++i];
+        } else if (strcmp(argv[i], "--time") == 0) {
+            batch_flags |= SCRIPT_TIME;
+        } else if (strcmp(argv[i], "--keep-going") == 0) {
+            batch_flags |= SCRIPT_KEEP_GOING;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage();
+            return 0;
+        } else if (!script) {
+            script = argv[i];
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    if (batch && script) {
+        print_usage();
+        return 2;
+    }
+
+    FILE* in = stdin;
+    if (script && strcmp(script, "-") != 0) {
+        in = fopen(script, "r");
+        if (!in) {
+            fprintf(stderr, "nexus-cli: cannot open %s\n", script);
+            return 1;
+        }
+    }
+    g_interactive = !batch && (in == stdin) && pf_is_terminal(stdin);
+
+    // Same start-up order as the window front end
+    engine_set_sink(&g_cliSink);
+    fs_init();
+    init_ide_configs();
+    init_security_system();
+    init_theme_system();
+    detect_project_type();
+
+    if (batch) {
+        int errors = script_run(batch, batch_flags, NULL);
+        fs_save_to_disk();
+        fflush(stdout);
+        return errors == 0 ? 0 : 1;
+    }
+
+    if (g_interactive) {
+        gui_println("NEXUS TERMINAL v5.0");
+        gui_println("");
+    }
+    gui_show_prompt_when_idle();
+
+    char line[1024];
+    while (fgets(line, sizeof(line), in)) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] != '\n' && !feof(in)) {
+            // Longer than the window accepts: drop the rest of the line
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {}
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (echo && !g_interactive) {
+            gui_print_prompt();
+            gui_println(line);
+        }
+        if (!process_command(line)) break;
+
+        // EDITCODE takes over the window until Ctrl+S; there is none here
+        if (editor_active()) {
+            gui_println("EDITCODE needs the terminal window; use WRITECODE instead.");
+            editor_cancel();
+            continue;
+        }
+        gui_show_prompt_when_idle();
+    }
+    if (g_interactive) gui_println("");
+
+    if (in != stdin) fclose(in);
+    fs_save_to_disk();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,105 @@
+// ---------------- Engine / front end interface ----------------
+// simple_gui_terminal.c is the engine: the virtual file system, users,
+// themes, sync and every command. It never touches a window. A front end
+// (gui_win32.c for the window, cli_main.c for nexus-cli) owns the input,
+// feeds lines to process_command and supplies the OutputSink the engine
+// prints through.
+#ifndef NEXUS_ENGINE_H
+#define NEXUS_ENGINE_H
+
+#include "platform.h"
+
+// ---- Provided by the engine ----
+void init_security_system(void);
+void init_theme_system(void);
+void detect_project_type(void);
+void fs_init(void);
+void init_ide_configs(void);
+void apply_theme(const char* theme_name);  // NULL re-applies the saved theme
+void fs_save_to_disk(void);
+BOOL process_command(char* input);        // FALSE when the terminal should close
+
+void gui_print_prompt(void);
+void gui_show_prompt_when_idle(void);     // holds the prompt back while a sync runs
+void theme_current_colors(COLORREF* text, COLORREF* bg);
+int settings_scrollback_lines(void);      // SET scrollback_lines: output lines a window keeps
+
+// Runs a file of commands as SOURCE does. Returns the number of commands
+// that failed, or -1 when the file could not be read; *quit (may be NULL) is
+// set when the script ran EXIT.
+#define SCRIPT_TIME       0x1             // print each command's latency and the total
+#define SCRIPT_KEEP_GOING 0x2             // list errors at the end instead of stopping
+int script_run(const char* path, int flags, BOOL* quit);
+
+// Tab: completes the last word of line (size bytes with the terminator) to
+// a command, sub-command or argument name. Returns how many names fit it;
+// when more than one, line gets what they share and choices (may be NULL)
+// lists them.
+int engine_complete(char* line, size_t size, char* choices, size_t choices_size);
+
+// EDITCODE hands the input over to the user until Ctrl+S or Ctrl+C
+BOOL editor_active(void);
+void editor_save(const char* text);       // text: everything typed since EDITCODE
+void editor_cancel(void);
+
+// Background sync; see sync_job_start. Front ends drive it through jobs_*.
+BOOL sync_job_active(void);
+void sync_job_poll(void);                 // refresh its status line
+void sync_job_finish(void);               // wait for the scan, then apply it
+void sync_job_cancel(void);
+void sync_job_abandon(void);
+
+#define SYNC_STATUS_INTERVAL_MS 250
+
+// Programs commands run (git, npm, compilers), BUILD and the sync, as seen
+// by the front end; see job_start
+void jobs_wake(void);                     // after gui_job_wake, on the front end's thread
+void jobs_poll(void);                     // status ticker, every SYNC_STATUS_INTERVAL_MS
+BOOL jobs_foreground(void);               // the terminal is held: only Ctrl+C counts
+void jobs_interrupt(void);                // Ctrl+C while it is held
+BOOL jobs_input_wanted(void);             // ...unless its program reads typed lines
+void jobs_input(const char* line);        // Enter then; NULL ends its input
+void jobs_abandon(void);                  // window closing: stop everything
+
+// ---- Output sink ----
+// A front end hands the engine one of these and the engine prints through
+// it. gui_win32.c writes into its edit control, cli_main.c to stdout. Any
+// member may be NULL.
+typedef struct {
+    void (*write)(const char* text);      // lines end in "\r\n"
+    void (*clear)(void);
+    void (*prompt)(void);                 // show gui_print_prompt and take input after it
+    void (*refresh)(void);                // colours or settings changed: repaint
+    // A single line at the end of the output that is rewritten in place; NULL
+    // removes it.
+    void (*status_line)(const char* text);
+    // Background jobs need an event loop. job_begin starts the status ticker
+    // and returns FALSE when there is no loop to run one, in which case the
+    // job runs inline. job_wake may be called from any thread.
+    BOOL (*job_begin)(void);
+    void (*job_end)(void);
+    void (*job_wake)(void);
+    // Push out whatever write has left in the front end's own buffers: a
+    // child started without PF_SPAWN_CAPTURE writes to the same stream
+    void (*flush)(void);
+} OutputSink;
+
+void engine_set_sink(const OutputSink* sink);
+
+// The engine's output calls, forwarded to the sink. Text written while a
+// command runs is buffered and handed to write() in one piece when it ends
+// (or once a frame); gui_flush sends it on now, before a sink reads back
+// what it has shown.
+void gui_flush(void);
+void gui_append(const char* text);
+void gui_println(const char* text);
+void gui_printf(const char* format, ...);
+void gui_clear(void);
+void gui_show_prompt_and_arm_input(void);
+void gui_refresh(void);
+void gui_status_line(const char* text);
+BOOL gui_job_begin(void);
+void gui_job_end(void);
+void gui_job_wake(void);
+
+#endif
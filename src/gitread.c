@@ -0,0 +1,1711 @@
+#include "gitread.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hash.h"
+
+#define GIT_MAX_DELTA_DEPTH 10000
+#define GIT_MAX_SYMREF_DEPTH 5
+#define GIT_CACHE_SLOTS 256
+#define GIT_CACHE_MAX_OBJECT (1u << 20)
+#define GIT_CACHE_MAX_BYTES (32u << 20)
+#define GIT_STAT_SLOTS 4096
+
+typedef struct {
+    char* key;                            // "section.name" or "section.subsection.name"
+    char* value;
+} GitConfigEntry;
+
+typedef struct {
+    char* name;
+    GitOid oid;
+} GitRef;
+
+typedef struct {
+    char path[1024];                      // the .pack
+    unsigned char* idx;                   // the whole .idx, loaded on first use
+    size_t idx_size;
+    unsigned int count;
+    const unsigned char* oids;
+    const unsigned char* offsets;
+    const unsigned char* large_offsets;
+    unsigned int large_count;
+    FILE* file;
+    BOOL failed;
+} GitPack;
+
+// Recently inflated pack objects, mostly delta bases: a long chain of tree
+// deltas would otherwise inflate its base once per link
+typedef struct {
+    const GitPack* pack;
+    unsigned long long offset;
+    GitObjType type;
+    unsigned char* data;
+    size_t size;
+} GitCacheSlot;
+
+struct GitRepo {
+    char work_tree[1024];
+    char git_dir[1024];
+    GitConfigEntry* config;
+    int config_count;
+    char head_ref[256];                   // empty when detached
+    GitRef* packed;
+    int packed_count;
+    GitPack* packs;
+    int pack_count;
+    GitCacheSlot cache[GIT_CACHE_SLOTS];
+    size_t cache_bytes;
+    BOOL autocrlf;
+};
+
+// Object ids of work tree files, by path, for files not touched since they
+// were hashed. Outlives any one GitRepo, so a second GIT STATUS is cheap.
+typedef struct {
+    unsigned long long key;               // hash of the full path
+    unsigned long long size;
+    long long mtime;
+    long long hashed_at;
+    GitOid oid;
+    BOOL used;
+} GitStatSlot;
+
+static GitStatSlot g_gitStatCache[GIT_STAT_SLOTS];
+
+// ---------------- SHA-1 ----------------
+typedef struct {
+    unsigned int h[5];
+    unsigned char block[64];
+    size_t used;
+    unsigned long long total;
+} GitSha1;
+
+static unsigned int rol32(unsigned int x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(GitSha1* s, const unsigned char* p) {
+    unsigned int w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((unsigned int)p[i * 4] << 24) | ((unsigned int)p[i * 4 + 1] << 16) |
+               ((unsigned int)p[i * 4 + 2] << 8) | (unsigned int)p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    unsigned int a = s->h[0], b = s->h[1], c = s->h[2], d = s->h[3], e = s->h[4];
+    for (int i = 0; i < 80; i++) {
+        unsigned int f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        unsigned int t = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+    s->h[0] += a;
+    s->h[1] += b;
+    s->h[2] += c;
+    s->h[3] += d;
+    s->h[4] += e;
+}
+
+static void sha1_init(GitSha1* s) {
+    s->h[0] = 0x67452301;
+    s->h[1] = 0xEFCDAB89;
+    s->h[2] = 0x98BADCFE;
+    s->h[3] = 0x10325476;
+    s->h[4] = 0xC3D2E1F0;
+    s->used = 0;
+    s->total = 0;
+}
+
+static void sha1_update(GitSha1* s, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    s->total += len;
+    if (s->used) {
+        size_t take = 64 - s->used;
+        if (take > len) take = len;
+        memcpy(s->block + s->used, p, take);
+        s->used += take;
+        p += take;
+        len -= take;
+        if (s->used < 64) return;
+        sha1_block(s, s->block);
+        s->used = 0;
+    }
+    for (; len >= 64; p += 64, len -= 64) sha1_block(s, p);
+    memcpy(s->block, p, len);
+    s->used = len;
+}
+
+static void sha1_final(GitSha1* s, GitOid* out) {
+    unsigned long long bits = s->total * 8;
+    unsigned char pad = 0x80;
+    sha1_update(s, &pad, 1);
+    pad = 0;
+    while (s->used != 56) sha1_update(s, &pad, 1);
+    unsigned char len[8];
+    for (int i = 0; i < 8; i++) len[i] = (unsigned char)(bits >> (56 - i * 8));
+    sha1_update(s, len, 8);
+    for (int i = 0; i < 5; i++) {
+        out->id[i * 4] = (unsigned char)(s->h[i] >> 24);
+        out->id[i * 4 + 1] = (unsigned char)(s->h[i] >> 16);
+        out->id[i * 4 + 2] = (unsigned char)(s->h[i] >> 8);
+        out->id[i * 4 + 3] = (unsigned char)s->h[i];
+    }
+}
+
+// ---------------- Inflate ----------------
+// RFC 1950/1951 decoding into one growing buffer, so back references are
+// plain indexes into the output. Input comes from memory or, for packs,
+// from a file read on demand, since a pack entry's compressed length is not
+// recorded anywhere.
+#define INFLATE_MAX_BITS 15
+
+typedef struct {
+    const unsigned char* in;
+    size_t in_pos;
+    size_t in_len;
+    FILE* file;
+    unsigned char* file_buf;
+    unsigned long bits;
+    int bit_count;
+    unsigned char* out;
+    size_t out_len;
+    size_t out_cap;
+    size_t out_max;                       // the size the output must not pass
+    BOOL error;
+} Inflate;
+
+typedef struct {
+    short count[INFLATE_MAX_BITS + 1];
+    short symbol[288];
+} Huffman;
+
+static const short k_lenBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const short k_lenExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const short k_distBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const short k_distExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+#define INFLATE_FILE_CHUNK 16384
+
+static int inflate_byte(Inflate* s) {
+    if (s->in_pos == s->in_len) {
+        size_t n = 0;
+        if (s->file && s->file_buf) n = fread(s->file_buf, 1, INFLATE_FILE_CHUNK, s->file);
+        if (n == 0) {
+            s->error = TRUE;
+            return 0;
+        }
+        s->in = s->file_buf;
+        s->in_pos = 0;
+        s->in_len = n;
+    }
+    return s->in[s->in_pos++];
+}
+
+static unsigned int inflate_bits(Inflate* s, int need) {
+    unsigned long value = s->bits;
+    while (s->bit_count < need) {
+        if (s->error) return 0;
+        value |= (unsigned long)inflate_byte(s) << s->bit_count;
+        s->bit_count += 8;
+    }
+    s->bits = value >> need;
+    s->bit_count -= need;
+    return (unsigned int)(value & ((1UL << need) - 1));
+}
+
+static BOOL inflate_reserve(Inflate* s, size_t extra) {
+    size_t need = s->out_len + extra;
+    if (s->out_max && need > s->out_max) return FALSE;
+    if (need + 1 <= s->out_cap) return TRUE;
+    size_t cap = s->out_cap ? s->out_cap * 2 : 4096;
+    while (cap < need + 1) cap *= 2;
+    if (s->out_max && cap > s->out_max + 1) cap = s->out_max + 1;
+    unsigned char* bigger = (unsigned char*)realloc(s->out, cap);
+    if (!bigger) return FALSE;
+    s->out = bigger;
+    s->out_cap = cap;
+    return TRUE;
+}
+
+// Canonical codes from code lengths. Incomplete codes are allowed (a
+// distance code may have a single symbol); over-subscribed ones are not.
+static BOOL huffman_build(Huffman* h, const short* lengths, int n) {
+    memset(h->count, 0, sizeof(h->count));
+    for (int i = 0; i < n; i++) h->count[lengths[i]]++;
+    if (h->count[0] == n) return TRUE;
+    int left = 1;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) return FALSE;
+    }
+    short offs[INFLATE_MAX_BITS + 1];
+    offs[1] = 0;
+    for (int len = 1; len < INFLATE_MAX_BITS; len++) offs[len + 1] = (short)(offs[len] + h->count[len]);
+    for (int i = 0; i < n; i++) {
+        if (lengths[i]) h->symbol[offs[lengths[i]]++] = (short)i;
+    }
+    return TRUE;
+}
+
+static int huffman_decode(Inflate* s, const Huffman* h) {
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        code |= (int)inflate_bits(s, 1);
+        int count = h->count[len];
+        if (code - count < first) return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    s->error = TRUE;
+    return -1;
+}
+
+static BOOL inflate_stored(Inflate* s) {
+    s->bits = 0;
+    s->bit_count = 0;
+    unsigned int len = (unsigned int)inflate_byte(s);
+    len |= (unsigned int)inflate_byte(s) << 8;
+    unsigned int nlen = (unsigned int)inflate_byte(s);
+    nlen |= (unsigned int)inflate_byte(s) << 8;
+    if (s->error || len != (~nlen & 0xffff) || !inflate_reserve(s, len)) return FALSE;
+    while (len--) s->out[s->out_len++] = (unsigned char)inflate_byte(s);
+    return !s->error;
+}
+
+static BOOL inflate_codes(Inflate* s, const Huffman* lencode, const Huffman* distcode) {
+    for (;;) {
+        int symbol = huffman_decode(s, lencode);
+        if (s->error) return FALSE;
+        if (symbol < 256) {
+            if (!inflate_reserve(s, 1)) return FALSE;
+            s->out[s->out_len++] = (unsigned char)symbol;
+            continue;
+        }
+        if (symbol == 256) return TRUE;
+        symbol -= 257;
+        if (symbol >= 29) return FALSE;
+        size_t len = (size_t)k_lenBase[symbol] + inflate_bits(s, k_lenExtra[symbol]);
+        int dsym = huffman_decode(s, distcode);
+        if (s->error || dsym < 0 || dsym >= 30) return FALSE;
+        size_t dist = (size_t)k_distBase[dsym] + inflate_bits(s, k_distExtra[dsym]);
+        if (s->error || dist > s->out_len || !inflate_reserve(s, len)) return FALSE;
+        // Byte by byte: the source may overlap what is being written
+        unsigned char* to = s->out + s->out_len;
+        const unsigned char* from = to - dist;
+        for (size_t i = 0; i < len; i++) to[i] = from[i];
+        s->out_len += len;
+    }
+}
+
+static BOOL inflate_fixed(Inflate* s) {
+    short lengths[288];
+    int i = 0;
+    for (; i < 144; i++) lengths[i] = 8;
+    for (; i < 256; i++) lengths[i] = 9;
+    for (; i < 280; i++) lengths[i] = 7;
+    for (; i < 288; i++) lengths[i] = 8;
+    Huffman lencode, distcode;
+    huffman_build(&lencode, lengths, 288);
+    for (i = 0; i < 30; i++) lengths[i] = 5;
+    huffman_build(&distcode, lengths, 30);
+    return inflate_codes(s, &lencode, &distcode);
+}
+
+static BOOL inflate_dynamic(Inflate* s) {
+    static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    int nlen = (int)inflate_bits(s, 5) + 257;
+    int ndist = (int)inflate_bits(s, 5) + 1;
+    int ncode = (int)inflate_bits(s, 4) + 4;
+    if (s->error || nlen > 286 || ndist > 30) return FALSE;
+
+    short lengths[320];
+    int i = 0;
+    for (; i < ncode; i++) lengths[order[i]] = (short)inflate_bits(s, 3);
+    for (; i < 19; i++) lengths[order[i]] = 0;
+    Huffman lencode, distcode;
+    if (!huffman_build(&lencode, lengths, 19)) return FALSE;
+
+    for (i = 0; i < nlen + ndist;) {
+        int symbol = huffman_decode(s, &lencode);
+        if (s->error || symbol < 0) return FALSE;
+        if (symbol < 16) {
+            lengths[i++] = (short)symbol;
+            continue;
+        }
+        short len = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (i == 0) return FALSE;
+            len = lengths[i - 1];
+            repeat = 3 + (int)inflate_bits(s, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + (int)inflate_bits(s, 3);
+        } else {
+            repeat = 11 + (int)inflate_bits(s, 7);
+        }
+        if (i + repeat > nlen + ndist) return FALSE;
+        while (repeat--) lengths[i++] = len;
+    }
+    if (lengths[256] == 0) return FALSE;
+    if (!huffman_build(&lencode, lengths, nlen) || !huffman_build(&distcode, lengths + nlen, ndist)) return FALSE;
+    return inflate_codes(s, &lencode, &distcode);
+}
+
+// A zlib stream: the two header bytes, then deflate blocks up to the last
+// one. The Adler-32 trailer is not checked; Git's own hashes cover the data.
+static BOOL inflate_zlib(Inflate* s) {
+    int cmf = inflate_byte(s);
+    int flg = inflate_byte(s);
+    if (s->error || (cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) return FALSE;
+    int last;
+    do {
+        last = (int)inflate_bits(s, 1);
+        int type = (int)inflate_bits(s, 2);
+        BOOL ok;
+        if (s->error) return FALSE;
+        if (type == 0) {
+            ok = inflate_stored(s);
+        } else if (type == 1) {
+            ok = inflate_fixed(s);
+        } else if (type == 2) {
+            ok = inflate_dynamic(s);
+        } else {
+            ok = FALSE;
+        }
+        if (!ok) return FALSE;
+    } while (!last);
+    if (s->out) s->out[s->out_len] = '\0';
+    return TRUE;
+}
+
+// ---------------- Files ----------------
+static BOOL git_seek(FILE* f, unsigned long long offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// A whole file, with a terminator after it. Caller frees.
+static unsigned char* git_read_file(const char* path, size_t* size) {
+    FILE* f = pf_fopen(path, "rb");
+    if (!f) return NULL;
+    size_t cap = 4096, len = 0;
+    unsigned char* data = (unsigned char*)malloc(cap);
+    size_t n;
+    while (data && (n = fread(data + len, 1, cap - len - 1, f)) > 0) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            unsigned char* bigger = (unsigned char*)realloc(data, cap * 2);
+            if (!bigger) { free(data); data = NULL; break; }
+            data = bigger;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    if (!data) return NULL;
+    data[len] = '\0';
+    if (size) *size = len;
+    return data;
+}
+
+// path is relative to the .git directory and uses '/'
+static void git_path(const GitRepo* repo, const char* path, char* out, size_t size) {
+    size_t j = (size_t)snprintf(out, size, "%s\\", repo->git_dir);
+    for (; *path && j + 1 < size; path++) out[j++] = (*path == '/') ? '\\' : *path;
+    out[j] = '\0';
+}
+
+static void trim_line(char* s) {
+    size_t len = strlen(s);
+    while (len > 0 && (s[len - 1] == '\n' || s[len - 1] == '\r' || s[len - 1] == ' ' || s[len - 1] == '\t')) {
+        s[--len] = '\0';
+    }
+}
+
+// ---------------- Object ids ----------------
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+BOOL git_oid_from_hex(const char* hex, GitOid* out) {
+    for (int i = 0; i < GIT_OID_RAW; i++) {
+        int hi = hex_value(hex[i * 2]);
+        int lo = (hi < 0) ? -1 : hex_value(hex[i * 2 + 1]);
+        if (lo < 0) return FALSE;
+        out->id[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return TRUE;
+}
+
+void git_oid_to_hex(const GitOid* oid, char out[GIT_OID_HEX]) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < GIT_OID_RAW; i++) {
+        out[i * 2] = digits[oid->id[i] >> 4];
+        out[i * 2 + 1] = digits[oid->id[i] & 15];
+    }
+    out[GIT_OID_HEX - 1] = '\0';
+}
+
+int git_oid_cmp(const GitOid* a, const GitOid* b) {
+    return memcmp(a->id, b->id, GIT_OID_RAW);
+}
+
+// ---------------- Config ----------------
+static void config_add(GitRepo* repo, const char* key, const char* value) {
+    GitConfigEntry* bigger = (GitConfigEntry*)realloc(repo->config, (repo->config_count + 1) * sizeof(GitConfigEntry));
+    if (!bigger) return;
+    repo->config = bigger;
+    GitConfigEntry* e = &repo->config[repo->config_count];
+    e->key = _strdup(key);
+    e->value = _strdup(value);
+    if (!e->key || !e->value) {
+        free(e->key);
+        free(e->value);
+        return;
+    }
+    repo->config_count++;
+}
+
+// The INI-like format git config writes: [section], [section "sub"] and
+// name = value lines. Include directives and line continuations are ignored.
+static void config_load(GitRepo* repo, const char* path) {
+    char* text = (char*)git_read_file(path, NULL);
+    if (!text) return;
+    char section[256] = "";
+    for (char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        trim_line(line);
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '\0' || *line == '#' || *line == ';') continue;
+        if (*line == '[') {
+            char name[128] = "", sub[128] = "";
+            char* quote = strchr(line, '"');
+            size_t n = strcspn(line + 1, " \t]\"");
+            if (n >= sizeof(name)) n = sizeof(name) - 1;
+            memcpy(name, line + 1, n);
+            name[n] = '\0';
+            for (char* p = name; *p; p++) *p = (char)tolower((unsigned char)*p);
+            if (quote) {
+                char* end = strrchr(quote + 1, '"');
+                size_t m = end ? (size_t)(end - quote - 1) : strlen(quote + 1);
+                if (m >= sizeof(sub)) m = sizeof(sub) - 1;
+                memcpy(sub, quote + 1, m);
+                sub[m] = '\0';
+                snprintf(section, sizeof(section), "%s.%s", name, sub);
+            } else {
+                // [section.sub] is the old spelling, and lowercases sub
+                snprintf(section, sizeof(section), "%s", name);
+            }
+            continue;
+        }
+        char* eq = strchr(line, '=');
+        char* value = eq ? eq + 1 : (char*)"true";
+        if (eq) {
+            *eq = '\0';
+            trim_line(line);
+            while (*value == ' ' || *value == '\t') value++;
+            size_t len = strlen(value);
+            if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
+                value[len - 1] = '\0';
+                value++;
+            }
+        }
+        for (char* p = line; *p; p++) *p = (char)tolower((unsigned char)*p);
+        char key[512];
+        snprintf(key, sizeof(key), "%s.%s", section, line);
+        config_add(repo, key, value);
+    }
+    free(text);
+}
+
+// Section and name compare without case, the subsection exactly
+static BOOL config_key_equal(const char* a, const char* b) {
+    const char* a_dot = strchr(a, '.');
+    const char* a_last = strrchr(a, '.');
+    const char* b_dot = strchr(b, '.');
+    const char* b_last = strrchr(b, '.');
+    if (!a_dot || !b_dot) return _stricmp(a, b) == 0;
+    if (a_dot - a != b_dot - b || _strnicmp(a, b, (size_t)(a_dot - a)) != 0) return FALSE;
+    if (a_last - a_dot != b_last - b_dot || strncmp(a_dot, b_dot, (size_t)(a_last - a_dot)) != 0) return FALSE;
+    return _stricmp(a_last, b_last) == 0;
+}
+
+const char* git_config_get(GitRepo* repo, const char* key) {
+    for (int i = repo->config_count - 1; i >= 0; i--) {
+        if (config_key_equal(repo->config[i].key, key)) return repo->config[i].value;
+    }
+    return NULL;
+}
+
+// ---------------- Refs ----------------
+static int ref_cmp(const void* a, const void* b) {
+    return strcmp(((const GitRef*)a)->name, ((const GitRef*)b)->name);
+}
+
+static void refs_free(GitRef* refs, int count) {
+    for (int i = 0; i < count; i++) free(refs[i].name);
+    free(refs);
+}
+
+static BOOL refs_add(GitRef** refs, int* count, int* cap, const char* name, const GitOid* oid) {
+    if (*count == *cap) {
+        int grown = *cap ? *cap * 2 : 64;
+        GitRef* bigger = (GitRef*)realloc(*refs, grown * sizeof(GitRef));
+        if (!bigger) return FALSE;
+        *refs = bigger;
+        *cap = grown;
+    }
+    char* copy = _strdup(name);
+    if (!copy) return FALSE;
+    (*refs)[*count].name = copy;
+    (*refs)[*count].oid = *oid;
+    (*count)++;
+    return TRUE;
+}
+
+// "^" lines peel the tag above them; only the ref itself is kept
+static void packed_refs_load(GitRepo* repo) {
+    char path[1100];
+    git_path(repo, "packed-refs", path, sizeof(path));
+    char* text = (char*)git_read_file(path, NULL);
+    if (!text) return;
+    int cap = 0;
+    for (char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        trim_line(line);
+        GitOid oid;
+        if (line[0] == '#' || line[0] == '^' || strlen(line) < GIT_OID_HEX + 1 || line[GIT_OID_HEX - 1] != ' ') continue;
+        if (!git_oid_from_hex(line, &oid)) continue;
+        refs_add(&repo->packed, &repo->packed_count, &cap, line + GIT_OID_HEX, &oid);
+    }
+    free(text);
+    if (repo->packed_count > 1) qsort(repo->packed, repo->packed_count, sizeof(GitRef), ref_cmp);
+}
+
+static const GitRef* packed_ref_find(const GitRepo* repo, const char* name) {
+    int lo = 0, hi = repo->packed_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int c = strcmp(repo->packed[mid].name, name);
+        if (c == 0) return &repo->packed[mid];
+        if (c < 0) lo = mid + 1; else hi = mid;
+    }
+    return NULL;
+}
+
+// A ref by its full name, following "ref: " links
+static BOOL ref_lookup(GitRepo* repo, const char* name, GitOid* out, int depth) {
+    if (depth > GIT_MAX_SYMREF_DEPTH) return FALSE;
+    char path[1400];
+    git_path(repo, name, path, sizeof(path));
+    if (pf_path_kind(path) == PF_PATH_FILE) {
+        char* text = (char*)git_read_file(path, NULL);
+        if (text) {
+            trim_line(text);
+            BOOL ok;
+            if (strncmp(text, "ref: ", 5) == 0) {
+                ok = ref_lookup(repo, text + 5, out, depth + 1);
+            } else {
+                ok = strlen(text) == GIT_OID_HEX - 1 && git_oid_from_hex(text, out);
+            }
+            free(text);
+            return ok;
+        }
+    }
+    const GitRef* packed = packed_ref_find(repo, name);
+    if (!packed) return FALSE;
+    *out = packed->oid;
+    return TRUE;
+}
+
+const char* git_head_ref(GitRepo* repo) {
+    return repo->head_ref[0] ? repo->head_ref : NULL;
+}
+
+BOOL git_resolve(GitRepo* repo, const char* name, GitOid* out) {
+    if (strlen(name) == GIT_OID_HEX - 1 && git_oid_from_hex(name, out)) return TRUE;
+    if (strcmp(name, "HEAD") == 0 || strncmp(name, "refs/", 5) == 0) {
+        if (ref_lookup(repo, name, out, 0)) return TRUE;
+    }
+    static const char* const rules[] = {
+        "refs/%s", "refs/tags/%s", "refs/heads/%s", "refs/remotes/%s", "refs/remotes/%s/HEAD"
+    };
+    for (size_t i = 0; i < sizeof(rules) / sizeof(rules[0]); i++) {
+        char full[512];
+        snprintf(full, sizeof(full), rules[i], name);
+        if (ref_lookup(repo, full, out, 0)) return TRUE;
+    }
+    return FALSE;
+}
+
+static void loose_refs_collect(GitRepo* repo, const char* name, GitRef** refs, int* count, int* cap) {
+    char path[1400];
+    git_path(repo, name, path, sizeof(path));
+    PfDir* dir = pf_dir_open(path);
+    if (!dir) return;
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
+        char child[512];
+        snprintf(child, sizeof(child), "%s/%s", name, entry.name);
+        if (entry.is_dir) {
+            loose_refs_collect(repo, child, refs, count, cap);
+            continue;
+        }
+        GitOid oid;
+        if (ref_lookup(repo, child, &oid, 0)) refs_add(refs, count, cap, child, &oid);
+    }
+    pf_dir_close(dir);
+}
+
+BOOL git_for_each_ref(GitRepo* repo, const char* prefix, GitRefFn fn, void* ctx) {
+    // Only the folder the prefix names needs listing
+    char start[512];
+    snprintf(start, sizeof(start), "%s", prefix);
+    char* slash = strrchr(start, '/');
+    if (slash) *slash = '\0'; else snprintf(start, sizeof(start), "refs");
+
+    GitRef* refs = NULL;
+    int count = 0, cap = 0;
+    loose_refs_collect(repo, start, &refs, &count, &cap);
+    int loose = count;
+    if (loose > 1) qsort(refs, loose, sizeof(GitRef), ref_cmp);
+    size_t prefix_len = strlen(prefix);
+    for (int i = 0; i < repo->packed_count; i++) {
+        const GitRef* p = &repo->packed[i];
+        if (strncmp(p->name, prefix, prefix_len) != 0) continue;
+        // A loose ref is newer than its packed copy
+        if (loose && bsearch(p, refs, loose, sizeof(GitRef), ref_cmp)) continue;
+        refs_add(&refs, &count, &cap, p->name, &p->oid);
+    }
+    if (count > 1) qsort(refs, count, sizeof(GitRef), ref_cmp);
+    for (int i = 0; i < count; i++) {
+        if (strncmp(refs[i].name, prefix, prefix_len) != 0) continue;
+        if (!fn(refs[i].name, &refs[i].oid, ctx)) break;
+    }
+    refs_free(refs, count);
+    return TRUE;
+}
+
+// ---------------- Repository ----------------
+static void packs_list(GitRepo* repo) {
+    char dir_path[1100];
+    git_path(repo, "objects/pack", dir_path, sizeof(dir_path));
+    PfDir* dir = pf_dir_open(dir_path);
+    if (!dir) return;
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
+        size_t len = strlen(entry.name);
+        if (entry.is_dir || len < 5 || strcmp(entry.name + len - 4, ".idx") != 0) continue;
+        GitPack* bigger = (GitPack*)realloc(repo->packs, (repo->pack_count + 1) * sizeof(GitPack));
+        if (!bigger) break;
+        repo->packs = bigger;
+        GitPack* pack = &repo->packs[repo->pack_count++];
+        memset(pack, 0, sizeof(*pack));
+        snprintf(pack->path, sizeof(pack->path), "%s\\%.*s.pack", dir_path, (int)(len - 4), entry.name);
+    }
+    pf_dir_close(dir);
+}
+
+GitRepo* git_repo_open(const char* work_tree) {
+    GitRepo* repo = (GitRepo*)calloc(1, sizeof(GitRepo));
+    if (!repo) return NULL;
+    snprintf(repo->work_tree, sizeof(repo->work_tree), "%s", work_tree);
+    snprintf(repo->git_dir, sizeof(repo->git_dir), "%s\\.git", work_tree);
+
+    // A .git file points at a linked worktree's folder, whose objects and
+    // refs live elsewhere: leave those to git
+    char path[1100];
+    git_path(repo, "HEAD", path, sizeof(path));
+    char* head = (char*)git_read_file(path, NULL);
+    if (pf_path_kind(repo->git_dir) != PF_PATH_DIR || !head) {
+        free(head);
+        free(repo);
+        return NULL;
+    }
+    trim_line(head);
+    if (strncmp(head, "ref: ", 5) == 0) snprintf(repo->head_ref, sizeof(repo->head_ref), "%s", head + 5);
+    free(head);
+
+    const char* home = getenv("HOME");
+    if (!home) home = getenv("USERPROFILE");
+    if (home) {
+        char global[1100];
+        snprintf(global, sizeof(global), "%s\\.gitconfig", home);
+        config_load(repo, global);
+    }
+    git_path(repo, "config", path, sizeof(path));
+    config_load(repo, path);
+
+    const char* version = git_config_get(repo, "core.repositoryformatversion");
+    const char* format = git_config_get(repo, "extensions.objectformat");
+    if ((version && atoi(version) > 1) || (format && _stricmp(format, "sha1") != 0) ||
+        git_config_get(repo, "extensions.refstorage")) {
+        git_repo_close(repo);
+        return NULL;
+    }
+    const char* autocrlf = git_config_get(repo, "core.autocrlf");
+    repo->autocrlf = autocrlf && (_stricmp(autocrlf, "true") == 0 || _stricmp(autocrlf, "input") == 0);
+
+    packed_refs_load(repo);
+    packs_list(repo);
+    return repo;
+}
+
+void git_repo_close(GitRepo* repo) {
+    if (!repo) return;
+    for (int i = 0; i < repo->config_count; i++) {
+        free(repo->config[i].key);
+        free(repo->config[i].value);
+    }
+    free(repo->config);
+    refs_free(repo->packed, repo->packed_count);
+    for (int i = 0; i < repo->pack_count; i++) {
+        free(repo->packs[i].idx);
+        if (repo->packs[i].file) fclose(repo->packs[i].file);
+    }
+    free(repo->packs);
+    for (int i = 0; i < GIT_CACHE_SLOTS; i++) free(repo->cache[i].data);
+    free(repo);
+}
+
+// ---------------- Packs ----------------
+static unsigned int be32(const unsigned char* p) {
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+}
+
+// Version 2 .idx: magic, fanout, sorted ids, CRCs, 31-bit offsets with the
+// top bit pointing into a table of 64-bit ones, then two checksums
+static BOOL pack_load_index(GitPack* pack) {
+    if (pack->idx) return TRUE;
+    if (pack->failed) return FALSE;
+    char idx_path[1100];
+    size_t len = strlen(pack->path);
+    snprintf(idx_path, sizeof(idx_path), "%.*s.idx", (int)(len - 5), pack->path);
+    size_t size = 0;
+    unsigned char* idx = git_read_file(idx_path, &size);
+    if (!idx || size < 8 + 256 * 4 + 40 || memcmp(idx, "\377tOc", 4) != 0 || be32(idx + 4) != 2) {
+        free(idx);
+        pack->failed = TRUE;
+        return FALSE;
+    }
+    unsigned int count = be32(idx + 8 + 255 * 4);
+    size_t tables = 8 + 256 * 4 + (size_t)count * (GIT_OID_RAW + 4 + 4);
+    if (size < tables + 40) {
+        free(idx);
+        pack->failed = TRUE;
+        return FALSE;
+    }
+    pack->idx = idx;
+    pack->idx_size = size;
+    pack->count = count;
+    pack->oids = idx + 8 + 256 * 4;
+    pack->offsets = pack->oids + (size_t)count * (GIT_OID_RAW + 4);
+    pack->large_offsets = pack->offsets + (size_t)count * 4;
+    pack->large_count = (unsigned int)((size - tables - 40) / 8);
+    return TRUE;
+}
+
+static BOOL pack_find(GitPack* pack, const GitOid* oid, unsigned long long* offset) {
+    if (!pack_load_index(pack)) return FALSE;
+    const unsigned char* fanout = pack->idx + 8;
+    unsigned int lo = oid->id[0] ? be32(fanout + (oid->id[0] - 1) * 4) : 0;
+    unsigned int hi = be32(fanout + oid->id[0] * 4);
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        int c = memcmp(pack->oids + (size_t)mid * GIT_OID_RAW, oid->id, GIT_OID_RAW);
+        if (c == 0) {
+            unsigned int off = be32(pack->offsets + (size_t)mid * 4);
+            if (off & 0x80000000u) {
+                unsigned int i = off & 0x7fffffffu;
+                if (i >= pack->large_count) return FALSE;
+                const unsigned char* p = pack->large_offsets + (size_t)i * 8;
+                *offset = ((unsigned long long)be32(p) << 32) | be32(p + 4);
+            } else {
+                *offset = off;
+            }
+            return TRUE;
+        }
+        if (c < 0) lo = mid + 1; else hi = mid;
+    }
+    return FALSE;
+}
+
+static GitCacheSlot* cache_slot(GitRepo* repo, const GitPack* pack, unsigned long long offset) {
+    unsigned long long key = offset ^ ((unsigned long long)(size_t)pack << 7);
+    return &repo->cache[(key ^ (key >> 11)) % GIT_CACHE_SLOTS];
+}
+
+static void cache_put(GitRepo* repo, const GitPack* pack, unsigned long long offset,
+                      GitObjType type, const unsigned char* data, size_t size) {
+    if (size > GIT_CACHE_MAX_OBJECT) return;
+    GitCacheSlot* slot = cache_slot(repo, pack, offset);
+    if (slot->data) {
+        repo->cache_bytes -= slot->size;
+        free(slot->data);
+        slot->data = NULL;
+    }
+    if (repo->cache_bytes + size > GIT_CACHE_MAX_BYTES) return;
+    slot->data = (unsigned char*)malloc(size + 1);
+    if (!slot->data) return;
+    memcpy(slot->data, data, size + 1);
+    slot->pack = pack;
+    slot->offset = offset;
+    slot->type = type;
+    slot->size = size;
+    repo->cache_bytes += size;
+}
+
+// Builds the target of a delta from its base: the two sizes, then copy
+// (from the base) and insert (literal bytes) instructions
+static unsigned char* delta_apply(const unsigned char* base, size_t base_size,
+                                  const unsigned char* delta, size_t delta_size, size_t* out_size) {
+    const unsigned char* p = delta;
+    const unsigned char* end = delta + delta_size;
+    unsigned long long sizes[2] = {0, 0};
+    for (int k = 0; k < 2; k++) {
+        int shift = 0;
+        unsigned char c;
+        do {
+            if (p == end || shift > 56) return NULL;
+            c = *p++;
+            sizes[k] |= (unsigned long long)(c & 0x7f) << shift;
+            shift += 7;
+        } while (c & 0x80);
+    }
+    if (sizes[0] != base_size) return NULL;
+    size_t size = (size_t)sizes[1];
+    unsigned char* out = (unsigned char*)malloc(size + 1);
+    if (!out) return NULL;
+    size_t len = 0;
+    while (p < end) {
+        unsigned char op = *p++;
+        if (op & 0x80) {
+            unsigned long long off = 0, n = 0;
+            for (int i = 0; i < 4; i++) {
+                if (op & (1 << i)) {
+                    if (p == end) goto bad;
+                    off |= (unsigned long long)*p++ << (i * 8);
+                }
+            }
+            for (int i = 0; i < 3; i++) {
+                if (op & (0x10 << i)) {
+                    if (p == end) goto bad;
+                    n |= (unsigned long long)*p++ << (i * 8);
+                }
+            }
+            if (n == 0) n = 0x10000;
+            if (off + n > base_size || len + n > size) goto bad;
+            memcpy(out + len, base + off, (size_t)n);
+            len += (size_t)n;
+        } else if (op) {
+            if ((size_t)(end - p) < op || len + op > size) goto bad;
+            memcpy(out + len, p, op);
+            p += op;
+            len += op;
+        } else {
+            goto bad;
+        }
+    }
+    if (len != size) goto bad;
+    out[size] = '\0';
+    *out_size = size;
+    return out;
+bad:
+    free(out);
+    return NULL;
+}
+
+static unsigned char* read_object_depth(GitRepo* repo, const GitOid* oid, GitObjType* type, size_t* size, int depth);
+
+static unsigned char* pack_read_at(GitRepo* repo, GitPack* pack, unsigned long long offset,
+                                   GitObjType* type, size_t* size, int depth) {
+    if (depth > GIT_MAX_DELTA_DEPTH) return NULL;
+    GitCacheSlot* slot = cache_slot(repo, pack, offset);
+    if (slot->data && slot->pack == pack && slot->offset == offset) {
+        unsigned char* copy = (unsigned char*)malloc(slot->size + 1);
+        if (!copy) return NULL;
+        memcpy(copy, slot->data, slot->size + 1);
+        *type = slot->type;
+        *size = slot->size;
+        return copy;
+    }
+
+    if (!pack->file) pack->file = pf_fopen(pack->path, "rb");
+    if (!pack->file || !git_seek(pack->file, offset)) return NULL;
+    // On the heap: a delta chain recurses once per link
+    Inflate s;
+    memset(&s, 0, sizeof(s));
+    s.file = pack->file;
+    s.file_buf = (unsigned char*)malloc(INFLATE_FILE_CHUNK);
+    if (!s.file_buf) return NULL;
+
+    // Type and inflated size, then for deltas where the base is
+    int c = inflate_byte(&s);
+    int kind = (c >> 4) & 7;
+    unsigned long long inflated = (unsigned long long)(c & 15);
+    int shift = 4;
+    while ((c & 0x80) && !s.error && shift < 60) {
+        c = inflate_byte(&s);
+        inflated |= (unsigned long long)(c & 0x7f) << shift;
+        shift += 7;
+    }
+    unsigned long long base_offset = 0;
+    GitOid base_oid;
+    if (kind == 6) {
+        c = inflate_byte(&s);
+        unsigned long long back = (unsigned long long)(c & 0x7f);
+        while ((c & 0x80) && !s.error) {
+            c = inflate_byte(&s);
+            back = ((back + 1) << 7) | (unsigned long long)(c & 0x7f);
+        }
+        base_offset = offset - back;
+        if (back == 0 || back > offset) s.error = TRUE;
+    } else if (kind == 7) {
+        for (int i = 0; i < GIT_OID_RAW; i++) base_oid.id[i] = (unsigned char)inflate_byte(&s);
+    } else if (kind < GIT_OBJ_COMMIT || kind > GIT_OBJ_TAG) {
+        s.error = TRUE;
+    }
+    s.out_max = (size_t)inflated;
+    BOOL ok = !s.error && inflated <= ((size_t)-1) / 2 && inflate_reserve(&s, s.out_max) &&
+              inflate_zlib(&s) && s.out_len == s.out_max;
+    free(s.file_buf);
+    if (!ok) {
+        free(s.out);
+        return NULL;
+    }
+    if (!s.out) {
+        // Empty object: nothing was reserved
+        s.out = (unsigned char*)calloc(1, 1);
+        if (!s.out) return NULL;
+    }
+    if (kind <= GIT_OBJ_TAG) {
+        *type = (GitObjType)kind;
+        *size = s.out_len;
+        cache_put(repo, pack, offset, *type, s.out, *size);
+        return s.out;
+    }
+
+    size_t base_size = 0;
+    unsigned char* base = (kind == 6)
+        ? pack_read_at(repo, pack, base_offset, type, &base_size, depth + 1)
+        : read_object_depth(repo, &base_oid, type, &base_size, depth + 1);
+    unsigned char* result = base ? delta_apply(base, base_size, s.out, s.out_len, size) : NULL;
+    free(base);
+    free(s.out);
+    if (result) cache_put(repo, pack, offset, *type, result, *size);
+    return result;
+}
+
+// ---------------- Objects ----------------
+// objects/ab/cdef...: zlib of "<type> <size>\0<content>"
+static unsigned char* loose_read(GitRepo* repo, const GitOid* oid, GitObjType* type, size_t* size) {
+    char hex[GIT_OID_HEX];
+    git_oid_to_hex(oid, hex);
+    char rel[64];
+    snprintf(rel, sizeof(rel), "objects/%.2s/%s", hex, hex + 2);
+    char path[1100];
+    git_path(repo, rel, path, sizeof(path));
+    size_t compressed_size = 0;
+    unsigned char* compressed = git_read_file(path, &compressed_size);
+    if (!compressed) return NULL;
+
+    Inflate s;
+    memset(&s, 0, sizeof(s));
+    s.in = compressed;
+    s.in_len = compressed_size;
+    BOOL ok = inflate_zlib(&s) && s.out;
+    free(compressed);
+    if (!ok) {
+        free(s.out);
+        return NULL;
+    }
+
+    static const char* const names[] = { "", "commit", "tree", "blob", "tag" };
+    unsigned char* nul = (unsigned char*)memchr(s.out, '\0', s.out_len);
+    char* space = (char*)memchr(s.out, ' ', s.out_len);
+    *type = GIT_OBJ_BAD;
+    for (int i = GIT_OBJ_COMMIT; nul && space && i <= GIT_OBJ_TAG; i++) {
+        if ((size_t)(space - (char*)s.out) == strlen(names[i]) && memcmp(s.out, names[i], strlen(names[i])) == 0) {
+            *type = (GitObjType)i;
+        }
+    }
+    size_t header = nul ? (size_t)(nul - s.out) + 1 : 0;
+    if (*type == GIT_OBJ_BAD || strtoull(space + 1, NULL, 10) != s.out_len - header) {
+        free(s.out);
+        return NULL;
+    }
+    *size = s.out_len - header;
+    memmove(s.out, s.out + header, *size + 1);
+    return s.out;
+}
+
+static unsigned char* read_object_depth(GitRepo* repo, const GitOid* oid, GitObjType* type, size_t* size, int depth) {
+    for (int i = 0; i < repo->pack_count; i++) {
+        unsigned long long offset;
+        if (pack_find(&repo->packs[i], oid, &offset)) {
+            unsigned char* data = pack_read_at(repo, &repo->packs[i], offset, type, size, depth);
+            if (data) return data;
+        }
+    }
+    return loose_read(repo, oid, type, size);
+}
+
+unsigned char* git_read_object(GitRepo* repo, const GitOid* oid, GitObjType* type, size_t* size) {
+    GitObjType ignored_type;
+    size_t ignored_size;
+    return read_object_depth(repo, oid, type ? type : &ignored_type, size ? size : &ignored_size, 0);
+}
+
+// ---------------- Commits ----------------
+// "Name <email> 1700000000 +0100": the name part and the time
+static long long parse_signature(const char* line, const char* end, char* who, size_t who_size) {
+    const char* close = line;
+    for (const char* p = line; p < end; p++) if (*p == '>') close = p + 1;
+    size_t n = (size_t)(close - line);
+    if (n >= who_size) n = who_size - 1;
+    memcpy(who, line, n);
+    who[n] = '\0';
+    return strtoll(close, NULL, 10);
+}
+
+BOOL git_read_commit(GitRepo* repo, const GitOid* oid, GitCommit* out) {
+    memset(out, 0, sizeof(*out));
+    GitObjType type;
+    size_t size;
+    char* text = (char*)git_read_object(repo, oid, &type, &size);
+    if (!text || type != GIT_OBJ_COMMIT) {
+        free(text);
+        return FALSE;
+    }
+    out->id = *oid;
+    BOOL has_tree = FALSE;
+    const char* p = text;
+    const char* end = text + size;
+    int cap = 0;
+    while (p < end && *p != '\n') {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        if (strncmp(p, "tree ", 5) == 0) {
+            has_tree = git_oid_from_hex(p + 5, &out->tree);
+        } else if (strncmp(p, "parent ", 7) == 0) {
+            if (out->parent_count == cap) {
+                cap = cap ? cap * 2 : 2;
+                GitOid* bigger = (GitOid*)realloc(out->parents, cap * sizeof(GitOid));
+                if (!bigger) break;
+                out->parents = bigger;
+            }
+            if (git_oid_from_hex(p + 7, &out->parents[out->parent_count])) out->parent_count++;
+        } else if (strncmp(p, "author ", 7) == 0) {
+            out->author_time = parse_signature(p + 7, eol, out->author, sizeof(out->author));
+        } else if (strncmp(p, "committer ", 10) == 0) {
+            char ignored[128];
+            out->commit_time = parse_signature(p + 10, eol, ignored, sizeof(ignored));
+        }
+        p = (eol < end) ? eol + 1 : end;
+    }
+
+    // The subject is the first paragraph on one line, as --oneline shows it
+    if (p < end) p++;
+    size_t n = 0;
+    while (p < end && *p == '\n') p++;
+    while (p < end) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        if (eol == p) break;
+        if (n && n + 1 < sizeof(out->summary)) out->summary[n++] = ' ';
+        for (const char* c = p; c < eol && n + 1 < sizeof(out->summary); c++) {
+            if (*c != '\r') out->summary[n++] = *c;
+        }
+        p = (eol < end) ? eol + 1 : end;
+    }
+    out->summary[n] = '\0';
+    free(text);
+    if (!has_tree) git_commit_free(out);
+    return has_tree;
+}
+
+void git_commit_free(GitCommit* commit) {
+    free(commit->parents);
+    commit->parents = NULL;
+    commit->parent_count = 0;
+}
+
+// ---- Walks ----
+// Commits seen so far and their flags, by id
+typedef struct {
+    GitOid* keys;
+    unsigned char* flags;
+    size_t cap;
+    size_t count;
+} OidMap;
+
+static unsigned char* oidmap_get(OidMap* map, const GitOid* oid, BOOL insert) {
+    if (insert && (map->count + 1) * 2 > map->cap) {
+        size_t cap = map->cap ? map->cap * 2 : 1024;
+        GitOid* keys = (GitOid*)calloc(cap, sizeof(GitOid));
+        unsigned char* flags = (unsigned char*)calloc(cap, 1);
+        if (!keys || !flags) {
+            free(keys);
+            free(flags);
+            return NULL;
+        }
+        for (size_t i = 0; i < map->cap; i++) {
+            if (!map->flags[i]) continue;
+            size_t j = be32(map->keys[i].id) & (cap - 1);
+            while (flags[j]) j = (j + 1) & (cap - 1);
+            keys[j] = map->keys[i];
+            flags[j] = map->flags[i];
+        }
+        free(map->keys);
+        free(map->flags);
+        map->keys = keys;
+        map->flags = flags;
+        map->cap = cap;
+    }
+    if (!map->cap) return NULL;
+    size_t i = be32(oid->id) & (map->cap - 1);
+    while (map->flags[i]) {
+        if (git_oid_cmp(&map->keys[i], oid) == 0) return &map->flags[i];
+        i = (i + 1) & (map->cap - 1);
+    }
+    if (!insert) return NULL;
+    map->keys[i] = *oid;
+    map->count++;
+    return &map->flags[i];            // 0: the caller sets its flags, which must be non-zero
+}
+
+static void oidmap_free(OidMap* map) {
+    free(map->keys);
+    free(map->flags);
+}
+
+// Newest commit date on top; equal dates come out in the order they went in
+typedef struct {
+    GitCommit* items;
+    unsigned long* order;
+    int count;
+    int cap;
+    unsigned long next_order;
+} CommitQueue;
+
+static BOOL queue_before(const CommitQueue* q, int a, int b) {
+    if (q->items[a].commit_time != q->items[b].commit_time) return q->items[a].commit_time > q->items[b].commit_time;
+    return q->order[a] < q->order[b];
+}
+
+static void queue_swap(CommitQueue* q, int a, int b) {
+    GitCommit c = q->items[a];
+    q->items[a] = q->items[b];
+    q->items[b] = c;
+    unsigned long o = q->order[a];
+    q->order[a] = q->order[b];
+    q->order[b] = o;
+}
+
+static BOOL queue_push(CommitQueue* q, const GitCommit* commit) {
+    if (q->count == q->cap) {
+        int cap = q->cap ? q->cap * 2 : 64;
+        GitCommit* items = (GitCommit*)realloc(q->items, cap * sizeof(GitCommit));
+        if (!items) return FALSE;
+        q->items = items;
+        unsigned long* order = (unsigned long*)realloc(q->order, cap * sizeof(unsigned long));
+        if (!order) return FALSE;
+        q->order = order;
+        q->cap = cap;
+    }
+    int i = q->count++;
+    q->items[i] = *commit;
+    q->order[i] = q->next_order++;
+    while (i > 0 && queue_before(q, i, (i - 1) / 2)) {
+        queue_swap(q, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    return TRUE;
+}
+
+static GitCommit queue_pop(CommitQueue* q) {
+    GitCommit top = q->items[0];
+    q->items[0] = q->items[--q->count];
+    q->order[0] = q->order[q->count];
+    int i = 0;
+    for (;;) {
+        int best = i, l = i * 2 + 1, r = l + 1;
+        if (l < q->count && queue_before(q, l, best)) best = l;
+        if (r < q->count && queue_before(q, r, best)) best = r;
+        if (best == i) break;
+        queue_swap(q, i, best);
+        i = best;
+    }
+    return top;
+}
+
+static void queue_free(CommitQueue* q) {
+    for (int i = 0; i < q->count; i++) git_commit_free(&q->items[i]);
+    free(q->items);
+    free(q->order);
+}
+
+#define WALK_SEEN 0x1
+
+int git_log(GitRepo* repo, const GitOid* start, int max, GitCommitFn fn, void* ctx) {
+    CommitQueue queue;
+    OidMap seen;
+    memset(&queue, 0, sizeof(queue));
+    memset(&seen, 0, sizeof(seen));
+    int shown = 0;
+    BOOL failed = FALSE;
+
+    GitCommit first;
+    unsigned char* flag = oidmap_get(&seen, start, TRUE);
+    if (!flag || !git_read_commit(repo, start, &first)) {
+        oidmap_free(&seen);
+        return -1;
+    }
+    *flag = WALK_SEEN;
+    queue_push(&queue, &first);
+
+    while (queue.count > 0 && (max <= 0 || shown < max)) {
+        GitCommit commit = queue_pop(&queue);
+        shown++;
+        BOOL go_on = fn(&commit, ctx);
+        for (int i = 0; go_on && i < commit.parent_count; i++) {
+            flag = oidmap_get(&seen, &commit.parents[i], TRUE);
+            if (!flag) { failed = TRUE; break; }
+            if (*flag) continue;
+            *flag = WALK_SEEN;
+            GitCommit parent;
+            if (!git_read_commit(repo, &commit.parents[i], &parent) || !queue_push(&queue, &parent)) {
+                failed = TRUE;
+                break;
+            }
+        }
+        git_commit_free(&commit);
+        if (!go_on || failed) break;
+    }
+    queue_free(&queue);
+    oidmap_free(&seen);
+    return failed ? -1 : shown;
+}
+
+#define PAINT_A 0x1
+#define PAINT_B 0x2
+#define PAINT_STALE 0x4
+#define PAINT_DONE 0x8
+
+// Paint everything reachable from a and from b, newest first, and stop once
+// only commits reachable from both are left: what is below them is shared
+BOOL git_ahead_behind(GitRepo* repo, const GitOid* a, const GitOid* b, int* ahead, int* behind) {
+    *ahead = *behind = 0;
+    if (git_oid_cmp(a, b) == 0) return TRUE;
+    CommitQueue queue;
+    OidMap paint;
+    memset(&queue, 0, sizeof(queue));
+    memset(&paint, 0, sizeof(paint));
+    BOOL ok = TRUE;
+
+    const GitOid* tips[2] = { a, b };
+    for (int t = 0; t < 2 && ok; t++) {
+        GitCommit commit;
+        unsigned char* flag = oidmap_get(&paint, tips[t], TRUE);
+        ok = flag && git_read_commit(repo, tips[t], &commit) && queue_push(&queue, &commit);
+        if (ok) *flag = (unsigned char)(t == 0 ? PAINT_A : PAINT_B);
+    }
+
+    while (ok && queue.count > 0) {
+        // Done once nothing left in the queue can still be on one side only
+        BOOL live = FALSE;
+        for (int i = 0; i < queue.count && !live; i++) {
+            unsigned char* f = oidmap_get(&paint, &queue.items[i].id, FALSE);
+            live = f && !(*f & PAINT_STALE);
+        }
+        if (!live) break;
+
+        GitCommit commit = queue_pop(&queue);
+        unsigned char* flag = oidmap_get(&paint, &commit.id, FALSE);
+        unsigned char flags = flag ? *flag : 0;
+        if (flags & PAINT_DONE) {
+            git_commit_free(&commit);
+            continue;
+        }
+        if ((flags & (PAINT_A | PAINT_B)) == (PAINT_A | PAINT_B)) flags |= PAINT_STALE;
+        if (!(flags & PAINT_STALE)) {
+            if (flags & PAINT_A) (*ahead)++;
+            else (*behind)++;
+        }
+        *flag = (unsigned char)(flags | PAINT_DONE);
+
+        // A parent already walked keeps its count even if it turns out to be
+        // reachable from the other side too; only clock skew does that
+        for (int i = 0; ok && i < commit.parent_count; i++) {
+            unsigned char* pf = oidmap_get(&paint, &commit.parents[i], TRUE);
+            if (!pf) { ok = FALSE; break; }
+            unsigned char add = (unsigned char)(flags & (PAINT_A | PAINT_B | PAINT_STALE));
+            BOOL known = *pf != 0;
+            *pf |= add;
+            if (known) continue;
+            GitCommit parent;
+            ok = git_read_commit(repo, &commit.parents[i], &parent) && queue_push(&queue, &parent);
+        }
+        git_commit_free(&commit);
+    }
+    queue_free(&queue);
+    oidmap_free(&paint);
+    return ok;
+}
+
+// ---------------- Index ----------------
+static int index_entry_cmp(const void* a, const void* b) {
+    const GitIndexEntry* x = (const GitIndexEntry*)a;
+    const GitIndexEntry* y = (const GitIndexEntry*)b;
+    int c = strcmp(x->path, y->path);
+    return c ? c : x->stage - y->stage;
+}
+
+// "DIRC", version 2 to 4, then the entries. Version 4 stores each path as
+// how much of the previous one to drop plus what to append.
+BOOL git_read_index(GitRepo* repo, GitIndex* index) {
+    memset(index, 0, sizeof(*index));
+    char path[1100];
+    git_path(repo, "index", path, sizeof(path));
+    PfStat st;
+    if (!pf_stat(path, &st)) return TRUE;
+    index->mtime = st.mtime;
+    size_t size = 0;
+    unsigned char* data = git_read_file(path, &size);
+    if (!data || size < 12 + GIT_OID_RAW || memcmp(data, "DIRC", 4) != 0) {
+        free(data);
+        return FALSE;
+    }
+    unsigned int version = be32(data + 4);
+    unsigned int count = be32(data + 8);
+    if (version < 2 || version > 4 || count > size / 62) {
+        free(data);
+        return FALSE;
+    }
+    index->entries = (GitIndexEntry*)calloc(count ? count : 1, sizeof(GitIndexEntry));
+    if (!index->entries) {
+        free(data);
+        return FALSE;
+    }
+
+    const unsigned char* p = data + 12;
+    const unsigned char* end = data + size - GIT_OID_RAW;
+    char previous[4096] = "";
+    BOOL ok = TRUE;
+    for (unsigned int i = 0; i < count && ok; i++) {
+        if (end - p < 62) { ok = FALSE; break; }
+        GitIndexEntry* e = &index->entries[index->count];
+        e->mtime = be32(p + 8);
+        e->mode = be32(p + 24);
+        e->size = be32(p + 36);
+        memcpy(e->oid.id, p + 40, GIT_OID_RAW);
+        unsigned int flags = ((unsigned int)p[60] << 8) | p[61];
+        e->stage = (int)((flags >> 12) & 3);
+        size_t header = 62;
+        if (flags & 0x4000) {
+            if (version < 3 || end - p < 64) { ok = FALSE; break; }
+            unsigned int extended = ((unsigned int)p[62] << 8) | p[63];
+            e->skip_worktree = (extended & 0x4000) != 0;
+            header = 64;
+        }
+        // A sparse index keeps whole folders as one entry
+        if ((e->mode & 0170000) == 0040000) { ok = FALSE; break; }
+        const unsigned char* name = p + header;
+        if (version == 4) {
+            unsigned long long drop = 0;
+            unsigned char c;
+            do {
+                if (name >= end) { ok = FALSE; break; }
+                c = *name++;
+                drop = (drop << 7) | (c & 0x7f);
+                if (c & 0x80) drop++;
+            } while (c & 0x80);
+            const unsigned char* nul = ok ? memchr(name, '\0', (size_t)(end - name)) : NULL;
+            size_t keep = strlen(previous);
+            if (!nul || drop > keep || keep - drop + (size_t)(nul - name) >= sizeof(previous)) { ok = FALSE; break; }
+            keep -= (size_t)drop;
+            memcpy(previous + keep, name, (size_t)(nul - name) + 1);
+            p = nul + 1;
+        } else {
+            const unsigned char* nul = memchr(name, '\0', (size_t)(end - name));
+            if (!nul || (size_t)(nul - name) >= sizeof(previous)) { ok = FALSE; break; }
+            memcpy(previous, name, (size_t)(nul - name) + 1);
+            size_t entry = (header + (size_t)(nul - name) + 8) & ~(size_t)7;
+            if ((size_t)(end - p) < entry) { ok = FALSE; break; }
+            p += entry;
+        }
+        e->path = _strdup(previous);
+        if (!e->path) { ok = FALSE; break; }
+        index->count++;
+    }
+    free(data);
+    if (!ok) {
+        git_index_free(index);
+        return FALSE;
+    }
+    qsort(index->entries, index->count, sizeof(GitIndexEntry), index_entry_cmp);
+    return TRUE;
+}
+
+void git_index_free(GitIndex* index) {
+    for (int i = 0; i < index->count; i++) free(index->entries[i].path);
+    free(index->entries);
+    memset(index, 0, sizeof(*index));
+}
+
+int git_index_find(const GitIndex* index, const char* path) {
+    int lo = 0, hi = index->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(index->entries[mid].path, path) < 0) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// ---------------- Status ----------------
+typedef struct {
+    char* path;
+    GitOid oid;
+    unsigned int mode;
+} TreeEntry;
+
+typedef struct {
+    TreeEntry* entries;
+    int count;
+    int cap;
+} TreeList;
+
+static int tree_entry_cmp(const void* a, const void* b) {
+    return strcmp(((const TreeEntry*)a)->path, ((const TreeEntry*)b)->path);
+}
+
+static void tree_list_free(TreeList* list) {
+    for (int i = 0; i < list->count; i++) free(list->entries[i].path);
+    free(list->entries);
+}
+
+// Every file under a tree, as "dir/name" paths
+static BOOL tree_flatten(GitRepo* repo, const GitOid* oid, const char* prefix, TreeList* list) {
+    GitObjType type;
+    size_t size;
+    unsigned char* data = git_read_object(repo, oid, &type, &size);
+    if (!data || type != GIT_OBJ_TREE) {
+        free(data);
+        return FALSE;
+    }
+    BOOL ok = TRUE;
+    const unsigned char* p = data;
+    const unsigned char* end = data + size;
+    while (p < end && ok) {
+        // "<octal mode> <name>\0<20-byte id>"
+        const unsigned char* space = memchr(p, ' ', (size_t)(end - p));
+        const unsigned char* nul = space ? memchr(space, '\0', (size_t)(end - space)) : NULL;
+        if (!nul || end - nul < 1 + GIT_OID_RAW) { ok = FALSE; break; }
+        unsigned int mode = (unsigned int)strtoul((const char*)p, NULL, 8);
+        char path[4096];
+        snprintf(path, sizeof(path), "%s%s", prefix, (const char*)space + 1);
+        GitOid child;
+        memcpy(child.id, nul + 1, GIT_OID_RAW);
+        p = nul + 1 + GIT_OID_RAW;
+        if ((mode & 0170000) == 0040000) {
+            size_t len = strlen(path);
+            if (len + 1 < sizeof(path)) {
+                path[len] = '/';
+                path[len + 1] = '\0';
+            }
+            ok = tree_flatten(repo, &child, path, list);
+            continue;
+        }
+        if (list->count == list->cap) {
+            int cap = list->cap ? list->cap * 2 : 256;
+            TreeEntry* bigger = (TreeEntry*)realloc(list->entries, cap * sizeof(TreeEntry));
+            if (!bigger) { ok = FALSE; break; }
+            list->entries = bigger;
+            list->cap = cap;
+        }
+        TreeEntry* e = &list->entries[list->count];
+        e->path = _strdup(path);
+        e->oid = child;
+        e->mode = mode;
+        if (!e->path) { ok = FALSE; break; }
+        list->count++;
+    }
+    free(data);
+    return ok;
+}
+
+// Blob id of a file as git add would store it. With crlf, CRLF line ends
+// become LF first, as core.autocrlf does for text.
+static BOOL hash_work_file(const char* path, BOOL crlf, GitOid* out) {
+    size_t size = 0;
+    unsigned char* data = git_read_file(path, &size);
+    if (!data) return FALSE;
+    if (crlf && !memchr(data, '\0', size)) {
+        size_t j = 0;
+        for (size_t i = 0; i < size; i++) {
+            if (data[i] == '\r' && i + 1 < size && data[i + 1] == '\n') continue;
+            data[j++] = data[i];
+        }
+        size = j;
+    }
+    char header[64];
+    int n = snprintf(header, sizeof(header), "blob %llu", (unsigned long long)size);
+    GitSha1 sha;
+    sha1_init(&sha);
+    sha1_update(&sha, header, (size_t)n + 1);
+    sha1_update(&sha, data, size);
+    sha1_final(&sha, out);
+    free(data);
+    return TRUE;
+}
+
+// 'M' when the file no longer matches what the index recorded
+static char work_file_state(GitRepo* repo, const GitIndex* index, const GitIndexEntry* e) {
+    // Submodules and symbolic links are not compared
+    unsigned int kind = e->mode & 0170000;
+    if (e->skip_worktree || kind == 0160000 || kind == 0120000) return ' ';
+    char path[4096];
+    size_t j = (size_t)snprintf(path, sizeof(path), "%s\\", repo->work_tree);
+    for (const char* s = e->path; *s && j + 1 < sizeof(path); s++) path[j++] = (*s == '/') ? '\\' : *s;
+    path[j] = '\0';
+    PfStat st;
+    if (!pf_stat(path, &st) || st.kind != PF_PATH_FILE) return 'D';
+
+    // Same size and time as when it was staged, and not written in the
+    // second the index was: unchanged without reading it
+    if ((st.size & 0xffffffffULL) == e->size && st.mtime == e->mtime && st.mtime < index->mtime) return ' ';
+
+    unsigned long long key = hash64(path, strlen(path));
+    GitStatSlot* slot = &g_gitStatCache[key % GIT_STAT_SLOTS];
+    GitOid oid;
+    if (slot->used && slot->key == key && slot->size == st.size && slot->mtime == st.mtime && st.mtime < slot->hashed_at) {
+        oid = slot->oid;
+    } else {
+        if (!hash_work_file(path, FALSE, &oid)) return 'M';
+        if (git_oid_cmp(&oid, &e->oid) != 0 && repo->autocrlf) {
+            GitOid normalized;
+            if (hash_work_file(path, TRUE, &normalized)) oid = normalized;
+        }
+        slot->used = TRUE;
+        slot->key = key;
+        slot->size = st.size;
+        slot->mtime = st.mtime;
+        slot->hashed_at = (long long)time(NULL);
+        slot->oid = oid;
+    }
+    return git_oid_cmp(&oid, &e->oid) == 0 ? ' ' : 'M';
+}
+
+static BOOL status_add(GitStatusEntry** out, int* count, int* cap, const char* path, char staged, char unstaged) {
+    if (*count == *cap) {
+        int grown = *cap ? *cap * 2 : 32;
+        GitStatusEntry* bigger = (GitStatusEntry*)realloc(*out, grown * sizeof(GitStatusEntry));
+        if (!bigger) return FALSE;
+        *out = bigger;
+        *cap = grown;
+    }
+    char* copy = _strdup(path);
+    if (!copy) return FALSE;
+    (*out)[*count].path = copy;
+    (*out)[*count].staged = staged;
+    (*out)[*count].unstaged = unstaged;
+    (*count)++;
+    return TRUE;
+}
+
+BOOL git_status(GitRepo* repo, const GitIndex* index, GitStatusEntry** out, int* count) {
+    *out = NULL;
+    *count = 0;
+    TreeList head;
+    memset(&head, 0, sizeof(head));
+    GitOid head_oid;
+    if (git_resolve(repo, "HEAD", &head_oid)) {
+        GitCommit commit;
+        if (!git_read_commit(repo, &head_oid, &commit)) return FALSE;
+        BOOL ok = tree_flatten(repo, &commit.tree, "", &head);
+        git_commit_free(&commit);
+        if (!ok) {
+            tree_list_free(&head);
+            return FALSE;
+        }
+        if (head.count > 1) qsort(head.entries, head.count, sizeof(TreeEntry), tree_entry_cmp);
+    }
+
+    // Both lists are in path order: merge them
+    int cap = 0, h = 0, i = 0;
+    BOOL ok = TRUE;
+    while (ok && (h < head.count || i < index->count)) {
+        int c = (h == head.count) ? 1 : (i == index->count) ? -1 : strcmp(head.entries[h].path, index->entries[i].path);
+        if (c < 0) {
+            ok = status_add(out, count, &cap, head.entries[h].path, 'D', ' ');
+            h++;
+            continue;
+        }
+        const GitIndexEntry* e = &index->entries[i];
+        if (e->stage != 0) {
+            ok = status_add(out, count, &cap, e->path, 'U', 'U');
+            while (i < index->count && strcmp(index->entries[i].path, e->path) == 0) i++;
+            if (c == 0) h++;
+            continue;
+        }
+        char staged = ' ';
+        if (c > 0) {
+            staged = 'A';
+        } else if (git_oid_cmp(&head.entries[h].oid, &e->oid) != 0 || head.entries[h].mode != e->mode) {
+            staged = 'M';
+        }
+        char unstaged = work_file_state(repo, index, e);
+        if (staged != ' ' || unstaged != ' ') ok = status_add(out, count, &cap, e->path, staged, unstaged);
+        if (c == 0) h++;
+        i++;
+    }
+    tree_list_free(&head);
+    if (!ok) {
+        git_status_free(*out, *count);
+        *out = NULL;
+        *count = 0;
+    }
+    return ok;
+}
+
+void git_status_free(GitStatusEntry* entries, int count) {
+    for (int i = 0; i < count; i++) free(entries[i].path);
+    free(entries);
+}
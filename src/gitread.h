@@ -0,0 +1,127 @@
+// ---------------- Native Git reader ----------------
+// Reads a repository's .git directory in-process: config, refs and
+// packed-refs, loose objects and packfiles (found through their .idx), the
+// index and commit history. Read-only; everything that writes is left to the
+// git program. SHA-1 repositories only.
+//
+// Paths to the work tree use the engine's '\' separator; paths inside the
+// repository (index entries, status) use Git's '/'.
+#ifndef NEXUS_GITREAD_H
+#define NEXUS_GITREAD_H
+
+#include <stddef.h>
+
+#include "platform.h"
+
+#define GIT_OID_RAW 20
+#define GIT_OID_HEX 41                    // 40 digits plus the terminator
+
+typedef struct {
+    unsigned char id[GIT_OID_RAW];
+} GitOid;
+
+typedef enum {
+    GIT_OBJ_BAD = 0,
+    GIT_OBJ_COMMIT = 1,
+    GIT_OBJ_TREE = 2,
+    GIT_OBJ_BLOB = 3,
+    GIT_OBJ_TAG = 4
+} GitObjType;
+
+typedef struct GitRepo GitRepo;
+
+// work_tree is the folder holding .git. NULL when there is no repository or
+// it is one this reader does not handle (SHA-256 objects, a linked worktree,
+// an unknown format version); callers then fall back to git itself.
+GitRepo* git_repo_open(const char* work_tree);
+void git_repo_close(GitRepo* repo);
+
+void git_oid_to_hex(const GitOid* oid, char out[GIT_OID_HEX]);
+BOOL git_oid_from_hex(const char* hex, GitOid* out);
+int git_oid_cmp(const GitOid* a, const GitOid* b);
+
+// ---- Config ----
+// Last value of "section.name" or "section.subsection.name"; section and
+// name ignore case, as in git config. NULL if unset.
+const char* git_config_get(GitRepo* repo, const char* key);
+
+// ---- Refs ----
+// Full name of the branch HEAD is on ("refs/heads/main"), even before its
+// first commit; NULL when HEAD is detached
+const char* git_head_ref(GitRepo* repo);
+// "HEAD", a full ref name, a short one looked up the way git does (refs/X,
+// refs/tags/X, refs/heads/X, refs/remotes/X, refs/remotes/X/HEAD) or 40 hex
+// digits. FALSE if it names nothing, as for a branch with no commits yet.
+BOOL git_resolve(GitRepo* repo, const char* name, GitOid* out);
+// Calls fn for every ref whose full name starts with prefix, loose and
+// packed, in name order. fn returns FALSE to stop.
+typedef BOOL (*GitRefFn)(const char* name, const GitOid* oid, void* ctx);
+BOOL git_for_each_ref(GitRepo* repo, const char* prefix, GitRefFn fn, void* ctx);
+
+// ---- Objects ----
+// The object's content with a terminator after it; caller frees. NULL if it
+// is missing or damaged.
+unsigned char* git_read_object(GitRepo* repo, const GitOid* oid, GitObjType* type, size_t* size);
+
+// ---- Commits ----
+typedef struct {
+    GitOid id;
+    GitOid tree;
+    GitOid* parents;
+    int parent_count;
+    long long author_time;
+    long long commit_time;                // seconds since the epoch
+    char author[128];                     // "Name <email>"
+    char summary[256];                    // first line of the message
+} GitCommit;
+
+BOOL git_read_commit(GitRepo* repo, const GitOid* oid, GitCommit* out);
+void git_commit_free(GitCommit* commit);
+
+// History from start, newest commit date first as in git log, up to max
+// commits (0: all). fn returns FALSE to stop. The number shown, or -1 if an
+// object could not be read.
+typedef BOOL (*GitCommitFn)(const GitCommit* commit, void* ctx);
+int git_log(GitRepo* repo, const GitOid* start, int max, GitCommitFn fn, void* ctx);
+
+// Commits reachable from a but not b, and from b but not a
+BOOL git_ahead_behind(GitRepo* repo, const GitOid* a, const GitOid* b, int* ahead, int* behind);
+
+// ---- Index and status ----
+typedef struct {
+    char* path;
+    GitOid oid;
+    unsigned int mode;
+    long long mtime;
+    unsigned long long size;              // low 32 bits only, as the index keeps it
+    int stage;                            // 1-3 while a merge conflict is unresolved
+    BOOL skip_worktree;                   // sparse checkout: not on disk on purpose
+} GitIndexEntry;
+
+typedef struct {
+    GitIndexEntry* entries;               // sorted by path, then stage
+    int count;
+    long long mtime;                      // of the index file; newer files need hashing
+} GitIndex;
+
+// An empty index when the repository has none yet
+BOOL git_read_index(GitRepo* repo, GitIndex* index);
+void git_index_free(GitIndex* index);
+// First entry whose path is >= path, or index->count
+int git_index_find(const GitIndex* index, const char* path);
+
+// ' ' unchanged, 'A' added, 'M' modified, 'D' deleted, 'U' unmerged
+typedef struct {
+    char* path;
+    char staged;                          // HEAD against the index
+    char unstaged;                        // the index against the work tree
+} GitStatusEntry;
+
+// Tracked paths that differ, in path order. The work tree is compared by
+// size and modification time first and only hashed when those disagree;
+// hashes are remembered between calls until the file changes again.
+// Untracked files are the caller's business.
+BOOL git_status(GitRepo* repo, const GitIndex* index, GitStatusEntry** out, int* count);
+void git_status_free(GitStatusEntry* entries, int count);
+
+#endif
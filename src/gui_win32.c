@@ -0,0 +1,940 @@
+#include <windows.h>
+#include <windowsx.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+
+// Win32 front end: a terminal view that shows the output and takes input
+// after the last prompt. Everything else lives in the engine.
+#define JOB_TIMER_ID 2901
+#define WM_JOB_WAKE (WM_APP + 29)
+#define WM_RUN_SCRIPT (WM_APP + 33)
+#define VIEW_CLASS "NexusTerminalView"
+
+static HWND g_hWnd = NULL;
+static HWND g_hOut = NULL;
+
+static HFONT g_hMono = NULL;
+static HBRUSH g_hbrBlack = NULL;
+static int g_charWidth = 9;
+static int g_lineHeight = 18;
+
+// Command history variables
+#define MAX_HISTORY 100
+static char g_commandHistory[MAX_HISTORY][256];
+static int g_historyCount = 0;
+static int g_historyIndex = -1;
+static char g_currentInput[256] = {0};
+
+// --script <file> [--time] [--keep-going] on the command line
+static char g_startupScript[MAX_PATH] = {0};
+static int g_startupScriptFlags = 0;
+
+static void navigate_history(int direction);
+static void update_input_field(const char* text);
+static void view_changed(BOOL follow);
+
+// ---------------- Scrollback ----------------
+// Output is kept as a ring of lines, at most settings_scrollback_lines() of
+// them; once the ring is full the oldest line makes room for the newest.
+// The last line is still open (the prompt, a half-written line). Only the
+// rows on screen are painted, so a long session costs memory, not time.
+typedef struct {
+    char* text;
+    int len;
+    int cap;
+} ScrollLine;
+
+static ScrollLine* g_lines = NULL;
+static int g_lineCap = 0;                 // ring size
+static int g_lineFirst = 0;               // ring slot of the oldest line
+static int g_lineCount = 0;               // lines in use, the open one included
+static int g_topRow = 0;                  // first row on screen
+static BOOL g_follow = TRUE;              // keep the newest row in view
+
+// Whole-line selection for copying, in rows; -1 when there is none
+static int g_selAnchor = -1;
+static int g_selEnd = -1;
+static BOOL g_selecting = FALSE;
+
+static ScrollLine* scrollback_line(int i) {
+    return &g_lines[(g_lineFirst + i) % g_lineCap];
+}
+
+static void scrollback_resize(int cap) {
+    if (cap < 1) cap = 1;
+    if (cap == g_lineCap) return;
+    ScrollLine* lines = (ScrollLine*)calloc((size_t)cap, sizeof(ScrollLine));
+    if (!lines) return;
+    // Keep the newest lines
+    int keep = g_lineCount < cap ? g_lineCount : cap;
+    int drop = g_lineCount - keep;
+    for (int i = 0; i < g_lineCount; i++) {
+        ScrollLine* line = scrollback_line(i);
+        if (i < drop) free(line->text); else lines[i - drop] = *line;
+    }
+    free(g_lines);
+    g_lines = lines;
+    g_lineCap = cap;
+    g_lineFirst = 0;
+    g_lineCount = keep;
+    if (g_lineCount == 0) g_lineCount = 1;
+    g_topRow = g_topRow > drop ? g_topRow - drop : 0;
+    g_selAnchor = g_selEnd = -1;
+}
+
+static void scrollback_add(const char* text, int n) {
+    ScrollLine* line = scrollback_line(g_lineCount - 1);
+    if (line->len + n + 1 > line->cap) {
+        int cap = line->cap ? line->cap : 80;
+        while (cap < line->len + n + 1) cap *= 2;
+        char* bigger = (char*)realloc(line->text, (size_t)cap);
+        if (!bigger) return;
+        line->text = bigger;
+        line->cap = cap;
+    }
+    memcpy(line->text + line->len, text, (size_t)n);
+    line->len += n;
+    line->text[line->len] = '\0';
+}
+
+static void scrollback_newline(void) {
+    if (g_lineCount < g_lineCap) {
+        g_lineCount++;
+    } else {
+        // Full: the oldest slot becomes the new open line
+        g_lineFirst = (g_lineFirst + 1) % g_lineCap;
+        if (g_topRow > 0) g_topRow--;
+        if (g_selAnchor >= 0) {
+            g_selAnchor--;
+            g_selEnd--;
+            if (g_selAnchor < 0 || g_selEnd < 0) g_selAnchor = g_selEnd = -1;
+        }
+    }
+    scrollback_line(g_lineCount - 1)->len = 0;
+}
+
+// Appends engine text: "\r\n" ends a line, tabs go to the next multiple of 8
+static void scrollback_write(const char* text) {
+    while (*text) {
+        int n = (int)strcspn(text, "\r\n\t");
+        if (n > 0) scrollback_add(text, n);
+        text += n;
+        if (*text == '\n') {
+            scrollback_newline();
+        } else if (*text == '\t') {
+            static const char spaces[] = "        ";
+            scrollback_add(spaces, 8 - scrollback_line(g_lineCount - 1)->len % 8);
+        }
+        if (*text) text++;
+    }
+}
+
+static void scrollback_clear(void) {
+    for (int i = 0; i < g_lineCount; i++) scrollback_line(i)->len = 0;
+    g_lineFirst = 0;
+    g_lineCount = 1;
+    g_topRow = 0;
+    g_selAnchor = g_selEnd = -1;
+}
+
+// ---------------- Input line ----------------
+// What the user types lives here, not in the scrollback, until Enter. It is
+// drawn after the open line; EDITCODE input may span several rows.
+#define INPUT_MAX 4096
+static char g_input[INPUT_MAX];
+static int g_inputLen = 0;
+static int g_inputCursor = 0;
+static char g_status[256];                // job status shown after the open line
+static BOOL g_statusShown = FALSE;
+
+static void input_set(const char* text) {
+    g_inputLen = (int)strlen(text);
+    if (g_inputLen >= INPUT_MAX) g_inputLen = INPUT_MAX - 1;
+    memcpy(g_input, text, (size_t)g_inputLen);
+    g_input[g_inputLen] = '\0';
+    g_inputCursor = g_inputLen;
+}
+
+static void input_insert(const char* text, int n) {
+    if (n > INPUT_MAX - 1 - g_inputLen) n = INPUT_MAX - 1 - g_inputLen;
+    if (n <= 0) return;
+    memmove(g_input + g_inputCursor + n, g_input + g_inputCursor, (size_t)(g_inputLen - g_inputCursor + 1));
+    memcpy(g_input + g_inputCursor, text, (size_t)n);
+    g_inputLen += n;
+    g_inputCursor += n;
+}
+
+static void input_delete(int at, int n) {
+    if (at < 0 || n <= 0 || at + n > g_inputLen) return;
+    memmove(g_input + at, g_input + at + n, (size_t)(g_inputLen - at - n + 1));
+    g_inputLen -= n;
+    if (g_inputCursor > at) g_inputCursor = (g_inputCursor >= at + n) ? g_inputCursor - n : at;
+}
+
+// Rows the input adds below the open line
+static int input_extra_rows(void) {
+    int rows = 0;
+    for (int i = 0; i < g_inputLen; i++) if (g_input[i] == '\n') rows++;
+    return rows;
+}
+
+// ---------------- View ----------------
+static int view_total_rows(void) {
+    return g_lineCount + input_extra_rows();
+}
+
+static int view_visible_rows(void) {
+    RECT rc;
+    GetClientRect(g_hOut, &rc);
+    int rows = (rc.bottom - rc.top) / g_lineHeight;
+    return rows > 0 ? rows : 1;
+}
+
+static int view_max_top(void) {
+    int top = view_total_rows() - view_visible_rows();
+    return top > 0 ? top : 0;
+}
+
+// A row's text in two pieces: the line, then the status or the first input
+// row when it is the open line. Input rows below it have only the input.
+static void view_row_parts(int row, const char** a, int* a_len, const char** b, int* b_len) {
+    *a = ""; *a_len = 0; *b = ""; *b_len = 0;
+    if (row < g_lineCount) {
+        ScrollLine* line = scrollback_line(row);
+        if (line->text) { *a = line->text; *a_len = line->len; }
+        if (row != g_lineCount - 1) return;
+        if (g_statusShown) {
+            *b = g_status;
+            *b_len = (int)strlen(g_status);
+            return;
+        }
+        *b = g_input;
+        *b_len = (int)strcspn(g_input, "\n");
+        return;
+    }
+    // Input row n (n >= 1) starts after the n-th '\n'
+    int n = row - g_lineCount + 1;
+    const char* p = g_input;
+    while (n > 0 && (p = strchr(p, '\n')) != NULL) { p++; n--; }
+    if (!p) return;
+    *a = p;
+    *a_len = (int)strcspn(p, "\n");
+}
+
+static void view_caret_position(int* row, int* col) {
+    int r = g_lineCount - 1;
+    int c = scrollback_line(r)->len;
+    for (int i = 0; i < g_inputCursor; i++) {
+        if (g_input[i] == '\n') { r++; c = 0; } else { c++; }
+    }
+    *row = r;
+    *col = c;
+}
+
+static void view_update_caret(void) {
+    if (GetFocus() != g_hOut) return;
+    int row, col;
+    view_caret_position(&row, &col);
+    SetCaretPos(col * g_charWidth, (row - g_topRow) * g_lineHeight);
+}
+
+static void view_update_scrollbar(void) {
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+    si.nMin = 0;
+    si.nMax = view_total_rows() - 1;
+    si.nPage = (UINT)view_visible_rows();
+    si.nPos = g_topRow;
+    SetScrollInfo(g_hOut, SB_VERT, &si, TRUE);
+}
+
+static void view_scroll_to(int top) {
+    int max_top = view_max_top();
+    if (top > max_top) top = max_top;
+    if (top < 0) top = 0;
+    g_follow = (top == max_top);
+    if (top == g_topRow) return;
+    g_topRow = top;
+    view_update_scrollbar();
+    view_update_caret();
+    InvalidateRect(g_hOut, NULL, FALSE);
+}
+
+// Something changed; follow: bring the newest row into view
+static void view_changed(BOOL follow) {
+    if (!g_hOut) return;
+    if (follow) g_follow = TRUE;
+    if (g_follow) g_topRow = view_max_top();
+    if (g_topRow > view_max_top()) g_topRow = view_max_top();
+    view_update_scrollbar();
+    view_update_caret();
+    InvalidateRect(g_hOut, NULL, FALSE);
+}
+
+static void view_paint(HWND hWnd) {
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hWnd, &ps);
+    RECT rc;
+    GetClientRect(hWnd, &rc);
+
+    // Off screen first, so a repaint never flickers
+    HDC mem = CreateCompatibleDC(hdc);
+    HBITMAP bmp = CreateCompatibleBitmap(hdc, rc.right, rc.bottom);
+    HGDIOBJ old_bmp = SelectObject(mem, bmp);
+    HGDIOBJ old_font = SelectObject(mem, g_hMono);
+
+    COLORREF text_color, bg_color;
+    theme_current_colors(&text_color, &bg_color);
+    HBRUSH bg = CreateSolidBrush(bg_color);
+    FillRect(mem, &rc, bg);
+    DeleteObject(bg);
+    SetBkMode(mem, OPAQUE);
+
+    int sel_lo = g_selAnchor < g_selEnd ? g_selAnchor : g_selEnd;
+    int sel_hi = g_selAnchor < g_selEnd ? g_selEnd : g_selAnchor;
+    int rows = view_visible_rows() + 1;
+    int total = view_total_rows();
+    for (int i = 0; i < rows && g_topRow + i < total; i++) {
+        int row = g_topRow + i;
+        int y = i * g_lineHeight;
+        BOOL selected = (g_selAnchor >= 0 && row >= sel_lo && row <= sel_hi);
+        if (selected) {
+            RECT band = { 0, y, rc.right, y + g_lineHeight };
+            HBRUSH hl = CreateSolidBrush(text_color);
+            FillRect(mem, &band, hl);
+            DeleteObject(hl);
+        }
+        SetTextColor(mem, selected ? bg_color : text_color);
+        SetBkColor(mem, selected ? text_color : bg_color);
+
+        const char *a, *b;
+        int a_len, b_len;
+        view_row_parts(row, &a, &a_len, &b, &b_len);
+        if (a_len > 0) TextOutA(mem, 0, y, a, a_len);
+        if (b_len > 0) TextOutA(mem, a_len * g_charWidth, y, b, b_len);
+    }
+
+    BitBlt(hdc, 0, 0, rc.right, rc.bottom, mem, 0, 0, SRCCOPY);
+    SelectObject(mem, old_font);
+    SelectObject(mem, old_bmp);
+    DeleteObject(bmp);
+    DeleteDC(mem);
+    EndPaint(hWnd, &ps);
+}
+
+static int view_row_at(int y) {
+    int row = g_topRow + y / g_lineHeight;
+    int total = view_total_rows();
+    return row < total ? row : total - 1;
+}
+
+// Copies the selected rows to the clipboard, one line each
+static BOOL view_copy_selection(void) {
+    if (g_selAnchor < 0) return FALSE;
+    int lo = g_selAnchor < g_selEnd ? g_selAnchor : g_selEnd;
+    int hi = g_selAnchor < g_selEnd ? g_selEnd : g_selAnchor;
+    size_t size = 1;
+    for (int row = lo; row <= hi; row++) {
+        const char *a, *b;
+        int a_len, b_len;
+        view_row_parts(row, &a, &a_len, &b, &b_len);
+        size += (size_t)(a_len + b_len) + 2;
+    }
+    HGLOBAL mem = GlobalAlloc(GMEM_MOVEABLE, size);
+    char* out = mem ? (char*)GlobalLock(mem) : NULL;
+    if (!out) {
+        if (mem) GlobalFree(mem);
+        return TRUE;
+    }
+    size_t n = 0;
+    for (int row = lo; row <= hi; row++) {
+        const char *a, *b;
+        int a_len, b_len;
+        view_row_parts(row, &a, &a_len, &b, &b_len);
+        memcpy(out + n, a, (size_t)a_len); n += (size_t)a_len;
+        memcpy(out + n, b, (size_t)b_len); n += (size_t)b_len;
+        if (row < hi) { out[n++] = '\r'; out[n++] = '\n'; }
+    }
+    out[n] = '\0';
+    GlobalUnlock(mem);
+    if (OpenClipboard(g_hOut)) {
+        EmptyClipboard();
+        if (!SetClipboardData(CF_TEXT, mem)) GlobalFree(mem);
+        CloseClipboard();
+    } else {
+        GlobalFree(mem);
+    }
+    g_selAnchor = g_selEnd = -1;
+    InvalidateRect(g_hOut, NULL, FALSE);
+    return TRUE;
+}
+
+// Ctrl+V: the clipboard's text goes in at the cursor; commands take one line
+static void view_paste(void) {
+    if (!OpenClipboard(g_hOut)) return;
+    HGLOBAL mem = GetClipboardData(CF_TEXT);
+    const char* text = mem ? (const char*)GlobalLock(mem) : NULL;
+    if (text) {
+        BOOL multi_line = editor_active();
+        for (const char* p = text; *p; p++) {
+            if (*p == '\r') continue;
+            if (*p == '\n' && !multi_line) break;
+            input_insert(p, 1);
+        }
+        GlobalUnlock(mem);
+    }
+    CloseClipboard();
+    view_changed(TRUE);
+}
+
+// ---------------- Output sink ----------------
+static void win32_write(const char* text) {
+    scrollback_write(text);
+    view_changed(FALSE);
+    // Commands run on this thread; paint now so long output is seen as it comes
+    UpdateWindow(g_hOut);
+}
+
+static void win32_clear(void) {
+    scrollback_clear();
+    g_statusShown = FALSE;
+    view_changed(TRUE);
+}
+
+static void win32_prompt(void) {
+    gui_print_prompt();
+    gui_flush();
+    view_changed(TRUE);
+    SetFocus(g_hOut);
+}
+
+static void win32_refresh(void) {
+    scrollback_resize(settings_scrollback_lines());
+    view_changed(FALSE);
+}
+
+static void win32_status_line(const char* text) {
+    if (text) snprintf(g_status, sizeof(g_status), "%s", text);
+    g_statusShown = (text != NULL);
+    view_changed(FALSE);
+    UpdateWindow(g_hOut);
+}
+
+// Background jobs tick on a window timer and report back with a message
+static BOOL win32_job_begin(void) {
+    if (!g_hWnd) return FALSE;
+    SetTimer(g_hWnd, JOB_TIMER_ID, SYNC_STATUS_INTERVAL_MS, NULL);
+    return TRUE;
+}
+
+static void win32_job_end(void) {
+    KillTimer(g_hWnd, JOB_TIMER_ID);
+}
+
+static void win32_job_wake(void) {
+    PostMessageA(g_hWnd, WM_JOB_WAKE, 0, 0);
+}
+
+static const OutputSink g_win32Sink = {
+    win32_write,
+    win32_clear,
+    win32_prompt,
+    win32_refresh,
+    win32_status_line,
+    win32_job_begin,
+    win32_job_end,
+    win32_job_wake,
+    NULL
+};
+
+// ---------------- Command history ----------------
+static void add_to_history(const char* command) {
+    // Don't add empty commands or duplicate of last command
+    if (strlen(command) == 0) return;
+    if (g_historyCount > 0 && strcmp(g_commandHistory[g_historyCount - 1], command) == 0) return;
+
+    // Shift history if we're at max capacity
+    if (g_historyCount >= MAX_HISTORY) {
+        for (int i = 0; i < MAX_HISTORY - 1; i++) {
+            strcpy(g_commandHistory[i], g_commandHistory[i + 1]);
+        }
+        g_historyCount = MAX_HISTORY - 1;
+    }
+
+    // Add new command
+    strncpy(g_commandHistory[g_historyCount], command, 255);
+    g_commandHistory[g_historyCount][255] = '\0';
+    g_historyCount++;
+    g_historyIndex = g_historyCount; // Reset to "new command" position
+}
+
+static void navigate_history(int direction) {
+    if (g_historyCount == 0) return;
+
+    // Save current input if we're at the "new command" position
+    if (g_historyIndex == g_historyCount) {
+        snprintf(g_currentInput, sizeof(g_currentInput), "%s", g_input);
+    }
+
+    // Navigate through history
+    if (direction < 0) { // Up arrow - go to older commands
+        if (g_historyIndex > 0) {
+            g_historyIndex--;
+        }
+    } else { // Down arrow - go to newer commands
+        if (g_historyIndex < g_historyCount) {
+            g_historyIndex++;
+        }
+    }
+
+    // Update the input field
+    if (g_historyIndex < g_historyCount) {
+        update_input_field(g_commandHistory[g_historyIndex]);
+    } else {
+        update_input_field(g_currentInput);
+    }
+}
+
+static void update_input_field(const char* text) {
+    input_set(text);
+    view_changed(TRUE);
+}
+
+// Enter: the typed line joins the output and runs
+static void submit_input(void) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", g_input);
+    input_set("");
+
+    gui_append(buf);
+    gui_append("\r\n");
+
+    // Add command to history if it's not empty
+    if (strlen(buf) > 0) {
+        add_to_history(buf);
+    }
+
+    if (!process_command(buf)) {
+        PostMessage(g_hWnd, WM_CLOSE, 0, 0);
+        return;
+    }
+    gui_show_prompt_when_idle();
+}
+
+// Keys while the running program reads its input: Enter sends the line,
+// Ctrl+Z or Ctrl+D ends the input, and the rest edits the line as usual
+static void job_input_char(WPARAM ch) {
+    if (ch == '\r' || ch == '\n') {
+        char buf[INPUT_MAX];
+        snprintf(buf, sizeof(buf), "%s", g_input);
+        input_set("");
+        jobs_input(buf);
+    } else if (ch == 26 || ch == 4) {
+        jobs_input(NULL);
+    } else if (ch == 22) {
+        view_paste();
+        return;
+    } else if (ch == '\b') {
+        input_delete(g_inputCursor - 1, 1);
+    } else if (ch >= 32 && ch < 256 && ch != 127) {
+        char c = (char)ch;
+        input_insert(&c, 1);
+    } else {
+        return;
+    }
+    view_changed(TRUE);
+}
+
+// Tab at the end of the line: the engine fills in the last word. When that
+// leaves several names to choose from and nothing more to fill in, they are
+// listed under the line and the line is offered again.
+static void complete_input(void) {
+    if (g_inputCursor != g_inputLen) return;
+    char line[INPUT_MAX];
+    char choices[2048];
+    snprintf(line, sizeof(line), "%s", g_input);
+    int count = engine_complete(line, sizeof(line), choices, sizeof(choices));
+    if (count > 1 && strcmp(line, g_input) == 0) {
+        input_set("");
+        gui_append(line);
+        gui_append("\r\n");
+        gui_append(choices);
+        gui_append("\r\n");
+        win32_prompt();
+    }
+    input_set(line);
+}
+
+// Ctrl+S in EDITCODE: the typed rows, with Windows line breaks, become the file
+static void editor_submit(void) {
+    char* text = (char*)malloc((size_t)g_inputLen * 2 + 1);
+    if (!text) {
+        editor_cancel();
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < g_inputLen; i++) {
+        if (g_input[i] == '\n') text[n++] = '\r';
+        text[n++] = g_input[i];
+    }
+    text[n] = '\0';
+    scrollback_write(g_input);
+    input_set("");
+    gui_append("\r\n");
+    editor_save(text);
+    free(text);
+}
+
+// ---------------- Terminal view ----------------
+static LRESULT CALLBACK OutputViewProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_GETDLGCODE:
+            return DLGC_WANTALLKEYS | DLGC_WANTCHARS;
+        case WM_ERASEBKGND:
+            return 1; // WM_PAINT covers every pixel
+        case WM_PAINT:
+            view_paint(hWnd);
+            return 0;
+        case WM_SIZE:
+            view_changed(FALSE);
+            return 0;
+        case WM_MOUSEWHEEL: {
+            int delta = GET_WHEEL_DELTA_WPARAM(wParam);
+            int lines = 3; // Scroll 3 lines at a time
+            view_scroll_to(g_topRow + (delta > 0 ? -lines : lines));
+            return 0;
+        }
+        case WM_VSCROLL: {
+            SCROLLINFO si;
+            ZeroMemory(&si, sizeof(si));
+            si.cbSize = sizeof(si);
+            si.fMask = SIF_ALL;
+            GetScrollInfo(hWnd, SB_VERT, &si);
+            int top = g_topRow;
+            switch (LOWORD(wParam)) {
+                case SB_LINEUP:     top--; break;
+                case SB_LINEDOWN:   top++; break;
+                case SB_PAGEUP:     top -= (int)si.nPage; break;
+                case SB_PAGEDOWN:   top += (int)si.nPage; break;
+                case SB_THUMBTRACK: top = si.nTrackPos; break;
+                case SB_TOP:        top = 0; break;
+                case SB_BOTTOM:     top = view_max_top(); break;
+            }
+            view_scroll_to(top);
+            return 0;
+        }
+        case WM_SETFOCUS:
+            CreateCaret(hWnd, NULL, 2, g_lineHeight);
+            view_update_caret();
+            ShowCaret(hWnd);
+            return 0;
+        case WM_KILLFOCUS:
+            DestroyCaret();
+            return 0;
+        case WM_LBUTTONDOWN:
+            SetFocus(hWnd);
+            SetCapture(hWnd);
+            g_selecting = TRUE;
+            g_selAnchor = g_selEnd = view_row_at(GET_Y_LPARAM(lParam));
+            InvalidateRect(hWnd, NULL, FALSE);
+            return 0;
+        case WM_MOUSEMOVE:
+            if (g_selecting) {
+                int y = GET_Y_LPARAM(lParam);
+                if (y < 0) view_scroll_to(g_topRow - 1);
+                if (y >= view_visible_rows() * g_lineHeight) view_scroll_to(g_topRow + 1);
+                g_selEnd = view_row_at(y < 0 ? 0 : y);
+                InvalidateRect(hWnd, NULL, FALSE);
+            }
+            return 0;
+        case WM_LBUTTONUP:
+            if (g_selecting) {
+                g_selecting = FALSE;
+                ReleaseCapture();
+                // A plain click selects nothing
+                if (g_selAnchor == g_selEnd) {
+                    g_selAnchor = g_selEnd = -1;
+                    InvalidateRect(hWnd, NULL, FALSE);
+                }
+            }
+            return 0;
+        case WM_KEYDOWN: {
+            // No editing while a sync or a program holds the terminal,
+            // unless the program reads what is typed
+            if (jobs_foreground() && !jobs_input_wanted()) return 0;
+
+            switch (wParam) {
+                case VK_UP:
+                    if (!editor_active()) navigate_history(-1); // Go up in history
+                    return 0;
+                case VK_DOWN:
+                    if (!editor_active()) navigate_history(1); // Go down in history
+                    return 0;
+                case VK_PRIOR:
+                    view_scroll_to(g_topRow - view_visible_rows());
+                    return 0;
+                case VK_NEXT:
+                    view_scroll_to(g_topRow + view_visible_rows());
+                    return 0;
+                case VK_LEFT:
+                    if (g_inputCursor > 0) g_inputCursor--;
+                    break;
+                case VK_RIGHT:
+                    if (g_inputCursor < g_inputLen) g_inputCursor++;
+                    break;
+                case VK_HOME:
+                    while (g_inputCursor > 0 && g_input[g_inputCursor - 1] != '\n') g_inputCursor--;
+                    break;
+                case VK_END:
+                    while (g_inputCursor < g_inputLen && g_input[g_inputCursor] != '\n') g_inputCursor++;
+                    break;
+                case VK_DELETE:
+                    input_delete(g_inputCursor, 1);
+                    break;
+                default:
+                    return 0;
+            }
+            view_changed(TRUE);
+            return 0;
+        }
+        case WM_CHAR: {
+            // A running sync or program only listens for Ctrl+C, or takes
+            // the typed line as its input
+            if (jobs_foreground()) {
+                if (wParam == 3) {
+                    jobs_interrupt();
+                } else if (jobs_input_wanted()) {
+                    job_input_char(wParam);
+                }
+                return 0;
+            }
+
+            if (wParam == 3 && view_copy_selection()) return 0; // Ctrl+C with a selection copies
+            if (wParam == 22) { // Ctrl+V
+                view_paste();
+                return 0;
+            }
+
+            // Handle edit mode
+            if (editor_active()) {
+                if (wParam == 19) { // Ctrl+S (save)
+                    editor_submit();
+                    return 0;
+                } else if (wParam == 3) { // Ctrl+C (cancel)
+                    scrollback_write(g_input);
+                    input_set("");
+                    gui_append("\r\n");
+                    editor_cancel();
+                    return 0;
+                } else if (wParam == '\r' || wParam == '\n') {
+                    input_insert("\n", 1);
+                    view_changed(TRUE);
+                    return 0;
+                } else if (wParam == '\t') {
+                    input_insert("    ", 4);
+                    view_changed(TRUE);
+                    return 0;
+                }
+            }
+
+            // Normal command mode
+            if (wParam == '\r' || wParam == '\n') {
+                submit_input();
+                return 0;
+            }
+            if (wParam == '\t') {
+                complete_input();
+            } else if (wParam == '\b') {
+                input_delete(g_inputCursor - 1, 1);
+            } else if (wParam >= 32 && wParam < 256 && wParam != 127) {
+                char c = (char)wParam;
+                input_insert(&c, 1);
+            } else {
+                return 0;
+            }
+            view_changed(TRUE);
+            return 0;
+        }
+    }
+    return DefWindowProcA(hWnd, msg, wParam, lParam);
+}
+
+static void create_child_controls(HWND hWnd) {
+    g_hWnd = hWnd;
+    scrollback_resize(settings_scrollback_lines());
+    g_hOut = CreateWindowExA(0, VIEW_CLASS, "", WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_TABSTOP,
+                             0, 0, 800, 500, hWnd, (HMENU)1001, GetModuleHandle(NULL), NULL);
+
+    g_hMono = CreateFontA(18, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, FIXED_PITCH | FF_DONTCARE, "Consolas");
+    HDC hdc = GetDC(g_hOut);
+    HGDIOBJ old = SelectObject(hdc, g_hMono);
+    TEXTMETRICA tm;
+    if (GetTextMetricsA(hdc, &tm)) {
+        g_charWidth = tm.tmAveCharWidth;
+        g_lineHeight = tm.tmHeight;
+    }
+    SelectObject(hdc, old);
+    ReleaseDC(g_hOut, hdc);
+    SetFocus(g_hOut);
+}
+
+static void layout_children(HWND hWnd) {
+    RECT rc; GetClientRect(hWnd, &rc);
+    MoveWindow(g_hOut, 0, 0, rc.right, rc.bottom, TRUE);
+}
+
+// ---------------- Start-up options ----------------
+static void parse_command_line(const char* cmdline) {
+    char word[MAX_PATH];
+    BOOL want_script = FALSE;
+    const char* p = cmdline;
+    while (*p) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+        size_t n = 0;
+        BOOL quoted = FALSE;
+        while (*p && (quoted || (*p != ' ' && *p != '\t'))) {
+            if (*p == '"') { quoted = !quoted; p++; continue; }
+            if (n + 1 < sizeof(word)) word[n++] = *p;
+            p++;
+        }
+        word[n] = '\0';
+
+        if (want_script) {
+            snprintf(g_startupScript, sizeof(g_startupScript), "%s", word);
+            want_script = FALSE;
+        } else if (strcmp(word, "--script") == 0) {
+            want_script = TRUE;
+        } else if (strcmp(word, "--time") == 0) {
+            g_startupScriptFlags |= SCRIPT_TIME;
+        } else if (strcmp(word, "--keep-going") == 0) {
+            g_startupScriptFlags |= SCRIPT_KEEP_GOING;
+        }
+    }
+}
+
+static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_ERASEBKGND: {
+            HDC hdc = (HDC)wParam;
+            RECT rc; GetClientRect(hWnd, &rc);
+
+            // Get current theme background color
+            COLORREF text_color, bg_color;
+            theme_current_colors(&text_color, &bg_color);
+
+            // Recreate brush with current theme color
+            if (g_hbrBlack) DeleteObject(g_hbrBlack);
+            g_hbrBlack = CreateSolidBrush(bg_color);
+            FillRect(hdc, &rc, g_hbrBlack);
+            return 1;
+        }
+        case WM_CREATE:
+            create_child_controls(hWnd);
+            fs_init();
+            init_ide_configs();
+            layout_children(hWnd);
+            // Apply theme after GUI is fully initialized
+            apply_theme(NULL);
+            
+            // Show title at top left, above command prompt
+            gui_println("NEXUS TERMINAL v5.0");
+            gui_println("");
+
+            // Then show command prompt (after the startup sync, if it is still running).
+            // A start-up script goes first, from the message loop: WinMain
+            // still has users and themes to set up.
+            if (g_startupScript[0]) {
+                PostMessage(hWnd, WM_RUN_SCRIPT, 0, 0);
+            } else {
+                gui_show_prompt_when_idle();
+            }
+            
+            // Force initial cursor draw
+            InvalidateRect(g_hOut, NULL, FALSE);
+            return 0;
+        case WM_ACTIVATE:
+            if (LOWORD(wParam) != WA_INACTIVE && g_hOut) SetFocus(g_hOut);
+            return 0;
+        case WM_SIZE:
+            layout_children(hWnd);
+            return 0;
+        case WM_TIMER:
+            if (wParam == JOB_TIMER_ID) jobs_poll();
+            return 0;
+        case WM_JOB_WAKE:
+            jobs_wake();
+            return 0;
+        case WM_RUN_SCRIPT: {
+            BOOL quit = FALSE;
+            script_run(g_startupScript, g_startupScriptFlags, &quit);
+            if (quit) {
+                PostMessage(hWnd, WM_CLOSE, 0, 0);
+            } else {
+                gui_show_prompt_when_idle();
+            }
+            return 0;
+        }
+        case WM_DESTROY:
+            // Stop any sync and running programs, then auto-save filesystem before closing
+            jobs_abandon();
+            fs_save_to_disk();
+            
+            if (g_hbrBlack) { DeleteObject(g_hbrBlack); g_hbrBlack = NULL; }
+            PostQuitMessage(0);
+            return 0;
+    }
+    return DefWindowProc(hWnd, msg, wParam, lParam);
+}
+
+int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE hPrev, LPSTR lpCmdLine, int nCmdShow) {
+    WNDCLASSA wc = {0};
+    wc.style = CS_HREDRAW | CS_VREDRAW;
+    wc.lpfnWndProc = WndProc;
+    wc.hInstance = hInst;
+    wc.hCursor = LoadCursor(NULL, IDC_IBEAM);
+    wc.hIcon = LoadIcon(NULL, IDI_APPLICATION);
+    if (!g_hbrBlack) g_hbrBlack = CreateSolidBrush(RGB(0,0,0));
+    wc.hbrBackground = g_hbrBlack;
+    wc.lpszClassName = "SimpleGuiTermClass";
+    if (!RegisterClassA(&wc)) return 1;
+
+    WNDCLASSA view = {0};
+    view.lpfnWndProc = OutputViewProc;
+    view.hInstance = hInst;
+    view.hCursor = LoadCursor(NULL, IDC_IBEAM);
+    view.lpszClassName = VIEW_CLASS;
+    if (!RegisterClassA(&view)) return 1;
+    parse_command_line(lpCmdLine);
+
+    // WM_CREATE already prints, so the sink goes in first
+    engine_set_sink(&g_win32Sink);
+
+    HWND hWnd = CreateWindowExA(0, wc.lpszClassName, "NEXUS TERMINAL", WS_OVERLAPPEDWINDOW, 100, 100, 800, 500, NULL, NULL, hInst, NULL);
+    if (!hWnd) return 1;
+    
+    // Initialize security and theme systems
+    init_security_system();
+    init_theme_system();
+    
+    // Initialize project detection
+    detect_project_type();
+    
+    ShowWindow(hWnd, SW_SHOW);
+    UpdateWindow(hWnd);
+    SetForegroundWindow(hWnd);
+    BringWindowToTop(hWnd);
+
+    MSG msg;
+    while (GetMessage(&msg, NULL, 0, 0)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    return (int)msg.wParam;
+}
+
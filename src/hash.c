@@ -0,0 +1,325 @@
+#include "hash.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define HASH_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HASH_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+// Key material: stripe n of a block is keyed at offset n * 8, the scramble
+// after each block uses the last 64 bytes.
+#define SECRET_BYTES 192
+#define SECRET_SCRAMBLE (SECRET_BYTES - HASH_STRIPE_BYTES)
+#define SECRET_TAIL 7
+#define SECRET_MERGE_LO 11
+#define SECRET_MERGE_HI 117
+
+static const unsigned char k_secret[SECRET_BYTES] = {
+    0x89, 0x61, 0x15, 0x1b, 0xd2, 0x09, 0x9c, 0x16, 0xac, 0x8d, 0x8b, 0x21,
+    0x26, 0x2f, 0xd5, 0xd0, 0xe9, 0x72, 0xab, 0x43, 0xdf, 0x85, 0x8c, 0x4e,
+    0x61, 0xd1, 0x77, 0xee, 0x96, 0xde, 0x5b, 0x0b, 0x1b, 0x0b, 0x60, 0xea,
+    0xbd, 0x78, 0xed, 0x51, 0xe7, 0xa8, 0x3e, 0x3b, 0x93, 0xb7, 0x35, 0x1d,
+    0xeb, 0x2c, 0xef, 0xb0, 0x4a, 0xad, 0xb4, 0x7c, 0x02, 0x13, 0xe1, 0x9b,
+    0x33, 0x64, 0x25, 0x3e, 0x33, 0xfc, 0xf7, 0x7d, 0xae, 0x7a, 0x39, 0x72,
+    0xc1, 0x25, 0x5b, 0x9f, 0xf0, 0xed, 0xd1, 0xe4, 0x4f, 0xa8, 0xc6, 0x62,
+    0x03, 0xef, 0x52, 0x23, 0x9f, 0xcd, 0x2b, 0x3c, 0x9b, 0x06, 0xd1, 0x5c,
+    0xc0, 0x7d, 0x75, 0x64, 0x3a, 0x15, 0x0e, 0x8c, 0x40, 0xb8, 0xe2, 0xbd,
+    0xf3, 0x71, 0xf8, 0x54, 0x76, 0x93, 0x44, 0xb7, 0xdd, 0x98, 0xa2, 0xbb,
+    0x41, 0xb5, 0x66, 0x30, 0x55, 0x01, 0x72, 0xa3, 0x43, 0xae, 0x98, 0x30,
+    0x15, 0x20, 0x4e, 0xb2, 0x1a, 0x60, 0xf1, 0xb5, 0x80, 0x1e, 0x6b, 0x91,
+    0x67, 0xfc, 0x0a, 0xe7, 0x50, 0xe1, 0x6a, 0x7b, 0x06, 0x5a, 0x28, 0x03,
+    0x2d, 0x49, 0x7d, 0xb8, 0xce, 0x73, 0x54, 0xb7, 0x28, 0xa1, 0xa0, 0xe6,
+    0x79, 0x24, 0xdf, 0x65, 0xf9, 0x91, 0x67, 0x35, 0x29, 0xb0, 0xbe, 0xf6,
+    0xe6, 0x5b, 0xb6, 0x93, 0x1d, 0x83, 0x0f, 0xf7, 0x6b, 0xf6, 0xec, 0x93,
+};
+
+static unsigned long long read64(const unsigned char* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8) |
+           ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24) |
+           ((unsigned long long)p[4] << 32) | ((unsigned long long)p[5] << 40) |
+           ((unsigned long long)p[6] << 48) | ((unsigned long long)p[7] << 56);
+#else
+    unsigned long long v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+// ---- Stripe accumulation: one implementation per instruction set ----
+// Each lane adds the product of the low and high halves of (data ^ key) and
+// the neighbouring lane's raw data. stripe n is keyed at secret + n * 8.
+typedef void (*HashAccumulateFn)(unsigned long long* acc, const unsigned char* in, size_t stripes,
+                                 const unsigned char* secret);
+
+static void accumulate_scalar(unsigned long long* acc, const unsigned char* in, size_t stripes,
+                              const unsigned char* secret) {
+    for (size_t n = 0; n < stripes; n++) {
+        const unsigned char* data = in + n * HASH_STRIPE_BYTES;
+        const unsigned char* key = secret + n * 8;
+        for (int i = 0; i < 8; i++) {
+            unsigned long long d = read64(data + i * 8);
+            unsigned long long dk = d ^ read64(key + i * 8);
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+        }
+    }
+}
+
+#ifdef HASH_HAVE_SSE2
+static void accumulate_sse2(unsigned long long* acc, const unsigned char* in, size_t stripes,
+                            const unsigned char* secret) {
+    __m128i a[4];
+    for (int i = 0; i < 4; i++) a[i] = _mm_loadu_si128((const __m128i*)(acc + i * 2));
+    for (size_t n = 0; n < stripes; n++) {
+        const unsigned char* data = in + n * HASH_STRIPE_BYTES;
+        const unsigned char* key = secret + n * 8;
+        for (int i = 0; i < 4; i++) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(data + i * 16));
+            __m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)(key + i * 16)));
+            __m128i dk_hi = _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1));
+            __m128i product = _mm_mul_epu32(dk, dk_hi);
+            __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (int i = 0; i < 4; i++) _mm_storeu_si128((__m128i*)(acc + i * 2), a[i]);
+}
+#endif
+
+#ifdef HASH_HAVE_AVX2
+__attribute__((target("avx2")))
+static void accumulate_avx2(unsigned long long* acc, const unsigned char* in, size_t stripes,
+                            const unsigned char* secret) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+    for (size_t n = 0; n < stripes; n++) {
+        const unsigned char* data = in + n * HASH_STRIPE_BYTES;
+        const unsigned char* key = secret + n * 8;
+
+        __m256i d0 = _mm256_loadu_si256((const __m256i*)data);
+        __m256i d1 = _mm256_loadu_si256((const __m256i*)(data + 32));
+        __m256i dk0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*)key));
+        __m256i dk1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*)(key + 32)));
+        __m256i p0 = _mm256_mul_epu32(dk0, _mm256_shuffle_epi32(dk0, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i p1 = _mm256_mul_epu32(dk1, _mm256_shuffle_epi32(dk1, _MM_SHUFFLE(0, 3, 0, 1)));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    _mm256_storeu_si256((__m256i*)acc, a0);
+    _mm256_storeu_si256((__m256i*)(acc + 4), a1);
+}
+#endif
+
+int hash_impl_available(HashImpl impl) {
+    switch (impl) {
+        case HASH_IMPL_AUTO:
+        case HASH_IMPL_SCALAR:
+            return 1;
+        case HASH_IMPL_SSE2:
+#ifdef HASH_HAVE_SSE2
+            return 1;
+#else
+            return 0;
+#endif
+        case HASH_IMPL_AVX2:
+#ifdef HASH_HAVE_AVX2
+            return __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+            return 0;
+#endif
+        default:
+            return 0;
+    }
+}
+
+const char* hash_impl_name(HashImpl impl) {
+    switch (impl) {
+        case HASH_IMPL_AUTO:   return "auto";
+        case HASH_IMPL_SCALAR: return "scalar";
+        case HASH_IMPL_SSE2:   return "sse2";
+        case HASH_IMPL_AVX2:   return "avx2";
+        default:               return "?";
+    }
+}
+
+static HashImpl hash_resolve_impl(HashImpl impl) {
+    if (impl != HASH_IMPL_AUTO && hash_impl_available(impl)) return impl;
+    if (hash_impl_available(HASH_IMPL_AVX2)) return HASH_IMPL_AVX2;
+    if (hash_impl_available(HASH_IMPL_SSE2)) return HASH_IMPL_SSE2;
+    return HASH_IMPL_SCALAR;
+}
+
+static HashAccumulateFn hash_accumulator(HashImpl impl) {
+    switch (impl) {
+#ifdef HASH_HAVE_AVX2
+        case HASH_IMPL_AVX2: return accumulate_avx2;
+#endif
+#ifdef HASH_HAVE_SSE2
+        case HASH_IMPL_SSE2: return accumulate_sse2;
+#endif
+        default: return accumulate_scalar;
+    }
+}
+
+// Runs once per 1 KB block, so it stays scalar
+static void scramble(unsigned long long* acc) {
+    const unsigned char* key = k_secret + SECRET_SCRAMBLE;
+    for (int i = 0; i < 8; i++) {
+        unsigned long long a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(key + i * 8);
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+static void process_blocks(unsigned long long* acc, const unsigned char* in, size_t blocks, HashAccumulateFn fn) {
+    for (size_t b = 0; b < blocks; b++) {
+        fn(acc, in + b * HASH_BLOCK_BYTES, HASH_BLOCK_STRIPES, k_secret);
+        scramble(acc);
+    }
+}
+
+void hash_init_impl(HashState* state, HashImpl impl) {
+    state->acc[0] = PRIME32_3;
+    state->acc[1] = PRIME64_1;
+    state->acc[2] = PRIME64_2;
+    state->acc[3] = PRIME64_3;
+    state->acc[4] = PRIME64_4;
+    state->acc[5] = PRIME32_2;
+    state->acc[6] = PRIME64_5;
+    state->acc[7] = PRIME32_1;
+    state->buffered = 0;
+    state->total = 0;
+    state->impl = hash_resolve_impl(impl);
+}
+
+void hash_init(HashState* state) {
+    hash_init_impl(state, HASH_IMPL_AUTO);
+}
+
+void hash_update(HashState* state, const void* data, size_t len) {
+    const unsigned char* in = (const unsigned char*)data;
+    HashAccumulateFn fn = hash_accumulator(state->impl);
+    state->total += len;
+
+    // Top up a partial block first
+    if (state->buffered > 0) {
+        size_t take = HASH_BLOCK_BYTES - state->buffered;
+        if (take > len) take = len;
+        memcpy(state->buffer + state->buffered, in, take);
+        state->buffered += take;
+        in += take;
+        len -= take;
+        if (state->buffered < HASH_BLOCK_BYTES) return;
+        process_blocks(state->acc, state->buffer, 1, fn);
+        state->buffered = 0;
+    }
+
+    // Whole blocks straight from the caller's memory
+    size_t blocks = len / HASH_BLOCK_BYTES;
+    process_blocks(state->acc, in, blocks, fn);
+    in += blocks * HASH_BLOCK_BYTES;
+    len -= blocks * HASH_BLOCK_BYTES;
+
+    memcpy(state->buffer, in, len);
+    state->buffered = len;
+}
+
+static unsigned long long mul128_fold64(unsigned long long a, unsigned long long b) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    return (unsigned long long)product ^ (unsigned long long)(product >> 64);
+#else
+    unsigned long long a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+    unsigned long long b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+    unsigned long long lo_lo = a_lo * b_lo;
+    unsigned long long hi_lo = a_hi * b_lo;
+    unsigned long long lo_hi = a_lo * b_hi;
+    unsigned long long hi_hi = a_hi * b_hi;
+    unsigned long long cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+    unsigned long long upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    unsigned long long lower = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+    return lower ^ upper;
+#endif
+}
+
+static unsigned long long avalanche(unsigned long long h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static unsigned long long merge_accs(const unsigned long long* acc, const unsigned char* key, unsigned long long start) {
+    unsigned long long h = start;
+    for (int i = 0; i < 4; i++) {
+        h += mul128_fold64(acc[2 * i] ^ read64(key + 16 * i), acc[2 * i + 1] ^ read64(key + 16 * i + 8));
+    }
+    return avalanche(h);
+}
+
+Hash128 hash_final128(const HashState* state) {
+    unsigned long long acc[8];
+    memcpy(acc, state->acc, sizeof(acc));
+    HashAccumulateFn fn = hash_accumulator(state->impl);
+
+    // Whole stripes left in the partial block, then the zero-padded tail
+    size_t stripes = state->buffered / HASH_STRIPE_BYTES;
+    fn(acc, state->buffer, stripes, k_secret);
+    size_t tail = state->buffered - stripes * HASH_STRIPE_BYTES;
+    if (tail > 0) {
+        unsigned char last[HASH_STRIPE_BYTES];
+        memset(last, 0, sizeof(last));
+        memcpy(last, state->buffer + stripes * HASH_STRIPE_BYTES, tail);
+        fn(acc, last, 1, k_secret + SECRET_TAIL);
+    }
+
+    Hash128 h;
+    h.lo = merge_accs(acc, k_secret + SECRET_MERGE_LO, state->total * PRIME64_1);
+    h.hi = merge_accs(acc, k_secret + SECRET_MERGE_HI, ~(state->total * PRIME64_2));
+    return h;
+}
+
+unsigned long long hash_final64(const HashState* state) {
+    return hash_final128(state).lo;
+}
+
+Hash128 hash128_impl(const void* data, size_t len, HashImpl impl) {
+    HashState state;
+    hash_init_impl(&state, impl);
+    hash_update(&state, data, len);
+    return hash_final128(&state);
+}
+
+Hash128 hash128(const void* data, size_t len) {
+    return hash128_impl(data, len, HASH_IMPL_AUTO);
+}
+
+unsigned long long hash64(const void* data, size_t len) {
+    return hash128_impl(data, len, HASH_IMPL_AUTO).lo;
+}
+
+void hash128_to_hex(Hash128 h, char out[33]) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 16; i++) {
+        out[i] = digits[(h.hi >> (60 - i * 4)) & 0xF];
+        out[16 + i] = digits[(h.lo >> (60 - i * 4)) & 0xF];
+    }
+    out[32] = '\0';
+}
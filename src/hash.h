@@ -0,0 +1,57 @@
+// ---------------- Content hashing ----------------
+// Fast non-cryptographic 64/128-bit fingerprints for change detection and
+// dedup (sync bases, HASH tree hashes). Not suitable for security purposes;
+// passwords keep using SHA-256.
+//
+// Input is consumed in 64-byte stripes by eight 64-bit lanes, so the inner
+// loop maps directly onto SSE2/AVX2. Every code path produces the same
+// result; the vector ones are picked at runtime when the CPU has them.
+#ifndef NEXUS_HASH_H
+#define NEXUS_HASH_H
+
+#include <stddef.h>
+
+#define HASH_STRIPE_BYTES 64
+#define HASH_BLOCK_STRIPES 16
+#define HASH_BLOCK_BYTES (HASH_STRIPE_BYTES * HASH_BLOCK_STRIPES)
+
+typedef struct {
+    unsigned long long lo;
+    unsigned long long hi;
+} Hash128;
+
+typedef enum {
+    HASH_IMPL_AUTO,                       // best available on this CPU
+    HASH_IMPL_SCALAR,
+    HASH_IMPL_SSE2,
+    HASH_IMPL_AVX2,
+    HASH_IMPL_COUNT
+} HashImpl;
+
+// Streaming state for content that arrives in chunks. Feeding the same bytes
+// in any chunking gives the same hash as the one-shot functions.
+typedef struct {
+    unsigned long long acc[8];
+    unsigned char buffer[HASH_BLOCK_BYTES];
+    size_t buffered;
+    unsigned long long total;
+    HashImpl impl;
+} HashState;
+
+void hash_init(HashState* state);
+void hash_init_impl(HashState* state, HashImpl impl);
+void hash_update(HashState* state, const void* data, size_t len);
+Hash128 hash_final128(const HashState* state);
+unsigned long long hash_final64(const HashState* state);
+
+unsigned long long hash64(const void* data, size_t len);
+Hash128 hash128(const void* data, size_t len);
+Hash128 hash128_impl(const void* data, size_t len, HashImpl impl);
+
+int hash_impl_available(HashImpl impl);
+const char* hash_impl_name(HashImpl impl);
+
+// 32 lowercase hex digits plus the terminator
+void hash128_to_hex(Hash128 h, char out[33]);
+
+#endif
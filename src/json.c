@@ -0,0 +1,378 @@
+#include "json.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define JSON_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// What json_next may see next
+enum {
+    STATE_VALUE,                          // the top level, after ':' or an array's ','
+    STATE_VALUE_OR_CLOSE,                 // after '['
+    STATE_KEY,                            // after an object's ','
+    STATE_KEY_OR_CLOSE,                   // after '{'
+    STATE_COMMA_OR_CLOSE,                 // after a value inside an object or array
+    STATE_DONE,                           // after the top-level value
+    STATE_FAILED
+};
+
+void json_init(JsonReader* reader, const char* text, size_t len) {
+    memset(reader, 0, sizeof(*reader));
+    reader->start = text;
+    reader->p = text;
+    reader->end = text + len;
+    reader->state = STATE_VALUE;
+}
+
+static JsonType json_fail(JsonReader* r, JsonToken* t, const char* why) {
+    r->state = STATE_FAILED;
+    r->error = why;
+    r->error_at = (size_t)(r->p - r->start);
+    t->type = JSON_ERROR;
+    return JSON_ERROR;
+}
+
+static void json_skip_space(JsonReader* r) {
+    const char* p = r->p;
+    while (p < r->end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    r->p = p;
+}
+
+#ifdef JSON_HAVE_SSE2
+static int json_lowest_bit(unsigned int mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int n = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+#endif
+
+// The first '"', '\' or control character at or after p: where a string's
+// plain run stops
+static const char* json_scan_string(const char* p, const char* end) {
+#ifdef JSON_HAVE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        // Unsigned v <= 0x1F exactly when max(v, 0x1F) is 0x1F
+        __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                    _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(stop);
+        if (mask) return p + json_lowest_bit(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) p++;
+    return p;
+}
+
+static int json_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// r->p is on the opening quote
+static JsonType json_read_string(JsonReader* r, JsonToken* t, JsonType type) {
+    const char* p = r->p + 1;
+    t->type = type;
+    t->text = p;
+    t->escaped = FALSE;
+    for (;;) {
+        p = json_scan_string(p, r->end);
+        r->p = p;
+        if (p == r->end) return json_fail(r, t, "unterminated string");
+        if (*p == '"') break;
+        if (*p != '\\') return json_fail(r, t, "control character in a string");
+        t->escaped = TRUE;
+        if (++p == r->end) return json_fail(r, t, "unterminated string");
+        if (*p == 'u') {
+            for (int i = 1; i <= 4; i++) {
+                if (p + i >= r->end || json_hex(p[i]) < 0) {
+                    r->p = p;
+                    return json_fail(r, t, "bad \\u escape");
+                }
+            }
+            p += 5;
+        } else if (*p && strchr("\"\\/bfnrt", *p)) {
+            p++;
+        } else {
+            r->p = p;
+            return json_fail(r, t, "bad escape");
+        }
+    }
+    t->len = (size_t)(p - t->text);
+    r->p = p + 1;
+    return type;
+}
+
+static const char* json_digits(const char* p, const char* end) {
+    while (p < end && *p >= '0' && *p <= '9') p++;
+    return p;
+}
+
+static JsonType json_read_number(JsonReader* r, JsonToken* t) {
+    const char* p = r->p;
+    const char* end = r->end;
+    t->text = p;
+    if (p < end && *p == '-') p++;
+    if (p < end && *p == '0') {
+        p++;
+    } else {
+        const char* digits = p;
+        p = json_digits(p, end);
+        if (p == digits) return json_fail(r, t, "bad number");
+    }
+    if (p < end && *p == '.') {
+        const char* digits = ++p;
+        p = json_digits(p, end);
+        if (p == digits) {
+            r->p = p;
+            return json_fail(r, t, "bad number");
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        const char* digits = p;
+        p = json_digits(p, end);
+        if (p == digits) {
+            r->p = p;
+            return json_fail(r, t, "bad number");
+        }
+    }
+    t->len = (size_t)(p - t->text);
+    r->p = p;
+    t->type = JSON_NUMBER;
+    return JSON_NUMBER;
+}
+
+static JsonType json_read_word(JsonReader* r, JsonToken* t, const char* word, JsonType type) {
+    size_t len = strlen(word);
+    if ((size_t)(r->end - r->p) < len || memcmp(r->p, word, len) != 0) {
+        return json_fail(r, t, "unexpected character");
+    }
+    t->text = r->p;
+    t->len = len;
+    r->p += len;
+    t->type = type;
+    return type;
+}
+
+static void json_after_value(JsonReader* r) {
+    r->state = r->depth ? STATE_COMMA_OR_CLOSE : STATE_DONE;
+}
+
+static JsonType json_close(JsonReader* r, JsonToken* t) {
+    BOOL object = r->in_object[r->depth - 1];
+    if (*r->p != (object ? '}' : ']')) return json_fail(r, t, object ? "expected ',' or '}'" : "expected ',' or ']'");
+    r->p++;
+    r->depth--;
+    t->depth = r->depth;
+    t->text = r->p - 1;
+    t->len = 1;
+    json_after_value(r);
+    t->type = object ? JSON_OBJECT_END : JSON_ARRAY_END;
+    return t->type;
+}
+
+static JsonType json_open(JsonReader* r, JsonToken* t, BOOL object) {
+    if (r->depth == JSON_MAX_DEPTH) return json_fail(r, t, "nested too deeply");
+    t->text = r->p;
+    t->len = 1;
+    r->p++;
+    r->in_object[r->depth++] = (unsigned char)object;
+    r->state = object ? STATE_KEY_OR_CLOSE : STATE_VALUE_OR_CLOSE;
+    t->type = object ? JSON_OBJECT_BEGIN : JSON_ARRAY_BEGIN;
+    return t->type;
+}
+
+JsonType json_next(JsonReader* r, JsonToken* t) {
+    t->text = NULL;
+    t->len = 0;
+    t->escaped = FALSE;
+    t->depth = r->depth;
+    if (r->state == STATE_FAILED) {
+        t->type = JSON_ERROR;
+        return JSON_ERROR;
+    }
+
+    json_skip_space(r);
+    if (r->state == STATE_COMMA_OR_CLOSE) {
+        if (r->p == r->end) return json_fail(r, t, "unexpected end");
+        if (*r->p != ',') return json_close(r, t);
+        r->p++;
+        json_skip_space(r);
+        r->state = r->in_object[r->depth - 1] ? STATE_KEY : STATE_VALUE;
+    }
+    if (r->p == r->end) {
+        if (r->state != STATE_DONE) return json_fail(r, t, "unexpected end");
+        t->type = JSON_END;
+        return JSON_END;
+    }
+
+    char c = *r->p;
+    switch (r->state) {
+        case STATE_DONE:
+            return json_fail(r, t, "text after the end");
+        case STATE_KEY_OR_CLOSE:
+            if (c == '}') return json_close(r, t);
+            // fall through
+        case STATE_KEY:
+            if (c != '"') return json_fail(r, t, "expected a name in quotes");
+            if (json_read_string(r, t, JSON_KEY) == JSON_ERROR) return JSON_ERROR;
+            json_skip_space(r);
+            if (r->p == r->end || *r->p != ':') return json_fail(r, t, "expected ':'");
+            r->p++;
+            r->state = STATE_VALUE;
+            return JSON_KEY;
+        case STATE_VALUE_OR_CLOSE:
+            if (c == ']') return json_close(r, t);
+            break;
+        default:
+            break;
+    }
+
+    JsonType type;
+    switch (c) {
+        case '{': return json_open(r, t, TRUE);
+        case '[': return json_open(r, t, FALSE);
+        case '"': type = json_read_string(r, t, JSON_STRING); break;
+        case 't': type = json_read_word(r, t, "true", JSON_TRUE); break;
+        case 'f': type = json_read_word(r, t, "false", JSON_FALSE); break;
+        case 'n': type = json_read_word(r, t, "null", JSON_NULL); break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                type = json_read_number(r, t);
+            } else {
+                return json_fail(r, t, "unexpected character");
+            }
+            break;
+    }
+    if (type != JSON_ERROR) json_after_value(r);
+    return type;
+}
+
+BOOL json_skip(JsonReader* reader, const JsonToken* token) {
+    if (token->type == JSON_ERROR) return FALSE;
+    if (token->type != JSON_OBJECT_BEGIN && token->type != JSON_ARRAY_BEGIN) return TRUE;
+    JsonToken t;
+    for (;;) {
+        JsonType type = json_next(reader, &t);
+        if (type == JSON_ERROR || type == JSON_END) return FALSE;
+        if ((type == JSON_OBJECT_END || type == JSON_ARRAY_END) && t.depth == token->depth) return TRUE;
+    }
+}
+
+static size_t json_put_utf8(unsigned long cp, char* out, size_t at, size_t size) {
+    unsigned char bytes[4];
+    size_t n;
+    if (cp < 0x80) {
+        bytes[0] = (unsigned char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        bytes[0] = (unsigned char)(0xC0 | (cp >> 6));
+        bytes[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        bytes[0] = (unsigned char)(0xE0 | (cp >> 12));
+        bytes[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        bytes[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        bytes[0] = (unsigned char)(0xF0 | (cp >> 18));
+        bytes[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+        bytes[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        bytes[3] = (unsigned char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (at + i + 1 < size) out[at + i] = (char)bytes[i];
+    }
+    return n;
+}
+
+static unsigned long json_hex4(const char* p) {
+    return (unsigned long)((json_hex(p[0]) << 12) | (json_hex(p[1]) << 8) | (json_hex(p[2]) << 4) | json_hex(p[3]));
+}
+
+size_t json_string(const JsonToken* token, char* out, size_t size) {
+    const char* p = token->text;
+    const char* end = p + token->len;
+    size_t n = 0;
+    if (!token->escaped) {
+        n = token->len;
+        if (size) {
+            size_t copy = n < size ? n : size - 1;
+            memcpy(out, p, copy);
+            out[copy] = '\0';
+        }
+        return n;
+    }
+    // The tokenizer checked every escape, so no bounds checks past it here
+    while (p < end) {
+        if (*p != '\\') {
+            if (n + 1 < size) out[n] = *p;
+            n++;
+            p++;
+            continue;
+        }
+        char c = p[1];
+        p += 2;
+        if (c == 'u') {
+            unsigned long cp = json_hex4(p);
+            p += 4;
+            // A surrogate pair spelled as two escapes
+            if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                unsigned long low = json_hex4(p + 2);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            n += json_put_utf8(cp, out, n, size);
+            continue;
+        }
+        switch (c) {
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            default: break;               // '"', '\' and '/' stand for themselves
+        }
+        if (n + 1 < size) out[n] = c;
+        n++;
+    }
+    if (size) out[n < size ? n : size - 1] = '\0';
+    return n;
+}
+
+BOOL json_equals(const JsonToken* token, const char* s) {
+    size_t len = strlen(s);
+    if (!token->escaped) return token->len == len && memcmp(token->text, s, len) == 0;
+    // Escapes only make the text longer than what it decodes to
+    if (token->len < len) return FALSE;
+    char buf[256];
+    if (len >= sizeof(buf)) return FALSE;  // longer than any name this is asked about
+    return json_string(token, buf, sizeof(buf)) == len && memcmp(buf, s, len) == 0;
+}
+
+int json_line_of(const char* text, size_t offset) {
+    int line = 1;
+    for (size_t i = 0; i < offset && text[i]; i++) {
+        if (text[i] == '\n') line++;
+    }
+    return line;
+}
@@ -0,0 +1,70 @@
+// ---------------- JSON reader ----------------
+// A pull tokenizer for JSON held in memory (package.json and the like). One
+// pass and no allocation: each json_next hands back the next token, strings
+// as spans of the input with their escapes still in. The structure is
+// checked on the way (brackets match, names are strings followed by ':',
+// values are separated by ','), so a damaged file ends in JSON_ERROR instead
+// of being half read.
+//
+// String bodies are scanned 16 bytes at a time with SSE2 when the compiler
+// targets it; that is where a large file spends its time.
+#ifndef NEXUS_JSON_H
+#define NEXUS_JSON_H
+
+#include <stddef.h>
+
+#include "platform.h"
+
+#define JSON_MAX_DEPTH 64
+
+typedef enum {
+    JSON_END,                             // the text is done
+    JSON_ERROR,
+    JSON_OBJECT_BEGIN,
+    JSON_OBJECT_END,
+    JSON_ARRAY_BEGIN,
+    JSON_ARRAY_END,
+    JSON_KEY,                             // a member name; its value comes next
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL
+} JsonType;
+
+typedef struct {
+    JsonType type;
+    const char* text;                     // strings without their quotes; numbers as written
+    size_t len;
+    int depth;                            // objects and arrays around it (an END has its BEGIN's)
+    BOOL escaped;                         // the string holds '\' escapes: read it with json_string
+} JsonToken;
+
+typedef struct {
+    const char* start;
+    const char* p;
+    const char* end;
+    int state;
+    int depth;
+    unsigned char in_object[JSON_MAX_DEPTH];
+    const char* error;                    // after JSON_ERROR: what was wrong...
+    size_t error_at;                      // ...and its byte offset
+} JsonReader;
+
+void json_init(JsonReader* reader, const char* text, size_t len);
+JsonType json_next(JsonReader* reader, JsonToken* token);
+
+// Passes over the rest of the value token starts: an object or array up to
+// its end, nothing for anything else. FALSE on an error.
+BOOL json_skip(JsonReader* reader, const JsonToken* token);
+
+// A string or key token with its escapes decoded (\u as UTF-8), cut to fit
+// size with a terminator. Returns the decoded length, which may not have fit.
+size_t json_string(const JsonToken* token, char* out, size_t size);
+// The decoded string is exactly s
+BOOL json_equals(const JsonToken* token, const char* s);
+
+// 1-based line of a byte offset, for error messages
+int json_line_of(const char* text, size_t offset);
+
+#endif
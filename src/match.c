@@ -0,0 +1,786 @@
+#include "match.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define MATCH_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATCH_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define MATCH_MAX_PATTERN 512
+#define MATCH_MAX_DFA_STATES 4096
+
+#define SYMBOLS 256
+#define SET_WORDS (SYMBOLS / 32)
+
+typedef struct {
+    unsigned int bits[SET_WORDS];
+} SymSet;
+
+struct Matcher {
+    int flags;
+    // Literal
+    char* literal;                        // lower case when ignoring case
+    size_t literal_len;
+    BOOL avx2;                            // the processor has it: 32 positions a step
+    // Regular expression
+    int classes;                          // symbols the pattern cannot tell apart share a class
+    unsigned short class_of[SYMBOLS];
+    int* next;                            // [state * classes + class]: the next state's, times classes
+    unsigned char* accept_end;            // a line that ends in this state matches
+    int state_count;
+};
+
+static void set_add(SymSet* s, int sym) {
+    s->bits[sym >> 5] |= 1u << (sym & 31);
+}
+
+static BOOL set_has(const SymSet* s, int sym) {
+    return (s->bits[sym >> 5] >> (sym & 31)) & 1;
+}
+
+// ---------------- Literals ----------------
+#if defined(MATCH_HAVE_SSE2) || defined(MATCH_HAVE_AVX2)
+static int match_lowest_bit(unsigned int mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int n = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+#endif
+
+static BOOL match_equal(const Matcher* m, const char* text, const char* lit, size_t n) {
+    if (!(m->flags & MATCH_IGNORE_CASE)) return memcmp(text, lit, n) == 0;
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)text[i]) != (unsigned char)lit[i]) return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL match_byte(const Matcher* m, char c, char lit) {
+    if (m->flags & MATCH_IGNORE_CASE) return tolower((unsigned char)c) == (unsigned char)lit;
+    return c == lit;
+}
+
+#ifdef MATCH_HAVE_AVX2
+// literal_find's filter 32 positions at a time. Returns the occurrence, or
+// len with *from moved to where the narrower loops take over.
+__attribute__((target("avx2")))
+static size_t literal_find_avx2(const Matcher* m, const char* text, size_t* from, size_t len) {
+    const char* lit = m->literal;
+    size_t n = m->literal_len;
+    size_t i = *from;
+    BOOL fold = (m->flags & MATCH_IGNORE_CASE) != 0;
+    const __m256i first = _mm256_set1_epi8(lit[0]);
+    const __m256i last = _mm256_set1_epi8(lit[n - 1]);
+    const __m256i first_up = _mm256_set1_epi8((char)toupper((unsigned char)lit[0]));
+    const __m256i last_up = _mm256_set1_epi8((char)toupper((unsigned char)lit[n - 1]));
+    while (i + n - 1 + 32 <= len) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(text + i + n - 1));
+        __m256i hit_a = _mm256_cmpeq_epi8(a, first);
+        __m256i hit_b = _mm256_cmpeq_epi8(b, last);
+        if (fold) {
+            hit_a = _mm256_or_si256(hit_a, _mm256_cmpeq_epi8(a, first_up));
+            hit_b = _mm256_or_si256(hit_b, _mm256_cmpeq_epi8(b, last_up));
+        }
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(hit_a, hit_b));
+        while (mask) {
+            int bit = match_lowest_bit(mask);
+            if (n <= 2 || match_equal(m, text + i + bit + 1, lit + 1, n - 2)) return i + (size_t)bit;
+            mask &= mask - 1;
+        }
+        i += 32;
+    }
+    *from = i;
+    return len;
+}
+#endif
+
+// Offset of the first occurrence at or after from, or len. Each 16 positions
+// are checked against the literal's first byte and, at the literal's length
+// further on, its last byte; only where both agree are the bytes between
+// compared.
+static size_t literal_find(const Matcher* m, const char* text, size_t from, size_t len) {
+    const char* lit = m->literal;
+    size_t n = m->literal_len;
+    if (n == 0) return from;
+    if (len < n) return len;
+    size_t i = from;
+#ifdef MATCH_HAVE_AVX2
+    if (m->avx2) {
+        size_t hit = literal_find_avx2(m, text, &i, len);
+        if (hit < len) return hit;
+    }
+#endif
+#ifdef MATCH_HAVE_SSE2
+    BOOL fold = (m->flags & MATCH_IGNORE_CASE) != 0;
+    const __m128i first = _mm_set1_epi8(lit[0]);
+    const __m128i last = _mm_set1_epi8(lit[n - 1]);
+    const __m128i first_up = _mm_set1_epi8((char)toupper((unsigned char)lit[0]));
+    const __m128i last_up = _mm_set1_epi8((char)toupper((unsigned char)lit[n - 1]));
+    while (i + n - 1 + 16 <= len) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(text + i + n - 1));
+        __m128i hit_a = _mm_cmpeq_epi8(a, first);
+        __m128i hit_b = _mm_cmpeq_epi8(b, last);
+        if (fold) {
+            hit_a = _mm_or_si128(hit_a, _mm_cmpeq_epi8(a, first_up));
+            hit_b = _mm_or_si128(hit_b, _mm_cmpeq_epi8(b, last_up));
+        }
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(hit_a, hit_b));
+        while (mask) {
+            int bit = match_lowest_bit(mask);
+            if (n <= 2 || match_equal(m, text + i + bit + 1, lit + 1, n - 2)) return i + (size_t)bit;
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+#endif
+    for (; i + n <= len; i++) {
+        if (match_byte(m, text[i], lit[0]) && match_byte(m, text[i + n - 1], lit[n - 1]) &&
+            match_equal(m, text + i, lit, n)) {
+            return i;
+        }
+    }
+    return len;
+}
+
+// The pattern as plain text when it has no operators; escaped operators
+// count as text
+static BOOL literal_of(const char* pattern, char* out, size_t* len) {
+    size_t n = 0;
+    for (const char* p = pattern; *p; p++) {
+        char c = *p;
+        if (strchr(".[]()*+?|^$", c)) return FALSE;
+        if (c == '\\') {
+            c = *++p;
+            if (!c || !strchr(".[]()*+?|^$\\{}/-", c)) return FALSE;
+        }
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    *len = n;
+    return TRUE;
+}
+
+// ---------------- Parsing ----------------
+typedef enum {
+    NODE_EMPTY,
+    NODE_SET,
+    NODE_BOL,                             // ^
+    NODE_EOL,                             // $
+    NODE_CONCAT,
+    NODE_ALT,
+    NODE_STAR,
+    NODE_PLUS,
+    NODE_QUEST
+} NodeType;
+
+typedef struct {
+    NodeType type;
+    int a, b;                             // operands
+    int set;
+} Node;
+
+typedef struct {
+    const char* p;
+    BOOL fold;
+    Node* nodes;
+    int node_count;
+    int node_cap;
+    SymSet* sets;
+    int set_count;
+    const char* error;
+} Parser;
+
+static int parse_node(Parser* ps, NodeType type, int a, int b) {
+    if (ps->node_count == ps->node_cap) {
+        ps->error = "pattern too large";
+        return -1;
+    }
+    Node* n = &ps->nodes[ps->node_count];
+    n->type = type;
+    n->a = a;
+    n->b = b;
+    n->set = -1;
+    return ps->node_count++;
+}
+
+// A new empty set and the node that matches it
+static int parse_set_node(Parser* ps, SymSet** set) {
+    int node = parse_node(ps, NODE_SET, -1, -1);
+    if (node < 0) return -1;
+    ps->nodes[node].set = ps->set_count;
+    *set = &ps->sets[ps->set_count++];
+    memset(*set, 0, sizeof(**set));
+    return node;
+}
+
+static void set_add_char(Parser* ps, SymSet* s, unsigned char c) {
+    set_add(s, c);
+    if (ps->fold && isalpha(c)) {
+        set_add(s, tolower(c));
+        set_add(s, toupper(c));
+    }
+}
+
+// \d \w \s and their opposites; FALSE for any other letter
+static BOOL set_add_shorthand(SymSet* s, char c) {
+    SymSet k;
+    memset(&k, 0, sizeof(k));
+    switch (tolower((unsigned char)c)) {
+        case 'd':
+            for (int i = '0'; i <= '9'; i++) set_add(&k, i);
+            break;
+        case 'w':
+            for (int i = 0; i < 256; i++) {
+                if (isalnum(i) || i == '_') set_add(&k, i);
+            }
+            break;
+        case 's':
+            for (const char* w = " \t\r\f\v"; *w; w++) set_add(&k, (unsigned char)*w);
+            break;
+        default:
+            return FALSE;
+    }
+    BOOL negate = isupper((unsigned char)c) != 0;
+    for (int i = 0; i < 256; i++) {
+        if (i != '\n' && set_has(&k, i) != negate) set_add(s, i);
+    }
+    return TRUE;
+}
+
+static char parse_escape_char(char c) {
+    return c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+}
+
+static int parse_alt(Parser* ps);
+
+static int parse_class(Parser* ps) {
+    SymSet* set;
+    int node = parse_set_node(ps, &set);
+    if (node < 0) return -1;
+    SymSet chosen;
+    memset(&chosen, 0, sizeof(chosen));
+    BOOL negate = FALSE;
+    if (*ps->p == '^') {
+        negate = TRUE;
+        ps->p++;
+    }
+    BOOL first = TRUE;
+    while (*ps->p && (*ps->p != ']' || first)) {
+        first = FALSE;
+        unsigned char lo = (unsigned char)*ps->p++;
+        if (lo == '\\') {
+            if (!*ps->p) break;
+            char e = *ps->p++;
+            if (set_add_shorthand(&chosen, e)) continue;
+            lo = (unsigned char)parse_escape_char(e);
+        }
+        unsigned char hi = lo;
+        if (ps->p[0] == '-' && ps->p[1] && ps->p[1] != ']') {
+            ps->p++;
+            hi = (unsigned char)*ps->p++;
+            if (hi == '\\' && *ps->p) hi = (unsigned char)parse_escape_char(*ps->p++);
+            if (hi < lo) {
+                ps->error = "bad range in [ ]";
+                return -1;
+            }
+        }
+        for (int c = lo; c <= hi; c++) set_add_char(ps, &chosen, (unsigned char)c);
+    }
+    if (*ps->p != ']') {
+        ps->error = "missing ]";
+        return -1;
+    }
+    ps->p++;
+    for (int i = 0; i < 256; i++) {
+        if (set_has(&chosen, i) != negate && (i != '\n' || !negate)) set_add(set, i);
+    }
+    return node;
+}
+
+static int parse_atom(Parser* ps) {
+    char c = *ps->p;
+    SymSet* set;
+    int node;
+    switch (c) {
+        case '(':
+            ps->p++;
+            node = parse_alt(ps);
+            if (node < 0) return -1;
+            if (*ps->p != ')') {
+                ps->error = "missing )";
+                return -1;
+            }
+            ps->p++;
+            return node;
+        case '[':
+            ps->p++;
+            return parse_class(ps);
+        case '*':
+        case '+':
+        case '?':
+            ps->error = "nothing to repeat";
+            return -1;
+        default:
+            break;
+    }
+    if (c == '^' || c == '$') {
+        ps->p++;
+        return parse_node(ps, c == '^' ? NODE_BOL : NODE_EOL, -1, -1);
+    }
+    node = parse_set_node(ps, &set);
+    if (node < 0) return -1;
+    ps->p++;
+    if (c == '.') {
+        for (int i = 0; i < 256; i++) {
+            if (i != '\n') set_add(set, i);
+        }
+    } else if (c == '\\') {
+        char e = *ps->p;
+        if (!e) {
+            ps->error = "\\ at the end";
+            return -1;
+        }
+        ps->p++;
+        if (!set_add_shorthand(set, e)) set_add_char(ps, set, (unsigned char)parse_escape_char(e));
+    } else {
+        set_add_char(ps, set, (unsigned char)c);
+    }
+    return node;
+}
+
+static int parse_repeat(Parser* ps) {
+    int node = parse_atom(ps);
+    while (node >= 0 && (*ps->p == '*' || *ps->p == '+' || *ps->p == '?')) {
+        NodeType type = *ps->p == '*' ? NODE_STAR : *ps->p == '+' ? NODE_PLUS : NODE_QUEST;
+        ps->p++;
+        node = parse_node(ps, type, node, -1);
+    }
+    return node;
+}
+
+static int parse_concat(Parser* ps) {
+    int node = -1;
+    while (*ps->p && *ps->p != '|' && *ps->p != ')') {
+        int next = parse_repeat(ps);
+        if (next < 0) return -1;
+        node = (node < 0) ? next : parse_node(ps, NODE_CONCAT, node, next);
+        if (node < 0) return -1;
+    }
+    return node < 0 ? parse_node(ps, NODE_EMPTY, -1, -1) : node;
+}
+
+static int parse_alt(Parser* ps) {
+    int node = parse_concat(ps);
+    while (node >= 0 && *ps->p == '|') {
+        ps->p++;
+        int other = parse_concat(ps);
+        if (other < 0) return -1;
+        node = parse_node(ps, NODE_ALT, node, other);
+    }
+    return node;
+}
+
+// ---------------- NFA ----------------
+// Built back to front: each node is compiled knowing the state that
+// follows it, so there is nothing to patch afterwards
+typedef enum {
+    NFA_SET,                              // one symbol from set, then out
+    NFA_SPLIT,                            // out and out1, reading nothing
+    NFA_BOL,                              // out, at the start of the line only
+    NFA_EOL,                              // out, at the end of the line only
+    NFA_MATCH
+} NfaType;
+
+typedef struct {
+    NfaType type;
+    int out, out1;
+    int set;
+} NfaState;
+
+typedef struct {
+    NfaState* states;
+    int count;
+    int cap;
+} Nfa;
+
+static int nfa_add(Nfa* nfa, NfaType type, int out, int out1, int set) {
+    if (nfa->count == nfa->cap) return -1;
+    NfaState* s = &nfa->states[nfa->count];
+    s->type = type;
+    s->out = out;
+    s->out1 = out1;
+    s->set = set;
+    return nfa->count++;
+}
+
+static int nfa_compile(Nfa* nfa, const Node* nodes, int node, int next) {
+    const Node* n = &nodes[node];
+    int s, start;
+    switch (n->type) {
+        case NODE_EMPTY:
+            return next;
+        case NODE_SET:
+            return nfa_add(nfa, NFA_SET, next, -1, n->set);
+        case NODE_BOL:
+            return nfa_add(nfa, NFA_BOL, next, -1, -1);
+        case NODE_EOL:
+            return nfa_add(nfa, NFA_EOL, next, -1, -1);
+        case NODE_CONCAT:
+            start = nfa_compile(nfa, nodes, n->b, next);
+            return start < 0 ? -1 : nfa_compile(nfa, nodes, n->a, start);
+        case NODE_ALT: {
+            int a = nfa_compile(nfa, nodes, n->a, next);
+            int b = a < 0 ? -1 : nfa_compile(nfa, nodes, n->b, next);
+            return b < 0 ? -1 : nfa_add(nfa, NFA_SPLIT, a, b, -1);
+        }
+        case NODE_STAR:
+            s = nfa_add(nfa, NFA_SPLIT, -1, next, -1);
+            if (s < 0) return -1;
+            start = nfa_compile(nfa, nodes, n->a, s);
+            nfa->states[s].out = start;
+            return start < 0 ? -1 : s;
+        case NODE_PLUS:
+            s = nfa_add(nfa, NFA_SPLIT, -1, next, -1);
+            if (s < 0) return -1;
+            start = nfa_compile(nfa, nodes, n->a, s);
+            nfa->states[s].out = start;
+            return start;
+        case NODE_QUEST:
+            start = nfa_compile(nfa, nodes, n->a, next);
+            return start < 0 ? -1 : nfa_add(nfa, NFA_SPLIT, start, next, -1);
+    }
+    return -1;
+}
+
+// ---------------- DFA ----------------
+// Subset construction, done in full when the pattern is compiled. Every DFA
+// state also holds the NFA's start, which is what lets a match begin
+// anywhere in the line. ^ and $ stay in a state's set until they can be
+// passed: ^ only in the first state, $ only when the line ends.
+#define CLOSE_BOL 0x1
+#define CLOSE_EOL 0x2
+
+typedef struct {
+    const Nfa* nfa;
+    int words;                            // per set: the NFA states, then a bit for "line start"
+    unsigned int* sets;                   // [dfa state * words]
+    int* stack;
+    int* slots;                           // hash of sets to DFA states, -1 empty
+    int slot_mask;
+} Builder;
+
+static BOOL bit_has(const unsigned int* set, int i) {
+    return (set[i >> 5] >> (i & 31)) & 1;
+}
+
+static void dfa_close(Builder* b, unsigned int* set, int state, int at) {
+    int top = 0;
+    b->stack[top++] = state;
+    while (top > 0) {
+        int s = b->stack[--top];
+        if (s < 0 || bit_has(set, s)) continue;
+        set[s >> 5] |= 1u << (s & 31);
+        const NfaState* ns = &b->nfa->states[s];
+        if (ns->type == NFA_SPLIT) {
+            b->stack[top++] = ns->out;
+            b->stack[top++] = ns->out1;
+        } else if ((ns->type == NFA_BOL && (at & CLOSE_BOL)) || (ns->type == NFA_EOL && (at & CLOSE_EOL))) {
+            b->stack[top++] = ns->out;
+        }
+    }
+}
+
+static unsigned int dfa_hash(const unsigned int* set, int words) {
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < words; i++) {
+        h ^= set[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// The DFA state for set, added if new; -1 when there are too many
+static int dfa_state(Builder* b, Matcher* m, const unsigned int* set) {
+    size_t bytes = sizeof(unsigned int) * (size_t)b->words;
+    unsigned int h = dfa_hash(set, b->words);
+    for (int i = (int)(h & (unsigned int)b->slot_mask);; i = (i + 1) & b->slot_mask) {
+        int d = b->slots[i];
+        if (d < 0) {
+            if (m->state_count == MATCH_MAX_DFA_STATES) return -1;
+            d = m->state_count++;
+            memcpy(b->sets + (size_t)d * (size_t)b->words, set, bytes);
+            b->slots[i] = d;
+            return d;
+        }
+        if (memcmp(b->sets + (size_t)d * (size_t)b->words, set, bytes) == 0) return d;
+    }
+}
+
+// Whether a state's set, closed once more at the end of the line, matches
+static BOOL dfa_accepts_at_end(Builder* b, const unsigned int* set, unsigned int* work, BOOL line_start) {
+    const Nfa* nfa = b->nfa;
+    memcpy(work, set, sizeof(unsigned int) * (size_t)b->words);
+    for (int s = 0; s < nfa->count; s++) {
+        const NfaState* ns = &nfa->states[s];
+        if (!bit_has(set, s)) continue;
+        if (ns->type == NFA_EOL || (ns->type == NFA_BOL && line_start)) {
+            dfa_close(b, work, ns->out, CLOSE_EOL | (line_start ? CLOSE_BOL : 0));
+        }
+    }
+    for (int s = 0; s < nfa->count; s++) {
+        if (bit_has(work, s) && nfa->states[s].type == NFA_MATCH) return TRUE;
+    }
+    return FALSE;
+}
+
+static const char* dfa_build(Matcher* m, const Nfa* nfa, int start, const SymSet* sets, int set_count) {
+    // Byte classes: split the bytes by every set in turn
+    int remap[SYMBOLS * 2];
+    unsigned short split[SYMBOLS];
+    memset(m->class_of, 0, sizeof(m->class_of));
+    m->classes = 1;
+    for (int k = 0; k < set_count; k++) {
+        for (int i = 0; i < m->classes * 2; i++) remap[i] = -1;
+        int count = 0;
+        for (int sym = 0; sym < SYMBOLS; sym++) {
+            int key = m->class_of[sym] * 2 + (set_has(&sets[k], sym) ? 1 : 0);
+            if (remap[key] < 0) remap[key] = count++;
+            split[sym] = (unsigned short)remap[key];
+        }
+        memcpy(m->class_of, split, sizeof(split));
+        m->classes = count;
+    }
+    int rep[SYMBOLS];
+    for (int sym = SYMBOLS - 1; sym >= 0; sym--) rep[m->class_of[sym]] = sym;
+
+    Builder b;
+    memset(&b, 0, sizeof(b));
+    b.nfa = nfa;
+    b.words = (nfa->count + 1 + 31) / 32;
+    b.slot_mask = MATCH_MAX_DFA_STATES * 2 - 1;
+    b.sets = (unsigned int*)calloc((size_t)MATCH_MAX_DFA_STATES * (size_t)b.words, sizeof(unsigned int));
+    b.stack = (int*)malloc(sizeof(int) * (size_t)(nfa->count * 2 + 2));
+    b.slots = (int*)malloc(sizeof(int) * (size_t)(b.slot_mask + 1));
+    unsigned int* scratch = (unsigned int*)calloc((size_t)b.words * 3, sizeof(unsigned int));
+    unsigned int* inject = scratch;
+    unsigned int* work = scratch ? scratch + b.words : NULL;
+    unsigned int* end = scratch ? scratch + b.words * 2 : NULL;
+    const char* error = NULL;
+    int cap = 64;
+    m->next = (int*)malloc(sizeof(int) * (size_t)cap * (size_t)m->classes);
+    m->accept_end = (unsigned char*)malloc((size_t)cap);
+    if (!b.sets || !b.stack || !b.slots || !scratch || !m->next || !m->accept_end) {
+        error = "out of memory";
+        goto done;
+    }
+    for (int i = 0; i <= b.slot_mask; i++) b.slots[i] = -1;
+
+    // State 0 is the start of a line, kept apart from any later state that
+    // happens to hold the same NFA states
+    dfa_close(&b, work, start, CLOSE_BOL);
+    work[nfa->count >> 5] |= 1u << (nfa->count & 31);
+    dfa_state(&b, m, work);
+    dfa_close(&b, inject, start, 0);
+
+    for (int d = 0; d < m->state_count; d++) {
+        if (d == cap) {
+            cap *= 2;
+            int* next = (int*)realloc(m->next, sizeof(int) * (size_t)cap * (size_t)m->classes);
+            if (next) m->next = next;
+            unsigned char* accept_end = (unsigned char*)realloc(m->accept_end, (size_t)cap);
+            if (accept_end) m->accept_end = accept_end;
+            if (!next || !accept_end) {
+                error = "out of memory";
+                goto done;
+            }
+        }
+        const unsigned int* from = b.sets + (size_t)d * (size_t)b.words;
+        BOOL matched = FALSE;
+        for (int s = 0; s < nfa->count; s++) {
+            if (bit_has(from, s) && nfa->states[s].type == NFA_MATCH) matched = TRUE;
+        }
+        m->accept_end[d] = matched || dfa_accepts_at_end(&b, from, end, d == 0);
+        int* row = m->next + (size_t)d * (size_t)m->classes;
+        if (matched) {
+            // The line matches whatever follows: stay here
+            for (int k = 0; k < m->classes; k++) row[k] = d * m->classes;
+            continue;
+        }
+        for (int k = 0; k < m->classes; k++) {
+            memcpy(work, inject, sizeof(unsigned int) * (size_t)b.words);
+            for (int s = 0; s < nfa->count; s++) {
+                const NfaState* ns = &nfa->states[s];
+                if (ns->type == NFA_SET && bit_has(from, s) && set_has(&sets[ns->set], rep[k])) {
+                    dfa_close(&b, work, ns->out, 0);
+                }
+            }
+            int to = dfa_state(&b, m, work);
+            if (to < 0) {
+                error = "pattern too complex";
+                goto done;
+            }
+            row[k] = to * m->classes;
+        }
+    }
+done:
+    free(b.sets);
+    free(b.stack);
+    free(b.slots);
+    free(scratch);
+    return error;
+}
+
+// Rows are stored multiplied out and a state that has matched keeps to
+// itself, so each byte costs one dependent load
+static BOOL dfa_line(const Matcher* m, const unsigned char* s, size_t n) {
+    const int* next = m->next;
+    const unsigned short* class_of = m->class_of;
+    size_t row = 0;
+    for (size_t i = 0; i < n; i++) row = (size_t)next[row + class_of[s[i]]];
+    return m->accept_end[row / (size_t)m->classes] != 0;
+}
+
+// ---------------- Interface ----------------
+Matcher* matcher_compile(const char* pattern, int flags, const char** error) {
+    *error = NULL;
+    size_t len = strlen(pattern);
+    if (len > MATCH_MAX_PATTERN) {
+        *error = "pattern too long";
+        return NULL;
+    }
+    Matcher* m = (Matcher*)calloc(1, sizeof(Matcher));
+    if (!m) {
+        *error = "out of memory";
+        return NULL;
+    }
+    m->flags = flags;
+
+    char text[MATCH_MAX_PATTERN + 1];
+    size_t text_len = 0;
+    if (flags & MATCH_LITERAL) {
+        memcpy(text, pattern, len + 1);
+        text_len = len;
+    }
+    if ((flags & MATCH_LITERAL) || literal_of(pattern, text, &text_len)) {
+        m->flags |= MATCH_LITERAL;
+        m->literal = (char*)malloc(text_len + 1);
+        if (!m->literal) {
+            free(m);
+            *error = "out of memory";
+            return NULL;
+        }
+        for (size_t i = 0; i <= text_len; i++) {
+            m->literal[i] = (flags & MATCH_IGNORE_CASE) ? (char)tolower((unsigned char)text[i]) : text[i];
+        }
+        m->literal_len = text_len;
+#ifdef MATCH_HAVE_AVX2
+        m->avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+        return m;
+    }
+
+    // Every character makes at most a node and a set, plus a join
+    Parser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.p = pattern;
+    ps.fold = (flags & MATCH_IGNORE_CASE) != 0;
+    ps.node_cap = (int)len * 2 + 2;
+    ps.nodes = (Node*)malloc(sizeof(Node) * (size_t)ps.node_cap);
+    ps.sets = (SymSet*)malloc(sizeof(SymSet) * (len + 1));
+    Nfa nfa;
+    nfa.count = 0;
+    nfa.cap = ps.node_cap * 2 + 1;
+    nfa.states = (NfaState*)malloc(sizeof(NfaState) * (size_t)nfa.cap);
+    if (!ps.nodes || !ps.sets || !nfa.states) {
+        *error = "out of memory";
+    } else {
+        int root = parse_alt(&ps);
+        if (root >= 0 && *ps.p == ')') ps.error = "unmatched )";
+        if (root < 0 || ps.error) {
+            *error = ps.error ? ps.error : "bad pattern";
+        } else {
+            int match = nfa_add(&nfa, NFA_MATCH, -1, -1, -1);
+            int start = nfa_compile(&nfa, ps.nodes, root, match);
+            if (start < 0) {
+                *error = "pattern too large";
+            } else {
+                *error = dfa_build(m, &nfa, start, ps.sets, ps.set_count);
+            }
+        }
+    }
+    free(ps.nodes);
+    free(ps.sets);
+    free(nfa.states);
+    if (*error) {
+        matcher_free(m);
+        return NULL;
+    }
+    return m;
+}
+
+void matcher_free(Matcher* m) {
+    if (!m) return;
+    free(m->literal);
+    free(m->next);
+    free(m->accept_end);
+    free(m);
+}
+
+BOOL matcher_is_literal(const Matcher* m) {
+    return (m->flags & MATCH_LITERAL) != 0;
+}
+
+BOOL matcher_line(const Matcher* m, const char* line, size_t len) {
+    if (m->flags & MATCH_LITERAL) return literal_find(m, line, 0, len) < len || m->literal_len == 0;
+    return dfa_line(m, (const unsigned char*)line, len);
+}
+
+BOOL matcher_next_line(const Matcher* m, const char* text, size_t len, size_t* pos,
+                       size_t* start, size_t* end) {
+    size_t at = *pos;
+    while (at < len) {
+        size_t line_start, line_end;
+        if ((m->flags & MATCH_LITERAL) && m->literal_len > 0) {
+            // Straight to the next occurrence, then out to its line
+            size_t hit = literal_find(m, text, at, len);
+            if (hit == len) break;
+            line_start = hit;
+            while (line_start > at && text[line_start - 1] != '\n') line_start--;
+            const char* nl = (const char*)memchr(text + hit, '\n', len - hit);
+            line_end = nl ? (size_t)(nl - text) : len;
+        } else {
+            line_start = at;
+            const char* nl = (const char*)memchr(text + at, '\n', len - at);
+            line_end = nl ? (size_t)(nl - text) : len;
+            size_t visible = line_end;
+            if (visible > line_start && text[visible - 1] == '\r') visible--;
+            if (!matcher_line(m, text + line_start, visible - line_start)) {
+                at = line_end + 1;
+                continue;
+            }
+        }
+        *pos = line_end + 1;
+        *start = line_start;
+        *end = (line_end > line_start && text[line_end - 1] == '\r') ? line_end - 1 : line_end;
+        return TRUE;
+    }
+    *pos = len;
+    return FALSE;
+}
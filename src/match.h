@@ -0,0 +1,41 @@
+// ---------------- Text matching ----------------
+// GREP's patterns, compiled once and then run over many files. A pattern
+// with no operators is a literal, found with an SSE2 filter (AVX2 when the
+// processor has it) on its first and last bytes: only positions where both
+// agree are compared in full. Any other pattern is a regular expression
+// compiled to a DFA, which reads each byte once, however the pattern
+// branches.
+//
+// Regular expressions are POSIX extended style: . [abc] [^a-z] * + ? |
+// ( ) ^ $, and \d \w \s (\D \W \S) inside or outside brackets. Back
+// references and counted repeats are not supported.
+//
+// A compiled Matcher is never changed by matching, so threads may share one.
+#ifndef NEXUS_MATCH_H
+#define NEXUS_MATCH_H
+
+#include <stddef.h>
+
+#include "platform.h"
+
+#define MATCH_IGNORE_CASE 0x1             // ASCII letters match either case
+#define MATCH_LITERAL     0x2             // the pattern is plain text, operators included
+
+typedef struct Matcher Matcher;
+
+// NULL when the pattern is invalid or too large, with the reason in *error
+Matcher* matcher_compile(const char* pattern, int flags, const char** error);
+void matcher_free(Matcher* m);
+BOOL matcher_is_literal(const Matcher* m);
+
+// The next line of text[0..len) that matches, searching from *pos. Lines
+// end at '\n'; a '\r' before it is not part of the line. Returns FALSE
+// when there is none, else sets *start and *end to the line and moves *pos
+// past it.
+BOOL matcher_next_line(const Matcher* m, const char* text, size_t len, size_t* pos,
+                       size_t* start, size_t* end);
+
+// The whole of line[0..len) is one line
+BOOL matcher_line(const Matcher* m, const char* line, size_t len);
+
+#endif
@@ -0,0 +1,184 @@
+// ---------------- Platform layer ----------------
+// Everything the engine needs from the operating system: files and
+// directories, processes and their output pipes, randomness, the executable
+// path, clocks and threads. platform_win32.c and platform_posix.c implement
+// it; nothing outside those files and the GUI front end includes windows.h.
+//
+// Paths use '\' as the separator throughout the engine, as on Windows. The
+// POSIX backend translates them at the boundary, so data\USERS\Public maps
+// to data/USERS/Public.
+#ifndef NEXUS_PLATFORM_H
+#define NEXUS_PLATFORM_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// The few Win32 names the engine uses as plain types. Front ends that need
+// windows.h include it before this header.
+#if !defined(_WINDEF_) && !defined(_WINDEF_H)
+typedef int BOOL;
+typedef unsigned long COLORREF;
+#define RGB(r, g, b) ((COLORREF)(((unsigned char)(r)) | ((unsigned long)(unsigned char)(g) << 8) | ((unsigned long)(unsigned char)(b) << 16)))
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+// The Windows C runtime spellings, which the engine uses throughout
+#ifndef _WIN32
+#include <strings.h>
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+#define _strdup strdup
+#endif
+
+// ---- Files and directories ----
+typedef enum {
+    PF_PATH_NONE,
+    PF_PATH_FILE,
+    PF_PATH_DIR
+} PfPathKind;
+
+typedef struct {
+    PfPathKind kind;
+    unsigned long long size;
+    long long mtime;                      // seconds since the epoch
+} PfStat;
+
+BOOL pf_stat(const char* path, PfStat* st);
+PfPathKind pf_path_kind(const char* path);
+FILE* pf_fopen(const char* path, const char* mode);
+BOOL pf_mkdir(const char* path);          // FALSE if it already exists
+BOOL pf_rmdir(const char* path);          // directory must be empty
+BOOL pf_remove(const char* path);
+BOOL pf_rename(const char* from, const char* to);
+// Replaces to if it exists; on POSIX the copy keeps from's permission bits
+BOOL pf_copy_file(const char* from, const char* to);
+BOOL pf_getcwd(char* out, size_t size);
+// Error code of the last failed call above (GetLastError or errno)
+unsigned long pf_last_error(void);
+
+typedef struct PfDir PfDir;
+
+typedef struct {
+    char name[MAX_PATH];
+    BOOL is_dir;
+    unsigned long long size;
+    long long mtime_ns;                   // nanoseconds since the epoch, for noticing edits
+} PfDirEntry;
+
+// Lists a directory; "." and ".." are skipped
+PfDir* pf_dir_open(const char* path);
+BOOL pf_dir_next(PfDir* dir, PfDirEntry* entry);
+void pf_dir_close(PfDir* dir);
+
+// ---- Processes ----
+#define PF_SPAWN_CAPTURE 0x1              // stdout and stderr go to a pipe read with pf_process_read
+#define PF_SPAWN_CONSOLE 0x2              // Win32: give the child its own visible console
+#define PF_SPAWN_SHELL   0x4              // run through cmd.exe /c or /bin/sh -c
+#define PF_SPAWN_GROUP   0x8              // POSIX: its own process group, for pf_process_kill
+#define PF_SPAWN_STDIN   0x10             // stdin is a pipe written with pf_process_write
+
+// Without PF_SPAWN_SHELL the command line is split into arguments the way a
+// Windows C program would split it, and the POSIX backend turns '\' into '/'
+// in each of them so engine paths can be passed as arguments.
+
+typedef struct PfProcess PfProcess;
+
+// NULL when the program could not be started. cwd may be NULL.
+PfProcess* pf_spawn(const char* command_line, const char* cwd, int flags);
+// Runs argv[0], found on PATH, with exactly these arguments: no shell, no
+// splitting and no path translation (PF_SPAWN_SHELL is ignored). env, if
+// set, is a NULL-terminated list of "NAME=value" entries the child gets on
+// top of this process's environment, which is left alone.
+PfProcess* pf_spawn_argv(const char* const* argv, const char* cwd, const char* const* env, int flags);
+
+// Caps the system holds a child to; 0 means none. Win32 sets them on the
+// child's job object, so they cover it and everything it starts together.
+// POSIX sets rlimits, which every process it starts gets afresh.
+typedef struct {
+    double cpu_seconds;                   // Win32: user time only
+    unsigned long long memory_bytes;      // POSIX: address space
+} PfLimits;
+
+// pf_spawn_argv when argv is set, else pf_spawn of command_line, held to
+// limits (may be NULL)
+PfProcess* pf_spawn_limited(const char* command_line, const char* const* argv, const char* cwd,
+                            const char* const* env, int flags, const PfLimits* limits);
+// Bytes read from the output pipe; 0 once the child has closed it
+int pf_process_read(PfProcess* proc, char* buf, size_t size);
+// The same, but gives up after timeout_ms and returns PF_READ_TIMEOUT. Win32
+// reads the pipe overlapped, POSIX polls it.
+#define PF_READ_TIMEOUT (-1)
+int pf_process_read_timeout(PfProcess* proc, char* buf, size_t size, int timeout_ms);
+// Writes all of buf to the child's stdin (PF_SPAWN_STDIN); FALSE once the
+// child has closed it or exited
+BOOL pf_process_write(PfProcess* proc, const void* buf, size_t size);
+// Closes that pipe: the child reads the end of its input
+void pf_process_close_input(PfProcess* proc);
+// TRUE once the child has exited, which may be before its pipe closes:
+// a program it started can still hold the write end
+BOOL pf_process_exited(PfProcess* proc);
+// Waits for the child, frees proc and returns the exit code
+int pf_process_wait(PfProcess* proc);
+
+// What a child used. Win32 counts its whole job; POSIX counts the child and
+// the children it waited for.
+typedef struct {
+    double cpu_seconds;                   // user plus system
+    unsigned long long peak_memory;       // bytes at most: resident (POSIX), committed (Win32); 0 if unknown
+    BOOL cpu_limit_hit;                   // the system ended it at its CPU limit
+} PfUsage;
+
+// pf_process_wait that also says what the child used
+int pf_process_wait_usage(PfProcess* proc, PfUsage* usage);
+// Waits for the child to exit but keeps proc, so another thread may still
+// pf_process_kill it; pf_process_wait then returns at once
+void pf_process_join(PfProcess* proc);
+// Ends the child and whatever it started: on Win32 always, on POSIX when
+// it was spawned with PF_SPAWN_GROUP (which keeps it from the terminal's
+// Ctrl+C, so it is only for children the engine stops itself). POSIX asks
+// with SIGTERM first; a second call sends SIGKILL.
+void pf_process_kill(PfProcess* proc);
+// Lets the child run on and frees proc
+void pf_process_detach(PfProcess* proc);
+
+// ---- System ----
+BOOL pf_random_bytes(void* buf, size_t len);
+void pf_executable_path(char* out, size_t size);
+int pf_cpu_count(void);                   // logical processors, at least 1
+BOOL pf_setenv(const char* name, const char* value);
+// Full path of the program a command line naming it would run, from PATH
+// (with .exe added on Win32). FALSE if there is none.
+BOOL pf_find_program(const char* name, char* out, size_t size);
+// Replaces %NAME% with the variable's value; unknown names are left as they are
+void pf_expand_env(const char* in, char* out, size_t size);
+BOOL pf_is_terminal(FILE* f);             // an interactive console, not a pipe or file
+
+// ---- Time ----
+unsigned long pf_ticks_ms(void);          // wraps; use differences only
+double pf_seconds(void);                  // monotonic, high resolution
+void pf_sleep_ms(unsigned int ms);
+
+// ---- Threads ----
+typedef struct PfThread PfThread;
+typedef int (*PfThreadFn)(void* arg);
+typedef volatile long PfAtomic;
+typedef struct PfMutex PfMutex;
+
+PfThread* pf_thread_start(PfThreadFn fn, void* arg);
+void pf_thread_join(PfThread* thread);    // waits and frees
+void pf_atomic_set(PfAtomic* value, long v);
+long pf_atomic_get(PfAtomic* value);
+PfMutex* pf_mutex_create(void);           // NULL if out of memory
+void pf_mutex_lock(PfMutex* mutex);
+void pf_mutex_unlock(PfMutex* mutex);
+void pf_mutex_free(PfMutex* mutex);
+
+#endif
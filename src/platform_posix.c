@@ -0,0 +1,626 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+// Engine paths use '\'; turn them into native ones
+static void pf_native_path(const char* path, char* out, size_t size) {
+    size_t i = 0;
+    for (; path[i] && i + 1 < size; i++) out[i] = (path[i] == '\\') ? '/' : path[i];
+    out[i] = '\0';
+}
+
+static void pf_engine_path(char* path) {
+    for (; *path; path++) if (*path == '/') *path = '\\';
+}
+
+// ---------------- Files and directories ----------------
+BOOL pf_stat(const char* path, PfStat* st) {
+    char native[4096];
+    pf_native_path(path, native, sizeof(native));
+    struct stat s;
+    if (stat(native, &s) != 0) {
+        st->kind = PF_PATH_NONE;
+        return FALSE;
+    }
+    st->kind = S_ISDIR(s.st_mode) ? PF_PATH_DIR : PF_PATH_FILE;
+    st->size = (unsigned long long)s.st_size;
+    st->mtime = (long long)s.st_mtime;
+    return TRUE;
+}
+
+PfPathKind pf_path_kind(const char* path) {
+    PfStat st;
+    pf_stat(path, &st);
+    return st.kind;
+}
+
+FILE* pf_fopen(const char* path, const char* mode) {
+    char native[4096];
+    pf_native_path(path, native, sizeof(native));
+    return fopen(native, mode);
+}
+
+BOOL pf_mkdir(const char* path) {
+    char native[4096];
+    pf_native_path(path, native, sizeof(native));
+    return mkdir(native, 0755) == 0;
+}
+
+BOOL pf_rmdir(const char* path) {
+    char native[4096];
+    pf_native_path(path, native, sizeof(native));
+    return rmdir(native) == 0;
+}
+
+BOOL pf_remove(const char* path) {
+    char native[4096];
+    pf_native_path(path, native, sizeof(native));
+    return unlink(native) == 0;
+}
+
+BOOL pf_rename(const char* from, const char* to) {
+    char native_from[4096], native_to[4096];
+    pf_native_path(from, native_from, sizeof(native_from));
+    pf_native_path(to, native_to, sizeof(native_to));
+    // MoveFile semantics: never replace an existing target
+    if (access(native_to, F_OK) == 0) return FALSE;
+    return rename(native_from, native_to) == 0;
+}
+
+BOOL pf_copy_file(const char* from, const char* to) {
+    char native_from[4096], native_to[4096];
+    pf_native_path(from, native_from, sizeof(native_from));
+    pf_native_path(to, native_to, sizeof(native_to));
+    int in = open(native_from, O_RDONLY);
+    if (in < 0) return FALSE;
+    struct stat s;
+    if (fstat(in, &s) != 0) {
+        close(in);
+        return FALSE;
+    }
+    // A fresh inode rather than truncating: a program still running from
+    // the old file keeps its text
+    unlink(native_to);
+    int out = open(native_to, O_WRONLY | O_CREAT | O_TRUNC, s.st_mode & 07777);
+    if (out < 0) {
+        close(in);
+        return FALSE;
+    }
+    char buf[65536];
+    BOOL ok = TRUE;
+    ssize_t n;
+    while (ok && (n = read(in, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            ok = (errno == EINTR);
+            continue;
+        }
+        for (ssize_t done = 0; ok && done < n;) {
+            ssize_t w = write(out, buf + done, (size_t)(n - done));
+            if (w < 0) ok = (errno == EINTR);
+            else done += w;
+        }
+    }
+    close(in);
+    if (close(out) != 0) ok = FALSE;
+    if (!ok) unlink(native_to);
+    return ok;
+}
+
+BOOL pf_getcwd(char* out, size_t size) {
+    if (!getcwd(out, size)) return FALSE;
+    pf_engine_path(out);
+    return TRUE;
+}
+
+unsigned long pf_last_error(void) {
+    return (unsigned long)errno;
+}
+
+struct PfDir {
+    DIR* dir;
+    char path[4096];
+};
+
+PfDir* pf_dir_open(const char* path) {
+    PfDir* dir = (PfDir*)calloc(1, sizeof(PfDir));
+    if (!dir) return NULL;
+    pf_native_path(path, dir->path, sizeof(dir->path));
+    dir->dir = opendir(dir->path);
+    if (!dir->dir) {
+        free(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+BOOL pf_dir_next(PfDir* dir, PfDirEntry* entry) {
+    struct dirent* de;
+    while ((de = readdir(dir->dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        if (strlen(de->d_name) >= sizeof(entry->name)) continue;
+
+        char full[4096 + MAX_PATH];
+        snprintf(full, sizeof(full), "%s/%s", dir->path, de->d_name);
+        struct stat s;
+        if (stat(full, &s) != 0) continue;
+
+        strcpy(entry->name, de->d_name);
+        entry->is_dir = S_ISDIR(s.st_mode);
+        entry->size = (unsigned long long)s.st_size;
+#ifdef __APPLE__
+        entry->mtime_ns = (long long)s.st_mtimespec.tv_sec * 1000000000LL + s.st_mtimespec.tv_nsec;
+#else
+        entry->mtime_ns = (long long)s.st_mtim.tv_sec * 1000000000LL + s.st_mtim.tv_nsec;
+#endif
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void pf_dir_close(PfDir* dir) {
+    if (!dir) return;
+    closedir(dir->dir);
+    free(dir);
+}
+
+// ---------------- Processes ----------------
+struct PfProcess {
+    pid_t pid;
+    int out_read;
+    int in_write;                         // -1 unless spawned with PF_SPAWN_STDIN
+    BOOL group;                           // leads its own process group
+    double cpu_limit;                     // seconds; 0: none
+    int kills;                            // pf_process_kill calls so far
+};
+
+// Splits on spaces, honouring double quotes, and makes paths native
+static int pf_split_command(char* line, char** argv, int max) {
+    int argc = 0;
+    char* p = line;
+    while (*p && argc < max - 1) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+        char* out = p;
+        argv[argc++] = out;
+        BOOL quoted = FALSE;
+        while (*p && (quoted || (*p != ' ' && *p != '\t'))) {
+            if (*p == '"') { quoted = !quoted; p++; continue; }
+            *out++ = (*p == '\\') ? '/' : *p;
+            p++;
+        }
+        if (*p) p++;
+        *out = '\0';
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// Forks and execs argv; envp, if set, replaces the environment
+static PfProcess* pf_spawn_exec(char* const* argv, char** envp, const char* cwd, int flags,
+                                const PfLimits* limits) {
+    PfProcess* proc = (PfProcess*)calloc(1, sizeof(PfProcess));
+    if (!proc) return NULL;
+    proc->out_read = -1;
+    proc->in_write = -1;
+
+    int fds[2] = {-1, -1};
+    if ((flags & PF_SPAWN_CAPTURE) && pipe(fds) != 0) {
+        free(proc);
+        return NULL;
+    }
+    int in_fds[2] = {-1, -1};
+    if ((flags & PF_SPAWN_STDIN) && pipe(in_fds) != 0) {
+        if (fds[0] >= 0) { close(fds[0]); close(fds[1]); }
+        free(proc);
+        return NULL;
+    }
+    // Writes to a child that has gone fail with EPIPE instead of killing us
+    if (flags & PF_SPAWN_STDIN) signal(SIGPIPE, SIG_IGN);
+
+    // An exec failure is reported through a close-on-exec pipe
+    int status_fds[2];
+    if (pipe(status_fds) != 0) {
+        if (fds[0] >= 0) { close(fds[0]); close(fds[1]); }
+        if (in_fds[0] >= 0) { close(in_fds[0]); close(in_fds[1]); }
+        free(proc);
+        return NULL;
+    }
+    fcntl(status_fds[1], F_SETFD, FD_CLOEXEC);
+
+    char native_cwd[4096];
+    if (cwd) pf_native_path(cwd, native_cwd, sizeof(native_cwd));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(status_fds[0]);
+        if (flags & PF_SPAWN_GROUP) setpgid(0, 0);
+        if (flags & PF_SPAWN_CAPTURE) {
+            dup2(fds[1], STDOUT_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+            close(fds[0]);
+            close(fds[1]);
+        }
+        if (flags & PF_SPAWN_STDIN) {
+            dup2(in_fds[0], STDIN_FILENO);
+            close(in_fds[0]);
+            close(in_fds[1]);
+        }
+        if (limits && limits->cpu_seconds > 0) {
+            // SIGXCPU at the soft limit, SIGKILL a second later if it is caught
+            struct rlimit cpu;
+            cpu.rlim_cur = (rlim_t)(limits->cpu_seconds + 0.999);
+            cpu.rlim_max = cpu.rlim_cur + 1;
+            setrlimit(RLIMIT_CPU, &cpu);
+        }
+        if (limits && limits->memory_bytes > 0) {
+            struct rlimit as;
+            as.rlim_cur = as.rlim_max = (rlim_t)limits->memory_bytes;
+            setrlimit(RLIMIT_AS, &as);
+        }
+        if (cwd && chdir(native_cwd) != 0) {
+            int err = errno;
+            ssize_t ignored = write(status_fds[1], &err, sizeof(err));
+            (void)ignored;
+            _exit(127);
+        }
+        // execvp searches PATH in the environment it is given
+        if (envp) environ = envp;
+        execvp(argv[0], argv);
+        int err = errno;
+        ssize_t ignored = write(status_fds[1], &err, sizeof(err));
+        (void)ignored;
+        _exit(127);
+    }
+
+    close(status_fds[1]);
+    if (fds[1] >= 0) close(fds[1]);
+    if (in_fds[0] >= 0) close(in_fds[0]);
+    // Kept from children spawned later, which would hold the pipe open
+    if (in_fds[1] >= 0) fcntl(in_fds[1], F_SETFD, FD_CLOEXEC);
+    int child_errno = 0;
+    ssize_t got = (pid > 0) ? read(status_fds[0], &child_errno, sizeof(child_errno)) : 0;
+    close(status_fds[0]);
+    if (pid < 0 || got > 0) {
+        if (pid > 0) waitpid(pid, NULL, 0);
+        if (fds[0] >= 0) close(fds[0]);
+        if (in_fds[1] >= 0) close(in_fds[1]);
+        free(proc);
+        return NULL;
+    }
+
+    // Set on both sides so a kill right after the spawn finds the group
+    if (flags & PF_SPAWN_GROUP) setpgid(pid, pid);
+    proc->pid = pid;
+    proc->out_read = fds[0];
+    proc->in_write = in_fds[1];
+    proc->group = (flags & PF_SPAWN_GROUP) != 0;
+    proc->cpu_limit = limits ? limits->cpu_seconds : 0;
+    return proc;
+}
+
+PfProcess* pf_spawn(const char* command_line, const char* cwd, int flags) {
+    return pf_spawn_limited(command_line, NULL, cwd, NULL, flags, NULL);
+}
+
+static BOOL pf_env_overridden(const char* entry, const char* const* env) {
+    size_t n = strcspn(entry, "=");
+    for (; *env; env++) {
+        if (strncmp(*env, entry, n) == 0 && (*env)[n] == '=') return TRUE;
+    }
+    return FALSE;
+}
+
+PfProcess* pf_spawn_argv(const char* const* argv, const char* cwd, const char* const* env, int flags) {
+    return pf_spawn_limited(NULL, argv, cwd, env, flags, NULL);
+}
+
+PfProcess* pf_spawn_limited(const char* command_line, const char* const* argv, const char* cwd,
+                            const char* const* env, int flags, const PfLimits* limits) {
+    // Built before the fork: the child may not allocate
+    char** envp = NULL;
+    if (env && *env) {
+        size_t count = 0, extra = 0;
+        while (environ[count]) count++;
+        while (env[extra]) extra++;
+        envp = (char**)malloc((count + extra + 1) * sizeof(char*));
+        if (!envp) return NULL;
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!pf_env_overridden(environ[i], env)) envp[n++] = environ[i];
+        }
+        for (size_t i = 0; i < extra; i++) envp[n++] = (char*)env[i];
+        envp[n] = NULL;
+    }
+
+    PfProcess* proc = NULL;
+    if (argv) {
+        proc = pf_spawn_exec((char* const*)argv, envp, cwd, flags, limits);
+    } else if (flags & PF_SPAWN_SHELL) {
+        char* shell_argv[] = { "sh", "-c", (char*)command_line, NULL };
+        proc = pf_spawn_exec(shell_argv, envp, cwd, flags, limits);
+    } else {
+        char* line = strdup(command_line);
+        char* split_argv[64];
+        if (line && pf_split_command(line, split_argv, 64) > 0) {
+            proc = pf_spawn_exec(split_argv, envp, cwd, flags, limits);
+        }
+        free(line);
+    }
+    free(envp);
+    return proc;
+}
+
+int pf_process_read(PfProcess* proc, char* buf, size_t size) {
+    return pf_process_read_timeout(proc, buf, size, -1);
+}
+
+int pf_process_read_timeout(PfProcess* proc, char* buf, size_t size, int timeout_ms) {
+    if (proc->out_read < 0) return 0;
+    struct pollfd p;
+    p.fd = proc->out_read;
+    p.events = POLLIN;
+    for (;;) {
+        int ready = poll(&p, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) return PF_READ_TIMEOUT;
+        ssize_t n = read(proc->out_read, buf, size);
+        if (n < 0 && errno == EINTR) continue;
+        return n > 0 ? (int)n : 0;
+    }
+}
+
+BOOL pf_process_write(PfProcess* proc, const void* buf, size_t size) {
+    const char* p = (const char*)buf;
+    while (size > 0 && proc->in_write >= 0) {
+        ssize_t n = write(proc->in_write, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return FALSE;
+        p += n;
+        size -= (size_t)n;
+    }
+    return size == 0;
+}
+
+void pf_process_close_input(PfProcess* proc) {
+    if (proc->in_write < 0) return;
+    close(proc->in_write);
+    proc->in_write = -1;
+}
+
+BOOL pf_process_exited(PfProcess* proc) {
+    siginfo_t info;
+    info.si_pid = 0;
+    if (waitid(P_PID, proc->pid, &info, WEXITED | WNOHANG | WNOWAIT) < 0) return errno == ECHILD;
+    return info.si_pid != 0;
+}
+
+int pf_process_wait(PfProcess* proc) {
+    return pf_process_wait_usage(proc, NULL);
+}
+
+int pf_process_wait_usage(PfProcess* proc, PfUsage* usage) {
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    if (proc->out_read >= 0) close(proc->out_read);
+    if (proc->in_write >= 0) close(proc->in_write);
+    while (wait4(proc->pid, &status, 0, &ru) < 0 && errno == EINTR) {}
+
+    double cpu = (double)ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+                 (double)ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    int sig = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    BOOL cpu_hit = proc->cpu_limit > 0 && (sig == SIGXCPU || (sig == SIGKILL && cpu >= proc->cpu_limit));
+    // The rlimit ended only this process; what it started goes with it
+    if (cpu_hit && proc->group) kill(-proc->pid, SIGKILL);
+    if (usage) {
+        usage->cpu_seconds = cpu;
+#ifdef __APPLE__
+        usage->peak_memory = (unsigned long long)ru.ru_maxrss;
+#else
+        usage->peak_memory = (unsigned long long)ru.ru_maxrss * 1024;
+#endif
+        usage->cpu_limit_hit = cpu_hit;
+    }
+    free(proc);
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + sig;
+}
+
+void pf_process_join(PfProcess* proc) {
+    // WNOWAIT leaves the child a zombie, so its pid stays safe to signal
+    siginfo_t info;
+    while (waitid(P_PID, proc->pid, &info, WEXITED | WNOWAIT) < 0 && errno == EINTR) {}
+}
+
+void pf_process_kill(PfProcess* proc) {
+    int sig = proc->kills++ ? SIGKILL : SIGTERM;
+    kill(proc->group ? -proc->pid : proc->pid, sig);
+}
+
+// Waits for one detached child so it does not linger as a zombie. Only
+// that pid is waited for; SIGCHLD and every other child are left alone.
+static void* pf_reap_main(void* arg) {
+    pid_t pid = (pid_t)(long)arg;
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {}
+    return NULL;
+}
+
+void pf_process_detach(PfProcess* proc) {
+    pthread_t reaper;
+    if (pthread_create(&reaper, NULL, pf_reap_main, (void*)(long)proc->pid) == 0) pthread_detach(reaper);
+    if (proc->out_read >= 0) close(proc->out_read);
+    if (proc->in_write >= 0) close(proc->in_write);
+    free(proc);
+}
+
+// ---------------- System ----------------
+BOOL pf_random_bytes(void* buf, size_t len) {
+    FILE* f = fopen("/dev/urandom", "rb");
+    if (!f) return FALSE;
+    size_t n = fread(buf, 1, len, f);
+    fclose(f);
+    return n == len;
+}
+
+void pf_executable_path(char* out, size_t size) {
+    ssize_t n = readlink("/proc/self/exe", out, size - 1);
+    if (n <= 0) {
+        out[0] = '\0';
+        return;
+    }
+    out[n] = '\0';
+    pf_engine_path(out);
+}
+
+int pf_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+BOOL pf_setenv(const char* name, const char* value) {
+    return (value ? setenv(name, value, 1) : unsetenv(name)) == 0;
+}
+
+BOOL pf_find_program(const char* name, char* out, size_t size) {
+    const char* path = getenv("PATH");
+    if (!path || strchr(name, '/') || strchr(name, '\\')) return FALSE;
+    while (*path) {
+        size_t n = strcspn(path, ":");
+        char candidate[4096];
+        // An empty entry means the current directory
+        int len = n ? snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)n, path, name)
+                    : snprintf(candidate, sizeof(candidate), "./%s", name);
+        struct stat s;
+        if (len > 0 && (size_t)len < sizeof(candidate) && (size_t)len < size &&
+            stat(candidate, &s) == 0 && S_ISREG(s.st_mode) && access(candidate, X_OK) == 0) {
+            memcpy(out, candidate, (size_t)len + 1);
+            pf_engine_path(out);
+            return TRUE;
+        }
+        path += n;
+        if (*path == ':') path++;
+    }
+    return FALSE;
+}
+
+void pf_expand_env(const char* in, char* out, size_t size) {
+    size_t j = 0;
+    while (*in && j + 1 < size) {
+        const char* close = (*in == '%') ? strchr(in + 1, '%') : NULL;
+        if (close && close > in + 1 && (size_t)(close - in - 1) < 256) {
+            char name[256];
+            memcpy(name, in + 1, (size_t)(close - in - 1));
+            name[close - in - 1] = '\0';
+            const char* value = getenv(name);
+            if (value) {
+                while (*value && j + 1 < size) out[j++] = *value++;
+                in = close + 1;
+                continue;
+            }
+        }
+        out[j++] = *in++;
+    }
+    out[j] = '\0';
+}
+
+BOOL pf_is_terminal(FILE* f) {
+    return isatty(fileno(f));
+}
+
+// ---------------- Time ----------------
+unsigned long pf_ticks_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL);
+}
+
+double pf_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void pf_sleep_ms(unsigned int ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {}
+}
+
+// ---------------- Threads ----------------
+struct PfThread {
+    pthread_t handle;
+    PfThreadFn fn;
+    void* arg;
+};
+
+static void* pf_thread_main(void* param) {
+    PfThread* t = (PfThread*)param;
+    t->fn(t->arg);
+    return NULL;
+}
+
+PfThread* pf_thread_start(PfThreadFn fn, void* arg) {
+    PfThread* t = (PfThread*)calloc(1, sizeof(PfThread));
+    if (!t) return NULL;
+    t->fn = fn;
+    t->arg = arg;
+    if (pthread_create(&t->handle, NULL, pf_thread_main, t) != 0) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+void pf_thread_join(PfThread* thread) {
+    if (!thread) return;
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+void pf_atomic_set(PfAtomic* value, long v) {
+    __atomic_store_n(value, v, __ATOMIC_SEQ_CST);
+}
+
+long pf_atomic_get(PfAtomic* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+struct PfMutex {
+    pthread_mutex_t handle;
+};
+
+PfMutex* pf_mutex_create(void) {
+    PfMutex* m = (PfMutex*)calloc(1, sizeof(PfMutex));
+    if (m) pthread_mutex_init(&m->handle, NULL);
+    return m;
+}
+
+void pf_mutex_lock(PfMutex* mutex) {
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void pf_mutex_unlock(PfMutex* mutex) {
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+void pf_mutex_free(PfMutex* mutex) {
+    if (!mutex) return;
+    pthread_mutex_destroy(&mutex->handle);
+    free(mutex);
+}
@@ -0,0 +1,566 @@
+#include <windows.h>
+#include <wincrypt.h>
+#include <io.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "platform.h"
+
+// ---------------- Files and directories ----------------
+BOOL pf_stat(const char* path, PfStat* st) {
+    struct _stat64 s;
+    if (_stat64(path, &s) != 0) {
+        st->kind = PF_PATH_NONE;
+        return FALSE;
+    }
+    st->kind = (s.st_mode & _S_IFDIR) ? PF_PATH_DIR : PF_PATH_FILE;
+    st->size = (unsigned long long)s.st_size;
+    st->mtime = (long long)s.st_mtime;
+    return TRUE;
+}
+
+PfPathKind pf_path_kind(const char* path) {
+    DWORD attrs = GetFileAttributesA(path);
+    if (attrs == INVALID_FILE_ATTRIBUTES) return PF_PATH_NONE;
+    return (attrs & FILE_ATTRIBUTE_DIRECTORY) ? PF_PATH_DIR : PF_PATH_FILE;
+}
+
+FILE* pf_fopen(const char* path, const char* mode) {
+    return fopen(path, mode);
+}
+
+BOOL pf_mkdir(const char* path) {
+    return CreateDirectoryA(path, NULL);
+}
+
+BOOL pf_rmdir(const char* path) {
+    return RemoveDirectoryA(path);
+}
+
+BOOL pf_remove(const char* path) {
+    return DeleteFileA(path);
+}
+
+BOOL pf_rename(const char* from, const char* to) {
+    return MoveFileA(from, to);
+}
+
+BOOL pf_copy_file(const char* from, const char* to) {
+    return CopyFileA(from, to, FALSE);
+}
+
+BOOL pf_getcwd(char* out, size_t size) {
+    DWORD n = GetCurrentDirectoryA((DWORD)size, out);
+    return n > 0 && n < size;
+}
+
+unsigned long pf_last_error(void) {
+    return GetLastError();
+}
+
+struct PfDir {
+    HANDLE find;
+    WIN32_FIND_DATAA data;
+    BOOL pending;                         // data holds an entry not yet returned
+};
+
+PfDir* pf_dir_open(const char* path) {
+    char pattern[MAX_PATH * 2];
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    PfDir* dir = (PfDir*)calloc(1, sizeof(PfDir));
+    if (!dir) return NULL;
+    dir->find = FindFirstFileA(pattern, &dir->data);
+    if (dir->find == INVALID_HANDLE_VALUE) {
+        free(dir);
+        return NULL;
+    }
+    dir->pending = TRUE;
+    return dir;
+}
+
+BOOL pf_dir_next(PfDir* dir, PfDirEntry* entry) {
+    for (;;) {
+        if (!dir->pending && !FindNextFileA(dir->find, &dir->data)) return FALSE;
+        dir->pending = FALSE;
+        if (strcmp(dir->data.cFileName, ".") == 0 || strcmp(dir->data.cFileName, "..") == 0) continue;
+
+        snprintf(entry->name, sizeof(entry->name), "%s", dir->data.cFileName);
+        entry->is_dir = (dir->data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry->size = ((unsigned long long)dir->data.nFileSizeHigh << 32) | dir->data.nFileSizeLow;
+        // FILETIME counts 100 ns ticks from 1601
+        unsigned long long ticks = ((unsigned long long)dir->data.ftLastWriteTime.dwHighDateTime << 32) |
+                                   dir->data.ftLastWriteTime.dwLowDateTime;
+        entry->mtime_ns = ((long long)ticks - 116444736000000000LL) * 100;
+        return TRUE;
+    }
+}
+
+void pf_dir_close(PfDir* dir) {
+    if (!dir) return;
+    FindClose(dir->find);
+    free(dir);
+}
+
+// ---------------- Processes ----------------
+struct PfProcess {
+    PROCESS_INFORMATION pi;
+    HANDLE out_read;                      // overlapped read end of the output pipe
+    HANDLE in_write;                      // stdin pipe (PF_SPAWN_STDIN); NULL otherwise
+    HANDLE job;                           // holds the child's process tree; NULL if unavailable
+    double cpu_limit;                     // seconds of user time for the job; 0: none
+    OVERLAPPED ov;
+    BOOL reading;                         // a read into chunk is in flight
+    char chunk[4096];
+    DWORD chunk_len;
+    DWORD chunk_pos;                      // bytes of chunk already handed out
+};
+
+static volatile LONG g_pipeSerial = 0;
+
+// An anonymous pipe cannot be read with a timeout; a uniquely named one
+// opened for overlapped reads can. Only the write end is inheritable.
+static BOOL pf_create_output_pipe(HANDLE* read_end, HANDLE* write_end) {
+    char name[128];
+    snprintf(name, sizeof(name), "\\\\.\\pipe\\nexus-%lu-%ld",
+             GetCurrentProcessId(), InterlockedIncrement(&g_pipeSerial));
+    *read_end = CreateNamedPipeA(name, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                 PIPE_TYPE_BYTE | PIPE_WAIT, 1, 0, 65536, 0, NULL);
+    if (*read_end == INVALID_HANDLE_VALUE) return FALSE;
+
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+    sa.lpSecurityDescriptor = NULL;
+    *write_end = CreateFileA(name, GENERIC_WRITE, 0, &sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (*write_end == INVALID_HANDLE_VALUE) {
+        CloseHandle(*read_end);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// CreateProcess may write to cmd_line. env_block is NULL or a complete
+// environment block.
+static PfProcess* pf_spawn_line(char* cmd_line, const char* cwd, char* env_block, int flags,
+                                const PfLimits* limits) {
+    PfProcess* proc = (PfProcess*)calloc(1, sizeof(PfProcess));
+    if (!proc) return NULL;
+
+    STARTUPINFOA si;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = (flags & PF_SPAWN_CONSOLE) ? SW_SHOW : SW_HIDE;
+
+    HANDLE out_write = NULL;
+    if (flags & PF_SPAWN_CAPTURE) {
+        proc->ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+        if (!proc->ov.hEvent || !pf_create_output_pipe(&proc->out_read, &out_write)) {
+            if (proc->ov.hEvent) CloseHandle(proc->ov.hEvent);
+            free(proc);
+            return NULL;
+        }
+        si.dwFlags |= STARTF_USESTDHANDLES;
+        si.hStdOutput = out_write;
+        si.hStdError = out_write;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    }
+
+    HANDLE in_read = NULL;
+    if (flags & PF_SPAWN_STDIN) {
+        SECURITY_ATTRIBUTES sa;
+        sa.nLength = sizeof(sa);
+        sa.bInheritHandle = TRUE;
+        sa.lpSecurityDescriptor = NULL;
+        // Only the child's end is inherited
+        if (!CreatePipe(&in_read, &proc->in_write, &sa, 0) ||
+            !SetHandleInformation(proc->in_write, HANDLE_FLAG_INHERIT, 0)) {
+            if (in_read) CloseHandle(in_read);
+            if (proc->in_write) CloseHandle(proc->in_write);
+            if (out_write) CloseHandle(out_write);
+            if (proc->out_read) CloseHandle(proc->out_read);
+            if (proc->ov.hEvent) CloseHandle(proc->ov.hEvent);
+            free(proc);
+            return NULL;
+        }
+        if (!(flags & PF_SPAWN_CAPTURE)) {
+            si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+            si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        }
+        si.dwFlags |= STARTF_USESTDHANDLES;
+        si.hStdInput = in_read;
+    }
+
+    // Started suspended so it is in the job before it can start anything
+    DWORD creation = ((flags & PF_SPAWN_CONSOLE) ? 0 : CREATE_NO_WINDOW) | CREATE_SUSPENDED;
+    BOOL inherit = (flags & (PF_SPAWN_CAPTURE | PF_SPAWN_STDIN)) ? TRUE : FALSE;
+    BOOL ok = CreateProcessA(NULL, cmd_line, NULL, NULL, inherit,
+                             creation, env_block, cwd, &si, &proc->pi);
+    if (out_write) CloseHandle(out_write);
+    if (in_read) CloseHandle(in_read);
+    if (!ok) {
+        if (proc->in_write) CloseHandle(proc->in_write);
+        if (proc->out_read) CloseHandle(proc->out_read);
+        if (proc->ov.hEvent) CloseHandle(proc->ov.hEvent);
+        free(proc);
+        return NULL;
+    }
+    // Without a job (older Windows refuses nested ones) kill ends only the child
+    proc->job = CreateJobObjectA(NULL, NULL);
+    if (proc->job && !AssignProcessToJobObject(proc->job, proc->pi.hProcess)) {
+        CloseHandle(proc->job);
+        proc->job = NULL;
+    }
+    if (proc->job && limits && (limits->cpu_seconds > 0 || limits->memory_bytes > 0)) {
+        // Past the time limit Windows ends every process in the job; past the
+        // memory limit their allocations fail
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+        ZeroMemory(&info, sizeof(info));
+        if (limits->cpu_seconds > 0) {
+            info.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_TIME;
+            info.BasicLimitInformation.PerJobUserTimeLimit.QuadPart = (LONGLONG)(limits->cpu_seconds * 1e7);
+            proc->cpu_limit = limits->cpu_seconds;
+        }
+        if (limits->memory_bytes > 0) {
+            info.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+            info.JobMemoryLimit = (SIZE_T)limits->memory_bytes;
+        }
+        SetInformationJobObject(proc->job, JobObjectExtendedLimitInformation, &info, sizeof(info));
+    }
+    ResumeThread(proc->pi.hThread);
+    return proc;
+}
+
+PfProcess* pf_spawn(const char* command_line, const char* cwd, int flags) {
+    return pf_spawn_limited(command_line, NULL, cwd, NULL, flags, NULL);
+}
+
+// Quotes arg so the child's C runtime splits it back out unchanged:
+// backslashes are only special right before a quote
+static BOOL pf_append_arg(char* out, size_t size, size_t* len, const char* arg) {
+    BOOL plain = *arg && !strpbrk(arg, " \t\"");
+    size_t j = *len;
+    if (j && j + 1 < size) out[j++] = ' ';
+    if (!plain && j + 1 < size) out[j++] = '"';
+    for (const char* p = arg; *p; p++) {
+        size_t slashes = 0;
+        while (p[slashes] == '\\') slashes++;
+        if (!plain && (p[slashes] == '"' || p[slashes] == '\0')) slashes *= 2;
+        for (size_t i = 0; i < slashes && j + 1 < size; i++) out[j++] = '\\';
+        p += strspn(p, "\\");
+        if (!*p) break;
+        if (!plain && *p == '"' && j + 1 < size) out[j++] = '\\';
+        if (j + 1 < size) out[j++] = *p;
+    }
+    if (!plain && j + 1 < size) out[j++] = '"';
+    out[j] = '\0';
+    *len = j;
+    return j + 1 < size;
+}
+
+// This process's environment with env laid over it, as CreateProcess wants
+// it: "NAME=value" strings ending in an empty one. Names ignore case.
+static char* pf_build_env_block(const char* const* env) {
+    char* current = GetEnvironmentStringsA();
+    if (!current) return NULL;
+    size_t size = 1;
+    for (const char* e = current; *e; e += strlen(e) + 1) size += strlen(e) + 1;
+    for (const char* const* e = env; *e; e++) size += strlen(*e) + 1;
+
+    char* block = (char*)malloc(size);
+    if (block) {
+        char* out = block;
+        for (const char* e = current; *e; e += strlen(e) + 1) {
+            size_t name_len = strcspn(e + 1, "=") + 1;   // "=C:" style entries start with '='
+            BOOL overridden = FALSE;
+            for (const char* const* o = env; *o && !overridden; o++) {
+                overridden = _strnicmp(*o, e, name_len) == 0 && (*o)[name_len] == '=';
+            }
+            if (overridden) continue;
+            memcpy(out, e, strlen(e) + 1);
+            out += strlen(e) + 1;
+        }
+        for (const char* const* e = env; *e; e++) {
+            memcpy(out, *e, strlen(*e) + 1);
+            out += strlen(*e) + 1;
+        }
+        *out = '\0';
+    }
+    FreeEnvironmentStringsA(current);
+    return block;
+}
+
+PfProcess* pf_spawn_argv(const char* const* argv, const char* cwd, const char* const* env, int flags) {
+    return pf_spawn_limited(NULL, argv, cwd, env, flags, NULL);
+}
+
+PfProcess* pf_spawn_limited(const char* command_line, const char* const* argv, const char* cwd,
+                            const char* const* env, int flags, const PfLimits* limits) {
+    char cmd_line[8192];
+    if (argv) {
+        size_t len = 0;
+        cmd_line[0] = '\0';
+        for (const char* const* a = argv; *a; a++) {
+            if (!pf_append_arg(cmd_line, sizeof(cmd_line), &len, *a)) return NULL;
+        }
+        flags &= ~PF_SPAWN_SHELL;
+    } else if (flags & PF_SPAWN_SHELL) {
+        snprintf(cmd_line, sizeof(cmd_line), "cmd.exe /c %s", command_line);
+    } else {
+        snprintf(cmd_line, sizeof(cmd_line), "%s", command_line);
+    }
+    char* env_block = NULL;
+    if (env && *env) {
+        env_block = pf_build_env_block(env);
+        if (!env_block) return NULL;
+    }
+    PfProcess* proc = pf_spawn_line(cmd_line, cwd, env_block, flags, limits);
+    free(env_block);
+    return proc;
+}
+
+int pf_process_read(PfProcess* proc, char* buf, size_t size) {
+    return pf_process_read_timeout(proc, buf, size, -1);
+}
+
+// Reads go into chunk, so one still in flight when the wait times out has
+// somewhere to land; the next call picks it up
+int pf_process_read_timeout(PfProcess* proc, char* buf, size_t size, int timeout_ms) {
+    if (!proc->out_read) return 0;
+    if (proc->chunk_pos == proc->chunk_len) {
+        if (!proc->reading) {
+            ResetEvent(proc->ov.hEvent);
+            proc->ov.Offset = proc->ov.OffsetHigh = 0;
+            proc->chunk_len = proc->chunk_pos = 0;
+            if (!ReadFile(proc->out_read, proc->chunk, sizeof(proc->chunk), NULL, &proc->ov) &&
+                GetLastError() != ERROR_IO_PENDING) {
+                return 0;                 // ERROR_BROKEN_PIPE: the writers are gone
+            }
+            proc->reading = TRUE;
+        }
+        if (WaitForSingleObject(proc->ov.hEvent, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms) == WAIT_TIMEOUT) {
+            return PF_READ_TIMEOUT;
+        }
+        proc->reading = FALSE;
+        DWORD n = 0;
+        if (!GetOverlappedResult(proc->out_read, &proc->ov, &n, FALSE) || n == 0) return 0;
+        proc->chunk_len = n;
+    }
+    DWORD n = proc->chunk_len - proc->chunk_pos;
+    if (n > size) n = (DWORD)size;
+    memcpy(buf, proc->chunk + proc->chunk_pos, n);
+    proc->chunk_pos += n;
+    return (int)n;
+}
+
+BOOL pf_process_write(PfProcess* proc, const void* buf, size_t size) {
+    const char* p = (const char*)buf;
+    while (size > 0 && proc->in_write) {
+        DWORD n = 0;
+        if (!WriteFile(proc->in_write, p, (DWORD)size, &n, NULL) || n == 0) return FALSE;
+        p += n;
+        size -= n;
+    }
+    return size == 0;
+}
+
+void pf_process_close_input(PfProcess* proc) {
+    if (!proc->in_write) return;
+    CloseHandle(proc->in_write);
+    proc->in_write = NULL;
+}
+
+BOOL pf_process_exited(PfProcess* proc) {
+    return WaitForSingleObject(proc->pi.hProcess, 0) == WAIT_OBJECT_0;
+}
+
+static void pf_process_close(PfProcess* proc) {
+    if (proc->reading) {
+        // The read must end before chunk goes away
+        DWORD n;
+        CancelIo(proc->out_read);
+        GetOverlappedResult(proc->out_read, &proc->ov, &n, TRUE);
+    }
+    if (proc->out_read) CloseHandle(proc->out_read);
+    if (proc->in_write) CloseHandle(proc->in_write);
+    if (proc->ov.hEvent) CloseHandle(proc->ov.hEvent);
+    if (proc->job) CloseHandle(proc->job);
+    CloseHandle(proc->pi.hProcess);
+    CloseHandle(proc->pi.hThread);
+    free(proc);
+}
+
+int pf_process_wait(PfProcess* proc) {
+    return pf_process_wait_usage(proc, NULL);
+}
+
+static double pf_filetime_seconds(const FILETIME* ft) {
+    ULARGE_INTEGER t;
+    t.u.LowPart = ft->dwLowDateTime;
+    t.u.HighPart = ft->dwHighDateTime;
+    return (double)t.QuadPart / 1e7;
+}
+
+int pf_process_wait_usage(PfProcess* proc, PfUsage* usage) {
+    DWORD exit_code = 1;
+    WaitForSingleObject(proc->pi.hProcess, INFINITE);
+    GetExitCodeProcess(proc->pi.hProcess, &exit_code);
+    if (usage) {
+        ZeroMemory(usage, sizeof(*usage));
+        JOBOBJECT_BASIC_ACCOUNTING_INFORMATION acct;
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+        if (proc->job && QueryInformationJobObject(proc->job, JobObjectBasicAccountingInformation,
+                                                   &acct, sizeof(acct), NULL)) {
+            double user = (double)acct.TotalUserTime.QuadPart / 1e7;
+            usage->cpu_seconds = user + (double)acct.TotalKernelTime.QuadPart / 1e7;
+            usage->cpu_limit_hit = proc->cpu_limit > 0 && user >= proc->cpu_limit;
+            if (QueryInformationJobObject(proc->job, JobObjectExtendedLimitInformation,
+                                          &info, sizeof(info), NULL)) {
+                usage->peak_memory = (unsigned long long)info.PeakJobMemoryUsed;
+            }
+        } else {
+            FILETIME created, exited, kernel, user;
+            if (GetProcessTimes(proc->pi.hProcess, &created, &exited, &kernel, &user)) {
+                usage->cpu_seconds = pf_filetime_seconds(&kernel) + pf_filetime_seconds(&user);
+            }
+        }
+    }
+    pf_process_close(proc);
+    return (int)exit_code;
+}
+
+void pf_process_join(PfProcess* proc) {
+    WaitForSingleObject(proc->pi.hProcess, INFINITE);
+}
+
+void pf_process_kill(PfProcess* proc) {
+    if (proc->job) {
+        TerminateJobObject(proc->job, 1);
+    } else {
+        TerminateProcess(proc->pi.hProcess, 1);
+    }
+}
+
+void pf_process_detach(PfProcess* proc) {
+    pf_process_close(proc);
+}
+
+// ---------------- System ----------------
+BOOL pf_random_bytes(void* buf, size_t len) {
+    HCRYPTPROV prov;
+    if (!CryptAcquireContext(&prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) return FALSE;
+    BOOL ok = CryptGenRandom(prov, (DWORD)len, (BYTE*)buf);
+    CryptReleaseContext(prov, 0);
+    return ok;
+}
+
+void pf_executable_path(char* out, size_t size) {
+    DWORD n = GetModuleFileNameA(NULL, out, (DWORD)size);
+    if (n == 0 || n >= size) out[0] = '\0';
+}
+
+int pf_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+BOOL pf_setenv(const char* name, const char* value) {
+    return SetEnvironmentVariableA(name, value);
+}
+
+BOOL pf_find_program(const char* name, char* out, size_t size) {
+    DWORD n = SearchPathA(NULL, name, ".exe", (DWORD)size, out, NULL);
+    return n > 0 && n < size;
+}
+
+void pf_expand_env(const char* in, char* out, size_t size) {
+    DWORD n = ExpandEnvironmentStringsA(in, out, (DWORD)size);
+    if (n == 0 || n > size) snprintf(out, size, "%s", in);
+}
+
+BOOL pf_is_terminal(FILE* f) {
+    return _isatty(_fileno(f));
+}
+
+// ---------------- Time ----------------
+unsigned long pf_ticks_ms(void) {
+    return GetTickCount();
+}
+
+double pf_seconds(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+}
+
+void pf_sleep_ms(unsigned int ms) {
+    Sleep(ms);
+}
+
+// ---------------- Threads ----------------
+struct PfThread {
+    HANDLE handle;
+    PfThreadFn fn;
+    void* arg;
+};
+
+static DWORD WINAPI pf_thread_main(LPVOID param) {
+    PfThread* t = (PfThread*)param;
+    return (DWORD)t->fn(t->arg);
+}
+
+PfThread* pf_thread_start(PfThreadFn fn, void* arg) {
+    PfThread* t = (PfThread*)calloc(1, sizeof(PfThread));
+    if (!t) return NULL;
+    t->fn = fn;
+    t->arg = arg;
+    t->handle = CreateThread(NULL, 0, pf_thread_main, t, 0, NULL);
+    if (!t->handle) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+void pf_thread_join(PfThread* thread) {
+    if (!thread) return;
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+void pf_atomic_set(PfAtomic* value, long v) {
+    InterlockedExchange((volatile LONG*)value, v);
+}
+
+long pf_atomic_get(PfAtomic* value) {
+    return InterlockedCompareExchange((volatile LONG*)value, 0, 0);
+}
+
+struct PfMutex {
+    CRITICAL_SECTION section;
+};
+
+PfMutex* pf_mutex_create(void) {
+    PfMutex* m = (PfMutex*)calloc(1, sizeof(PfMutex));
+    if (m) InitializeCriticalSection(&m->section);
+    return m;
+}
+
+void pf_mutex_lock(PfMutex* mutex) {
+    EnterCriticalSection(&mutex->section);
+}
+
+void pf_mutex_unlock(PfMutex* mutex) {
+    LeaveCriticalSection(&mutex->section);
+}
+
+void pf_mutex_free(PfMutex* mutex) {
+    if (!mutex) return;
+    DeleteCriticalSection(&mutex->section);
+    free(mutex);
+}
@@ -1,13 +1,16 @@
-#include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <io.h>
 #include <time.h>
 #include <stdarg.h>
-#include <wincrypt.h>
-#pragma comment(lib, "advapi32.lib")
+
+#include "platform.h"
+#include "engine.h"
+#include "hash.h"
+#include "gitread.h"
+#include "json.h"
+#include "match.h"
 // IDE functionality integrated directly
 
 #define MAX_NAME 256
@@ -28,12 +31,18 @@
 #define MAX_THEME_NAME 32
 #define MAX_FONT_NAME 64
 #define MAX_SETTINGS_SIZE 1024
+#define SCROLLBACK_DEFAULT 5000
+#define SCROLLBACK_MIN 100
+#define SCROLLBACK_MAX 1000000
 
 // Project Detection Constants
 #define MAX_PROJECT_PATH 512
 #define MAX_SCRIPT_NAME 128
 #define MAX_DEPENDENCY_NAME 64
 #define MAX_DEPENDENCIES 50
+#define MAX_PACKAGE_SCRIPTS 32
+#define MAX_SCRIPT_COMMAND 256
+#define PACKAGE_CACHE_SLOTS 4
 
 // Project Types
 typedef enum {
@@ -66,6 +75,35 @@ typedef struct {
 // Global project info
 static ProjectInfo g_currentProject = {0};
 
+// What a package.json declares, read in one pass by package_info
+#define PACKAGE_USES_REACT 0x1             // react
+#define PACKAGE_USES_VUE 0x2               // vue
+#define PACKAGE_USES_ANGULAR 0x4           // @angular/core
+
+typedef struct {
+    char name[MAX_SCRIPT_NAME];
+    char command[MAX_SCRIPT_COMMAND];
+} PackageScript;
+
+typedef struct {
+    char name[MAX_DEPENDENCY_NAME];
+    BOOL dev;                             // from devDependencies
+} PackageDependency;
+
+typedef struct {
+    BOOL used;
+    unsigned long long hash;              // hash64 of the text it was read from
+    BOOL valid;                           // FALSE: not a JSON object, error says why
+    char error[128];
+    PackageScript scripts[MAX_PACKAGE_SCRIPTS];
+    int script_count;
+    PackageDependency dependencies[MAX_DEPENDENCIES];
+    int dependency_count;                 // names kept; the counts below are all listed
+    int runtime_count;
+    int dev_count;
+    int uses;                             // PACKAGE_USES_* from either list
+} PackageInfo;
+
 // Forward declarations
 static void get_main_project_dir(char* buffer, size_t size);
 static void cmd_sync(void);
@@ -73,15 +111,41 @@ static void cmd_writeln(const char* args);
 static void cmd_writecode(const char* args);
 static void cmd_editcode(const char* args);
 static void cmd_adduser(const char* args);
-static void gui_println(const char* text);
-static void gui_printf(const char* format, ...);
+static int parse_first_token(char* line, char** arg_out);
+static int split_args(char* line, char** argv, int max);
+static int str_icmp(const char* s1, const char* s2);
 
 // ---------------- In-memory filesystem ----------------
 typedef struct File {
     char name[MAX_NAME];
     char content[MAX_FILE_SIZE];
+    int search_doc;                       // SEARCH's document number + 1; 0 when not indexed
+    int name_node;                        // FIND's name index entry + 1; 0 when not indexed
 } File;
 
+// What project detection needs to know about a folder: source files by
+// kind in it and below it (ignored ones left out, as the old scans did)
+// and which build files sit in the folder itself
+typedef enum {
+    SOURCE_C,
+    SOURCE_CPP,
+    SOURCE_HEADER,
+    SOURCE_PYTHON,
+    SOURCE_JS,
+    SOURCE_TS,
+    SOURCE_KINDS
+} SourceKind;
+
+#define PROJECT_MARK_PACKAGE_JSON 0x1
+#define PROJECT_MARK_CMAKE        0x2
+#define PROJECT_MARK_MAKEFILE     0x4
+#define PROJECT_MARK_REQUIREMENTS 0x8
+
+typedef struct {
+    int sources[SOURCE_KINDS];
+    int marks;                            // PROJECT_MARK_*
+} ProjectStats;
+
 typedef struct Directory {
     char name[MAX_NAME];
     struct Directory* parent;
@@ -89,8 +153,313 @@ typedef struct Directory {
     File* files[MAX_FILES];
     int child_count;
     int file_count;
+    ProjectStats stats;                   // see project_stats
+    unsigned stats_epoch;                 // g_projectStatsEpoch when stats were counted; 0: stale
+    int name_node;                        // FIND's name index entry + 1; 0 when not indexed
 } Directory;
 
+// What vfs_changed reports
+typedef enum {
+    VFS_FILE_ADDED,
+    VFS_FILE_WRITTEN,
+    VFS_FILE_REMOVED,
+    VFS_DIR_ADDED,
+    VFS_DIR_REMOVED
+} VfsChange;
+
+// ---------------- Ignore rules (.gitignore semantics) ----------------
+#define IGNORE_MAX_TOKENS 63       // one NFA state per token, plus the accept state, in 64 bits
+#define IGNORE_MAX_FRAMES 32
+#define IGNORE_MAX_USERS 16
+#define IGNORE_NEGATE   0x1        // "!pattern" re-includes a previously ignored path
+#define IGNORE_DIR_ONLY 0x2        // "pattern/" only matches directories
+
+// A pattern compiled to a bit-parallel NFA: bit i of the state set means
+// "the first i tokens have matched". Every input byte is a shift and two masks.
+typedef struct {
+    unsigned long long consume[256];   // bit i: token i consumes this byte
+    unsigned long long loop_any;       // bit i: token i is inside "**" (stays on any byte)
+    unsigned long long loop_seg;       // bit i: token i is "*" (stays on any byte but '/')
+    unsigned long long skip1;          // bit i: token i may match nothing
+    unsigned long long skip2;          // bit i: "**/" may match nothing at all
+    int accept;
+    int flags;
+    char source[96];
+} IgnoreRule;
+
+typedef struct {
+    IgnoreRule* rules;
+    int count;
+    int capacity;
+} IgnoreRuleSet;
+
+// State carried through a tree walk: the stack of rule sets in scope
+// (defaults, the user's rules file, then any .gitignore met on the way down)
+// and the path of the current directory relative to the user's home.
+typedef struct IgnoreWalk {
+    const IgnoreRuleSet* sets[IGNORE_MAX_FRAMES];
+    IgnoreRuleSet* owned[IGNORE_MAX_FRAMES];
+    int base[IGNORE_MAX_FRAMES];
+    int depth;
+    char path[1024];
+    int len;
+} IgnoreWalk;
+
+typedef struct {
+    int depth;
+    int len;
+} IgnoreMark;
+
+// ---------------- Sync engine ----------------
+// Last content both sides agreed on, keyed by path relative to C:\USERS
+typedef struct SyncBase {
+    char* path;
+    char* content;                        // NULL for a directory
+    unsigned long long hash;
+    struct SyncBase* next;
+} SyncBase;
+
+// One file or directory found under data\USERS
+typedef struct {
+    char* path;
+    char* content;
+    unsigned long long hash;
+    BOOL is_dir;
+    BOOL unsyncable;                      // too big or binary; left alone
+    BOOL seen;                            // matched while walking the VFS
+    BOOL complete;                        // directory listed to the end (not cancelled)
+    int first_child;
+    int next_sibling;
+} SyncEntry;
+
+typedef struct {
+    SyncEntry* entries;
+    int count;
+    int capacity;
+    int* index;                           // open addressing over entries by path
+    int index_size;
+    // Progress, written by the scanning thread and read by the status line
+    PfAtomic* cancel;
+    volatile long dirs_scanned;
+    volatile long files_read;
+    volatile long files_changed;
+    volatile unsigned long long bytes_read;
+} SyncScan;
+
+typedef enum {
+    SYNC_OP_IMPORT,                       // disk changed: copy into the VFS
+    SYNC_OP_EXPORT,                       // VFS changed: write to disk
+    SYNC_OP_DELETE_VFS,
+    SYNC_OP_DELETE_DISK,
+    SYNC_OP_MKDIR_VFS,
+    SYNC_OP_MKDIR_DISK,
+    SYNC_OP_DELETE_VFS_DIR,
+    SYNC_OP_DELETE_DISK_DIR,
+    SYNC_OP_ADOPT,                        // both sides agree: record a new base
+    SYNC_OP_FORGET,                       // gone from both sides: drop the base
+    SYNC_OP_CONFLICT
+} SyncOpKind;
+
+typedef struct {
+    SyncOpKind kind;
+    char* path;
+    const char* content;                  // borrowed from the VFS or the scan
+    const char* reason;
+} SyncOp;
+
+typedef struct {
+    SyncOp* ops;
+    int count;
+    int capacity;
+} SyncPlan;
+
+typedef struct {
+    int imported;
+    int exported;
+    int deleted;
+    int dirs;
+    int conflicts;
+    int skipped;
+} SyncReport;
+
+// A sync in flight. The disk scan runs on a worker thread; planning and
+// applying touch the VFS and run on the UI thread once the scan ends.
+#define SYNC_MAX_ROOTS MAX_CHILDREN
+#define SYNC_STATUS_DELAY_MS 500
+
+typedef enum {
+    SYNC_JOB_APPLY,                       // SYNC
+    SYNC_JOB_STATUS,                      // SYNC STATUS (dry run)
+    SYNC_JOB_STARTUP                      // every user at startup; quiet unless something needs attention
+} SyncJobMode;
+
+typedef struct {
+    SyncJobMode mode;
+    int root_count;
+    Directory* dirs[SYNC_MAX_ROOTS];
+    char* rel[SYNC_MAX_ROOTS];
+    IgnoreWalk* walks[SYNC_MAX_ROOTS];
+    int roots[SYNC_MAX_ROOTS];            // scan entry of each root, -1 if it has no real directory
+    SyncScan scan;
+    PfThread* thread;                     // NULL when the scan ran inline
+    PfAtomic cancel;
+    PfAtomic finished;
+    long expected_files;                  // synced files under the roots last time, for the ETA
+    unsigned long started;
+    BOOL status_shown;
+    BOOL prompt_pending;                  // a prompt was held back until the job ends
+} SyncJob;
+
+// ---------------- Jobs ----------------
+#define JOB_STATUS_DELAY_MS 1000
+#define JOB_POLL_MS 100                   // how often a silent job checks whether its program exited
+#define JOB_LINE_MAX 4096
+#define JOB_MARK_MAX 64
+#define JOB_KILL_GRACE_MS 2000            // from SIGTERM to SIGKILL for a program past a limit
+
+typedef struct Job Job;
+typedef void (*JobDoneFn)(Job* job, int exit_code);
+
+// An external program a command started. A worker thread reads its output
+// into out; the UI thread prints it from there and calls done at the end.
+struct Job {
+    int id;
+    char label[256];                      // the command line that started it
+    PfProcess* proc;
+    PfThread* thread;                     // NULL when it ran inline
+    PfMutex* lock;                        // guards out and out_len
+    char* out;                            // read by the thread, not yet printed
+    size_t out_len;
+    size_t out_cap;
+    char line[JOB_LINE_MAX];              // the unfinished last line
+    size_t line_len;
+    size_t shown;                         // how much of line is already on screen
+    BOOL cr;                              // the last byte printed was a '\r'
+    BOOL input;                           // stdin is a pipe fed by jobs_input
+    BOOL fresh;                           // output came since the last tick
+    PfAtomic finished;                    // exited, and all its output is in out
+    BOOL background;
+    BOOL watched;                         // started by a WATCH run
+    BOOL killed;
+    BOOL status_shown;
+    unsigned long started;
+    double start_time;                    // pf_seconds at the spawn
+    double seconds;                       // how long the program ran
+    JobDoneFn done;                       // NULL: nothing to do after it
+    char cwd[1024];                       // VFS working directory, relative to the root
+    char dir[1024];                       // the real folder it runs in
+    char arg[1024];                       // whatever else done needs
+    // A job attached to a program that outlives it (job_attach) ends at a
+    // line "<until><exit code>" instead of when the program exits
+    BOOL borrowed;
+    char until[JOB_MARK_MAX];
+    int until_code;                       // -1 if the program died first
+    // The job_*_limit settings when it started. The runner enforces wall
+    // time and output; the system, CPU time and memory.
+    double time_limit;                    // seconds; 0: none
+    size_t output_limit;                  // bytes; 0: none
+    size_t output_total;
+    PfLimits limits;
+    const char* limit_hit;                // the limit the runner stopped it for
+    double kill_time;                     // when, until the follow-up kill
+    PfUsage usage;                        // what it used, once it has ended
+    Job* next;
+};
+
+// ---------------- Build ----------------
+// BUILD compiles the C/C++ sources of a folder into build\<folder>.exe,
+// recompiling only the objects whose inputs changed, on several compilers at
+// once. What it learned about each file is kept in build\build.db.
+#define BUILD_DIR "build"
+#define BUILD_MAX_WORKERS 64
+#define BUILD_MAX_INCLUDE_DEPTH 64
+#define BUILD_STATUS_DELAY_MS 500
+
+// A source or a header one of them reached. Read again only when its size
+// or mtime changes, or when the mtime was too recent to tell an edit made
+// in the same second.
+typedef struct {
+    char* path;                           // relative to the project folder
+    unsigned long long size;
+    long long mtime;
+    long long scanned_at;                 // when it was read
+    unsigned long long hash;              // of its content
+    char** includes;                      // its #include "..." names, in order
+    int include_count;
+    BOOL checked;                         // looked at during this build
+    BOOL exists;
+    int visit;                            // last walk that reached it
+} BuildFile;
+
+typedef struct {
+    char* source;
+    unsigned long long sig;               // inputs it was last compiled from
+} BuildObject;
+
+typedef struct {
+    BuildFile* files;
+    int count;
+    int capacity;
+    int* index;                           // open addressing over files by path
+    int index_size;
+    BuildObject* objects;
+    int object_count;
+    int object_capacity;
+    unsigned long long link_sig;          // objects the program was last linked from
+    int visit;
+    BOOL dirty;
+} BuildDb;
+
+typedef struct {
+    char* source;
+    char* command;
+    unsigned long long sig;
+    int exit_code;
+    BOOL done;
+} BuildUnit;
+
+typedef struct BuildJob BuildJob;
+
+typedef struct {
+    BuildJob* job;
+    int slot;
+    PfThread* thread;                     // NULL for the one the builder itself runs
+} BuildWorker;
+
+// A build in flight. Planning happens on the UI thread; the compilers run
+// on worker threads, which take the next stale unit until none are left,
+// and the builder links once they are done. Results reach the database on
+// the UI thread again.
+struct BuildJob {
+    char dir[1024];                       // the real project folder
+    char exe[MAX_NAME + 16];              // build\<name>.exe
+    char* link_command;                   // NULL: the program is up to date
+    BuildDb db;
+    BuildUnit* units;                     // stale ones only
+    int unit_count;
+    int up_to_date;
+    unsigned long long link_sig;
+    int worker_count;
+    BuildWorker workers[BUILD_MAX_WORKERS];
+    PfThread* thread;                     // NULL when the build ran inline
+    PfMutex* lock;                        // guards next, failed, running and out
+    int next;
+    volatile long completed;
+    BOOL failed;
+    PfProcess* running[BUILD_MAX_WORKERS];
+    char* out;                            // lines not yet printed
+    size_t out_len;
+    size_t out_cap;
+    int link_exit;
+    int spawn_flags;
+    PfAtomic cancel;
+    PfAtomic finished;
+    double start;
+    unsigned long started;
+    BOOL status_shown;
+    BOOL prompt_pending;                  // a prompt was held back until the build ends
+};
+
 // ---------------- Security & Authentication System ----------------
 typedef struct {
     char username[64];
@@ -136,6 +505,12 @@ typedef struct {
     BOOL show_hidden_files;
     char default_editor[64];
     int max_history_size;
+    int scrollback_lines;                 // output lines the window keeps
+    BOOL python_worker;                   // RUN .py through a long-lived interpreter
+    int job_time_limit;                   // seconds a program may run; 0: no limit
+    int job_cpu_limit;                    // seconds of CPU time; 0: no limit
+    int job_memory_limit;                 // MB; 0: no limit
+    int job_output_limit;                 // MB of output; 0: no limit
     BOOL sound_enabled;
     int window_width;
     int window_height;
@@ -157,6 +532,16 @@ static int g_authCount = 0;
 static BOOL g_requireAuthForAdmin = TRUE;
 static char g_authFilePath[MAX_PATH];
 
+// Set once filesystem.dat has been read; the sync base is only trusted alongside it
+static BOOL g_fsLoadedFromDisk = FALSE;
+#define FS_FORMAT_VERSION 2
+
+#define SYNC_BASE_BUCKETS 4096
+static SyncBase* g_syncBase[SYNC_BASE_BUCKETS];
+static BOOL g_syncBaseLoaded = FALSE;
+static BOOL g_syncBaseDirty = FALSE;
+static BOOL g_syncBaseFresh = FALSE;      // no sync_base.dat yet: the first sync records it
+
 // Theme & Settings Globals
 static ColorTheme g_themes[10];
 static int g_themeCount = 0;
@@ -166,19 +551,54 @@ static char g_themesDir[MAX_PATH];
 
 // Forward declarations
 static void fs_load_from_disk(void);
-static void fs_save_to_disk(void);
-static void save_filesystem_recursive(Directory* dir, FILE* f, const char* path);
+static void save_filesystem_recursive(Directory* dir, FILE* f, const char* path, IgnoreWalk* walk);
 static void join_path(char* out, size_t out_sz, const char* base, const char* name);
+static BOOL mkdir_p(const char* pathIn);
 static void load_users_from_realfilesystem(void);
 static void sync_all_directories(void);
-static void sync_directory_recursive(Directory* virtual_dir, const char* real_path);
+static void cmd_sync_command(const char* args);
+
+// Scripts
+#define SAVE_FS       0x1
+#define SAVE_AUTH     0x2
+#define SAVE_SETTINGS 0x4
+#define SAVE_SYNC     0x8
+static void cmd_source(const char* args);
+static BOOL script_running(void);
+static BOOL script_defer_save(int what);
+static void script_note_error(const char* text);
+static void gui_error(const char* text);
+static void gui_errorf(const char* format, ...);
+
+// Pipelines
+static BOOL command_line_run(char* input);
+static void cmd_find(const char* args);
+static void cmd_grep(const char* args);
+static void cmd_search(const char* args);
+static void search_index_changed(VfsChange what, Directory* dir, File* file);
+static void search_index_save(void);
+static void find_by_name(const char* args);
+static void name_index_changed(VfsChange what, Directory* dir, File* file);
+static void name_index_rename(Directory* dir, const char* name);
 static void cmd_ide(const char* args);
 static void cmd_ide_help(void);
 static void cmd_ide_list(void);
 
+// Ignore Rule Functions
+static void ignore_walk_begin(IgnoreWalk* w, const char* user);
+static void ignore_walk_begin_at(IgnoreWalk* w, Directory* dir);
+static void ignore_walk_detach(IgnoreWalk* w);
+static void ignore_walk_end(IgnoreWalk* w);
+static BOOL ignore_walk_check(IgnoreWalk* w, const char* name, BOOL is_dir);
+static void ignore_walk_enter(IgnoreWalk* w, const char* name, IgnoreMark* mark);
+static void ignore_walk_enter_dir(IgnoreWalk* w, Directory* dir, IgnoreMark* mark);
+static void ignore_walk_leave(IgnoreWalk* w, const IgnoreMark* mark);
+static void ignore_walk_push_text(IgnoreWalk* w, const char* text);
+static void ignore_walk_push_file(IgnoreWalk* w, const char* real_dir);
+static void cmd_ignore(const char* args);
+static void cmd_hash(const char* args);
+
 // Security & Authentication Functions
-static void init_security_system(void);
-static void init_theme_system(void);
 static void generate_salt(char* salt, int length);
 static void hash_password(const char* password, const char* salt, char* hash);
 static BOOL verify_password(const char* password, const char* hash, const char* salt);
@@ -200,7 +620,6 @@ static BOOL user_exists(const char* username);
 static void init_default_themes(void);
 static void load_settings(void);
 static void save_settings(void);
-static void apply_theme(const char* theme_name);
 static void apply_theme_silent(const char* theme_name, BOOL show_message);
 static void create_custom_theme(const char* name, COLORREF text, COLORREF bg, COLORREF cursor);
 static void cmd_login(const char* args);
@@ -218,17 +637,13 @@ static void cmd_textcolor(const char* args);
 static void cmd_cursorcolor(const char* args);
 
 // Project Detection Functions
-static void detect_project_type(void);
 static ProjectType scan_directory_for_project_type(Directory* dir);
+static const ProjectStats* project_stats(Directory* dir);
+static void project_stats_changed(VfsChange what, Directory* dir, File* file);
 static int has_package_json(Directory* dir);
-static int has_react_dependency(Directory* dir);
-static int has_vue_dependency(Directory* dir);
-static int has_angular_dependency(Directory* dir);
-static int has_cpp_files(Directory* dir);
-static int has_python_files(Directory* dir);
-static int has_requirements_txt(Directory* dir);
-static int has_cmake_files(Directory* dir);
-static int has_makefile(Directory* dir);
+static const PackageInfo* package_info(const File* file);
+static const PackageScript* package_script(const PackageInfo* info, const char* name);
+static File* package_json_find(Directory* dir);
 static void load_package_json_info(void);
 static void find_main_files(void);
 static const char* project_type_to_string(ProjectType type);
@@ -269,15 +684,28 @@ static void execute_npm_command(const char* npm_args);
 // C++ and Python Execution
 static void execute_cpp_file(const char* filename);
 static void execute_python_file(const char* filename);
+static void python_worker_stop(void);
+static int* job_limit_setting(const char* name);
+static int job_limit_max(const char* name);
+static const char* job_limits_text(void);
 static int find_cpp_files(char files[][256], int max_files);
 static int find_python_files(char files[][256], int max_files);
 static void cmd_run(const char* filename);
 static void cmd_compile(const char* filename);
-
-// Command history functions
-static void add_to_history(const char* command);
-static void navigate_history(int direction);
-static void update_input_field(const char* text);
+static void cmd_cache_stats(void);
+static void cmd_cache_clear(void);
+static void cmd_cache_usage(const char* args);
+static void cmd_build(const char* args);
+static BOOL build_job_active(void);
+static void build_job_wake(void);
+static void build_job_poll(void);
+static void build_job_cancel(void);
+static void build_job_abandon(void);
+static void build_job_hold_prompt(void);
+static void cmd_watch(const char* args);
+static void watch_poll(void);
+static void watch_abandon(void);
+static void watch_vfs_changed(VfsChange what, Directory* dir, File* file);
 
 // System maintenance functions for admin operations
 static void create_system_maintenance_folder(void);
@@ -303,13 +731,6 @@ static File* g_editFile = NULL;
 static char g_editBuffer[2048];
 static int g_editBufferPos = 0;
 
-// Command history variables
-#define MAX_HISTORY 100
-static char g_commandHistory[MAX_HISTORY][256];
-static int g_historyCount = 0;
-static int g_historyIndex = -1;
-static char g_currentInput[256] = {0};
-
 // System maintenance variables for admin operations
 static BOOL g_systemMaintenanceMode = FALSE;
 static char g_systemMaintenancePath[1024] = "C:\\";
@@ -346,16 +767,29 @@ static File* fs_find_file(Directory* parent, const char* name) {
     return NULL;
 }
 
+// Every change to the tree is reported here: additions once linked in,
+// writes once the content is in place, removals just before the node is
+// unlinked. A removed directory is reported once, not entry by entry. For
+// a directory, dir is the directory itself and file is NULL.
+static void vfs_changed(VfsChange what, Directory* dir, File* file) {
+    project_stats_changed(what, dir, file);
+    watch_vfs_changed(what, dir, file);
+    search_index_changed(what, dir, file);
+    name_index_changed(what, dir, file);
+}
+
 static void fs_add_child(Directory* parent, Directory* child) {
     if (parent->child_count < MAX_CHILDREN) {
         parent->children[parent->child_count++] = child;
         child->parent = parent;
+        vfs_changed(VFS_DIR_ADDED, child, NULL);
     }
 }
 
 static void fs_add_file(Directory* parent, File* file) {
     if (parent->file_count < MAX_FILES) {
         parent->files[parent->file_count++] = file;
+        vfs_changed(VFS_FILE_ADDED, parent, file);
     }
 }
 
@@ -381,9 +815,427 @@ static void fs_print_path(Directory* dir, char* out, size_t out_sz) {
     snprintf(out, out_sz, "C:\\USERS\\%s", tmp);
 }
 
+// ---------------- Ignore rules ----------------
+// Rules every user starts with; their Settings\ignore.dat is layered on top
+static const char* g_defaultIgnoreRules[] = {
+    ".git/",
+    "node_modules/",
+    "__pycache__/",
+    "build/",
+    "dist/",
+    "*.o",
+    "*.obj",
+    "*.exe",
+    "*.pyc",
+    NULL
+};
+
+typedef struct {
+    char user[64];
+    IgnoreRuleSet set;
+    time_t mtime;
+    long size;
+    BOOL loaded;
+} IgnoreUserRules;
+
+static IgnoreRuleSet g_ignoreDefaults;
+static BOOL g_ignoreDefaultsReady = FALSE;
+static IgnoreUserRules g_ignoreUsers[IGNORE_MAX_USERS];
+static int g_ignoreUserCount = 0;
+
+// Compile a glob into the rule's automaton. Matching is case-insensitive like the VFS.
+static BOOL ignore_compile_glob(IgnoreRule* r, const char* pat) {
+    const char* p = pat;
+    int n = 0;
+    memset(r->consume, 0, sizeof(r->consume));
+    r->loop_any = r->loop_seg = r->skip1 = r->skip2 = 0;
+
+    while (*p) {
+        if (n >= IGNORE_MAX_TOKENS) return FALSE;
+        unsigned long long bit = 1ULL << n;
+
+        // "**" spanning whole path segments crosses directories
+        if (p[0] == '*' && p[1] == '*' && (p == pat || p[-1] == '/') && (p[2] == '/' || p[2] == '\0')) {
+            if (p[2] == '\0') {
+                r->loop_any |= bit;
+                r->skip1 |= bit;
+                p += 2; n++;
+                continue;
+            }
+            // "**/" is an entry state that either matches nothing or enters
+            // a loop over any bytes that leaves on a '/'
+            if (n + 1 >= IGNORE_MAX_TOKENS) return FALSE;
+            r->skip1 |= bit;
+            r->skip2 |= bit;
+            r->loop_any |= bit << 1;
+            r->consume['/'] |= bit << 1;
+            p += 3; n += 2;
+            continue;
+        }
+        if (*p == '*') {
+            while (*p == '*') p++;
+            r->loop_seg |= bit;
+            r->skip1 |= bit;
+            n++;
+            continue;
+        }
+        if (*p == '?') {
+            for (int c = 1; c < 256; c++) if (c != '/') r->consume[c] |= bit;
+            p++; n++;
+            continue;
+        }
+        if (*p == '[') {
+            const char* q = p + 1;
+            BOOL negate = FALSE;
+            unsigned char members[256] = {0};
+            if (*q == '!' || *q == '^') { negate = TRUE; q++; }
+            const char* first = q;
+            while (*q && (*q != ']' || q == first)) {
+                if (*q == '\\' && q[1]) q++;
+                int lo = (unsigned char)*q, hi = lo;
+                if (q[1] == '-' && q[2] && q[2] != ']') { hi = (unsigned char)q[2]; q += 2; }
+                for (int c = lo; c <= hi; c++) {
+                    members[c] = 1;
+                    members[tolower(c)] = 1;
+                    members[toupper(c)] = 1;
+                }
+                q++;
+            }
+            if (*q == ']') {
+                for (int c = 1; c < 256; c++) {
+                    if (c != '/' && members[c] != negate) r->consume[c] |= bit;
+                }
+                p = q + 1; n++;
+                continue;
+            }
+            // No closing bracket: '[' is an ordinary character
+        }
+        if (*p == '\\' && p[1]) p++;
+        unsigned char c = (unsigned char)*p;
+        r->consume[c] |= bit;
+        r->consume[(unsigned char)tolower(c)] |= bit;
+        r->consume[(unsigned char)toupper(c)] |= bit;
+        p++; n++;
+    }
+    r->accept = n;
+    return TRUE;
+}
+
+static unsigned long long ignore_closure(const IgnoreRule* r, unsigned long long s) {
+    unsigned long long prev;
+    do {
+        prev = s;
+        s |= ((s & r->skip1) << 1) | ((s & r->skip2) << 2);
+    } while (s != prev);
+    return s;
+}
+
+// The states after reading text from states s; 0 once nothing can match
+static unsigned long long ignore_rule_feed(const IgnoreRule* r, unsigned long long s, const char* text) {
+    for (const unsigned char* c = (const unsigned char*)text; *c && s; c++) {
+        unsigned long long stay = r->loop_any | (*c == '/' ? 0 : r->loop_seg);
+        s = ((s & r->consume[*c]) << 1) | (s & stay);
+        if (s) s = ignore_closure(r, s);
+    }
+    return s;
+}
+
+static BOOL ignore_rule_accepts(const IgnoreRule* r, unsigned long long s) {
+    return (s >> r->accept) & 1ULL;
+}
+
+static BOOL ignore_rule_match(const IgnoreRule* r, const char* path) {
+    return ignore_rule_accepts(r, ignore_rule_feed(r, ignore_closure(r, 1ULL), path));
+}
+
+// Parse one line of .gitignore syntax. Returns FALSE for blanks and comments.
+static BOOL ignore_parse_rule(IgnoreRule* r, const char* line) {
+    char pat[512];
+    size_t len = strlen(line);
+    while (len > 0 && (line[len-1] == '\r' || line[len-1] == '\n' || line[len-1] == ' ' || line[len-1] == '\t')) len--;
+    if (len == 0 || line[0] == '#' || len >= sizeof(pat)) return FALSE;
+    memcpy(pat, line, len);
+    pat[len] = '\0';
+
+    r->flags = 0;
+    snprintf(r->source, sizeof(r->source), "%s", pat);
+
+    char* p = pat;
+    if (*p == '!') {
+        r->flags |= IGNORE_NEGATE;
+        p++;
+    } else if (*p == '\\' && (p[1] == '!' || p[1] == '#')) {
+        p++;
+    }
+    size_t plen = strlen(p);
+    if (plen > 0 && p[plen-1] == '/') {
+        r->flags |= IGNORE_DIR_ONLY;
+        p[--plen] = '\0';
+    }
+    if (plen == 0) return FALSE;
+
+    // A slash anywhere but the end anchors the pattern; otherwise it matches at any depth
+    char glob[600];
+    if (*p == '/') {
+        snprintf(glob, sizeof(glob), "%s", p + 1);
+    } else if (strchr(p, '/')) {
+        snprintf(glob, sizeof(glob), "%s", p);
+    } else {
+        snprintf(glob, sizeof(glob), "**/%s", p);
+    }
+    return ignore_compile_glob(r, glob);
+}
+
+static void ignore_set_add(IgnoreRuleSet* set, const char* line) {
+    if (set->count == set->capacity) {
+        int cap = set->capacity ? set->capacity * 2 : 8;
+        IgnoreRule* grown = (IgnoreRule*)realloc(set->rules, cap * sizeof(IgnoreRule));
+        if (!grown) return;
+        set->rules = grown;
+        set->capacity = cap;
+    }
+    if (ignore_parse_rule(&set->rules[set->count], line)) set->count++;
+}
+
+static void ignore_set_add_text(IgnoreRuleSet* set, const char* text) {
+    char line[512];
+    while (text && *text) {
+        size_t n = strcspn(text, "\r\n");
+        if (n < sizeof(line)) {
+            memcpy(line, text, n);
+            line[n] = '\0';
+            ignore_set_add(set, line);
+        }
+        text += n;
+        while (*text == '\r' || *text == '\n') text++;
+    }
+}
+
+static void ignore_set_free(IgnoreRuleSet* set) {
+    free(set->rules);
+    memset(set, 0, sizeof(*set));
+}
+
+// Last matching rule in a set wins
+static const IgnoreRule* ignore_set_match(const IgnoreRuleSet* set, const char* rel, BOOL is_dir) {
+    for (int i = set->count - 1; i >= 0; --i) {
+        const IgnoreRule* r = &set->rules[i];
+        if ((r->flags & IGNORE_DIR_ONLY) && !is_dir) continue;
+        if (ignore_rule_match(r, rel)) return r;
+    }
+    return NULL;
+}
+
+static char* ignore_read_small_file(const char* path) {
+    FILE* f = pf_fopen(path, "rb");
+    if (!f) return NULL;
+    char* text = (char*)malloc(65536);
+    if (text) {
+        size_t n = fread(text, 1, 65535, f);
+        text[n] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+static void ignore_user_rules_path(const char* user, char* out, size_t out_sz) {
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    snprintf(out, out_sz, "%s\\data\\USERS\\%s\\Settings\\ignore.dat", program_dir, user);
+}
+
+static const IgnoreRuleSet* ignore_default_rules(void) {
+    if (!g_ignoreDefaultsReady) {
+        for (int i = 0; g_defaultIgnoreRules[i]; i++) {
+            ignore_set_add(&g_ignoreDefaults, g_defaultIgnoreRules[i]);
+        }
+        g_ignoreDefaultsReady = TRUE;
+    }
+    return &g_ignoreDefaults;
+}
+
+// Compiled rules for a user, recompiled only when their rules file changes
+static const IgnoreRuleSet* ignore_rules_for_user(const char* user) {
+    IgnoreUserRules* entry = NULL;
+    for (int i = 0; i < g_ignoreUserCount; i++) {
+        if (_stricmp(g_ignoreUsers[i].user, user) == 0) { entry = &g_ignoreUsers[i]; break; }
+    }
+    if (!entry) {
+        if (g_ignoreUserCount >= IGNORE_MAX_USERS) return NULL;
+        entry = &g_ignoreUsers[g_ignoreUserCount++];
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->user, user, sizeof(entry->user) - 1);
+    }
+
+    char path[1024];
+    ignore_user_rules_path(user, path, sizeof(path));
+    PfStat st;
+    time_t mtime = 0;
+    long size = -1;
+    if (pf_stat(path, &st)) {
+        mtime = (time_t)st.mtime;
+        size = (long)st.size;
+    }
+    if (entry->loaded && entry->mtime == mtime && entry->size == size) return &entry->set;
+
+    ignore_set_free(&entry->set);
+    if (size >= 0) {
+        char* text = ignore_read_small_file(path);
+        if (text) {
+            ignore_set_add_text(&entry->set, text);
+            free(text);
+        }
+    }
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->loaded = TRUE;
+    return &entry->set;
+}
+
+static void ignore_walk_push(IgnoreWalk* w, const IgnoreRuleSet* set, IgnoreRuleSet* owned) {
+    if (w->depth >= IGNORE_MAX_FRAMES) {
+        if (owned) { ignore_set_free(owned); free(owned); }
+        return;
+    }
+    w->sets[w->depth] = set;
+    w->owned[w->depth] = owned;
+    w->base[w->depth] = w->len ? w->len + 1 : 0;
+    w->depth++;
+}
+
+static void ignore_walk_push_user(IgnoreWalk* w, const char* user) {
+    ignore_walk_push(w, ignore_default_rules(), NULL);
+    const IgnoreRuleSet* user_rules = ignore_rules_for_user(user);
+    if (user_rules) ignore_walk_push(w, user_rules, NULL);
+}
+
+// Start a walk at a user's home. A NULL user gives a walk with no rules,
+// which is what the level above the homes uses.
+static void ignore_walk_begin(IgnoreWalk* w, const char* user) {
+    w->depth = 0;
+    w->len = 0;
+    w->path[0] = '\0';
+    if (user && *user) ignore_walk_push_user(w, user);
+}
+
+// Start a walk at any VFS directory with every rule file above it in scope
+static void ignore_walk_begin_at(IgnoreWalk* w, Directory* dir) {
+    Directory* chain[128];
+    int n = 0;
+    for (Directory* d = dir; d && d != g_root && n < 128; d = d->parent) chain[n++] = d;
+
+    ignore_walk_begin(w, NULL);
+    for (int i = n - 1; i >= 0; --i) {
+        IgnoreMark mark;
+        ignore_walk_enter_dir(w, chain[i], &mark);
+    }
+}
+
+// Give the walk its own copy of every cached rule set it borrows, so it can
+// be handed to another thread while the cache is reloaded underneath it.
+static void ignore_walk_detach(IgnoreWalk* w) {
+    for (int i = 0; i < w->depth; i++) {
+        if (w->owned[i] || w->sets[i] == &g_ignoreDefaults) continue;
+        IgnoreRuleSet* copy = (IgnoreRuleSet*)calloc(1, sizeof(IgnoreRuleSet));
+        if (!copy) continue;
+        if (w->sets[i]->count > 0) {
+            copy->rules = (IgnoreRule*)malloc(w->sets[i]->count * sizeof(IgnoreRule));
+            if (!copy->rules) { free(copy); continue; }
+            memcpy(copy->rules, w->sets[i]->rules, w->sets[i]->count * sizeof(IgnoreRule));
+            copy->count = copy->capacity = w->sets[i]->count;
+        }
+        w->sets[i] = copy;
+        w->owned[i] = copy;
+    }
+}
+
+static void ignore_walk_end(IgnoreWalk* w) {
+    IgnoreMark mark = {0, 0};
+    ignore_walk_leave(w, &mark);
+}
+
+static void ignore_walk_push_text(IgnoreWalk* w, const char* text) {
+    if (!text || !*text) return;
+    IgnoreRuleSet* set = (IgnoreRuleSet*)calloc(1, sizeof(IgnoreRuleSet));
+    if (!set) return;
+    ignore_set_add_text(set, text);
+    if (set->count == 0) {
+        ignore_set_free(set);
+        free(set);
+        return;
+    }
+    ignore_walk_push(w, set, set);
+}
+
+// Bring the .gitignore of a real directory into scope
+static void ignore_walk_push_file(IgnoreWalk* w, const char* real_dir) {
+    char path[2048];
+    snprintf(path, sizeof(path), "%s\\.gitignore", real_dir);
+    char* text = ignore_read_small_file(path);
+    if (text) {
+        ignore_walk_push_text(w, text);
+        free(text);
+    }
+}
+
+static void ignore_walk_enter(IgnoreWalk* w, const char* name, IgnoreMark* mark) {
+    mark->depth = w->depth;
+    mark->len = w->len;
+    int room = (int)sizeof(w->path) - w->len;
+    int n = snprintf(w->path + w->len, room, "%s%s", w->len ? "/" : "", name);
+    if (n > 0 && n < room) {
+        w->len += n;
+    } else {
+        w->path[w->len] = '\0';
+    }
+}
+
+// Enter a VFS directory, bringing its .gitignore into scope. Entering a
+// user's home switches to that user's rules; paths are relative to the home.
+static void ignore_walk_enter_dir(IgnoreWalk* w, Directory* dir, IgnoreMark* mark) {
+    if (dir->parent == g_root) {
+        mark->depth = w->depth;
+        mark->len = w->len;
+        ignore_walk_push_user(w, dir->name);
+    } else {
+        ignore_walk_enter(w, dir->name, mark);
+    }
+    File* gitignore = fs_find_file(dir, ".gitignore");
+    if (gitignore) ignore_walk_push_text(w, gitignore->content);
+}
 
+static void ignore_walk_leave(IgnoreWalk* w, const IgnoreMark* mark) {
+    while (w->depth > mark->depth) {
+        w->depth--;
+        if (w->owned[w->depth]) {
+            ignore_set_free(w->owned[w->depth]);
+            free(w->owned[w->depth]);
+            w->owned[w->depth] = NULL;
+        }
+    }
+    w->len = mark->len;
+    w->path[w->len] = '\0';
+}
+
+// Deepest rule file first, so a .gitignore overrides the user's rules,
+// which override the defaults
+static const IgnoreRule* ignore_walk_match(IgnoreWalk* w, const char* name, BOOL is_dir) {
+    if (!w || w->depth == 0) return NULL;
+    char full[1300];
+    snprintf(full, sizeof(full), "%s%s%s", w->path, w->len ? "/" : "", name);
+    for (int i = w->depth - 1; i >= 0; --i) {
+        const IgnoreRule* r = ignore_set_match(w->sets[i], full + w->base[i], is_dir);
+        if (r) return r;
+    }
+    return NULL;
+}
+
+static BOOL ignore_walk_check(IgnoreWalk* w, const char* name, BOOL is_dir) {
+    const IgnoreRule* r = ignore_walk_match(w, name, is_dir);
+    return r && !(r->flags & IGNORE_NEGATE);
+}
 
-static void fs_init(void) {
+void fs_init(void) {
     g_root = fs_create_dir("");
     Directory* windows = fs_create_dir("Windows");
     Directory* temp = fs_create_dir("Temp");
@@ -427,12 +1279,12 @@ static void fs_init(void) {
     // Create Public Settings folder
     char public_settings_path[1024];
     snprintf(public_settings_path, sizeof(public_settings_path), "%s\\data\\USERS\\Public\\Settings", program_dir);
-    CreateDirectoryA(public_settings_path, NULL);
+    pf_mkdir(public_settings_path);
     
     // Create Admin Settings folder
     char admin_settings_path[1024];
     snprintf(admin_settings_path, sizeof(admin_settings_path), "%s\\data\\USERS\\Admin\\Settings", program_dir);
-    CreateDirectoryA(admin_settings_path, NULL);
+    pf_mkdir(admin_settings_path);
     
     // README.txt files will be added by fs_load_from_disk() if needed
     
@@ -452,17 +1304,13 @@ static void fs_init(void) {
 
 // ---------------- Security & Authentication System ----------------
 static void generate_salt(char* salt, int length) {
-    HCRYPTPROV hProv;
-    BYTE binary_salt[32];
-    if (CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
-        if (CryptGenRandom(hProv, length, binary_salt)) {
-            // Convert to hex string
-            for (int i = 0; i < length; i++) {
-                sprintf(salt + i * 2, "%02x", binary_salt[i]);
-            }
-            salt[length * 2] = '\0';
+    unsigned char binary_salt[32];
+    if (pf_random_bytes(binary_salt, (size_t)length)) {
+        // Convert to hex string
+        for (int i = 0; i < length; i++) {
+            sprintf(salt + i * 2, "%02x", binary_salt[i]);
         }
-        CryptReleaseContext(hProv, 0);
+        salt[length * 2] = '\0';
     }
 }
 
@@ -494,7 +1342,7 @@ static BOOL verify_password(const char* password, const char* hash, const char*
     return strcmp(computed_hash, hash) == 0;
 }
 
-static void init_security_system(void) {
+void init_security_system(void) {
     // Initialize current session
     memset(&g_currentSession, 0, sizeof(g_currentSession));
     g_currentSession.is_authenticated = FALSE;
@@ -510,8 +1358,8 @@ static void init_security_system(void) {
     // Create System directory if it doesn't exist
     char system_dir[MAX_PATH];
     snprintf(system_dir, sizeof(system_dir), "%s\\data\\USERS\\Admin\\System", program_dir);
-    CreateDirectoryA(system_dir, NULL);
-    CreateDirectoryA(g_themesDir, NULL);
+    pf_mkdir(system_dir);
+    pf_mkdir(g_themesDir);
     
     // Load existing authentication data
     load_auth_data();
@@ -534,7 +1382,7 @@ static BOOL create_user_account(const char* username, const char* password, int
     // Check if user already exists
     for (int i = 0; i < g_authCount; i++) {
         if (strcmp(g_userAuth[i].username, username) == 0) {
-            gui_println("User account already exists");
+            gui_error("User account already exists");
             return FALSE;
         }
     }
@@ -568,7 +1416,7 @@ static BOOL create_user_account(const char* username, const char* password, int
 static BOOL authenticate_user(const char* username, const char* password) {
     // Check if account is locked
     if (is_account_locked(username)) {
-        gui_println("Account is locked due to too many failed attempts");
+        gui_error("Account is locked due to too many failed attempts");
         return FALSE;
     }
     
@@ -582,7 +1430,7 @@ static BOOL authenticate_user(const char* username, const char* password) {
     }
     
     if (!user || !user->is_active) {
-        gui_println("Invalid username or account disabled");
+        gui_error("Invalid username or account disabled");
         return FALSE;
     }
     
@@ -612,7 +1460,7 @@ static BOOL authenticate_user(const char* username, const char* password) {
         user->failed_attempts++;
         if (user->failed_attempts >= MAX_FAILED_ATTEMPTS) {
             lock_account(username);
-            gui_println("Account locked due to too many failed attempts");
+            gui_error("Account locked due to too many failed attempts");
         }
         
         log_security_event("LOGIN_FAILED", username, "Failed authentication attempt");
@@ -642,7 +1490,7 @@ static BOOL change_password(const char* username, const char* old_password, cons
     }
     
     if (!user) {
-        gui_println("User account not found");
+        gui_error("User account not found");
         return FALSE;
     }
     
@@ -666,7 +1514,8 @@ static BOOL change_password(const char* username, const char* old_password, cons
 }
 
 static void save_auth_data(void) {
-    FILE* f = fopen(g_authFilePath, "w");
+    if (script_defer_save(SAVE_AUTH)) return;
+    FILE* f = pf_fopen(g_authFilePath, "w");
     if (!f) return;
     
     for (int i = 0; i < g_authCount; i++) {
@@ -687,7 +1536,7 @@ static void save_auth_data(void) {
 }
 
 static void load_auth_data(void) {
-    FILE* f = fopen(g_authFilePath, "r");
+    FILE* f = pf_fopen(g_authFilePath, "r");
     if (!f) return;
     
     char line[1024];
@@ -736,37 +1585,28 @@ static void load_user_specific_auth(void) {
     snprintf(users_dir, sizeof(users_dir), "%s\\data\\USERS", program_dir);
     
     // Find all user directories
-    char search_path[1024];
-    snprintf(search_path, sizeof(search_path), "%s\\*", users_dir);
-    
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(search_path, &findData);
-    
-    if (hFind == INVALID_HANDLE_VALUE) {
+    PfDir* dir = pf_dir_open(users_dir);
+    if (!dir) {
         return;
     }
     
-    do {
-        // Skip . and .. entries
-        if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0) {
-            continue;
-        }
-        
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
         // Skip if not a directory
-        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        if (!entry.is_dir) {
             continue;
         }
         
         // Skip Admin (already loaded from System folder)
-        if (strcmp(findData.cFileName, "Admin") == 0) {
+        if (strcmp(entry.name, "Admin") == 0) {
             continue;
         }
         
         // Load authentication from user's Settings folder
         char user_auth_file[1024];
-        snprintf(user_auth_file, sizeof(user_auth_file), "%s\\%s\\Settings\\auth.dat", users_dir, findData.cFileName);
+        snprintf(user_auth_file, sizeof(user_auth_file), "%s\\%s\\Settings\\auth.dat", users_dir, entry.name);
         
-        FILE* f = fopen(user_auth_file, "r");
+        FILE* f = pf_fopen(user_auth_file, "r");
         if (f) {
             char line[1024];
             while (fgets(line, sizeof(line), f) && g_authCount < MAX_SESSIONS) {
@@ -800,9 +1640,9 @@ static void load_user_specific_auth(void) {
             fclose(f);
         }
         
-    } while (FindNextFileA(hFind, &findData));
+    }
     
-    FindClose(hFind);
+    pf_dir_close(dir);
 }
 
 static void log_security_event(const char* event, const char* username, const char* details) {
@@ -814,9 +1654,9 @@ static void log_security_event(const char* event, const char* username, const ch
     // Create logs directory if it doesn't exist
     char logs_dir[MAX_PATH];
     snprintf(logs_dir, sizeof(logs_dir), "%s\\data\\USERS\\Admin\\System\\logs", program_dir);
-    CreateDirectoryA(logs_dir, NULL);
+    pf_mkdir(logs_dir);
     
-    FILE* f = fopen(log_file, "a");
+    FILE* f = pf_fopen(log_file, "a");
     if (f) {
         time_t now = time(NULL);
         struct tm* tm_info = localtime(&now);
@@ -917,7 +1757,7 @@ static void init_default_themes(void) {
     g_themeCount = 3;
 }
 
-static void init_theme_system(void) {
+void init_theme_system(void) {
     // Initialize default themes
     init_default_themes();
     
@@ -930,6 +1770,12 @@ static void init_theme_system(void) {
     g_settings.show_hidden_files = FALSE;
     strcpy(g_settings.default_editor, "notepad");
     g_settings.max_history_size = 100;
+    g_settings.scrollback_lines = SCROLLBACK_DEFAULT;
+    g_settings.python_worker = FALSE;
+    g_settings.job_time_limit = 0;
+    g_settings.job_cpu_limit = 0;
+    g_settings.job_memory_limit = 0;
+    g_settings.job_output_limit = 0;
     g_settings.sound_enabled = TRUE;
     g_settings.window_width = 800;
     g_settings.window_height = 600;
@@ -943,7 +1789,7 @@ static void init_theme_system(void) {
 }
 
 static void load_settings(void) {
-    FILE* f = fopen(g_settingsFilePath, "r");
+    FILE* f = pf_fopen(g_settingsFilePath, "r");
     if (!f) return;
     
     char line[256];
@@ -966,6 +1812,14 @@ static void load_settings(void) {
                 strncpy(g_settings.default_editor, value, sizeof(g_settings.default_editor) - 1);
             } else if (strcmp(key, "max_history_size") == 0) {
                 g_settings.max_history_size = atoi(value);
+            } else if (strcmp(key, "scrollback_lines") == 0) {
+                int lines = atoi(value);
+                if (lines >= SCROLLBACK_MIN && lines <= SCROLLBACK_MAX) g_settings.scrollback_lines = lines;
+            } else if (strcmp(key, "python_worker") == 0) {
+                g_settings.python_worker = atoi(value) != 0;
+            } else if (job_limit_setting(key)) {
+                int limit = atoi(value);
+                if (limit >= 0 && limit <= job_limit_max(key)) *job_limit_setting(key) = limit;
             } else if (strcmp(key, "sound_enabled") == 0) {
                 g_settings.sound_enabled = atoi(value) != 0;
             } else if (strcmp(key, "window_width") == 0) {
@@ -988,7 +1842,8 @@ static void load_settings(void) {
 }
 
 static void save_settings(void) {
-    FILE* f = fopen(g_settingsFilePath, "w");
+    if (script_defer_save(SAVE_SETTINGS)) return;
+    FILE* f = pf_fopen(g_settingsFilePath, "w");
     if (!f) return;
     
     fprintf(f, "current_theme=%s\n", g_settings.current_theme);
@@ -999,6 +1854,12 @@ static void save_settings(void) {
     fprintf(f, "show_hidden_files=%d\n", g_settings.show_hidden_files ? 1 : 0);
     fprintf(f, "default_editor=%s\n", g_settings.default_editor);
     fprintf(f, "max_history_size=%d\n", g_settings.max_history_size);
+    fprintf(f, "scrollback_lines=%d\n", g_settings.scrollback_lines);
+    fprintf(f, "python_worker=%d\n", g_settings.python_worker ? 1 : 0);
+    fprintf(f, "job_time_limit=%d\n", g_settings.job_time_limit);
+    fprintf(f, "job_cpu_limit=%d\n", g_settings.job_cpu_limit);
+    fprintf(f, "job_memory_limit=%d\n", g_settings.job_memory_limit);
+    fprintf(f, "job_output_limit=%d\n", g_settings.job_output_limit);
     fprintf(f, "sound_enabled=%d\n", g_settings.sound_enabled ? 1 : 0);
     fprintf(f, "window_width=%d\n", g_settings.window_width);
     fprintf(f, "window_height=%d\n", g_settings.window_height);
@@ -1010,8 +1871,8 @@ static void save_settings(void) {
     fclose(f);
 }
 
-static void apply_theme(const char* theme_name) {
-    apply_theme_silent(theme_name, FALSE);
+void apply_theme(const char* theme_name) {
+    apply_theme_silent(theme_name ? theme_name : g_settings.current_theme, FALSE);
 }
 
 static void apply_theme_silent(const char* theme_name, BOOL show_message) {
@@ -1030,31 +1891,227 @@ static void apply_theme_silent(const char* theme_name, BOOL show_message) {
         }
     }
     if (show_message) {
-        gui_println("Theme not found");
+        gui_error("Theme not found");
+    }
+}
+
+// Before the settings file is read the default applies
+int settings_scrollback_lines(void) {
+    return g_settings.scrollback_lines > 0 ? g_settings.scrollback_lines : SCROLLBACK_DEFAULT;
+}
+
+// Current theme colours for the front end; a custom text colour wins
+void theme_current_colors(COLORREF* text, COLORREF* bg) {
+    *text = RGB(0,255,0);  // Default green
+    *bg = RGB(0,0,0);      // Default black
+    for (int i = 0; i < g_themeCount; i++) {
+        if (strcmp(g_themes[i].name, g_settings.current_theme) == 0) {
+            *text = g_themes[i].text_color;
+            *bg = g_themes[i].bg_color;
+            break;
+        }
+    }
+    if (g_settings.custom_text_color != 0) {
+        *text = g_settings.custom_text_color;
+    }
+}
+
+// ---------------- Output ----------------
+static const OutputSink* g_sink = NULL;
+
+void engine_set_sink(const OutputSink* sink) {
+    g_sink = sink;
+}
+
+// ---- Streams ----
+// While a pipeline stage runs, its output goes into a stream instead of the
+// sink: a list of chunks the next stage reads in place. Lines are stored
+// '\0'-terminated ("\r\n" dropped) and never straddle two chunks, so a reader
+// gets each line as a C string pointing straight into the chunk.
+#define STREAM_CHUNK_SIZE 4096
+
+typedef struct StreamChunk {
+    struct StreamChunk* next;
+    size_t len;
+    size_t line_start;                    // where the unfinished line begins
+    char data[STREAM_CHUNK_SIZE + 1];     // +1: room to end an overlong line
+} StreamChunk;
+
+typedef struct {
+    StreamChunk* head;
+    StreamChunk* tail;
+    size_t size;                          // bytes, counting one per line end
+    int lines;
+} Stream;
+
+typedef struct {
+    const StreamChunk* chunk;
+    size_t pos;
+} StreamReader;
+
+static Stream* g_outStream = NULL;        // the running stage's output, NULL: the sink
+static Stream* g_inStream = NULL;         // the previous stage's output
+
+static BOOL stream_grow(Stream* s) {
+    StreamChunk* c = (StreamChunk*)malloc(sizeof(StreamChunk));
+    if (!c) return FALSE;
+    c->next = NULL;
+    c->len = 0;
+    c->line_start = 0;
+    StreamChunk* tail = s->tail;
+    if (tail && tail->line_start < tail->len) {
+        if (tail->line_start > 0) {
+            // Carry the unfinished line over so it stays in one piece
+            c->len = tail->len - tail->line_start;
+            memcpy(c->data, tail->data + tail->line_start, c->len);
+            tail->len = tail->line_start;
+        } else {
+            // One line longer than a chunk: end it here
+            tail->data[tail->len++] = '\0';
+            tail->line_start = tail->len;
+            s->size++;
+            s->lines++;
+        }
+    }
+    if (tail) tail->next = c; else s->head = c;
+    s->tail = c;
+    return TRUE;
+}
+
+static void stream_write(Stream* s, const char* text) {
+    while (*text) {
+        size_t n = strcspn(text, "\r\n");
+        while (n > 0) {
+            if (!s->tail || s->tail->len == STREAM_CHUNK_SIZE) {
+                if (!stream_grow(s)) return;
+            }
+            StreamChunk* c = s->tail;
+            size_t room = STREAM_CHUNK_SIZE - c->len;
+            size_t take = n < room ? n : room;
+            memcpy(c->data + c->len, text, take);
+            c->len += take;
+            s->size += take;
+            text += take;
+            n -= take;
+        }
+        if (*text == '\n') {
+            if (!s->tail || s->tail->len == STREAM_CHUNK_SIZE) {
+                if (!stream_grow(s)) return;
+            }
+            s->tail->data[s->tail->len++] = '\0';
+            s->tail->line_start = s->tail->len;
+            s->size++;
+            s->lines++;
+        }
+        if (*text) text++;
+    }
+}
+
+// Ends a last line that had no line break
+static void stream_finish(Stream* s) {
+    if (s->tail && s->tail->line_start < s->tail->len) stream_write(s, "\n");
+}
+
+static void stream_free(Stream* s) {
+    StreamChunk* c = s->head;
+    while (c) {
+        StreamChunk* next = c->next;
+        free(c);
+        c = next;
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+static void stream_reader_init(StreamReader* r, const Stream* s) {
+    r->chunk = s->head;
+    r->pos = 0;
+}
+
+// The next line, or NULL at the end; valid while the stream lives
+static const char* stream_next_line(StreamReader* r) {
+    while (r->chunk && r->pos >= r->chunk->line_start) {
+        r->chunk = r->chunk->next;
+        r->pos = 0;
     }
+    if (!r->chunk) return NULL;
+    const char* line = r->chunk->data + r->pos;
+    r->pos += strlen(line) + 1;
+    return line;
 }
 
-// ---------------- GUI helpers ----------------
-static HWND g_hOut = NULL;
+// ---- Output buffer ----
+// While a command runs its output collects here and reaches the sink in one
+// write when the command ends, so the window pays one edit-control update
+// per command instead of two per line. Commands that stream for a while
+// (git clone, npm install) are flushed once a frame.
+#define OUTPUT_FRAME_MS 16
+#define OUTPUT_BUFFER_MAX (256 * 1024)
 
-// Scroll functionality (using built-in edit control scrolling)
-static HFONT g_hMono = NULL;
-static HBRUSH g_hbrBlack = NULL;
-static WNDPROC g_OutputPrevProc = NULL;
-static int g_inputStart = 0;
+static char* g_outBuf = NULL;
+static size_t g_outLen = 0;
+static size_t g_outCap = 0;
+static unsigned long g_outSince = 0;      // when the oldest buffered byte arrived
+static unsigned int g_outWrites = 0;      // appends since then
+static int g_commandDepth = 0;            // process_command calls in progress
+static BOOL g_outputBuffered = TRUE;      // FILEVIEW BENCH turns it off to compare
+static BOOL g_promptArmed = FALSE;        // the prompt is up, waiting for a command
+static BOOL g_jobWakeDeferred = FALSE;    // a job wake came while EDITCODE had the window
+static int g_jobTickers = 0;              // gui_job_begin calls not yet ended
+
+void gui_flush(void) {
+    if (g_outLen == 0) return;
+    g_outBuf[g_outLen] = '\0';
+    g_outLen = 0;
+    if (g_sink && g_sink->write) g_sink->write(g_outBuf);
+}
+
+// Everything printed so far, through the front end too, before a child
+// writes to the same stream
+static void output_sync(void) {
+    gui_flush();
+    if (g_sink && g_sink->flush) g_sink->flush();
+}
+
+static BOOL output_buffer(const char* text) {
+    size_t n = strlen(text);
+    if (g_outLen + n + 1 > g_outCap) {
+        size_t cap = g_outCap ? g_outCap : 4096;
+        while (cap < g_outLen + n + 1) cap *= 2;
+        char* bigger = (char*)realloc(g_outBuf, cap);
+        if (!bigger) return FALSE;
+        g_outBuf = bigger;
+        g_outCap = cap;
+    }
+    if (g_outLen == 0) {
+        g_outSince = pf_ticks_ms();
+        g_outWrites = 0;
+    }
+    memcpy(g_outBuf + g_outLen, text, n);
+    g_outLen += n;
+    // Reading the clock costs more than the copy; a frame is plenty of appends
+    if (g_outLen >= OUTPUT_BUFFER_MAX ||
+        (++g_outWrites % 64 == 0 && pf_ticks_ms() - g_outSince >= OUTPUT_FRAME_MS)) {
+        gui_flush();
+    }
+    return TRUE;
+}
 
-static void gui_append(const char* text) {
-    int len = GetWindowTextLengthA(g_hOut);
-    SendMessageA(g_hOut, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-    SendMessageA(g_hOut, EM_REPLACESEL, FALSE, (LPARAM)text);
+void gui_append(const char* text) {
+    if (g_outStream) {
+        stream_write(g_outStream, text);
+        return;
+    }
+    if (g_commandDepth > 0 && g_outputBuffered && output_buffer(text)) return;
+    gui_flush();
+    if (g_sink && g_sink->write) g_sink->write(text);
 }
 
-static void gui_println(const char* text) {
+void gui_println(const char* text) {
     gui_append(text);
     gui_append("\r\n");
 }
 
-static void gui_printf(const char* format, ...) {
+void gui_printf(const char* format, ...) {
     char buffer[1024];
     va_list args;
     va_start(args, format);
@@ -1063,7 +2120,75 @@ static void gui_printf(const char* format, ...) {
     gui_println(buffer);
 }
 
-static void gui_print_prompt(void) {
+// For a command that could not do what it was asked. The line prints like
+// any other and marks the command failed, which stops a SOURCE script and
+// gives nexus-cli --script its exit status.
+static void gui_error(const char* text) {
+    script_note_error(text);
+    gui_println(text);
+}
+
+static void gui_errorf(const char* format, ...) {
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    gui_error(buffer);
+}
+
+// Screen effects have nothing to act on while output is captured; otherwise
+// buffered text goes out first so it lands in order
+void gui_clear(void) {
+    if (g_outStream) return;
+    g_outLen = 0;
+    if (g_sink && g_sink->clear) g_sink->clear();
+}
+
+void gui_show_prompt_and_arm_input(void) {
+    if (g_outStream) return;
+    // Job output held back for the editor can be shown now
+    if (g_jobWakeDeferred) {
+        g_jobWakeDeferred = FALSE;
+        gui_job_wake();
+    }
+    gui_flush();
+    if (g_sink && g_sink->prompt) g_sink->prompt();
+    g_promptArmed = TRUE;
+}
+
+void gui_refresh(void) {
+    gui_flush();
+    if (g_sink && g_sink->refresh) g_sink->refresh();
+}
+
+void gui_status_line(const char* text) {
+    if (g_outStream) return;
+    gui_flush();
+    if (g_sink && g_sink->status_line) g_sink->status_line(text);
+}
+
+// A job started while output is captured runs inline, so its results land
+// in the stream before the next stage reads it. A sync and several jobs
+// share the front end's ticker: it stops when the last of them ends.
+BOOL gui_job_begin(void) {
+    if (g_outStream) return FALSE;
+    if (!g_sink || !g_sink->job_begin || !g_sink->job_begin()) return FALSE;
+    g_jobTickers++;
+    return TRUE;
+}
+
+void gui_job_end(void) {
+    if (g_jobTickers > 0 && --g_jobTickers > 0) return;
+    if (g_sink && g_sink->job_end) g_sink->job_end();
+}
+
+void gui_job_wake(void) {
+    if (g_sink && g_sink->job_wake) g_sink->job_wake();
+}
+
+// ---------------- Prompt ----------------
+void gui_print_prompt(void) {
     char path[1024];
     fs_print_path(g_cwd, path, sizeof(path));
     char prompt[1200];
@@ -1071,16 +2196,39 @@ static void gui_print_prompt(void) {
     gui_append(prompt);
 }
 
-static void gui_clear(void) {
-    SetWindowTextA(g_hOut, "");
-}
-
-static void gui_show_prompt_and_arm_input(void) {
-    gui_print_prompt();
-    g_inputStart = GetWindowTextLengthA(g_hOut);
-    SendMessageA(g_hOut, EM_SETSEL, (WPARAM)g_inputStart, (LPARAM)g_inputStart);
-    SetFocus(g_hOut);
-    
+// filesystem.dat keeps one file per line, so '|', line breaks and (from
+// version 2 on) backslashes are escaped. Version 1 files left backslashes
+// alone, which turned a literal "\n" in source code into a line break.
+static void fs_escape_content(const char* src, char* dst, size_t dst_sz) {
+    size_t j = 0;
+    for (; *src && j + 2 < dst_sz; src++) {
+        switch (*src) {
+            case '|':  dst[j++] = '\\'; dst[j++] = '|'; break;
+            case '\n': dst[j++] = '\\'; dst[j++] = 'n'; break;
+            case '\r': dst[j++] = '\\'; dst[j++] = 'r'; break;
+            case '\\': dst[j++] = '\\'; dst[j++] = '\\'; break;
+            default:   dst[j++] = *src; break;
+        }
+    }
+    dst[j] = '\0';
+}
+
+static void fs_unescape_content(const char* src, char* dst, size_t dst_sz, int version) {
+    size_t j = 0;
+    while (*src && j + 1 < dst_sz) {
+        if (src[0] == '\\' && src[1] == '|') {
+            dst[j++] = '|'; src += 2;
+        } else if (src[0] == '\\' && src[1] == 'n') {
+            dst[j++] = '\n'; src += 2;
+        } else if (src[0] == '\\' && src[1] == 'r') {
+            dst[j++] = '\r'; src += 2;
+        } else if (version >= 2 && src[0] == '\\' && src[1] == '\\') {
+            dst[j++] = '\\'; src += 2;
+        } else {
+            dst[j++] = *src++;
+        }
+    }
+    dst[j] = '\0';
 }
 
 // Load filesystem from disk
@@ -1093,9 +2241,9 @@ static void fs_load_from_disk(void) {
     // Ensure the data directory exists
     char data_dir[1024];
     snprintf(data_dir, sizeof(data_dir), "%s\\data", program_dir);
-    CreateDirectoryA(data_dir, NULL);
+    pf_mkdir(data_dir);
     
-    FILE* f = fopen(fs_file, "r");
+    FILE* f = pf_fopen(fs_file, "r");
     if (!f) {
         // No saved filesystem found, using initialized filesystem
         // Add README.txt files to users if they don't exist
@@ -1124,9 +2272,12 @@ static void fs_load_from_disk(void) {
     }
     
     // Loading saved filesystem silently
+    g_fsLoadedFromDisk = TRUE;
     
-    char line[1024];
+    // Escaped content can be twice MAX_FILE_SIZE
+    static char line[MAX_FILE_SIZE * 2 + MAX_NAME + 16];
     Directory* current_dir = g_root;
+    int version = 1;
     
     while (fgets(line, sizeof(line), f)) {
         // Remove newline
@@ -1134,7 +2285,9 @@ static void fs_load_from_disk(void) {
         
         if (strlen(line) == 0) continue;
         
-        if (strncmp(line, "DIR:", 4) == 0) {
+        if (strncmp(line, "VERSION:", 8) == 0) {
+            version = atoi(line + 8);
+        } else if (strncmp(line, "DIR:", 4) == 0) {
             // Directory entry: DIR:path
             char* path = line + 4;
             if (strcmp(path, "C:\\USERS") == 0) {
@@ -1147,7 +2300,13 @@ static void fs_load_from_disk(void) {
                     if (strcmp(token, "USERS") == 0) {
                         // Skip USERS, it's the root
                     } else {
-                        current_dir = fs_find_child(current_dir, token);
+                        // Recreate directories that are not part of the default layout
+                        Directory* next = fs_find_child(current_dir, token);
+                        if (!next && current_dir->child_count < MAX_CHILDREN) {
+                            next = fs_create_dir(token);
+                            if (next) fs_add_child(current_dir, next);
+                        }
+                        current_dir = next;
                     }
                     token = strtok(NULL, "\\");
                 }
@@ -1161,27 +2320,10 @@ static void fs_load_from_disk(void) {
                 char* filename = file_info;
                 char* content = pipe_pos + 1;
                 
-                if (current_dir) {
+                if (current_dir && !fs_find_file(current_dir, filename)) {
                     File* f = fs_create_file(filename);
                     if (f) {
-                        // Unescape content
-                        char* src = content;
-                        char* dst = f->content;
-                        while (*src && (dst - f->content) < sizeof(f->content) - 1) {
-                            if (*src == '\\' && *(src + 1) == '|') {
-                                *dst++ = '|';
-                                src += 2;
-                            } else if (*src == '\\' && *(src + 1) == 'n') {
-                                *dst++ = '\n';
-                                src += 2;
-                            } else if (*src == '\\' && *(src + 1) == 'r') {
-                                *dst++ = '\r';
-                                src += 2;
-                            } else {
-                                *dst++ = *src++;
-                            }
-                        }
-                        *dst = '\0';
+                        fs_unescape_content(content, f->content, sizeof(f->content), version);
                         fs_add_file(current_dir, f);
                     }
                 }
@@ -1198,7 +2340,8 @@ static void fs_load_from_disk(void) {
 }
 
 // Save filesystem to disk
-static void fs_save_to_disk(void) {
+void fs_save_to_disk(void) {
+    if (script_defer_save(SAVE_FS)) return;
     char fs_file[1024];
     char program_dir[1024];
     get_main_project_dir(program_dir, sizeof(program_dir));
@@ -1207,18 +2350,23 @@ static void fs_save_to_disk(void) {
     // Ensure the data directory exists
     char data_dir[1024];
     snprintf(data_dir, sizeof(data_dir), "%s\\data", program_dir);
-    CreateDirectoryA(data_dir, NULL);
+    pf_mkdir(data_dir);
     
-    FILE* f = fopen(fs_file, "w");
+    FILE* f = pf_fopen(fs_file, "w");
     if (!f) {
-        gui_println("Failed to save filesystem");
+        gui_error("Failed to save filesystem");
         return;
     }
     
-    // Save the filesystem structure
-    save_filesystem_recursive(g_root, f, "C:\\USERS");
+    // Save the filesystem structure, leaving out ignored subtrees
+    fprintf(f, "VERSION:%d\n", FS_FORMAT_VERSION);
+    IgnoreWalk walk;
+    ignore_walk_begin(&walk, NULL);
+    save_filesystem_recursive(g_root, f, "C:\\USERS", &walk);
+    ignore_walk_end(&walk);
     
     fclose(f);
+    search_index_save();
     
 }
 
@@ -1230,41 +2378,31 @@ static void load_users_from_realfilesystem(void) {
     snprintf(users_dir, sizeof(users_dir), "%s\\data\\USERS", program_dir);
     
     // Check if USERS directory exists
-    DWORD attrs = GetFileAttributesA(users_dir);
-    if (attrs == INVALID_FILE_ATTRIBUTES || !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+    if (pf_path_kind(users_dir) != PF_PATH_DIR) {
         return; // No USERS directory
     }
     
     // Find all subdirectories in USERS (these are user directories)
-    char search_path[1024];
-    snprintf(search_path, sizeof(search_path), "%s\\*", users_dir);
-    
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(search_path, &findData);
-    
-    if (hFind == INVALID_HANDLE_VALUE) {
+    PfDir* dir = pf_dir_open(users_dir);
+    if (!dir) {
         return;
     }
     
-    do {
-        // Skip . and .. entries
-        if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0) {
-            continue;
-        }
-        
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
         // Skip if not a directory
-        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        if (!entry.is_dir) {
             continue;
         }
         
         // Check if this user already exists in virtual filesystem
-        Directory* existing_user = fs_find_child(g_root, findData.cFileName);
+        Directory* existing_user = fs_find_child(g_root, entry.name);
         if (existing_user) {
             continue; // User already exists
         }
         
         // Create new user directory in virtual filesystem
-        Directory* new_user = fs_create_dir(findData.cFileName);
+        Directory* new_user = fs_create_dir(entry.name);
         if (!new_user) {
             continue;
         }
@@ -1296,3253 +2434,8046 @@ static void load_users_from_realfilesystem(void) {
                 "- WRITE <file> <text> - Write to file\n"
                 "- EDITCODE <file> - Interactive code editor\n"
                 "- TYPE <file> - View file contents\n"
-                "- And many more! Type HELP for full list.", findData.cFileName);
+                "- And many more! Type HELP for full list.", entry.name);
             
             fs_add_file(new_user, readme);
         }
         
-    } while (FindNextFileA(hFind, &findData));
+    }
     
-    FindClose(hFind);
+    pf_dir_close(dir);
 }
 
-static void sync_all_directories(void) {
+// ---------------- Sync engine ----------------
+// Three-way sync between the VFS and data\USERS. Every synced file keeps a
+// base: the content both sides last agreed on. Comparing each side's hash
+// with the base tells which side changed, so edits flow in both directions
+// and only edits made on both sides are reported as conflicts.
+static unsigned long long sync_hash(const char* text) {
+    return hash64(text, strlen(text));
+}
+
+// Paths compare case-insensitively, like the VFS
+static unsigned long long sync_path_hash(const char* path) {
+    unsigned long long h = 1469598103934665603ULL;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        h ^= (unsigned char)tolower(*p);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void sync_base_file_path(char* out, size_t out_sz) {
     char program_dir[1024];
     get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char users_dir[1024];
-    snprintf(users_dir, sizeof(users_dir), "%s\\data\\USERS", program_dir);
-    
-    // Check if USERS directory exists
-    DWORD attrs = GetFileAttributesA(users_dir);
-    if (attrs == INVALID_FILE_ATTRIBUTES || !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
-        return; // No USERS directory
-    }
-    
-    // Sync each user directory
-    for (int i = 0; i < g_root->child_count; i++) {
-        Directory* user_dir = g_root->children[i];
-        if (!user_dir) continue;
-        
-        char user_real_path[1024];
-        snprintf(user_real_path, sizeof(user_real_path), "%s\\%s", users_dir, user_dir->name);
-        
-        // Ensure preset directories exist in real filesystem
-        char docs_path[1024], desktop_path[1024], downloads_path[1024], settings_path[1024];
-        snprintf(docs_path, sizeof(docs_path), "%s\\Documents", user_real_path);
-        snprintf(desktop_path, sizeof(desktop_path), "%s\\Desktop", user_real_path);
-        snprintf(downloads_path, sizeof(downloads_path), "%s\\Downloads", user_real_path);
-        snprintf(settings_path, sizeof(settings_path), "%s\\Settings", user_real_path);
-        
-        CreateDirectoryA(docs_path, NULL);
-        CreateDirectoryA(desktop_path, NULL);
-        CreateDirectoryA(downloads_path, NULL);
-        CreateDirectoryA(settings_path, NULL);
-        
-        // Check if the real user directory exists
-        DWORD user_attrs = GetFileAttributesA(user_real_path);
-        if (user_attrs != INVALID_FILE_ATTRIBUTES && (user_attrs & FILE_ATTRIBUTE_DIRECTORY)) {
-            // Sync this user's directory recursively
-            sync_directory_recursive(user_dir, user_real_path);
+    snprintf(out, out_sz, "%s\\data\\sync_base.dat", program_dir);
+}
+
+static SyncBase* sync_base_find(const char* path) {
+    SyncBase* b = g_syncBase[sync_path_hash(path) & (SYNC_BASE_BUCKETS - 1)];
+    while (b && _stricmp(b->path, path) != 0) b = b->next;
+    return b;
+}
+
+// A NULL content records a directory
+static void sync_base_set(const char* path, const char* content) {
+    SyncBase* b = sync_base_find(path);
+    if (b) {
+        if (!b->content && !content) return;
+        if (b->content && content && strcmp(b->content, content) == 0) return;
+        free(b->content);
+    } else {
+        b = (SyncBase*)calloc(1, sizeof(SyncBase));
+        if (!b) return;
+        b->path = _strdup(path);
+        int bucket = (int)(sync_path_hash(path) & (SYNC_BASE_BUCKETS - 1));
+        b->next = g_syncBase[bucket];
+        g_syncBase[bucket] = b;
+    }
+    b->content = content ? _strdup(content) : NULL;
+    b->hash = content ? sync_hash(content) : 0;
+    g_syncBaseDirty = TRUE;
+}
+
+static void sync_base_remove(const char* path) {
+    SyncBase** link = &g_syncBase[sync_path_hash(path) & (SYNC_BASE_BUCKETS - 1)];
+    while (*link) {
+        if (_stricmp((*link)->path, path) == 0) {
+            SyncBase* gone = *link;
+            *link = gone->next;
+            free(gone->path);
+            free(gone->content);
+            free(gone);
+            g_syncBaseDirty = TRUE;
+            return;
         }
+        link = &(*link)->next;
     }
-    
-    // Auto-sync completed silently
 }
 
-static void sync_directory_recursive(Directory* virtual_dir, const char* real_path) {
-    if (!virtual_dir || !real_path) return;
-    
-    // Scan the real directory for files and subdirectories
-    char search_path[2048];
-    snprintf(search_path, sizeof(search_path), "%s\\*", real_path);
-    
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(search_path, &findData);
-    
-    if (hFind == INVALID_HANDLE_VALUE) {
+// Bases are only meaningful next to the filesystem.dat they were saved with;
+// without it every base would read as "deleted in the VFS".
+static void sync_base_load(void) {
+    if (g_syncBaseLoaded) return;
+    g_syncBaseLoaded = TRUE;
+    if (!g_fsLoadedFromDisk) return;
+
+    char path[1024];
+    sync_base_file_path(path, sizeof(path));
+    FILE* f = pf_fopen(path, "r");
+    if (!f) {
+        g_syncBaseFresh = TRUE;
         return;
     }
-    
-    do {
-        // Skip . and .. entries
-        if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0) {
-            continue;
-        }
-        
-        // Check if it's a directory
-        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            // Check if this directory exists in virtual filesystem
-            Directory* existing = fs_find_child(virtual_dir, findData.cFileName);
-            if (!existing) {
-                // Create the directory in virtual filesystem
-                Directory* new_dir = fs_create_dir(findData.cFileName);
-                if (new_dir) {
-                    fs_add_child(virtual_dir, new_dir);
-                }
-                existing = new_dir;
-            }
-            
-            // Recursively sync this subdirectory
-            if (existing) {
-                char subdir_real_path[2048];
-                snprintf(subdir_real_path, sizeof(subdir_real_path), "%s\\%s", real_path, findData.cFileName);
-                sync_directory_recursive(existing, subdir_real_path);
-            }
-        } else {
-            // It's a file - check if this file exists in virtual filesystem
-            File* existing_file = fs_find_file(virtual_dir, findData.cFileName);
-            if (!existing_file) {
-                // Read the file content from real filesystem
-                char full_path[2048];
-                snprintf(full_path, sizeof(full_path), "%s\\%s", real_path, findData.cFileName);
-                
-                HANDLE hFile = CreateFileA(full_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-                if (hFile != INVALID_HANDLE_VALUE) {
-                    DWORD fileSize = GetFileSize(hFile, NULL);
-                    if (fileSize >= 0 && fileSize < 10240) { // Read files including empty ones, but smaller than 10KB
-                        char* content = (char*)malloc(fileSize + 1);
-                        if (content) {
-                            DWORD bytesRead;
-                            if (ReadFile(hFile, content, fileSize, &bytesRead, NULL)) {
-                                content[bytesRead] = '\0';
-                                
-                                // Create the file in virtual filesystem
-                                File* new_file = fs_create_file(findData.cFileName);
-                                if (new_file) {
-                                    strncpy(new_file->content, content, MAX_FILE_SIZE - 1);
-                                    new_file->content[MAX_FILE_SIZE - 1] = '\0';
-                                    fs_add_file(virtual_dir, new_file);
-                                }
-                            }
-                            free(content);
-                        }
-                    }
-                    CloseHandle(hFile);
-                }
-            }
+
+    static char line[MAX_FILE_SIZE * 2 + 1200];
+    static char content[MAX_FILE_SIZE];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, "BASE:", 5) == 0) {
+            char* sep = strchr(line + 5, '|');
+            if (!sep) continue;
+            *sep = '\0';
+            fs_unescape_content(sep + 1, content, sizeof(content), FS_FORMAT_VERSION);
+            sync_base_set(line + 5, content);
+        } else if (strncmp(line, "BASEDIR:", 8) == 0) {
+            sync_base_set(line + 8, NULL);
         }
-    } while (FindNextFileA(hFind, &findData));
-    
-    FindClose(hFind);
+    }
+    fclose(f);
+    g_syncBaseDirty = FALSE;
 }
 
-// Helper function to recursively save filesystem
-static void save_filesystem_recursive(Directory* dir, FILE* f, const char* path) {
-    if (!dir || !f) return;
-    
-    // Save current directory
-    fprintf(f, "DIR:%s\n", path);
-    
-    // Save files in this directory
-    for (int i = 0; i < dir->file_count; ++i) {
-        if (dir->files[i]) {
-            // Escape pipe characters in content
-            char escaped_content[2048];
-            char* src = dir->files[i]->content;
-            char* dst = escaped_content;
-            while (*src && (dst - escaped_content) < sizeof(escaped_content) - 1) {
-                if (*src == '|') {
-                    *dst++ = '\\';
-                    *dst++ = '|';
-                } else if (*src == '\n') {
-                    *dst++ = '\\';
-                    *dst++ = 'n';
-                } else if (*src == '\r') {
-                    *dst++ = '\\';
-                    *dst++ = 'r';
-                } else {
-                    *dst++ = *src;
-                }
-                src++;
+static void sync_base_save(void) {
+    if (!g_syncBaseDirty) return;
+    if (script_defer_save(SAVE_SYNC)) return;
+    char path[1024];
+    sync_base_file_path(path, sizeof(path));
+    FILE* f = pf_fopen(path, "w");
+    if (!f) return;
+
+    static char escaped[MAX_FILE_SIZE * 2 + 1];
+    for (int i = 0; i < SYNC_BASE_BUCKETS; i++) {
+        for (SyncBase* b = g_syncBase[i]; b; b = b->next) {
+            if (b->content) {
+                fs_escape_content(b->content, escaped, sizeof(escaped));
+                fprintf(f, "BASE:%s|%s\n", b->path, escaped);
+            } else {
+                fprintf(f, "BASEDIR:%s\n", b->path);
             }
-            *dst = '\0';
-            
-            fprintf(f, "FILE:%s|%s\n", dir->files[i]->name, escaped_content);
         }
     }
-    
-    // Recursively save subdirectories
-    for (int i = 0; i < dir->child_count; ++i) {
-        if (dir->children[i]) {
-            char new_path[1024];
-            snprintf(new_path, sizeof(new_path), "%s\\%s", path, dir->children[i]->name);
-            save_filesystem_recursive(dir->children[i], f, new_path);
+    fclose(f);
+    g_syncBaseDirty = FALSE;
+}
+
+// Path of a VFS directory relative to C:\USERS (and so to data\USERS)
+static void vfs_rel_path(Directory* dir, char* out, size_t out_sz) {
+    char tmp[1024] = {0};
+    for (Directory* cur = dir; cur && cur != g_root; cur = cur->parent) {
+        char buf[1024];
+        if (tmp[0]) {
+            snprintf(buf, sizeof(buf), "%s\\%s", cur->name, tmp);
+        } else {
+            snprintf(buf, sizeof(buf), "%s", cur->name);
         }
+        strncpy(tmp, buf, sizeof(tmp) - 1);
     }
+    snprintf(out, out_sz, "%s", tmp);
 }
 
-// ---------------- Command processing ----------------
-static void cmd_help(void) {
-    gui_println("Commands:");
-    gui_println("  DIR, LS               List directory contents");
-    gui_println("  CD <dir>|..|~         Change directory");
-    gui_println("  MKDIR <name>          Create directory");
-    gui_println("  RMDIR <name>          Remove empty directory");
-    gui_println("  TOUCH <name>          Create empty file");
-    gui_println("  DEL <name>            Delete file (permanent)");
-    gui_println("  SOFTDEL <name>        Soft delete (terminal only)");
-    gui_println("  SOFTDEL /F <name>     Force delete (both terminal and File Explorer)");
-    gui_println("  RESTORE <name>        Restore from trash");
-    gui_println("  TRASH                 Show trash contents");
-    gui_println("  EMPTYTRASH            Permanently delete trash");
-    gui_println("  TYPE <file>           Show file contents");
-    gui_println("  WRITE <file> <text>   Replace file content with text");
-    gui_println("  WRITELN <file> <text> Write text with line breaks (use \\n)");
-    gui_println("  WRITECODE <file> <code> Write code with formatting (use \\n, \\t)");
-    gui_println("  EDITCODE <file> Interactive code editor (Ctrl+S to save, Ctrl+C to cancel)");
-    gui_println("  APPEND <file> <text>  Append text to file");
-    gui_println("  ECHO <text>           Print text");
-    gui_println("  PWD                   Print working directory");
-    gui_println("  SAVEFS <path>         Save entire filesystem to disk");
-    gui_println("  USER <name>           Switch to user");
-    gui_println("  ADDUSER <name>        Create new user");
-    gui_println("  RENAMEUSER <old> <new> Rename a user account");
-    gui_println("  TEXTCOLOR <color>       Change text color");
-    gui_println("  CURSORCOLOR <color>     Change cursor color");
-    gui_println("  WHOAMI                Show current user");
-    gui_println("  USERS                 List all users");
-    gui_println("  FILEVIEW              Show files in filesystem tree structure");
-    gui_println("  SYNC                  Sync virtual filesystem with real filesystem");
-    gui_println("  SAVE                  Save filesystem to disk");
-    gui_println("");
-    gui_println("=== AUTHENTICATION ===");
-    gui_println("  LOGIN <user> <pass>   Login to user account (required for Admin)");
-    gui_println("  USER <username>       Switch to user (Admin requires login first)");
-    gui_println("  LOGOUT                Logout from current session");
-    gui_println("  CHPASSWD <old> <new>  Change password");
-    gui_println("  SETUP_AUTH <user> <pass>  Setup authentication for user");
-    gui_println("");
-    gui_println("=== CUSTOMIZATION ===");
-    gui_println("  THEME <name>          Switch theme (classic, white, dark)");
-    gui_println("  THEME LIST            List available themes");
-    gui_println("  SETTINGS              Show current settings");
-    gui_println("  SET <setting> <value> Set configuration value");
-    gui_println("  GET <setting>         Get configuration value");
-    gui_println("  CLS, CLEAR            Clear screen");
-    gui_println("  EXIT                  Quit");
-    gui_println("");
-    gui_println("Git Commands (working with system Git):");
-    gui_println("  GIT INIT               Initialize a new Git repository");
-    gui_println("  GIT CLONE <url>        Clone a repository from URL");
-    gui_println("  GIT ADD <file>         Add file to staging area");
-    gui_println("  GIT ADD .              Add all files to staging area");
-    gui_println("  GIT COMMIT -m <msg>    Commit staged changes with message");
-    gui_println("  GIT STATUS             Show repository status");
-    gui_println("  GIT LOG                Show commit history");
-    gui_println("  GIT DIFF               Show changes between commits");
-    gui_println("  GIT BRANCH             List branches");
-    gui_println("  GIT BRANCH <name>      Create new branch");
-    gui_println("  GIT CHECKOUT <branch>  Switch to branch");
-    gui_println("  GIT MERGE <branch>     Merge branch into current");
-    gui_println("  GIT PULL               Pull changes from remote");
-    gui_println("  GIT PUSH               Push changes to remote");
-    gui_println("  GIT REMOTE -v          List remote repositories");
-    gui_println("  GIT REMOTE ADD <name> <url>  Add remote repository");
-    gui_println("  GIT FETCH              Fetch changes from remote");
-    gui_println("  GIT RESET <file>       Unstage file");
-    gui_println("  GIT RESET --hard       Reset to last commit");
-    gui_println("  GIT STASH              Stash current changes");
-    gui_println("  GIT STASH POP          Apply stashed changes");
-    gui_println("  GIT TAG <name>         Create a tag");
-    gui_println("  GIT TAG -l             List tags");
-    gui_println("  GIT CONFIG --global user.name <name>  Set global username");
-    gui_println("  GIT CONFIG --global user.email <email>  Set global email");
-    gui_println("  GIT CONFIG --list      List Git configuration");
-    gui_println("  GIT HELP <command>     Show help for Git command");
-    gui_println("  GIT VERSION            Show Git version");
-    gui_println("  GIT TEST               Test Git installation");
-    gui_println("  GIT PWD                Show where Git operations happen");
-    gui_println("");
-    gui_println("=== PROJECT DETECTION ===");
-    gui_println("  PROJECT_TYPE           Show current project type");
-    gui_println("  PROJECT_INFO           Show detailed project information");
-    gui_println("");
-    gui_println("=== C++ & PYTHON EXECUTION ===");
-    gui_println("  RUN <file>             Run C++ or Python file");
-    gui_println("  COMPILE <file>         Compile C++ file");
-    gui_println("");
-    gui_println("=== SYSTEM MAINTENANCE (Admin Only) ===");
-    gui_println("  CD .system_maintenance Access system maintenance tools");
-    gui_println("  SYSTEM_LS <path>       List directory contents");
-    gui_println("  SYSTEM_CD <path>       Change working directory");
-    gui_println("  SYSTEM_CAT <path>      Display file contents");
-    gui_println("  SYSTEM_COPY <src> <dest> Copy files between systems");
-    gui_println("  SYSTEM_EXIT            Exit maintenance mode");
-    gui_println("  SYSTEM_LOG             View maintenance activity log");
-    gui_println("");
-    gui_println("=== NPM/NODE.JS COMMANDS ===");
-    gui_println("  NPM INSTALL            Install all dependencies");
-    gui_println("  NPM ADD <package>      Install a package");
-    gui_println("  NPM REMOVE <package>   Uninstall a package");
-    gui_println("  NPM UPDATE             Update all packages");
-    gui_println("  NPM AUDIT              Check for vulnerabilities");
-    gui_println("  NPM OUTDATED           Show outdated packages");
-    gui_println("  NPM RUN <script>       Run a package script");
-    gui_println("  NPM START              Run start script");
-    gui_println("  NPM BUILD              Run build script");
-    gui_println("  NPM TEST               Run test script");
-    gui_println("  NPM DEV                Run dev script");
-    gui_println("  NPM INIT               Initialize package.json");
-    gui_println("  NPM LIST               List installed packages");
-    gui_println("  NPM HELP               Show npm help");
-    gui_println("");
-    gui_println("=== REACT DEVELOPMENT ===");
-    gui_println("  REACT CREATE <name>    Create new React app");
-    gui_println("  REACT COMPONENT <name> Create React component");
-    gui_println("  REACT START            Start React dev server");
-    gui_println("  REACT BUILD            Build React app");
-    gui_println("  REACT TEST             Run React tests");
-    gui_println("  REACT EJECT            Eject from Create React App");
-    gui_println("  REACT LINT             Run ESLint");
-    gui_println("");
-    gui_println("IDE Commands (open external editors):");
-    gui_println("  IDE vscode             Open VS Code in current directory");
-    gui_println("  IDE code               Alternative VS Code command");
-    gui_println("  IDE cursor             Open Cursor in current directory");
-    gui_println("  IDE notepad            Open Notepad");
-    gui_println("  IDE notepad++          Open Notepad++");
-    gui_println("  IDE sublime            Open Sublime Text");
-    gui_println("  IDE atom               Open Atom");
-    gui_println("  IDE vim                Open Vim");
-    gui_println("  IDE LIST               List available editors");
-    gui_println("  IDE HELP               Show IDE command help");
+static void sync_real_path(const char* rel, char* out, size_t out_sz) {
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    snprintf(out, out_sz, "%s\\data\\USERS\\%s", program_dir, rel);
 }
 
-// ---------------- IDE Commands ----------------
+// Walk a relative path in the VFS. With create set, missing directories are made.
+static Directory* vfs_walk_dirs(const char* rel, int segments, BOOL create) {
+    Directory* cur = g_root;
+    const char* p = rel;
+    for (int i = 0; cur && i < segments && *p; i++) {
+        char seg[MAX_NAME];
+        size_t n = strcspn(p, "\\");
+        if (n >= sizeof(seg)) return NULL;
+        memcpy(seg, p, n);
+        seg[n] = '\0';
+        p += n;
+        if (*p == '\\') p++;
 
-// IDE Configuration
-#define MAX_IDES 10
-#define MAX_EDITOR_NAME 32
-#define MAX_EDITOR_PATH 512
+        Directory* next = fs_find_child(cur, seg);
+        if (!next && create && cur->child_count < MAX_CHILDREN) {
+            next = fs_create_dir(seg);
+            if (next) fs_add_child(cur, next);
+        }
+        cur = next;
+    }
+    return cur;
+}
 
-typedef struct {
-    char name[MAX_EDITOR_NAME];
-    char path[MAX_EDITOR_PATH];
-    int enabled;
-} IDEConfig;
+static int sync_path_segments(const char* rel) {
+    int n = 1;
+    for (const char* p = rel; *p; p++) if (*p == '\\') n++;
+    return n;
+}
 
-static IDEConfig g_ide_configs[MAX_IDES];
-static int g_ide_count = 0;
+static const char* sync_path_name(const char* rel) {
+    const char* sep = strrchr(rel, '\\');
+    return sep ? sep + 1 : rel;
+}
 
-// Initialize IDE configurations
-static void init_ide_configs(void) {
-    g_ide_count = 0;
-    
-    // VS Code detection
-    const char* vscode_paths[] = {
-        "C:\\Users\\%USERNAME%\\AppData\\Local\\Programs\\Microsoft VS Code\\Code.exe",
-        "C:\\Program Files\\Microsoft VS Code\\Code.exe",
-        "C:\\Program Files (x86)\\Microsoft VS Code\\Code.exe"
-    };
-    
-    for (int i = 0; i < 3; i++) {
-        char expanded_path[MAX_EDITOR_PATH];
-        ExpandEnvironmentStringsA(vscode_paths[i], expanded_path, sizeof(expanded_path));
-        
-        if (GetFileAttributesA(expanded_path) != INVALID_FILE_ATTRIBUTES) {
-            strcpy(g_ide_configs[g_ide_count].name, "vscode");
-            strcpy(g_ide_configs[g_ide_count].path, expanded_path);
-            g_ide_configs[g_ide_count].enabled = 1;
-            g_ide_count++;
-            
-            // Add alternative "code" command
-            strcpy(g_ide_configs[g_ide_count].name, "code");
-            strcpy(g_ide_configs[g_ide_count].path, expanded_path);
-            g_ide_configs[g_ide_count].enabled = 1;
-            g_ide_count++;
-            break;
+static File* vfs_lookup_file(const char* rel, Directory** parent_out) {
+    Directory* parent = vfs_walk_dirs(rel, sync_path_segments(rel) - 1, FALSE);
+    if (parent_out) *parent_out = parent;
+    return parent ? fs_find_file(parent, sync_path_name(rel)) : NULL;
+}
+
+static void vfs_remove_file(Directory* parent, File* f) {
+    for (int i = 0; i < parent->file_count; ++i) {
+        if (parent->files[i] == f) {
+            vfs_changed(VFS_FILE_REMOVED, parent, f);
+            for (int j = i; j < parent->file_count - 1; ++j) parent->files[j] = parent->files[j + 1];
+            parent->file_count--;
+            if (g_editFile == f) g_editFile = NULL;
+            free(f);
+            return;
         }
     }
-    
-    // Notepad detection
-    const char* notepad_path = "C:\\Windows\\System32\\notepad.exe";
-    if (GetFileAttributesA(notepad_path) != INVALID_FILE_ATTRIBUTES) {
-        strcpy(g_ide_configs[g_ide_count].name, "notepad");
-        strcpy(g_ide_configs[g_ide_count].path, notepad_path);
-        g_ide_configs[g_ide_count].enabled = 1;
-        g_ide_count++;
+}
+
+static void vfs_free_tree(Directory* dir) {
+    for (int i = 0; i < dir->file_count; ++i) {
+        if (g_editFile == dir->files[i]) g_editFile = NULL;
+        free(dir->files[i]);
     }
-    
-    // Notepad++ detection
-    const char* npp_paths[] = {
-        "C:\\Program Files\\Notepad++\\notepad++.exe",
-        "C:\\Program Files (x86)\\Notepad++\\notepad++.exe"
-    };
-    
-    for (int i = 0; i < 2; i++) {
-        if (GetFileAttributesA(npp_paths[i]) != INVALID_FILE_ATTRIBUTES) {
-            strcpy(g_ide_configs[g_ide_count].name, "notepad++");
-            strcpy(g_ide_configs[g_ide_count].path, npp_paths[i]);
-            g_ide_configs[g_ide_count].enabled = 1;
-            g_ide_count++;
-            break;
-        }
+    for (int i = 0; i < dir->child_count; ++i) vfs_free_tree(dir->children[i]);
+    free(dir);
+}
+
+static void vfs_remove_dir(Directory* dir) {
+    Directory* parent = dir->parent;
+    if (!parent) return;
+    // Never leave the working directory dangling
+    for (Directory* d = g_cwd; d; d = d->parent) {
+        if (d == dir) { g_cwd = parent; break; }
     }
-    
-    // Cursor detection
-    const char* cursor_paths[] = {
-        "C:\\Users\\%USERNAME%\\AppData\\Local\\Programs\\cursor\\Cursor.exe",
-        "C:\\Program Files\\Cursor\\Cursor.exe",
-        "C:\\Program Files (x86)\\Cursor\\Cursor.exe"
-    };
-    
-    for (int i = 0; i < 3; i++) {
-        char expanded_path[MAX_EDITOR_PATH];
-        ExpandEnvironmentStringsA(cursor_paths[i], expanded_path, sizeof(expanded_path));
-        
-        if (GetFileAttributesA(expanded_path) != INVALID_FILE_ATTRIBUTES) {
-            strcpy(g_ide_configs[g_ide_count].name, "cursor");
-            strcpy(g_ide_configs[g_ide_count].path, expanded_path);
-            g_ide_configs[g_ide_count].enabled = 1;
-            g_ide_count++;
+    vfs_changed(VFS_DIR_REMOVED, dir, NULL);
+    for (int i = 0; i < parent->child_count; ++i) {
+        if (parent->children[i] == dir) {
+            for (int j = i; j < parent->child_count - 1; ++j) parent->children[j] = parent->children[j + 1];
+            parent->child_count--;
             break;
         }
     }
+    vfs_free_tree(dir);
 }
 
-// Find IDE by name
-static int find_ide_by_name(const char* name) {
-    for (int i = 0; i < g_ide_count; i++) {
-        if (strcmp(g_ide_configs[i].name, name) == 0 && g_ide_configs[i].enabled) {
-            return i;
+static BOOL sync_write_disk_file(const char* real, const char* content) {
+    char parent[2048];
+    snprintf(parent, sizeof(parent), "%s", real);
+    char* sep = strrchr(parent, '\\');
+    if (sep) { *sep = '\0'; mkdir_p(parent); }
+    FILE* f = pf_fopen(real, "wb");
+    if (!f) return FALSE;
+    fwrite(content, 1, strlen(content), f);
+    fclose(f);
+    return TRUE;
+}
+
+// Read a disk file the way the VFS would hold it. Anything the VFS cannot
+// hold verbatim (too big, or binary with embedded NULs) is left out of sync,
+// so a truncated copy can never be written back over the original.
+static char* sync_read_disk_file(const char* real, unsigned long long size, BOOL* unsyncable) {
+    *unsyncable = (size >= MAX_FILE_SIZE);
+    if (*unsyncable) return NULL;
+    FILE* f = pf_fopen(real, "rb");
+    if (!f) return NULL;
+    char* content = (char*)malloc(MAX_FILE_SIZE);
+    if (content) {
+        size_t n = fread(content, 1, MAX_FILE_SIZE - 1, f);
+        content[n] = '\0';
+        if (strlen(content) != n) {
+            free(content);
+            content = NULL;
+            *unsyncable = TRUE;
+        }
+    }
+    fclose(f);
+    return content;
+}
+
+// ---- Disk scan ----
+static int sync_scan_add(SyncScan* scan, int parent, const char* path, char* content, BOOL is_dir, BOOL unsyncable) {
+    if (scan->count == scan->capacity) {
+        int cap = scan->capacity ? scan->capacity * 2 : 256;
+        SyncEntry* grown = (SyncEntry*)realloc(scan->entries, cap * sizeof(SyncEntry));
+        if (!grown) { free(content); return -1; }
+        scan->entries = grown;
+        scan->capacity = cap;
+    }
+    int idx = scan->count++;
+    SyncEntry* e = &scan->entries[idx];
+    memset(e, 0, sizeof(*e));
+    e->path = _strdup(path);
+    e->content = content;
+    e->hash = content ? sync_hash(content) : 0;
+    e->is_dir = is_dir;
+    e->unsyncable = unsyncable;
+    e->first_child = -1;
+    e->next_sibling = -1;
+    if (parent >= 0) {
+        e->next_sibling = scan->entries[parent].first_child;
+        scan->entries[parent].first_child = idx;
+    }
+    return idx;
+}
+
+static BOOL sync_scan_cancelled(const SyncScan* scan) {
+    return scan->cancel && pf_atomic_get(scan->cancel);
+}
+
+// Returns TRUE when the directory was listed to the end. A cancelled or
+// failed listing leaves it incomplete, and planning never reads missing
+// entries of an incomplete directory as deletions.
+static BOOL sync_scan_recursive(SyncScan* scan, int parent, const char* real_path, IgnoreWalk* walk) {
+    PfDir* dir = pf_dir_open(real_path);
+    if (!dir) return FALSE;
+
+    BOOL complete = TRUE;
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
+        if (sync_scan_cancelled(scan)) { complete = FALSE; break; }
+
+        // Ignored entries are pruned before anything is read or enumerated
+        BOOL is_dir = entry.is_dir;
+        if (ignore_walk_check(walk, entry.name, is_dir)) continue;
+
+        char rel[1024], real[2048];
+        snprintf(rel, sizeof(rel), "%s\\%s", scan->entries[parent].path, entry.name);
+        snprintf(real, sizeof(real), "%s\\%s", real_path, entry.name);
+
+        if (is_dir) {
+            int idx = sync_scan_add(scan, parent, rel, NULL, TRUE, FALSE);
+            if (idx < 0) { complete = FALSE; continue; }
+            IgnoreMark mark;
+            ignore_walk_enter(walk, entry.name, &mark);
+            ignore_walk_push_file(walk, real);
+            sync_scan_recursive(scan, idx, real, walk);
+            ignore_walk_leave(walk, &mark);
+        } else {
+            BOOL unsyncable = FALSE;
+            char* content = sync_read_disk_file(real, entry.size, &unsyncable);
+            if (!content && !unsyncable) { complete = FALSE; continue; }
+            int idx = sync_scan_add(scan, parent, rel, content, FALSE, unsyncable);
+            if (idx < 0) { complete = FALSE; continue; }
+            if (content) {
+                // Bases only change on the UI thread, which waits for the scan
+                SyncBase* base = sync_base_find(rel);
+                if (!base || base->hash != scan->entries[idx].hash) scan->files_changed++;
+                scan->bytes_read += strlen(content);
+            }
+            scan->files_read++;
         }
     }
+
+    pf_dir_close(dir);
+    scan->dirs_scanned++;
+    scan->entries[parent].complete = complete;
+    return complete;
+}
+
+// Scan the disk side of one root (a path relative to data\USERS); returns its
+// entry, or -1 when there is no such real directory. Touches no VFS state,
+// so it can run on the worker thread.
+static int sync_scan_root(SyncScan* scan, const char* rel, IgnoreWalk* walk) {
+    char real[2048];
+    sync_real_path(rel, real, sizeof(real));
+
+    if (pf_path_kind(real) != PF_PATH_DIR) return -1;
+
+    int root = sync_scan_add(scan, -1, rel, NULL, TRUE, FALSE);
+    if (root < 0) return -1;
+    sync_scan_recursive(scan, root, real, walk);
+    return root;
+}
+
+static void sync_scan_index(SyncScan* scan) {
+    free(scan->index);
+    scan->index_size = 64;
+    while (scan->index_size < scan->count * 2) scan->index_size <<= 1;
+    scan->index = (int*)malloc(scan->index_size * sizeof(int));
+    if (!scan->index) { scan->index_size = 0; return; }
+    for (int i = 0; i < scan->index_size; i++) scan->index[i] = -1;
+    for (int i = 0; i < scan->count; i++) {
+        int slot = (int)(sync_path_hash(scan->entries[i].path) & (scan->index_size - 1));
+        while (scan->index[slot] >= 0) slot = (slot + 1) & (scan->index_size - 1);
+        scan->index[slot] = i;
+    }
+}
+
+static int sync_scan_find(const SyncScan* scan, const char* path) {
+    if (!scan->index_size) return -1;
+    int slot = (int)(sync_path_hash(path) & (scan->index_size - 1));
+    while (scan->index[slot] >= 0) {
+        if (_stricmp(scan->entries[scan->index[slot]].path, path) == 0) return scan->index[slot];
+        slot = (slot + 1) & (scan->index_size - 1);
+    }
     return -1;
 }
 
-// Get current working directory for IDE
-static void get_current_working_directory(char* path, size_t path_size) {
-    // Get the main project directory
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    // Build the real path based on current virtual directory
-    if (g_cwd) {
-        // Convert virtual path to real path
-        char virtual_path[1024];
-        fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-        
-        // Find the position after "C:\\USERS\\"
-        char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-        if (profiles_pos) {
-            // Skip "C:\USERS\" and add the rest to the base path
-            char* relative_path = profiles_pos + 7; // Skip "\USERS\"
-            snprintf(path, path_size, "%s\\data\\USERS\\%s", program_dir, relative_path);
+static void sync_scan_free(SyncScan* scan) {
+    for (int i = 0; i < scan->count; i++) {
+        free(scan->entries[i].path);
+        free(scan->entries[i].content);
+    }
+    free(scan->entries);
+    free(scan->index);
+    memset(scan, 0, sizeof(*scan));
+}
+
+// ---- Planning ----
+static void sync_plan_add(SyncPlan* plan, SyncOpKind kind, const char* path, const char* content, const char* reason) {
+    if (plan->count == plan->capacity) {
+        int cap = plan->capacity ? plan->capacity * 2 : 64;
+        SyncOp* grown = (SyncOp*)realloc(plan->ops, cap * sizeof(SyncOp));
+        if (!grown) return;
+        plan->ops = grown;
+        plan->capacity = cap;
+    }
+    SyncOp* op = &plan->ops[plan->count++];
+    op->kind = kind;
+    op->path = _strdup(path);
+    op->content = content;
+    op->reason = reason;
+}
+
+static void sync_plan_free(SyncPlan* plan) {
+    for (int i = 0; i < plan->count; i++) free(plan->ops[i].path);
+    free(plan->ops);
+    memset(plan, 0, sizeof(*plan));
+}
+
+// Decide what happens to one file. Returns TRUE when it ends up on neither side.
+static BOOL sync_plan_file(SyncPlan* plan, const char* path, File* vf, SyncEntry* de) {
+    if (de && de->unsyncable) return FALSE;
+    SyncBase* base = sync_base_find(path);
+    if (base && !base->content) base = NULL;
+
+    if (vf && de) {
+        unsigned long long hv = sync_hash(vf->content);
+        if (hv == de->hash && strcmp(vf->content, de->content) == 0) {
+            if (!base || base->hash != hv) sync_plan_add(plan, SYNC_OP_ADOPT, path, de->content, NULL);
+        } else if (base && base->hash == hv) {
+            sync_plan_add(plan, SYNC_OP_IMPORT, path, de->content, NULL);
+        } else if ((base && base->hash == de->hash) || (!base && g_syncBaseFresh)) {
+            // Before the first sync nothing has been edited on either side:
+            // the VFS wins, as the startup import always let it
+            sync_plan_add(plan, SYNC_OP_EXPORT, path, vf->content, NULL);
         } else {
-            // Fallback to current user's directory
-            snprintf(path, path_size, "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+            sync_plan_add(plan, SYNC_OP_CONFLICT, path, NULL,
+                          base ? "changed in the VFS and on disk" : "differs and has never been synced");
         }
-    } else {
-        strcpy(path, "C:\\");
+        return FALSE;
     }
-}
-
-// Execute IDE
-static int execute_ide(const char* ide_path, const char* working_dir) {
-    STARTUPINFOA si = {0};
-    PROCESS_INFORMATION pi = {0};
-    
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_NORMAL;
-    
-    // Build command line with new window flags
-    char command_line[1024];
-    
-    // Check if it's VS Code or Cursor (they use similar arguments)
-    const char* exe_name = strrchr(ide_path, '\\');
-    if (exe_name) exe_name++; else exe_name = ide_path;
-    
-    if (strstr(exe_name, "Code.exe") || strstr(exe_name, "Cursor.exe")) {
-        // VS Code and Cursor: use -n for new window
-        snprintf(command_line, sizeof(command_line), "\"%s\" -n \"%s\"", ide_path, working_dir);
-    } else if (strstr(exe_name, "notepad++.exe")) {
-        // Notepad++: use -multiInst for new instance
-        snprintf(command_line, sizeof(command_line), "\"%s\" -multiInst \"%s\"", ide_path, working_dir);
-    } else {
-        // Default: just open the directory
-        snprintf(command_line, sizeof(command_line), "\"%s\" \"%s\"", ide_path, working_dir);
+    if (vf) {
+        if (!base) {
+            sync_plan_add(plan, SYNC_OP_EXPORT, path, vf->content, NULL);
+        } else if (base->hash == sync_hash(vf->content)) {
+            sync_plan_add(plan, SYNC_OP_DELETE_VFS, path, NULL, NULL);
+            return TRUE;
+        } else {
+            sync_plan_add(plan, SYNC_OP_CONFLICT, path, NULL, "changed in the VFS, deleted on disk");
+        }
+        return FALSE;
     }
-    
-    // Create process
-    BOOL success = CreateProcessA(
-        NULL,                    // Application name
-        command_line,            // Command line
-        NULL,                    // Process security attributes
-        NULL,                    // Thread security attributes
-        FALSE,                   // Inherit handles
-        0,                       // Creation flags
-        NULL,                    // Environment
-        working_dir,             // Current directory
-        &si,                     // Startup info
-        &pi                      // Process information
-    );
-    
-    if (success) {
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-        return 1;
+    if (de) {
+        if (!base) {
+            sync_plan_add(plan, SYNC_OP_IMPORT, path, de->content, NULL);
+        } else if (base->hash == de->hash) {
+            sync_plan_add(plan, SYNC_OP_DELETE_DISK, path, NULL, NULL);
+            return TRUE;
+        } else {
+            sync_plan_add(plan, SYNC_OP_CONFLICT, path, NULL, "deleted in the VFS, changed on disk");
+        }
+        return FALSE;
     }
-    
-    return 0;
+    return TRUE;
 }
 
-// IDE command implementation
-static void cmd_ide(const char* args) {
-    if (!args || !*args) {
-        cmd_ide_help();
-        return;
+// Plan one directory present on at least one side. Ops for the contents come
+// before the op for the directory itself, so removals empty it first.
+// Returns TRUE when the directory ends up on neither side.
+static BOOL sync_plan_dir(SyncPlan* plan, SyncScan* scan, const char* path, Directory* vdir, int dentry, IgnoreWalk* walk) {
+    BOOL all_gone = TRUE;
+    // After a cancelled scan, whatever was not listed is unknown, not deleted
+    BOOL partial = (dentry >= 0 && !scan->entries[dentry].complete);
+
+    if (vdir) {
+        for (int i = 0; i < vdir->file_count; i++) {
+            File* f = vdir->files[i];
+            if (ignore_walk_check(walk, f->name, FALSE)) { all_gone = FALSE; continue; }
+            char child[1024];
+            snprintf(child, sizeof(child), "%s\\%s", path, f->name);
+            int idx = sync_scan_find(scan, child);
+            SyncEntry* de = (idx >= 0) ? &scan->entries[idx] : NULL;
+            if (de) de->seen = TRUE;
+            if ((de && de->is_dir) || (!de && partial)) { all_gone = FALSE; continue; }
+            if (!sync_plan_file(plan, child, f, de)) all_gone = FALSE;
+        }
+        for (int i = 0; i < vdir->child_count; i++) {
+            Directory* sub = vdir->children[i];
+            // The maintenance folder only lives in the VFS
+            if (_stricmp(sub->name, ".system_maintenance") == 0 ||
+                ignore_walk_check(walk, sub->name, TRUE)) {
+                all_gone = FALSE;
+                continue;
+            }
+            char child[1024];
+            snprintf(child, sizeof(child), "%s\\%s", path, sub->name);
+            int idx = sync_scan_find(scan, child);
+            if (idx >= 0) {
+                scan->entries[idx].seen = TRUE;
+                if (!scan->entries[idx].is_dir) { all_gone = FALSE; continue; }
+            } else if (partial) {
+                all_gone = FALSE;
+                continue;
+            }
+            IgnoreMark mark;
+            ignore_walk_enter_dir(walk, sub, &mark);
+            if (!sync_plan_dir(plan, scan, child, sub, idx, walk)) all_gone = FALSE;
+            ignore_walk_leave(walk, &mark);
+        }
+    }
+
+    if (dentry >= 0) {
+        for (int idx = scan->entries[dentry].first_child; idx >= 0; idx = scan->entries[idx].next_sibling) {
+            SyncEntry* de = &scan->entries[idx];
+            if (de->seen) continue;
+            de->seen = TRUE;
+            if (de->is_dir) {
+                if (!sync_plan_dir(plan, scan, de->path, NULL, idx, walk)) all_gone = FALSE;
+            } else if (!sync_plan_file(plan, de->path, NULL, de)) {
+                all_gone = FALSE;
+            }
+        }
     }
-    
-    // Parse arguments
-    char editor_name[64];
-    if (sscanf(args, "%63s", editor_name) != 1) {
-        cmd_ide_help();
-        return;
+
+    // The directory itself: new on one side, or removed on one side
+    SyncBase* base = sync_base_find(path);
+    BOOL known = (base && !base->content);
+    if (vdir && dentry >= 0) {
+        if (!known) sync_plan_add(plan, SYNC_OP_ADOPT, path, NULL, NULL);
+        return FALSE;
     }
-    
-    // Find the IDE
-    int ide_index = find_ide_by_name(editor_name);
-    if (ide_index == -1) {
-        char msg[256];
-        snprintf(msg, sizeof(msg), "IDE '%s' not found. Use 'IDE LIST' to see available editors.", editor_name);
-        gui_println(msg);
-        return;
+    if (vdir) {
+        if (!known) {
+            sync_plan_add(plan, SYNC_OP_MKDIR_DISK, path, NULL, NULL);
+            return FALSE;
+        }
+        if (all_gone) sync_plan_add(plan, SYNC_OP_DELETE_VFS_DIR, path, NULL, NULL);
+        return all_gone;
     }
-    
-    // Get current working directory
-    char working_dir[1024];
-    get_current_working_directory(working_dir, sizeof(working_dir));
-    
-    // Execute the IDE
-    if (execute_ide(g_ide_configs[ide_index].path, working_dir)) {
-        char msg[512];
-        snprintf(msg, sizeof(msg), "Opening %s in %s...", g_ide_configs[ide_index].name, working_dir);
-        gui_println(msg);
-    } else {
-        char msg[256];
-        snprintf(msg, sizeof(msg), "Failed to open %s. Please check if it's installed.", g_ide_configs[ide_index].name);
-        gui_println(msg);
+    if (dentry >= 0) {
+        if (!known) {
+            sync_plan_add(plan, SYNC_OP_MKDIR_VFS, path, NULL, NULL);
+            return FALSE;
+        }
+        if (partial) return FALSE;
+        if (all_gone) sync_plan_add(plan, SYNC_OP_DELETE_DISK_DIR, path, NULL, NULL);
+        return all_gone;
     }
+    return all_gone;
 }
 
-// IDE help command
-static void cmd_ide_help(void) {
-    gui_println("IDE Command Help:");
-    gui_println("================");
-    gui_println("Usage: IDE <editor>");
-    gui_println("");
-    gui_println("Available Editors:");
-    cmd_ide_list();
-    gui_println("");
-    gui_println("Examples:");
-    gui_println("  IDE vscode              - Open VS Code in new window");
-    gui_println("  IDE code                - Alternative VS Code command");
-    gui_println("  IDE cursor              - Open Cursor in new window");
-    gui_println("  IDE notepad             - Open Notepad");
-    gui_println("  IDE notepad++           - Open Notepad++ in new instance");
-    gui_println("");
-    gui_println("Editors will open in new windows in the current terminal directory.");
+// Bases under a directory that neither side has any more
+static void sync_plan_forget(SyncPlan* plan, SyncScan* scan, const char* path) {
+    size_t len = strlen(path);
+    for (int i = 0; i < SYNC_BASE_BUCKETS; i++) {
+        for (SyncBase* b = g_syncBase[i]; b; b = b->next) {
+            if (_strnicmp(b->path, path, len) != 0 || b->path[len] != '\\') continue;
+            if (sync_scan_find(scan, b->path) >= 0) continue;
+            if (b->content ? vfs_lookup_file(b->path, NULL) != NULL
+                           : vfs_walk_dirs(b->path, sync_path_segments(b->path), FALSE) != NULL) continue;
+            sync_plan_add(plan, SYNC_OP_FORGET, b->path, NULL, NULL);
+        }
+    }
+}
+
+static void sync_plan_root(SyncPlan* plan, SyncScan* scan, Directory* dir, int root, BOOL cancelled) {
+    char rel[1024];
+    vfs_rel_path(dir, rel, sizeof(rel));
+    IgnoreWalk walk;
+    ignore_walk_begin_at(&walk, dir);
+    scan->entries[root].seen = TRUE;
+    sync_plan_dir(plan, scan, rel, dir, root, &walk);
+    ignore_walk_end(&walk);
+    // Forgetting needs to know what is really gone; leave it to a full pass
+    if (!cancelled) sync_plan_forget(plan, scan, rel);
+}
+
+// ---- Applying ----
+static void sync_apply(SyncPlan* plan, SyncReport* report) {
+    memset(report, 0, sizeof(*report));
+    for (int i = 0; i < plan->count; i++) {
+        SyncOp* op = &plan->ops[i];
+        char real[2048];
+        sync_real_path(op->path, real, sizeof(real));
+
+        switch (op->kind) {
+            case SYNC_OP_IMPORT: {
+                int segments = sync_path_segments(op->path);
+                Directory* parent = vfs_walk_dirs(op->path, segments - 1, TRUE);
+                if (!parent) { report->skipped++; break; }
+                const char* name = sync_path_name(op->path);
+                File* f = fs_find_file(parent, name);
+                if (!f && parent->file_count < MAX_FILES) {
+                    f = fs_create_file(name);
+                    if (f) fs_add_file(parent, f);
+                }
+                if (!f) { report->skipped++; break; }
+                strncpy(f->content, op->content, MAX_FILE_SIZE - 1);
+                f->content[MAX_FILE_SIZE - 1] = '\0';
+                vfs_changed(VFS_FILE_WRITTEN, parent, f);
+                sync_base_set(op->path, f->content);
+                report->imported++;
+                break;
+            }
+            case SYNC_OP_EXPORT:
+                if (!sync_write_disk_file(real, op->content)) { report->skipped++; break; }
+                sync_base_set(op->path, op->content);
+                report->exported++;
+                break;
+            case SYNC_OP_DELETE_VFS: {
+                Directory* parent = NULL;
+                File* f = vfs_lookup_file(op->path, &parent);
+                if (f) vfs_remove_file(parent, f);
+                sync_base_remove(op->path);
+                report->deleted++;
+                break;
+            }
+            case SYNC_OP_DELETE_DISK:
+                pf_remove(real);
+                sync_base_remove(op->path);
+                report->deleted++;
+                break;
+            case SYNC_OP_MKDIR_VFS:
+                if (vfs_walk_dirs(op->path, sync_path_segments(op->path), TRUE)) {
+                    sync_base_set(op->path, NULL);
+                    report->dirs++;
+                } else {
+                    report->skipped++;
+                }
+                break;
+            case SYNC_OP_MKDIR_DISK:
+                if (mkdir_p(real)) {
+                    sync_base_set(op->path, NULL);
+                    report->dirs++;
+                } else {
+                    report->skipped++;
+                }
+                break;
+            case SYNC_OP_DELETE_VFS_DIR: {
+                Directory* d = vfs_walk_dirs(op->path, sync_path_segments(op->path), FALSE);
+                if (d && d->file_count == 0 && d->child_count == 0 && d->parent != g_root) vfs_remove_dir(d);
+                sync_base_remove(op->path);
+                report->deleted++;
+                break;
+            }
+            case SYNC_OP_DELETE_DISK_DIR:
+                pf_rmdir(real);
+                sync_base_remove(op->path);
+                report->deleted++;
+                break;
+            case SYNC_OP_ADOPT:
+                sync_base_set(op->path, op->content);
+                break;
+            case SYNC_OP_FORGET:
+                sync_base_remove(op->path);
+                break;
+            case SYNC_OP_CONFLICT:
+                report->conflicts++;
+                break;
+        }
+    }
 }
 
-// IDE list command
-static void cmd_ide_list(void) {
-    gui_println("Available IDEs:");
-    gui_println("===============");
-    
-    for (int i = 0; i < g_ide_count; i++) {
-        if (g_ide_configs[i].enabled) {
-            char msg[256];
-            snprintf(msg, sizeof(msg), "  %-12s - %s", g_ide_configs[i].name, g_ide_configs[i].path);
-            gui_println(msg);
+// ---- Reporting ----
+static void sync_print_status(SyncPlan* plan, const char* prefix) {
+    size_t prefix_len = strlen(prefix);
+    int pending = 0, conflicts = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < plan->count; i++) {
+            SyncOp* op = &plan->ops[i];
+            const char* label = NULL;
+            switch (op->kind) {
+                case SYNC_OP_IMPORT:          label = "disk -> VFS "; break;
+                case SYNC_OP_EXPORT:          label = "VFS -> disk "; break;
+                case SYNC_OP_DELETE_VFS:
+                case SYNC_OP_DELETE_VFS_DIR:  label = "delete (VFS)"; break;
+                case SYNC_OP_DELETE_DISK:
+                case SYNC_OP_DELETE_DISK_DIR: label = "delete (disk)"; break;
+                case SYNC_OP_MKDIR_VFS:       label = "mkdir (VFS) "; break;
+                case SYNC_OP_MKDIR_DISK:      label = "mkdir (disk)"; break;
+                case SYNC_OP_CONFLICT:        label = "CONFLICT    "; break;
+                default: break;
+            }
+            if (!label || (pass == 0) == (op->kind == SYNC_OP_CONFLICT)) continue;
+
+            const char* shown = op->path;
+            if (_strnicmp(shown, prefix, prefix_len) == 0 && shown[prefix_len] == '\\') shown += prefix_len + 1;
+            if (op->kind == SYNC_OP_CONFLICT) {
+                if (conflicts++ == 0) gui_println("Conflicts:");
+                gui_printf("  %s %s  (%s)", label, shown, op->reason);
+            } else {
+                if (pending++ == 0) gui_println("Pending changes:");
+                gui_printf("  %s %s", label, shown);
+            }
         }
     }
-    
-    if (g_ide_count == 0) {
-        gui_println("  No IDEs detected. Please install an editor.");
+
+    if (pending == 0 && conflicts == 0) {
+        gui_println("Everything is in sync.");
+    } else if (conflicts > 0) {
+        gui_println("Resolve with: SYNC RESOLVE <path> VFS|DISK|MERGE");
     }
 }
 
-static void cmd_pwd(void) {
-    char path[1024];
-    fs_print_path(g_cwd, path, sizeof(path));
-    gui_println(path);
+static void sync_print_report(const SyncReport* report) {
+    gui_printf("Sync completed: %d imported, %d exported, %d deleted, %d folder(s) created, %d conflict(s)",
+               report->imported, report->exported, report->deleted, report->dirs, report->conflicts);
+    if (report->skipped > 0) {
+        gui_printf("%d change(s) could not be applied (VFS limits or disk errors).", report->skipped);
+    }
+    if (report->conflicts > 0) {
+        gui_println("Use SYNC STATUS to list conflicts and SYNC RESOLVE to settle them.");
+    }
 }
 
+// ---- Background jobs ----
+// One sync at a time. While it runs the terminal stays responsive but takes
+// no commands; Ctrl+C cancels. Cancelling only stops the scan: whatever was
+// scanned is still planned and applied as a whole, so the VFS, the disk and
+// the bases stay consistent, and unscanned folders are simply left for later.
+static SyncJob* g_syncJob = NULL;
 
-static void cmd_dir(void) {
-    char head[1024];
-    fs_print_path(g_cwd, head, sizeof(head));
-    char title[1200];
-    snprintf(title, sizeof(title), " Directory of %s", head);
-    gui_println(title);
-    gui_println("");
-    for (int i = 0; i < g_cwd->child_count; ++i) {
-        char line[400];
-        snprintf(line, sizeof(line), "%-24s <DIR>", g_cwd->children[i]->name);
-        gui_println(line);
-    }
-    for (int i = 0; i < g_cwd->file_count; ++i) {
-        gui_println(g_cwd->files[i]->name);
-    }
+BOOL sync_job_active(void) {
+    return g_syncJob != NULL;
 }
 
-static void cmd_mkdir(const char* name) {
-    if (!name || !*name) { 
-        gui_println("The syntax of the command is incorrect."); 
-        return; 
-    }
-    
-    // Check if directory already exists in virtual filesystem
-    if (fs_find_child(g_cwd, name)) { 
-        gui_println("A subdirectory or file already exists."); 
-        return; 
+static void sync_job_scan(SyncJob* job) {
+    for (int i = 0; i < job->root_count && !pf_atomic_get(&job->cancel); i++) {
+        job->roots[i] = sync_scan_root(&job->scan, job->rel[i], job->walks[i]);
     }
-    
-    // Create the directory in virtual filesystem
-    Directory* d = fs_create_dir(name);
-    if (d) {
-        fs_add_child(g_cwd, d);
-        
-        // Get the real path based on current directory
-        char virtual_path[1024];
-        fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-        
-        // Get program directory
-        char program_dir[1024];
-        get_main_project_dir(program_dir, sizeof(program_dir));
-        
-        // Convert virtual path to real path
-        char real_path[1024];
-        const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-        if (profiles_pos) {
-            snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-        } else {
-            snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+}
+
+static int sync_job_thread(void* param) {
+    SyncJob* job = (SyncJob*)param;
+    sync_job_scan(job);
+    pf_atomic_set(&job->finished, 1);
+    gui_job_wake();
+    return 0;
+}
+
+static void sync_job_free(SyncJob* job) {
+    for (int i = 0; i < job->root_count; i++) {
+        free(job->rel[i]);
+        if (job->walks[i]) {
+            ignore_walk_end(job->walks[i]);
+            free(job->walks[i]);
         }
-        
-        // Add the directory name to the path
-        char full_real_path[1024];
-        join_path(full_real_path, sizeof(full_real_path), real_path, name);
-        
-        // Create the directory on disk (hidden)
-        CreateDirectoryA(full_real_path, NULL);
-        
-        char msg[256];
-        snprintf(msg, sizeof(msg), "Directory '%s' created successfully.", name);
-        gui_println(msg);
-        
-        // Auto-save filesystem
-        fs_save_to_disk();
-    } else {
-        gui_println("Failed to create directory.");
     }
+    sync_scan_free(&job->scan);
+    free(job);
 }
 
-static void cmd_touch(const char* name) {
-    if (!name || !*name) { gui_println("The syntax of the command is incorrect."); return; }
-    if (fs_find_file(g_cwd, name)) { gui_println("File already exists."); return; }
-    
-    // Create the file in virtual filesystem
-    File* f = fs_create_file(name);
-    if (f) {
-        fs_add_file(g_cwd, f);
-        
-        // Get the real path based on current directory
-        char virtual_path[1024];
-        fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-        
-        // Convert virtual path to real path using absolute paths
-        char program_dir[1024];
-        get_main_project_dir(program_dir, sizeof(program_dir));
-        
-        char real_path[1024];
-        const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-        if (profiles_pos) {
-            snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-        } else {
-            snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-        }
-        
-        // Add the filename to the path
-        char full_real_path[1024];
-        join_path(full_real_path, sizeof(full_real_path), real_path, name);
-        
-        
-        // Create empty file on disk (hidden)
-        HANDLE hFile = CreateFileA(full_real_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hFile != INVALID_HANDLE_VALUE) {
-            CloseHandle(hFile);
-            gui_println("File created successfully in real filesystem.");
-        } else {
-            gui_println("Failed to create file in real filesystem.");
+// Ticker: refresh the status line. Quick syncs never show one.
+void sync_job_poll(void) {
+    SyncJob* job = g_syncJob;
+    if (!job || !job->thread) return;
+    BOOL cancelling = pf_atomic_get(&job->cancel) != 0;
+    unsigned long elapsed = pf_ticks_ms() - job->started;
+    if (elapsed < SYNC_STATUS_DELAY_MS && !cancelling) return;
+
+    char text[256];
+    if (cancelling) {
+        snprintf(text, sizeof(text), "Cancelling sync...");
+    } else {
+        long files = job->scan.files_read;
+        char eta[32] = "--:--";
+        if (files > 0 && job->expected_files > files) {
+            unsigned long long remaining = (unsigned long long)elapsed * (job->expected_files - files) / files / 1000;
+            snprintf(eta, sizeof(eta), "%llu:%02llu", remaining / 60, remaining % 60);
         }
-        
-        char msg[256];
-        snprintf(msg, sizeof(msg), "File '%s' created successfully.", name);
-        gui_println(msg);
-        
-        // Auto-save filesystem
-        fs_save_to_disk();
+        snprintf(text, sizeof(text), "Syncing: %ld folders, %ld files (%ld changed), %.1f MB read, ETA %s - Ctrl+C to cancel",
+                 job->scan.dirs_scanned, files, job->scan.files_changed,
+                 job->scan.bytes_read / (1024.0 * 1024.0), eta);
     }
+    gui_status_line(text);
+    job->status_shown = TRUE;
 }
 
-static void cmd_del(const char* name) {
-    if (!name || !*name) {
-        gui_println("Usage: DEL <filename>");
-        gui_println("Example: DEL myfile.txt");
-        return;
+// Scan done (or cancelled): plan and apply on the UI thread
+void sync_job_finish(void) {
+    SyncJob* job = g_syncJob;
+    if (!job) return;
+    if (job->thread) {
+        pf_thread_join(job->thread);
+        job->thread = NULL;
+        gui_job_end();
     }
-    
-    // Check if file exists in virtual filesystem
-    File* f = fs_find_file(g_cwd, name);
-    if (!f) {
-        gui_println("File not found.");
-        return;
+    if (job->status_shown) gui_status_line(NULL);
+    g_syncJob = NULL;
+
+    BOOL cancelled = pf_atomic_get(&job->cancel) != 0;
+    SyncPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    sync_scan_index(&job->scan);
+    for (int i = 0; i < job->root_count; i++) {
+        if (job->roots[i] >= 0) sync_plan_root(&plan, &job->scan, job->dirs[i], job->roots[i], cancelled);
     }
-    
-    // Remove file from virtual filesystem
-    for (int i = 0; i < g_cwd->file_count; ++i) {
-        if (strcmp(g_cwd->files[i]->name, name) == 0) {
-            free(g_cwd->files[i]);
-            // Shift remaining files
-            for (int j = i; j < g_cwd->file_count - 1; ++j) {
-                g_cwd->files[j] = g_cwd->files[j + 1];
-            }
-            g_cwd->file_count--;
-            break;
+
+    if (job->mode != SYNC_JOB_STARTUP && !cancelled && job->roots[0] < 0) {
+        gui_println("No files found in real directory or directory doesn't exist.");
+    } else if (job->mode == SYNC_JOB_STATUS) {
+        sync_print_status(&plan, job->rel[0]);
+        if (cancelled) gui_println("Cancelled: only the folders scanned so far are listed.");
+    } else {
+        SyncReport report;
+        sync_apply(&plan, &report);
+        if (!cancelled) g_syncBaseFresh = FALSE;
+        fs_save_to_disk();
+        sync_base_save();
+        if (job->mode == SYNC_JOB_APPLY) {
+            if (cancelled) gui_println("Sync cancelled. Changes in the folders scanned so far were applied; run SYNC again to finish.");
+            sync_print_report(&report);
+        } else if (cancelled) {
+            gui_println("Startup sync cancelled. Changes in the folders scanned so far were applied; run SYNC to finish.");
+        } else if (report.conflicts > 0) {
+            gui_printf("Sync found %d conflict(s). Use SYNC STATUS to review them.", report.conflicts);
         }
     }
-    
-    // Remove file from real filesystem
+
+    BOOL prompt = job->prompt_pending;
+    sync_plan_free(&plan);
+    sync_job_free(job);
+    if (prompt) gui_show_prompt_when_idle();
+}
+
+void sync_job_cancel(void) {
+    if (!g_syncJob) return;
+    pf_atomic_set(&g_syncJob->cancel, 1);
+    sync_job_poll();
+}
+
+// Window closing: stop the scan and drop its results unapplied
+void sync_job_abandon(void) {
+    SyncJob* job = g_syncJob;
+    if (!job) return;
+    pf_atomic_set(&job->cancel, 1);
+    if (job->thread) {
+        pf_thread_join(job->thread);
+        gui_job_end();
+    }
+    g_syncJob = NULL;
+    sync_job_free(job);
+}
+
+static long sync_base_count_under(const char* prefix) {
+    size_t len = strlen(prefix);
+    long count = 0;
+    for (int i = 0; i < SYNC_BASE_BUCKETS; i++) {
+        for (SyncBase* b = g_syncBase[i]; b; b = b->next) {
+            if (b->content && _strnicmp(b->path, prefix, len) == 0 && b->path[len] == '\\') count++;
+        }
+    }
+    return count;
+}
+
+// Scan the given VFS directories in the background. Without a front end
+// event loop (or if the thread cannot start) the scan runs inline and
+// finishes before returning.
+static BOOL sync_job_start(SyncJobMode mode, Directory** dirs, int count) {
+    if (g_syncJob) {
+        gui_println("A sync is already running.");
+        return FALSE;
+    }
+    sync_base_load();
+
+    SyncJob* job = (SyncJob*)calloc(1, sizeof(SyncJob));
+    if (!job) return FALSE;
+    job->mode = mode;
+    job->scan.cancel = &job->cancel;
+    for (int i = 0; i < count && i < SYNC_MAX_ROOTS; i++) {
+        char rel[1024];
+        vfs_rel_path(dirs[i], rel, sizeof(rel));
+        job->dirs[i] = dirs[i];
+        job->rel[i] = _strdup(rel);
+        job->walks[i] = (IgnoreWalk*)malloc(sizeof(IgnoreWalk));
+        job->roots[i] = -1;
+        job->root_count++;
+        if (!job->rel[i] || !job->walks[i]) {
+            sync_job_free(job);
+            return FALSE;
+        }
+        ignore_walk_begin_at(job->walks[i], dirs[i]);
+        ignore_walk_detach(job->walks[i]);
+        job->expected_files += sync_base_count_under(rel);
+    }
+    job->started = pf_ticks_ms();
+    g_syncJob = job;
+
+    // A script's next line must see the sync finished
+    if (!script_running() && gui_job_begin()) {
+        job->thread = pf_thread_start(sync_job_thread, job);
+        if (!job->thread) gui_job_end();
+    }
+    if (!job->thread) {
+        sync_job_scan(job);
+        pf_atomic_set(&job->finished, 1);
+        sync_job_finish();
+    }
+    return TRUE;
+}
+
+static void sync_all_directories(void) {
     char program_dir[1024];
     get_main_project_dir(program_dir, sizeof(program_dir));
+
+    char users_dir[1024];
+    snprintf(users_dir, sizeof(users_dir), "%s\\data\\USERS", program_dir);
+
+    // Check if USERS directory exists
+    if (pf_path_kind(users_dir) != PF_PATH_DIR) {
+        return; // No USERS directory
+    }
+
+    Directory* users[SYNC_MAX_ROOTS];
+    int count = 0;
+    for (int i = 0; i < g_root->child_count; i++) {
+        Directory* user_dir = g_root->children[i];
+        if (!user_dir) continue;
+
+        char user_real_path[1024];
+        snprintf(user_real_path, sizeof(user_real_path), "%s\\%s", users_dir, user_dir->name);
+        if (pf_path_kind(user_real_path) != PF_PATH_DIR) {
+            continue; // Users without a real directory stay VFS-only
+        }
+
+        // Ensure preset directories exist in real filesystem
+        char docs_path[1024], desktop_path[1024], downloads_path[1024], settings_path[1024];
+        snprintf(docs_path, sizeof(docs_path), "%s\\Documents", user_real_path);
+        snprintf(desktop_path, sizeof(desktop_path), "%s\\Desktop", user_real_path);
+        snprintf(downloads_path, sizeof(downloads_path), "%s\\Downloads", user_real_path);
+        snprintf(settings_path, sizeof(settings_path), "%s\\Settings", user_real_path);
+
+        pf_mkdir(docs_path);
+        pf_mkdir(desktop_path);
+        pf_mkdir(downloads_path);
+        pf_mkdir(settings_path);
+
+        users[count++] = user_dir;
+    }
+    if (count > 0) sync_job_start(SYNC_JOB_STARTUP, users, count);
+}
+
+// Helper function to recursively save filesystem
+static void save_filesystem_recursive(Directory* dir, FILE* f, const char* path, IgnoreWalk* walk) {
+    if (!dir || !f) return;
     
-    char virtual_path[1024];
-    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+    // Save current directory
+    fprintf(f, "DIR:%s\n", path);
     
-    char real_path[1024];
-    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-    if (profiles_pos) {
-        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-    } else {
-        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    // Save files in this directory
+    for (int i = 0; i < dir->file_count; ++i) {
+        if (dir->files[i] && !ignore_walk_check(walk, dir->files[i]->name, FALSE)) {
+            // Escape pipe characters and line breaks in content
+            static char escaped_content[MAX_FILE_SIZE * 2 + 1];
+            fs_escape_content(dir->files[i]->content, escaped_content, sizeof(escaped_content));
+            fprintf(f, "FILE:%s|%s\n", dir->files[i]->name, escaped_content);
+        }
     }
     
-    char full_real_path[1024];
-    join_path(full_real_path, sizeof(full_real_path), real_path, name);
-    
-    // Delete the file from real filesystem
-    BOOL result = DeleteFileA(full_real_path);
-    if (result) {
-        gui_println("File deleted from both terminal and File Explorer.");
+    // Recursively save subdirectories
+    for (int i = 0; i < dir->child_count; ++i) {
+        if (dir->children[i] && !ignore_walk_check(walk, dir->children[i]->name, TRUE)) {
+            char new_path[1024];
+            snprintf(new_path, sizeof(new_path), "%s\\%s", path, dir->children[i]->name);
+            IgnoreMark mark;
+            ignore_walk_enter_dir(walk, dir->children[i], &mark);
+            save_filesystem_recursive(dir->children[i], f, new_path, walk);
+            ignore_walk_leave(walk, &mark);
+        }
+    }
+}
+
+// ---------------- Jobs ----------------
+// Commands that run an external program start it with job_start. A worker
+// thread reads what the program writes and wakes the front end, and on its
+// thread jobs_wake prints the lines and, once the program exits, runs the
+// command's follow-up. The window keeps painting and scrolling meanwhile. A
+// foreground job holds the prompt until it ends and Ctrl+C kills it; a
+// command line ending in '&' leaves it in the background, where JOBS lists
+// it, FG waits for it and KILL stops it. Without an event loop, in a script
+// or inside a pipeline a job runs inline, the way these commands always did.
+static Job* g_jobs = NULL;                // oldest first
+static Job* g_jobFg = NULL;               // the job holding the prompt
+static BOOL g_jobPromptPending = FALSE;   // a prompt waits for g_jobFg to end
+static BOOL g_jobBackground = FALSE;      // the running command line ended in '&'
+static BOOL g_jobWatched = FALSE;         // the running command line is a WATCH run
+static char g_jobLabel[256];              // the running command line
+static BOOL g_jobReprompt = FALSE;        // jobs_wake printed under the prompt
+
+// Strips a trailing '&' (not "&&", not quoted); TRUE if there was one
+static BOOL job_strip_background(char* line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+    if (len == 0 || line[len - 1] != '&' || (len > 1 && line[len - 2] == '&')) return FALSE;
+    int quotes = 0;
+    for (size_t i = 0; i + 1 < len; i++) if (line[i] == '"') quotes++;
+    if (quotes % 2 != 0) return FALSE;
+    len--;
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+    line[len] = '\0';
+    return TRUE;
+}
+
+// ---- Limits ----
+// SET job_time_limit, job_cpu_limit, job_memory_limit and job_output_limit
+// cap every program a command starts; 0 leaves one off. Past a limit the
+// program and everything it started are stopped.
+static int* job_limit_setting(const char* name) {
+    if (strcmp(name, "job_time_limit") == 0) return &g_settings.job_time_limit;
+    if (strcmp(name, "job_cpu_limit") == 0) return &g_settings.job_cpu_limit;
+    if (strcmp(name, "job_memory_limit") == 0) return &g_settings.job_memory_limit;
+    if (strcmp(name, "job_output_limit") == 0) return &g_settings.job_output_limit;
+    return NULL;
+}
+
+static int job_limit_max(const char* name) {
+    if (strcmp(name, "job_memory_limit") == 0) return 1048576;     // MB
+    if (strcmp(name, "job_output_limit") == 0) return 65536;       // MB
+    return 604800;                                                 // seconds: a week
+}
+
+static const char* job_limits_text(void) {
+    static char text[160];
+    size_t len = 0;
+    text[0] = '\0';
+    if (g_settings.job_time_limit) {
+        len += (size_t)snprintf(text + len, sizeof(text) - len, "%stime %d s", len ? ", " : "", g_settings.job_time_limit);
+    }
+    if (g_settings.job_cpu_limit) {
+        len += (size_t)snprintf(text + len, sizeof(text) - len, "%sCPU %d s", len ? ", " : "", g_settings.job_cpu_limit);
+    }
+    if (g_settings.job_memory_limit) {
+        len += (size_t)snprintf(text + len, sizeof(text) - len, "%smemory %d MB", len ? ", " : "", g_settings.job_memory_limit);
+    }
+    if (g_settings.job_output_limit) {
+        snprintf(text + len, sizeof(text) - len, "%soutput %d MB", len ? ", " : "", g_settings.job_output_limit);
+    }
+    return text[0] ? text : "None";
+}
+
+static void job_take_limits(Job* job) {
+    job->time_limit = g_settings.job_time_limit;
+    job->output_limit = (size_t)g_settings.job_output_limit * 1024 * 1024;
+    job->limits.cpu_seconds = g_settings.job_cpu_limit;
+    job->limits.memory_bytes = (unsigned long long)g_settings.job_memory_limit * 1024 * 1024;
+}
+
+static BOOL job_limited(const Job* job) {
+    return job->time_limit > 0 || job->output_limit > 0 ||
+           job->limits.cpu_seconds > 0 || job->limits.memory_bytes > 0;
+}
+
+// On the runner's thread: stop the program for a limit it went past
+static void job_stop_for(Job* job, const char* limit) {
+    if (job->limit_hit) return;
+    job->limit_hit = limit;
+    job->kill_time = pf_seconds();
+    pf_process_kill(job->proc);
+}
+
+// The wall-time limit, and the hard kill for a program that ignored the
+// first one
+static void job_check_time(Job* job) {
+    double now = pf_seconds();
+    if (!job->limit_hit) {
+        if (job->time_limit > 0 && now - job->start_time > job->time_limit) job_stop_for(job, "time");
+    } else if (job->kill_time > 0 && (now - job->kill_time) * 1000.0 > JOB_KILL_GRACE_MS) {
+        pf_process_kill(job->proc);
+        job->kill_time = 0;
+    }
+}
+
+// "1.20 s, CPU 0.95 s, peak 14.2 MB": how long a finished job ran and,
+// when the system says, what it used
+static const char* job_cost(const Job* job) {
+    static char text[96];
+    if (job->borrowed) {
+        snprintf(text, sizeof(text), "%.2f s", job->seconds);
+    } else if (job->usage.peak_memory > 0) {
+        snprintf(text, sizeof(text), "%.2f s, CPU %.2f s, peak %.1f MB", job->seconds,
+                 job->usage.cpu_seconds, job->usage.peak_memory / (1024.0 * 1024.0));
     } else {
-        DWORD error = GetLastError();
-        char error_msg[512];
-        snprintf(error_msg, sizeof(error_msg), "Failed to delete file from File Explorer. Error: %lu", error);
-        gui_println(error_msg);
+        snprintf(text, sizeof(text), "%.2f s, CPU %.2f s", job->seconds, job->usage.cpu_seconds);
     }
-    
-    // Auto-save filesystem
-    fs_save_to_disk();
-    gui_println("File deleted successfully.");
+    return text;
 }
 
-static void cmd_rmdir(const char* name) {
-    if (!name || !*name) {
-        gui_println("Usage: RMDIR <foldername>");
-        gui_println("Example: RMDIR myfolder");
-        return;
+// TRUE if job_start would run a program alongside the UI rather than inline
+static BOOL jobs_async(void) {
+    if (script_running() || !gui_job_begin()) return FALSE;
+    gui_job_end();
+    return TRUE;
+}
+
+static Job* job_find(const char* args) {
+    if (*args == '%') args++;
+    char* end = NULL;
+    long id = strtol(args, &end, 10);
+    if (end == args || *end) return NULL;
+    for (Job* job = g_jobs; job; job = job->next) {
+        if (job->id == id) return job;
     }
-    
-    // Check if directory exists in virtual filesystem
-    Directory* d = fs_find_child(g_cwd, name);
-    if (!d) {
-        gui_println("Directory not found.");
-        return;
+    return NULL;
+}
+
+// Background output goes under the prompt the user may be typing at: on a
+// line of its own, with the prompt shown again below it
+static void job_output_begin(void) {
+    if (!g_promptArmed) return;
+    g_promptArmed = FALSE;
+    g_jobReprompt = TRUE;
+    gui_append("\r\n");
+}
+
+static void job_print_line(Job* job, const char* text) {
+    job_output_begin();
+    if (job->background) {
+        gui_printf("[%d] %s", job->id, text);
+    } else {
+        gui_println(text);
     }
-    
-    // Check if directory is empty
-    if (d->child_count > 0 || d->file_count > 0) {
-        gui_println("Directory is not empty. Use RMDIR /S to force delete.");
+}
+
+// On the UI thread: split what the program wrote into lines. A '\r' on its
+// own starts the line over, as progress counters expect.
+static void job_print(Job* job, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == '\r') {
+            job->cr = TRUE;
+            continue;
+        }
+        if (job->cr && c != '\n') {
+            // What is on screen stays; the new text starts below it
+            if (job->shown > 0) gui_append("\r\n");
+            job->line_len = job->shown = 0;
+        }
+        job->cr = FALSE;
+        if (c == '\n' || job->line_len == JOB_LINE_MAX - 1) {
+            job->line[job->line_len] = '\0';
+            job_print_line(job, job->line + job->shown);
+            job->line_len = job->shown = 0;
+            if (c == '\n') continue;
+        }
+        job->line[job->line_len++] = c;
+    }
+}
+
+static void job_take_output(Job* job) {
+    if (!job->lock) return;
+    pf_mutex_lock(job->lock);
+    char* out = job->out;
+    size_t len = job->out_len;
+    job->out = NULL;
+    job->out_len = job->out_cap = 0;
+    pf_mutex_unlock(job->lock);
+    if (out) {
+        job_print(job, out, len);
+        job->fresh = TRUE;
+        free(out);
+    }
+}
+
+// A program waiting for input has usually written its prompt without a
+// line break: that much goes on screen, and what is typed follows it
+static void job_show_line(Job* job) {
+    if (job->line_len <= job->shown) return;
+    job->line[job->line_len] = '\0';
+    gui_append(job->line + job->shown);
+    job->shown = job->line_len;
+}
+
+// What the program wrote: printed straight away by an inline job, queued
+// for the UI thread otherwise. Only a write into an empty queue wakes the
+// front end; until it has taken that, one wake is already on its way.
+static void job_output(Job* job, const char* data, size_t len) {
+    if (!job->lock) {
+        job_print(job, data, len);
         return;
     }
-    
-    // Remove directory from virtual filesystem
-    for (int i = 0; i < g_cwd->child_count; ++i) {
-        if (strcmp(g_cwd->children[i]->name, name) == 0) {
-            free(g_cwd->children[i]);
-            // Shift remaining directories
-            for (int j = i; j < g_cwd->child_count - 1; ++j) {
-                g_cwd->children[j] = g_cwd->children[j + 1];
+    pf_mutex_lock(job->lock);
+    BOOL wake = job->out_len == 0;
+    if (job->out_len + len > job->out_cap) {
+        size_t cap = job->out_cap ? job->out_cap : 8192;
+        while (cap < job->out_len + len) cap *= 2;
+        char* bigger = (char*)realloc(job->out, cap);
+        if (bigger) {
+            job->out = bigger;
+            job->out_cap = cap;
+        }
+    }
+    if (job->out_len + len <= job->out_cap) {
+        memcpy(job->out + job->out_len, data, len);
+        job->out_len += len;
+    }
+    pf_mutex_unlock(job->lock);
+    if (wake) gui_job_wake();
+}
+
+// job_output up to the output limit; past it the program is stopped and
+// the rest dropped
+static void job_forward(Job* job, const char* data, size_t len) {
+    if (job->output_limit > 0 && len > job->output_limit - job->output_total) {
+        len = job->output_limit - job->output_total;
+        job_stop_for(job, "output");
+    }
+    job->output_total += len;
+    if (len > 0) job_output(job, data, len);
+}
+
+// Length of the longest tail of data that could be the start of mark
+static size_t job_mark_tail(const char* data, size_t len, const char* mark, size_t mark_len) {
+    size_t keep = len < mark_len - 1 ? len : mark_len - 1;
+    for (; keep > 0; keep--) {
+        if (memcmp(data + len - keep, mark, keep) == 0) break;
+    }
+    return keep;
+}
+
+// The runner for an attached job: output up to the end-of-run line. Bytes
+// that may be the start of that line are held back until the next read
+// settles it.
+static void job_pump_until(Job* job) {
+    char buf[4096 + JOB_MARK_MAX + 16];
+    size_t held = 0;
+    size_t mark_len = strlen(job->until);
+    job->until_code = -1;
+    for (;;) {
+        int n = pf_process_read_timeout(job->proc, buf + held, 4096, JOB_POLL_MS);
+        job_check_time(job);
+        if (n == PF_READ_TIMEOUT) continue;
+        if (n <= 0) {
+            job_forward(job, buf, held);
+            break;
+        }
+        size_t len = held + (size_t)n;
+        char* hit = NULL;
+        for (size_t i = 0; i + mark_len <= len && !hit; i++) {
+            if (memcmp(buf + i, job->until, mark_len) == 0) hit = buf + i;
+        }
+        if (hit) {
+            size_t before = (size_t)(hit - buf);
+            job_forward(job, buf, before);
+            len -= before;
+            memmove(buf, hit, len);
+            char* nl = (char*)memchr(buf + mark_len, '\n', len - mark_len);
+            if (nl || len >= sizeof(buf) - 4096) {
+                if (nl) job->until_code = atoi(buf + mark_len);
+                break;
             }
-            g_cwd->child_count--;
+            held = len;
+            continue;
+        }
+        held = job_mark_tail(buf, len, job->until, mark_len);
+        job_forward(job, buf, len - held);
+        memmove(buf, buf + len - held, held);
+    }
+    job->seconds = pf_seconds() - job->start_time;
+}
+
+// The runner: output as it comes, in whatever chunks the pipe gives, until
+// the pipe closes. Something the program started may keep the pipe open
+// after the program itself has exited (a dev server npm left running), so
+// the reads time out now and then to check, and once it has exited what is
+// already in the pipe is the last of it.
+static void job_pump(Job* job) {
+    if (job->borrowed) {
+        job_pump_until(job);
+        return;
+    }
+    char buf[4096];
+    BOOL exited = FALSE;
+    for (;;) {
+        int n = pf_process_read_timeout(job->proc, buf, sizeof(buf), exited ? 0 : JOB_POLL_MS);
+        if (n > 0) {
+            job_forward(job, buf, (size_t)n);
+        } else if (n == 0 || exited) {
             break;
+        } else {
+            exited = pf_process_exited(job->proc);
         }
+        job_check_time(job);
     }
-    
-    // Remove directory from real filesystem
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char virtual_path[1024];
-    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-    
-    char real_path[1024];
-    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-    if (profiles_pos) {
-        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+    // A program with its own console has no pipe to time out on
+    while (job->time_limit > 0 && !pf_process_exited(job->proc)) {
+        pf_sleep_ms(JOB_POLL_MS);
+        job_check_time(job);
+    }
+    // What it started may have outlived the first kill
+    if (job->limit_hit && job->kill_time > 0) pf_process_kill(job->proc);
+    pf_process_join(job->proc);
+    job->seconds = pf_seconds() - job->start_time;
+}
+
+static int job_thread(void* param) {
+    Job* job = (Job*)param;
+    job_pump(job);
+    pf_atomic_set(&job->finished, 1);
+    gui_job_wake();
+    return 0;
+}
+
+static void job_free(Job* job) {
+    pf_mutex_free(job->lock);
+    free(job->out);
+    free(job);
+}
+
+// The program has exited: print the rest, then run done where the command
+// was typed, as part of the same command line
+static void job_finish(Job* job) {
+    if (job->thread) {
+        pf_thread_join(job->thread);
+        job->thread = NULL;
+        gui_job_end();
+    }
+    job_take_output(job);
+    if (job->line_len > 0) {
+        job->line[job->line_len] = '\0';
+        job_print_line(job, job->line + job->shown);
+        job->line_len = job->shown = 0;
+    }
+    if (job->status_shown) gui_status_line(NULL);
+    for (Job** link = &g_jobs; *link; link = &(*link)->next) {
+        if (*link == job) {
+            *link = job->next;
+            break;
+        }
+    }
+    if (g_jobFg == job) g_jobFg = NULL;
+    int exit_code = job->borrowed ? job->until_code : pf_process_wait_usage(job->proc, &job->usage);
+    job_output_begin();
+    if (!job->limit_hit && job->usage.cpu_limit_hit) job->limit_hit = "cpu";
+
+    if (job->killed) {
+        script_note_error("Killed.");
+        if (job->background) {
+            gui_printf("[%d] Killed  %s", job->id, job->label);
+        } else {
+            gui_println("Killed.");
+        }
+    } else if (job->limit_hit) {
+        char text[320];
+        if (strcmp(job->limit_hit, "time") == 0) {
+            snprintf(text, sizeof(text), "Error: stopped after the %.0f s time limit (%s).", job->time_limit, job_cost(job));
+        } else if (strcmp(job->limit_hit, "output") == 0) {
+            snprintf(text, sizeof(text), "Error: stopped at the %d MB output limit (%s).",
+                     (int)(job->output_limit / (1024 * 1024)), job_cost(job));
+        } else {
+            snprintf(text, sizeof(text), "Error: stopped at the %.0f s CPU time limit (%s).",
+                     job->limits.cpu_seconds, job_cost(job));
+        }
+        script_note_error(text);
+        job_print_line(job, text);
     } else {
-        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+        // Allocations past the limit fail, so nothing says it was the limit
+        // that made the program fail; peak use close to it is the sign
+        if (exit_code != 0 && job->limits.memory_bytes > 0 &&
+            job->usage.peak_memory >= job->limits.memory_bytes / 10 * 9) {
+            char text[160];
+            snprintf(text, sizeof(text), "Note: it used %.1f MB of its %.0f MB memory limit.",
+                     job->usage.peak_memory / (1024.0 * 1024.0), job->limits.memory_bytes / (1024.0 * 1024.0));
+            job_print_line(job, text);
+        }
+        if (job->background) gui_printf("[%d] Done  %s  %s", job->id, job_cost(job), job->label);
+        if (job->done) {
+            BOOL background = g_jobBackground;
+            BOOL watched = g_jobWatched;
+            char label[sizeof(g_jobLabel)];
+            memcpy(label, g_jobLabel, sizeof(label));
+            Directory* cwd = g_cwd;
+            Directory* started_in = vfs_walk_dirs(job->cwd, sync_path_segments(job->cwd), FALSE);
+            if (started_in) g_cwd = started_in;
+            g_jobBackground = job->background;
+            g_jobWatched = job->watched;
+            snprintf(g_jobLabel, sizeof(g_jobLabel), "%s", job->label);
+
+            job->done(job, exit_code);
+
+            if (g_cwd == started_in) g_cwd = cwd;
+            g_jobBackground = background;
+            g_jobWatched = watched;
+            memcpy(g_jobLabel, label, sizeof(label));
+        }
+    }
+    job_free(job);
+
+    if (!g_jobFg && g_jobPromptPending) {
+        g_jobPromptPending = FALSE;
+        gui_show_prompt_when_idle();
+    }
+}
+
+// A job for a program that is running: pumped by a thread when async, else
+// right here to the end. label is used when no command set one.
+static void job_run(Job* job, BOOL async, const char* label, const char* cwd, JobDoneFn done, const char* arg) {
+    job->id = 1;
+    for (Job* j = g_jobs; j; j = j->next) {
+        if (j->id >= job->id) job->id = j->id + 1;
+    }
+    snprintf(job->label, sizeof(job->label), "%s", g_jobLabel[0] ? g_jobLabel : label);
+    job->background = g_jobBackground;
+    job->watched = g_jobWatched;
+    job->started = pf_ticks_ms();
+    job->done = done;
+    vfs_rel_path(g_cwd, job->cwd, sizeof(job->cwd));
+    snprintf(job->dir, sizeof(job->dir), "%s", cwd ? cwd : "");
+    snprintf(job->arg, sizeof(job->arg), "%s", arg ? arg : "");
+
+    if (job->lock) job->thread = pf_thread_start(job_thread, job);
+    if (async && !job->thread) gui_job_end();
+    if (!job->thread) {
+        pf_mutex_free(job->lock);
+        job->lock = NULL;
+        job->background = FALSE;
+        job_pump(job);
+        job_finish(job);
+        return;
     }
-    
-    char full_real_path[1024];
-    join_path(full_real_path, sizeof(full_real_path), real_path, name);
-    
-    // Delete the directory from real filesystem
-    BOOL result = RemoveDirectoryA(full_real_path);
-    if (result) {
-        char msg[512];
-        snprintf(msg, sizeof(msg), "Directory deleted from both terminal and File Explorer: %s", full_real_path);
-        gui_println(msg);
+
+    Job** tail = &g_jobs;
+    while (*tail) tail = &(*tail)->next;
+    *tail = job;
+    if (job->background) {
+        gui_printf("[%d] %s", job->id, job->label);
     } else {
-        char msg[512];
-        snprintf(msg, sizeof(msg), "Directory deleted from terminal. Real directory deletion failed: %s", full_real_path);
-        gui_println(msg);
+        g_jobFg = job;
+    }
+}
+
+// Starts a job for job_start or job_start_argv; command_line is its label
+// when no command set one, and what pf_spawn runs when argv is NULL
+static BOOL job_launch(const char* command_line, const char* const* argv, const char* const* env,
+                       const char* cwd, int flags, JobDoneFn done, const char* arg) {
+    Job* job = (Job*)calloc(1, sizeof(Job));
+    if (!job) return FALSE;
+    // A script's next line must see the program finished
+    BOOL async = !script_running() && gui_job_begin();
+    if (async) job->lock = pf_mutex_create();
+    // A program with its own console writes around the engine's buffer
+    if (!(flags & PF_SPAWN_CAPTURE)) output_sync();
+    // Lines typed while it holds the terminal reach it through the pipe;
+    // inline, it reads the front end's own stdin
+    if (!async || g_jobBackground) flags &= ~PF_SPAWN_STDIN;
+    job->input = (flags & PF_SPAWN_STDIN) != 0;
+    job->start_time = pf_seconds();
+    job_take_limits(job);
+    // Its own group so a limit can stop everything it started
+    if (job->lock || job_limited(job)) flags |= PF_SPAWN_GROUP;
+    job->proc = pf_spawn_limited(command_line, argv, cwd, env, flags, &job->limits);
+    if (!job->proc) {
+        if (async) gui_job_end();
+        job_free(job);
+        return FALSE;
     }
-    
-    // Auto-save filesystem
-    fs_save_to_disk();
-    gui_println("Directory deleted successfully.");
+    job_run(job, async, command_line, cwd, done, arg);
+    return TRUE;
 }
 
-// Trash system for soft deletes
-typedef struct TrashItem {
-    char name[256];
-    char path[1024];
-    int is_directory;
-    char content[4096]; // For files
-    struct TrashItem* next;
-} TrashItem;
+// A job for one run of proc, a captured program that stays up between runs
+// and ends each one with a line "<until><exit code>", which done gets. The
+// caller has already told it what to run. KILL and Ctrl+C end proc itself.
+static BOOL job_attach(PfProcess* proc, const char* label, const char* until, const char* cwd,
+                       JobDoneFn done, const char* arg) {
+    Job* job = (Job*)calloc(1, sizeof(Job));
+    if (!job) return FALSE;
+    BOOL async = !script_running() && gui_job_begin();
+    if (async) job->lock = pf_mutex_create();
+    job->start_time = pf_seconds();
+    job->proc = proc;
+    job->borrowed = TRUE;
+    // proc was started without the system limits; only the runner's apply
+    job_take_limits(job);
+    job->limits.cpu_seconds = 0;
+    job->limits.memory_bytes = 0;
+    snprintf(job->until, sizeof(job->until), "%s", until);
+    job_run(job, async, label, cwd, done, arg);
+    return TRUE;
+}
 
-static TrashItem* g_trash = NULL;
+// Runs command_line (pf_spawn flags) in cwd for the running command. done,
+// if set, gets the exit code once the program ends, unless it was killed;
+// job->dir is cwd and job->arg is arg. FALSE if the program could not be
+// started, in which case nothing was printed.
+static BOOL job_start(const char* command_line, const char* cwd, int flags, JobDoneFn done, const char* arg) {
+    return job_launch(command_line, NULL, NULL, cwd, flags, done, arg);
+}
+
+// The same for argv run directly (pf_spawn_argv), with env added to the
+// child's environment
+static BOOL job_start_argv(const char* const* argv, const char* const* env, const char* cwd, int flags,
+                           JobDoneFn done, const char* arg) {
+    char label[256];
+    size_t len = 0;
+    label[0] = '\0';
+    for (const char* const* a = argv; *a && len + 1 < sizeof(label); a++) {
+        len += (size_t)snprintf(label + len, sizeof(label) - len, len ? " %s" : "%s", *a);
+    }
+    return job_launch(label, argv, env, cwd, flags, done, arg);
+}
+
+// After gui_job_wake, on the front end's thread: print what the jobs wrote
+// and finish the ones that have exited
+void jobs_wake(void) {
+    if (g_syncJob && pf_atomic_get(&g_syncJob->finished)) sync_job_finish();
+    if (build_job_active()) {
+        g_commandDepth++;
+        build_job_wake();
+        if (--g_commandDepth == 0) gui_flush();
+    }
+    if (!g_jobs) return;
+    // Lines would land in the middle of the text being edited
+    if (editor_active()) {
+        g_jobWakeDeferred = TRUE;
+        return;
+    }
 
-static void add_to_trash(const char* name, const char* path, int is_directory, const char* content) {
-    TrashItem* item = (TrashItem*)malloc(sizeof(TrashItem));
-    if (!item) return;
-    
-    strncpy(item->name, name, sizeof(item->name) - 1);
-    item->name[sizeof(item->name) - 1] = '\0';
-    
-    strncpy(item->path, path, sizeof(item->path) - 1);
-    item->path[sizeof(item->path) - 1] = '\0';
-    
-    item->is_directory = is_directory;
-    
-    if (content) {
-        strncpy(item->content, content, sizeof(item->content) - 1);
-        item->content[sizeof(item->content) - 1] = '\0';
+    g_jobReprompt = FALSE;
+    g_commandDepth++;
+    Job* job = g_jobs;
+    while (job) {
+        Job* next = job->next;
+        if (pf_atomic_get(&job->finished)) {
+            job_finish(job);
+        } else {
+            job_take_output(job);
+        }
+        job = next;
+    }
+    if (--g_commandDepth == 0) gui_flush();
+    if (g_jobReprompt) gui_show_prompt_when_idle();
+}
+
+// Ticker: the foreground job's status line. Quick programs never show one.
+void jobs_poll(void) {
+    sync_job_poll();
+    build_job_poll();
+    watch_poll();
+    Job* job = g_jobFg;
+    if (!job) return;
+    // Quiet for a tick with a line left open: it is likely waiting for input
+    if (job->input && !job->fresh) job_show_line(job);
+    job->fresh = FALSE;
+    unsigned long elapsed = pf_ticks_ms() - job->started;
+    if (elapsed < JOB_STATUS_DELAY_MS && !job->killed) return;
+
+    char text[512];
+    if (job->killed) {
+        snprintf(text, sizeof(text), "Stopping %s...", job->label);
     } else {
-        item->content[0] = '\0';
+        snprintf(text, sizeof(text), "Running %s (%lu:%02lu) - Ctrl+C to stop",
+                 job->label, elapsed / 60000, elapsed / 1000 % 60);
     }
-    
-    item->next = g_trash;
-    g_trash = item;
+    gui_status_line(text);
+    job->status_shown = TRUE;
 }
 
-static void cmd_softdel(const char* name) {
-    if (!name || !*name) {
-        gui_println("Usage: SOFTDEL <filename> or SOFTDEL <foldername>");
-        gui_println("         SOFTDEL /S <filename> (soft delete - terminal only)");
-        gui_println("Example: SOFTDEL myfile.txt (deletes from both terminal and File Explorer)");
-        gui_println("         SOFTDEL /S myfile.txt (soft delete - terminal only)");
-        gui_println("Note: Default behavior deletes from both terminal and File Explorer");
-        return;
-    }
-    
-    // Check for soft delete flag
-    int soft_delete_only = 0;
-    if (strncmp(name, "/S ", 3) == 0) {
-        soft_delete_only = 1;
-        name += 3; // Skip "/S "
-        // Skip leading spaces
-        while (*name && isspace((unsigned char)*name)) name++;
+// A sync, a build or a foreground job has the terminal: keys other than
+// Ctrl+C wait
+BOOL jobs_foreground(void) {
+    return g_syncJob != NULL || build_job_active() || g_jobFg != NULL;
+}
+
+// Ctrl+C while jobs_foreground
+void jobs_interrupt(void) {
+    if (g_syncJob) {
+        sync_job_cancel();
+    } else if (build_job_active()) {
+        build_job_cancel();
+    } else if (g_jobFg && !g_jobFg->killed) {
+        g_jobFg->killed = TRUE;
+        pf_process_kill(g_jobFg->proc);
+        jobs_poll();
     }
-    
-    // Check if it's a file
-    File* f = fs_find_file(g_cwd, name);
-    if (f) {
-        // Get current path for trash
-        char current_path[1024];
-        fs_print_path(g_cwd, current_path, sizeof(current_path));
-        
-        if (soft_delete_only) {
-            // Add to trash (soft delete - terminal only)
-            add_to_trash(name, current_path, 0, f->content);
-        } else {
-            // Delete from real filesystem
-            char program_dir[1024];
-            get_main_project_dir(program_dir, sizeof(program_dir));
-            
-            char virtual_path[1024];
-            fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-            
-            char real_path[1024];
-            const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-            if (profiles_pos) {
-                snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-            } else {
-                snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-            }
-            
-            char full_real_path[1024];
-            join_path(full_real_path, sizeof(full_real_path), real_path, name);
-            
-            // Delete the file from real filesystem
-            BOOL delete_result = DeleteFileA(full_real_path);
-            if (!delete_result) {
-                DWORD error = GetLastError();
-                char error_msg[512];
-                snprintf(error_msg, sizeof(error_msg), "Warning: Failed to delete file from File Explorer. Error: %lu", error);
-                gui_println(error_msg);
+}
+
+// The foreground program reads what is typed (it was started with
+// PF_SPAWN_STDIN): keys go to the input line instead of waiting
+BOOL jobs_input_wanted(void) {
+    return !g_syncJob && !build_job_active() && g_jobFg && g_jobFg->input && !g_jobFg->killed;
+}
+
+// Enter while jobs_input_wanted: the line shows after the program's open
+// prompt and goes to its stdin. NULL ends its input (Ctrl+Z or Ctrl+D).
+void jobs_input(const char* line) {
+    Job* job = g_jobFg;
+    if (!jobs_input_wanted()) return;
+    if (!line) {
+        pf_process_close_input(job->proc);
+        job->input = FALSE;
+        return;
+    }
+    job_take_output(job);
+    job_show_line(job);
+    gui_println(line);
+    job->line_len = job->shown = 0;
+    job->cr = FALSE;
+    // A program that has stopped reading just misses the line
+    if (pf_process_write(job->proc, line, strlen(line))) pf_process_write(job->proc, "\n", 1);
+}
+
+// Window closing: stop the sync and every program still running
+void jobs_abandon(void) {
+    watch_abandon();
+    sync_job_abandon();
+    build_job_abandon();
+    while (g_jobs) {
+        Job* job = g_jobs;
+        g_jobs = job->next;
+        pf_process_kill(job->proc);
+        pf_thread_join(job->thread);
+        gui_job_end();
+        if (!job->borrowed) pf_process_wait(job->proc);
+        job_free(job);
+    }
+    g_jobFg = NULL;
+    python_worker_stop();
+}
+
+// Show the prompt now, or once the running sync, build or foreground job
+// has ended
+void gui_show_prompt_when_idle(void) {
+    if (g_syncJob) {
+        g_syncJob->prompt_pending = TRUE;
+    } else if (build_job_active()) {
+        build_job_hold_prompt();
+    } else if (g_jobFg) {
+        g_jobPromptPending = TRUE;
+    } else {
+        gui_show_prompt_and_arm_input();
+    }
+}
+
+static void cmd_jobs(void) {
+    if (!g_jobs) {
+        gui_println("No jobs. End a command line with & to run its program in the background.");
+        return;
+    }
+    for (Job* job = g_jobs; job; job = job->next) {
+        unsigned long elapsed = pf_ticks_ms() - job->started;
+        gui_printf("[%d] %-8s %lu:%02lu  %s", job->id, job->killed ? "Stopping" : "Running",
+                   elapsed / 60000, elapsed / 1000 % 60, job->label);
+    }
+}
+
+static void cmd_fg(const char* args) {
+    Job* job = NULL;
+    if (args && *args) {
+        job = job_find(args);
+        if (!job) {
+            gui_errorf("No such job: %s", args);
+            return;
+        }
+    } else {
+        for (Job* j = g_jobs; j; j = j->next) job = j;
+        if (!job) {
+            gui_println("No background jobs.");
+            return;
+        }
+    }
+    // The prompt now waits for it, and its lines lose the [id]
+    job->background = FALSE;
+    g_jobFg = job;
+    gui_println(job->label);
+}
+
+static void cmd_kill(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: KILL <id>");
+        gui_println("Stops a background job; JOBS lists them.");
+        gui_println("Example: KILL 1");
+        return;
+    }
+    Job* job = job_find(args);
+    if (!job) {
+        gui_errorf("No such job: %s", args);
+        return;
+    }
+    if (job->killed) return;
+    job->killed = TRUE;
+    pf_process_kill(job->proc);
+}
+
+// ---------------- Watch ----------------
+// WATCH <pattern> -- <command> runs a command line again each time a file
+// matching the pattern changes under the folder it was started in, whether
+// a VFS command changed it (reported through vfs_changed: EDITCODE, WRITE,
+// a sync) or something else did on disk (an editor, the IDE; found by a
+// rescan the ticker starts on a worker thread). A burst of saves counts
+// once it has been quiet for WATCH_DEBOUNCE_MS, and a change that arrives
+// while a run is still going stops that run first. Runs go to the background like a command line
+// ending in '&', so the prompt stays free for editing; WATCH STOP ends it.
+// Files the ignore rules skip never count, so build output and __pycache__
+// are safe, but a pattern matching what the command itself writes would
+// keep it running.
+#define WATCH_SCAN_MS 500
+#define WATCH_DEBOUNCE_MS 300
+#define WATCH_MAX_DEPTH 64
+
+// One rescan of the disk. It runs on a worker thread so a large tree does
+// not hold up the window, with everything it reads copied in first.
+typedef struct {
+    char real[2048];                      // the folder on disk
+    IgnoreRule rule;
+    IgnoreWalk walk;                      // detached: its rule sets are its own
+    unsigned long long sig;
+    int files;
+    BOOL rebase;                          // what it finds is the new baseline, not a change
+    PfThread* thread;
+    PfAtomic cancel;
+    PfAtomic finished;
+} WatchScan;
+
+typedef struct {
+    char pattern[256];
+    IgnoreRule rule;                      // the pattern, against paths relative to the folder
+    char command[1024];
+    char dir[1024];                       // the folder, relative to C:\USERS
+    Directory* root;                      // NULL once the folder is removed from the VFS
+    unsigned long long disk_sig;          // of the matching files on disk
+    int disk_files;
+    unsigned long next_scan;
+    WatchScan* scan;                      // in flight; NULL when none is
+    BOOL rebase;                          // the next scan started sets the baseline
+    BOOL pending;                         // a change the command has not run for yet
+    unsigned long changed_at;             // the latest part of it
+    char changed[MAX_NAME];               // its first file; empty when only the disk saw it
+    BOOL changed_more;                    // and others after it
+    BOOL running;                         // the command line is being started
+    BOOL build;                           // the last run started a BUILD
+    int runs;
+} WatchState;
+
+static WatchState* g_watch = NULL;
+
+// The last run is still going
+static BOOL watch_busy(const WatchState* w) {
+    if (w->build && build_job_active()) return TRUE;
+    for (Job* job = g_jobs; job; job = job->next) {
+        if (job->watched) return TRUE;
+    }
+    return FALSE;
+}
+
+static void watch_cancel_run(WatchState* w) {
+    if (w->build && build_job_active()) build_job_cancel();
+    for (Job* job = g_jobs; job; job = job->next) {
+        if (job->watched && !job->killed) {
+            job->killed = TRUE;
+            pf_process_kill(job->proc);
+        }
+    }
+}
+
+// Adds one hash per matching file to sig, so the order a folder lists its
+// entries in does not matter. rel is the path so far, with '/' separators.
+static void watch_scan_dir(WatchScan* s, const char* real, char* rel, size_t rel_size, size_t rel_len, int depth) {
+    PfDir* dir = pf_dir_open(real);
+    if (!dir) return;
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry) && !pf_atomic_get(&s->cancel)) {
+        if (ignore_walk_check(&s->walk, entry.name, entry.is_dir)) continue;
+        size_t room = rel_size - rel_len;
+        int n = snprintf(rel + rel_len, room, "%s%s", rel_len ? "/" : "", entry.name);
+        if (n <= 0 || (size_t)n >= room) {
+            rel[rel_len] = '\0';
+            continue;
+        }
+        char path[2048];
+        snprintf(path, sizeof(path), "%s\\%s", real, entry.name);
+        if (entry.is_dir) {
+            if (depth < WATCH_MAX_DEPTH) {
+                IgnoreMark mark;
+                ignore_walk_enter(&s->walk, entry.name, &mark);
+                ignore_walk_push_file(&s->walk, path);
+                watch_scan_dir(s, path, rel, rel_size, rel_len + n, depth + 1);
+                ignore_walk_leave(&s->walk, &mark);
             }
+        } else if (ignore_rule_match(&s->rule, rel)) {
+            unsigned long long stamp[2] = { entry.size, (unsigned long long)entry.mtime_ns };
+            s->sig += hash64(rel, rel_len + n) ^ hash64(stamp, sizeof(stamp));
+            s->files++;
         }
-        
-        // Remove file from virtual filesystem
-        for (int i = 0; i < g_cwd->file_count; ++i) {
-            if (strcmp(g_cwd->files[i]->name, name) == 0) {
-                free(g_cwd->files[i]);
-                // Shift remaining files
-                for (int j = i; j < g_cwd->file_count - 1; ++j) {
-                    g_cwd->files[j] = g_cwd->files[j + 1];
-                }
-                g_cwd->file_count--;
-                break;
+        rel[rel_len] = '\0';
+    }
+    pf_dir_close(dir);
+}
+
+static int watch_scan_thread(void* arg) {
+    WatchScan* s = (WatchScan*)arg;
+    char rel[1024] = "";
+    watch_scan_dir(s, s->real, rel, sizeof(rel), 0, 0);
+    ignore_walk_end(&s->walk);
+    pf_atomic_set(&s->finished, 1);
+    gui_job_wake();
+    return 0;
+}
+
+// Starts a rescan unless one is already going
+static void watch_scan_start(WatchState* w) {
+    if (w->scan || !w->root) return;
+    WatchScan* s = (WatchScan*)calloc(1, sizeof(WatchScan));
+    if (!s) return;
+    sync_real_path(w->dir, s->real, sizeof(s->real));
+    s->rule = w->rule;
+    s->rebase = w->rebase;
+    w->rebase = FALSE;
+    ignore_walk_begin_at(&s->walk, w->root);
+    ignore_walk_detach(&s->walk);
+    w->scan = s;
+    s->thread = pf_thread_start(watch_scan_thread, s);
+    if (!s->thread) watch_scan_thread(s);
+}
+
+// The disk as it is from now on is what the next change is measured from
+static void watch_scan_rebase(WatchState* w) {
+    w->rebase = TRUE;
+    watch_scan_start(w);
+}
+
+// Waits for the scan in flight, stopping it early, and drops it
+static void watch_scan_discard(WatchState* w) {
+    WatchScan* s = w->scan;
+    if (!s) return;
+    w->scan = NULL;
+    pf_atomic_set(&s->cancel, 1);
+    if (s->thread) pf_thread_join(s->thread);
+    free(s);
+}
+
+// TRUE if a finished scan found the matching files on disk changed
+static BOOL watch_scan_collect(WatchState* w) {
+    WatchScan* s = w->scan;
+    if (!s || !pf_atomic_get(&s->finished)) return FALSE;
+    if (s->thread) pf_thread_join(s->thread);
+    w->scan = NULL;
+    w->next_scan = pf_ticks_ms() + WATCH_SCAN_MS;
+
+    // A run started since this scan began makes it out of date either way
+    BOOL changed = FALSE;
+    if (s->rebase || !w->rebase) {
+        changed = !s->rebase && (s->sig != w->disk_sig || s->files != w->disk_files);
+        w->disk_sig = s->sig;
+        w->disk_files = s->files;
+    }
+    free(s);
+    return changed;
+}
+
+// name is NULL when the disk scan noticed it
+static void watch_note_change(WatchState* w, const char* name) {
+    if (!w->pending) {
+        w->changed[0] = '\0';
+        w->changed_more = FALSE;
+    }
+    if (name && !w->changed[0]) {
+        snprintf(w->changed, sizeof(w->changed), "%s", name);
+    } else if (name && _stricmp(name, w->changed) != 0) {
+        w->changed_more = TRUE;
+    }
+    w->pending = TRUE;
+    w->changed_at = pf_ticks_ms();
+    // The run in progress is already out of date
+    watch_cancel_run(w);
+}
+
+static void watch_vfs_changed(VfsChange what, Directory* dir, File* file) {
+    WatchState* w = g_watch;
+    // What a run writes itself is not a change
+    if (!w || !w->root || w->running || g_jobWatched || what == VFS_DIR_ADDED) return;
+    if (what == VFS_DIR_REMOVED) {
+        for (Directory* d = w->root; d; d = d->parent) {
+            if (d == dir) {
+                w->root = NULL;
+                return;
             }
         }
-        
-        char msg[256];
-        if (soft_delete_only) {
-            snprintf(msg, sizeof(msg), "File '%s' moved to trash (soft delete - terminal only).", name);
+    }
+
+    // Only what is inside the folder and not ignored; a removed folder
+    // counts whatever it held
+    Directory* chain[WATCH_MAX_DEPTH];
+    int n = 0;
+    Directory* d = dir;
+    for (; d && d != w->root; d = d->parent) {
+        if (n == WATCH_MAX_DEPTH) return;
+        chain[n++] = d;
+    }
+    if (!d) return;
+    if (file) {
+        char rel[1024];
+        size_t len = 0;
+        rel[0] = '\0';
+        for (int i = n - 1; i >= 0 && len < sizeof(rel); --i) {
+            len += (size_t)snprintf(rel + len, sizeof(rel) - len, "%s/", chain[i]->name);
+        }
+        if (len < sizeof(rel)) snprintf(rel + len, sizeof(rel) - len, "%s", file->name);
+        if (!ignore_rule_match(&w->rule, rel)) return;
+    }
+    IgnoreWalk walk;
+    ignore_walk_begin_at(&walk, w->root);
+    BOOL ignored = FALSE;
+    for (int i = n - 1; i >= 0 && !ignored; --i) {
+        IgnoreMark mark;
+        ignored = ignore_walk_check(&walk, chain[i]->name, TRUE);
+        if (!ignored) ignore_walk_enter_dir(&walk, chain[i], &mark);
+    }
+    if (!ignored && file) ignored = ignore_walk_check(&walk, file->name, FALSE);
+    ignore_walk_end(&walk);
+    if (!ignored) watch_note_change(w, file ? file->name : dir->name);
+}
+
+// The command line, as if typed in the watched folder with a '&' after it
+static void watch_run(WatchState* w) {
+    w->pending = FALSE;
+    w->runs++;
+    // What is on disk now is what this run sees, VFS writes mirrored there
+    // included, so the same change does not come round again
+    watch_scan_rebase(w);
+
+    char line[sizeof(w->command)];
+    snprintf(line, sizeof(line), "%s", w->command);
+    BOOL background = g_jobBackground;
+    BOOL watched = g_jobWatched;
+    char label[sizeof(g_jobLabel)];
+    memcpy(label, g_jobLabel, sizeof(label));
+    Directory* cwd = g_cwd;
+    BOOL building = build_job_active();
+    g_cwd = w->root;
+    g_jobBackground = TRUE;
+    g_jobWatched = TRUE;
+    w->running = TRUE;
+    g_commandDepth++;
+
+    command_line_run(line);
+
+    if (--g_commandDepth == 0) gui_flush();
+    w->running = FALSE;
+    w->build = !building && build_job_active();
+    if (g_cwd == w->root) g_cwd = cwd;
+    g_jobBackground = background;
+    g_jobWatched = watched;
+    memcpy(g_jobLabel, label, sizeof(label));
+    // Nor is anything the command wrote before returning
+    watch_scan_rebase(w);
+}
+
+// Stops the watch and the run it has going
+static void watch_stop(const char* why) {
+    WatchState* w = g_watch;
+    if (!w) return;
+    g_watch = NULL;
+    watch_cancel_run(w);
+    watch_scan_discard(w);
+    gui_job_end();
+    gui_printf("Stopped watching %s%s (%d run(s)).", w->pattern, why, w->runs);
+    free(w);
+}
+
+// Window closing
+static void watch_abandon(void) {
+    if (!g_watch) return;
+    watch_scan_discard(g_watch);
+    free(g_watch);
+    g_watch = NULL;
+    gui_job_end();
+}
+
+// From jobs_poll: take in the last rescan and start the next, and run the command once a change has
+// settled and the last run is over. Nothing is printed into the text
+// EDITCODE is taking, nor while a foreground command has the terminal.
+static void watch_poll(void) {
+    WatchState* w = g_watch;
+    if (!w) return;
+    if (!w->root) {
+        g_jobReprompt = FALSE;
+        g_commandDepth++;
+        job_output_begin();
+        watch_stop(": its folder was removed");
+        if (--g_commandDepth == 0) gui_flush();
+        if (g_jobReprompt) gui_show_prompt_when_idle();
+        return;
+    }
+    unsigned long now = pf_ticks_ms();
+    if (watch_scan_collect(w)) watch_note_change(w, NULL);
+    if (w->rebase || (long)(now - w->next_scan) >= 0) watch_scan_start(w);
+    if (!w->pending || now - w->changed_at < WATCH_DEBOUNCE_MS) return;
+    if (watch_busy(w) || editor_active() || jobs_foreground()) return;
+
+    g_jobReprompt = FALSE;
+    g_commandDepth++;
+    job_output_begin();
+    if (!w->changed[0]) {
+        gui_printf("Files changed: %s", w->command);
+    } else if (w->changed_more) {
+        gui_printf("%s and other files changed: %s", w->changed, w->command);
+    } else {
+        gui_printf("%s changed: %s", w->changed, w->command);
+    }
+    watch_run(w);
+    if (--g_commandDepth == 0) gui_flush();
+    if (g_jobReprompt) gui_show_prompt_when_idle();
+}
+
+static void cmd_watch(const char* args) {
+    const char* sep = args ? strstr(args, "--") : NULL;
+    char pattern[256] = "";
+    if (sep) {
+        size_t len = (size_t)(sep - args);
+        while (len > 0 && isspace((unsigned char)args[len - 1])) len--;
+        if (len < sizeof(pattern)) {
+            memcpy(pattern, args, len);
+            pattern[len] = '\0';
+        }
+        sep += 2;
+        while (isspace((unsigned char)*sep)) sep++;
+    }
+    if (!sep && args && str_icmp(args, "STOP") == 0) {
+        if (g_watch) {
+            watch_stop("");
         } else {
-            snprintf(msg, sizeof(msg), "File '%s' deleted from both terminal and File Explorer.", name);
+            gui_println("Nothing is being watched.");
         }
-        gui_println(msg);
-        
-        // Auto-save filesystem
-        fs_save_to_disk();
         return;
     }
+    if (!sep && g_watch && (!args || !*args)) {
+        gui_printf("Watching %s in %s for: %s (%d run(s)%s)", g_watch->pattern, g_watch->dir, g_watch->command,
+                   g_watch->runs, watch_busy(g_watch) ? ", one running" : "");
+        gui_println("WATCH STOP ends it.");
+        return;
+    }
+    if (!pattern[0] || !sep || !*sep) {
+        gui_error("Usage: WATCH <pattern> -- <command>");
+        gui_println("       WATCH STOP");
+        gui_println("Runs the command in the background again each time a file matching the");
+        gui_println("pattern changes in this folder or below. A pattern without a '/' matches");
+        gui_println("at any depth; files the ignore rules skip never count.");
+        gui_println("Example: WATCH *.py -- RUN script.py");
+        gui_println("Example: WATCH src/*.cpp -- RUN src/main.cpp");
+        return;
+    }
+    if (g_watch) {
+        gui_errorf("Error: already watching %s; WATCH STOP ends it first.", g_watch->pattern);
+        return;
+    }
+    if (strlen(sep) >= sizeof(g_watch->command)) {
+        gui_error("Error: the command is too long.");
+        return;
+    }
+
+    WatchState* w = (WatchState*)calloc(1, sizeof(WatchState));
+    if (!w) {
+        gui_error("Out of memory.");
+        return;
+    }
+    snprintf(w->pattern, sizeof(w->pattern), "%s", pattern);
+    snprintf(w->command, sizeof(w->command), "%s", sep);
+
+    // Folder separators either way; without one it matches at any depth
+    char glob[300];
+    for (char* p = pattern; *p; p++) if (*p == '\\') *p = '/';
+    const char* pat = pattern;
+    if (strncmp(pat, "./", 2) == 0) pat += 2;
+    if (*pat == '/') {
+        snprintf(glob, sizeof(glob), "%s", pat + 1);
+    } else if (strchr(pat, '/')) {
+        snprintf(glob, sizeof(glob), "%s", pat);
+    } else {
+        snprintf(glob, sizeof(glob), "**/%s", pat);
+    }
+    if (!ignore_compile_glob(&w->rule, glob)) {
+        gui_error("Error: the pattern is too long.");
+        free(w);
+        return;
+    }
+
+    // It waits for changes, so it needs the window's event loop
+    if (script_running() || !gui_job_begin()) {
+        gui_error("Error: WATCH needs the terminal window; it cannot run in a script or nexus-cli.");
+        free(w);
+        return;
+    }
+    w->root = g_cwd;
+    vfs_rel_path(g_cwd, w->dir, sizeof(w->dir));
+    g_watch = w;
+
+    char where[1024];
+    fs_print_path(g_cwd, where, sizeof(where));
+    gui_printf("Watching %s in %s; WATCH STOP ends it.", w->pattern, where);
+    watch_run(w);
+}
+
+// ---------------- IDE Commands ----------------
+
+// IDE Configuration
+#define MAX_IDES 10
+#define MAX_EDITOR_NAME 32
+#define MAX_EDITOR_PATH 512
+
+typedef struct {
+    char name[MAX_EDITOR_NAME];
+    char path[MAX_EDITOR_PATH];
+    int enabled;
+} IDEConfig;
+
+static IDEConfig g_ide_configs[MAX_IDES];
+static int g_ide_count = 0;
+
+// Initialize IDE configurations
+void init_ide_configs(void) {
+    g_ide_count = 0;
     
-    // Check if it's a directory
-    Directory* d = fs_find_child(g_cwd, name);
-    if (d) {
-        // Get current path for trash
-        char current_path[1024];
-        fs_print_path(g_cwd, current_path, sizeof(current_path));
+    // VS Code detection
+    const char* vscode_paths[] = {
+        "C:\\Users\\%USERNAME%\\AppData\\Local\\Programs\\Microsoft VS Code\\Code.exe",
+        "C:\\Program Files\\Microsoft VS Code\\Code.exe",
+        "C:\\Program Files (x86)\\Microsoft VS Code\\Code.exe"
+    };
+    
+    for (int i = 0; i < 3; i++) {
+        char expanded_path[MAX_EDITOR_PATH];
+        pf_expand_env(vscode_paths[i], expanded_path, sizeof(expanded_path));
         
-        if (soft_delete_only) {
-            // Add to trash (soft delete - terminal only)
-            add_to_trash(name, current_path, 1, NULL);
-        } else {
-            // Delete from real filesystem
-            char program_dir[1024];
-            get_main_project_dir(program_dir, sizeof(program_dir));
-            
-            char virtual_path[1024];
-            fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-            
-            char real_path[1024];
-            const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-            if (profiles_pos) {
-                snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-            } else {
-                snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-            }
-            
-            char full_real_path[1024];
-            join_path(full_real_path, sizeof(full_real_path), real_path, name);
+        if (pf_path_kind(expanded_path) != PF_PATH_NONE) {
+            strcpy(g_ide_configs[g_ide_count].name, "vscode");
+            strcpy(g_ide_configs[g_ide_count].path, expanded_path);
+            g_ide_configs[g_ide_count].enabled = 1;
+            g_ide_count++;
             
-            // Delete the directory from real filesystem
-            BOOL delete_result = RemoveDirectoryA(full_real_path);
-            if (!delete_result) {
-                DWORD error = GetLastError();
-                char error_msg[512];
-                snprintf(error_msg, sizeof(error_msg), "Warning: Failed to delete directory from File Explorer. Error: %lu", error);
-                gui_println(error_msg);
-            }
+            // Add alternative "code" command
+            strcpy(g_ide_configs[g_ide_count].name, "code");
+            strcpy(g_ide_configs[g_ide_count].path, expanded_path);
+            g_ide_configs[g_ide_count].enabled = 1;
+            g_ide_count++;
+            break;
+        }
+    }
+    
+    // Notepad detection
+    const char* notepad_path = "C:\\Windows\\System32\\notepad.exe";
+    if (pf_path_kind(notepad_path) != PF_PATH_NONE) {
+        strcpy(g_ide_configs[g_ide_count].name, "notepad");
+        strcpy(g_ide_configs[g_ide_count].path, notepad_path);
+        g_ide_configs[g_ide_count].enabled = 1;
+        g_ide_count++;
+    }
+    
+    // Notepad++ detection
+    const char* npp_paths[] = {
+        "C:\\Program Files\\Notepad++\\notepad++.exe",
+        "C:\\Program Files (x86)\\Notepad++\\notepad++.exe"
+    };
+    
+    for (int i = 0; i < 2; i++) {
+        if (pf_path_kind(npp_paths[i]) != PF_PATH_NONE) {
+            strcpy(g_ide_configs[g_ide_count].name, "notepad++");
+            strcpy(g_ide_configs[g_ide_count].path, npp_paths[i]);
+            g_ide_configs[g_ide_count].enabled = 1;
+            g_ide_count++;
+            break;
+        }
+    }
+    
+    // Cursor detection
+    const char* cursor_paths[] = {
+        "C:\\Users\\%USERNAME%\\AppData\\Local\\Programs\\cursor\\Cursor.exe",
+        "C:\\Program Files\\Cursor\\Cursor.exe",
+        "C:\\Program Files (x86)\\Cursor\\Cursor.exe"
+    };
+    
+    for (int i = 0; i < 3; i++) {
+        char expanded_path[MAX_EDITOR_PATH];
+        pf_expand_env(cursor_paths[i], expanded_path, sizeof(expanded_path));
+        
+        if (pf_path_kind(expanded_path) != PF_PATH_NONE) {
+            strcpy(g_ide_configs[g_ide_count].name, "cursor");
+            strcpy(g_ide_configs[g_ide_count].path, expanded_path);
+            g_ide_configs[g_ide_count].enabled = 1;
+            g_ide_count++;
+            break;
+        }
+    }
+}
+
+// Find IDE by name
+static int find_ide_by_name(const char* name) {
+    for (int i = 0; i < g_ide_count; i++) {
+        if (strcmp(g_ide_configs[i].name, name) == 0 && g_ide_configs[i].enabled) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Get current working directory for IDE
+static void get_current_working_directory(char* path, size_t path_size) {
+    // Get the main project directory
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    // Build the real path based on current virtual directory
+    if (g_cwd) {
+        // Convert virtual path to real path
+        char virtual_path[1024];
+        fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+        
+        // Find the position after "C:\\USERS\\"
+        char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+        if (profiles_pos) {
+            // Skip "C:\USERS\" and add the rest to the base path
+            char* relative_path = profiles_pos + 7; // Skip "\USERS\"
+            snprintf(path, path_size, "%s\\data\\USERS\\%s", program_dir, relative_path);
+        } else {
+            // Fallback to current user's directory
+            snprintf(path, path_size, "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+        }
+    } else {
+        strcpy(path, "C:\\");
+    }
+}
+
+// Execute IDE
+static int execute_ide(const char* ide_path, const char* working_dir) {
+    // Build command line with new window flags
+    char command_line[1024];
+    
+    // Check if it's VS Code or Cursor (they use similar arguments)
+    const char* exe_name = strrchr(ide_path, '\\');
+    if (exe_name) exe_name++; else exe_name = ide_path;
+    
+    if (strstr(exe_name, "Code.exe") || strstr(exe_name, "Cursor.exe")) {
+        // VS Code and Cursor: use -n for new window
+        snprintf(command_line, sizeof(command_line), "\"%s\" -n \"%s\"", ide_path, working_dir);
+    } else if (strstr(exe_name, "notepad++.exe")) {
+        // Notepad++: use -multiInst for new instance
+        snprintf(command_line, sizeof(command_line), "\"%s\" -multiInst \"%s\"", ide_path, working_dir);
+    } else {
+        // Default: just open the directory
+        snprintf(command_line, sizeof(command_line), "\"%s\" \"%s\"", ide_path, working_dir);
+    }
+    
+    // Start it in its own window and let it run
+    output_sync();
+    PfProcess* proc = pf_spawn(command_line, working_dir, PF_SPAWN_CONSOLE);
+    if (proc) {
+        pf_process_detach(proc);
+        return 1;
+    }
+    
+    return 0;
+}
+
+// IDE command implementation
+static void cmd_ide(const char* args) {
+    if (!args || !*args) {
+        cmd_ide_help();
+        return;
+    }
+    
+    // Parse arguments
+    char editor_name[64];
+    if (sscanf(args, "%63s", editor_name) != 1) {
+        cmd_ide_help();
+        return;
+    }
+    
+    // Find the IDE
+    int ide_index = find_ide_by_name(editor_name);
+    if (ide_index == -1) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "IDE '%s' not found. Use 'IDE LIST' to see available editors.", editor_name);
+        gui_println(msg);
+        return;
+    }
+    
+    // Get current working directory
+    char working_dir[1024];
+    get_current_working_directory(working_dir, sizeof(working_dir));
+    
+    // Execute the IDE
+    if (execute_ide(g_ide_configs[ide_index].path, working_dir)) {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Opening %s in %s...", g_ide_configs[ide_index].name, working_dir);
+        gui_println(msg);
+    } else {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Failed to open %s. Please check if it's installed.", g_ide_configs[ide_index].name);
+        gui_println(msg);
+    }
+}
+
+// IDE help command
+static void cmd_ide_help(void) {
+    gui_println("IDE Command Help:");
+    gui_println("================");
+    gui_println("Usage: IDE <editor>");
+    gui_println("");
+    gui_println("Available Editors:");
+    cmd_ide_list();
+    gui_println("");
+    gui_println("Examples:");
+    gui_println("  IDE vscode              - Open VS Code in new window");
+    gui_println("  IDE code                - Alternative VS Code command");
+    gui_println("  IDE cursor              - Open Cursor in new window");
+    gui_println("  IDE notepad             - Open Notepad");
+    gui_println("  IDE notepad++           - Open Notepad++ in new instance");
+    gui_println("");
+    gui_println("Editors will open in new windows in the current terminal directory.");
+}
+
+// IDE list command
+static void cmd_ide_list(void) {
+    gui_println("Available IDEs:");
+    gui_println("===============");
+    
+    for (int i = 0; i < g_ide_count; i++) {
+        if (g_ide_configs[i].enabled) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "  %-12s - %s", g_ide_configs[i].name, g_ide_configs[i].path);
+            gui_println(msg);
+        }
+    }
+    
+    if (g_ide_count == 0) {
+        gui_println("  No IDEs detected. Please install an editor.");
+    }
+}
+
+static void cmd_pwd(void) {
+    char path[1024];
+    fs_print_path(g_cwd, path, sizeof(path));
+    gui_println(path);
+}
+
+
+static void cmd_dir(void) {
+    char head[1024];
+    fs_print_path(g_cwd, head, sizeof(head));
+    char title[1200];
+    snprintf(title, sizeof(title), " Directory of %s", head);
+    gui_println(title);
+    gui_println("");
+    for (int i = 0; i < g_cwd->child_count; ++i) {
+        char line[400];
+        snprintf(line, sizeof(line), "%-24s <DIR>", g_cwd->children[i]->name);
+        gui_println(line);
+    }
+    for (int i = 0; i < g_cwd->file_count; ++i) {
+        gui_println(g_cwd->files[i]->name);
+    }
+}
+
+static void cmd_mkdir(const char* name) {
+    if (!name || !*name) { 
+        gui_error("The syntax of the command is incorrect."); 
+        return; 
+    }
+    
+    // Check if directory already exists in virtual filesystem
+    if (fs_find_child(g_cwd, name)) { 
+        gui_error("A subdirectory or file already exists."); 
+        return; 
+    }
+    
+    // Create the directory in virtual filesystem
+    Directory* d = fs_create_dir(name);
+    if (d) {
+        fs_add_child(g_cwd, d);
+        
+        // Get the real path based on current directory
+        char virtual_path[1024];
+        fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+        
+        // Get program directory
+        char program_dir[1024];
+        get_main_project_dir(program_dir, sizeof(program_dir));
+        
+        // Convert virtual path to real path
+        char real_path[1024];
+        const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+        if (profiles_pos) {
+            snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+        } else {
+            snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+        }
+        
+        // Add the directory name to the path
+        char full_real_path[1024];
+        join_path(full_real_path, sizeof(full_real_path), real_path, name);
+        
+        // Create the directory on disk (hidden)
+        pf_mkdir(full_real_path);
+        
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Directory '%s' created successfully.", name);
+        gui_println(msg);
+        
+        // Auto-save filesystem
+        fs_save_to_disk();
+    } else {
+        gui_error("Failed to create directory.");
+    }
+}
+
+static void cmd_touch(const char* name) {
+    if (!name || !*name) { gui_error("The syntax of the command is incorrect."); return; }
+    if (fs_find_file(g_cwd, name)) { gui_error("File already exists."); return; }
+    
+    // Create the file in virtual filesystem
+    File* f = fs_create_file(name);
+    if (f) {
+        fs_add_file(g_cwd, f);
+        
+        // Get the real path based on current directory
+        char virtual_path[1024];
+        fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+        
+        // Convert virtual path to real path using absolute paths
+        char program_dir[1024];
+        get_main_project_dir(program_dir, sizeof(program_dir));
+        
+        char real_path[1024];
+        const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+        if (profiles_pos) {
+            snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+        } else {
+            snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+        }
+        
+        // Add the filename to the path
+        char full_real_path[1024];
+        join_path(full_real_path, sizeof(full_real_path), real_path, name);
+        
+        
+        // Create empty file on disk (hidden)
+        FILE* fp = pf_fopen(full_real_path, "wb");
+        if (fp) {
+            fclose(fp);
+            gui_println("File created successfully in real filesystem.");
+        } else {
+            gui_error("Failed to create file in real filesystem.");
+        }
+        
+        char msg[256];
+        snprintf(msg, sizeof(msg), "File '%s' created successfully.", name);
+        gui_println(msg);
+        
+        // Auto-save filesystem
+        fs_save_to_disk();
+    }
+}
+
+static void cmd_del(const char* name) {
+    if (!name || !*name) {
+        gui_error("Usage: DEL <filename>");
+        gui_println("Example: DEL myfile.txt");
+        return;
+    }
+    
+    // Check if file exists in virtual filesystem
+    File* f = fs_find_file(g_cwd, name);
+    if (!f) {
+        gui_error("File not found.");
+        return;
+    }
+    
+    // Remove file from virtual filesystem
+    vfs_remove_file(g_cwd, f);
+    
+    // Remove file from real filesystem
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    char virtual_path[1024];
+    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+    
+    char real_path[1024];
+    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+    if (profiles_pos) {
+        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+    } else {
+        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    }
+    
+    char full_real_path[1024];
+    join_path(full_real_path, sizeof(full_real_path), real_path, name);
+    
+    // Delete the file from real filesystem
+    BOOL result = pf_remove(full_real_path);
+    if (result) {
+        gui_println("File deleted from both terminal and File Explorer.");
+    } else {
+        unsigned long error = pf_last_error();
+        char error_msg[512];
+        snprintf(error_msg, sizeof(error_msg), "Failed to delete file from File Explorer. Error: %lu", error);
+        gui_println(error_msg);
+    }
+    
+    // Auto-save filesystem
+    fs_save_to_disk();
+    gui_println("File deleted successfully.");
+}
+
+static void cmd_rmdir(const char* name) {
+    if (!name || !*name) {
+        gui_error("Usage: RMDIR <foldername>");
+        gui_println("Example: RMDIR myfolder");
+        return;
+    }
+    
+    // Check if directory exists in virtual filesystem
+    Directory* d = fs_find_child(g_cwd, name);
+    if (!d) {
+        gui_error("Directory not found.");
+        return;
+    }
+    
+    // Check if directory is empty
+    if (d->child_count > 0 || d->file_count > 0) {
+        gui_error("Directory is not empty. Use RMDIR /S to force delete.");
+        return;
+    }
+    
+    // Remove directory from virtual filesystem
+    vfs_remove_dir(d);
+    
+    // Remove directory from real filesystem
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    char virtual_path[1024];
+    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+    
+    char real_path[1024];
+    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+    if (profiles_pos) {
+        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+    } else {
+        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    }
+    
+    char full_real_path[1024];
+    join_path(full_real_path, sizeof(full_real_path), real_path, name);
+    
+    // Delete the directory from real filesystem
+    BOOL result = pf_rmdir(full_real_path);
+    if (result) {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Directory deleted from both terminal and File Explorer: %s", full_real_path);
+        gui_println(msg);
+    } else {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Directory deleted from terminal. Real directory deletion failed: %s", full_real_path);
+        gui_println(msg);
+    }
+    
+    // Auto-save filesystem
+    fs_save_to_disk();
+    gui_println("Directory deleted successfully.");
+}
+
+// Trash system for soft deletes
+typedef struct TrashItem {
+    char name[256];
+    char path[1024];
+    int is_directory;
+    char content[4096]; // For files
+    struct TrashItem* next;
+} TrashItem;
+
+static TrashItem* g_trash = NULL;
+
+static void add_to_trash(const char* name, const char* path, int is_directory, const char* content) {
+    TrashItem* item = (TrashItem*)malloc(sizeof(TrashItem));
+    if (!item) return;
+    
+    strncpy(item->name, name, sizeof(item->name) - 1);
+    item->name[sizeof(item->name) - 1] = '\0';
+    
+    strncpy(item->path, path, sizeof(item->path) - 1);
+    item->path[sizeof(item->path) - 1] = '\0';
+    
+    item->is_directory = is_directory;
+    
+    if (content) {
+        strncpy(item->content, content, sizeof(item->content) - 1);
+        item->content[sizeof(item->content) - 1] = '\0';
+    } else {
+        item->content[0] = '\0';
+    }
+    
+    item->next = g_trash;
+    g_trash = item;
+}
+
+static void cmd_softdel(const char* name) {
+    if (!name || !*name) {
+        gui_error("Usage: SOFTDEL <filename> or SOFTDEL <foldername>");
+        gui_println("         SOFTDEL /S <filename> (soft delete - terminal only)");
+        gui_println("Example: SOFTDEL myfile.txt (deletes from both terminal and File Explorer)");
+        gui_println("         SOFTDEL /S myfile.txt (soft delete - terminal only)");
+        gui_println("Note: Default behavior deletes from both terminal and File Explorer");
+        return;
+    }
+    
+    // Check for soft delete flag
+    int soft_delete_only = 0;
+    if (strncmp(name, "/S ", 3) == 0) {
+        soft_delete_only = 1;
+        name += 3; // Skip "/S "
+        // Skip leading spaces
+        while (*name && isspace((unsigned char)*name)) name++;
+    }
+    
+    // Check if it's a file
+    File* f = fs_find_file(g_cwd, name);
+    if (f) {
+        // Get current path for trash
+        char current_path[1024];
+        fs_print_path(g_cwd, current_path, sizeof(current_path));
+        
+        if (soft_delete_only) {
+            // Add to trash (soft delete - terminal only)
+            add_to_trash(name, current_path, 0, f->content);
+        } else {
+            // Delete from real filesystem
+            char program_dir[1024];
+            get_main_project_dir(program_dir, sizeof(program_dir));
+            
+            char virtual_path[1024];
+            fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+            
+            char real_path[1024];
+            const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+            if (profiles_pos) {
+                snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+            } else {
+                snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+            }
+            
+            char full_real_path[1024];
+            join_path(full_real_path, sizeof(full_real_path), real_path, name);
+            
+            // Delete the file from real filesystem
+            BOOL delete_result = pf_remove(full_real_path);
+            if (!delete_result) {
+                unsigned long error = pf_last_error();
+                char error_msg[512];
+                snprintf(error_msg, sizeof(error_msg), "Warning: Failed to delete file from File Explorer. Error: %lu", error);
+                gui_println(error_msg);
+            }
+        }
+        
+        // Remove file from virtual filesystem
+        vfs_remove_file(g_cwd, f);
+        
+        char msg[256];
+        if (soft_delete_only) {
+            snprintf(msg, sizeof(msg), "File '%s' moved to trash (soft delete - terminal only).", name);
+        } else {
+            snprintf(msg, sizeof(msg), "File '%s' deleted from both terminal and File Explorer.", name);
+        }
+        gui_println(msg);
+        
+        // Auto-save filesystem
+        fs_save_to_disk();
+        return;
+    }
+    
+    // Check if it's a directory
+    Directory* d = fs_find_child(g_cwd, name);
+    if (d) {
+        // Get current path for trash
+        char current_path[1024];
+        fs_print_path(g_cwd, current_path, sizeof(current_path));
+        
+        if (soft_delete_only) {
+            // Add to trash (soft delete - terminal only)
+            add_to_trash(name, current_path, 1, NULL);
+        } else {
+            // Delete from real filesystem
+            char program_dir[1024];
+            get_main_project_dir(program_dir, sizeof(program_dir));
+            
+            char virtual_path[1024];
+            fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+            
+            char real_path[1024];
+            const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+            if (profiles_pos) {
+                snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+            } else {
+                snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+            }
+            
+            char full_real_path[1024];
+            join_path(full_real_path, sizeof(full_real_path), real_path, name);
+            
+            // Delete the directory from real filesystem
+            BOOL delete_result = pf_rmdir(full_real_path);
+            if (!delete_result) {
+                unsigned long error = pf_last_error();
+                char error_msg[512];
+                snprintf(error_msg, sizeof(error_msg), "Warning: Failed to delete directory from File Explorer. Error: %lu", error);
+                gui_println(error_msg);
+            }
+        }
+        
+        // Remove directory from virtual filesystem
+        vfs_remove_dir(d);
+        
+        char msg[256];
+        if (soft_delete_only) {
+            snprintf(msg, sizeof(msg), "Directory '%s' moved to trash (soft delete - terminal only).", name);
+        } else {
+            snprintf(msg, sizeof(msg), "Directory '%s' deleted from both terminal and File Explorer.", name);
+        }
+        gui_println(msg);
+        
+        // Auto-save filesystem
+        fs_save_to_disk();
+        return;
+    }
+    
+    gui_error("File or directory not found.");
+}
+
+static void cmd_restore(const char* name) {
+    if (!name || !*name) {
+        gui_error("Usage: RESTORE <filename> or RESTORE <foldername>");
+        gui_println("Example: RESTORE myfile.txt");
+        gui_println("Use TRASH to see deleted items");
+        return;
+    }
+    
+    // Find item in trash
+    TrashItem* prev = NULL;
+    TrashItem* current = g_trash;
+    
+    while (current) {
+        if (strcmp(current->name, name) == 0) {
+            // Remove from trash
+            if (prev) {
+                prev->next = current->next;
+            } else {
+                g_trash = current->next;
+            }
+            
+            if (current->is_directory) {
+                // Restore directory
+                Directory* new_dir = fs_create_dir(name);
+                if (new_dir) {
+                    fs_add_child(g_cwd, new_dir);
+                    char msg[256];
+                    snprintf(msg, sizeof(msg), "Directory '%s' restored from trash.", name);
+                    gui_println(msg);
+                }
+            } else {
+                // Restore file
+                File* new_file = fs_create_file(name);
+                if (new_file) {
+                    strncpy(new_file->content, current->content, sizeof(new_file->content) - 1);
+                    new_file->content[sizeof(new_file->content) - 1] = '\0';
+                    fs_add_file(g_cwd, new_file);
+                    char msg[256];
+                    snprintf(msg, sizeof(msg), "File '%s' restored from trash.", name);
+                    gui_println(msg);
+                }
+            }
+            
+            free(current);
+            fs_save_to_disk();
+            return;
+        }
+        prev = current;
+        current = current->next;
+    }
+    
+    gui_error("Item not found in trash.");
+}
+
+static void cmd_trash(void) {
+    gui_println("Trash contents:");
+    gui_println("===============");
+    
+    if (!g_trash) {
+        gui_println("Trash is empty.");
+        return;
+    }
+    
+    TrashItem* current = g_trash;
+    int count = 0;
+    
+    while (current) {
+        char type[16];
+        strcpy(type, current->is_directory ? "DIR" : "FILE");
+        
+        char msg[512];
+        snprintf(msg, sizeof(msg), "[%d] %s %s (from %s)", count + 1, type, current->name, current->path);
+        gui_println(msg);
+        
+        current = current->next;
+        count++;
+    }
+    
+    char count_msg[256];
+    snprintf(count_msg, sizeof(count_msg), "Total items in trash: %d", count);
+    gui_println(count_msg);
+}
+
+static void cmd_emptytrash(void) {
+    gui_println("Emptying trash...");
+    
+    TrashItem* current = g_trash;
+    int count = 0;
+    
+    while (current) {
+        TrashItem* next = current->next;
+        free(current);
+        current = next;
+        count++;
+    }
+    
+    g_trash = NULL;
+    
+    char msg[256];
+    snprintf(msg, sizeof(msg), "Trash emptied. %d items permanently deleted.", count);
+    gui_println(msg);
+}
+
+static void split_name_and_text(const char* arg, char* outName, size_t name_sz, const char** outText) {
+    while (*arg && isspace((unsigned char)*arg)) arg++;
+    size_t i = 0;
+    while (*arg && !isspace((unsigned char)*arg) && i + 1 < name_sz) { outName[i++] = *arg++; }
+    outName[i] = '\0';
+    while (*arg && isspace((unsigned char)*arg)) arg++;
+    *outText = arg;
+}
+
+// Mirrors a VFS file into data\USERS; mode is "wb" to replace, "ab" to append
+static void fs_write_real_file(Directory* dir, const char* name, const char* text, const char* mode) {
+    char virtual_path[1024];
+    fs_print_path(dir, virtual_path, sizeof(virtual_path));
+    
+    // Convert virtual path to real path using absolute paths
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    char real_path[1024];
+    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+    if (profiles_pos) {
+        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+    } else {
+        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    }
+    
+    char full_real_path[1024];
+    join_path(full_real_path, sizeof(full_real_path), real_path, name);
+    
+    FILE* fp = pf_fopen(full_real_path, mode);
+    if (fp) {
+        fputs(text, fp);
+        fclose(fp);
+    }
+}
+
+static void cmd_write(const char* args) {
+    char name[MAX_NAME]; const char* text = NULL; split_name_and_text(args ? args : "", name, sizeof(name), &text);
+    if (name[0] == '\0') { gui_error("Usage: WRITE <file> <text>"); return; }
+    File* f = fs_find_file(g_cwd, name);
+    if (!f) { f = fs_create_file(name); if (f) fs_add_file(g_cwd, f); }
+    if (!f) { gui_error("Out of memory creating file."); return; }
+    strncpy(f->content, text ? text : "", sizeof(f->content) - 1);
+    f->content[sizeof(f->content) - 1] = '\0';
+    vfs_changed(VFS_FILE_WRITTEN, g_cwd, f);
+    
+    // Also write to real file system
+    fs_write_real_file(g_cwd, name, f->content, "wb");
+    
+    gui_println("File written successfully.");
+}
+
+static void cmd_writeln(const char* args) {
+    char name[MAX_NAME]; 
+    const char* text = NULL; 
+    split_name_and_text(args ? args : "", name, sizeof(name), &text);
+    
+    if (name[0] == '\0') { 
+        gui_error("Usage: WRITELN <file> <text>"); 
+        gui_println("Writes text to file with automatic line breaks."); 
+        return; 
+    }
+    
+    if (!text || !*text) { 
+        gui_error("Usage: WRITELN <file> <text>"); 
+        return; 
+    }
+    
+    // Create or find the file
+    File* f = fs_find_file(g_cwd, name);
+    if (!f) {
+        f = fs_create_file(name);
+        if (!f) {
+            gui_error("Failed to create file.");
+            return;
+        }
+        fs_add_file(g_cwd, f);
+    }
+    
+    // Process text to add line breaks
+    char processed_text[MAX_FILE_SIZE];
+    int j = 0;
+    for (int i = 0; text[i] && j < MAX_FILE_SIZE - 1; i++) {
+        if (text[i] == '\\' && text[i+1] == 'n') {
+            processed_text[j++] = '\r';
+            processed_text[j++] = '\n';
+            i++; // Skip the 'n'
+        } else {
+            processed_text[j++] = text[i];
+        }
+    }
+    processed_text[j] = '\0';
+    
+    // Copy processed text to file content
+    strncpy(f->content, processed_text, MAX_FILE_SIZE - 1);
+    f->content[MAX_FILE_SIZE - 1] = '\0';
+    vfs_changed(VFS_FILE_WRITTEN, g_cwd, f);
+    
+    // Save to real filesystem
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    char virtual_path[1024];
+    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+    
+    char real_path[1024];
+    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+    if (profiles_pos) {
+        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+    } else {
+        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    }
+    
+    char full_real_path[1024];
+    join_path(full_real_path, sizeof(full_real_path), real_path, name);
+    
+    FILE* fp = pf_fopen(full_real_path, "wb");
+    if (fp) {
+        fputs(f->content, fp);
+        fclose(fp);
+    }
+    
+    gui_println("File written with line breaks successfully.");
+}
+
+static void cmd_writecode(const char* args) {
+    char name[MAX_NAME]; 
+    const char* text = NULL; 
+    split_name_and_text(args ? args : "", name, sizeof(name), &text);
+    
+    if (name[0] == '\0') { 
+        gui_error("Usage: WRITECODE <file> <code>"); 
+        gui_println("Writes code to file with proper formatting and syntax highlighting."); 
+        return; 
+    }
+    
+    if (!text || !*text) { 
+        gui_error("Usage: WRITECODE <file> <code>"); 
+        return; 
+    }
+    
+    // Create or find the file
+    File* f = fs_create_file(name);
+    if (!f) {
+        gui_error("Failed to create file.");
+        return;
+    }
+    fs_add_file(g_cwd, f);
+    
+    // Process code text
+    char processed_text[MAX_FILE_SIZE];
+    int j = 0;
+    for (int i = 0; text[i] && j < MAX_FILE_SIZE - 1; i++) {
+        if (text[i] == '\\' && text[i+1] == 'n') {
+            processed_text[j++] = '\r';
+            processed_text[j++] = '\n';
+            i++; // Skip the 'n'
+        } else if (text[i] == '\\' && text[i+1] == 't') {
+            processed_text[j++] = '\t';
+            i++; // Skip the 't'
+        } else {
+            processed_text[j++] = text[i];
+        }
+    }
+    processed_text[j] = '\0';
+    
+    // Copy processed text to file content
+    strncpy(f->content, processed_text, MAX_FILE_SIZE - 1);
+    f->content[MAX_FILE_SIZE - 1] = '\0';
+    vfs_changed(VFS_FILE_WRITTEN, g_cwd, f);
+    
+    // Save to real filesystem
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    char virtual_path[1024];
+    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
+    
+    char real_path[1024];
+    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
+    if (profiles_pos) {
+        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+    } else {
+        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    }
+    
+    char full_real_path[1024];
+    join_path(full_real_path, sizeof(full_real_path), real_path, name);
+    
+    FILE* fp = pf_fopen(full_real_path, "wb");
+    if (fp) {
+        fputs(f->content, fp);
+        fclose(fp);
+    }
+    
+    gui_println("Code file written successfully.");
+}
+
+static void cmd_editcode(const char* args) {
+    char name[MAX_NAME];
+    if (sscanf(args, "%s", name) != 1) {
+        gui_error("Usage: EDITCODE <file>");
+        gui_println("Opens interactive code editor. Press Ctrl+S to save and exit.");
+        return;
+    }
+    
+    gui_println("=== INTERACTIVE CODE EDITOR ===");
+    char file_msg[256];
+    snprintf(file_msg, sizeof(file_msg), "File: %s", name);
+    gui_println(file_msg);
+    gui_println("Type your code line by line. Press Ctrl+S to save and exit.");
+    gui_println("Press Ctrl+C to cancel without saving.");
+    gui_println("----------------------------------------");
+    
+    // Create or find the file
+    File* f = fs_find_file(g_cwd, name);
+    if (!f) {
+        f = fs_create_file(name);
+        if (!f) {
+            gui_error("Failed to create file.");
+            return;
+        }
+        fs_add_file(g_cwd, f);
+    }
+    
+    // Clear existing content
+    f->content[0] = '\0';
+    vfs_changed(VFS_FILE_WRITTEN, g_cwd, f);
+    
+    // Set up interactive editing mode
+    g_editMode = 1;
+    g_editFile = f;
+    g_editBuffer[0] = '\0';
+    g_editBufferPos = 0;
+    
+    gui_println("Ready to edit. Start typing...");
+}
+
+BOOL editor_active(void) {
+    return g_editMode != 0;
+}
+
+// Ctrl+S: everything typed since the editor opened becomes the file
+void editor_save(const char* text) {
+    if (g_editFile) {
+        strncpy(g_editFile->content, text, MAX_FILE_SIZE - 1);
+        g_editFile->content[MAX_FILE_SIZE - 1] = '\0';
+        vfs_changed(VFS_FILE_WRITTEN, g_cwd, g_editFile);
+        
+        // Save to real filesystem
+        fs_write_real_file(g_cwd, g_editFile->name, g_editFile->content, "wb");
+        
+        gui_println("File saved successfully!");
+    }
+    
+    g_editMode = 0;
+    g_editFile = NULL;
+    gui_show_prompt_and_arm_input();
+}
+
+// Ctrl+C
+void editor_cancel(void) {
+    gui_println("Edit cancelled.");
+    g_editMode = 0;
+    g_editFile = NULL;
+    gui_show_prompt_and_arm_input();
+}
+
+static void cmd_adduser(const char* username) {
+    if (!username || !*username) {
+        gui_error("Usage: ADDUSER <username>");
+        gui_println("Creates a new user with the specified name.");
+        gui_println("Example: ADDUSER Developer");
+        gui_println("         ADDUSER TestUser");
+        return;
+    }
+    
+    // Validate username (alphanumeric and underscore only)
+    for (const char* p = username; *p; p++) {
+        if (!isalnum(*p) && *p != '_') {
+            gui_error("Error: Username can only contain letters, numbers, and underscores.");
+            return;
+        }
+    }
+    
+    // Check if username already exists
+    Directory* existing_user = fs_find_child(g_root, username);
+    if (existing_user) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Error: User '%s' already exists.", username);
+        gui_println(msg);
+        return;
+    }
+    
+    // Create new user directory
+    Directory* new_user = fs_create_dir(username);
+    if (!new_user) {
+        gui_error("Error: Failed to create user directory.");
+        return;
+    }
+    
+    // Add user to root directory
+    fs_add_child(g_root, new_user);
+    
+    // Create default directories for the new user
+    Directory* user_docs = fs_create_dir("Documents");
+    Directory* user_desktop = fs_create_dir("Desktop");
+    Directory* user_downloads = fs_create_dir("Downloads");
+    Directory* user_settings = fs_create_dir("Settings");
+    
+    fs_add_child(new_user, user_docs);
+    fs_add_child(new_user, user_desktop);
+    fs_add_child(new_user, user_downloads);
+    fs_add_child(new_user, user_settings);
+    
+    // Create real filesystem directory
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    char user_path[1024];
+    snprintf(user_path, sizeof(user_path), "%s\\data\\USERS\\%s", program_dir, username);
+    
+    // Create directory in real filesystem
+    if (!pf_mkdir(user_path)) {
+        if (pf_path_kind(user_path) != PF_PATH_DIR) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "Warning: Could not create real directory for user '%s'.", username);
+            gui_println(msg);
+        }
+    }
+    
+    // Create all preset directories in real filesystem
+    char settings_path[1024];
+    snprintf(settings_path, sizeof(settings_path), "%s\\Settings", user_path);
+    pf_mkdir(settings_path);
+    
+    char docs_path[1024];
+    snprintf(docs_path, sizeof(docs_path), "%s\\Documents", user_path);
+    pf_mkdir(docs_path);
+    
+    char desktop_path[1024];
+    snprintf(desktop_path, sizeof(desktop_path), "%s\\Desktop", user_path);
+    pf_mkdir(desktop_path);
+    
+    char downloads_path[1024];
+    snprintf(downloads_path, sizeof(downloads_path), "%s\\Downloads", user_path);
+    pf_mkdir(downloads_path);
+    
+    // All preset directories created in both virtual and real filesystem
+    
+    // Create README.txt for the new user
+    File* readme = fs_create_file("README.txt");
+    if (readme) {
+        snprintf(readme->content, sizeof(readme->content), 
+            "Welcome to %s's directory!\n\n"
+            "This is your personal workspace.\n"
+            "You can create files and folders here.\n\n"
+            "Available commands:\n"
+            "- MKDIR <name> - Create directory\n"
+            "- TOUCH <name> - Create file\n"
+            "- WRITE <file> <text> - Write to file\n"
+            "- EDITCODE <file> - Interactive code editor\n"
+            "- TYPE <file> - View file contents\n"
+            "- And many more! Type HELP for full list.", username);
+        
+        fs_add_file(new_user, readme);
+        
+        // Save README.txt to real filesystem
+        char readme_path[1024];
+        snprintf(readme_path, sizeof(readme_path), "%s\\README.txt", user_path);
+        
+        FILE* fp = pf_fopen(readme_path, "wb");
+        if (fp) {
+            fputs(readme->content, fp);
+            fclose(fp);
+        }
+    }
+    
+    // Create system maintenance folder for Admin user
+    if (strcmp(username, "Admin") == 0) {
+        create_system_maintenance_folder();
+    }
+    
+    // Save filesystem
+    fs_save_to_disk();
+    
+    char msg[256];
+    snprintf(msg, sizeof(msg), "User '%s' created successfully!", username);
+    gui_println(msg);
+    gui_println("The new user starts with an empty directory and a README.txt file.");
+    gui_println("Use 'USER <username>' to switch to the new user.");
+}
+
+
+static void cmd_append(const char* args) {
+    char name[MAX_NAME]; const char* text = NULL; split_name_and_text(args ? args : "", name, sizeof(name), &text);
+    if (name[0] == '\0') { gui_error("Usage: APPEND <file> <text>"); return; }
+    File* f = fs_find_file(g_cwd, name);
+    if (!f) { f = fs_create_file(name); if (f) fs_add_file(g_cwd, f); }
+    if (!f) { gui_error("Out of memory creating file."); return; }
+    size_t cur = strlen(f->content);
+    size_t left = (cur < sizeof(f->content)) ? (sizeof(f->content) - 1 - cur) : 0;
+    if (left == 0) { gui_error("File is full."); return; }
+    strncat(f->content, text ? text : "", left);
+    vfs_changed(VFS_FILE_WRITTEN, g_cwd, f);
+    
+    // Also append to real file system
+    fs_write_real_file(g_cwd, name, text ? text : "", "ab");
+    
+    gui_println("Text appended successfully.");
+}
+
+static void cmd_type(const char* name) {
+    if (!name || !*name) { gui_error("The system cannot find the file specified."); return; }
+    File* f = fs_find_file(g_cwd, name);
+    if (!f) { gui_error("The system cannot find the file specified."); return; }
+    
+    // Check if file has content
+    if (!f->content || strlen(f->content) == 0) {
+        gui_println("File is empty.");
+        return;
+    }
+    
+    // Display file content with proper line break handling
+    const char* content = f->content;
+    const char* start = content;
+    
+    while (*content) {
+        if (*content == '\r' && *(content + 1) == '\n') {
+            // Windows line break - print up to this point
+            int len = content - start;
+            if (len > 0) {
+                char line[1024];
+                strncpy(line, start, len);
+                line[len] = '\0';
+                gui_println(line);
+            } else {
+                gui_println(""); // Empty line
+            }
+            content += 2; // Skip \r\n
+            start = content;
+        } else if (*content == '\n') {
+            // Unix line break - print up to this point
+            int len = content - start;
+            if (len > 0) {
+                char line[1024];
+                strncpy(line, start, len);
+                line[len] = '\0';
+                gui_println(line);
+            } else {
+                gui_println(""); // Empty line
+            }
+            content++; // Skip \n
+            start = content;
+        } else {
+            content++;
+        }
+    }
+    
+    // Print the last line if there's any content
+    if (content > start) {
+        int len = content - start;
+        char line[1024];
+        strncpy(line, start, len);
+        line[len] = '\0';
+        gui_println(line);
+    }
+}
+
+static void cmd_cd(const char* path) {
+    if (!path || !*path || strcmp(path, "~") == 0) { g_cwd = g_home ? g_home : g_root; return; }
+    if (strcmp(path, "..") == 0) { if (g_cwd != g_root) g_cwd = g_cwd->parent; return; }
+    
+        // Check for system maintenance folder access (admin only)
+        if (strcmp(path, ".system_maintenance") == 0) {
+            
+            // Verify admin privileges for system maintenance
+            if (strcmp(g_currentUser, "Admin") != 0) {
+                gui_error("Access denied. System maintenance requires Admin privileges.");
+                return;
+            }
+            
+            // Check if already in maintenance mode
+            if (g_systemMaintenanceMode) {
+                gui_println("Already in maintenance mode. Use SYSTEM_EXIT to exit.");
+                return;
+            }
+            
+            // Check if user is authenticated
+            if (!g_currentSession.is_authenticated) {
+                gui_println("System Maintenance Access");
+                gui_println("=========================");
+                gui_println("Enter Admin credentials:");
+                gui_println("Username: Admin");
+                gui_println("Password: [Enter your Admin password]");
+                gui_println("");
+                gui_println("Use: LOGIN Admin <password> to authenticate");
+                gui_println("Then use: CD .system_maintenance again");
+                return;
+            }
+            
+            // Activate system maintenance mode
+            g_systemMaintenanceMode = TRUE;
+            strcpy(g_systemMaintenancePath, "C:\\");
+            g_systemMaintenanceStart = time(NULL);
+            
+            gui_println("System maintenance mode activated.");
+            gui_println("Accessing real filesystem...");
+            gui_println("Use SYSTEM_* commands to interact with the real filesystem.");
+            gui_println("Type SYSTEM_EXIT to return to normal mode.");
+            return;
+        }
+    
+    Directory* d = fs_find_child(g_cwd, path);
+    if (d) { 
+        g_cwd = d; 
+        // Auto-detect project type when changing directories
+        detect_project_type();
+    } else { 
+        gui_error("The system cannot find the path specified."); 
+    }
+}
+
+static void cmd_echo(const char* text) { gui_println(text ? text : ""); }
+
+// -------- File system persistence --------
+static void join_path(char* out, size_t out_sz, const char* base, const char* name) {
+    size_t bl = strlen(base);
+    int needs_sep = (bl > 0 && base[bl-1] != '\\' && base[bl-1] != '/');
+    if (needs_sep) {
+        snprintf(out, out_sz, "%s\\%s", base, name);
+    } else {
+        snprintf(out, out_sz, "%s%s", base, name);
+    }
+}
+
+static BOOL mkdir_p(const char* pathIn) {
+    if (!pathIn || !*pathIn) return FALSE;
+    char* path = _strdup(pathIn);
+    if (!path) return FALSE;
+    size_t len = strlen(path);
+    for (size_t i = 0; i < len; ++i) {
+        if (path[i] == '/' || path[i] == '\\') {
+            char old = path[i]; path[i] = '\0';
+            if (*path) { pf_mkdir(path); }
+            path[i] = old;
+        }
+    }
+    BOOL ok = pf_mkdir(path);
+    if (!ok) {
+        ok = (pf_path_kind(path) == PF_PATH_DIR);
+    }
+    free(path);
+    return ok;
+}
+
+static void save_dir_recursive(Directory* dir, const char* base, IgnoreWalk* walk) {
+    // Save files in this directory
+    for (int i = 0; i < dir->file_count; ++i) {
+        if (ignore_walk_check(walk, dir->files[i]->name, FALSE)) continue;
+        char fpath[MAX_PATH];
+        join_path(fpath, sizeof(fpath), base, dir->files[i]->name);
+        FILE* fp = pf_fopen(fpath, "wb");
+        if (fp) {
+            fputs(dir->files[i]->content, fp);
+            fclose(fp);
+        }
+    }
+    // Recurse into subdirectories
+    for (int i = 0; i < dir->child_count; ++i) {
+        if (ignore_walk_check(walk, dir->children[i]->name, TRUE)) continue;
+        char dpath[MAX_PATH];
+        join_path(dpath, sizeof(dpath), base, dir->children[i]->name);
+        mkdir_p(dpath);
+        IgnoreMark mark;
+        ignore_walk_enter_dir(walk, dir->children[i], &mark);
+        save_dir_recursive(dir->children[i], dpath, walk);
+        ignore_walk_leave(walk, &mark);
+    }
+}
+
+static void cmd_savefs(const char* base) {
+    if (!base || !*base) { gui_error("Usage: SAVEFS <path>"); return; }
+    if (!mkdir_p(base)) {
+        if (pf_path_kind(base) != PF_PATH_DIR) {
+            gui_error("Failed to create target folder.");
+            return;
+        }
+    }
+    IgnoreWalk walk;
+    ignore_walk_begin(&walk, NULL);
+    save_dir_recursive(g_root, base, &walk);
+    ignore_walk_end(&walk);
+    char msg[1024]; snprintf(msg, sizeof(msg), "Filesystem saved to %s", base);
+    gui_println(msg);
+}
+
+
+static void cmd_user(const char* username) {
+    if (!username || !*username) { 
+        gui_error("Usage: USER <username>"); 
+        gui_println("Available users:");
+        for (int i = 0; i < g_root->child_count; i++) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "  %s", g_root->children[i]->name);
+            gui_println(msg);
+        }
+        return; 
+    }
+    
+    Directory* user_dir = fs_find_child(g_root, username);
+    if (!user_dir) { 
+        char msg[256]; 
+        snprintf(msg, sizeof(msg), "Invalid user. Available users:");
+        gui_println(msg);
+        for (int i = 0; i < g_root->child_count; i++) {
+            char user_msg[256];
+            snprintf(user_msg, sizeof(user_msg), "  %s", g_root->children[i]->name);
+            gui_println(user_msg);
+        }
+        return;
+    }
+    
+    // Check if user has authentication credentials
+    BOOL user_has_auth = FALSE;
+    for (int i = 0; i < g_authCount; i++) {
+        if (strcmp(g_userAuth[i].username, username) == 0) {
+            user_has_auth = TRUE;
+            break;
+        }
+    }
+    
+    // If user has authentication credentials, require login
+    if (user_has_auth) {
+        if (!g_currentSession.is_authenticated || strcmp(g_currentSession.username, username) != 0) {
+            gui_println("User access requires authentication.");
+            gui_printf("Use: LOGIN %s <password>", username);
+            return;
+        }
+    } else {
+        // User doesn't have authentication setup
+        gui_printf("User '%s' does not have authentication setup.", username);
+        gui_printf("Use: SETUP_AUTH %s <password>", username);
+        return; 
+    }
+    
+    strncpy(g_currentUser, username, sizeof(g_currentUser) - 1);
+    g_currentUser[sizeof(g_currentUser) - 1] = '\0';
+    g_home = user_dir;
+    g_cwd = user_dir;
+    
+    char msg[256]; 
+    snprintf(msg, sizeof(msg), "Switched to user: %s", username);
+    gui_println(msg);
+}
+
+static void cmd_whoami(void) {
+    char msg[256]; 
+    snprintf(msg, sizeof(msg), "Current user: %s", g_currentUser);
+    gui_println(msg);
+}
+
+static void cmd_users(void) {
+    gui_println("Available users:");
+    for (int i = 0; i < g_root->child_count; i++) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "  %s", g_root->children[i]->name);
+        gui_println(msg);
+    }
+    gui_println("");
+    gui_println("User profiles are stored in: C:\\USERS\\");
+}
+
+// Filesystem tree display functions
+static void print_filesystem_tree_recursive(Directory* dir, int level, int is_last, char* prefix, IgnoreWalk* walk) {
+    if (!dir) return;
+    
+    // Print current directory
+    char line[512];
+    char type = 'D';
+    char connector[16];
+    
+    if (level == 0) {
+        // Root directory
+        snprintf(line, sizeof(line), "|%s[%c] %s", prefix, type, dir->name);
+    } else {
+        // Child directory
+        if (is_last) {
+            strcpy(connector, "└── ");
+        } else {
+            strcpy(connector, "├── ");
+        }
+        snprintf(line, sizeof(line), "|%s%s[%c] %s", prefix, connector, type, dir->name);
+    }
+    gui_println(line);
+    
+    // Update prefix for children
+    char new_prefix[256];
+    if (level == 0) {
+        strcpy(new_prefix, "");
+    } else {
+        if (is_last) {
+            snprintf(new_prefix, sizeof(new_prefix), "%s    ", prefix);
+        } else {
+            snprintf(new_prefix, sizeof(new_prefix), "%s│   ", prefix);
+        }
+    }
+    
+    // Drop ignored entries up front so the last-item connectors stay right
+    File* files[MAX_FILES];
+    Directory* children[MAX_CHILDREN];
+    int file_count = 0, child_count = 0;
+    for (int i = 0; i < dir->file_count; i++) {
+        if (!ignore_walk_check(walk, dir->files[i]->name, FALSE)) files[file_count++] = dir->files[i];
+    }
+    for (int i = 0; i < dir->child_count; i++) {
+        if (!ignore_walk_check(walk, dir->children[i]->name, TRUE)) children[child_count++] = dir->children[i];
+    }
+    
+    // Print files first
+    for (int i = 0; i < file_count; i++) {
+        char file_line[512];
+        char file_connector[16];
+        
+        // Check if this is the last item (after all directories)
+        int is_last_item = (i == file_count - 1) && (child_count == 0);
+        
+        if (is_last_item) {
+            strcpy(file_connector, "└── ");
+        } else {
+            strcpy(file_connector, "├── ");
+        }
+        
+        snprintf(file_line, sizeof(file_line), "|%s%s[F] %s", new_prefix, file_connector, files[i]->name);
+        gui_println(file_line);
+    }
+    
+    // Print subdirectories
+    for (int i = 0; i < child_count; i++) {
+        int is_last_dir = (i == child_count - 1);
+        IgnoreMark mark;
+        ignore_walk_enter_dir(walk, children[i], &mark);
+        print_filesystem_tree_recursive(children[i], level + 1, is_last_dir, new_prefix, walk);
+        ignore_walk_leave(walk, &mark);
+    }
+}
+
+static void print_filesystem_visualization(Directory* dir, const char* user_name) {
+    gui_println("+-------------------------------------------------------------+");
+    gui_println("|                    FILESYSTEM TREE STRUCTURE               |");
+    gui_println("+-------------------------------------------------------------+");
+    
+    char user_line[64];
+    snprintf(user_line, sizeof(user_line), "|  User: %-50s |", user_name);
+    gui_println(user_line);
+    
+    gui_println("|                                                         |");
+    gui_println("|  Directory Structure:                                   |");
+    
+    if (dir) {
+        IgnoreWalk walk;
+        ignore_walk_begin_at(&walk, dir);
+        print_filesystem_tree_recursive(dir, 0, 1, "", &walk);
+        ignore_walk_end(&walk);
+    } else {
+        gui_println("|  (No files or directories found)                        |");
+    }
+    
+    gui_println("|                                                         |");
+    gui_println("|  Legend: [D] = Directory, [F] = File                     |");
+    gui_println("+-------------------------------------------------------------+");
+}
+
+// A throwaway tree of about nodes entries: every directory holds nine files
+// and up to ten subdirectories, filled breadth first. Not linked into the VFS.
+static Directory* fileview_bench_tree(int nodes) {
+    Directory** queue = (Directory**)malloc(sizeof(Directory*) * (size_t)nodes);
+    Directory* root = fs_create_dir("bench");
+    if (!queue || !root) {
+        free(queue);
+        free(root);
+        return NULL;
+    }
+    int head = 0, tail = 0, made = 1;
+    queue[tail++] = root;
+    while (made < nodes && head < tail) {
+        Directory* dir = queue[head++];
+        for (int i = 0; i < 9 && made < nodes; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "file%d.txt", i);
+            File* f = fs_create_file(name);
+            if (!f) break;
+            fs_add_file(dir, f);
+            made++;
+        }
+        for (int i = 0; i < 10 && made < nodes && tail < nodes; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "dir%d", made);
+            Directory* child = fs_create_dir(name);
+            if (!child) break;
+            fs_add_child(dir, child);
+            queue[tail++] = child;
+            made++;
+        }
+    }
+    free(queue);
+    return root;
+}
+
+// FILEVIEW BENCH [nodes]: draws the tree into a stream (formatting alone),
+// then to the screen with output buffering off and on, and reports lines
+// per second for each
+static void cmd_fileview_bench(const char* args) {
+    int nodes = (args && *args) ? atoi(args) : 10000;
+    if (nodes < 10) nodes = 10;
+    if (nodes > 1000000) nodes = 1000000;
+    Directory* tree = fileview_bench_tree(nodes);
+    if (!tree) {
+        gui_error("Not enough memory for the benchmark tree.");
+        return;
+    }
+
+    static const char* const names[3] = { "no output", "unbuffered", "buffered" };
+    double rate[3];
+    int lines = 0;
+    Stream* outer = g_outStream;
+    BOOL was_buffered = g_outputBuffered;
+    for (int pass = 0; pass < 3; pass++) {
+        Stream captured;
+        memset(&captured, 0, sizeof(captured));
+        gui_flush();
+        g_outStream = (pass == 0) ? &captured : outer;
+        g_outputBuffered = (pass == 2);
+        double start = pf_seconds();
+        print_filesystem_visualization(tree, "bench");
+        gui_flush();
+        double elapsed = pf_seconds() - start;
+        g_outStream = outer;
+        if (pass == 0) {
+            lines = captured.lines;
+            stream_free(&captured);
+        }
+        rate[pass] = elapsed > 0.0 ? lines / elapsed : 0.0;
+    }
+    g_outputBuffered = was_buffered;
+    vfs_free_tree(tree);
+
+    gui_printf("FILEVIEW of %d nodes (%d lines):", nodes, lines);
+    for (int pass = 0; pass < 3; pass++) {
+        gui_printf("  %-10s %12.0f lines/s", names[pass], rate[pass]);
+    }
+    if (rate[1] > 0.0) gui_printf("  buffering: %.1fx", rate[2] / rate[1]);
+}
+
+static void cmd_fileview(const char* args) {
+    if (args && *args) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s", args);
+        char* rest = NULL;
+        parse_first_token(buf, &rest);
+        if (str_icmp(buf, "BENCH") == 0) {
+            cmd_fileview_bench(rest);
+            return;
+        }
+        gui_error("Usage: FILEVIEW | FILEVIEW BENCH [nodes]");
+        return;
+    }
+    // Display filesystem tree visualization
+    print_filesystem_visualization(g_cwd, g_currentUser);
+}
+
+// Sync works on the subtree under the working directory; from C:\USERS itself
+// it falls back to the current user's home, as it always has.
+static Directory* sync_target_dir(void) {
+    return (g_cwd == g_root) ? g_home : g_cwd;
+}
+
+static void cmd_sync(void) {
+    Directory* target = sync_target_dir();
+    sync_job_start(SYNC_JOB_APPLY, &target, 1);
+}
+
+static void cmd_sync_status(void) {
+    Directory* target = sync_target_dir();
+    sync_job_start(SYNC_JOB_STATUS, &target, 1);
+}
+
+// ---- Line-based three-way merge for SYNC RESOLVE ... MERGE ----
+typedef struct {
+    const char* text;
+    int len;                              // including the line break, if any
+} MergeLine;
+
+static int merge_split_lines(const char* text, MergeLine** out) {
+    int count = 0;
+    for (const char* p = text; *p; p++) if (*p == '\n') count++;
+    *out = (MergeLine*)malloc((count + 1) * sizeof(MergeLine));
+    if (!*out) return -1;
+    int n = 0;
+    const char* start = text;
+    for (const char* p = text; *p; p++) {
+        if (*p == '\n') {
+            (*out)[n].text = start;
+            (*out)[n].len = (int)(p - start + 1);
+            n++;
+            start = p + 1;
+        }
+    }
+    if (*start) {
+        (*out)[n].text = start;
+        (*out)[n].len = (int)strlen(start);
+        n++;
+    }
+    return n;
+}
+
+static BOOL merge_line_eq(const MergeLine* a, const MergeLine* b) {
+    return a->len == b->len && memcmp(a->text, b->text, a->len) == 0;
+}
+
+// match[i] = index in "other" paired with base line i by an LCS, or -1
+static BOOL merge_lcs(const MergeLine* base, int nb, const MergeLine* other, int no, int* match) {
+    unsigned short* dp = (unsigned short*)calloc((size_t)(nb + 1) * (no + 1), sizeof(unsigned short));
+    if (!dp) return FALSE;
+    for (int i = nb - 1; i >= 0; i--) {
+        for (int j = no - 1; j >= 0; j--) {
+            unsigned short* cell = &dp[(size_t)i * (no + 1) + j];
+            if (merge_line_eq(&base[i], &other[j])) {
+                *cell = dp[(size_t)(i + 1) * (no + 1) + j + 1] + 1;
+            } else {
+                unsigned short down = dp[(size_t)(i + 1) * (no + 1) + j];
+                unsigned short right = dp[(size_t)i * (no + 1) + j + 1];
+                *cell = down > right ? down : right;
+            }
+        }
+    }
+    for (int i = 0; i < nb; i++) match[i] = -1;
+    int i = 0, j = 0;
+    while (i < nb && j < no) {
+        if (merge_line_eq(&base[i], &other[j])) {
+            match[i++] = j++;
+        } else if (dp[(size_t)(i + 1) * (no + 1) + j] >= dp[(size_t)i * (no + 1) + j + 1]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    free(dp);
+    return TRUE;
+}
+
+typedef struct {
+    char* text;
+    size_t len;
+    size_t cap;
+} MergeOut;
+
+static void merge_emit(MergeOut* out, const char* text, size_t len) {
+    if (out->len + len + 1 > out->cap) {
+        size_t cap = out->cap ? out->cap * 2 : 1024;
+        while (cap < out->len + len + 1) cap *= 2;
+        char* grown = (char*)realloc(out->text, cap);
+        if (!grown) return;
+        out->text = grown;
+        out->cap = cap;
+    }
+    memcpy(out->text + out->len, text, len);
+    out->len += len;
+    out->text[out->len] = '\0';
+}
+
+static void merge_emit_lines(MergeOut* out, const MergeLine* lines, int from, int to) {
+    for (int i = from; i < to; i++) merge_emit(out, lines[i].text, lines[i].len);
+}
+
+static void merge_emit_marker(MergeOut* out, const char* marker) {
+    if (out->len > 0 && out->text[out->len - 1] != '\n') merge_emit(out, "\n", 1);
+    merge_emit(out, marker, strlen(marker));
+}
+
+static BOOL merge_range_eq(const MergeLine* a, int a0, int a1, const MergeLine* b, int b0, int b1) {
+    if (a1 - a0 != b1 - b0) return FALSE;
+    for (int k = 0; k < a1 - a0; k++) {
+        if (!merge_line_eq(&a[a0 + k], &b[b0 + k])) return FALSE;
+    }
+    return TRUE;
+}
+
+// diff3: keep lines unchanged on both sides, take whichever side changed a
+// region, and mark regions both sides changed differently. Caller frees.
+static char* merge_three_way(const char* base_text, const char* ours_text, const char* theirs_text, int* conflicts) {
+    MergeLine *base = NULL, *ours = NULL, *theirs = NULL;
+    int *mo = NULL, *mt = NULL;
+    MergeOut out = {0};
+    *conflicts = 0;
+
+    int nb = merge_split_lines(base_text, &base);
+    int no = merge_split_lines(ours_text, &ours);
+    int nt = merge_split_lines(theirs_text, &theirs);
+    if (nb < 0 || no < 0 || nt < 0) goto done;
+    mo = (int*)malloc((nb + 1) * sizeof(int));
+    mt = (int*)malloc((nb + 1) * sizeof(int));
+    if (!mo || !mt || !merge_lcs(base, nb, ours, no, mo) || !merge_lcs(base, nb, theirs, nt, mt)) goto done;
+
+    merge_emit(&out, "", 0);
+    int i = 0, a = 0, b = 0;
+    while (i < nb || a < no || b < nt) {
+        if (i < nb && mo[i] == a && mt[i] == b) {
+            merge_emit(&out, base[i].text, base[i].len);
+            i++; a++; b++;
+            continue;
+        }
+        // Unstable region up to the next base line both sides kept
+        int j = i;
+        while (j < nb && (mo[j] < 0 || mt[j] < 0)) j++;
+        int a_end = (j < nb) ? mo[j] : no;
+        int b_end = (j < nb) ? mt[j] : nt;
+
+        if (merge_range_eq(ours, a, a_end, base, i, j)) {
+            merge_emit_lines(&out, theirs, b, b_end);
+        } else if (merge_range_eq(theirs, b, b_end, base, i, j) ||
+                   merge_range_eq(ours, a, a_end, theirs, b, b_end)) {
+            merge_emit_lines(&out, ours, a, a_end);
+        } else {
+            merge_emit_marker(&out, "<<<<<<< VFS\n");
+            merge_emit_lines(&out, ours, a, a_end);
+            merge_emit_marker(&out, "=======\n");
+            merge_emit_lines(&out, theirs, b, b_end);
+            merge_emit_marker(&out, ">>>>>>> DISK\n");
+            (*conflicts)++;
+        }
+        i = j; a = a_end; b = b_end;
+    }
+
+done:
+    free(base); free(ours); free(theirs);
+    free(mo); free(mt);
+    return out.text;
+}
+
+static void cmd_sync_resolve(const char* args) {
+    char buf[1024];
+    strncpy(buf, args ? args : "", sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    // The side is the last word so paths may contain spaces
+    char* end = buf + strlen(buf);
+    while (end > buf && isspace((unsigned char)end[-1])) *--end = '\0';
+    char* side = strrchr(buf, ' ');
+    if (!side) {
+        gui_error("Usage: SYNC RESOLVE <path> VFS|DISK|MERGE");
+        gui_println("Example: SYNC RESOLVE Documents\\notes.txt MERGE");
+        return;
+    }
+    *side++ = '\0';
+    char* path = buf;
+    while (*path && isspace((unsigned char)*path)) path++;
+    end = path + strlen(path);
+    while (end > path && isspace((unsigned char)end[-1])) *--end = '\0';
+    if (str_icmp(side, "VFS") != 0 && str_icmp(side, "DISK") != 0 && str_icmp(side, "MERGE") != 0) {
+        gui_error("Usage: SYNC RESOLVE <path> VFS|DISK|MERGE");
+        return;
+    }
+    for (char* p = path; *p; p++) if (*p == '/') *p = '\\';
+
+    // Paths are relative to the working directory unless given as C:\USERS\...
+    char rel[1024];
+    if (_strnicmp(path, "C:\\USERS\\", 9) == 0) {
+        snprintf(rel, sizeof(rel), "%s", path + 9);
+    } else {
+        char prefix[1024];
+        vfs_rel_path(sync_target_dir(), prefix, sizeof(prefix));
+        snprintf(rel, sizeof(rel), "%s\\%s", prefix, path);
+    }
+
+    sync_base_load();
+    char real[2048];
+    sync_real_path(rel, real, sizeof(real));
+    Directory* vparent = NULL;
+    File* vf = vfs_lookup_file(rel, &vparent);
+
+    char* disk = NULL;
+    PfStat st;
+    if (pf_stat(real, &st) && st.kind == PF_PATH_FILE) {
+        BOOL unsyncable = FALSE;
+        disk = sync_read_disk_file(real, st.size, &unsyncable);
+        if (unsyncable) {
+            gui_println("The disk copy is too large or binary and is not synced.");
+            return;
+        }
+    }
+    if (!vf && !disk) {
+        gui_errorf("File not found in the VFS or on disk: %s", path);
+        return;
+    }
+
+    if (str_icmp(side, "VFS") == 0) {
+        if (vf) {
+            if (!sync_write_disk_file(real, vf->content)) {
+                gui_errorf("Could not write %s", real);
+                free(disk);
+                return;
+            }
+            sync_base_set(rel, vf->content);
+        } else {
+            pf_remove(real);
+            sync_base_remove(rel);
+        }
+        gui_printf("Resolved %s: kept the VFS version.", path);
+    } else if (str_icmp(side, "DISK") == 0) {
+        if (disk) {
+            if (!vf) {
+                vparent = vfs_walk_dirs(rel, sync_path_segments(rel) - 1, TRUE);
+                if (vparent && vparent->file_count < MAX_FILES) {
+                    vf = fs_create_file(sync_path_name(rel));
+                    if (vf) fs_add_file(vparent, vf);
+                }
+                if (!vf) {
+                    gui_error("Could not create the file in the VFS.");
+                    free(disk);
+                    return;
+                }
+            }
+            strncpy(vf->content, disk, MAX_FILE_SIZE - 1);
+            vf->content[MAX_FILE_SIZE - 1] = '\0';
+            vfs_changed(VFS_FILE_WRITTEN, vparent, vf);
+            sync_base_set(rel, vf->content);
+        } else {
+            vfs_remove_file(vparent, vf);
+            sync_base_remove(rel);
+        }
+        gui_printf("Resolved %s: kept the disk version.", path);
+    } else {
+        if (!vf || !disk) {
+            gui_println("MERGE needs the file on both sides; choose VFS or DISK instead.");
+            free(disk);
+            return;
+        }
+        SyncBase* base = sync_base_find(rel);
+        int conflicts = 0;
+        char* merged = merge_three_way((base && base->content) ? base->content : "", vf->content, disk, &conflicts);
+        if (!merged) {
+            gui_error("Out of memory while merging.");
+            free(disk);
+            return;
+        }
+        if (strlen(merged) >= MAX_FILE_SIZE) {
+            gui_printf("Merged result is larger than %d bytes; resolve with VFS or DISK instead.", MAX_FILE_SIZE - 1);
+            free(merged);
+            free(disk);
+            return;
+        }
+        strcpy(vf->content, merged);
+        vfs_changed(VFS_FILE_WRITTEN, vparent, vf);
+        sync_write_disk_file(real, merged);
+        sync_base_set(rel, merged);
+        free(merged);
+        if (conflicts > 0) {
+            gui_printf("Merged %s with %d conflicting region(s); edit the <<<<<<< markers to finish.", path, conflicts);
+        } else {
+            gui_printf("Merged %s cleanly.", path);
+        }
+    }
+    free(disk);
+    fs_save_to_disk();
+    sync_base_save();
+}
+
+// SYNC on its own; STATUS and RESOLVE are rows of their own
+static void cmd_sync_command(const char* args) {
+    if (!args || !*args) {
+        cmd_sync();
+        return;
+    }
+    gui_error("Usage: SYNC [STATUS | RESOLVE <path> VFS|DISK|MERGE]");
+}
+
+static void print_ignore_set(const char* title, const IgnoreRuleSet* set) {
+    gui_println(title);
+    if (!set || set->count == 0) {
+        gui_println("  (none)");
+        return;
+    }
+    for (int i = 0; i < set->count; i++) {
+        gui_printf("  %s", set->rules[i].source);
+    }
+}
+
+static void cmd_ignore_check(const char* path) {
+    char rel[1024];
+    snprintf(rel, sizeof(rel), "%s", path);
+    for (char* p = rel; *p; p++) if (*p == '\\') *p = '/';
+    size_t len = strlen(rel);
+    BOOL trailing_slash = (len > 0 && rel[len-1] == '/');
+    if (trailing_slash) rel[--len] = '\0';
+
+    IgnoreWalk walk;
+    ignore_walk_begin_at(&walk, g_cwd);
+    Directory* cur = g_cwd;
+    const IgnoreRule* hit = NULL;
+    BOOL parent_excluded = FALSE;
+
+    char* seg = rel;
+    while (seg && *seg) {
+        char* slash = strchr(seg, '/');
+        if (slash) *slash = '\0';
+        Directory* child = cur ? fs_find_child(cur, seg) : NULL;
+        BOOL is_dir = slash ? TRUE : (trailing_slash || child != NULL);
+        hit = ignore_walk_match(&walk, seg, is_dir);
+        if (slash && hit && !(hit->flags & IGNORE_NEGATE)) {
+            parent_excluded = TRUE;
+            break;
+        }
+        if (!slash) break;
+        IgnoreMark mark;
+        if (child) {
+            ignore_walk_enter_dir(&walk, child, &mark);
+        } else {
+            ignore_walk_enter(&walk, seg, &mark);
+        }
+        cur = child;
+        seg = slash + 1;
+    }
+    ignore_walk_end(&walk);
+
+    if (!hit) {
+        gui_printf("%s: not ignored", path);
+    } else if (hit->flags & IGNORE_NEGATE) {
+        gui_printf("%s: not ignored (re-included by '%s')", path, hit->source);
+    } else if (parent_excluded) {
+        gui_printf("%s: ignored (parent directory excluded by '%s')", path, hit->source);
+    } else {
+        gui_printf("%s: ignored (rule '%s')", path, hit->source);
+    }
+}
+
+static void cmd_ignore(const char* args) {
+    if (!args || !*args || str_icmp(args, "LIST") == 0) {
+        print_ignore_set("Default ignore rules:", ignore_default_rules());
+        char title[128];
+        snprintf(title, sizeof(title), "Rules for %s (Settings\\ignore.dat):", g_currentUser);
+        print_ignore_set(title, ignore_rules_for_user(g_currentUser));
+        gui_println("A .gitignore in any directory also applies below it.");
+        gui_error("Usage: IGNORE [LIST] | IGNORE ADD <pattern> | IGNORE CHECK <path>");
+        return;
+    }
+
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args);
+    char* rest = NULL;
+    parse_first_token(buf, &rest);
+
+    if (str_icmp(buf, "ADD") == 0) {
+        if (!*rest) {
+            gui_error("Usage: IGNORE ADD <pattern>");
+            gui_println("Example: IGNORE ADD *.log");
+            return;
+        }
+        IgnoreRule probe;
+        if (!ignore_parse_rule(&probe, rest)) {
+            gui_error("Invalid ignore pattern.");
+            return;
+        }
+
+        char rules_path[1024];
+        ignore_user_rules_path(g_currentUser, rules_path, sizeof(rules_path));
+        char settings_dir[1024];
+        snprintf(settings_dir, sizeof(settings_dir), "%s", rules_path);
+        char* last_sep = strrchr(settings_dir, '\\');
+        if (last_sep) *last_sep = '\0';
+        mkdir_p(settings_dir);
+
+        FILE* f = pf_fopen(rules_path, "a");
+        if (!f) {
+            gui_error("Failed to update ignore rules.");
+            return;
+        }
+        fprintf(f, "%s\n", rest);
+        fclose(f);
+
+        // Keep the VFS copy of the rules file in step with the disk
+        Directory* settings = fs_find_child(g_home, "Settings");
+        if (settings) {
+            File* vfile = fs_find_file(settings, "ignore.dat");
+            if (!vfile) {
+                vfile = fs_create_file("ignore.dat");
+                if (vfile) fs_add_file(settings, vfile);
+            }
+            if (vfile) {
+                size_t used = strlen(vfile->content);
+                snprintf(vfile->content + used, sizeof(vfile->content) - used, "%s\n", rest);
+                vfs_changed(VFS_FILE_WRITTEN, settings, vfile);
+            }
+        }
+        for (int i = 0; i < g_ignoreUserCount; i++) {
+            if (_stricmp(g_ignoreUsers[i].user, g_currentUser) == 0) g_ignoreUsers[i].loaded = FALSE;
+        }
+        fs_save_to_disk();
+        gui_printf("Added ignore rule: %s", rest);
+    } else if (str_icmp(buf, "CHECK") == 0) {
+        if (!*rest) {
+            gui_error("Usage: IGNORE CHECK <path>");
+            gui_println("Example: IGNORE CHECK node_modules/react");
+            return;
+        }
+        cmd_ignore_check(rest);
+    } else {
+        gui_error("Usage: IGNORE [LIST] | IGNORE ADD <pattern> | IGNORE CHECK <path>");
+    }
+}
+
+// ---------------- HASH ----------------
+// Merkle-style tree hash: a file hashes its content, a directory hashes the
+// sorted list of (kind, name, child hash), so equal trees give equal hashes
+// and any edit below a directory changes every hash up to the root.
+typedef struct {
+    const char* name;
+    BOOL is_dir;
+    Hash128 hash;
+} HashTreeEntry;
+
+static Hash128 hash_tree_file(const File* f) {
+    HashState state;
+    hash_init(&state);
+    hash_update(&state, "blob", 5);
+    hash_update(&state, f->content, strlen(f->content));
+    return hash_final128(&state);
+}
+
+static int hash_tree_entry_cmp(const void* a, const void* b) {
+    const HashTreeEntry* x = (const HashTreeEntry*)a;
+    const HashTreeEntry* y = (const HashTreeEntry*)b;
+    int c = _stricmp(x->name, y->name);
+    return c ? c : strcmp(x->name, y->name);
+}
+
+static Hash128 hash_tree_dir(Directory* dir, IgnoreWalk* walk, int* files, int* dirs) {
+    HashTreeEntry entries[MAX_FILES + MAX_CHILDREN];
+    int count = 0;
+
+    for (int i = 0; i < dir->file_count; i++) {
+        File* f = dir->files[i];
+        if (ignore_walk_check(walk, f->name, FALSE)) continue;
+        entries[count].name = f->name;
+        entries[count].is_dir = FALSE;
+        entries[count].hash = hash_tree_file(f);
+        count++;
+        (*files)++;
+    }
+    for (int i = 0; i < dir->child_count; i++) {
+        Directory* sub = dir->children[i];
+        if (ignore_walk_check(walk, sub->name, TRUE)) continue;
+        IgnoreMark mark;
+        ignore_walk_enter_dir(walk, sub, &mark);
+        entries[count].name = sub->name;
+        entries[count].is_dir = TRUE;
+        entries[count].hash = hash_tree_dir(sub, walk, files, dirs);
+        ignore_walk_leave(walk, &mark);
+        count++;
+        (*dirs)++;
+    }
+    qsort(entries, count, sizeof(entries[0]), hash_tree_entry_cmp);
+
+    HashState state;
+    hash_init(&state);
+    hash_update(&state, "tree", 5);
+    for (int i = 0; i < count; i++) {
+        unsigned char raw[16];
+        for (int b = 0; b < 8; b++) {
+            raw[b] = (unsigned char)(entries[i].hash.lo >> (b * 8));
+            raw[8 + b] = (unsigned char)(entries[i].hash.hi >> (b * 8));
+        }
+        hash_update(&state, entries[i].is_dir ? "D" : "F", 1);
+        hash_update(&state, entries[i].name, strlen(entries[i].name) + 1);
+        hash_update(&state, raw, sizeof(raw));
+    }
+    return hash_final128(&state);
+}
+
+// Resolve a path relative to the working directory ("." and ".." allowed)
+static BOOL vfs_resolve_path(const char* path, Directory** dir_out, File** file_out) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char* p = buf; *p; p++) if (*p == '/') *p = '\\';
+
+    Directory* cur = g_cwd;
+    char* seg = buf;
+    *dir_out = NULL;
+    *file_out = NULL;
+    while (seg && *seg) {
+        char* next = strchr(seg, '\\');
+        if (next) *next++ = '\0';
+        if (*seg == '\0' || strcmp(seg, ".") == 0) {
+            // stay
+        } else if (strcmp(seg, "..") == 0) {
+            if (cur->parent) cur = cur->parent;
+        } else {
+            Directory* child = fs_find_child(cur, seg);
+            if (!child) {
+                // Only the last segment may name a file
+                if (next && *next) return FALSE;
+                *file_out = fs_find_file(cur, seg);
+                return *file_out != NULL;
+            }
+            cur = child;
+        }
+        seg = next;
+    }
+    *dir_out = cur;
+    return TRUE;
+}
+
+// Throughput of one implementation over inputs of chunk bytes; returns GB/s
+// The buffer's chunks hashed once each and folded together, for checking
+// that every implementation gives the same answer
+static Hash128 hash_bench_digest(const unsigned char* data, size_t size, size_t chunk, HashImpl impl) {
+    Hash128 h = {0, 0};
+    for (size_t off = 0; off + chunk <= size; off += chunk) {
+        Hash128 part = hash128_impl(data + off, chunk, impl);
+        h.lo ^= part.lo;
+        h.hi ^= part.hi;
+    }
+    return h;
+}
+
+// GB/s hashing the buffer in chunks, repeated for a quarter second
+static double hash_bench_run(const unsigned char* data, size_t size, size_t chunk, HashImpl impl) {
+    static volatile unsigned long long sink;  // keeps the hashing from being optimized away
+    double start = pf_seconds();
+
+    unsigned long long bytes = 0;
+    double elapsed = 0.0;
+    do {
+        for (size_t off = 0; off + chunk <= size; off += chunk) {
+            sink += hash128_impl(data + off, chunk, impl).lo;
+        }
+        bytes += (size / chunk) * chunk;
+        elapsed = pf_seconds() - start;
+    } while (elapsed < 0.25);
+
+    return (double)bytes / elapsed / 1e9;
+}
+
+static void cmd_hash_bench(const char* args) {
+    int mb = (args && *args) ? atoi(args) : 64;
+    if (mb < 1) mb = 1;
+    if (mb > 1024) mb = 1024;
+
+    size_t size = (size_t)mb << 20;
+    unsigned char* data = (unsigned char*)malloc(size);
+    if (!data) {
+        gui_error("Not enough memory for the benchmark buffer.");
+        return;
+    }
+    unsigned long long x = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        data[i] = (unsigned char)x;
+    }
+
+    gui_printf("Hashing a %d MB buffer whole, and as 1 KB chunks (typical VFS file):", mb);
+    double scalar_big = 0.0, scalar_small = 0.0;
+    Hash128 reference_big = hash_bench_digest(data, size, size, HASH_IMPL_SCALAR);
+    Hash128 reference_small = hash_bench_digest(data, size, 1024, HASH_IMPL_SCALAR);
+    for (int impl = HASH_IMPL_SCALAR; impl < HASH_IMPL_COUNT; impl++) {
+        if (!hash_impl_available((HashImpl)impl)) continue;
+        Hash128 big = hash_bench_digest(data, size, size, (HashImpl)impl);
+        Hash128 small = hash_bench_digest(data, size, 1024, (HashImpl)impl);
+        BOOL same = big.lo == reference_big.lo && big.hi == reference_big.hi &&
+                    small.lo == reference_small.lo && small.hi == reference_small.hi;
+        double gbps_big = hash_bench_run(data, size, size, (HashImpl)impl);
+        double gbps_small = hash_bench_run(data, size, 1024, (HashImpl)impl);
+        if (impl == HASH_IMPL_SCALAR) {
+            scalar_big = gbps_big;
+            scalar_small = gbps_small;
+        }
+        gui_printf("  %-7s %7.2f GB/s (%.2fx)   1 KB: %7.2f GB/s (%.2fx)%s",
+                   hash_impl_name((HashImpl)impl), gbps_big, gbps_big / scalar_big,
+                   gbps_small, gbps_small / scalar_small, same ? "" : "  DIGEST MISMATCH");
+    }
+    gui_printf("HASH uses: %s", hash_impl_name(hash_impl_available(HASH_IMPL_AVX2) ? HASH_IMPL_AVX2 :
+                                               hash_impl_available(HASH_IMPL_SSE2) ? HASH_IMPL_SSE2 : HASH_IMPL_SCALAR));
+    free(data);
+}
+
+static void cmd_hash(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: HASH <file|dir> | HASH BENCH [MB]");
+        gui_println("Example: HASH Documents");
+        return;
+    }
+
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args);
+    char* rest = NULL;
+    parse_first_token(buf, &rest);
+    if (str_icmp(buf, "BENCH") == 0) {
+        cmd_hash_bench(rest);
+        return;
+    }
+
+    Directory* dir = NULL;
+    File* file = NULL;
+    if (!vfs_resolve_path(args, &dir, &file)) {
+        gui_error("The system cannot find the path specified.");
+        return;
+    }
+
+    char hex[33];
+    if (file) {
+        hash128_to_hex(hash_tree_file(file), hex);
+        gui_printf("%s  %s", hex, file->name);
+        return;
+    }
+
+    int files = 0, dirs = 0;
+    IgnoreWalk walk;
+    ignore_walk_begin_at(&walk, dir);
+    Hash128 h = hash_tree_dir(dir, &walk, &files, &dirs);
+    ignore_walk_end(&walk);
+    hash128_to_hex(h, hex);
+    gui_printf("%s  %s\\  (%d files, %d folders)", hex, dir == g_root ? "C:" : dir->name, files, dirs);
+}
+
+// Helper function to get the main project directory (not the build directory)
+static void get_main_project_dir(char* buffer, size_t size) {
+    // Get the executable's full path
+    pf_executable_path(buffer, size);
+    
+    // Find the last backslash and remove the filename
+    char* last_slash = strrchr(buffer, '\\');
+    if (last_slash) {
+        *last_slash = '\0';  // Remove the executable filename (now in build directory)
+    }
+    
+    // Now we're in the build directory, go up one level to the main project directory
+    last_slash = strrchr(buffer, '\\');
+    if (last_slash) {
+        *last_slash = '\0';  // Go up one level from build/ to main project directory
+    }
+}
+
+static void git_command_done(Job* job, int exit_code) {
+    if (exit_code == 0) {
+        gui_printf("Git command completed successfully (%s).", job_cost(job));
+    } else {
+        gui_error("Git command failed. Check your Git installation and try again.");
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "Exit code: %d", exit_code);
+        gui_println(error_msg);
+    }
+}
+
+// The real folder behind the working directory, where Git runs
+static void git_work_tree(char* out, size_t size) {
+    // Get the main project directory (not the build directory)
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    
+    if (g_cwd == g_home) {
+        // We're in the user's home directory
+        snprintf(out, size, "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+        return;
+    }
+    // Virtual path: C:\USERS\Public\folder\subfolder
+    // Real path: [program_dir]\data\USERS\Public\folder\subfolder
+    char current_path[2048];
+    fs_print_path(g_cwd, current_path, sizeof(current_path));
+    char* profiles_pos = strstr(current_path, "\\USERS\\");
+    if (profiles_pos) {
+        // Skip "\USERS\" and add the rest to the base path
+        snprintf(out, size, "%s\\data\\USERS\\%s", program_dir, profiles_pos + 7);
+    } else {
+        // Fallback to current user's directory
+        snprintf(out, size, "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    }
+}
+
+// Runs git with args (NULL-terminated, at most GIT_MAX_ARGS) in the real
+// folder behind the working directory
+#define GIT_MAX_ARGS 60
+
+// Keeps Git to the folder it runs in: no pager, no system-wide config
+static const char* const g_gitEnv[] = { "GIT_PAGER=cat", "GIT_CONFIG_NOSYSTEM=1", NULL };
+
+static void execute_git_argv(const char* const* args) {
+    char storage_path[2048];
+    git_work_tree(storage_path, sizeof(storage_path));
+
+    // Only INIT may start in a folder that is not on disk yet
+    BOOL init = str_icmp(args[0], "init") == 0;
+    if (init) mkdir_p(storage_path);
+
+    char git_dir[2048];
+    snprintf(git_dir, sizeof(git_dir), "%s\\.git", storage_path);
+    if (!init && pf_path_kind(git_dir) != PF_PATH_DIR) {
+        gui_println("No .git folder found. Use 'GIT INIT' to create a repository.");
+        return;
+    }
+
+    // Git runs directly, with no shell in between
+    const char* argv[GIT_MAX_ARGS + 4] = { "git", "--git-dir=.git", "--work-tree=." };
+    int argc = 3;
+    for (int i = 0; args[i] && i < GIT_MAX_ARGS; i++) argv[argc++] = args[i];
+    argv[argc] = NULL;
+
+    // Its output streams in as a job
+    if (!job_start_argv(argv, g_gitEnv, storage_path, PF_SPAWN_CAPTURE, git_command_done, NULL)) {
+        gui_error("Failed to execute Git command.");
+    }
+}
+
+// git_args is split into words; double quotes keep spaces in one
+static void execute_git_command(const char* git_args) {
+    char line[2048];
+    snprintf(line, sizeof(line), "%s", git_args);
+    char* args[GIT_MAX_ARGS + 1];
+    if (split_args(line, args, GIT_MAX_ARGS + 1) == 0) return;
+    execute_git_argv((const char* const*)args);
+}
+
+// ---- Native reads ----
+// STATUS, LOG, BRANCH and TAG -l only read the repository, so they are
+// answered from .git in-process (gitread.c). When the reader cannot open
+// the repository, or an object in it, git runs instead.
+#define GIT_ABBREV 7
+#define GIT_LOG_MAX 10
+
+static GitRepo* git_native_open(void) {
+    char work_tree[2048];
+    git_work_tree(work_tree, sizeof(work_tree));
+    return git_repo_open(work_tree);
+}
+
+typedef struct {
+    char lines[GIT_LOG_MAX][300];
+    int count;
+} GitLogLines;
+
+static BOOL git_log_line(const GitCommit* commit, void* ctx) {
+    GitLogLines* out = (GitLogLines*)ctx;
+    char hex[GIT_OID_HEX];
+    git_oid_to_hex(&commit->id, hex);
+    snprintf(out->lines[out->count++], sizeof(out->lines[0]), "%.*s %s", GIT_ABBREV, hex, commit->summary);
+    return out->count < GIT_LOG_MAX;
+}
+
+// "git log --oneline -max rev". FALSE if history could not be read, before
+// anything was printed.
+static BOOL git_native_log(GitRepo* repo, const char* rev, int max, const char* missing) {
+    GitOid start;
+    if (!git_resolve(repo, rev, &start)) {
+        gui_println(missing);
+        return TRUE;
+    }
+    GitLogLines out;
+    out.count = 0;
+    if (git_log(repo, &start, max < GIT_LOG_MAX ? max : GIT_LOG_MAX, git_log_line, &out) < 0) return FALSE;
+    for (int i = 0; i < out.count; i++) gui_println(out.lines[i]);
+    return TRUE;
+}
+
+typedef struct {
+    char** paths;
+    int count;
+    int cap;
+} GitPathList;
+
+static void git_path_list_add(GitPathList* list, const char* path) {
+    if (list->count == list->cap) {
+        int cap = list->cap ? list->cap * 2 : 32;
+        char** bigger = (char**)realloc(list->paths, cap * sizeof(char*));
+        if (!bigger) return;
+        list->paths = bigger;
+        list->cap = cap;
+    }
+    char* copy = _strdup(path);
+    if (copy) list->paths[list->count++] = copy;
+}
+
+static void git_path_list_free(GitPathList* list) {
+    for (int i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+}
+
+static int git_path_cmp(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Whether a folder holds any file the ignore rules let through
+static BOOL git_untracked_any(const char* real_dir, IgnoreWalk* walk) {
+    PfDir* dir = pf_dir_open(real_dir);
+    if (!dir) return FALSE;
+    BOOL found = FALSE;
+    PfDirEntry entry;
+    while (!found && pf_dir_next(dir, &entry)) {
+        if (strcmp(entry.name, ".git") == 0 || ignore_walk_check(walk, entry.name, entry.is_dir)) continue;
+        if (!entry.is_dir) {
+            found = TRUE;
+            continue;
+        }
+        char child[2048];
+        snprintf(child, sizeof(child), "%s\\%s", real_dir, entry.name);
+        IgnoreMark mark;
+        ignore_walk_enter(walk, entry.name, &mark);
+        ignore_walk_push_file(walk, child);
+        found = git_untracked_any(child, walk);
+        ignore_walk_leave(walk, &mark);
+    }
+    pf_dir_close(dir);
+    return found;
+}
+
+// Files the index does not know, as git status lists them: a folder with
+// nothing tracked in it shows as "folder/"
+static void git_untracked_walk(const char* real_dir, const char* rel, const GitIndex* index,
+                               IgnoreWalk* walk, GitPathList* out) {
+    PfDir* dir = pf_dir_open(real_dir);
+    if (!dir) return;
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
+        if (strcmp(entry.name, ".git") == 0 || ignore_walk_check(walk, entry.name, entry.is_dir)) continue;
+        char path[2048];
+        snprintf(path, sizeof(path), "%s%s%s", rel, entry.name, entry.is_dir ? "/" : "");
+        int i = git_index_find(index, path);
+        if (!entry.is_dir) {
+            if (i == index->count || strcmp(index->entries[i].path, path) != 0) git_path_list_add(out, path);
+            continue;
+        }
+        BOOL tracked_below = i < index->count && strncmp(index->entries[i].path, path, strlen(path)) == 0;
+        char child[2048];
+        snprintf(child, sizeof(child), "%s\\%s", real_dir, entry.name);
+        IgnoreMark mark;
+        ignore_walk_enter(walk, entry.name, &mark);
+        ignore_walk_push_file(walk, child);
+        if (tracked_below) {
+            git_untracked_walk(child, path, index, walk, out);
+        } else if (git_untracked_any(child, walk)) {
+            git_path_list_add(out, path);
+        }
+        ignore_walk_leave(walk, &mark);
+    }
+    pf_dir_close(dir);
+}
+
+// "Your branch is ..." against the branch's upstream, if it has one
+static void git_print_upstream(GitRepo* repo, const char* branch, const GitOid* head) {
+    char key[300];
+    snprintf(key, sizeof(key), "branch.%s.remote", branch);
+    const char* remote = git_config_get(repo, key);
+    snprintf(key, sizeof(key), "branch.%s.merge", branch);
+    const char* merge = git_config_get(repo, key);
+    if (!remote || !merge) return;
+
+    const char* name = strncmp(merge, "refs/heads/", 11) == 0 ? merge + 11 : merge;
+    char ref[512], shown[512];
+    if (strcmp(remote, ".") == 0) {
+        snprintf(ref, sizeof(ref), "%s", merge);
+        snprintf(shown, sizeof(shown), "%s", name);
+    } else {
+        snprintf(ref, sizeof(ref), "refs/remotes/%s/%s", remote, name);
+        snprintf(shown, sizeof(shown), "%s/%s", remote, name);
+    }
+    GitOid upstream;
+    if (!git_resolve(repo, ref, &upstream)) {
+        gui_printf("Your branch is based on '%s', but the upstream is gone.", shown);
+        gui_println("  (use \"git branch --unset-upstream\" to fixup)");
+        gui_println("");
+        return;
+    }
+    int ahead = 0, behind = 0;
+    if (!head || !git_ahead_behind(repo, head, &upstream, &ahead, &behind)) return;
+    if (ahead == 0 && behind == 0) {
+        gui_printf("Your branch is up to date with '%s'.", shown);
+    } else if (behind == 0) {
+        gui_printf("Your branch is ahead of '%s' by %d commit%s.", shown, ahead, ahead == 1 ? "" : "s");
+        gui_println("  (use \"git push\" to publish your local commits)");
+    } else if (ahead == 0) {
+        gui_printf("Your branch is behind '%s' by %d commit%s, and can be fast-forwarded.", shown, behind, behind == 1 ? "" : "s");
+        gui_println("  (use \"git pull\" to update your local branch)");
+    } else {
+        gui_printf("Your branch and '%s' have diverged,", shown);
+        gui_printf("and have %d and %d different commits each, respectively.", ahead, behind);
+        gui_println("  (use \"git pull\" if you want to integrate the remote branch with yours)");
+    }
+    gui_println("");
+}
+
+static const char* git_status_label(char state) {
+    switch (state) {
+        case 'A': return "new file:   ";
+        case 'D': return "deleted:    ";
+        case 'U': return "both modified:   ";
+        default: return "modified:   ";
+    }
+}
+
+// git status, long format
+static BOOL git_native_status(GitRepo* repo) {
+    GitIndex index;
+    if (!git_read_index(repo, &index)) return FALSE;
+    GitStatusEntry* changes = NULL;
+    int change_count = 0;
+    if (!git_status(repo, &index, &changes, &change_count)) {
+        git_index_free(&index);
+        return FALSE;
+    }
+
+    char work_tree[2048];
+    git_work_tree(work_tree, sizeof(work_tree));
+    IgnoreWalk walk;
+    ignore_walk_begin(&walk, NULL);
+    char exclude[2100];
+    snprintf(exclude, sizeof(exclude), "%s\\.git\\info\\exclude", work_tree);
+    char* exclude_text = ignore_read_small_file(exclude);
+    if (exclude_text) {
+        ignore_walk_push_text(&walk, exclude_text);
+        free(exclude_text);
+    }
+    ignore_walk_push_file(&walk, work_tree);
+    GitPathList untracked = {0};
+    git_untracked_walk(work_tree, "", &index, &walk, &untracked);
+    ignore_walk_end(&walk);
+    if (untracked.count > 1) qsort(untracked.paths, untracked.count, sizeof(char*), git_path_cmp);
+
+    GitOid head;
+    BOOL born = git_resolve(repo, "HEAD", &head);
+    const char* branch = git_head_ref(repo);
+    if (branch) {
+        if (strncmp(branch, "refs/heads/", 11) == 0) branch += 11;
+        gui_printf("On branch %s", branch);
+        git_print_upstream(repo, branch, born ? &head : NULL);
+    } else {
+        char hex[GIT_OID_HEX];
+        git_oid_to_hex(&head, hex);
+        gui_printf("HEAD detached at %.*s", GIT_ABBREV, hex);
+    }
+    if (!born) {
+        gui_println("");
+        gui_println("No commits yet");
+        gui_println("");
+    }
+
+    int staged = 0, unstaged = 0, unmerged = 0;
+    BOOL deleted = FALSE;
+    for (int i = 0; i < change_count; i++) {
+        if (changes[i].staged == 'U') unmerged++;
+        else if (changes[i].staged != ' ') staged++;
+        if (changes[i].unstaged != ' ' && changes[i].unstaged != 'U') unstaged++;
+        if (changes[i].unstaged == 'D') deleted = TRUE;
+    }
+    if (staged) {
+        gui_println("Changes to be committed:");
+        gui_println(born ? "  (use \"git restore --staged <file>...\" to unstage)" : "  (use \"git rm --cached <file>...\" to unstage)");
+        for (int i = 0; i < change_count; i++) {
+            char s = changes[i].staged;
+            if (s != ' ' && s != 'U') gui_printf("\t%s%s", git_status_label(s), changes[i].path);
         }
-        
-        // Remove directory from virtual filesystem
-        for (int i = 0; i < g_cwd->child_count; ++i) {
-            if (strcmp(g_cwd->children[i]->name, name) == 0) {
-                free(g_cwd->children[i]);
-                // Shift remaining directories
-                for (int j = i; j < g_cwd->child_count - 1; ++j) {
-                    g_cwd->children[j] = g_cwd->children[j + 1];
-                }
-                g_cwd->child_count--;
-                break;
-            }
+        gui_println("");
+    }
+    if (unmerged) {
+        gui_println("Unmerged paths:");
+        gui_println("  (use \"git add <file>...\" to mark resolution)");
+        for (int i = 0; i < change_count; i++) {
+            if (changes[i].staged == 'U') gui_printf("\t%s%s", git_status_label('U'), changes[i].path);
         }
-        
-        char msg[256];
-        if (soft_delete_only) {
-            snprintf(msg, sizeof(msg), "Directory '%s' moved to trash (soft delete - terminal only).", name);
-        } else {
-            snprintf(msg, sizeof(msg), "Directory '%s' deleted from both terminal and File Explorer.", name);
+        gui_println("");
+    }
+    if (unstaged) {
+        gui_println("Changes not staged for commit:");
+        gui_println(deleted ? "  (use \"git add/rm <file>...\" to update what will be committed)"
+                            : "  (use \"git add <file>...\" to update what will be committed)");
+        gui_println("  (use \"git restore <file>...\" to discard changes in working directory)");
+        for (int i = 0; i < change_count; i++) {
+            char u = changes[i].unstaged;
+            if (u != ' ' && u != 'U') gui_printf("\t%s%s", git_status_label(u), changes[i].path);
         }
-        gui_println(msg);
-        
-        // Auto-save filesystem
-        fs_save_to_disk();
-        return;
+        gui_println("");
     }
-    
-    gui_println("File or directory not found.");
+    if (untracked.count) {
+        gui_println("Untracked files:");
+        gui_println("  (use \"git add <file>...\" to include in what will be committed)");
+        for (int i = 0; i < untracked.count; i++) gui_printf("\t%s", untracked.paths[i]);
+        gui_println("");
+    }
+    if (staged || unmerged) {
+        // git says nothing more when something is staged
+    } else if (unstaged) {
+        gui_println("no changes added to commit (use \"git add\" and/or \"git commit -a\")");
+    } else if (untracked.count) {
+        gui_println("nothing added to commit but untracked files present (use \"git add\" to track)");
+    } else if (!born) {
+        gui_println("nothing to commit (create/copy files and use \"git add\" to track)");
+    } else {
+        gui_println("nothing to commit, working tree clean");
+    }
+
+    git_path_list_free(&untracked);
+    git_status_free(changes, change_count);
+    git_index_free(&index);
+    return TRUE;
 }
 
-static void cmd_restore(const char* name) {
-    if (!name || !*name) {
-        gui_println("Usage: RESTORE <filename> or RESTORE <foldername>");
-        gui_println("Example: RESTORE myfile.txt");
-        gui_println("Use TRASH to see deleted items");
+typedef struct {
+    GitPathList names;
+    size_t strip;                         // length of the prefix to drop
+} GitRefNames;
+
+static BOOL git_ref_name(const char* name, const GitOid* oid, void* ctx) {
+    (void)oid;
+    GitRefNames* out = (GitRefNames*)ctx;
+    git_path_list_add(&out->names, name + out->strip);
+    return TRUE;
+}
+
+// git branch: local branches, the current one starred
+static void git_native_branches(GitRepo* repo) {
+    GitRefNames refs = {{0}, 11};
+    git_for_each_ref(repo, "refs/heads/", git_ref_name, &refs);
+    const char* current = git_head_ref(repo);
+    if (!current) {
+        GitOid head;
+        char hex[GIT_OID_HEX];
+        if (git_resolve(repo, "HEAD", &head)) {
+            git_oid_to_hex(&head, hex);
+            gui_printf("* (HEAD detached at %.*s)", GIT_ABBREV, hex);
+        }
+    }
+    for (int i = 0; i < refs.names.count; i++) {
+        BOOL here = current && strcmp(current + 11, refs.names.paths[i]) == 0;
+        gui_printf("%c %s", here ? '*' : ' ', refs.names.paths[i]);
+    }
+    git_path_list_free(&refs.names);
+}
+
+static void git_native_tags(GitRepo* repo) {
+    GitRefNames refs = {{0}, 10};
+    git_for_each_ref(repo, "refs/tags/", git_ref_name, &refs);
+    for (int i = 0; i < refs.names.count; i++) gui_println(refs.names.paths[i]);
+    git_path_list_free(&refs.names);
+}
+
+static void cmd_git_init(void) {
+    gui_println("Initializing Git repository...");
+    execute_git_command("init");
+}
+
+// Runs in the folder the clone was started from
+static void git_clone_done(Job* job, int exit_code) {
+    if (exit_code != 0) {
+        gui_errorf("Git clone failed. Exit code: %d", exit_code);
         return;
     }
+
+    // Extract repository name from URL for virtual filesystem
+    char repo_name[256] = {0};
+    const char* last_slash = strrchr(job->arg, '/');
+    if (last_slash) {
+        snprintf(repo_name, sizeof(repo_name), "%s", last_slash + 1);
+        // Remove .git extension if present
+        char* dot_git = strstr(repo_name, ".git");
+        if (dot_git) {
+            *dot_git = '\0';
+        }
+    }
     
-    // Find item in trash
-    TrashItem* prev = NULL;
-    TrashItem* current = g_trash;
-    
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            // Remove from trash
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                g_trash = current->next;
-            }
-            
-            if (current->is_directory) {
-                // Restore directory
-                Directory* new_dir = fs_create_dir(name);
-                if (new_dir) {
-                    fs_add_child(g_cwd, new_dir);
-                    char msg[256];
-                    snprintf(msg, sizeof(msg), "Directory '%s' restored from trash.", name);
-                    gui_println(msg);
-                }
-            } else {
-                // Restore file
-                File* new_file = fs_create_file(name);
-                if (new_file) {
-                    strncpy(new_file->content, current->content, sizeof(new_file->content) - 1);
-                    new_file->content[sizeof(new_file->content) - 1] = '\0';
-                    fs_add_file(g_cwd, new_file);
-                    char msg[256];
-                    snprintf(msg, sizeof(msg), "File '%s' restored from trash.", name);
-                    gui_println(msg);
-                }
-            }
+    // Create the repository folder in virtual filesystem
+    if (strlen(repo_name) > 0) {
+        Directory* repo_dir = fs_create_dir(repo_name);
+        if (repo_dir) {
+            fs_add_child(g_cwd, repo_dir);
+            char msg[256];
+            snprintf(msg, sizeof(msg), "Repository '%s' added to virtual filesystem.", repo_name);
+            gui_println(msg);
             
-            free(current);
+            // Auto-save filesystem
             fs_save_to_disk();
-            return;
         }
-        prev = current;
-        current = current->next;
     }
     
-    gui_println("Item not found in trash.");
+    // Auto-sync to update virtual filesystem with cloned repository
+    cmd_sync();
 }
 
-static void cmd_trash(void) {
-    gui_println("Trash contents:");
-    gui_println("===============");
-    
-    if (!g_trash) {
-        gui_println("Trash is empty.");
+static void cmd_git_clone(const char* url) {
+    if (!url || !*url) {
+        gui_error("Usage: GIT CLONE <url>");
+        gui_println("Example: GIT CLONE https://github.com/user/repo.git");
         return;
     }
     
-    TrashItem* current = g_trash;
-    int count = 0;
+    gui_println("Cloning repository...");
+    gui_println("Note: This will clone to your actual file system.");
     
-    while (current) {
-        char type[16];
-        strcpy(type, current->is_directory ? "DIR" : "FILE");
-        
-        char msg[512];
-        snprintf(msg, sizeof(msg), "[%d] %s %s (from %s)", count + 1, type, current->name, current->path);
-        gui_println(msg);
-        
-        current = current->next;
-        count++;
-    }
+    char storage_path[2048];
+    git_work_tree(storage_path, sizeof(storage_path));
     
-    char count_msg[256];
-    snprintf(count_msg, sizeof(count_msg), "Total items in trash: %d", count);
-    gui_println(count_msg);
+    // Clone into the current folder (no .git folder needed)
+    const char* argv[] = { "git", "clone", url, NULL };
+    if (!job_start_argv(argv, g_gitEnv, storage_path, PF_SPAWN_CAPTURE, git_clone_done, url)) {
+        gui_error("Failed to execute Git command.");
+    }
 }
 
-static void cmd_emptytrash(void) {
-    gui_println("Emptying trash...");
-    
-    TrashItem* current = g_trash;
-    int count = 0;
-    
-    while (current) {
-        TrashItem* next = current->next;
-        free(current);
-        current = next;
-        count++;
+static void cmd_git_add(const char* file) {
+    if (!file || !*file) {
+        gui_error("Usage: GIT ADD <file> or GIT ADD .");
+        gui_println("Example: GIT ADD . (adds all files)");
+        return;
     }
     
-    g_trash = NULL;
-    
-    char msg[256];
-    snprintf(msg, sizeof(msg), "Trash emptied. %d items permanently deleted.", count);
-    gui_println(msg);
-}
-
-static void split_name_and_text(const char* arg, char* outName, size_t name_sz, const char** outText) {
-    while (*arg && isspace((unsigned char)*arg)) arg++;
-    size_t i = 0;
-    while (*arg && !isspace((unsigned char)*arg) && i + 1 < name_sz) { outName[i++] = *arg++; }
-    outName[i] = '\0';
-    while (*arg && isspace((unsigned char)*arg)) arg++;
-    *outText = arg;
+    char command[1024];
+    snprintf(command, sizeof(command), "add %s", file);
+    execute_git_command(command);
 }
 
-static void cmd_write(const char* args) {
-    char name[MAX_NAME]; const char* text = NULL; split_name_and_text(args ? args : "", name, sizeof(name), &text);
-    if (name[0] == '\0') { gui_println("Usage: WRITE <file> <text>"); return; }
-    File* f = fs_find_file(g_cwd, name);
-    if (!f) { f = fs_create_file(name); if (f) fs_add_file(g_cwd, f); }
-    if (!f) { gui_println("Out of memory creating file."); return; }
-    strncpy(f->content, text ? text : "", sizeof(f->content) - 1);
-    f->content[sizeof(f->content) - 1] = '\0';
-    
-    // Also write to real file system
-    char virtual_path[1024];
-    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-    
-    // Convert virtual path to real path using absolute paths
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char real_path[1024];
-    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-    if (profiles_pos) {
-        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-    } else {
-        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+static void cmd_git_commit(const char* message) {
+    if (!message || !*message) {
+        gui_error("Usage: GIT COMMIT -m <message>");
+        gui_println("Example: GIT COMMIT -m \"Initial commit\"");
+        return;
     }
     
-    // Add the filename to the path
-    char full_real_path[1024];
-    join_path(full_real_path, sizeof(full_real_path), real_path, name);
-    
-    // Write content to real file
-    HANDLE hFile = CreateFileA(full_real_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        DWORD bytesWritten;
-        WriteFile(hFile, f->content, strlen(f->content), &bytesWritten, NULL);
-        CloseHandle(hFile);
+    // Handle both "GIT COMMIT -m message" and "GIT COMMIT message" formats
+    char command[1024];
+    if (strncmp(message, "-m ", 3) == 0) {
+        // Already has -m flag
+        snprintf(command, sizeof(command), "commit %s", message);
+    } else {
+        // Add -m flag; the message is one argument whatever it contains
+        const char* args[] = { "commit", "-m", message, NULL };
+        execute_git_argv(args);
+        return;
     }
-    
-    gui_println("File written successfully.");
+    execute_git_command(command);
 }
 
-static void cmd_writeln(const char* args) {
-    char name[MAX_NAME]; 
-    const char* text = NULL; 
-    split_name_and_text(args ? args : "", name, sizeof(name), &text);
-    
-    if (name[0] == '\0') { 
-        gui_println("Usage: WRITELN <file> <text>"); 
-        gui_println("Writes text to file with automatic line breaks."); 
-        return; 
-    }
-    
-    if (!text || !*text) { 
-        gui_println("Usage: WRITELN <file> <text>"); 
-        return; 
-    }
-    
-    // Create or find the file
-    File* f = fs_find_file(g_cwd, name);
-    if (!f) {
-        f = fs_create_file(name);
-        if (!f) {
-            gui_println("Failed to create file.");
-            return;
-        }
-        fs_add_file(g_cwd, f);
-    }
-    
-    // Process text to add line breaks
-    char processed_text[MAX_FILE_SIZE];
-    int j = 0;
-    for (int i = 0; text[i] && j < MAX_FILE_SIZE - 1; i++) {
-        if (text[i] == '\\' && text[i+1] == 'n') {
-            processed_text[j++] = '\r';
-            processed_text[j++] = '\n';
-            i++; // Skip the 'n'
+static void cmd_git_status(void) {
+    gui_println("Git Status:");
+    GitRepo* repo = git_native_open();
+    if (!repo || !git_native_status(repo)) execute_git_command("status");
+    git_repo_close(repo);
+}
+
+static void cmd_git_log(void) {
+    gui_println("Git Log:");
+    GitRepo* repo = git_native_open();
+    char missing[300];
+    const char* branch = repo ? git_head_ref(repo) : NULL;
+    snprintf(missing, sizeof(missing), "fatal: your current branch '%s' does not have any commits yet",
+             branch && strncmp(branch, "refs/heads/", 11) == 0 ? branch + 11 : "HEAD");
+    if (!repo || !git_native_log(repo, "HEAD", 10, missing)) execute_git_command("log --oneline -10");
+    gui_println("Remote commits:");
+    if (!repo || !git_native_log(repo, "origin/main", 5, "No origin/main branch yet.")) {
+        execute_git_command("log --oneline origin/main -5");
+    }
+    git_repo_close(repo);
+}
+
+static void cmd_git_diff(void) {
+    gui_println("Git Diff:");
+    execute_git_command("diff");
+}
+
+static void cmd_git_branch(const char* name) {
+    if (!name || !*name) {
+        gui_println("Git Branches:");
+        GitRepo* repo = git_native_open();
+        if (repo) {
+            git_native_branches(repo);
+            git_repo_close(repo);
         } else {
-            processed_text[j++] = text[i];
+            execute_git_command("branch");
         }
+    } else {
+        char command[1024];
+        snprintf(command, sizeof(command), "branch %s", name);
+        execute_git_command(command);
     }
-    processed_text[j] = '\0';
-    
-    // Copy processed text to file content
-    strncpy(f->content, processed_text, MAX_FILE_SIZE - 1);
-    f->content[MAX_FILE_SIZE - 1] = '\0';
-    
-    // Save to real filesystem
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char virtual_path[1024];
-    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-    
-    char real_path[1024];
-    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-    if (profiles_pos) {
-        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
+}
+
+static void cmd_git_remote(const char* args) {
+    if (!args || !*args) {
+        gui_println("Git Remotes:");
+        execute_git_command("remote -v");
     } else {
-        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+        char command[1024];
+        snprintf(command, sizeof(command), "remote %s", args);
+        execute_git_command(command);
     }
-    
-    char full_real_path[1024];
-    join_path(full_real_path, sizeof(full_real_path), real_path, name);
-    
-    HANDLE hFile = CreateFileA(full_real_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        DWORD bytesWritten;
-        WriteFile(hFile, f->content, strlen(f->content), &bytesWritten, NULL);
-        CloseHandle(hFile);
+}
+
+static void cmd_git_checkout(const char* branch) {
+    if (!branch || !*branch) {
+        gui_error("Usage: GIT CHECKOUT <branch>");
+        gui_println("Example: GIT CHECKOUT main");
+        return;
     }
     
-    gui_println("File written with line breaks successfully.");
+    char command[1024];
+    snprintf(command, sizeof(command), "checkout %s", branch);
+    execute_git_command(command);
+    // Auto-sync to update virtual filesystem
+    cmd_sync();
 }
 
-static void cmd_writecode(const char* args) {
-    char name[MAX_NAME]; 
-    const char* text = NULL; 
-    split_name_and_text(args ? args : "", name, sizeof(name), &text);
-    
-    if (name[0] == '\0') { 
-        gui_println("Usage: WRITECODE <file> <code>"); 
-        gui_println("Writes code to file with proper formatting and syntax highlighting."); 
-        return; 
+static void cmd_git_merge(const char* branch) {
+    if (!branch || !*branch) {
+        gui_error("Usage: GIT MERGE <branch>");
+        gui_println("Example: GIT MERGE feature-branch");
+        return;
     }
     
-    if (!text || !*text) { 
-        gui_println("Usage: WRITECODE <file> <code>"); 
-        return; 
+    char command[1024];
+    snprintf(command, sizeof(command), "merge %s", branch);
+    execute_git_command(command);
+    // Auto-sync to update virtual filesystem
+    cmd_sync();
+}
+
+static void cmd_git_pull(void) {
+    gui_println("Pulling changes from remote...");
+    gui_println("Checking remote configuration...");
+    execute_git_command("remote -v");
+    gui_println("Checking current branch...");
+    execute_git_command("branch");
+    gui_println("Checking status before pull...");
+    execute_git_command("status");
+    gui_println("Executing git pull...");
+    execute_git_command("pull");
+    gui_println("Checking status after pull...");
+    execute_git_command("status");
+    // Auto-sync to update virtual filesystem
+    cmd_sync();
+}
+
+static void cmd_git_push(void) {
+    gui_println("Pushing changes to remote...");
+    gui_println("Checking commits ahead of remote...");
+    execute_git_command("log --oneline origin/main..HEAD");
+    gui_println("Executing git push...");
+    execute_git_command("push");
+}
+
+
+static void cmd_git_fetch(void) {
+    gui_println("Fetching changes from remote...");
+    execute_git_command("fetch");
+}
+
+static void cmd_git_reset(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: GIT RESET <file> or GIT RESET --hard");
+        gui_println("Example: GIT RESET --hard (reset all changes)");
+        return;
     }
     
-    // Create or find the file
-    File* f = fs_create_file(name);
-    if (!f) {
-        gui_println("Failed to create file.");
+    char command[1024];
+    snprintf(command, sizeof(command), "reset %s", args);
+    execute_git_command(command);
+}
+
+static void cmd_git_rm(const char* file) {
+    if (!file || !*file) {
+        gui_error("Usage: GIT RM <file> or GIT RM -r <folder>");
+        gui_println("Example: GIT RM file.txt (remove file from Git)");
+        gui_println("Example: GIT RM -r folder/ (remove folder from Git)");
         return;
     }
-    fs_add_file(g_cwd, f);
     
-    // Process code text
-    char processed_text[MAX_FILE_SIZE];
-    int j = 0;
-    for (int i = 0; text[i] && j < MAX_FILE_SIZE - 1; i++) {
-        if (text[i] == '\\' && text[i+1] == 'n') {
-            processed_text[j++] = '\r';
-            processed_text[j++] = '\n';
-            i++; // Skip the 'n'
-        } else if (text[i] == '\\' && text[i+1] == 't') {
-            processed_text[j++] = '\t';
-            i++; // Skip the 't'
-        } else {
-            processed_text[j++] = text[i];
-        }
+    char command[1024];
+    snprintf(command, sizeof(command), "rm %s", file);
+    execute_git_command(command);
+    // Auto-sync to update virtual filesystem
+    cmd_sync();
+}
+
+static void cmd_git_clean(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: GIT CLEAN -f (remove untracked files)");
+        gui_error("Usage: GIT CLEAN -fd (remove untracked files and directories)");
+        gui_println("Example: GIT CLEAN -fd (remove all untracked files and folders)");
+        return;
     }
-    processed_text[j] = '\0';
-    
-    // Copy processed text to file content
-    strncpy(f->content, processed_text, MAX_FILE_SIZE - 1);
-    f->content[MAX_FILE_SIZE - 1] = '\0';
     
-    // Save to real filesystem
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char virtual_path[1024];
-    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-    
-    char real_path[1024];
-    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-    if (profiles_pos) {
-        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-    } else {
-        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+    char command[1024];
+    snprintf(command, sizeof(command), "clean %s", args);
+    execute_git_command(command);
+    // Auto-sync to update virtual filesystem
+    cmd_sync();
+}
+
+static void cmd_git_stash(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: GIT STASH or GIT STASH POP");
+        gui_println("Example: GIT STASH (stash changes)");
+        return;
     }
     
-    char full_real_path[1024];
-    join_path(full_real_path, sizeof(full_real_path), real_path, name);
-    
-    HANDLE hFile = CreateFileA(full_real_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        DWORD bytesWritten;
-        WriteFile(hFile, f->content, strlen(f->content), &bytesWritten, NULL);
-        CloseHandle(hFile);
+    char command[1024];
+    snprintf(command, sizeof(command), "stash %s", args);
+    execute_git_command(command);
+}
+
+static void cmd_git_tag(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: GIT TAG <name> or GIT TAG -l");
+        gui_println("Example: GIT TAG -l (list tags)");
+        return;
     }
     
-    gui_println("Code file written successfully.");
+    GitRepo* repo = (str_icmp(args, "-l") == 0 || str_icmp(args, "--list") == 0) ? git_native_open() : NULL;
+    if (repo) {
+        git_native_tags(repo);
+        git_repo_close(repo);
+        return;
+    }
+    char command[1024];
+    snprintf(command, sizeof(command), "tag %s", args);
+    execute_git_command(command);
 }
 
-static void cmd_editcode(const char* args) {
-    char name[MAX_NAME];
-    if (sscanf(args, "%s", name) != 1) {
-        gui_println("Usage: EDITCODE <file>");
-        gui_println("Opens interactive code editor. Press Ctrl+S to save and exit.");
+static void cmd_git_config(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: GIT CONFIG --global user.name <name> or GIT CONFIG --list");
+        gui_println("Example: GIT CONFIG --list (show all config)");
         return;
     }
     
-    gui_println("=== INTERACTIVE CODE EDITOR ===");
-    char file_msg[256];
-    snprintf(file_msg, sizeof(file_msg), "File: %s", name);
-    gui_println(file_msg);
-    gui_println("Type your code line by line. Press Ctrl+S to save and exit.");
-    gui_println("Press Ctrl+C to cancel without saving.");
-    gui_println("----------------------------------------");
-    
-    // Create or find the file
-    File* f = fs_find_file(g_cwd, name);
-    if (!f) {
-        f = fs_create_file(name);
-        if (!f) {
-            gui_println("Failed to create file.");
-            return;
-        }
-        fs_add_file(g_cwd, f);
+    char command[1024];
+    snprintf(command, sizeof(command), "config %s", args);
+    execute_git_command(command);
+}
+
+static void cmd_git_help(const char* command) {
+    if (!command || !*command) {
+        gui_println("Available Git commands:");
+        gui_println("  INIT, CLONE, ADD, COMMIT, STATUS, LOG, DIFF");
+        gui_println("  BRANCH, CHECKOUT, MERGE, PULL, PUSH, REMOTE");
+        gui_println("  FETCH, RESET, RM, CLEAN, STASH, TAG, CONFIG, VERSION");
+        gui_println("Type 'HELP' for detailed command descriptions.");
+        return;
     }
     
-    // Clear existing content
-    f->content[0] = '\0';
-    
-    // Set up interactive editing mode
-    g_editMode = 1;
-    g_editFile = f;
-    g_editBuffer[0] = '\0';
-    g_editBufferPos = 0;
-    
-    gui_println("Ready to edit. Start typing...");
+    char git_help_cmd[1024];
+    snprintf(git_help_cmd, sizeof(git_help_cmd), "help %s", command);
+    execute_git_command(git_help_cmd);
+}
+
+static void cmd_git_version(void) {
+    gui_println("Git Version:");
+    execute_git_command("--version");
 }
 
-static void cmd_adduser(const char* username) {
-    if (!username || !*username) {
-        gui_println("Usage: ADDUSER <username>");
-        gui_println("Creates a new user with the specified name.");
-        gui_println("Example: ADDUSER Developer");
-        gui_println("         ADDUSER TestUser");
-        return;
+static void git_test_done(Job* job, int exit_code) {
+    (void)job;
+    if (exit_code == 0) {
+        gui_println("Git is working correctly!");
+    } else {
+        gui_error("Git is not installed or not in PATH.");
+        gui_println("Please install Git from https://git-scm.com/");
     }
+}
+
+// Test command to verify Git is working
+static void cmd_git_test(void) {
+    gui_println("Testing Git installation...");
+    gui_println("Running: git --version");
     
-    // Validate username (alphanumeric and underscore only)
-    for (const char* p = username; *p; p++) {
-        if (!isalnum(*p) && *p != '_') {
-            gui_println("Error: Username can only contain letters, numbers, and underscores.");
-            return;
-        }
+    const char* argv[] = { "git", "--version", NULL };
+    if (!job_start_argv(argv, NULL, NULL, PF_SPAWN_CAPTURE, git_test_done, NULL)) {
+        git_test_done(NULL, -1);
     }
+}
+
+// Show where Git operations happen
+static void cmd_git_pwd(void) {
+    gui_println("Git operations happen in the real Windows file system.");
+    gui_println("Current working directory for Git commands:");
     
-    // Check if username already exists
-    Directory* existing_user = fs_find_child(g_root, username);
-    if (existing_user) {
-        char msg[256];
-        snprintf(msg, sizeof(msg), "Error: User '%s' already exists.", username);
-        gui_println(msg);
-        return;
+    // Get current working directory
+    char cwd[1024];
+    if (pf_getcwd(cwd, sizeof(cwd))) {
+        gui_println(cwd);
+    } else {
+        gui_error("Unable to get current directory");
     }
     
-    // Create new user directory
-    Directory* new_user = fs_create_dir(username);
-    if (!new_user) {
-        gui_println("Error: Failed to create user directory.");
+    gui_println("");
+    gui_println("Terminal virtual filesystem path:");
+    char path[1024];
+    fs_print_path(g_cwd, path, sizeof(path));
+    gui_println(path);
+}
+
+static int parse_first_token(char* line, char** arg_out) {
+    while (*line && isspace((unsigned char)*line)) line++;
+    if (!*line) { *arg_out = line; return 0; }
+    char* p = line;
+    while (*p && !isspace((unsigned char)*p)) { p++; }
+    int has_cmd = (*line != '\0');
+    if (*p) { *p++ = '\0'; }
+    while (*p && isspace((unsigned char)*p)) p++;
+    *arg_out = p;
+    return has_cmd ? 1 : 0;
+}
+
+// Splits line in place into at most max - 1 words, NULL-terminated. Double
+// quotes group words and are dropped, as a command prompt would.
+static int split_args(char* line, char** argv, int max) {
+    int argc = 0;
+    char* p = line;
+    while (*p && argc < max - 1) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        char* out = p;
+        argv[argc++] = out;
+        BOOL quoted = FALSE;
+        while (*p && (quoted || !isspace((unsigned char)*p))) {
+            if (*p == '"') quoted = !quoted;
+            else *out++ = *p;
+            p++;
+        }
+        if (*p) p++;
+        *out = '\0';
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// Case-insensitive string comparison
+static int str_icmp(const char* s1, const char* s2) {
+    while (*s1 && *s2) {
+        int c1 = tolower((unsigned char)*s1);
+        int c2 = tolower((unsigned char)*s2);
+        if (c1 != c2) return c1 - c2;
+        s1++;
+        s2++;
+    }
+    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+}
+
+// ---------------- Command Implementations ----------------
+static void cmd_login(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: LOGIN <username> <password>");
         return;
     }
     
-    // Add user to root directory
-    fs_add_child(g_root, new_user);
-    
-    // Create default directories for the new user
-    Directory* user_docs = fs_create_dir("Documents");
-    Directory* user_desktop = fs_create_dir("Desktop");
-    Directory* user_downloads = fs_create_dir("Downloads");
-    Directory* user_settings = fs_create_dir("Settings");
-    
-    fs_add_child(new_user, user_docs);
-    fs_add_child(new_user, user_desktop);
-    fs_add_child(new_user, user_downloads);
-    fs_add_child(new_user, user_settings);
-    
-    // Create real filesystem directory
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char user_path[1024];
-    snprintf(user_path, sizeof(user_path), "%s\\data\\USERS\\%s", program_dir, username);
-    
-    // Create directory in real filesystem
-    if (!CreateDirectoryA(user_path, NULL)) {
-        DWORD error = GetLastError();
-        if (error != ERROR_ALREADY_EXISTS) {
-            char msg[256];
-            snprintf(msg, sizeof(msg), "Warning: Could not create real directory for user '%s'.", username);
-            gui_println(msg);
-        }
+    char username[64], password[128];
+    if (sscanf(args, "%63s %127s", username, password) != 2) {
+        gui_error("Usage: LOGIN <username> <password>");
+        return;
     }
     
-    // Create all preset directories in real filesystem
-    char settings_path[1024];
-    snprintf(settings_path, sizeof(settings_path), "%s\\Settings", user_path);
-    CreateDirectoryA(settings_path, NULL);
-    
-    char docs_path[1024];
-    snprintf(docs_path, sizeof(docs_path), "%s\\Documents", user_path);
-    CreateDirectoryA(docs_path, NULL);
-    
-    char desktop_path[1024];
-    snprintf(desktop_path, sizeof(desktop_path), "%s\\Desktop", user_path);
-    CreateDirectoryA(desktop_path, NULL);
-    
-    char downloads_path[1024];
-    snprintf(downloads_path, sizeof(downloads_path), "%s\\Downloads", user_path);
-    CreateDirectoryA(downloads_path, NULL);
-    
-    // All preset directories created in both virtual and real filesystem
-    
-    // Create README.txt for the new user
-    File* readme = fs_create_file("README.txt");
-    if (readme) {
-        snprintf(readme->content, sizeof(readme->content), 
-            "Welcome to %s's directory!\n\n"
-            "This is your personal workspace.\n"
-            "You can create files and folders here.\n\n"
-            "Available commands:\n"
-            "- MKDIR <name> - Create directory\n"
-            "- TOUCH <name> - Create file\n"
-            "- WRITE <file> <text> - Write to file\n"
-            "- EDITCODE <file> - Interactive code editor\n"
-            "- TYPE <file> - View file contents\n"
-            "- And many more! Type HELP for full list.", username);
+    if (authenticate_user(username, password)) {
+        gui_printf("Successfully logged in as %s", username);
         
-        fs_add_file(new_user, readme);
         
-        // Save README.txt to real filesystem
-        char readme_path[1024];
-        snprintf(readme_path, sizeof(readme_path), "%s\\README.txt", user_path);
+        // Update current user
+        strncpy(g_currentUser, username, sizeof(g_currentUser) - 1);
         
-        HANDLE hFile = CreateFileA(readme_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hFile != INVALID_HANDLE_VALUE) {
-            DWORD bytesWritten;
-            WriteFile(hFile, readme->content, strlen(readme->content), &bytesWritten, NULL);
-            CloseHandle(hFile);
+        // Switch to user's home directory
+        Directory* user_dir = fs_find_child(g_root, username);
+        if (user_dir) {
+            g_home = user_dir;
+            g_cwd = user_dir;
         }
+        
+        // Check if this was a system maintenance authentication attempt
+        if (strcmp(username, "Admin") == 0) {
+            gui_println("");
+            gui_println("Admin authentication successful.");
+            gui_println("System maintenance tools available: CD .system_maintenance");
+        }
+    } else {
+        gui_error("Login failed. Invalid username or password.");
     }
-    
-    // Create system maintenance folder for Admin user
-    if (strcmp(username, "Admin") == 0) {
-        create_system_maintenance_folder();
-    }
-    
-    // Save filesystem
-    fs_save_to_disk();
-    
-    char msg[256];
-    snprintf(msg, sizeof(msg), "User '%s' created successfully!", username);
-    gui_println(msg);
-    gui_println("The new user starts with an empty directory and a README.txt file.");
-    gui_println("Use 'USER <username>' to switch to the new user.");
 }
 
-
-static void cmd_append(const char* args) {
-    char name[MAX_NAME]; const char* text = NULL; split_name_and_text(args ? args : "", name, sizeof(name), &text);
-    if (name[0] == '\0') { gui_println("Usage: APPEND <file> <text>"); return; }
-    File* f = fs_find_file(g_cwd, name);
-    if (!f) { f = fs_create_file(name); if (f) fs_add_file(g_cwd, f); }
-    if (!f) { gui_println("Out of memory creating file."); return; }
-    size_t cur = strlen(f->content);
-    size_t left = (cur < sizeof(f->content)) ? (sizeof(f->content) - 1 - cur) : 0;
-    if (left == 0) { gui_println("File is full."); return; }
-    strncat(f->content, text ? text : "", left);
-    
-    // Also append to real file system
-    char virtual_path[1024];
-    fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-    
-    // Convert virtual path to real path using absolute paths
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    char real_path[1024];
-    const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-    if (profiles_pos) {
-        snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-    } else {
-        snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+static void cmd_logout(void) {
+    if (!g_currentSession.is_authenticated) {
+        gui_println("No active session to logout from.");
+        return;
     }
     
-    // Add the filename to the path
-    char full_real_path[1024];
-    join_path(full_real_path, sizeof(full_real_path), real_path, name);
+    gui_printf("Logged out from %s", g_currentSession.username);
     
-    // Append content to real file
-    HANDLE hFile = CreateFileA(full_real_path, GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        SetFilePointer(hFile, 0, NULL, FILE_END);
-        DWORD bytesWritten;
-        WriteFile(hFile, text ? text : "", strlen(text ? text : ""), &bytesWritten, NULL);
-        CloseHandle(hFile);
-    }
+    logout_user();
     
-    gui_println("Text appended successfully.");
+    // Switch back to Public user
+    strncpy(g_currentUser, "Public", sizeof(g_currentUser) - 1);
+    Directory* public_dir = fs_find_child(g_root, "Public");
+    if (public_dir) {
+        g_home = public_dir;
+        g_cwd = public_dir;
+    }
 }
 
-static void cmd_type(const char* name) {
-    if (!name || !*name) { gui_println("The system cannot find the file specified."); return; }
-    File* f = fs_find_file(g_cwd, name);
-    if (!f) { gui_println("The system cannot find the file specified."); return; }
-    
-    // Check if file has content
-    if (!f->content || strlen(f->content) == 0) {
-        gui_println("File is empty.");
+static void cmd_chpasswd(const char* args) {
+    if (!g_currentSession.is_authenticated) {
+        gui_error("You must be logged in to change password.");
         return;
     }
     
-    // Display file content with proper line break handling
-    const char* content = f->content;
-    const char* start = content;
-    
-    while (*content) {
-        if (*content == '\r' && *(content + 1) == '\n') {
-            // Windows line break - print up to this point
-            int len = content - start;
-            if (len > 0) {
-                char line[1024];
-                strncpy(line, start, len);
-                line[len] = '\0';
-                gui_println(line);
-            } else {
-                gui_println(""); // Empty line
-            }
-            content += 2; // Skip \r\n
-            start = content;
-        } else if (*content == '\n') {
-            // Unix line break - print up to this point
-            int len = content - start;
-            if (len > 0) {
-                char line[1024];
-                strncpy(line, start, len);
-                line[len] = '\0';
-                gui_println(line);
-            } else {
-                gui_println(""); // Empty line
-            }
-            content++; // Skip \n
-            start = content;
-        } else {
-            content++;
-        }
+    if (!args || !*args) {
+        gui_error("Usage: CHPASSWD <old_password> <new_password>");
+        return;
     }
     
-    // Print the last line if there's any content
-    if (content > start) {
-        int len = content - start;
-        char line[1024];
-        strncpy(line, start, len);
-        line[len] = '\0';
-        gui_println(line);
+    char old_password[128], new_password[128];
+    if (sscanf(args, "%127s %127s", old_password, new_password) != 2) {
+        gui_error("Usage: CHPASSWD <old_password> <new_password>");
+        return;
     }
-}
-
-static void cmd_cd(const char* path) {
-    if (!path || !*path || strcmp(path, "~") == 0) { g_cwd = g_home ? g_home : g_root; return; }
-    if (strcmp(path, "..") == 0) { if (g_cwd != g_root) g_cwd = g_cwd->parent; return; }
     
-        // Check for system maintenance folder access (admin only)
-        if (strcmp(path, ".system_maintenance") == 0) {
-            
-            // Verify admin privileges for system maintenance
-            if (strcmp(g_currentUser, "Admin") != 0) {
-                gui_println("Access denied. System maintenance requires Admin privileges.");
-                return;
-            }
-            
-            // Check if already in maintenance mode
-            if (g_systemMaintenanceMode) {
-                gui_println("Already in maintenance mode. Use SYSTEM_EXIT to exit.");
-                return;
-            }
-            
-            // Check if user is authenticated
-            if (!g_currentSession.is_authenticated) {
-                gui_println("System Maintenance Access");
-                gui_println("=========================");
-                gui_println("Enter Admin credentials:");
-                gui_println("Username: Admin");
-                gui_println("Password: [Enter your Admin password]");
-                gui_println("");
-                gui_println("Use: LOGIN Admin <password> to authenticate");
-                gui_println("Then use: CD .system_maintenance again");
-                return;
-            }
-            
-            // Activate system maintenance mode
-            g_systemMaintenanceMode = TRUE;
-            strcpy(g_systemMaintenancePath, "C:\\");
-            g_systemMaintenanceStart = time(NULL);
-            
-            gui_println("System maintenance mode activated.");
-            gui_println("Accessing real filesystem...");
-            gui_println("Use SYSTEM_* commands to interact with the real filesystem.");
-            gui_println("Type SYSTEM_EXIT to return to normal mode.");
-            return;
-        }
+    if (strlen(new_password) < 6) {
+        gui_error("Password must be at least 6 characters long.");
+        return;
+    }
     
-    Directory* d = fs_find_child(g_cwd, path);
-    if (d) { 
-        g_cwd = d; 
-        // Auto-detect project type when changing directories
-        detect_project_type();
-    } else { 
-        gui_println("The system cannot find the path specified."); 
+    if (change_password(g_currentSession.username, old_password, new_password)) {
+        gui_println("Password changed successfully.");
+    } else {
+        gui_error("Failed to change password. Check your current password.");
     }
 }
 
-static void cmd_echo(const char* text) { gui_println(text ? text : ""); }
-
-// -------- File system persistence --------
-static void join_path(char* out, size_t out_sz, const char* base, const char* name) {
-    size_t bl = strlen(base);
-    int needs_sep = (bl > 0 && base[bl-1] != '\\' && base[bl-1] != '/');
-    if (needs_sep) {
-        snprintf(out, out_sz, "%s\\%s", base, name);
+static void cmd_sessions(void) {
+    gui_println("Active Sessions:");
+    gui_println("===============");
+    
+    if (g_currentSession.is_authenticated) {
+        time_t now = time(NULL);
+        int session_duration = (int)(now - g_currentSession.session_start);
+        
+        gui_printf("User: %s | Session ID: %.8s... | Duration: %d seconds | Level: %d",
+                g_currentSession.username,
+                g_currentSession.session_id,
+                session_duration,
+                g_currentSession.privilege_level);
     } else {
-        snprintf(out, out_sz, "%s%s", base, name);
+        gui_println("No active sessions.");
     }
 }
 
-static BOOL mkdir_p(const char* pathIn) {
-    if (!pathIn || !*pathIn) return FALSE;
-    char* path = _strdup(pathIn);
-    if (!path) return FALSE;
-    size_t len = strlen(path);
-    for (size_t i = 0; i < len; ++i) {
-        if (path[i] == '/' || path[i] == '\\') {
-            char old = path[i]; path[i] = '\0';
-            if (*path) { CreateDirectoryA(path, NULL); }
-            path[i] = old;
+static void cmd_theme(const char* args) {
+    if (!args || !*args) {
+        gui_println("Available themes:");
+        for (int i = 0; i < g_themeCount; i++) {
+            gui_printf("  %s", g_themes[i].name);
         }
+        gui_error("Usage: THEME <theme_name>");
+        return;
     }
-    BOOL ok = CreateDirectoryA(path, NULL);
-    if (!ok) {
-        DWORD attrs = GetFileAttributesA(path);
-        ok = (attrs != INVALID_FILE_ATTRIBUTES) && (attrs & FILE_ATTRIBUTE_DIRECTORY);
-    }
-    free(path);
-    return ok;
-}
-
-static void save_dir_recursive(Directory* dir, const char* base) {
-    // Save files in this directory
-    for (int i = 0; i < dir->file_count; ++i) {
-        char fpath[MAX_PATH];
-        join_path(fpath, sizeof(fpath), base, dir->files[i]->name);
-        HANDLE h = CreateFileA(fpath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (h != INVALID_HANDLE_VALUE) {
-            DWORD toWrite = (DWORD)strlen(dir->files[i]->content);
-            DWORD written = 0;
-            if (toWrite > 0) WriteFile(h, dir->files[i]->content, toWrite, &written, NULL);
-            CloseHandle(h);
+    
+    if (strcmp(args, "LIST") == 0) {
+        gui_println("Available themes:");
+        for (int i = 0; i < g_themeCount; i++) {
+            gui_printf("  %s", g_themes[i].name);
         }
+        return;
     }
-    // Recurse into subdirectories
-    for (int i = 0; i < dir->child_count; ++i) {
-        char dpath[MAX_PATH];
-        join_path(dpath, sizeof(dpath), base, dir->children[i]->name);
-        mkdir_p(dpath);
-        save_dir_recursive(dir->children[i], dpath);
-    }
+    
+    apply_theme_silent(args, TRUE);
 }
 
-static void cmd_savefs(const char* base) {
-    if (!base || !*base) { gui_println("Usage: SAVEFS <path>"); return; }
-    if (!mkdir_p(base)) {
-        DWORD attrs = GetFileAttributesA(base);
-        if (attrs == INVALID_FILE_ATTRIBUTES || !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
-            gui_println("Failed to create target folder.");
-            return;
-        }
+static void cmd_settings(const char* args) {
+    if (!args || !*args) {
+        gui_println("Current Settings:");
+        gui_println("=================");
+        gui_printf("Theme: %s", g_settings.current_theme);
+        gui_printf("Font: %s (%dpt)", g_settings.font_name, g_settings.font_size);
+        gui_printf("Auto Sync: %s", g_settings.auto_sync_enabled ? "Enabled" : "Disabled");
+        gui_printf("Scrollback: %d lines", g_settings.scrollback_lines);
+        gui_printf("Python Worker: %s", g_settings.python_worker ? "Enabled" : "Disabled");
+        gui_printf("Program Limits: %s", job_limits_text());
+        gui_println("");
+        gui_println("Quick Commands:");
+        gui_println("  THEME <name>     - Change theme (classic, white, dark)");
+        gui_println("  SETTINGS RESET   - Reset to defaults");
+        return;
+    }
+    
+    if (strcmp(args, "RESET") == 0) {
+        // Reset to defaults
+        strcpy(g_settings.current_theme, "classic");
+        g_settings.cursor_blink_speed = 500;
+        g_settings.font_size = 14;
+        strcpy(g_settings.font_name, "Consolas");
+        g_settings.auto_sync_enabled = TRUE;
+        g_settings.show_hidden_files = FALSE;
+        strcpy(g_settings.default_editor, "notepad");
+        g_settings.max_history_size = 100;
+        g_settings.scrollback_lines = SCROLLBACK_DEFAULT;
+        g_settings.python_worker = FALSE;
+        python_worker_stop();
+        g_settings.job_time_limit = 0;
+        g_settings.job_cpu_limit = 0;
+        g_settings.job_memory_limit = 0;
+        g_settings.job_output_limit = 0;
+        g_settings.sound_enabled = TRUE;
+        g_settings.window_width = 800;
+        g_settings.window_height = 600;
+        g_settings.require_auth_for_admin = TRUE;
+        g_settings.session_timeout = 30;
+        
+        save_settings();
+        apply_theme("classic");
+        gui_println("Settings reset to defaults.");
+    } else {
+        gui_error("Usage: SETTINGS [RESET]");
     }
-    save_dir_recursive(g_root, base);
-    char msg[1024]; snprintf(msg, sizeof(msg), "Filesystem saved to %s", base);
-    gui_println(msg);
 }
 
-
-static void cmd_user(const char* username) {
-    if (!username || !*username) { 
-        gui_println("Usage: USER <username>"); 
-        gui_println("Available users:");
-        for (int i = 0; i < g_root->child_count; i++) {
-            char msg[256];
-            snprintf(msg, sizeof(msg), "  %s", g_root->children[i]->name);
-            gui_println(msg);
-        }
-        return; 
+static void cmd_set(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: SET <setting> <value>");
+        gui_println("Available settings: current_theme, font_size, font_name, cursor_blink_speed, auto_sync_enabled, show_hidden_files, default_editor, window_width, window_height, session_timeout, require_auth_for_admin, scrollback_lines, python_worker, job_time_limit, job_cpu_limit, job_memory_limit, job_output_limit");
+        return;
     }
     
-    Directory* user_dir = fs_find_child(g_root, username);
-    if (!user_dir) { 
-        char msg[256]; 
-        snprintf(msg, sizeof(msg), "Invalid user. Available users:");
-        gui_println(msg);
-        for (int i = 0; i < g_root->child_count; i++) {
-            char user_msg[256];
-            snprintf(user_msg, sizeof(user_msg), "  %s", g_root->children[i]->name);
-            gui_println(user_msg);
-        }
+    char setting[64], value[128];
+    if (sscanf(args, "%63s %127s", setting, value) != 2) {
+        gui_error("Usage: SET <setting> <value>");
         return;
     }
     
-    // Check if user has authentication credentials
-    BOOL user_has_auth = FALSE;
-    for (int i = 0; i < g_authCount; i++) {
-        if (strcmp(g_userAuth[i].username, username) == 0) {
-            user_has_auth = TRUE;
-            break;
+    BOOL changed = FALSE;
+    
+    if (strcmp(setting, "current_theme") == 0) {
+        strncpy(g_settings.current_theme, value, sizeof(g_settings.current_theme) - 1);
+        apply_theme(value);
+        changed = TRUE;
+    } else if (strcmp(setting, "font_size") == 0) {
+        int size = atoi(value);
+        if (size >= 8 && size <= 72) {
+            g_settings.font_size = size;
+            changed = TRUE;
+        } else {
+            gui_error("Font size must be between 8 and 72.");
+            return;
+        }
+    } else if (strcmp(setting, "font_name") == 0) {
+        strncpy(g_settings.font_name, value, sizeof(g_settings.font_name) - 1);
+        changed = TRUE;
+    } else if (strcmp(setting, "cursor_blink_speed") == 0) {
+        int speed = atoi(value);
+        if (speed >= 100 && speed <= 2000) {
+            g_settings.cursor_blink_speed = speed;
+            changed = TRUE;
+        } else {
+            gui_error("Cursor speed must be between 100 and 2000 milliseconds.");
+            return;
+        }
+    } else if (strcmp(setting, "auto_sync_enabled") == 0) {
+        g_settings.auto_sync_enabled = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        changed = TRUE;
+    } else if (strcmp(setting, "show_hidden_files") == 0) {
+        g_settings.show_hidden_files = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        changed = TRUE;
+    } else if (strcmp(setting, "default_editor") == 0) {
+        strncpy(g_settings.default_editor, value, sizeof(g_settings.default_editor) - 1);
+        changed = TRUE;
+    } else if (strcmp(setting, "window_width") == 0) {
+        int width = atoi(value);
+        if (width >= 400 && width <= 2000) {
+            g_settings.window_width = width;
+            changed = TRUE;
+        } else {
+            gui_error("Window width must be between 400 and 2000 pixels.");
+            return;
+        }
+    } else if (strcmp(setting, "window_height") == 0) {
+        int height = atoi(value);
+        if (height >= 300 && height <= 1500) {
+            g_settings.window_height = height;
+            changed = TRUE;
+        } else {
+            gui_error("Window height must be between 300 and 1500 pixels.");
+            return;
+        }
+    } else if (strcmp(setting, "session_timeout") == 0) {
+        int timeout = atoi(value);
+        if (timeout >= 5 && timeout <= 480) {
+            g_settings.session_timeout = timeout;
+            changed = TRUE;
+        } else {
+            gui_error("Session timeout must be between 5 and 480 minutes.");
+            return;
+        }
+    } else if (strcmp(setting, "require_auth_for_admin") == 0) {
+        g_settings.require_auth_for_admin = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        changed = TRUE;
+    } else if (strcmp(setting, "scrollback_lines") == 0) {
+        int lines = atoi(value);
+        if (lines >= SCROLLBACK_MIN && lines <= SCROLLBACK_MAX) {
+            g_settings.scrollback_lines = lines;
+            gui_refresh();
+            changed = TRUE;
+        } else {
+            gui_errorf("Scrollback must be between %d and %d lines.", SCROLLBACK_MIN, SCROLLBACK_MAX);
+            return;
         }
-    }
-    
-    // If user has authentication credentials, require login
-    if (user_has_auth) {
-        if (!g_currentSession.is_authenticated || strcmp(g_currentSession.username, username) != 0) {
-            gui_println("User access requires authentication.");
-            gui_printf("Use: LOGIN %s <password>", username);
+    } else if (strcmp(setting, "python_worker") == 0) {
+        g_settings.python_worker = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        if (!g_settings.python_worker) python_worker_stop();
+        changed = TRUE;
+    } else if (job_limit_setting(setting)) {
+        int limit = atoi(value);
+        if (value[strspn(value, "0123456789")] != '\0' || limit > job_limit_max(setting)) {
+            gui_errorf("%s must be a whole number from 0 (no limit) to %d.", setting, job_limit_max(setting));
             return;
         }
+        *job_limit_setting(setting) = limit;
+        changed = TRUE;
     } else {
-        // User doesn't have authentication setup
-        gui_printf("User '%s' does not have authentication setup.", username);
-        gui_printf("Use: SETUP_AUTH %s <password>", username);
-        return; 
+        gui_error("Unknown setting. Use SETTINGS to see available options.");
+        return;
     }
     
-    strncpy(g_currentUser, username, sizeof(g_currentUser) - 1);
-    g_currentUser[sizeof(g_currentUser) - 1] = '\0';
-    g_home = user_dir;
-    g_cwd = user_dir;
-    
-    char msg[256]; 
-    snprintf(msg, sizeof(msg), "Switched to user: %s", username);
-    gui_println(msg);
-}
-
-static void cmd_whoami(void) {
-    char msg[256]; 
-    snprintf(msg, sizeof(msg), "Current user: %s", g_currentUser);
-    gui_println(msg);
+    if (changed) {
+        save_settings();
+        gui_printf("Setting '%s' updated to '%s'", setting, value);
+    }
 }
 
-static void cmd_users(void) {
-    gui_println("Available users:");
-    for (int i = 0; i < g_root->child_count; i++) {
-        char msg[256];
-        snprintf(msg, sizeof(msg), "  %s", g_root->children[i]->name);
-        gui_println(msg);
+static void cmd_get(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: GET <setting>");
+        return;
+    }
+    
+    if (strcmp(args, "current_theme") == 0) {
+        gui_println(g_settings.current_theme);
+    } else if (strcmp(args, "font_size") == 0) {
+        gui_printf("%d", g_settings.font_size);
+    } else if (strcmp(args, "font_name") == 0) {
+        gui_println(g_settings.font_name);
+    } else if (strcmp(args, "cursor_blink_speed") == 0) {
+        gui_printf("%d", g_settings.cursor_blink_speed);
+    } else if (strcmp(args, "auto_sync_enabled") == 0) {
+        gui_println(g_settings.auto_sync_enabled ? "true" : "false");
+    } else if (strcmp(args, "show_hidden_files") == 0) {
+        gui_println(g_settings.show_hidden_files ? "true" : "false");
+    } else if (strcmp(args, "default_editor") == 0) {
+        gui_println(g_settings.default_editor);
+    } else if (strcmp(args, "window_width") == 0) {
+        gui_printf("%d", g_settings.window_width);
+    } else if (strcmp(args, "window_height") == 0) {
+        gui_printf("%d", g_settings.window_height);
+    } else if (strcmp(args, "session_timeout") == 0) {
+        gui_printf("%d", g_settings.session_timeout);
+    } else if (strcmp(args, "require_auth_for_admin") == 0) {
+        gui_println(g_settings.require_auth_for_admin ? "true" : "false");
+    } else if (strcmp(args, "scrollback_lines") == 0) {
+        gui_printf("%d", g_settings.scrollback_lines);
+    } else if (strcmp(args, "python_worker") == 0) {
+        gui_println(g_settings.python_worker ? "true" : "false");
+    } else if (job_limit_setting(args)) {
+        gui_printf("%d", *job_limit_setting(args));
+    } else {
+        gui_error("Unknown setting. Use SETTINGS to see available options.");
     }
-    gui_println("");
-    gui_println("User profiles are stored in: C:\\USERS\\");
 }
 
-// Filesystem tree display functions
-static void print_filesystem_tree_recursive(Directory* dir, int level, int is_last, char* prefix) {
-    if (!dir) return;
+static void cmd_setup_auth(const char* args) {
+    if (!args || !*args) {
+        gui_error("Usage: SETUP_AUTH <username> <password>");
+        gui_println("Sets up authentication for a user account.");
+        gui_println("Example: SETUP_AUTH Public mypassword123");
+        gui_println("         SETUP_AUTH Admin admin123");
+        return;
+    }
     
-    // Print current directory
-    char line[512];
-    char type = 'D';
-    char connector[16];
+    char username[64], password[64];
+    if (sscanf(args, "%63s %63s", username, password) != 2) {
+        gui_error("Usage: SETUP_AUTH <username> <password>");
+        return;
+    }
     
-    if (level == 0) {
-        // Root directory
-        snprintf(line, sizeof(line), "|%s[%c] %s", prefix, type, dir->name);
-    } else {
-        // Child directory
-        if (is_last) {
-            strcpy(connector, "└── ");
-        } else {
-            strcpy(connector, "├── ");
-        }
-        snprintf(line, sizeof(line), "|%s%s[%c] %s", prefix, connector, type, dir->name);
+    // Check if user exists in filesystem
+    Directory* user_dir = fs_find_child(g_root, username);
+    if (!user_dir) {
+        gui_errorf("Error: User '%s' does not exist.", username);
+        gui_println("Use ADDUSER to create the user first.");
+        return;
     }
-    gui_println(line);
     
-    // Update prefix for children
-    char new_prefix[256];
-    if (level == 0) {
-        strcpy(new_prefix, "");
-    } else {
-        if (is_last) {
-            snprintf(new_prefix, sizeof(new_prefix), "%s    ", prefix);
-        } else {
-            snprintf(new_prefix, sizeof(new_prefix), "%s│   ", prefix);
+    // Check if user already has authentication
+    for (int i = 0; i < g_authCount; i++) {
+        if (strcmp(g_userAuth[i].username, username) == 0) {
+            gui_printf("User '%s' already has authentication setup.", username);
+            gui_println("Use CHPASSWD to change password.");
+            return;
         }
     }
     
-    // Print files first
-    for (int i = 0; i < dir->file_count; i++) {
-        char file_line[512];
-        char file_connector[16];
+    // Create user account with authentication
+    if (create_user_account(username, password, 0)) { // Default privilege level 0
+        // Save authentication to user's Settings folder
+        char program_dir[1024];
+        get_main_project_dir(program_dir, sizeof(program_dir));
         
-        // Check if this is the last item (after all directories)
-        int is_last_item = (i == dir->file_count - 1) && (dir->child_count == 0);
+        char user_auth_file[1024];
+        snprintf(user_auth_file, sizeof(user_auth_file), "%s\\data\\USERS\\%s\\Settings\\auth.dat", program_dir, username);
         
-        if (is_last_item) {
-            strcpy(file_connector, "└── ");
-        } else {
-            strcpy(file_connector, "├── ");
+        // Create Settings directory if it doesn't exist
+        char settings_dir[1024];
+        snprintf(settings_dir, sizeof(settings_dir), "%s\\data\\USERS\\%s\\Settings", program_dir, username);
+        pf_mkdir(settings_dir);
+        
+        // Save authentication data
+        FILE* f = pf_fopen(user_auth_file, "w");
+        if (f) {
+            // Find the user in our auth array
+            for (int i = 0; i < g_authCount; i++) {
+                if (strcmp(g_userAuth[i].username, username) == 0) {
+                    fprintf(f, "USER:%s|%s|%s|%ld|%ld|%d|%ld|%d|%d\n",
+                        g_userAuth[i].username,
+                        g_userAuth[i].password_hash,
+                        g_userAuth[i].salt,
+                        g_userAuth[i].last_login,
+                        g_userAuth[i].password_changed,
+                        g_userAuth[i].failed_attempts,
+                        g_userAuth[i].locked_until,
+                        g_userAuth[i].privilege_level,
+                        g_userAuth[i].is_active ? 1 : 0);
+                    break;
+                }
+            }
+            fclose(f);
         }
         
-        snprintf(file_line, sizeof(file_line), "|%s%s[F] %s", new_prefix, file_connector, dir->files[i]->name);
-        gui_println(file_line);
-    }
-    
-    // Print subdirectories
-    for (int i = 0; i < dir->child_count; i++) {
-        int is_last_dir = (i == dir->child_count - 1);
-        print_filesystem_tree_recursive(dir->children[i], level + 1, is_last_dir, new_prefix);
-    }
-}
-
-static void print_filesystem_visualization(Directory* dir, const char* user_name) {
-    gui_println("+-------------------------------------------------------------+");
-    gui_println("|                    FILESYSTEM TREE STRUCTURE               |");
-    gui_println("+-------------------------------------------------------------+");
-    
-    char user_line[64];
-    snprintf(user_line, sizeof(user_line), "|  User: %-50s |", user_name);
-    gui_println(user_line);
-    
-    gui_println("|                                                         |");
-    gui_println("|  Directory Structure:                                   |");
-    
-    if (dir) {
-        print_filesystem_tree_recursive(dir, 0, 1, "");
+        // Also create a virtual file in the Settings folder
+        Directory* settings_dir_virtual = fs_find_child(user_dir, "Settings");
+        if (settings_dir_virtual) {
+            File* auth_file_virtual = fs_create_file("auth.dat");
+            if (auth_file_virtual) {
+                // Find the user in our auth array
+                for (int i = 0; i < g_authCount; i++) {
+                    if (strcmp(g_userAuth[i].username, username) == 0) {
+                        snprintf(auth_file_virtual->content, sizeof(auth_file_virtual->content),
+                            "USER:%s|%s|%s|%ld|%ld|%d|%ld|%d|%d",
+                            g_userAuth[i].username,
+                            g_userAuth[i].password_hash,
+                            g_userAuth[i].salt,
+                            g_userAuth[i].last_login,
+                            g_userAuth[i].password_changed,
+                            g_userAuth[i].failed_attempts,
+                            g_userAuth[i].locked_until,
+                            g_userAuth[i].privilege_level,
+                            g_userAuth[i].is_active ? 1 : 0);
+                        break;
+                    }
+                }
+                fs_add_file(settings_dir_virtual, auth_file_virtual);
+            }
+        }
+        
+        gui_printf("Authentication setup complete for user '%s'", username);
+        gui_println("You can now use LOGIN to authenticate before switching users.");
     } else {
-        gui_println("|  (No files or directories found)                        |");
+        gui_error("Failed to setup authentication. Maximum accounts reached.");
     }
-    
-    gui_println("|                                                         |");
-    gui_println("|  Legend: [D] = Directory, [F] = File                     |");
-    gui_println("+-------------------------------------------------------------+");
 }
 
-static void cmd_fileview(void) {
-    // Display filesystem tree visualization
-    print_filesystem_visualization(g_cwd, g_currentUser);
-}
-
-static void cmd_sync(void) {
-    // Syncing virtual filesystem with real filesystem silently
-    
-    // Get the main project directory
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    // Get the current working directory path in the real file system
-    char current_real_dir[2048];
-    char current_path[2048];
-    
-    // Build the real path based on current virtual directory
-    if (g_cwd == g_home) {
-        // We're in the user's home directory
-        snprintf(current_real_dir, sizeof(current_real_dir), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-    } else {
-        // We're in a subdirectory, build the full path
-        fs_print_path(g_cwd, current_path, sizeof(current_path));
-        
-        // Find the position after "C:\\USERS\\"
-        char* profiles_pos = strstr(current_path, "\\USERS\\");
-        if (profiles_pos) {
-            // Skip "C:\USERS\" and add the rest to the base path
-            char* relative_path = profiles_pos + 7; // Skip "\USERS\"
-            snprintf(current_real_dir, sizeof(current_real_dir), "%s\\data\\USERS\\%s", program_dir, relative_path);
-        } else {
-            // Fallback to current user's directory
-            snprintf(current_real_dir, sizeof(current_real_dir), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-        }
-    }
-    
-    
-    // Scan the real directory and add missing folders to virtual filesystem
-    WIN32_FIND_DATAA findData;
-    char search_path[2048];
-    snprintf(search_path, sizeof(search_path), "%s\\*", current_real_dir);
-    
-    HANDLE hFind = FindFirstFileA(search_path, &findData);
-    if (hFind != INVALID_HANDLE_VALUE) {
-        do {
-            // Skip . and .. entries
-            if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0) {
-                continue;
-            }
-            
-            // Check if it's a directory
-            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                // Check if this directory exists in virtual filesystem
-                Directory* existing = fs_find_child(g_cwd, findData.cFileName);
-                if (!existing) {
-                    // Create the directory in virtual filesystem
-                    Directory* new_dir = fs_create_dir(findData.cFileName);
-                    if (new_dir) {
-                        fs_add_child(g_cwd, new_dir);
-                        // Directory added silently
-                    }
-                }
-            } else {
-                // It's a file - check if this file exists in virtual filesystem
-                File* existing_file = fs_find_file(g_cwd, findData.cFileName);
-                if (!existing_file) {
-                    // Read the file content from real filesystem
-                    char full_path[2048];
-                    snprintf(full_path, sizeof(full_path), "%s\\%s", current_real_dir, findData.cFileName);
-                    
-                    HANDLE hFile = CreateFileA(full_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-                    if (hFile != INVALID_HANDLE_VALUE) {
-                        DWORD fileSize = GetFileSize(hFile, NULL);
-                        if (fileSize > 0 && fileSize < 10240) { // Only read files smaller than 10KB
-                            char* content = (char*)malloc(fileSize + 1);
-                            if (content) {
-                                DWORD bytesRead;
-                                if (ReadFile(hFile, content, fileSize, &bytesRead, NULL)) {
-                                    content[bytesRead] = '\0';
-                                    
-                                    // Create the file in virtual filesystem
-                                    File* new_file = fs_create_file(findData.cFileName);
-                                    if (new_file) {
-                                        // Set the file content
-                                        strncpy(new_file->content, content, sizeof(new_file->content) - 1);
-                                        new_file->content[sizeof(new_file->content) - 1] = '\0';
-                                        
-                                        fs_add_file(g_cwd, new_file);
-                                        char msg[256];
-                                        snprintf(msg, sizeof(msg), "Added missing file: %s", findData.cFileName);
-                                        gui_println(msg);
-                                    }
-                                }
-                                free(content);
-                            }
-                        }
-                        CloseHandle(hFile);
-                    }
+// ---------------- Command table ----------------
+// Every command is a row: name, aliases, handler, privilege and help. A row
+// with a sub-table (GIT, NPM, ...) hands the next word to that table; its own
+// handler gets the arguments when there is no sub-command or it is unknown.
+// HELP is printed from the same rows, in table order.
+#define COMMAND_MAX_ALIASES 2
+#define COMMAND_HASH_SLOTS 128     // power of two, at least the number of names
+#define COMMAND_HASH_BUCKETS 32    // power of two
+#define COMMAND_QUIT 0x1           // EXIT: the terminal closes
+#define COMMAND_RAW 0x2            // arguments are text: '|' and '>' are not operators
+
+typedef struct CommandTable CommandTable;
+typedef struct Completion Completion;
+
+typedef struct {
+    const char* name;                     // NULL: a section heading, help is its title
+    const char* aliases[COMMAND_MAX_ALIASES];
+    void (*run)(const char* args);
+    void (*plain)(void);                  // for commands that take no arguments
+    CommandTable* sub;
+    void (*complete)(Completion* c);      // Tab on its first argument: completion_offer names
+    int privilege;                        // has_privilege level, 0 = everyone
+    int flags;
+    const char* help;                     // "usage\tdescription" lines; NULL hides the row
+} Command;
+
+// Names are found through a perfect hash (hash and displace): a name's
+// bucket picks a seed, and that seed sends every name in the bucket to its
+// own slot. The rows are fixed when the program is compiled; the seeds are
+// worked out the first time a table is used.
+struct CommandTable {
+    const Command* commands;
+    int count;
+    int ready;                            // 0 not built, 1 hashed, -1 fall back to a scan
+    unsigned short seed[COMMAND_HASH_BUCKETS];
+    short slot[COMMAND_HASH_SLOTS];       // row index, -1 when empty
+};
+
+#define COMMAND_TABLE(rows) { rows, (int)(sizeof(rows) / sizeof((rows)[0])), 0, {0}, {0} }
+
+static unsigned int command_hash(const char* name, unsigned int seed) {
+    unsigned int h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (; *name; name++) {
+        h ^= (unsigned char)tolower((unsigned char)*name);
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+static BOOL command_matches(const Command* cmd, const char* word) {
+    if (!cmd->name) return FALSE;
+    if (str_icmp(cmd->name, word) == 0) return TRUE;
+    for (int i = 0; i < COMMAND_MAX_ALIASES && cmd->aliases[i]; i++) {
+        if (str_icmp(cmd->aliases[i], word) == 0) return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL command_table_build(CommandTable* table) {
+    const char* keys[COMMAND_HASH_SLOTS];
+    short rows[COMMAND_HASH_SLOTS];
+    int bucket_of[COMMAND_HASH_SLOTS];
+    int bucket_size[COMMAND_HASH_BUCKETS] = {0};
+    int key_count = 0;
+
+    for (int i = 0; i < table->count; i++) {
+        const Command* cmd = &table->commands[i];
+        if (!cmd->name) continue;
+        for (int k = -1; k < COMMAND_MAX_ALIASES; k++) {
+            const char* key = (k < 0) ? cmd->name : cmd->aliases[k];
+            if (!key) break;
+            if (key_count == COMMAND_HASH_SLOTS) return FALSE;
+            keys[key_count] = key;
+            rows[key_count] = (short)i;
+            bucket_of[key_count] = (int)(command_hash(key, 0) & (COMMAND_HASH_BUCKETS - 1));
+            bucket_size[bucket_of[key_count]]++;
+            key_count++;
+        }
+    }
+
+    for (int s = 0; s < COMMAND_HASH_SLOTS; s++) table->slot[s] = -1;
+    memset(table->seed, 0, sizeof(table->seed));
+
+    // Fullest buckets first, while there is the most room
+    BOOL placed[COMMAND_HASH_BUCKETS] = {FALSE};
+    for (int round = 0; round < COMMAND_HASH_BUCKETS; round++) {
+        int b = -1;
+        for (int i = 0; i < COMMAND_HASH_BUCKETS; i++) {
+            if (!placed[i] && (b < 0 || bucket_size[i] > bucket_size[b])) b = i;
+        }
+        placed[b] = TRUE;
+        if (bucket_size[b] == 0) break;
+
+        unsigned int seed;
+        for (seed = 1; seed <= 0xFFFF; seed++) {
+            int taken[COMMAND_HASH_SLOTS];
+            int n = 0;
+            BOOL ok = TRUE;
+            for (int k = 0; k < key_count && ok; k++) {
+                if (bucket_of[k] != b) continue;
+                int s = (int)(command_hash(keys[k], seed) & (COMMAND_HASH_SLOTS - 1));
+                if (table->slot[s] >= 0) ok = FALSE;
+                for (int j = 0; j < n && ok; j++) {
+                    if (taken[j] == s) ok = FALSE;
                 }
+                taken[n++] = s;
             }
-        } while (FindNextFileA(hFind, &findData));
-        FindClose(hFind);
-    } else {
-        gui_println("No files found in real directory or directory doesn't exist.");
+            if (!ok) continue;
+            n = 0;
+            for (int k = 0; k < key_count; k++) {
+                if (bucket_of[k] == b) table->slot[taken[n++]] = rows[k];
+            }
+            table->seed[b] = (unsigned short)seed;
+            break;
+        }
+        if (seed > 0xFFFF) return FALSE;
     }
-    
-    // Save the updated filesystem
-    fs_save_to_disk();
-    gui_println("Sync completed successfully!");
+    return TRUE;
 }
 
-// Helper function to get the main project directory (not the build directory)
-static void get_main_project_dir(char* buffer, size_t size) {
-    // Get the executable's full path
-    GetModuleFileNameA(NULL, buffer, (DWORD)size);
-    
-    // Find the last backslash and remove the filename
-    char* last_slash = strrchr(buffer, '\\');
-    if (last_slash) {
-        *last_slash = '\0';  // Remove the executable filename (now in build directory)
+static const Command* command_lookup(CommandTable* table, const char* word) {
+    if (table->ready == 0) table->ready = command_table_build(table) ? 1 : -1;
+    if (table->ready < 0) {
+        for (int i = 0; i < table->count; i++) {
+            if (command_matches(&table->commands[i], word)) return &table->commands[i];
+        }
+        return NULL;
     }
-    
-    // Now we're in the build directory, go up one level to the main project directory
-    last_slash = strrchr(buffer, '\\');
-    if (last_slash) {
-        *last_slash = '\0';  // Go up one level from build/ to main project directory
+    unsigned int b = command_hash(word, 0) & (COMMAND_HASH_BUCKETS - 1);
+    int row = table->slot[command_hash(word, table->seed[b]) & (COMMAND_HASH_SLOTS - 1)];
+    if (row >= 0 && command_matches(&table->commands[row], word)) return &table->commands[row];
+    return NULL;
+}
+
+// ---- Handlers that only exist as table rows ----
+static void cmd_test(void) {
+    gui_println("Test command works!");
+}
+
+static void cmd_git_usage(const char* args) {
+    if (!*args) {
+        gui_error("Usage: GIT <command> [options]");
+        gui_println("Type 'HELP' to see all available Git commands.");
+        return;
+    }
+    char git_cmd[64];
+    if (sscanf(args, "%63s", git_cmd) != 1) git_cmd[0] = '\0';
+    for (char* p = git_cmd; *p; p++) {
+        *p = (char)toupper((unsigned char)*p);
     }
+    char msg[256];
+    snprintf(msg, sizeof(msg), "Git command '%s' not recognized.", git_cmd);
+    gui_println(msg);
+    gui_println("Type 'HELP' to see all available Git commands.");
 }
 
-// Simple Git command implementations using system calls
-static void execute_git_command(const char* git_args) {
-    char command[1024];
-    snprintf(command, sizeof(command), "git %s", git_args);
-    
-    // Get the current working directory path in the real file system
-    char storage_path[2048];
-    char current_path[2048];
-    
-    // Build the real path based on current virtual directory
-    // Get the main project directory (not the build directory)
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    if (g_cwd == g_home) {
-        // We're in the user's home directory
-        snprintf(storage_path, sizeof(storage_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+static void cmd_react_usage(const char* args) {
+    if (!*args) {
+        gui_error("Usage: REACT <command> [args]");
     } else {
-        // We're in a subdirectory, build the full path
-        fs_print_path(g_cwd, current_path, sizeof(current_path));
-        
-        // Convert virtual path to real path
-        // Virtual path: C:\USERS\Public\folder\subfolder
-        // Real path: [program_dir]\data\USERS\Public\folder\subfolder
-        
-        // Find the position after "C:\\USERS\\"
-        char* profiles_pos = strstr(current_path, "\\USERS\\");
-        if (profiles_pos) {
-            // Skip "C:\USERS\" and add the rest to the base path
-            char* relative_path = profiles_pos + 7; // Skip "\USERS\"
-            snprintf(storage_path, sizeof(storage_path), "%s\\data\\USERS\\%s", program_dir, relative_path);
+        gui_error("Unknown React command. Use REACT HELP for available commands.");
+    }
+}
+
+// Printed from the tables below
+static void cmd_help(void);
+static void cmd_react_help(void);
+
+static void complete_npm_script(Completion* c);
+
+static void cmd_system_usage(const char* args) {
+    (void)args;
+    gui_error("Usage: SYSTEM_LS | SYSTEM_CD | SYSTEM_CAT | SYSTEM_COPY | SYSTEM_EXIT | SYSTEM_LOG");
+    gui_println("Use CD .system_maintenance first.");
+}
+
+// ---- Tables ----
+static const Command g_gitRows[] = {
+    { .name = "INIT", .plain = cmd_git_init, .help = "GIT INIT\tInitialize a new Git repository" },
+    { .name = "CLONE", .run = cmd_git_clone, .help = "GIT CLONE <url>\tClone a repository from URL" },
+    { .name = "ADD", .run = cmd_git_add,
+      .help = "GIT ADD <file>\tAdd file to staging area\nGIT ADD .\tAdd all files to staging area" },
+    { .name = "COMMIT", .run = cmd_git_commit, .help = "GIT COMMIT -m <msg>\tCommit staged changes with message" },
+    { .name = "STATUS", .plain = cmd_git_status, .help = "GIT STATUS\tShow repository status" },
+    { .name = "LOG", .plain = cmd_git_log, .help = "GIT LOG\tShow commit history" },
+    { .name = "DIFF", .plain = cmd_git_diff, .help = "GIT DIFF\tShow changes between commits" },
+    { .name = "BRANCH", .run = cmd_git_branch,
+      .help = "GIT BRANCH\tList branches\nGIT BRANCH <name>\tCreate new branch" },
+    { .name = "CHECKOUT", .run = cmd_git_checkout, .help = "GIT CHECKOUT <branch>\tSwitch to branch" },
+    { .name = "MERGE", .run = cmd_git_merge, .help = "GIT MERGE <branch>\tMerge branch into current" },
+    { .name = "PULL", .plain = cmd_git_pull, .help = "GIT PULL\tPull changes from remote" },
+    { .name = "PUSH", .plain = cmd_git_push, .help = "GIT PUSH\tPush changes to remote" },
+    { .name = "REMOTE", .run = cmd_git_remote,
+      .help = "GIT REMOTE -v\tList remote repositories\nGIT REMOTE ADD <name> <url>\tAdd remote repository" },
+    { .name = "FETCH", .plain = cmd_git_fetch, .help = "GIT FETCH\tFetch changes from remote" },
+    { .name = "RESET", .run = cmd_git_reset,
+      .help = "GIT RESET <file>\tUnstage file\nGIT RESET --hard\tReset to last commit" },
+    { .name = "RM", .run = cmd_git_rm, .help = "GIT RM <file>\tRemove file from Git" },
+    { .name = "CLEAN", .run = cmd_git_clean, .help = "GIT CLEAN -fd\tRemove untracked files and folders" },
+    { .name = "STASH", .run = cmd_git_stash,
+      .help = "GIT STASH\tStash current changes\nGIT STASH POP\tApply stashed changes" },
+    { .name = "TAG", .run = cmd_git_tag, .help = "GIT TAG <name>\tCreate a tag\nGIT TAG -l\tList tags" },
+    { .name = "CONFIG", .run = cmd_git_config,
+      .help = "GIT CONFIG --global user.name <name>\tSet global username\n"
+              "GIT CONFIG --global user.email <email>\tSet global email\n"
+              "GIT CONFIG --list\tList Git configuration" },
+    { .name = "HELP", .run = cmd_git_help, .help = "GIT HELP <command>\tShow help for Git command" },
+    { .name = "VERSION", .plain = cmd_git_version, .help = "GIT VERSION\tShow Git version" },
+    { .name = "TEST", .plain = cmd_git_test, .help = "GIT TEST\tTest Git installation" },
+    { .name = "PWD", .plain = cmd_git_pwd, .help = "GIT PWD\tShow where Git operations happen" }
+};
+static CommandTable g_gitCommands = COMMAND_TABLE(g_gitRows);
+
+static const Command g_npmRows[] = {
+    { .name = "INSTALL", .run = cmd_npm_install, .help = "NPM INSTALL\tInstall all dependencies" },
+    { .name = "ADD", .run = cmd_npm_add, .help = "NPM ADD <package>\tInstall a package" },
+    { .name = "REMOVE", .run = cmd_npm_remove, .help = "NPM REMOVE <package>\tUninstall a package" },
+    { .name = "UPDATE", .run = cmd_npm_update, .help = "NPM UPDATE\tUpdate all packages" },
+    { .name = "AUDIT", .run = cmd_npm_audit, .help = "NPM AUDIT\tCheck for vulnerabilities" },
+    { .name = "OUTDATED", .plain = cmd_npm_outdated, .help = "NPM OUTDATED\tShow outdated packages" },
+    { .name = "RUN", .run = cmd_npm_run, .complete = complete_npm_script,
+      .help = "NPM RUN [script]\tRun a package script; alone, list them" },
+    { .name = "START", .plain = cmd_npm_start, .help = "NPM START\tRun start script" },
+    { .name = "BUILD", .plain = cmd_npm_build, .help = "NPM BUILD\tRun build script" },
+    { .name = "TEST", .plain = cmd_npm_test, .help = "NPM TEST\tRun test script" },
+    { .name = "DEV", .plain = cmd_npm_dev, .help = "NPM DEV\tRun dev script" },
+    { .name = "INIT", .run = cmd_npm_init, .help = "NPM INIT\tInitialize package.json" },
+    { .name = "PUBLISH", .run = cmd_npm_publish, .help = "NPM PUBLISH\tPublish the package" },
+    { .name = "LINK", .run = cmd_npm_link, .help = "NPM LINK\tLink the package globally" },
+    { .name = "LIST", .plain = cmd_npm_list, .help = "NPM LIST\tList installed packages" },
+    { .name = "HELP", .plain = cmd_npm_help, .help = "NPM HELP\tShow npm help" }
+};
+static CommandTable g_npmCommands = COMMAND_TABLE(g_npmRows);
+
+static const Command g_reactRows[] = {
+    { .name = "CREATE", .run = cmd_react_create, .help = "REACT CREATE <name>\tCreate new React app" },
+    { .name = "COMPONENT", .run = cmd_react_component, .help = "REACT COMPONENT <name>\tCreate React component" },
+    { .name = "START", .plain = cmd_react_start, .help = "REACT START\tStart React dev server" },
+    { .name = "BUILD", .plain = cmd_react_build, .help = "REACT BUILD\tBuild React app" },
+    { .name = "TEST", .plain = cmd_react_test, .help = "REACT TEST\tRun React tests" },
+    { .name = "EJECT", .plain = cmd_react_eject, .help = "REACT EJECT\tEject from Create React App" },
+    { .name = "LINT", .plain = cmd_react_lint, .help = "REACT LINT\tRun ESLint" },
+    { .name = "HELP", .plain = cmd_react_help, .help = "REACT HELP\tList React commands" }
+};
+static CommandTable g_reactCommands = COMMAND_TABLE(g_reactRows);
+
+static const Command g_systemRows[] = {
+    { .name = "LS", .run = cmd_system_ls, .help = "SYSTEM_LS <path>\tList directory contents" },
+    { .name = "CD", .run = cmd_system_cd, .help = "SYSTEM_CD <path>\tChange working directory" },
+    { .name = "CAT", .run = cmd_system_cat, .help = "SYSTEM_CAT <path>\tDisplay file contents" },
+    { .name = "COPY", .run = cmd_system_copy, .help = "SYSTEM_COPY <src> <dest>\tCopy files between systems" },
+    { .name = "EXIT", .plain = cmd_system_exit, .help = "SYSTEM_EXIT\tExit maintenance mode" },
+    { .name = "LOG", .plain = cmd_system_log, .help = "SYSTEM_LOG\tView maintenance activity log" }
+};
+static CommandTable g_systemCommands = COMMAND_TABLE(g_systemRows);
+
+static const Command g_ideRows[] = {
+    { .name = "LIST", .plain = cmd_ide_list, .help = "IDE LIST\tList available editors" },
+    { .name = "HELP", .plain = cmd_ide_help, .help = "IDE HELP\tShow IDE command help" }
+};
+static CommandTable g_ideCommands = COMMAND_TABLE(g_ideRows);
+
+static const Command g_syncRows[] = {
+    { .name = "STATUS", .plain = cmd_sync_status, .help = "SYNC STATUS\tList pending changes and conflicts" },
+    { .name = "RESOLVE", .run = cmd_sync_resolve, .help = "SYNC RESOLVE <path> VFS|DISK|MERGE\tSettle a conflict" }
+};
+static CommandTable g_syncCommands = COMMAND_TABLE(g_syncRows);
+
+static const Command g_cacheRows[] = {
+    { .name = "STATS", .plain = cmd_cache_stats, .help = "CACHE STATS\tCompile cache size, hit rate and time saved" },
+    { .name = "CLEAR", .plain = cmd_cache_clear, .help = "CACHE CLEAR\tDelete the cached programs and reset the counts" }
+};
+static CommandTable g_cacheCommands = COMMAND_TABLE(g_cacheRows);
+
+static const Command g_commandRows[] = {
+    { .help = "Commands:" },
+    { .name = "DIR", .aliases = { "LS" }, .plain = cmd_dir, .help = "DIR, LS\tList directory contents" },
+    { .name = "CD", .run = cmd_cd, .help = "CD <dir>|..|~\tChange directory" },
+    { .name = "MKDIR", .aliases = { "MD" }, .run = cmd_mkdir, .help = "MKDIR <name>\tCreate directory" },
+    { .name = "RMDIR", .aliases = { "RD" }, .run = cmd_rmdir, .help = "RMDIR <name>\tRemove empty directory" },
+    { .name = "TOUCH", .run = cmd_touch, .help = "TOUCH <name>\tCreate empty file" },
+    { .name = "DEL", .aliases = { "DELETE" }, .run = cmd_del, .help = "DEL <name>\tDelete file (permanent)" },
+    { .name = "SOFTDEL", .run = cmd_softdel,
+      .help = "SOFTDEL <name>\tSoft delete (terminal only)\n"
+              "SOFTDEL /F <name>\tForce delete (both terminal and File Explorer)" },
+    { .name = "RESTORE", .run = cmd_restore, .help = "RESTORE <name>\tRestore from trash" },
+    { .name = "TRASH", .plain = cmd_trash, .help = "TRASH\tShow trash contents" },
+    { .name = "EMPTYTRASH", .plain = cmd_emptytrash, .help = "EMPTYTRASH\tPermanently delete trash" },
+    { .name = "TYPE", .aliases = { "CAT" }, .run = cmd_type, .help = "TYPE <file>\tShow file contents" },
+    { .name = "WRITE", .run = cmd_write, .flags = COMMAND_RAW, .help = "WRITE <file> <text>\tReplace file content with text" },
+    { .name = "WRITELN", .run = cmd_writeln, .flags = COMMAND_RAW, .help = "WRITELN <file> <text>\tWrite text with line breaks (use \\n)" },
+    { .name = "WRITECODE", .run = cmd_writecode, .flags = COMMAND_RAW, .help = "WRITECODE <file> <code>\tWrite code with formatting (use \\n, \\t)" },
+    { .name = "EDITCODE", .run = cmd_editcode, .help = "EDITCODE <file>\tInteractive code editor (Ctrl+S to save, Ctrl+C to cancel)" },
+    { .name = "APPEND", .run = cmd_append, .flags = COMMAND_RAW, .help = "APPEND <file> <text>\tAppend text to file" },
+    { .name = "ECHO", .run = cmd_echo, .help = "ECHO <text>\tPrint text" },
+    { .name = "FIND", .run = cmd_find,
+      .help = "FIND <glob> [path] [-type f|d]\tList the files and folders whose names match glob\n"
+              "<cmd> | FIND [/I] [/V] [/C] <text>\tKeep the lines of piped output that contain text" },
+    { .name = "GREP", .run = cmd_grep,
+      .help = "GREP [-r] [-i] [-n] <pattern> [path]\tShow the lines of files that match a regular expression\n"
+              "<cmd> | GREP [-i] [-n] <pattern>\tKeep the lines of piped output that match\n"
+              "GREP --bench <pattern> [path]\tTime the search against a strstr loop" },
+    { .name = "SEARCH", .run = cmd_search,
+      .help = "SEARCH [-i] <text>\tFind text in the files below this folder through the content index\n"
+              "SEARCH --stats\tShow the index's size and how long it took to build\n"
+              "SEARCH --bench <text>\tTime a query through the index against a full scan" },
+    { .name = "PWD", .plain = cmd_pwd, .help = "PWD\tPrint working directory" },
+    { .name = "SAVEFS", .run = cmd_savefs, .help = "SAVEFS <path>\tSave entire filesystem to disk" },
+    { .name = "ADDUSER", .run = cmd_adduser, .help = "ADDUSER <name>\tCreate new user" },
+    { .name = "RENAMEUSER", .run = cmd_renameuser, .help = "RENAMEUSER <old> <new>\tRename a user account" },
+    { .name = "TEXTCOLOR", .run = cmd_textcolor, .help = "TEXTCOLOR <color>\tChange text color" },
+    { .name = "CURSORCOLOR", .run = cmd_cursorcolor, .help = "CURSORCOLOR <color>\tChange cursor color" },
+    { .name = "WHOAMI", .plain = cmd_whoami, .help = "WHOAMI\tShow current user" },
+    { .name = "USERS", .plain = cmd_users, .help = "USERS\tList all users" },
+    { .name = "FILEVIEW", .run = cmd_fileview,
+      .help = "FILEVIEW\tShow files in filesystem tree structure\n"
+              "FILEVIEW BENCH [nodes]\tMeasure output speed on a generated tree (10000 nodes)" },
+    { .name = "SYNC", .run = cmd_sync_command, .sub = &g_syncCommands,
+      .help = "SYNC\tTwo-way sync of this folder with the real filesystem" },
+    { .name = "IGNORE", .run = cmd_ignore,
+      .help = "IGNORE [LIST]\tShow ignore rules (.gitignore syntax)\n"
+              "IGNORE ADD <pattern>\tAdd a rule to your Settings\\ignore.dat\n"
+              "IGNORE CHECK <path>\tExplain whether a path is ignored" },
+    { .name = "HASH", .run = cmd_hash,
+      .help = "HASH <file|dir>\tContent hash (tree hash for folders)\n"
+              "HASH BENCH [MB]\tMeasure hashing speed per instruction set" },
+    { .name = "SAVE", .plain = fs_save_to_disk, .help = "SAVE\tSave filesystem to disk" },
+    { .name = "SOURCE", .aliases = { "RUN-SCRIPT" }, .run = cmd_source,
+      .help = "SOURCE <file>\tRun the commands in a file, one per line\n"
+              "SOURCE --time <file>\tAlso show how long each command took\n"
+              "SOURCE --keep-going <file>\tList errors at the end instead of stopping" },
+    { .name = "JOBS", .plain = cmd_jobs, .help = "JOBS\tList background jobs (end a command line with & to start one)" },
+    { .name = "FG", .run = cmd_fg, .help = "FG [id]\tWait for a background job; Ctrl+C stops it" },
+    { .name = "KILL", .run = cmd_kill, .help = "KILL <id>\tStop a background job" },
+    { .name = "HELP", .plain = cmd_help, .help = "HELP\tShow this list" },
+    { .name = "TEST", .plain = cmd_test },
+
+    { .help = "=== AUTHENTICATION ===" },
+    { .name = "LOGIN", .run = cmd_login, .help = "LOGIN <user> <pass>\tLogin to user account (required for Admin)" },
+    { .name = "USER", .run = cmd_user, .help = "USER <username>\tSwitch to user (Admin requires login first)" },
+    { .name = "LOGOUT", .plain = cmd_logout, .help = "LOGOUT\tLogout from current session" },
+    { .name = "CHPASSWD", .run = cmd_chpasswd, .help = "CHPASSWD <old> <new>\tChange password" },
+    { .name = "SETUP_AUTH", .run = cmd_setup_auth, .help = "SETUP_AUTH <user> <pass>\tSetup authentication for user" },
+    { .name = "SESSIONS", .plain = cmd_sessions, .privilege = 1, .help = "SESSIONS\tList active sessions (Admin)" },
+
+    { .help = "=== CUSTOMIZATION ===" },
+    { .name = "THEME", .run = cmd_theme,
+      .help = "THEME <name>\tSwitch theme (classic, white, dark)\nTHEME LIST\tList available themes" },
+    { .name = "SETTINGS", .run = cmd_settings, .help = "SETTINGS\tShow current settings" },
+    { .name = "SET", .run = cmd_set, .help = "SET <setting> <value>\tSet configuration value" },
+    { .name = "GET", .run = cmd_get, .help = "GET <setting>\tGet configuration value" },
+    { .name = "CLS", .aliases = { "CLEAR" }, .plain = gui_clear, .help = "CLS, CLEAR\tClear screen" },
+    { .name = "EXIT", .aliases = { "QUIT" }, .flags = COMMAND_QUIT, .help = "EXIT\tQuit" },
+
+    { .help = "Git Commands (working with system Git):" },
+    { .name = "GIT", .run = cmd_git_usage, .sub = &g_gitCommands },
+
+    { .help = "=== PROJECT DETECTION ===" },
+    { .name = "PROJECT_TYPE", .plain = cmd_project_type, .help = "PROJECT_TYPE\tShow current project type" },
+    { .name = "PROJECT_INFO", .plain = cmd_project_info, .help = "PROJECT_INFO\tShow detailed project information" },
+
+    { .help = "=== C++ & PYTHON EXECUTION ===" },
+    { .name = "RUN", .run = cmd_run, .help = "RUN <file>\tRun C++ or Python file" },
+    { .name = "COMPILE", .run = cmd_compile, .help = "COMPILE <file>\tCompile C++ file" },
+    { .name = "BUILD", .run = cmd_build,
+      .help = "BUILD [-j N] [-o name]\tCompile the changed .c/.cpp files here in parallel and link build\\<name>.exe" },
+    { .name = "WATCH", .run = cmd_watch, .flags = COMMAND_RAW,
+      .help = "WATCH <pattern> -- <command>\tRun a command again whenever matching files here change" },
+    { .name = "CACHE", .run = cmd_cache_usage, .sub = &g_cacheCommands },
+
+    { .help = "=== SYSTEM MAINTENANCE (Admin Only) ===" },
+    { .name = "SYSTEM", .run = cmd_system_usage, .sub = &g_systemCommands, .privilege = 1,
+      .help = "CD .system_maintenance\tAccess system maintenance tools" },
+
+    { .help = "=== NPM/NODE.JS COMMANDS ===" },
+    { .name = "NPM", .plain = cmd_npm_help, .sub = &g_npmCommands },
+
+    { .help = "=== REACT DEVELOPMENT ===" },
+    { .name = "REACT", .run = cmd_react_usage, .sub = &g_reactCommands },
+
+    { .help = "IDE Commands (open external editors):" },
+    { .name = "IDE", .run = cmd_ide, .sub = &g_ideCommands,
+      .help = "IDE vscode\tOpen VS Code in current directory\n"
+              "IDE code\tAlternative VS Code command\n"
+              "IDE cursor\tOpen Cursor in current directory\n"
+              "IDE notepad\tOpen Notepad\n"
+              "IDE notepad++\tOpen Notepad++\n"
+              "IDE sublime\tOpen Sublime Text\n"
+              "IDE atom\tOpen Atom\n"
+              "IDE vim\tOpen Vim" }
+};
+static CommandTable g_commands = COMMAND_TABLE(g_commandRows);
+
+// ---- Help ----
+static void print_help_lines(const char* help) {
+    while (help && *help) {
+        const char* end = strchr(help, '\n');
+        size_t len = end ? (size_t)(end - help) : strlen(help);
+        char line[256];
+        if (len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, help, len);
+        line[len] = '\0';
+
+        char* tab = strchr(line, '\t');
+        if (tab) {
+            *tab = '\0';
+            gui_printf("  %-21s %s", line, tab + 1);
         } else {
-            // Fallback to current user's directory
-            snprintf(storage_path, sizeof(storage_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+            gui_printf("  %s", line);
         }
+        help = end ? end + 1 : NULL;
     }
-    
-    // Create the directories if they don't exist (hidden) - use absolute paths
-    char data_dir[1024];
-    snprintf(data_dir, sizeof(data_dir), "%s\\data", program_dir);
-    CreateDirectoryA(data_dir, NULL);
-    
-    char users_dir[1024];
-    snprintf(users_dir, sizeof(users_dir), "%s\\data\\USERS", program_dir);
-    CreateDirectoryA(users_dir, NULL);
-    
-    char public_dir[1024];
-    snprintf(public_dir, sizeof(public_dir), "%s\\data\\USERS\\Public", program_dir);
-    CreateDirectoryA(public_dir, NULL);
-    
-    char admin_dir[1024];
-    snprintf(admin_dir, sizeof(admin_dir), "%s\\data\\USERS\\Admin", program_dir);
-    CreateDirectoryA(admin_dir, NULL);
-    
-    // Create Admin's System folder in real filesystem
-    char admin_system_dir[1024];
-    snprintf(admin_system_dir, sizeof(admin_system_dir), "%s\\data\\USERS\\Admin\\System", program_dir);
-    CreateDirectoryA(admin_system_dir, NULL);
-    
-    
-    
-    // Create a temporary batch file to capture output (in temp directory)
-    char temp_bat[1024];
-    snprintf(temp_bat, sizeof(temp_bat), "%s\\data\\temp_git_output.bat", program_dir);
-    
-    // Create the batch file content with Git isolation using --git-dir and --work-tree
-    char batch_content[4096];
-    snprintf(batch_content, sizeof(batch_content), 
-        "@echo off\n"
-        "cd /d \"%s\"\n"
-        "if exist .git (\n"
-        "    set GIT_PAGER=cat\n"
-        "    set GIT_CONFIG_NOSYSTEM=1\n"
-        "    git --git-dir=\"%%CD%%\\.git\" --work-tree=\"%%CD%%\" %s\n"
-        ") else (\n"
-        "    echo No .git folder found. Use 'GIT INIT' to create a repository.\n"
-        ")\n"
-        "echo.\n"
-        "echo [GIT_EXIT_CODE] %%ERRORLEVEL%%\n", 
-        storage_path, git_args);
-    
-    // Write the batch file
-    HANDLE hFile = CreateFileA(temp_bat, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        DWORD bytesWritten;
-        WriteFile(hFile, batch_content, strlen(batch_content), &bytesWritten, NULL);
-        CloseHandle(hFile);
-        
-        // Execute the batch file and capture output using CreateProcess (hidden)
-        STARTUPINFOA si;
-        PROCESS_INFORMATION pi;
-        SECURITY_ATTRIBUTES sa;
-        HANDLE hReadPipe, hWritePipe;
-        
-        ZeroMemory(&si, sizeof(si));
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-        si.wShowWindow = SW_HIDE; // Hide the window
-        
-        ZeroMemory(&pi, sizeof(pi));
-        
-        // Create pipes for input/output
-        sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-        sa.bInheritHandle = TRUE;
-        sa.lpSecurityDescriptor = NULL;
-        
-        if (CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
-            si.hStdOutput = hWritePipe;
-            si.hStdError = hWritePipe;
-            si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
-            
-            // Create the process
-            if (CreateProcessA(NULL, temp_bat, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
-                CloseHandle(hWritePipe);
-                
-                // Read output
-                char buffer[1024];
-                DWORD bytesRead;
-                int exit_code = 0;
-                
-                while (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
-                    buffer[bytesRead] = '\0';
-                    
-                    // Process each line
-                    char* line = buffer;
-                    char* next_line;
-                    while ((next_line = strchr(line, '\n')) != NULL) {
-                        *next_line = '\0';
-                        
-                        // Remove carriage return if present
-                        char* cr = strchr(line, '\r');
-                        if (cr) *cr = '\0';
-                        
-                        // Check for exit code marker
-                        if (strstr(line, "[GIT_EXIT_CODE]") != NULL) {
-                            sscanf(line, "[GIT_EXIT_CODE] %d", &exit_code);
-                        } else if (strlen(line) > 0) {
-                            // Display the output line
-                            gui_println(line);
-                        }
-                        
-                        line = next_line + 1;
-                    }
-                }
-                
-                // Wait for process to complete
-                WaitForSingleObject(pi.hProcess, INFINITE);
-                GetExitCodeProcess(pi.hProcess, (DWORD*)&exit_code);
-                
-                CloseHandle(pi.hProcess);
-                CloseHandle(pi.hThread);
-                CloseHandle(hReadPipe);
-                
-                if (exit_code == 0) {
-                    gui_println("Git command completed successfully.");
-                } else {
-                    gui_println("Git command failed. Check your Git installation and try again.");
-                    char error_msg[256];
-                    snprintf(error_msg, sizeof(error_msg), "Exit code: %d", exit_code);
-                    gui_println(error_msg);
-                }
-            } else {
-                CloseHandle(hReadPipe);
-                CloseHandle(hWritePipe);
-                gui_println("Failed to execute Git command.");
-            }
-        } else {
-            gui_println("Failed to create pipes for Git command.");
-        }
-        
-        // Clean up the temporary batch file
-        DeleteFileA(temp_bat);
-        
-        // Create .gitignore to ignore temp files if it doesn't exist
-        char gitignore_path[1024];
-        snprintf(gitignore_path, sizeof(gitignore_path), "%s\\.gitignore", storage_path);
-        
-        // Check if .gitignore exists
-        HANDLE hGitignore = CreateFileA(gitignore_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hGitignore == INVALID_HANDLE_VALUE) {
-            // .gitignore doesn't exist, create it
-            hGitignore = CreateFileA(gitignore_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-            if (hGitignore != INVALID_HANDLE_VALUE) {
-                const char* gitignore_content = "temp_git_output.bat\n*.tmp\n";
-                DWORD bytesWritten;
-                WriteFile(hGitignore, gitignore_content, strlen(gitignore_content), &bytesWritten, NULL);
-                CloseHandle(hGitignore);
-            }
-        } else {
-            CloseHandle(hGitignore);
+}
+
+static void print_command_help(const CommandTable* table) {
+    for (int i = 0; i < table->count; i++) {
+        const Command* cmd = &table->commands[i];
+        if (!cmd->name) {
+            if (i > 0) gui_println("");
+            gui_println(cmd->help);
+            continue;
         }
-    } else {
-        gui_println("Failed to create temporary file for Git command.");
+        print_help_lines(cmd->help);
+        if (cmd->sub) print_command_help(cmd->sub);
     }
 }
 
-static void cmd_git_init(void) {
-    gui_println("Initializing Git repository...");
-    execute_git_command("init");
+static void cmd_help(void) {
+    print_command_help(&g_commands);
 }
 
-static void cmd_git_clone(const char* url) {
-    if (!url || !*url) {
-        gui_println("Usage: GIT CLONE <url>");
-        gui_println("Example: GIT CLONE https://github.com/user/repo.git");
-        return;
+static void cmd_react_help(void) {
+    print_command_help(&g_reactCommands);
+}
+
+// ---- Dispatch ----
+// FALSE when the terminal should close
+static BOOL command_run(const Command* cmd, const char* args) {
+    if (cmd->privilege > 0 && !has_privilege(cmd->privilege)) {
+        gui_error("Insufficient privileges. Admin access required.");
+        return TRUE;
     }
-    
-    gui_println("Cloning repository...");
-    gui_println("Note: This will clone to your actual file system.");
-    
-    // Get the main project directory
-    char program_dir[1024];
-    get_main_project_dir(program_dir, sizeof(program_dir));
-    
-    // Get the current working directory path in the real file system
-    char storage_path[2048];
-    char current_path[2048];
-    
-    // Build the real path based on current virtual directory
-    if (g_cwd == g_home) {
-        // We're in the user's home directory
-        snprintf(storage_path, sizeof(storage_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-    } else {
-        // We're in a subdirectory, build the full path
-        fs_print_path(g_cwd, current_path, sizeof(current_path));
-        
-        // Find the position after "C:\\USERS\\"
-        char* profiles_pos = strstr(current_path, "\\USERS\\");
-        if (profiles_pos) {
-            // Skip "C:\USERS\" and add the rest to the base path
-            char* relative_path = profiles_pos + 7; // Skip "\USERS\"
-            snprintf(storage_path, sizeof(storage_path), "%s\\data\\USERS\\%s", program_dir, relative_path);
+    if (cmd->flags & COMMAND_QUIT) return FALSE;
+
+    if (cmd->sub && *args) {
+        char buf[1024];
+        snprintf(buf, sizeof(buf), "%s", args);
+        char* rest = NULL;
+        parse_first_token(buf, &rest);
+        const Command* sub = command_lookup(cmd->sub, buf);
+        if (sub) return command_run(sub, rest);
+    }
+
+    if (cmd->run) {
+        cmd->run(args);
+    } else if (cmd->plain) {
+        cmd->plain();
+    }
+    return TRUE;
+}
+
+// One command, no pipes or redirection
+static BOOL command_exec(char* input) {
+    char* arg = NULL;
+    if (!parse_first_token(input, &arg)) return TRUE;
+
+    const Command* cmd = command_lookup(&g_commands, input);
+    char joined[1024];
+    char* underscore = strchr(input, '_');
+    if (!cmd && underscore) {
+        // SYSTEM_LS is the SYSTEM family's LS
+        *underscore = '\0';
+        cmd = command_lookup(&g_commands, input);
+        if (cmd && cmd->sub) {
+            snprintf(joined, sizeof(joined), "%s %s", underscore + 1, arg);
+            arg = joined;
         } else {
-            // Fallback to current user's directory
-            snprintf(storage_path, sizeof(storage_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
+            cmd = NULL;
         }
     }
-    
-    // Create a temporary batch file for git clone (no .git folder needed)
-    char temp_bat[1024];
-    snprintf(temp_bat, sizeof(temp_bat), "%s\\data\\temp_git_clone.bat", program_dir);
-    
-    // Create the batch file content for git clone
-    char batch_content[4096];
-    snprintf(batch_content, sizeof(batch_content), 
-        "@echo off\n"
-        "cd /d \"%s\"\n"
-        "git clone \"%s\"\n"
-        "echo.\n"
-        "echo [GIT_EXIT_CODE] %%ERRORLEVEL%%\n", 
-        storage_path, url);
-    
-    
-    // Write the batch file
-    HANDLE hFile = CreateFileA(temp_bat, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-        DWORD bytesWritten;
-        WriteFile(hFile, batch_content, (DWORD)strlen(batch_content), &bytesWritten, NULL);
-        CloseHandle(hFile);
-        
-        // Execute the batch file
-        STARTUPINFOA si = {0};
-        PROCESS_INFORMATION pi = {0};
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESHOWWINDOW;
-        si.wShowWindow = SW_HIDE;
-        
-        if (CreateProcessA(temp_bat, NULL, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
-            WaitForSingleObject(pi.hProcess, INFINITE);
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
+
+    if (!cmd) {
+        gui_error("'COMMAND' is not recognized.");
+        return TRUE;
+    }
+    return command_run(cmd, arg);
+}
+
+// ---- Tab completion ----
+// The words before the one being typed are walked through the same tables
+// dispatch uses. A table offers its visible command names; past that, the
+// command's complete hook offers names for its first argument.
+struct Completion {
+    const char* word;                     // what has been typed of it
+    size_t word_len;
+    int count;
+    char first[256];                      // the first name offered...
+    size_t common;                        // ...and how much of it all of them share
+    BOOL any_case;                        // command names: typed in lower case, finished in it
+    char* choices;                        // every name, two spaces apart
+    size_t choices_size;
+    size_t choices_len;
+};
+
+static void completion_offer(Completion* c, const char* name) {
+    for (size_t i = 0; i < c->word_len; i++) {
+        if (tolower((unsigned char)name[i]) != tolower((unsigned char)c->word[i])) return;
+    }
+    if (c->count++ == 0) {
+        snprintf(c->first, sizeof(c->first), "%s", name);
+        c->common = strlen(c->first);
+    } else {
+        size_t i = 0;
+        while (i < c->common && tolower((unsigned char)c->first[i]) == tolower((unsigned char)name[i])) i++;
+        c->common = i;
+    }
+    if (c->choices && c->choices_len < c->choices_size) {
+        c->choices_len += (size_t)snprintf(c->choices + c->choices_len, c->choices_size - c->choices_len,
+                                           "%s%s", c->choices_len ? "  " : "", name);
+    }
+}
+
+static void completion_offer_table(Completion* c, const CommandTable* table) {
+    c->any_case = TRUE;
+    for (int i = 0; i < table->count; i++) {
+        const Command* cmd = &table->commands[i];
+        if (!cmd->name || (!cmd->help && !cmd->sub)) continue;
+        if (cmd->privilege > 0 && !has_privilege(cmd->privilege)) continue;
+        completion_offer(c, cmd->name);
+    }
+}
+
+int engine_complete(char* line, size_t size, char* choices, size_t choices_size) {
+    if (choices && choices_size) choices[0] = '\0';
+    // Only the last command of a pipeline
+    char* segment = strrchr(line, '|');
+    segment = segment ? segment + 1 : line;
+    char* word = segment + strlen(segment);
+    while (word > segment && word[-1] != ' ' && word[-1] != '\t') word--;
+
+    Completion c;
+    memset(&c, 0, sizeof(c));
+    c.word = word;
+    c.word_len = strlen(word);
+    c.choices = choices;
+    c.choices_size = choices_size;
+
+    char before[1024];
+    snprintf(before, sizeof(before), "%.*s", (int)(word - segment), segment);
+    CommandTable* table = &g_commands;
+    const Command* cmd = NULL;
+    int args = 0;
+    for (char* token = strtok(before, " \t"); token; token = strtok(NULL, " \t")) {
+        const Command* found = table ? command_lookup(table, token) : NULL;
+        if (found) {
+            cmd = found;
+            table = found->sub;
+        } else if (cmd) {
+            table = NULL;
+            args++;
+        } else {
+            return 0;
         }
-        
-        // Clean up the batch file
-        DeleteFileA(temp_bat);
     }
-    
-    // Extract repository name from URL for virtual filesystem
-    char repo_name[256] = {0};
-    const char* last_slash = strrchr(url, '/');
-    if (last_slash) {
-        strcpy(repo_name, last_slash + 1);
-        // Remove .git extension if present
-        char* dot_git = strstr(repo_name, ".git");
-        if (dot_git) {
-            *dot_git = '\0';
+    if (table) {
+        completion_offer_table(&c, table);
+    } else if (cmd->complete && args == 0) {
+        cmd->complete(&c);
+    }
+    if (c.count == 0) return 0;
+
+    BOOL lower = FALSE;
+    for (size_t i = 0; i < c.word_len; i++) {
+        if (islower((unsigned char)word[i])) lower = TRUE;
+    }
+
+    // A single name replaces the word; several extend it by what they share
+    size_t at = (size_t)(word - line);
+    size_t from = (c.count == 1) ? 0 : c.word_len;
+    size_t keep = (c.count == 1) ? strlen(c.first) : c.common;
+    if (at + keep + 2 > size) return c.count;
+    memcpy(line + at + from, c.first + from, keep - from);
+    line[at + keep] = '\0';
+    if (c.any_case && lower) {
+        for (char* p = line + at; *p; p++) *p = (char)tolower((unsigned char)*p);
+    }
+    if (c.count == 1) strcat(line, " ");
+    return c.count;
+}
+
+// ---------------- Scripts ----------------
+// SOURCE (RUN-SCRIPT) and the --script start-up flag run a file of commands,
+// one per line, as if they were typed. Blank lines and lines starting with
+// '#' are skipped. Saves wait until the outermost script ends, and syncs run
+// inline so every line sees the previous one finished.
+#define SCRIPT_MAX_DEPTH 8
+#define SCRIPT_MAX_ERRORS 32
+
+static int g_scriptDepth = 0;
+static int g_scriptPendingSaves = 0;
+static BOOL g_scriptFailed = FALSE;       // the running line reported an error (gui_error)
+static char g_scriptError[256];           // its first error line
+
+static BOOL script_running(void) {
+    return g_scriptDepth > 0;
+}
+
+static BOOL script_defer_save(int what) {
+    if (g_scriptDepth == 0) return FALSE;
+    g_scriptPendingSaves |= what;
+    return TRUE;
+}
+
+static void script_flush_saves(void) {
+    int pending = g_scriptPendingSaves;
+    g_scriptPendingSaves = 0;
+    if (pending & SAVE_FS) fs_save_to_disk();
+    if (pending & SAVE_SYNC) sync_base_save();
+    if (pending & SAVE_AUTH) save_auth_data();
+    if (pending & SAVE_SETTINGS) save_settings();
+}
+
+// The line the script is running failed; the first error is the one kept
+static void script_note_error(const char* text) {
+    if (!script_running() || g_scriptFailed) return;
+    g_scriptFailed = TRUE;
+    snprintf(g_scriptError, sizeof(g_scriptError), "%s", text);
+}
+
+// The script's text: a VFS file relative to the working directory, else a
+// real file. Caller frees.
+static char* script_load(const char* path) {
+    Directory* dir = NULL;
+    File* file = NULL;
+    if (vfs_resolve_path(path, &dir, &file) && file) return _strdup(file->content);
+
+    FILE* f = pf_fopen(path, "rb");
+    if (!f) return NULL;
+    size_t cap = 4096, len = 0;
+    char* text = (char*)malloc(cap);
+    size_t n;
+    while (text && (n = fread(text + len, 1, cap - len - 1, f)) > 0) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            char* bigger = (char*)realloc(text, cap * 2);
+            if (!bigger) { free(text); text = NULL; break; }
+            text = bigger;
+            cap *= 2;
         }
     }
-    
-    // Create the repository folder in virtual filesystem
-    if (strlen(repo_name) > 0) {
-        Directory* repo_dir = fs_create_dir(repo_name);
-        if (repo_dir) {
-            fs_add_child(g_cwd, repo_dir);
-            char msg[256];
-            snprintf(msg, sizeof(msg), "Repository '%s' added to virtual filesystem.", repo_name);
-            gui_println(msg);
-            
-            // Auto-save filesystem
-            fs_save_to_disk();
+    fclose(f);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+int script_run(const char* path, int flags, BOOL* quit) {
+    if (quit) *quit = FALSE;
+    if (g_scriptDepth >= SCRIPT_MAX_DEPTH) {
+        gui_error("Error: scripts are nested too deeply.");
+        return -1;
+    }
+    char* text = script_load(path);
+    if (!text) {
+        gui_errorf("Script not found: %s", path);
+        return -1;
+    }
+
+    // A start-up sync still scanning would apply its results under the script
+    if (sync_job_active()) sync_job_finish();
+
+    g_scriptDepth++;
+    char errors[SCRIPT_MAX_ERRORS][300];
+    int error_count = 0, commands = 0, line_no = 0;
+    double total_start = pf_seconds();
+
+    char* next = text;
+    while (next && *next) {
+        char* line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        line_no++;
+
+        line[strcspn(line, "\r")] = '\0';
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '\0' || *line == '#') continue;
+
+        char input[1024];
+        snprintf(input, sizeof(input), "%s", line);
+        gui_print_prompt();
+        gui_println(line);
+
+        g_scriptFailed = FALSE;
+        g_scriptError[0] = '\0';
+        double start = pf_seconds();
+        BOOL keep_running = process_command(input);
+        double ms = (pf_seconds() - start) * 1000.0;
+        commands++;
+
+        // EDITCODE waits for keys a script never sends
+        if (editor_active()) {
+            g_editMode = 0;
+            g_editFile = NULL;
+            g_scriptFailed = TRUE;
+            snprintf(g_scriptError, sizeof(g_scriptError), "EDITCODE needs the terminal window; use WRITECODE.");
+        }
+        if (flags & SCRIPT_TIME) gui_printf("[%.3f ms]", ms);
+
+        if (g_scriptFailed) {
+            if (error_count < SCRIPT_MAX_ERRORS) {
+                snprintf(errors[error_count], sizeof(errors[0]), "line %d: %s -> %s", line_no, line, g_scriptError);
+            }
+            error_count++;
+            if (!(flags & SCRIPT_KEEP_GOING)) {
+                gui_printf("Script stopped at line %d: %s", line_no, line);
+                break;
+            }
+        }
+        if (!keep_running) {
+            if (quit) *quit = TRUE;
+            break;
         }
     }
-    
-    // Auto-sync to update virtual filesystem with cloned repository
-    cmd_sync();
+    free(text);
+
+    g_scriptDepth--;
+    if (g_scriptDepth == 0) script_flush_saves();
+
+    if ((flags & SCRIPT_KEEP_GOING) && error_count > 0) {
+        gui_printf("%d command(s) failed:", error_count);
+        for (int i = 0; i < error_count && i < SCRIPT_MAX_ERRORS; i++) gui_printf("  %s", errors[i]);
+    }
+    if (flags & SCRIPT_TIME) {
+        gui_printf("Script %s: %d command(s), %d error(s), %.3f ms total",
+                   path, commands, error_count, (pf_seconds() - total_start) * 1000.0);
+    }
+
+    // A nested script's failure is the failure of the SOURCE line that ran it
+    g_scriptFailed = error_count > 0;
+    if (g_scriptFailed) snprintf(g_scriptError, sizeof(g_scriptError), "%d error(s) in %s", error_count, path);
+    return error_count;
 }
 
-static void cmd_git_add(const char* file) {
-    if (!file || !*file) {
-        gui_println("Usage: GIT ADD <file> or GIT ADD .");
-        gui_println("Example: GIT ADD . (adds all files)");
+static void cmd_source(const char* args) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args ? args : "");
+    int flags = 0;
+    char* path = buf;
+    for (;;) {
+        char* rest = NULL;
+        char* word = path;
+        if (!parse_first_token(word, &rest)) { path = word; break; }
+        if (str_icmp(word, "--time") == 0) {
+            flags |= SCRIPT_TIME;
+        } else if (str_icmp(word, "--keep-going") == 0) {
+            flags |= SCRIPT_KEEP_GOING;
+        } else {
+            // Not a flag: the path is this word and everything after it
+            if (*rest) word[strlen(word)] = ' ';
+            path = word;
+            break;
+        }
+        path = rest;
+    }
+    if (!*path) {
+        gui_error("Usage: SOURCE [--time] [--keep-going] <file>");
+        gui_println("Runs the commands in a VFS or real file, one per line; # starts a comment.");
+        gui_println("Example: SOURCE setup.txt");
         return;
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "add %s", file);
-    execute_git_command(command);
+    size_t len = strlen(path);
+    if (len >= 2 && path[0] == '"' && path[len - 1] == '"') {
+        path[len - 1] = '\0';
+        path++;
+    }
+    // EXIT inside a script only ends the script
+    script_run(path, flags, NULL);
 }
 
-static void cmd_git_commit(const char* message) {
-    if (!message || !*message) {
-        gui_println("Usage: GIT COMMIT -m <message>");
-        gui_println("Example: GIT COMMIT -m \"Initial commit\"");
+// ---------------- Pipelines ----------------
+// "A | B | C > file": each stage's output is captured in a stream and handed
+// to the next stage by reference (g_inStream); the last one prints as usual,
+// or with > / >> fills a VFS file. '|' and '>' inside double quotes are text,
+// and commands flagged COMMAND_RAW (WRITE and friends) never see operators.
+#define PIPELINE_MAX_STAGES 8
+
+static void strip_quotes(char* text) {
+    size_t len = strlen(text);
+    if (len >= 2 && text[0] == '"' && text[len - 1] == '"') {
+        memmove(text, text + 1, len - 2);
+        text[len - 2] = '\0';
+    }
+}
+
+static char* trim_spaces(char* text) {
+    while (*text == ' ' || *text == '\t') text++;
+    size_t len = strlen(text);
+    while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\t')) text[--len] = '\0';
+    return text;
+}
+
+// Splits line in place; -1 when it is malformed
+static int pipeline_parse(char* line, char** stages, char** target, BOOL* append) {
+    int count = 0;
+    BOOL quoted = FALSE;
+    *target = NULL;
+    *append = FALSE;
+    stages[count++] = line;
+    for (char* p = line; *p; p++) {
+        if (*p == '"') {
+            quoted = !quoted;
+        } else if (quoted) {
+            // text
+        } else if (*p == '|') {
+            if (*target || count == PIPELINE_MAX_STAGES) return -1;
+            *p = '\0';
+            stages[count++] = p + 1;
+        } else if (*p == '>') {
+            if (*target) return -1;
+            *p = '\0';
+            if (p[1] == '>') {
+                *append = TRUE;
+                p++;
+            }
+            *target = p + 1;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        stages[i] = trim_spaces(stages[i]);
+        if (!*stages[i]) return -1;
+    }
+    if (*target) {
+        *target = trim_spaces(*target);
+        strip_quotes(*target);
+        if (!**target) return -1;
+    }
+    return count;
+}
+
+// > and >> write straight into the VFS file (created if missing) and mirror
+// it to disk like WRITE does
+static void pipeline_redirect(const Stream* s, const char* target, BOOL append) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s", target);
+    for (char* p = path; *p; p++) if (*p == '/') *p = '\\';
+
+    Directory* dir = g_cwd;
+    char* name = path;
+    char* slash = strrchr(path, '\\');
+    if (slash) {
+        *slash = '\0';
+        File* file = NULL;
+        if (!vfs_resolve_path(path, &dir, &file) || !dir) {
+            gui_error("The system cannot find the path specified.");
+            return;
+        }
+        name = slash + 1;
+    }
+    if (!*name || fs_find_child(dir, name)) {
+        gui_error("Access is denied.");
         return;
     }
-    
-    // Handle both "GIT COMMIT -m message" and "GIT COMMIT message" formats
-    char command[1024];
-    if (strncmp(message, "-m ", 3) == 0) {
-        // Already has -m flag
-        snprintf(command, sizeof(command), "commit %s", message);
-    } else {
-        // Add -m flag
-        snprintf(command, sizeof(command), "commit -m \"%s\"", message);
+
+    File* f = fs_find_file(dir, name);
+    if (!f) {
+        if (dir->file_count >= MAX_FILES) {
+            gui_errorf("Cannot create %s: the directory is full.", name);
+            return;
+        }
+        f = fs_create_file(name);
+        if (!f) { gui_error("Out of memory creating file."); return; }
+        fs_add_file(dir, f);
+    }
+
+    size_t len = append ? strlen(f->content) : 0;
+    size_t cap = sizeof(f->content) - 1;
+    size_t dropped = 0;
+    StreamReader r;
+    stream_reader_init(&r, s);
+    const char* line;
+    while ((line = stream_next_line(&r)) != NULL) {
+        size_t n = strlen(line);
+        if (dropped == 0 && len + n + 2 <= cap) {
+            memcpy(f->content + len, line, n);
+            memcpy(f->content + len + n, "\r\n", 2);
+            len += n + 2;
+        } else {
+            dropped += n + 2;
+        }
+    }
+    f->content[len] = '\0';
+    vfs_changed(VFS_FILE_WRITTEN, dir, f);
+    fs_write_real_file(dir, name, f->content, "wb");
+    if (dropped > 0) {
+        gui_printf("Output truncated: %s holds %d bytes, %lu more were dropped.",
+                   name, MAX_FILE_SIZE - 1, (unsigned long)dropped);
+    }
+}
+
+static BOOL pipeline_run(char** stages, int count, const char* target, BOOL append) {
+    // A pipeline inside a captured stage (a SOURCE line, say) reads and
+    // writes through the enclosing one
+    Stream* outer_in = g_inStream;
+    Stream* outer_out = g_outStream;
+    Stream buffers[2];
+    memset(buffers, 0, sizeof(buffers));
+
+    Stream* in = outer_in;
+    BOOL keep_running = TRUE;
+    int i = 0;
+    for (; i < count && keep_running; i++) {
+        BOOL last = (i == count - 1);
+        Stream* out = (last && !target) ? outer_out : &buffers[i % 2];
+        g_inStream = in;
+        g_outStream = out;
+        keep_running = command_exec(stages[i]);
+        if (out != outer_out) stream_finish(out);
+        if (in != outer_in) stream_free(in);
+        in = out;
+    }
+    g_inStream = outer_in;
+    g_outStream = outer_out;
+
+    if (target && i == count && keep_running) pipeline_redirect(in, target, append);
+    if (in != outer_out && in != outer_in) stream_free(in);
+    return keep_running;
+}
+
+static BOOL command_line_run(char* input) {
+    char* stages[PIPELINE_MAX_STAGES];
+    char* target = NULL;
+    BOOL append = FALSE;
+    snprintf(g_jobLabel, sizeof(g_jobLabel), "%s", input);
+    if (strcspn(input, "|>&") == strlen(input)) return command_exec(input);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s", input);
+    char* rest = NULL;
+    if (parse_first_token(name, &rest)) {
+        const Command* cmd = command_lookup(&g_commands, name);
+        if (cmd && (cmd->flags & COMMAND_RAW)) return command_exec(input);
+    }
+    if (job_strip_background(input)) {
+        g_jobBackground = TRUE;
+        snprintf(g_jobLabel, sizeof(g_jobLabel), "%s", input);
+    }
+    if (strcspn(input, "|>") == strlen(input)) return command_exec(input);
+
+    int count = pipeline_parse(input, stages, &target, &append);
+    if (count < 0) {
+        gui_error("The syntax of the command is incorrect.");
+        return TRUE;
     }
-    execute_git_command(command);
+    return pipeline_run(stages, count, target, append);
 }
 
-static void cmd_git_status(void) {
-    gui_println("Git Status:");
-    execute_git_command("status");
-}
+BOOL process_command(char* input) {
+    // A script line's '&' and label are its own, not the SOURCE line's
+    BOOL background = g_jobBackground;
+    char label[sizeof(g_jobLabel)];
+    memcpy(label, g_jobLabel, sizeof(label));
+    g_jobBackground = FALSE;
+    if (g_commandDepth++ == 0) g_promptArmed = FALSE;
 
-static void cmd_git_log(void) {
-    gui_println("Git Log:");
-    execute_git_command("log --oneline -10");
-    gui_println("Remote commits:");
-    execute_git_command("log --oneline origin/main -5");
-}
+    BOOL keep_running = command_line_run(input);
 
-static void cmd_git_diff(void) {
-    gui_println("Git Diff:");
-    execute_git_command("diff");
+    g_jobBackground = background;
+    memcpy(g_jobLabel, label, sizeof(label));
+    if (--g_commandDepth == 0) gui_flush();
+    return keep_running;
 }
 
-static void cmd_git_branch(const char* name) {
-    if (!name || !*name) {
-        gui_println("Git Branches:");
-        execute_git_command("branch");
-    } else {
-        char command[1024];
-        snprintf(command, sizeof(command), "branch %s", name);
-        execute_git_command(command);
+static BOOL contains_icase(const char* text, const char* word) {
+    size_t n = strlen(word);
+    for (; *text; text++) {
+        if (_strnicmp(text, word, n) == 0) return TRUE;
     }
+    return FALSE;
 }
 
-static void cmd_git_remote(const char* args) {
-    if (!args || !*args) {
-        gui_println("Git Remotes:");
-        execute_git_command("remote -v");
-    } else {
-        char command[1024];
-        snprintf(command, sizeof(command), "remote %s", args);
-        execute_git_command(command);
+// FIND filters what the previous stage printed, like the Windows filter.
+// With nothing piped to it and no filter switch it finds files by name.
+static void cmd_find(const char* args) {
+    const char* first = args ? args : "";
+    while (*first == ' ' || *first == '\t') first++;
+    if (!g_inStream && *first != '/') {
+        find_by_name(args);
+        return;
     }
-}
-
-static void cmd_git_checkout(const char* branch) {
-    if (!branch || !*branch) {
-        gui_println("Usage: GIT CHECKOUT <branch>");
-        gui_println("Example: GIT CHECKOUT main");
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args ? args : "");
+    BOOL ignore_case = FALSE, invert = FALSE, count_only = FALSE;
+    char* text = buf;
+    for (;;) {
+        char* rest = NULL;
+        char* word = text;
+        if (!parse_first_token(word, &rest)) { text = word; break; }
+        if (str_icmp(word, "/I") == 0) {
+            ignore_case = TRUE;
+        } else if (str_icmp(word, "/V") == 0) {
+            invert = TRUE;
+        } else if (str_icmp(word, "/C") == 0) {
+            count_only = TRUE;
+        } else {
+            if (*rest) word[strlen(word)] = ' ';
+            text = word;
+            break;
+        }
+        text = rest;
+    }
+    strip_quotes(text);
+    if (!*text || !g_inStream) {
+        gui_error("Usage: <command> | FIND [/I] [/V] [/C] <text>");
+        gui_println("Keeps the lines that contain text: /I ignores case, /V keeps the others, /C counts them.");
+        gui_println("Example: DIR | FIND src");
         return;
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "checkout %s", branch);
-    execute_git_command(command);
-    // Auto-sync to update virtual filesystem
-    cmd_sync();
-}
 
-static void cmd_git_merge(const char* branch) {
-    if (!branch || !*branch) {
-        gui_println("Usage: GIT MERGE <branch>");
-        gui_println("Example: GIT MERGE feature-branch");
-        return;
+    int matches = 0;
+    StreamReader r;
+    stream_reader_init(&r, g_inStream);
+    const char* line;
+    while ((line = stream_next_line(&r)) != NULL) {
+        BOOL hit = ignore_case ? contains_icase(line, text) : strstr(line, text) != NULL;
+        if (hit == invert) continue;
+        matches++;
+        if (!count_only) gui_println(line);
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "merge %s", branch);
-    execute_git_command(command);
-    // Auto-sync to update virtual filesystem
-    cmd_sync();
+    if (count_only) gui_printf("%d", matches);
 }
 
-static void cmd_git_pull(void) {
-    gui_println("Pulling changes from remote...");
-    gui_println("Checking remote configuration...");
-    execute_git_command("remote -v");
-    gui_println("Checking current branch...");
-    execute_git_command("branch");
-    gui_println("Checking status before pull...");
-    execute_git_command("status");
-    gui_println("Executing git pull...");
-    execute_git_command("pull");
-    gui_println("Checking status after pull...");
-    execute_git_command("status");
-    // Auto-sync to update virtual filesystem
-    cmd_sync();
-}
+// ---------------- GREP ----------------
+// GREP searches file contents. The files are listed first, folder by
+// folder in tree order, and cut into chunks that worker threads claim in
+// turn; each chunk keeps its own output, printed in order once all are
+// done, so what is shown never depends on which thread ran what. The VFS
+// is only read while the workers run: GREP waits for them.
+#define GREP_CHUNK_FILES 64
+#define GREP_MAX_WORKERS 16
 
-static void cmd_git_push(void) {
-    gui_println("Pushing changes to remote...");
-    gui_println("Checking commits ahead of remote...");
-    execute_git_command("log --oneline origin/main..HEAD");
-    gui_println("Executing git push...");
-    execute_git_command("push");
-}
+typedef struct {
+    Directory* dir;                       // NULL for a file named on its own
+    File* file;
+} GrepTarget;
 
+typedef struct {
+    char* text;                           // output lines, each ending in '\0'
+    size_t len;
+    size_t cap;
+    int matches;
+} GrepChunk;
 
-static void cmd_git_fetch(void) {
-    gui_println("Fetching changes from remote...");
-    execute_git_command("fetch");
+typedef struct {
+    const Matcher* matcher;
+    const GrepTarget* targets;
+    int target_count;
+    GrepChunk* chunks;
+    int chunk_count;
+    int next;                             // first chunk not yet claimed, under lock
+    PfMutex* lock;                        // NULL: the calling thread does every chunk
+    BOOL names;                           // lines start with their file's path
+    BOOL numbers;
+    BOOL count_only;                      // GREP --bench: count, keep no text
+    size_t root_len;                      // of the searched folder's vfs_rel_path
+    const char* prefix;                   // the path as typed, "" for the working folder
+} GrepJob;
+
+static BOOL grep_collect(Directory* dir, BOOL recurse, GrepTarget** targets, int* count, int* cap) {
+    for (int i = 0; i < dir->file_count; i++) {
+        if (*count == *cap) {
+            int bigger_cap = *cap ? *cap * 2 : 256;
+            GrepTarget* bigger = (GrepTarget*)realloc(*targets, sizeof(GrepTarget) * (size_t)bigger_cap);
+            if (!bigger) return FALSE;
+            *targets = bigger;
+            *cap = bigger_cap;
+        }
+        (*targets)[*count].dir = dir;
+        (*targets)[*count].file = dir->files[i];
+        (*count)++;
+    }
+    if (!recurse) return TRUE;
+    for (int i = 0; i < dir->child_count; i++) {
+        if (!grep_collect(dir->children[i], TRUE, targets, count, cap)) return FALSE;
+    }
+    return TRUE;
 }
 
-static void cmd_git_reset(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: GIT RESET <file> or GIT RESET --hard");
-        gui_println("Example: GIT RESET --hard (reset all changes)");
-        return;
+static void grep_file_path(const GrepJob* job, const GrepTarget* t, char* out, size_t size) {
+    char rel[1024];
+    vfs_rel_path(t->dir, rel, sizeof(rel));
+    const char* below = rel + (strlen(rel) >= job->root_len ? job->root_len : strlen(rel));
+    if (*below == '\\') below++;
+    snprintf(out, size, "%s%s%s%s%s", job->prefix, (*job->prefix && *below) ? "\\" : "", below,
+             (*job->prefix || *below) ? "\\" : "", t->file->name);
+}
+
+static void grep_chunk_add(GrepChunk* chunk, const char* line, size_t len) {
+    if (chunk->len + len + 1 > chunk->cap) {
+        size_t cap = chunk->cap ? chunk->cap : 4096;
+        while (cap < chunk->len + len + 1) cap *= 2;
+        char* bigger = (char*)realloc(chunk->text, cap);
+        if (!bigger) return;
+        chunk->text = bigger;
+        chunk->cap = cap;
+    }
+    memcpy(chunk->text + chunk->len, line, len);
+    chunk->text[chunk->len + len] = '\0';
+    chunk->len += len + 1;
+}
+
+static void grep_search_chunk(GrepJob* job, int index) {
+    GrepChunk* chunk = &job->chunks[index];
+    int first = index * GREP_CHUNK_FILES;
+    int last = first + GREP_CHUNK_FILES < job->target_count ? first + GREP_CHUNK_FILES : job->target_count;
+    char path[1200];
+    char line[MAX_FILE_SIZE + sizeof(path) + 16];
+    for (int i = first; i < last; i++) {
+        const GrepTarget* t = &job->targets[i];
+        const char* text = t->file->content;
+        size_t len = strlen(text);
+        size_t pos = 0, start, end, counted = 0;
+        int number = 1;
+        BOOL named = FALSE;
+        while (matcher_next_line(job->matcher, text, len, &pos, &start, &end)) {
+            chunk->matches++;
+            if (job->count_only) continue;
+            if (job->names && !named) {
+                grep_file_path(job, t, path, sizeof(path));
+                named = TRUE;
+            }
+            if (job->numbers) {
+                for (const char* nl; (nl = (const char*)memchr(text + counted, '\n', start - counted)) != NULL;) {
+                    number++;
+                    counted = (size_t)(nl - text) + 1;
+                }
+                counted = start;
+            }
+            int n;
+            if (job->names && job->numbers) {
+                n = snprintf(line, sizeof(line), "%s:%d:%.*s", path, number, (int)(end - start), text + start);
+            } else if (job->names) {
+                n = snprintf(line, sizeof(line), "%s:%.*s", path, (int)(end - start), text + start);
+            } else if (job->numbers) {
+                n = snprintf(line, sizeof(line), "%d:%.*s", number, (int)(end - start), text + start);
+            } else {
+                n = snprintf(line, sizeof(line), "%.*s", (int)(end - start), text + start);
+            }
+            if (n >= (int)sizeof(line)) n = (int)sizeof(line) - 1;
+            grep_chunk_add(chunk, line, (size_t)n);
+        }
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "reset %s", args);
-    execute_git_command(command);
 }
 
-static void cmd_git_rm(const char* file) {
-    if (!file || !*file) {
-        gui_println("Usage: GIT RM <file> or GIT RM -r <folder>");
-        gui_println("Example: GIT RM file.txt (remove file from Git)");
-        gui_println("Example: GIT RM -r folder/ (remove folder from Git)");
-        return;
-    }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "rm %s", file);
-    execute_git_command(command);
-    // Auto-sync to update virtual filesystem
-    cmd_sync();
+static int grep_worker(void* param) {
+    GrepJob* job = (GrepJob*)param;
+    for (;;) {
+        int i;
+        if (job->lock) {
+            pf_mutex_lock(job->lock);
+            i = job->next < job->chunk_count ? job->next++ : -1;
+            pf_mutex_unlock(job->lock);
+        } else {
+            i = job->next < job->chunk_count ? job->next++ : -1;
+        }
+        if (i < 0) return 0;
+        grep_search_chunk(job, i);
+    }
+}
+
+// Searches every target with up to workers threads, the caller's included;
+// FALSE when out of memory
+static BOOL grep_run(GrepJob* job, int workers) {
+    job->chunk_count = (job->target_count + GREP_CHUNK_FILES - 1) / GREP_CHUNK_FILES;
+    job->chunks = (GrepChunk*)calloc((size_t)(job->chunk_count ? job->chunk_count : 1), sizeof(GrepChunk));
+    if (!job->chunks) return FALSE;
+    job->next = 0;
+    if (workers > job->chunk_count) workers = job->chunk_count;
+    if (workers > GREP_MAX_WORKERS) workers = GREP_MAX_WORKERS;
+    job->lock = workers > 1 ? pf_mutex_create() : NULL;
+
+    PfThread* threads[GREP_MAX_WORKERS];
+    int started = 0;
+    while (job->lock && started < workers - 1) {
+        threads[started] = pf_thread_start(grep_worker, job);
+        if (!threads[started]) break;
+        started++;
+    }
+    grep_worker(job);
+    for (int i = 0; i < started; i++) pf_thread_join(threads[i]);
+    if (job->lock) pf_mutex_free(job->lock);
+    job->lock = NULL;
+    return TRUE;
 }
 
-static void cmd_git_clean(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: GIT CLEAN -f (remove untracked files)");
-        gui_println("Usage: GIT CLEAN -fd (remove untracked files and directories)");
-        gui_println("Example: GIT CLEAN -fd (remove all untracked files and folders)");
+static int grep_finish(GrepJob* job, BOOL print) {
+    int matches = 0;
+    for (int i = 0; i < job->chunk_count; i++) {
+        GrepChunk* chunk = &job->chunks[i];
+        matches += chunk->matches;
+        for (size_t at = 0; print && at < chunk->len; at += strlen(chunk->text + at) + 1) {
+            gui_println(chunk->text + at);
+        }
+        free(chunk->text);
+    }
+    free(job->chunks);
+    job->chunks = NULL;
+    return matches;
+}
+
+// The baseline GREP --bench measures against: strstr over each file, then
+// on to the end of the line it found
+static int grep_strstr_count(const GrepTarget* targets, int count, const char* text) {
+    int matches = 0;
+    for (int i = 0; i < count; i++) {
+        const char* p = targets[i].file->content;
+        const char* hit;
+        while ((hit = strstr(p, text)) != NULL) {
+            matches++;
+            const char* nl = strchr(hit, '\n');
+            if (!nl) break;
+            p = nl + 1;
+        }
+    }
+    return matches;
+}
+
+// GREP --bench: the same search as strstr, as GREP on one thread and as
+// GREP on every processor, repeated for a quarter second each
+static void grep_bench(GrepJob* job, const char* pattern, BOOL plain, int workers) {
+    unsigned long long bytes = 0;
+    for (int i = 0; i < job->target_count; i++) bytes += strlen(job->targets[i].file->content);
+    gui_printf("Searching %d files (%llu bytes) for \"%s\" (%s):", job->target_count, bytes, pattern,
+               matcher_is_literal(job->matcher) ? "plain text" : "regular expression");
+
+    int chunks = (job->target_count + GREP_CHUNK_FILES - 1) / GREP_CHUNK_FILES;
+    if (workers > chunks) workers = chunks > 0 ? chunks : 1;
+    if (workers > GREP_MAX_WORKERS) workers = GREP_MAX_WORKERS;
+    double baseline = 0.0;
+    for (int pass = 0; pass < 3; pass++) {
+        char label[32];
+        if (pass == 0) snprintf(label, sizeof(label), "strstr");
+        else snprintf(label, sizeof(label), "%d thread%s", pass == 1 ? 1 : workers, (pass == 2 && workers > 1) ? "s" : "");
+        if (pass == 0 && !plain) {
+            gui_printf("  %-10s        n/a (only for plain text, matching case)", label);
+            continue;
+        }
+        int matches = 0;
+        long runs = 0;
+        double start = pf_seconds(), elapsed;
+        do {
+            if (pass == 0) {
+                matches = grep_strstr_count(job->targets, job->target_count, pattern);
+            } else {
+                if (!grep_run(job, pass == 1 ? 1 : workers)) {
+                    gui_error("Not enough memory for the benchmark.");
+                    return;
+                }
+                matches = grep_finish(job, FALSE);
+            }
+            runs++;
+            elapsed = pf_seconds() - start;
+        } while (elapsed < 0.25);
+        double rate = (double)bytes * (double)runs / elapsed / 1e6;
+        char speedup[32] = "";
+        if (pass == 0) baseline = rate;
+        else if (baseline > 0.0) snprintf(speedup, sizeof(speedup), "  %.2fx strstr", rate / baseline);
+        gui_printf("  %-10s %9.1f MB/s %8.3f ms  %d lines%s", label, rate, elapsed * 1000.0 / (double)runs,
+                   matches, speedup);
+    }
+}
+
+static void cmd_grep(const char* args) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args ? args : "");
+    char* argv[16];
+    int argc = split_args(buf, argv, 16);
+    BOOL recurse = FALSE, ignore_case = FALSE, numbers = FALSE, fixed = FALSE, bench = FALSE;
+    const char* pattern = NULL;
+    const char* path = NULL;
+    BOOL usage = FALSE;
+    for (int i = 0; i < argc; i++) {
+        const char* a = argv[i];
+        if (!pattern && strcmp(a, "--bench") == 0) {
+            bench = TRUE;
+        } else if (!pattern && a[0] == '-' && a[1]) {
+            for (const char* o = a + 1; *o; o++) {
+                char c = (char)tolower((unsigned char)*o);
+                if (c == 'r') recurse = TRUE;
+                else if (c == 'i') ignore_case = TRUE;
+                else if (c == 'n') numbers = TRUE;
+                else if (c == 'f') fixed = TRUE;
+                else usage = TRUE;
+            }
+        } else if (!pattern) {
+            pattern = a;
+        } else if (!path) {
+            path = a;
+        } else {
+            usage = TRUE;
+        }
+    }
+    if (usage || !pattern || !*pattern) {
+        gui_error("Usage: GREP [-r] [-i] [-n] [-F] <pattern> [path] | <cmd> | GREP [-i] [-n] <pattern>");
+        gui_println("Shows the lines that match: -r searches subfolders too, -i ignores case,");
+        gui_println("-n numbers the lines, -F takes the pattern as plain text. Patterns are");
+        gui_println("regular expressions: . [a-z] * + ? | ( ) ^ $ \\d \\w \\s");
+        gui_println("GREP --bench [-i] <pattern> [path] times it against strstr.");
+        gui_println("Example: GREP -rn \"TODO|FIXME\" src");
         return;
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "clean %s", args);
-    execute_git_command(command);
-    // Auto-sync to update virtual filesystem
-    cmd_sync();
-}
 
-static void cmd_git_stash(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: GIT STASH or GIT STASH POP");
-        gui_println("Example: GIT STASH (stash changes)");
+    const char* error = NULL;
+    Matcher* m = matcher_compile(pattern, (ignore_case ? MATCH_IGNORE_CASE : 0) | (fixed ? MATCH_LITERAL : 0), &error);
+    if (!m) {
+        gui_errorf("GREP: %s", error ? error : "invalid pattern");
         return;
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "stash %s", args);
-    execute_git_command(command);
-}
 
-static void cmd_git_tag(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: GIT TAG <name> or GIT TAG -l");
-        gui_println("Example: GIT TAG -l (list tags)");
+    // Piped lines, when there is no path to search
+    if (!path && g_inStream && !bench) {
+        StreamReader r;
+        stream_reader_init(&r, g_inStream);
+        const char* line;
+        int number = 0;
+        while ((line = stream_next_line(&r)) != NULL) {
+            number++;
+            if (!matcher_line(m, line, strlen(line))) continue;
+            if (numbers) gui_printf("%d:%s", number, line);
+            else gui_println(line);
+        }
+        matcher_free(m);
         return;
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "tag %s", args);
-    execute_git_command(command);
-}
 
-static void cmd_git_config(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: GIT CONFIG --global user.name <name> or GIT CONFIG --list");
-        gui_println("Example: GIT CONFIG --list (show all config)");
+    Directory* dir = g_cwd;
+    File* file = NULL;
+    if (path && !vfs_resolve_path(path, &dir, &file)) {
+        gui_error("The system cannot find the path specified.");
+        matcher_free(m);
         return;
     }
-    
-    char command[1024];
-    snprintf(command, sizeof(command), "config %s", args);
-    execute_git_command(command);
-}
 
-static void cmd_git_help(const char* command) {
-    if (!command || !*command) {
-        gui_println("Available Git commands:");
-        gui_println("  INIT, CLONE, ADD, COMMIT, STATUS, LOG, DIFF");
-        gui_println("  BRANCH, CHECKOUT, MERGE, PULL, PUSH, REMOTE");
-        gui_println("  FETCH, RESET, RM, CLEAN, STASH, TAG, CONFIG, VERSION");
-        gui_println("Type 'HELP' for detailed command descriptions.");
+    GrepJob job;
+    memset(&job, 0, sizeof(job));
+    GrepTarget single;
+    GrepTarget* targets = NULL;
+    int cap = 0;
+    if (file) {
+        single.dir = NULL;
+        single.file = file;
+        job.targets = &single;
+        job.target_count = 1;
+    } else if (!grep_collect(dir, recurse || bench, &targets, &job.target_count, &cap)) {
+        gui_error("Not enough memory to list the files.");
+        free(targets);
+        matcher_free(m);
         return;
+    } else {
+        job.targets = targets;
+        char rel[1024];
+        vfs_rel_path(dir, rel, sizeof(rel));
+        job.root_len = strlen(rel);
+        job.names = TRUE;
+    }
+    job.matcher = m;
+    job.numbers = numbers;
+    job.prefix = path ? path : "";
+
+    int workers = pf_cpu_count();
+    if (bench) {
+        job.count_only = TRUE;
+        // strstr can only stand in for a case-sensitive literal, written as is
+        BOOL plain = matcher_is_literal(m) && !ignore_case && (fixed || !strchr(pattern, '\\'));
+        grep_bench(&job, pattern, plain, workers);
+    } else if (!grep_run(&job, workers)) {
+        gui_error("Not enough memory to search.");
+    } else {
+        grep_finish(&job, TRUE);
+    }
+    free(targets);
+    matcher_free(m);
+}
+
+// ---------------- SEARCH ----------------
+// A trigram index over file contents, so a repeated search reads only the
+// files that can match. Every indexed file is a document. Each trigram
+// (three bytes, ASCII case folded, no line breaks) lists the documents that
+// hold it in ascending order. A query's lists are intersected and only
+// those files are searched, the way GREP searches.
+//
+// The first SEARCH builds the index, and vfs_changed keeps it current from
+// then on. A rewritten file becomes a new document and the old one is only
+// marked dead, so lists are only ever appended to. Once the dead outnumber
+// the live, the next SEARCH rebuilds the index.
+//
+// Saving the filesystem writes it to data\search_index.dat as well. On
+// reading it back, a document is kept only if the file at its path still
+// has the saved content hash; anything else is indexed afresh.
+#define SEARCH_INDEX_MAGIC "NXSI"
+#define SEARCH_INDEX_VERSION 1
+#define SEARCH_COMPACT_MIN 1024           // dead documents tolerated whatever the live count
+
+typedef struct {
+    unsigned int trigram;                 // 0: empty slot
+    int count;
+    int cap;
+    int last;                             // docs[count - 1], kept here to save a cache miss
+    int* docs;                            // ascending
+} SearchPosting;
+
+typedef struct {
+    File* file;                           // NULL once the file is rewritten or removed
+    Directory* dir;
+} SearchDoc;
+
+typedef struct {
+    BOOL ready;
+    BOOL dirty;                           // changed since search_index.dat was written
+    SearchDoc* docs;
+    int doc_count;
+    int doc_cap;
+    int live;
+    SearchPosting* table;                 // open addressing, a power of two
+    int table_cap;
+    int trigrams;
+    size_t postings;                      // entries over every list
+    size_t posting_bytes;                 // allocated for them
+    double ready_seconds;                 // spent building or loading it
+    int reused;                           // documents taken from search_index.dat
+} SearchIndex;
+
+static SearchIndex g_search;
+
+static void search_index_path(char* out, size_t out_sz) {
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    snprintf(out, out_sz, "%s\\data\\search_index.dat", program_dir);
+}
+
+// 0 when the three bytes hold a line break (or the end)
+static unsigned int search_trigram(const char* p) {
+    unsigned int t = 0;
+    for (int i = 0; i < 3; i++) {
+        unsigned char c = (unsigned char)p[i];
+        if (c == '\0' || c == '\n' || c == '\r') return 0;
+        t = (t << 8) | (unsigned char)tolower(c);
+    }
+    return t;
+}
+
+static unsigned int search_slot_of(unsigned int trigram, int cap) {
+    // The product's high bits mix all three bytes; its low bits do not
+    unsigned int h = trigram * 2654435761u;
+    return (h ^ (h >> 16)) & (unsigned int)(cap - 1);
+}
+
+static SearchPosting* search_posting(unsigned int trigram, BOOL create) {
+    if (create && (g_search.trigrams + 1) * 2 > g_search.table_cap) {
+        int cap = g_search.table_cap ? g_search.table_cap * 2 : 4096;
+        SearchPosting* table = (SearchPosting*)calloc((size_t)cap, sizeof(SearchPosting));
+        if (!table) return NULL;
+        for (int i = 0; i < g_search.table_cap; i++) {
+            SearchPosting* p = &g_search.table[i];
+            if (!p->trigram) continue;
+            unsigned int s = search_slot_of(p->trigram, cap);
+            while (table[s].trigram) s = (s + 1) & (unsigned int)(cap - 1);
+            table[s] = *p;
+        }
+        free(g_search.table);
+        g_search.table = table;
+        g_search.table_cap = cap;
+    }
+    if (!g_search.table_cap) return NULL;
+    unsigned int s = search_slot_of(trigram, g_search.table_cap);
+    while (g_search.table[s].trigram && g_search.table[s].trigram != trigram) {
+        s = (s + 1) & (unsigned int)(g_search.table_cap - 1);
+    }
+    SearchPosting* p = &g_search.table[s];
+    if (!p->trigram) {
+        if (!create) return NULL;
+        p->trigram = trigram;
+        g_search.trigrams++;
+    }
+    return p;
+}
+
+// Documents arrive in ascending order, so a repeat is always the last entry
+static void search_posting_add(SearchPosting* p, int doc) {
+    if (p->count > 0 && p->last == doc) return;
+    if (p->count == p->cap) {
+        int cap = p->cap ? p->cap * 2 : 4;
+        int* docs = (int*)realloc(p->docs, sizeof(int) * (size_t)cap);
+        if (!docs) return;
+        g_search.posting_bytes += sizeof(int) * (size_t)(cap - p->cap);
+        p->docs = docs;
+        p->cap = cap;
+    }
+    p->docs[p->count++] = doc;
+    p->last = doc;
+    g_search.postings++;
+}
+
+// A new document for file (NULL: a dead one); -1 when out of memory
+static int search_doc_new(Directory* dir, File* file) {
+    if (g_search.doc_count == g_search.doc_cap) {
+        int cap = g_search.doc_cap ? g_search.doc_cap * 2 : 1024;
+        SearchDoc* docs = (SearchDoc*)realloc(g_search.docs, sizeof(SearchDoc) * (size_t)cap);
+        if (!docs) return -1;
+        g_search.docs = docs;
+        g_search.doc_cap = cap;
+    }
+    int doc = g_search.doc_count++;
+    g_search.docs[doc].file = file;
+    g_search.docs[doc].dir = dir;
+    if (file) {
+        file->search_doc = doc + 1;
+        g_search.live++;
+    }
+    return doc;
+}
+
+static void search_doc_add(Directory* dir, File* file) {
+    int doc = search_doc_new(dir, file);
+    if (doc < 0) return;
+    // The trigram ending at each byte, rolled along; run counts the bytes
+    // since the last line break
+    unsigned int t = 0;
+    int run = 0;
+    for (const unsigned char* p = (const unsigned char*)file->content; *p; p++) {
+        if (*p == '\n' || *p == '\r') {
+            run = 0;
+            continue;
+        }
+        t = ((t << 8) | (unsigned char)tolower(*p)) & 0xFFFFFF;
+        if (++run < 3) continue;
+        SearchPosting* posting = search_posting(t, TRUE);
+        if (posting) search_posting_add(posting, doc);
     }
-    
-    char git_help_cmd[1024];
-    snprintf(git_help_cmd, sizeof(git_help_cmd), "help %s", command);
-    execute_git_command(git_help_cmd);
 }
 
-static void cmd_git_version(void) {
-    gui_println("Git Version:");
-    execute_git_command("--version");
+static void search_doc_drop(File* file) {
+    if (!file->search_doc) return;
+    g_search.docs[file->search_doc - 1].file = NULL;
+    g_search.live--;
+    file->search_doc = 0;
 }
 
-// Test command to verify Git is working
-static void cmd_git_test(void) {
-    gui_println("Testing Git installation...");
-    gui_println("Running: git --version");
-    
-    int result = system("git --version");
-    
-    if (result == 0) {
-        gui_println("Git is working correctly!");
-    } else {
-        gui_println("Git is not installed or not in PATH.");
-        gui_println("Please install Git from https://git-scm.com/");
+static void search_add_tree(Directory* dir) {
+    for (int i = 0; i < dir->file_count; i++) {
+        if (!dir->files[i]->search_doc) search_doc_add(dir, dir->files[i]);
     }
+    for (int i = 0; i < dir->child_count; i++) search_add_tree(dir->children[i]);
 }
 
-// Show where Git operations happen
-static void cmd_git_pwd(void) {
-    gui_println("Git operations happen in the real Windows file system.");
-    gui_println("Current working directory for Git commands:");
-    
-    // Get current working directory
-    char cwd[1024];
-    if (GetCurrentDirectoryA(sizeof(cwd), cwd) != 0) {
-        gui_println(cwd);
-    } else {
-        gui_println("Unable to get current directory");
+static void search_drop_tree(Directory* dir) {
+    for (int i = 0; i < dir->file_count; i++) search_doc_drop(dir->files[i]);
+    for (int i = 0; i < dir->child_count; i++) search_drop_tree(dir->children[i]);
+}
+
+static void search_index_clear(void) {
+    search_drop_tree(g_root);
+    for (int i = 0; i < g_search.table_cap; i++) free(g_search.table[i].docs);
+    free(g_search.table);
+    free(g_search.docs);
+    memset(&g_search, 0, sizeof(g_search));
+}
+
+// Only the tree under C:\USERS is indexed, not FILEVIEW BENCH's scratch trees
+static BOOL search_attached(Directory* dir) {
+    while (dir && dir != g_root) dir = dir->parent;
+    return dir == g_root;
+}
+
+static void search_index_changed(VfsChange what, Directory* dir, File* file) {
+    if (!g_search.ready) return;
+    switch (what) {
+        case VFS_FILE_ADDED:
+        case VFS_FILE_WRITTEN:
+            search_doc_drop(file);
+            if (search_attached(dir)) search_doc_add(dir, file);
+            break;
+        case VFS_FILE_REMOVED:
+            search_doc_drop(file);
+            break;
+        case VFS_DIR_ADDED:
+            if (search_attached(dir)) search_add_tree(dir);
+            break;
+        case VFS_DIR_REMOVED:
+            search_drop_tree(dir);
+            break;
     }
-    
-    gui_println("");
-    gui_println("Terminal virtual filesystem path:");
-    char path[1024];
-    fs_print_path(g_cwd, path, sizeof(path));
-    gui_println(path);
+    g_search.dirty = TRUE;
 }
 
-static int parse_first_token(char* line, char** arg_out) {
-    while (*line && isspace((unsigned char)*line)) line++;
-    if (!*line) { *arg_out = line; return 0; }
-    char* p = line;
-    while (*p && !isspace((unsigned char)*p)) { p++; }
-    int has_cmd = (*line != '\0');
-    if (*p) { *p++ = '\0'; }
-    while (*p && isspace((unsigned char)*p)) p++;
-    *arg_out = p;
-    return has_cmd ? 1 : 0;
+// ---- Saving ----
+// Little-endian varints throughout; each list is stored as gaps between
+// document numbers, renumbered so dead documents take no room.
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t cap;
+    BOOL failed;
+} SearchBuffer;
+
+static void search_put(SearchBuffer* b, const void* data, size_t len) {
+    if (b->failed) return;
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 65536;
+        while (cap < b->len + len) cap *= 2;
+        unsigned char* bigger = (unsigned char*)realloc(b->data, cap);
+        if (!bigger) {
+            b->failed = TRUE;
+            return;
+        }
+        b->data = bigger;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
 }
 
-// Case-insensitive string comparison
-static int str_icmp(const char* s1, const char* s2) {
-    while (*s1 && *s2) {
-        int c1 = tolower((unsigned char)*s1);
-        int c2 = tolower((unsigned char)*s2);
-        if (c1 != c2) return c1 - c2;
-        s1++;
-        s2++;
+static void search_put_varint(SearchBuffer* b, unsigned long long v) {
+    unsigned char bytes[10];
+    size_t n = 0;
+    do {
+        bytes[n] = (unsigned char)(v & 0x7F);
+        v >>= 7;
+        if (v) bytes[n] |= 0x80;
+        n++;
+    } while (v);
+    search_put(b, bytes, n);
+}
+
+static BOOL search_get_varint(const unsigned char** p, const unsigned char* end, unsigned long long* v) {
+    *v = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        unsigned char c = *(*p)++;
+        *v |= (unsigned long long)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return TRUE;
     }
-    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+    return FALSE;
 }
 
-// ---------------- Command Implementations ----------------
-static void cmd_login(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: LOGIN <username> <password>");
-        return;
+static void search_index_save(void) {
+    if (!g_search.ready || !g_search.dirty) return;
+    int* renumber = (int*)malloc(sizeof(int) * (size_t)(g_search.doc_count + 1));
+    if (!renumber) return;
+    SearchBuffer b;
+    memset(&b, 0, sizeof(b));
+    search_put(&b, SEARCH_INDEX_MAGIC, 4);
+    search_put_varint(&b, SEARCH_INDEX_VERSION);
+    search_put_varint(&b, (unsigned long long)g_search.live);
+    int kept = 0;
+    for (int i = 0; i < g_search.doc_count; i++) {
+        const SearchDoc* d = &g_search.docs[i];
+        renumber[i] = d->file ? kept++ : -1;
+        if (!d->file) continue;
+        char rel[1024], path[1400];
+        vfs_rel_path(d->dir, rel, sizeof(rel));
+        snprintf(path, sizeof(path), "%s%s%s", rel, *rel ? "\\" : "", d->file->name);
+        search_put_varint(&b, hash64(d->file->content, strlen(d->file->content)));
+        search_put_varint(&b, strlen(path));
+        search_put(&b, path, strlen(path));
+    }
+    for (int i = 0; i < g_search.table_cap; i++) {
+        const SearchPosting* p = &g_search.table[i];
+        int live = 0;
+        for (int k = 0; k < p->count; k++) live += renumber[p->docs[k]] >= 0;
+        if (!live) continue;
+        search_put_varint(&b, p->trigram);
+        search_put_varint(&b, (unsigned long long)live);
+        int last = -1;
+        for (int k = 0; k < p->count; k++) {
+            int doc = renumber[p->docs[k]];
+            if (doc < 0) continue;
+            search_put_varint(&b, (unsigned long long)(doc - last));
+            last = doc;
+        }
+    }
+    free(renumber);
+
+    char path[1024];
+    search_index_path(path, sizeof(path));
+    FILE* f = b.failed ? NULL : pf_fopen(path, "wb");
+    if (f) {
+        if (fwrite(b.data, 1, b.len, f) == b.len) g_search.dirty = FALSE;
+        fclose(f);
     }
-    
-    char username[64], password[128];
-    if (sscanf(args, "%63s %127s", username, password) != 2) {
-        gui_println("Usage: LOGIN <username> <password>");
-        return;
+    free(b.data);
+}
+
+// Reads search_index.dat into the empty index; FALSE when there is none or
+// it does not parse, and the index is then left empty again
+static BOOL search_index_load(void) {
+    if (!g_fsLoadedFromDisk) return FALSE;
+    char path[1024];
+    search_index_path(path, sizeof(path));
+    FILE* f = pf_fopen(path, "rb");
+    if (!f) return FALSE;
+    unsigned char* data = NULL;
+    size_t len = 0, cap = 0, n;
+    unsigned char chunk[65536];
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        if (len + n > cap) {
+            cap = cap ? cap * 2 : sizeof(chunk) * 4;
+            while (cap < len + n) cap *= 2;
+            unsigned char* bigger = (unsigned char*)realloc(data, cap);
+            if (!bigger) break;
+            data = bigger;
+        }
+        memcpy(data + len, chunk, n);
+        len += n;
     }
-    
-    if (authenticate_user(username, password)) {
-        gui_printf("Successfully logged in as %s", username);
-        
-        
-        // Update current user
-        strncpy(g_currentUser, username, sizeof(g_currentUser) - 1);
-        
-        // Switch to user's home directory
-        Directory* user_dir = fs_find_child(g_root, username);
-        if (user_dir) {
-            g_home = user_dir;
-            g_cwd = user_dir;
-        }
-        
-        // Check if this was a system maintenance authentication attempt
-        if (strcmp(username, "Admin") == 0) {
-            gui_println("");
-            gui_println("Admin authentication successful.");
-            gui_println("System maintenance tools available: CD .system_maintenance");
+    fclose(f);
+
+    const unsigned char* p = data;
+    const unsigned char* end = data + len;
+    unsigned long long version = 0, docs = 0;
+    BOOL ok = data && len > 4 && memcmp(data, SEARCH_INDEX_MAGIC, 4) == 0;
+    if (ok) {
+        p += 4;
+        ok = search_get_varint(&p, end, &version) && version == SEARCH_INDEX_VERSION &&
+             search_get_varint(&p, end, &docs) && docs < 0x7FFFFFFF;
+    }
+    for (unsigned long long i = 0; ok && i < docs; i++) {
+        unsigned long long hash, path_len;
+        char rel[1400];
+        ok = search_get_varint(&p, end, &hash) && search_get_varint(&p, end, &path_len) &&
+             path_len < sizeof(rel) && path_len <= (unsigned long long)(end - p);
+        if (!ok) break;
+        memcpy(rel, p, (size_t)path_len);
+        rel[path_len] = '\0';
+        p += path_len;
+        // A document its file no longer matches stays, dead, to keep the numbering
+        Directory* dir = NULL;
+        File* file = vfs_lookup_file(rel, &dir);
+        if (file && (file->search_doc || hash64(file->content, strlen(file->content)) != hash)) file = NULL;
+        ok = search_doc_new(dir, file) >= 0;
+        if (file) g_search.reused++;
+    }
+    while (ok && p < end) {
+        unsigned long long trigram, count, gap;
+        ok = search_get_varint(&p, end, &trigram) && trigram && trigram < 0x1000000 &&
+             search_get_varint(&p, end, &count);
+        SearchPosting* posting = ok ? search_posting((unsigned int)trigram, TRUE) : NULL;
+        ok = ok && posting && posting->count == 0;
+        long long doc = -1;
+        for (unsigned long long k = 0; ok && k < count; k++) {
+            ok = search_get_varint(&p, end, &gap) && gap > 0 && doc + (long long)gap < (long long)docs;
+            if (ok) {
+                doc += (long long)gap;
+                search_posting_add(posting, (int)doc);
+            }
         }
+    }
+    free(data);
+    if (!ok) search_index_clear();
+    return ok;
+}
+
+// ---- Searching ----
+// Lists grow by doubling while the index is built; afterwards most never
+// grow again, so they give the slack back
+static void search_index_trim(void) {
+    for (int i = 0; i < g_search.table_cap; i++) {
+        SearchPosting* p = &g_search.table[i];
+        if (p->cap == p->count || !p->count) continue;
+        int* docs = (int*)realloc(p->docs, sizeof(int) * (size_t)p->count);
+        if (!docs) continue;
+        g_search.posting_bytes -= sizeof(int) * (size_t)(p->cap - p->count);
+        p->docs = docs;
+        p->cap = p->count;
+    }
+}
+
+static void search_index_ready(void) {
+    BOOL crowded = g_search.doc_count - g_search.live > g_search.live &&
+                   g_search.doc_count - g_search.live > SEARCH_COMPACT_MIN;
+    if (g_search.ready && !crowded) return;
+    double start = pf_seconds();
+    search_index_clear();
+    BOOL loaded = !crowded && search_index_load();
+    int before = g_search.doc_count;
+    search_add_tree(g_root);
+    search_index_trim();
+    g_search.ready = TRUE;
+    g_search.dirty = !loaded || g_search.doc_count != before || g_search.reused != before;
+    g_search.ready_seconds = pf_seconds() - start;
+}
+
+static int search_compare_postings(const void* a, const void* b) {
+    const SearchPosting* pa = *(const SearchPosting* const*)a;
+    const SearchPosting* pb = *(const SearchPosting* const*)b;
+    return (pa->count > pb->count) - (pa->count < pb->count);
+}
+
+// Live documents that hold every trigram of query, ascending, in a malloc'd
+// array; a query shorter than a trigram gets every live document
+static int* search_candidates(const char* query, int* count_out) {
+    *count_out = 0;
+    size_t len = strlen(query);
+    int* result = NULL;
+    int count = 0;
+    const SearchPosting** lists = (const SearchPosting**)malloc(sizeof(SearchPosting*) * (len + 1));
+    int list_count = 0;
+    if (!lists) return NULL;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        unsigned int t = search_trigram(query + i);
+        if (!t) continue;
+        const SearchPosting* p = search_posting(t, FALSE);
+        if (!p) {
+            free(lists);
+            return (int*)calloc(1, sizeof(int));
+        }
+        lists[list_count++] = p;
+    }
+
+    if (list_count == 0) {
+        result = (int*)malloc(sizeof(int) * (size_t)(g_search.doc_count + 1));
+        for (int d = 0; result && d < g_search.doc_count; d++) result[count++] = d;
+    } else {
+        // Shortest list first: nothing after it can add documents
+        qsort(lists, (size_t)list_count, sizeof(lists[0]), search_compare_postings);
+        result = (int*)malloc(sizeof(int) * (size_t)(lists[0]->count + 1));
+        if (result) {
+            memcpy(result, lists[0]->docs, sizeof(int) * (size_t)lists[0]->count);
+            count = lists[0]->count;
+        }
+        for (int l = 1; result && l < list_count && count > 0; l++) {
+            const SearchPosting* p = lists[l];
+            int kept = 0, k = 0;
+            for (int i = 0; i < count; i++) {
+                while (k < p->count && p->docs[k] < result[i]) k++;
+                if (k == p->count) break;
+                if (p->docs[k] == result[i]) result[kept++] = result[i];
+            }
+            count = kept;
+        }
+    }
+    free(lists);
+    if (!result) return NULL;
+    int live = 0;
+    for (int i = 0; i < count; i++) {
+        if (g_search.docs[result[i]].file) result[live++] = result[i];
+    }
+    *count_out = live;
+    return result;
+}
+
+static int search_depth(const Directory* dir) {
+    int n = 0;
+    for (; dir; dir = dir->parent) n++;
+    return n;
+}
+
+// Orders entry na in folder da against nb in db by path without building
+// the paths: each side is walked up to where the two part, and the names
+// just below that are compared
+static int search_compare_paths(const Directory* da, const char* na, const Directory* db, const char* nb) {
+    int depth_a = search_depth(da), depth_b = search_depth(db);
+    int own_a = depth_a, own_b = depth_b;
+    for (; depth_a > depth_b; depth_a--, da = da->parent) na = da->name;
+    for (; depth_b > depth_a; depth_b--, db = db->parent) nb = db->name;
+    while (da != db) {
+        na = da->name;
+        nb = db->name;
+        da = da->parent;
+        db = db->parent;
+    }
+    int c = str_icmp(na, nb);
+    return c ? c : own_a - own_b;
+}
+
+static int search_compare_targets(const void* a, const void* b) {
+    const GrepTarget* ta = (const GrepTarget*)a;
+    const GrepTarget* tb = (const GrepTarget*)b;
+    return search_compare_paths(ta->dir, ta->file->name, tb->dir, tb->file->name);
+}
+
+// The candidates below root as GREP targets, by path; NULL when out of memory
+static GrepTarget* search_targets(const int* docs, int count, Directory* root, int* target_count) {
+    *target_count = 0;
+    GrepTarget* targets = (GrepTarget*)malloc(sizeof(GrepTarget) * (size_t)(count + 1));
+    if (!targets) return NULL;
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        const SearchDoc* d = &g_search.docs[docs[i]];
+        Directory* up = d->dir;
+        while (up && up != root) up = up->parent;
+        if (!up) continue;
+        targets[n].dir = d->dir;
+        targets[n].file = d->file;
+        n++;
+    }
+    qsort(targets, (size_t)n, sizeof(GrepTarget), search_compare_targets);
+    *target_count = n;
+    return targets;
+}
+
+static void search_stats(void) {
+    size_t content = 0;
+    for (int i = 0; i < g_search.doc_count; i++) {
+        if (g_search.docs[i].file) content += strlen(g_search.docs[i].file->content);
+    }
+    size_t memory = sizeof(SearchPosting) * (size_t)g_search.table_cap + g_search.posting_bytes +
+                    sizeof(SearchDoc) * (size_t)g_search.doc_cap;
+    gui_printf("Files indexed:      %d (%d stale entries left from rewrites and removals)",
+               g_search.live, g_search.doc_count - g_search.live);
+    gui_printf("Distinct trigrams:  %d, %lu postings", g_search.trigrams, (unsigned long)g_search.postings);
+    gui_printf("Memory:             %lu KB for %lu KB of content (%.0f%%)", (unsigned long)(memory / 1024),
+               (unsigned long)(content / 1024), content ? 100.0 * (double)memory / (double)content : 0.0);
+    if (g_search.reused > 0) {
+        gui_printf("Ready in:           %.1f ms (read from search_index.dat, %d files reused)",
+                   g_search.ready_seconds * 1000.0, g_search.reused);
     } else {
-        gui_println("Login failed. Invalid username or password.");
+        gui_printf("Ready in:           %.1f ms (built)", g_search.ready_seconds * 1000.0);
+    }
+    char path[1024];
+    search_index_path(path, sizeof(path));
+    PfStat st;
+    if (pf_stat(path, &st)) {
+        gui_printf("On disk:            %lu KB%s", (unsigned long)(st.size / 1024), g_search.dirty ? " (older than the index)" : "");
     }
 }
 
-static void cmd_logout(void) {
-    if (!g_currentSession.is_authenticated) {
-        gui_println("No active session to logout from.");
+// SEARCH --bench: the same query through the index and as a GREP of every
+// file below the working folder, each repeated for a quarter second
+static void search_bench(const Matcher* m, const char* query) {
+    GrepTarget* all = NULL;
+    int all_count = 0, all_cap = 0;
+    if (!grep_collect(g_cwd, TRUE, &all, &all_count, &all_cap)) {
+        gui_error("Not enough memory for the benchmark.");
+        free(all);
         return;
     }
-    
-    gui_printf("Logged out from %s", g_currentSession.username);
-    
-    logout_user();
-    
-    // Switch back to Public user
-    strncpy(g_currentUser, "Public", sizeof(g_currentUser) - 1);
-    Directory* public_dir = fs_find_child(g_root, "Public");
-    if (public_dir) {
-        g_home = public_dir;
-        g_cwd = public_dir;
+    gui_printf("Searching %d files for \"%s\":", all_count, query);
+    double scan_ms = 0.0;
+    for (int pass = 0; pass < 2; pass++) {
+        int matches = 0, candidates = 0;
+        long runs = 0;
+        double start = pf_seconds(), elapsed;
+        do {
+            GrepJob job;
+            memset(&job, 0, sizeof(job));
+            job.matcher = m;
+            job.count_only = TRUE;
+            GrepTarget* targets = all;
+            int count = all_count;
+            if (pass == 1) {
+                int doc_count = 0;
+                int* docs = search_candidates(query, &doc_count);
+                targets = docs ? search_targets(docs, doc_count, g_cwd, &count) : NULL;
+                free(docs);
+                if (!targets) break;
+                candidates = count;
+            }
+            job.targets = targets;
+            job.target_count = count;
+            if (grep_run(&job, pf_cpu_count())) matches = grep_finish(&job, FALSE);
+            if (targets != all) free(targets);
+            runs++;
+            elapsed = pf_seconds() - start;
+        } while (elapsed < 0.25);
+        double ms = runs ? elapsed * 1000.0 / (double)runs : 0.0;
+        if (pass == 0) {
+            scan_ms = ms;
+            gui_printf("  %-7s %9.3f ms  %d lines", "scan", ms, matches);
+        } else {
+            gui_printf("  %-7s %9.3f ms  %d lines  %d candidate files  %.1fx faster", "index", ms, matches,
+                       candidates, ms > 0.0 ? scan_ms / ms : 0.0);
+        }
     }
+    free(all);
 }
 
-static void cmd_chpasswd(const char* args) {
-    if (!g_currentSession.is_authenticated) {
-        gui_println("You must be logged in to change password.");
-        return;
+static void cmd_search(const char* args) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args ? args : "");
+    char* text = buf;
+    BOOL ignore_case = FALSE, bench = FALSE, stats = FALSE;
+    for (;;) {
+        char* rest = NULL;
+        char* word = text;
+        if (!parse_first_token(word, &rest)) { text = word; break; }
+        if (strcmp(word, "-i") == 0 || strcmp(word, "-I") == 0) {
+            ignore_case = TRUE;
+        } else if (strcmp(word, "--bench") == 0) {
+            bench = TRUE;
+        } else if (strcmp(word, "--stats") == 0) {
+            stats = TRUE;
+        } else {
+            if (*rest) word[strlen(word)] = ' ';
+            text = word;
+            break;
+        }
+        text = rest;
     }
-    
-    if (!args || !*args) {
-        gui_println("Usage: CHPASSWD <old_password> <new_password>");
+    strip_quotes(text);
+    if (stats) {
+        search_index_ready();
+        search_stats();
         return;
     }
-    
-    char old_password[128], new_password[128];
-    if (sscanf(args, "%127s %127s", old_password, new_password) != 2) {
-        gui_println("Usage: CHPASSWD <old_password> <new_password>");
+    if (!*text) {
+        gui_error("Usage: SEARCH [-i] <text> | SEARCH --stats | SEARCH --bench [-i] <text>");
+        gui_println("Finds text in the files below the current folder through a trigram index,");
+        gui_println("built on first use and kept current as files change. -i ignores case.");
+        gui_println("Example: SEARCH gui_printf");
         return;
     }
-    
-    if (strlen(new_password) < 6) {
-        gui_println("Password must be at least 6 characters long.");
+
+    const char* error = NULL;
+    Matcher* m = matcher_compile(text, MATCH_LITERAL | (ignore_case ? MATCH_IGNORE_CASE : 0), &error);
+    if (!m) {
+        gui_errorf("SEARCH: %s", error ? error : "invalid text");
         return;
     }
-    
-    if (change_password(g_currentSession.username, old_password, new_password)) {
-        gui_println("Password changed successfully.");
-    } else {
-        gui_println("Failed to change password. Check your current password.");
+    search_index_ready();
+    if (bench) {
+        search_bench(m, text);
+        matcher_free(m);
+        return;
     }
-}
 
-static void cmd_sessions(void) {
-    if (!has_privilege(1)) {
-        gui_println("Insufficient privileges. Admin access required.");
+    int doc_count = 0, target_count = 0;
+    int* docs = search_candidates(text, &doc_count);
+    GrepTarget* targets = docs ? search_targets(docs, doc_count, g_cwd, &target_count) : NULL;
+    free(docs);
+    if (!targets) {
+        gui_error("Not enough memory to search.");
+        matcher_free(m);
         return;
     }
-    
-    gui_println("Active Sessions:");
-    gui_println("===============");
-    
-    if (g_currentSession.is_authenticated) {
-        time_t now = time(NULL);
-        int session_duration = (int)(now - g_currentSession.session_start);
-        
-        gui_printf("User: %s | Session ID: %.8s... | Duration: %d seconds | Level: %d",
-                g_currentSession.username,
-                g_currentSession.session_id,
-                session_duration,
-                g_currentSession.privilege_level);
+    GrepJob job;
+    memset(&job, 0, sizeof(job));
+    job.matcher = m;
+    job.targets = targets;
+    job.target_count = target_count;
+    job.names = TRUE;
+    job.numbers = TRUE;
+    job.prefix = "";
+    char rel[1024];
+    vfs_rel_path(g_cwd, rel, sizeof(rel));
+    job.root_len = strlen(rel);
+    if (grep_run(&job, pf_cpu_count())) {
+        grep_finish(&job, TRUE);
     } else {
-        gui_println("No active sessions.");
-    }
+        gui_error("Not enough memory to search.");
+    }
+    free(targets);
+    matcher_free(m);
+}
+
+// ---------------- FIND by name ----------------
+// FIND <glob> looks files and folders up by name instead of listing the
+// tree. Every node under C:\USERS is an entry in a name index: each
+// distinct name (lower case, so FIND ignores case like the rest of the VFS)
+// lists the entries that have it, and each extension, the text after the
+// last '.', lists them again. A glob is compiled once and then matched
+// against each distinct name, not each node; a plain name or a "*.ext"
+// glob goes straight to its list. A glob with folders in it walks down
+// from the starting folder instead, entering only folders its automaton
+// can still match in.
+//
+// The first FIND builds the index, and vfs_changed keeps it current from
+// then on. Lists are unordered: an entry leaving one takes the last
+// entry's place, so every change costs the same however common the name.
+typedef struct {
+    Directory* dir;                       // the folder itself, or the file's folder
+    File* file;                           // NULL for a folder
+    int name;                             // its key in g_names.names
+    int ext;                              // its key in g_names.exts; -1 without a '.'
+    int name_at;                          // where it sits in those keys' lists
+    int ext_at;
+} NameNode;
+
+typedef struct {
+    char* text;                           // lower case
+    unsigned long long hash;
+    int* nodes;
+    int count;
+    int cap;
+} NameKey;
+
+typedef struct {
+    NameKey* keys;                        // never removed, only emptied
+    int count;
+    int cap;
+    int* slots;                           // open addressing over keys, key + 1; a power of two
+    int slot_cap;
+} NameTable;
+
+typedef struct {
+    BOOL ready;
+    NameNode* nodes;
+    int node_count;
+    int node_cap;
+    NameTable names;
+    NameTable exts;
+} NameIndex;
+
+static NameIndex g_names;
+
+static BOOL name_table_grow(NameTable* t) {
+    int cap = t->slot_cap ? t->slot_cap * 2 : 1024;
+    int* slots = (int*)calloc((size_t)cap, sizeof(int));
+    if (!slots) return FALSE;
+    for (int k = 0; k < t->count; k++) {
+        unsigned int s = (unsigned int)t->keys[k].hash & (unsigned int)(cap - 1);
+        while (slots[s]) s = (s + 1) & (unsigned int)(cap - 1);
+        slots[s] = k + 1;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->slot_cap = cap;
+    return TRUE;
 }
 
-static void cmd_theme(const char* args) {
-    if (!args || !*args) {
-        gui_println("Available themes:");
-        for (int i = 0; i < g_themeCount; i++) {
-            gui_printf("  %s", g_themes[i].name);
-        }
-        gui_println("Usage: THEME <theme_name>");
-        return;
-    }
-    
-    if (strcmp(args, "LIST") == 0) {
-        gui_println("Available themes:");
-        for (int i = 0; i < g_themeCount; i++) {
-            gui_printf("  %s", g_themes[i].name);
-        }
+// The key for text[0..len), case folded; -1 when there is none (or no memory)
+static int name_table_key(NameTable* t, const char* text, size_t len, BOOL create) {
+    char lower[MAX_NAME];
+    if (len >= sizeof(lower)) len = sizeof(lower) - 1;
+    for (size_t i = 0; i < len; i++) lower[i] = (char)tolower((unsigned char)text[i]);
+    lower[len] = '\0';
+    if (create && (t->count + 1) * 2 > t->slot_cap && !name_table_grow(t)) return -1;
+    if (!t->slot_cap) return -1;
+    unsigned long long hash = hash64(lower, len);
+    unsigned int s = (unsigned int)hash & (unsigned int)(t->slot_cap - 1);
+    for (; t->slots[s]; s = (s + 1) & (unsigned int)(t->slot_cap - 1)) {
+        const NameKey* key = &t->keys[t->slots[s] - 1];
+        if (key->hash == hash && strcmp(key->text, lower) == 0) return t->slots[s] - 1;
+    }
+    if (!create) return -1;
+    if (t->count == t->cap) {
+        int cap = t->cap ? t->cap * 2 : 1024;
+        NameKey* keys = (NameKey*)realloc(t->keys, sizeof(NameKey) * (size_t)cap);
+        if (!keys) return -1;
+        t->keys = keys;
+        t->cap = cap;
+    }
+    NameKey* key = &t->keys[t->count];
+    memset(key, 0, sizeof(*key));
+    key->text = _strdup(lower);
+    if (!key->text) return -1;
+    key->hash = hash;
+    t->slots[s] = ++t->count;
+    return t->count - 1;
+}
+
+// Where node now sits in key's list; -1 when out of memory
+static int name_key_add(NameKey* key, int node) {
+    if (key->count == key->cap) {
+        int cap = key->cap ? key->cap * 2 : 2;
+        int* nodes = (int*)realloc(key->nodes, sizeof(int) * (size_t)cap);
+        if (!nodes) return -1;
+        key->nodes = nodes;
+        key->cap = cap;
+    }
+    key->nodes[key->count] = node;
+    return key->count++;
+}
+
+static int* name_node_owner(const NameNode* n) {
+    return n->file ? &n->file->name_node : &n->dir->name_node;
+}
+
+static void name_node_add(Directory* dir, File* file) {
+    int* owner = file ? &file->name_node : &dir->name_node;
+    if (*owner) return;
+    const char* name = file ? file->name : dir->name;
+    const char* dot = strrchr(name, '.');
+    int key = name_table_key(&g_names.names, name, strlen(name), TRUE);
+    int ext = dot ? name_table_key(&g_names.exts, dot + 1, strlen(dot + 1), TRUE) : -1;
+    if (key < 0 || (dot && ext < 0)) return;
+    if (g_names.node_count == g_names.node_cap) {
+        int cap = g_names.node_cap ? g_names.node_cap * 2 : 1024;
+        NameNode* nodes = (NameNode*)realloc(g_names.nodes, sizeof(NameNode) * (size_t)cap);
+        if (!nodes) return;
+        g_names.nodes = nodes;
+        g_names.node_cap = cap;
+    }
+    int index = g_names.node_count;
+    NameNode* n = &g_names.nodes[index];
+    n->dir = dir;
+    n->file = file;
+    n->name = key;
+    n->ext = ext;
+    n->name_at = name_key_add(&g_names.names.keys[key], index);
+    n->ext_at = ext >= 0 ? name_key_add(&g_names.exts.keys[ext], index) : -1;
+    if (n->name_at < 0 || (ext >= 0 && n->ext_at < 0)) {
+        if (n->name_at >= 0) g_names.names.keys[key].count--;
         return;
     }
-    
-    apply_theme_silent(args, TRUE);
+    g_names.node_count++;
+    *owner = index + 1;
 }
 
-static void cmd_settings(const char* args) {
-    if (!args || !*args) {
-        gui_println("Current Settings:");
-        gui_println("=================");
-        gui_printf("Theme: %s", g_settings.current_theme);
-        gui_printf("Font: %s (%dpt)", g_settings.font_name, g_settings.font_size);
-        gui_printf("Auto Sync: %s", g_settings.auto_sync_enabled ? "Enabled" : "Disabled");
-        gui_println("");
-        gui_println("Quick Commands:");
-        gui_println("  THEME <name>     - Change theme (classic, white, dark)");
-        gui_println("  SETTINGS RESET   - Reset to defaults");
-        return;
-    }
-    
-    if (strcmp(args, "RESET") == 0) {
-        // Reset to defaults
-        strcpy(g_settings.current_theme, "classic");
-        g_settings.cursor_blink_speed = 500;
-        g_settings.font_size = 14;
-        strcpy(g_settings.font_name, "Consolas");
-        g_settings.auto_sync_enabled = TRUE;
-        g_settings.show_hidden_files = FALSE;
-        strcpy(g_settings.default_editor, "notepad");
-        g_settings.max_history_size = 100;
-        g_settings.sound_enabled = TRUE;
-        g_settings.window_width = 800;
-        g_settings.window_height = 600;
-        g_settings.require_auth_for_admin = TRUE;
-        g_settings.session_timeout = 30;
-        
-        save_settings();
-        apply_theme("classic");
-        gui_println("Settings reset to defaults.");
-    } else {
-        gui_println("Usage: SETTINGS [RESET]");
-    }
+// Takes entry at out of key's list, moving the last entry into its place
+static void name_key_remove(NameKey* key, int at, BOOL ext) {
+    int last = key->nodes[--key->count];
+    if (at == key->count) return;
+    key->nodes[at] = last;
+    if (ext) g_names.nodes[last].ext_at = at;
+    else g_names.nodes[last].name_at = at;
 }
 
-static void cmd_set(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: SET <setting> <value>");
-        gui_println("Available settings: current_theme, font_size, font_name, cursor_blink_speed, auto_sync_enabled, show_hidden_files, default_editor, window_width, window_height, session_timeout, require_auth_for_admin");
-        return;
-    }
-    
-    char setting[64], value[128];
-    if (sscanf(args, "%63s %127s", setting, value) != 2) {
-        gui_println("Usage: SET <setting> <value>");
-        return;
+static void name_node_drop(int* owner) {
+    if (!*owner) return;
+    int index = *owner - 1;
+    *owner = 0;
+    NameNode* n = &g_names.nodes[index];
+    name_key_remove(&g_names.names.keys[n->name], n->name_at, FALSE);
+    if (n->ext >= 0) name_key_remove(&g_names.exts.keys[n->ext], n->ext_at, TRUE);
+    // The last entry fills the gap, and whatever pointed at it follows
+    int last = --g_names.node_count;
+    if (index == last) return;
+    NameNode* moved = &g_names.nodes[last];
+    g_names.names.keys[moved->name].nodes[moved->name_at] = index;
+    if (moved->ext >= 0) g_names.exts.keys[moved->ext].nodes[moved->ext_at] = index;
+    *name_node_owner(moved) = index + 1;
+    *n = *moved;
+}
+
+static void name_add_tree(Directory* dir) {
+    if (dir != g_root) name_node_add(dir, NULL);
+    for (int i = 0; i < dir->file_count; i++) name_node_add(dir, dir->files[i]);
+    for (int i = 0; i < dir->child_count; i++) name_add_tree(dir->children[i]);
+}
+
+static void name_drop_tree(Directory* dir) {
+    name_node_drop(&dir->name_node);
+    for (int i = 0; i < dir->file_count; i++) name_node_drop(&dir->files[i]->name_node);
+    for (int i = 0; i < dir->child_count; i++) name_drop_tree(dir->children[i]);
+}
+
+static void name_index_ready(void) {
+    if (g_names.ready) return;
+    name_add_tree(g_root);
+    g_names.ready = TRUE;
+}
+
+static void name_index_changed(VfsChange what, Directory* dir, File* file) {
+    if (!g_names.ready) return;
+    switch (what) {
+        case VFS_FILE_ADDED:
+            if (search_attached(dir)) name_node_add(dir, file);
+            break;
+        case VFS_FILE_WRITTEN:
+            break;
+        case VFS_FILE_REMOVED:
+            name_node_drop(&file->name_node);
+            break;
+        case VFS_DIR_ADDED:
+            if (search_attached(dir)) name_add_tree(dir);
+            break;
+        case VFS_DIR_REMOVED:
+            name_drop_tree(dir);
+            break;
     }
-    
-    BOOL changed = FALSE;
-    
-    if (strcmp(setting, "current_theme") == 0) {
-        strncpy(g_settings.current_theme, value, sizeof(g_settings.current_theme) - 1);
-        apply_theme(value);
-        changed = TRUE;
-    } else if (strcmp(setting, "font_size") == 0) {
-        int size = atoi(value);
-        if (size >= 8 && size <= 72) {
-            g_settings.font_size = size;
-            changed = TRUE;
-        } else {
-            gui_println("Font size must be between 8 and 72.");
-            return;
-        }
-    } else if (strcmp(setting, "font_name") == 0) {
-        strncpy(g_settings.font_name, value, sizeof(g_settings.font_name) - 1);
-        changed = TRUE;
-    } else if (strcmp(setting, "cursor_blink_speed") == 0) {
-        int speed = atoi(value);
-        if (speed >= 100 && speed <= 2000) {
-            g_settings.cursor_blink_speed = speed;
-            changed = TRUE;
-        } else {
-            gui_println("Cursor speed must be between 100 and 2000 milliseconds.");
-            return;
-        }
-    } else if (strcmp(setting, "auto_sync_enabled") == 0) {
-        g_settings.auto_sync_enabled = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
-        changed = TRUE;
-    } else if (strcmp(setting, "show_hidden_files") == 0) {
-        g_settings.show_hidden_files = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
-        changed = TRUE;
-    } else if (strcmp(setting, "default_editor") == 0) {
-        strncpy(g_settings.default_editor, value, sizeof(g_settings.default_editor) - 1);
-        changed = TRUE;
-    } else if (strcmp(setting, "window_width") == 0) {
-        int width = atoi(value);
-        if (width >= 400 && width <= 2000) {
-            g_settings.window_width = width;
-            changed = TRUE;
-        } else {
-            gui_println("Window width must be between 400 and 2000 pixels.");
-            return;
-        }
-    } else if (strcmp(setting, "window_height") == 0) {
-        int height = atoi(value);
-        if (height >= 300 && height <= 1500) {
-            g_settings.window_height = height;
-            changed = TRUE;
-        } else {
-            gui_println("Window height must be between 300 and 1500 pixels.");
-            return;
-        }
-    } else if (strcmp(setting, "session_timeout") == 0) {
-        int timeout = atoi(value);
-        if (timeout >= 5 && timeout <= 480) {
-            g_settings.session_timeout = timeout;
-            changed = TRUE;
-        } else {
-            gui_println("Session timeout must be between 5 and 480 minutes.");
+}
+
+// RENAMEUSER renames a user's folder in place, the one rename the VFS has
+static void name_index_rename(Directory* dir, const char* name) {
+    name_node_drop(&dir->name_node);
+    snprintf(dir->name, sizeof(dir->name), "%s", name);
+    if (g_names.ready) name_node_add(dir, NULL);
+}
+
+// ---- Queries ----
+typedef struct {
+    Directory* parent;                    // the folder it is in
+    const char* name;
+    BOOL is_dir;
+} FindHit;
+
+typedef struct {
+    FindHit* hits;
+    int count;
+    int cap;
+    Directory* root;
+    int type;                             // 'f', 'd' or 0 for either
+    BOOL failed;
+} FindResults;
+
+static void find_hit(FindResults* r, Directory* parent, const char* name, BOOL is_dir) {
+    if (r->failed || (r->type == 'f' && is_dir) || (r->type == 'd' && !is_dir)) return;
+    if (r->count == r->cap) {
+        int cap = r->cap ? r->cap * 2 : 256;
+        FindHit* hits = (FindHit*)realloc(r->hits, sizeof(FindHit) * (size_t)cap);
+        if (!hits) {
+            r->failed = TRUE;
             return;
         }
-    } else if (strcmp(setting, "require_auth_for_admin") == 0) {
-        g_settings.require_auth_for_admin = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
-        changed = TRUE;
-    } else {
-        gui_println("Unknown setting. Use SETTINGS to see available options.");
-        return;
-    }
-    
-    if (changed) {
-        save_settings();
-        gui_printf("Setting '%s' updated to '%s'", setting, value);
+        r->hits = hits;
+        r->cap = cap;
     }
+    r->hits[r->count].parent = parent;
+    r->hits[r->count].name = name;
+    r->hits[r->count].is_dir = is_dir;
+    r->count++;
 }
 
-static void cmd_get(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: GET <setting>");
-        return;
+// Every entry in key's list that lies below the starting folder
+static void find_key_hits(FindResults* r, const NameKey* key, const IgnoreRule* rule) {
+    for (int i = 0; i < key->count; i++) {
+        const NameNode* n = &g_names.nodes[key->nodes[i]];
+        Directory* parent = n->file ? n->dir : n->dir->parent;
+        const char* name = n->file ? n->file->name : n->dir->name;
+        if (rule && !ignore_rule_match(rule, name)) continue;
+        Directory* up = parent;
+        while (up && up != r->root) up = up->parent;
+        if (up) find_hit(r, parent, name, n->file == NULL);
     }
-    
-    if (strcmp(args, "current_theme") == 0) {
-        gui_println(g_settings.current_theme);
-    } else if (strcmp(args, "font_size") == 0) {
-        gui_printf("%d", g_settings.font_size);
-    } else if (strcmp(args, "font_name") == 0) {
-        gui_println(g_settings.font_name);
-    } else if (strcmp(args, "cursor_blink_speed") == 0) {
-        gui_printf("%d", g_settings.cursor_blink_speed);
-    } else if (strcmp(args, "auto_sync_enabled") == 0) {
-        gui_println(g_settings.auto_sync_enabled ? "true" : "false");
-    } else if (strcmp(args, "show_hidden_files") == 0) {
-        gui_println(g_settings.show_hidden_files ? "true" : "false");
-    } else if (strcmp(args, "default_editor") == 0) {
-        gui_println(g_settings.default_editor);
-    } else if (strcmp(args, "window_width") == 0) {
-        gui_printf("%d", g_settings.window_width);
-    } else if (strcmp(args, "window_height") == 0) {
-        gui_printf("%d", g_settings.window_height);
-    } else if (strcmp(args, "session_timeout") == 0) {
-        gui_printf("%d", g_settings.session_timeout);
-    } else if (strcmp(args, "require_auth_for_admin") == 0) {
-        gui_println(g_settings.require_auth_for_admin ? "true" : "false");
+}
+
+// A glob holds no wildcards from text on
+static BOOL find_glob_literal(const char* text) {
+    return strpbrk(text, "*?[]\\") == NULL;
+}
+
+// A glob for a single name, through the index
+static void find_names(FindResults* r, const IgnoreRule* rule, const char* glob) {
+    name_index_ready();
+    const char* dot = strrchr(glob, '.');
+    if (find_glob_literal(glob)) {
+        int key = name_table_key(&g_names.names, glob, strlen(glob), FALSE);
+        if (key >= 0) find_key_hits(r, &g_names.names.keys[key], NULL);
+    } else if (dot && find_glob_literal(dot + 1)) {
+        // Whatever it matches ends in this extension
+        int key = name_table_key(&g_names.exts, dot + 1, strlen(dot + 1), FALSE);
+        if (key >= 0) find_key_hits(r, &g_names.exts.keys[key], rule);
     } else {
-        gui_println("Unknown setting. Use SETTINGS to see available options.");
+        for (int k = 0; k < g_names.names.count && !r->failed; k++) {
+            const NameKey* key = &g_names.names.keys[k];
+            if (key->count > 0 && ignore_rule_match(rule, key->text)) find_key_hits(r, key, NULL);
+        }
     }
 }
 
-static void cmd_setup_auth(const char* args) {
-    if (!args || !*args) {
-        gui_println("Usage: SETUP_AUTH <username> <password>");
-        gui_println("Sets up authentication for a user account.");
-        gui_println("Example: SETUP_AUTH Public mypassword123");
-        gui_println("         SETUP_AUTH Admin admin123");
-        return;
+// A glob with folders in it, matched on the way down from dir, where the
+// automaton is in states s
+static void find_walk(FindResults* r, const IgnoreRule* rule, Directory* dir, unsigned long long s) {
+    for (int i = 0; i < dir->file_count; i++) {
+        File* f = dir->files[i];
+        if (ignore_rule_accepts(rule, ignore_rule_feed(rule, s, f->name))) find_hit(r, dir, f->name, FALSE);
+    }
+    for (int i = 0; i < dir->child_count && !r->failed; i++) {
+        Directory* child = dir->children[i];
+        unsigned long long at = ignore_rule_feed(rule, s, child->name);
+        if (!at) continue;
+        if (ignore_rule_accepts(rule, at)) find_hit(r, dir, child->name, TRUE);
+        unsigned long long below = ignore_rule_feed(rule, at, "/");
+        if (below) find_walk(r, rule, child, below);
+    }
+}
+
+static int find_compare_hits(const void* a, const void* b) {
+    const FindHit* ha = (const FindHit*)a;
+    const FindHit* hb = (const FindHit*)b;
+    return search_compare_paths(ha->parent, ha->name, hb->parent, hb->name);
+}
+
+// FIND <glob> [path] [-type f|d], for cmd_find when nothing is piped to it
+static void find_by_name(const char* args) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", args ? args : "");
+    char* argv[8];
+    int argc = split_args(buf, argv, 8);
+    char* glob = NULL;
+    const char* path = NULL;
+    int type = 0;
+    BOOL usage = FALSE;
+    for (int i = 0; i < argc; i++) {
+        if (str_icmp(argv[i], "-type") == 0 && i + 1 < argc) {
+            char t = (char)tolower((unsigned char)argv[++i][0]);
+            if ((t == 'f' || t == 'd') && !argv[i][1]) type = t;
+            else usage = TRUE;
+        } else if (!glob) {
+            glob = argv[i];
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage = TRUE;
+        }
     }
-    
-    char username[64], password[64];
-    if (sscanf(args, "%63s %63s", username, password) != 2) {
-        gui_println("Usage: SETUP_AUTH <username> <password>");
+    if (usage || !glob || !*glob) {
+        gui_error("Usage: FIND <glob> [path] [-type f|d] | <cmd> | FIND [/I] [/V] [/C] <text>");
+        gui_println("Lists the files and folders below the current folder (or path) whose names");
+        gui_println("match glob: * ? [a-z], ignoring case. A glob with folders in it, like");
+        gui_println("src\\*\\*.c, matches their paths instead; ** spans any number of folders.");
+        gui_println("-type f keeps only files, -type d only folders.");
+        gui_println("Example: FIND *.c src");
         return;
     }
-    
-    // Check if user exists in filesystem
-    Directory* user_dir = fs_find_child(g_root, username);
-    if (!user_dir) {
-        gui_printf("Error: User '%s' does not exist.", username);
-        gui_println("Use ADDUSER to create the user first.");
+
+    Directory* root = g_cwd;
+    File* file = NULL;
+    if (path && (!vfs_resolve_path(path, &root, &file) || file)) {
+        gui_error("The system cannot find the path specified.");
         return;
     }
-    
-    // Check if user already has authentication
-    for (int i = 0; i < g_authCount; i++) {
-        if (strcmp(g_userAuth[i].username, username) == 0) {
-            gui_printf("User '%s' already has authentication setup.", username);
-            gui_println("Use CHPASSWD to change password.");
-            return;
-        }
+
+    // Folder separators either way, as WATCH takes them
+    for (char* p = glob; *p; p++) if (*p == '\\') *p = '/';
+    if (strncmp(glob, "./", 2) == 0) glob += 2;
+    while (*glob == '/') glob++;
+    IgnoreRule rule;
+    if (!*glob || !ignore_compile_glob(&rule, glob)) {
+        gui_error("Error: the pattern is too long.");
+        return;
     }
-    
-    // Create user account with authentication
-    if (create_user_account(username, password, 0)) { // Default privilege level 0
-        // Save authentication to user's Settings folder
-        char program_dir[1024];
-        get_main_project_dir(program_dir, sizeof(program_dir));
-        
-        char user_auth_file[1024];
-        snprintf(user_auth_file, sizeof(user_auth_file), "%s\\data\\USERS\\%s\\Settings\\auth.dat", program_dir, username);
-        
-        // Create Settings directory if it doesn't exist
-        char settings_dir[1024];
-        snprintf(settings_dir, sizeof(settings_dir), "%s\\data\\USERS\\%s\\Settings", program_dir, username);
-        CreateDirectoryA(settings_dir, NULL);
-        
-        // Save authentication data
-        FILE* f = fopen(user_auth_file, "w");
-        if (f) {
-            // Find the user in our auth array
-            for (int i = 0; i < g_authCount; i++) {
-                if (strcmp(g_userAuth[i].username, username) == 0) {
-                    fprintf(f, "USER:%s|%s|%s|%ld|%ld|%d|%ld|%d|%d\n",
-                        g_userAuth[i].username,
-                        g_userAuth[i].password_hash,
-                        g_userAuth[i].salt,
-                        g_userAuth[i].last_login,
-                        g_userAuth[i].password_changed,
-                        g_userAuth[i].failed_attempts,
-                        g_userAuth[i].locked_until,
-                        g_userAuth[i].privilege_level,
-                        g_userAuth[i].is_active ? 1 : 0);
-                    break;
-                }
-            }
-            fclose(f);
-        }
-        
-        // Also create a virtual file in the Settings folder
-        Directory* settings_dir_virtual = fs_find_child(user_dir, "Settings");
-        if (settings_dir_virtual) {
-            File* auth_file_virtual = fs_create_file("auth.dat");
-            if (auth_file_virtual) {
-                // Find the user in our auth array
-                for (int i = 0; i < g_authCount; i++) {
-                    if (strcmp(g_userAuth[i].username, username) == 0) {
-                        snprintf(auth_file_virtual->content, sizeof(auth_file_virtual->content),
-                            "USER:%s|%s|%s|%ld|%ld|%d|%ld|%d|%d",
-                            g_userAuth[i].username,
-                            g_userAuth[i].password_hash,
-                            g_userAuth[i].salt,
-                            g_userAuth[i].last_login,
-                            g_userAuth[i].password_changed,
-                            g_userAuth[i].failed_attempts,
-                            g_userAuth[i].locked_until,
-                            g_userAuth[i].privilege_level,
-                            g_userAuth[i].is_active ? 1 : 0);
-                        break;
-                    }
-                }
-                fs_add_file(settings_dir_virtual, auth_file_virtual);
-            }
-        }
-        
-        gui_printf("Authentication setup complete for user '%s'", username);
-        gui_println("You can now use LOGIN to authenticate before switching users.");
+
+    FindResults r;
+    memset(&r, 0, sizeof(r));
+    r.root = root;
+    r.type = type;
+    if (strchr(glob, '/')) {
+        find_walk(&r, &rule, root, ignore_closure(&rule, 1ULL));
     } else {
-        gui_println("Failed to setup authentication. Maximum accounts reached.");
+        find_names(&r, &rule, glob);
+    }
+    if (r.failed) {
+        gui_error("Not enough memory to list the matches.");
+        free(r.hits);
+        return;
     }
-}
 
-static BOOL process_command(char* input) {
-    char* arg = NULL;
-    if (!parse_first_token(input, &arg)) return TRUE;
-    if (str_icmp(input, "help") == 0) { cmd_help(); }
-    else if (str_icmp(input, "pwd") == 0) { cmd_pwd(); }
-    else if (str_icmp(input, "dir") == 0 || str_icmp(input, "ls") == 0) { cmd_dir(); }
-    else if (str_icmp(input, "mkdir") == 0 || str_icmp(input, "md") == 0) { cmd_mkdir(arg); }
-    else if (str_icmp(input, "touch") == 0) { cmd_touch(arg); }
-    else if (str_icmp(input, "del") == 0 || str_icmp(input, "delete") == 0) { cmd_del(arg); }
-    else if (str_icmp(input, "rmdir") == 0 || str_icmp(input, "rd") == 0) { cmd_rmdir(arg); }
-    else if (str_icmp(input, "softdel") == 0) { cmd_softdel(arg); }
-    else if (str_icmp(input, "restore") == 0) { cmd_restore(arg); }
-    else if (str_icmp(input, "trash") == 0) { cmd_trash(); }
-    else if (str_icmp(input, "emptytrash") == 0) { cmd_emptytrash(); }
-    else if (str_icmp(input, "type") == 0 || str_icmp(input, "cat") == 0) { cmd_type(arg); }
-    else if (str_icmp(input, "write") == 0) { cmd_write(arg); }
-    else if (str_icmp(input, "writeln") == 0) { cmd_writeln(arg); }
-    else if (str_icmp(input, "writecode") == 0) { cmd_writecode(arg); }
-    else if (str_icmp(input, "editcode") == 0) { cmd_editcode(arg); }
-    else if (str_icmp(input, "append") == 0) { cmd_append(arg); }
-    else if (str_icmp(input, "cd") == 0) { cmd_cd(arg); }
-    else if (str_icmp(input, "echo") == 0) { cmd_echo(arg); }
-    else if (str_icmp(input, "savefs") == 0) { cmd_savefs(arg); }
-    else if (str_icmp(input, "user") == 0) { cmd_user(arg); }
-    else if (str_icmp(input, "adduser") == 0) { cmd_adduser(arg); }
-    else if (str_icmp(input, "renameuser") == 0) { cmd_renameuser(arg); }
-    else if (str_icmp(input, "textcolor") == 0) { cmd_textcolor(arg); }
-    else if (str_icmp(input, "cursorcolor") == 0) { cmd_cursorcolor(arg); }
-    else if (str_icmp(input, "whoami") == 0) { cmd_whoami(); }
-    else if (str_icmp(input, "users") == 0) { cmd_users(); }
-    else if (str_icmp(input, "fileview") == 0) { cmd_fileview(); }
-    else if (str_icmp(input, "sync") == 0) { cmd_sync(); }
-    else if (str_icmp(input, "save") == 0) { fs_save_to_disk(); }
-    else if (str_icmp(input, "ide") == 0) { 
-        if (arg && str_icmp(arg, "list") == 0) { cmd_ide_list(); }
-        else if (arg && str_icmp(arg, "help") == 0) { cmd_ide_help(); }
-        else { cmd_ide(arg); }
-    }
-    else if (str_icmp(input, "git") == 0) {
-        // Simple Git command handling
-        if (!arg || !*arg) {
-            gui_println("Usage: GIT <command> [options]");
-            gui_println("Type 'HELP' to see all available Git commands.");
-            return TRUE;
-        }
-        
-        // Parse the Git command and arguments properly
-        char git_cmd[64];
-        char* git_args = NULL;
-        
-        // Find the first space to separate command from arguments
-        char* space_pos = strchr(arg, ' ');
-        if (space_pos) {
-            // Copy command part (before first space)
-            size_t cmd_len = space_pos - arg;
-            if (cmd_len >= sizeof(git_cmd)) cmd_len = sizeof(git_cmd) - 1;
-            strncpy(git_cmd, arg, cmd_len);
-            git_cmd[cmd_len] = '\0';
-            
-            // Get arguments part (after first space)
-            git_args = space_pos + 1;
-            while (*git_args && isspace(*git_args)) git_args++;
-        } else {
-            // No arguments, just the command
-            strncpy(git_cmd, arg, sizeof(git_cmd) - 1);
-            git_cmd[sizeof(git_cmd) - 1] = '\0';
-        }
-        
-        // Convert command to uppercase for comparison
-        for (char* p = git_cmd; *p; p++) {
-            *p = toupper(*p);
-        }
-        
-        if (strcmp(git_cmd, "INIT") == 0) { cmd_git_init(); }
-        else if (strcmp(git_cmd, "CLONE") == 0) { cmd_git_clone(git_args); }
-        else if (strcmp(git_cmd, "ADD") == 0) { cmd_git_add(git_args); }
-        else if (strcmp(git_cmd, "COMMIT") == 0) { cmd_git_commit(git_args); }
-        else if (strcmp(git_cmd, "STATUS") == 0) { cmd_git_status(); }
-        else if (strcmp(git_cmd, "LOG") == 0) { cmd_git_log(); }
-        else if (strcmp(git_cmd, "DIFF") == 0) { cmd_git_diff(); }
-        else if (strcmp(git_cmd, "BRANCH") == 0) { cmd_git_branch(git_args); }
-        else if (strcmp(git_cmd, "REMOTE") == 0) { cmd_git_remote(git_args); }
-        else if (strcmp(git_cmd, "CHECKOUT") == 0) { cmd_git_checkout(git_args); }
-        else if (strcmp(git_cmd, "MERGE") == 0) { cmd_git_merge(git_args); }
-        else if (strcmp(git_cmd, "PULL") == 0) { cmd_git_pull(); }
-        else if (strcmp(git_cmd, "PUSH") == 0) { cmd_git_push(); }
-        else if (strcmp(git_cmd, "FETCH") == 0) { cmd_git_fetch(); }
-        else if (strcmp(git_cmd, "RESET") == 0) { cmd_git_reset(git_args); }
-        else if (strcmp(git_cmd, "RM") == 0) { cmd_git_rm(git_args); }
-        else if (strcmp(git_cmd, "CLEAN") == 0) { cmd_git_clean(git_args); }
-        else if (strcmp(git_cmd, "STASH") == 0) { cmd_git_stash(git_args); }
-        else if (strcmp(git_cmd, "TAG") == 0) { cmd_git_tag(git_args); }
-        else if (strcmp(git_cmd, "CONFIG") == 0) { cmd_git_config(git_args); }
-        else if (strcmp(git_cmd, "HELP") == 0) { cmd_git_help(git_args); }
-        else if (strcmp(git_cmd, "VERSION") == 0) { cmd_git_version(); }
-        else if (strcmp(git_cmd, "TEST") == 0) { cmd_git_test(); }
-        else if (strcmp(git_cmd, "PWD") == 0) { cmd_git_pwd(); }
-        else {
-            char msg[256];
-            snprintf(msg, sizeof(msg), "Git command '%s' not recognized.", git_cmd);
-            gui_println(msg);
-            gui_println("Type 'HELP' to see all available Git commands.");
-        }
-    }
-    // Project Detection Commands
-    else if (str_icmp(input, "project_type") == 0) { cmd_project_type(); }
-    else if (str_icmp(input, "project_info") == 0) { cmd_project_info(); }
-    // Test command
-    else if (str_icmp(input, "test") == 0) { gui_println("Test command works!"); }
-    // npm/Node.js Commands
-    else if (str_icmp(input, "npm") == 0) {
-        if (!arg) { cmd_npm_help(); }
-        else if (str_icmp(arg, "install") == 0) { 
-            // Get remaining arguments after install
-            char* remaining = strstr(input, "install");
-            if (!remaining) remaining = strstr(input, "INSTALL");
-            if (remaining) {
-                remaining += 7; // Skip "install"
-                while (*remaining == ' ') remaining++; // Skip spaces
-                cmd_npm_install(remaining);
-            } else {
-                cmd_npm_install("");
-            }
-        }
-        else if (str_icmp(arg, "add") == 0) { 
-            char* remaining = strstr(input, "add");
-            if (!remaining) remaining = strstr(input, "ADD");
-            if (remaining) {
-                remaining += 3;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_add(remaining);
-            } else {
-                cmd_npm_add("");
-            }
-        }
-        else if (str_icmp(arg, "remove") == 0) { 
-            char* remaining = strstr(input, "remove");
-            if (!remaining) remaining = strstr(input, "REMOVE");
-            if (remaining) {
-                remaining += 6;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_remove(remaining);
-            } else {
-                cmd_npm_remove("");
-            }
-        }
-        else if (str_icmp(arg, "update") == 0) { 
-            char* remaining = strstr(input, "update");
-            if (!remaining) remaining = strstr(input, "UPDATE");
-            if (remaining) {
-                remaining += 6;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_update(remaining);
-            } else {
-                cmd_npm_update("");
-            }
-        }
-        else if (str_icmp(arg, "audit") == 0) { 
-            char* remaining = strstr(input, "audit");
-            if (!remaining) remaining = strstr(input, "AUDIT");
-            if (remaining) {
-                remaining += 5;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_audit(remaining);
-            } else {
-                cmd_npm_audit("");
-            }
-        }
-        else if (str_icmp(arg, "outdated") == 0) { cmd_npm_outdated(); }
-        else if (str_icmp(arg, "run") == 0) { 
-            char* remaining = strstr(input, "run");
-            if (!remaining) remaining = strstr(input, "RUN");
-            if (remaining) {
-                remaining += 3;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_run(remaining);
-            } else {
-                cmd_npm_run("");
-            }
-        }
-        else if (str_icmp(arg, "start") == 0) { cmd_npm_start(); }
-        else if (str_icmp(arg, "build") == 0) { cmd_npm_build(); }
-        else if (str_icmp(arg, "test") == 0) { cmd_npm_test(); }
-        else if (str_icmp(arg, "dev") == 0) { cmd_npm_dev(); }
-        else if (str_icmp(arg, "init") == 0) { 
-            char* remaining = strstr(input, "init");
-            if (!remaining) remaining = strstr(input, "INIT");
-            if (remaining) {
-                remaining += 4;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_init(remaining);
-            } else {
-                cmd_npm_init("");
-            }
-        }
-        else if (str_icmp(arg, "publish") == 0) { 
-            char* remaining = strstr(input, "publish");
-            if (!remaining) remaining = strstr(input, "PUBLISH");
-            if (remaining) {
-                remaining += 7;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_publish(remaining);
-            } else {
-                cmd_npm_publish("");
-            }
-        }
-        else if (str_icmp(arg, "link") == 0) { 
-            char* remaining = strstr(input, "link");
-            if (!remaining) remaining = strstr(input, "LINK");
-            if (remaining) {
-                remaining += 4;
-                while (*remaining == ' ') remaining++;
-                cmd_npm_link(remaining);
-            } else {
-                cmd_npm_link("");
-            }
-        }
-        else if (str_icmp(arg, "list") == 0) { cmd_npm_list(); }
-        else if (str_icmp(arg, "help") == 0) { cmd_npm_help(); }
-        else { cmd_npm_help(); }
-    }
-    // React Development Commands
-    else if (str_icmp(input, "react") == 0) {
-        if (!arg) { gui_println("Usage: REACT <command> [args]"); }
-        else if (str_icmp(arg, "create") == 0) { 
-            char* remaining = strstr(input, "create");
-            if (!remaining) remaining = strstr(input, "CREATE");
-            if (remaining) {
-                remaining += 6;
-                while (*remaining == ' ') remaining++;
-                cmd_react_create(remaining);
-            } else {
-                cmd_react_create("");
-            }
-        }
-        else if (str_icmp(arg, "component") == 0) { 
-            char* remaining = strstr(input, "component");
-            if (!remaining) remaining = strstr(input, "COMPONENT");
-            if (remaining) {
-                remaining += 9;
-                while (*remaining == ' ') remaining++;
-                cmd_react_component(remaining);
-            } else {
-                cmd_react_component("");
-            }
-        }
-        else if (str_icmp(arg, "start") == 0) { cmd_react_start(); }
-        else if (str_icmp(arg, "build") == 0) { cmd_react_build(); }
-        else if (str_icmp(arg, "test") == 0) { cmd_react_test(); }
-        else if (str_icmp(arg, "eject") == 0) { cmd_react_eject(); }
-        else if (str_icmp(arg, "lint") == 0) { cmd_react_lint(); }
-        else { gui_println("Unknown React command. Use REACT HELP for available commands."); }
-    }
-    // C++ and Python Execution Commands
-    else if (str_icmp(input, "run") == 0) { cmd_run(arg); }
-    else if (str_icmp(input, "compile") == 0) { cmd_compile(arg); }
-    // System Maintenance Commands
-    else if (str_icmp(input, "system_ls") == 0) { cmd_system_ls(arg); }
-    else if (str_icmp(input, "system_cd") == 0) { cmd_system_cd(arg); }
-    else if (str_icmp(input, "system_cat") == 0) { cmd_system_cat(arg); }
-    else if (str_icmp(input, "system_copy") == 0) { cmd_system_copy(arg); }
-    else if (str_icmp(input, "system_exit") == 0) { cmd_system_exit(); }
-    else if (str_icmp(input, "system_log") == 0) { cmd_system_log(); }
-    // Authentication Commands
-    else if (str_icmp(input, "login") == 0) { cmd_login(arg); }
-    else if (str_icmp(input, "logout") == 0) { cmd_logout(); }
-    else if (str_icmp(input, "chpasswd") == 0) { cmd_chpasswd(arg); }
-    else if (str_icmp(input, "sessions") == 0) { cmd_sessions(); }
-    // Theme & Settings Commands
-    else if (str_icmp(input, "theme") == 0) { cmd_theme(arg); }
-    else if (str_icmp(input, "settings") == 0) { cmd_settings(arg); }
-    else if (str_icmp(input, "set") == 0) { cmd_set(arg); }
-    else if (str_icmp(input, "get") == 0) { cmd_get(arg); }
-    else if (str_icmp(input, "setup_auth") == 0) { cmd_setup_auth(arg); }
-    else if (str_icmp(input, "cls") == 0 || str_icmp(input, "clear") == 0) { gui_clear(); }
-    else if (str_icmp(input, "exit") == 0 || str_icmp(input, "quit") == 0) { return FALSE; }
-    else { gui_println("'COMMAND' is not recognized."); }
-    return TRUE;
+    if (r.count > 0) qsort(r.hits, (size_t)r.count, sizeof(FindHit), find_compare_hits);
+    char rel[1024];
+    vfs_rel_path(root, rel, sizeof(rel));
+    size_t root_len = strlen(rel);
+    const char* prefix = path ? path : "";
+    for (int i = 0; i < r.count; i++) {
+        const FindHit* h = &r.hits[i];
+        vfs_rel_path(h->parent, rel, sizeof(rel));
+        const char* below = rel + (strlen(rel) >= root_len ? root_len : strlen(rel));
+        if (*below == '\\') below++;
+        gui_printf("%s%s%s%s%s%s", prefix, (*prefix && *below) ? "\\" : "", below,
+                   (*prefix || *below) ? "\\" : "", h->name, h->is_dir ? "\\" : "");
+    }
+    free(r.hits);
 }
 
 // Scroll handling functions (using built-in edit control)
@@ -4550,21 +10481,21 @@ static BOOL process_command(char* input) {
 // User management functions
 static void cmd_renameuser(const char* args) {
     if (!args || !*args) {
-        gui_println("Usage: RENAMEUSER <old_name> <new_name>");
+        gui_error("Usage: RENAMEUSER <old_name> <new_name>");
         gui_println("Example: RENAMEUSER Developer Coder");
         return;
     }
     
     char oldName[64], newName[64];
     if (sscanf(args, "%63s %63s", oldName, newName) != 2) {
-        gui_println("Usage: RENAMEUSER <old_name> <new_name>");
+        gui_error("Usage: RENAMEUSER <old_name> <new_name>");
         return;
     }
     
     // Validate new name (letters, numbers, underscores only)
     for (int i = 0; newName[i]; i++) {
         if (!isalnum(newName[i]) && newName[i] != '_') {
-            gui_println("Error: Username can only contain letters, numbers, and underscores");
+            gui_error("Error: Username can only contain letters, numbers, and underscores");
             return;
         }
     }
@@ -4579,14 +10510,14 @@ static void cmd_renameuser(const char* args) {
     }
     
     if (!oldUserFound) {
-        gui_println("Error: User not found");
+        gui_error("Error: User not found");
         return;
     }
     
     // Check if new name already exists
     for (int i = 0; i < g_authCount; i++) {
         if (strcmp(g_userAuth[i].username, newName) == 0) {
-            gui_println("Error: Username already exists");
+            gui_error("Error: Username already exists");
             return;
         }
     }
@@ -4609,7 +10540,7 @@ static void cmd_renameuser(const char* args) {
             // Update virtual filesystem - rename the user directory
             Directory* old_user_dir = fs_find_child(g_root, oldName);
             if (old_user_dir) {
-                strcpy(old_user_dir->name, newName);
+                name_index_rename(old_user_dir, newName);
             }
             
             // Update home directory if it's the current user
@@ -4631,7 +10562,7 @@ static void cmd_renameuser(const char* args) {
             snprintf(new_dir, sizeof(new_dir), "%s\\data\\USERS\\%s", program_dir, newName);
             
             // Rename the directory
-            if (MoveFileA(old_dir, new_dir)) {
+            if (pf_rename(old_dir, new_dir)) {
                 gui_printf("User directory renamed from %s to %s\n", oldName, newName);
             } else {
                 gui_printf("Warning: Could not rename user directory, but user data updated\n");
@@ -4648,13 +10579,13 @@ static void cmd_renameuser(const char* args) {
         }
     }
     
-    gui_println("Error: User not found");
+    gui_error("Error: User not found");
 }
 
 // Color customization commands
 static void cmd_textcolor(const char* args) {
     if (!args || !*args) {
-        gui_println("Usage: TEXTCOLOR <color>");
+        gui_error("Usage: TEXTCOLOR <color>");
         gui_println("Colors: red, green, blue, yellow, cyan, magenta, white, black, orange, purple");
         gui_println("Or use hex: TEXTCOLOR #FF0000 (for red)");
         gui_println("Use 'default' to use theme color");
@@ -4667,7 +10598,7 @@ static void cmd_textcolor(const char* args) {
         g_settings.custom_text_color = 0;
         gui_println("Text color reset to theme default");
         save_settings();
-        InvalidateRect(g_hOut, NULL, TRUE);
+        gui_refresh();
         return;
     }
     
@@ -4687,7 +10618,7 @@ static void cmd_textcolor(const char* args) {
         else if (strcmp(args, "orange") == 0) color = RGB(255, 165, 0);
         else if (strcmp(args, "purple") == 0) color = RGB(128, 0, 128);
         else {
-            gui_println("Invalid color. Use: red, green, blue, yellow, cyan, magenta, white, black, orange, purple");
+            gui_error("Invalid color. Use: red, green, blue, yellow, cyan, magenta, white, black, orange, purple");
             return;
         }
     }
@@ -4695,12 +10626,12 @@ static void cmd_textcolor(const char* args) {
     g_settings.custom_text_color = color;
     save_settings();
     gui_printf("Text color changed to %s\n", args);
-    InvalidateRect(g_hOut, NULL, TRUE);
+    gui_refresh();
 }
 
 static void cmd_cursorcolor(const char* args) {
     if (!args || !*args) {
-        gui_println("Usage: CURSORCOLOR <color>");
+        gui_error("Usage: CURSORCOLOR <color>");
         gui_println("Colors: red, green, blue, yellow, cyan, magenta, white, black, orange, purple");
         gui_println("Or use hex: CURSORCOLOR #FF0000 (for red)");
         gui_println("Use 'default' to use theme color");
@@ -4713,7 +10644,7 @@ static void cmd_cursorcolor(const char* args) {
         g_settings.custom_cursor_color = 0;
         gui_println("Cursor color reset to theme default");
         save_settings();
-        InvalidateRect(g_hOut, NULL, TRUE);
+        gui_refresh();
         return;
     }
     
@@ -4733,287 +10664,27 @@ static void cmd_cursorcolor(const char* args) {
         else if (strcmp(args, "orange") == 0) color = RGB(255, 165, 0);
         else if (strcmp(args, "purple") == 0) color = RGB(128, 0, 128);
         else {
-            gui_println("Invalid color. Use: red, green, blue, yellow, cyan, magenta, white, black, orange, purple");
-            return;
-        }
-    }
-    
-    g_settings.custom_cursor_color = color;
-    save_settings();
-    gui_printf("Cursor color changed to %s\n", args);
-    InvalidateRect(g_hOut, NULL, TRUE);
-}
-
-// Simplified output edit procedure
-static LRESULT CALLBACK OutputEditProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    switch (msg) {
-        case WM_GETDLGCODE:
-            return DLGC_WANTALLKEYS | DLGC_WANTCHARS;
-        case WM_MOUSEWHEEL: {
-            int delta = GET_WHEEL_DELTA_WPARAM(wParam);
-            int lines = 3; // Scroll 3 lines at a time
-            
-            if (delta > 0) {
-                // Scroll up
-                for (int i = 0; i < lines; i++) {
-                    SendMessageA(hWnd, EM_SCROLL, SB_LINEUP, 0);
-                }
-            } else if (delta < 0) {
-                // Scroll down
-                for (int i = 0; i < lines; i++) {
-                    SendMessageA(hWnd, EM_SCROLL, SB_LINEDOWN, 0);
-                }
-            }
-                    return 0;
-                }
-        case WM_PAINT: {
-            // Let default paint happen first
-            LRESULT result = CallWindowProcA(g_OutputPrevProc, hWnd, msg, wParam, lParam);
-            return result;
-            }
-        case WM_SETFOCUS: {
-            int len = GetWindowTextLengthA(hWnd);
-            SendMessageA(hWnd, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-                return 0;
-            }
-        case WM_KEYDOWN: {
-            // Handle arrow keys for command history
-            if (wParam == VK_UP) {
-                navigate_history(-1); // Go up in history
-                return 0;
-            } else if (wParam == VK_DOWN) {
-                navigate_history(1); // Go down in history
-                return 0;
-            }
-            
-            // Ensure cursor stays at end when typing
-            int len = GetWindowTextLengthA(hWnd);
-            SendMessageA(hWnd, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-            return CallWindowProcA(g_OutputPrevProc, hWnd, msg, wParam, lParam);
-        }
-        case WM_LBUTTONDOWN:
-        case WM_RBUTTONDOWN: {
-            int len = GetWindowTextLengthA(hWnd);
-            SendMessageA(hWnd, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-            return 0;
-        }
-        case WM_CHAR: {
-            // Handle edit mode
-            if (g_editMode) {
-                if (wParam == 19) { // Ctrl+S (save)
-                    // Get the current text from the edit control
-                    int totalLen = GetWindowTextLengthA(hWnd);
-                    char* all = (char*)malloc((size_t)totalLen + 1);
-                    if (all) {
-                        GetWindowTextA(hWnd, all, totalLen + 1);
-                        
-                        // Find the content after the edit mode start
-                        char* editStart = strstr(all, "Ready to edit. Start typing...");
-                        if (editStart) {
-                            editStart = strstr(editStart, "\r\n");
-                            if (editStart) {
-                                editStart += 2; // Skip \r\n
-                                
-                                // Copy the edited content
-                                strncpy(g_editFile->content, editStart, MAX_FILE_SIZE - 1);
-                                g_editFile->content[MAX_FILE_SIZE - 1] = '\0';
-                                
-                                // Save to real filesystem
-                                char program_dir[1024];
-                                get_main_project_dir(program_dir, sizeof(program_dir));
-                                
-                                char virtual_path[1024];
-                                fs_print_path(g_cwd, virtual_path, sizeof(virtual_path));
-                                
-                                char real_path[1024];
-                                const char* profiles_pos = strstr(virtual_path, "\\USERS\\");
-                                if (profiles_pos) {
-                                    snprintf(real_path, sizeof(real_path), "%s\\data%s", program_dir, profiles_pos);
-                                } else {
-                                    snprintf(real_path, sizeof(real_path), "%s\\data\\USERS\\%s", program_dir, g_currentUser);
-                                }
-                                
-                                char full_real_path[1024];
-                                join_path(full_real_path, sizeof(full_real_path), real_path, g_editFile->name);
-                                
-                                HANDLE hFile = CreateFileA(full_real_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-                                if (hFile != INVALID_HANDLE_VALUE) {
-                                    DWORD bytesWritten;
-                                    WriteFile(hFile, g_editFile->content, strlen(g_editFile->content), &bytesWritten, NULL);
-                                    CloseHandle(hFile);
-                                }
-                                
-                                gui_println("File saved successfully!");
-                            }
-                        }
-                        free(all);
-                    }
-                    
-                    g_editMode = 0;
-                    g_editFile = NULL;
-                    gui_show_prompt_and_arm_input();
-                    return 0;
-                } else if (wParam == 3) { // Ctrl+C (cancel)
-                    gui_println("Edit cancelled.");
-                    g_editMode = 0;
-                    g_editFile = NULL;
-                    gui_show_prompt_and_arm_input();
-                    return 0;
-                }
-                // For all other characters, let the normal display handle them
-            }
-            
-            // Normal command mode
-            if (wParam == '\r' || wParam == '\n') {
-                int totalLen = GetWindowTextLengthA(hWnd);
-                int cmdLen = totalLen - g_inputStart;
-                if (cmdLen < 0) cmdLen = 0;
-                char buf[1024];
-                int copyLen = cmdLen < (int)sizeof(buf) - 1 ? cmdLen : (int)sizeof(buf) - 1;
-                if (copyLen > 0) {
-                    char* all = (char*)malloc((size_t)totalLen + 1);
-                    if (!all) return 0;
-                    GetWindowTextA(hWnd, all, totalLen + 1);
-                    memcpy(buf, all + g_inputStart, (size_t)copyLen);
-                    buf[copyLen] = '\0';
-                    free(all);
-                } else {
-                    buf[0] = '\0';
-                }
-
-                gui_append("\r\n");
-                
-                // Add command to history if it's not empty
-                if (strlen(buf) > 0) {
-                    add_to_history(buf);
-                }
-                
-                if (!process_command(buf)) {
-                    PostMessage(GetParent(hWnd), WM_CLOSE, 0, 0);
-                    return 0;
-                }
-                gui_show_prompt_and_arm_input();
-                return 0;
-            }
-            
-            DWORD start = 0, end = 0;
-            SendMessageA(hWnd, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
-            if ((int)start < g_inputStart) {
-                SendMessageA(hWnd, EM_SETSEL, (WPARAM)g_inputStart, (LPARAM)g_inputStart);
-                return 0;
-            }
-            
-            return CallWindowProcA(g_OutputPrevProc, hWnd, msg, wParam, lParam);
-        }
-    }
-    return CallWindowProcA(g_OutputPrevProc, hWnd, msg, wParam, lParam);
-}
-
-static void create_child_controls(HWND hWnd) {
-    DWORD outStyle = WS_CHILD | WS_VISIBLE | ES_MULTILINE | ES_AUTOVSCROLL | ES_AUTOHSCROLL | WS_TABSTOP;
-    g_hOut = CreateWindowExA(0, "EDIT", "", outStyle, 0, 0, 800, 500, hWnd, (HMENU)1001, GetModuleHandle(NULL), NULL);
-
-    g_hMono = CreateFontA(18, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, FIXED_PITCH | FF_DONTCARE, "Consolas");
-    SendMessageA(g_hOut, WM_SETFONT, (WPARAM)g_hMono, TRUE);
-
-    g_OutputPrevProc = (WNDPROC)SetWindowLongPtrA(g_hOut, GWLP_WNDPROC, (LONG_PTR)OutputEditProc);
-    SetFocus(g_hOut);
-}
-
-static void layout_children(HWND hWnd) {
-    RECT rc; GetClientRect(hWnd, &rc);
-    MoveWindow(g_hOut, 0, 0, rc.right, rc.bottom, TRUE);
-}
-
-static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    switch (msg) {
-        case WM_CTLCOLOREDIT:
-        case WM_CTLCOLORSTATIC: {
-            HDC hdc = (HDC)wParam;
-            
-            // Get current theme colors
-            COLORREF text_color = RGB(0,255,0);  // Default green
-            COLORREF bg_color = RGB(0,0,0);      // Default black
-            
-            for (int i = 0; i < g_themeCount; i++) {
-                if (strcmp(g_themes[i].name, g_settings.current_theme) == 0) {
-                    text_color = g_themes[i].text_color;
-                    bg_color = g_themes[i].bg_color;
-                    break;
-                }
-            }
-            
-            // Use custom text color if set
-            if (g_settings.custom_text_color != 0) {
-                text_color = g_settings.custom_text_color;
-            }
-            
-            SetTextColor(hdc, text_color);
-            SetBkColor(hdc, bg_color);
-            
-            // Recreate brush with current theme color
-            if (g_hbrBlack) DeleteObject(g_hbrBlack);
-            g_hbrBlack = CreateSolidBrush(bg_color);
-            return (LRESULT)g_hbrBlack;
-        }
-        case WM_ERASEBKGND: {
-            HDC hdc = (HDC)wParam;
-            RECT rc; GetClientRect(hWnd, &rc);
-            
-            // Get current theme background color
-            COLORREF bg_color = RGB(0,0,0);  // Default black
-            for (int i = 0; i < g_themeCount; i++) {
-                if (strcmp(g_themes[i].name, g_settings.current_theme) == 0) {
-                    bg_color = g_themes[i].bg_color;
-                    break;
-                }
-            }
-            
-            // Recreate brush with current theme color
-            if (g_hbrBlack) DeleteObject(g_hbrBlack);
-            g_hbrBlack = CreateSolidBrush(bg_color);
-            FillRect(hdc, &rc, g_hbrBlack);
-            return 1;
+            gui_error("Invalid color. Use: red, green, blue, yellow, cyan, magenta, white, black, orange, purple");
+            return;
         }
-        case WM_CREATE:
-            create_child_controls(hWnd);
-            fs_init();
-            init_ide_configs();
-            layout_children(hWnd);
-            // Apply theme after GUI is fully initialized
-            apply_theme(g_settings.current_theme);
-            
-            // Show title at top left, above command prompt
-            gui_println("NEXUS TERMINAL v5.0");
-            gui_println("");
-            
-            // Then show command prompt
-            gui_show_prompt_and_arm_input();
-            
-            // Force initial cursor draw
-            InvalidateRect(g_hOut, NULL, FALSE);
-            return 0;
-        case WM_ACTIVATE:
-            if (LOWORD(wParam) != WA_INACTIVE && g_hOut) SetFocus(g_hOut);
-            return 0;
-        case WM_SIZE:
-            layout_children(hWnd);
-            return 0;
-        case WM_TIMER:
-            return 0;
-        case WM_DESTROY:
-            // Auto-save filesystem before closing
-            fs_save_to_disk();
-            
-            if (g_hbrBlack) { DeleteObject(g_hbrBlack); g_hbrBlack = NULL; }
-            PostQuitMessage(0);
-            return 0;
     }
-    return DefWindowProc(hWnd, msg, wParam, lParam);
+    
+    g_settings.custom_cursor_color = color;
+    save_settings();
+    gui_printf("Cursor color changed to %s\n", args);
+    gui_refresh();
 }
 
 // ================ NPM/NODE.JS FUNCTIONS ================
 
+static void system_command_done(Job* job, int exit_code) {
+    if (exit_code == 0) {
+        gui_printf("Command completed successfully (%s).", job_cost(job));
+    } else {
+        gui_errorf("Command failed with exit code: %d (%s)", exit_code, job_cost(job));
+    }
+}
+
 static void execute_system_command(const char* command, const char* args) {
     char full_command[1024];
     if (args && strlen(args) > 0) {
@@ -5051,64 +10722,35 @@ static void execute_system_command(const char* command, const char* args) {
         }
     }
     
-    // Execute the command using CreateProcessA to hide the console window
-    STARTUPINFOA si = {0};
-    PROCESS_INFORMATION pi = {0};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE; // Hide the window
+    // Check if this is a long-running command (like npm dev, npm start)
+    int is_long_running = 0;
+    if (strstr(full_command, "npm dev") || strstr(full_command, "npm start") || 
+        strstr(full_command, "npm run dev") || strstr(full_command, "npm run start")) {
+        is_long_running = 1;
+    }
     
-    char cmd_line[1024];
-    snprintf(cmd_line, sizeof(cmd_line), "cmd.exe /c %s", full_command);
-    
-    BOOL success = CreateProcessA(
-        NULL,           // Application name
-        cmd_line,       // Command line
-        NULL,           // Process security attributes
-        NULL,           // Thread security attributes
-        FALSE,          // Inherit handles
-        CREATE_NO_WINDOW, // Creation flags - no window
-        NULL,           // Environment
-        current_dir,    // Current directory - set to virtual directory location
-        &si,            // Startup info
-        &pi             // Process information
-    );
-    
-    if (success) {
-        // Check if this is a long-running command (like npm dev, npm start)
-        int is_long_running = 0;
-        if (strstr(full_command, "npm dev") || strstr(full_command, "npm start") || 
-            strstr(full_command, "npm run dev") || strstr(full_command, "npm run start")) {
-            is_long_running = 1;
-        }
-        
-        if (is_long_running) {
-            // For long-running commands, don't wait - just start and return
-            gui_println("Development server started successfully.");
-            gui_println("Note: Server is running in background. Use Ctrl+C in the server window to stop.");
-            
-            // Close handles immediately for long-running processes
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
-        } else {
-            // For regular commands, wait for completion
-            WaitForSingleObject(pi.hProcess, INFINITE);
-            
-            DWORD exit_code;
-            GetExitCodeProcess(pi.hProcess, &exit_code);
-            
-            // Close handles
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
-            
-            if (exit_code == 0) {
-                gui_println("Command completed successfully.");
-            } else {
-                gui_printf("Command failed with exit code: %d\n", exit_code);
-            }
+    // A dev server never ends. With jobs it runs as a background one that
+    // KILL stops; without (nexus-cli, scripts) it is started and left running.
+    if (is_long_running && !jobs_async()) {
+        output_sync();
+        PfProcess* proc = pf_spawn(full_command, current_dir, PF_SPAWN_SHELL);
+        if (!proc) {
+            gui_error("Failed to execute command.");
+            return;
         }
-    } else {
-        gui_println("Failed to execute command.");
+        gui_println("Development server started successfully.");
+        gui_println("Note: Server is running in background. Use Ctrl+C in the server window to stop.");
+        pf_process_detach(proc);
+        return;
+    }
+    if (is_long_running) g_jobBackground = TRUE;
+    
+    // Run the command through the shell without a console window; its
+    // output streams in as a job
+    if (!job_start(full_command, current_dir, PF_SPAWN_SHELL | PF_SPAWN_CAPTURE, system_command_done, NULL)) {
+        gui_error("Failed to execute command.");
+    } else if (is_long_running) {
+        gui_println("Development server started in the background. Use JOBS to see it and KILL to stop it.");
     }
 }
 
@@ -5133,7 +10775,7 @@ static void cmd_npm_install(const char* args) {
 
 static void cmd_npm_add(const char* args) {
     if (!args || strlen(args) == 0) {
-        gui_println("Usage: NPM ADD <package> [--save-dev]");
+        gui_error("Usage: NPM ADD <package> [--save-dev]");
         gui_println("Example: NPM ADD react");
         gui_println("Example: NPM ADD eslint --save-dev");
         return;
@@ -5146,7 +10788,7 @@ static void cmd_npm_add(const char* args) {
 
 static void cmd_npm_remove(const char* args) {
     if (!args || strlen(args) == 0) {
-        gui_println("Usage: NPM REMOVE <package>");
+        gui_error("Usage: NPM REMOVE <package>");
         gui_println("Example: NPM REMOVE react");
         return;
     }
@@ -5185,13 +10827,47 @@ static void cmd_npm_outdated(void) {
     execute_npm_command("outdated");
 }
 
+static void npm_print_scripts(const PackageInfo* package) {
+    if (package->script_count == 0) {
+        gui_println("package.json has no scripts.");
+        return;
+    }
+    gui_println("Scripts in package.json:");
+    for (int i = 0; i < package->script_count; i++) {
+        gui_printf("  %-20s %s", package->scripts[i].name, package->scripts[i].command);
+    }
+}
+
+// A package.json npm cannot read is left for npm to report
+static const PackageInfo* npm_package(void) {
+    File* file = package_json_find(g_cwd);
+    const PackageInfo* package = file ? package_info(file) : NULL;
+    return (package && package->valid) ? package : NULL;
+}
+
+static void complete_npm_script(Completion* c) {
+    const PackageInfo* package = npm_package();
+    for (int i = 0; package && i < package->script_count; i++) completion_offer(c, package->scripts[i].name);
+}
+
 static void cmd_npm_run(const char* args) {
+    const PackageInfo* package = npm_package();
     if (!args || strlen(args) == 0) {
-        gui_println("Usage: NPM RUN <script>");
+        if (package) {
+            npm_print_scripts(package);
+            return;
+        }
+        gui_error("Usage: NPM RUN <script>");
         gui_println("Example: NPM RUN start");
         gui_println("Example: NPM RUN build");
         return;
     }
+    char name[MAX_SCRIPT_NAME];
+    if (package && sscanf(args, "%127s", name) == 1 && !package_script(package, name)) {
+        gui_errorf("No script named '%s' in package.json.", name);
+        npm_print_scripts(package);
+        return;
+    }
     gui_printf("Running script: %s\n", args);
     char npm_cmd[512];
     snprintf(npm_cmd, sizeof(npm_cmd), "run %s", args);
@@ -5277,7 +10953,7 @@ static void cmd_npm_help(void) {
     gui_println("NPM UPDATE             Update all packages");
     gui_println("NPM AUDIT              Check for vulnerabilities");
     gui_println("NPM OUTDATED           Show outdated packages");
-    gui_println("NPM RUN <script>       Run a package script");
+    gui_println("NPM RUN [script]       Run a package script; alone, list them");
     gui_println("NPM START              Run start script");
     gui_println("NPM BUILD              Run build script");
     gui_println("NPM TEST               Run test script");
@@ -5291,7 +10967,7 @@ static void cmd_npm_help(void) {
 
 static void cmd_react_create(const char* args) {
     if (!args || strlen(args) == 0) {
-        gui_println("Usage: REACT CREATE <app-name>");
+        gui_error("Usage: REACT CREATE <app-name>");
         gui_println("Example: REACT CREATE my-react-app");
         return;
     }
@@ -5303,7 +10979,7 @@ static void cmd_react_create(const char* args) {
 
 static void cmd_react_component(const char* args) {
     if (!args || strlen(args) == 0) {
-        gui_println("Usage: REACT COMPONENT <component-name>");
+        gui_error("Usage: REACT COMPONENT <component-name>");
         gui_println("Example: REACT COMPONENT Button");
         return;
     }
@@ -5363,7 +11039,7 @@ static void cmd_react_lint(void) {
 
 static void cmd_run(const char* filename) {
     if (!filename || strlen(filename) == 0) {
-        gui_println("Usage: RUN <filename>");
+        gui_error("Usage: RUN <filename>");
         gui_println("Example: RUN main.cpp");
         gui_println("Example: RUN script.py");
         return;
@@ -5372,49 +11048,1130 @@ static void cmd_run(const char* filename) {
     // Check if file exists
     File* file = fs_find_file(g_cwd, filename);
     if (!file) {
-        gui_printf("File '%s' not found in current directory.\n", filename);
+        gui_errorf("File '%s' not found in current directory.\n", filename);
         return;
     }
     
     // Determine file type and execute
     const char* ext = strrchr(filename, '.');
     if (!ext) {
-        gui_println("File has no extension. Cannot determine type.");
+        gui_error("File has no extension. Cannot determine type.");
+        return;
+    }
+    
+    if (str_icmp(ext, ".cpp") == 0 || str_icmp(ext, ".c") == 0) {
+        execute_cpp_file(filename);
+    } else if (str_icmp(ext, ".py") == 0) {
+        execute_python_file(filename);
+    } else {
+        gui_errorf("Unsupported file type: %s\n", ext);
+        gui_println("Supported types: .cpp, .c, .py");
+    }
+}
+
+static void cmd_compile(const char* filename) {
+    if (!filename || strlen(filename) == 0) {
+        gui_error("Usage: COMPILE <filename>");
+        gui_println("Example: COMPILE main.cpp");
+        return;
+    }
+    
+    // Check if file exists
+    File* file = fs_find_file(g_cwd, filename);
+    if (!file) {
+        gui_errorf("File '%s' not found in current directory.\n", filename);
+        return;
+    }
+    
+    // Check if it's a C++ file
+    const char* ext = strrchr(filename, '.');
+    if (!ext || (str_icmp(ext, ".cpp") != 0 && str_icmp(ext, ".c") != 0)) {
+        gui_println("COMPILE command only works with .cpp and .c files.");
+        return;
+    }
+    
+    execute_cpp_file(filename);
+}
+
+// ---------------- Compile cache ----------------
+// RUN and COMPILE reuse the program built last time when nothing that goes
+// into it has changed. The key hashes the compiler (path, size and
+// timestamp), the command line it runs with, the source and every local
+// header reached through #include "..."; system headers are taken to change
+// only with the compiler. Programs are kept in data\cache\compile as
+// <key>.exe, and the least recently used go first once the folder passes
+// its limits. index.dat keeps them in that order, with the hit counts.
+#define CPP_COMPILE_LINE "g++ -o %s.exe \"%s\""
+#define COMPILE_CACHE_MAX_BYTES (256ULL * 1024 * 1024)
+#define COMPILE_CACHE_MAX_ENTRIES 256
+#define COMPILE_CACHE_MAX_HEADERS 128
+#define COMPILE_CACHE_INCLUDE_DEPTH 16
+
+typedef struct {
+    char key[33];
+    unsigned long long size;
+    double seconds;                       // what compiling it took
+} CompileCacheEntry;
+
+static CompileCacheEntry* g_compileCache = NULL;    // least recently used first
+static int g_compileCacheCount = 0;
+static int g_compileCacheCap = 0;
+static BOOL g_compileCacheLoaded = FALSE;
+static long g_compileCacheHits = 0;
+static long g_compileCacheMisses = 0;
+static double g_compileCacheSaved = 0.0;            // seconds of compiling skipped
+
+// The next #include "name" from *cursor on, which then moves past its line;
+// NULL at the end. <...> includes are the compiler's own and are skipped.
+static const char* next_local_include(const char** cursor, size_t* len) {
+    const char* line = *cursor;
+    while (line && *line) {
+        const char* next = strchr(line, '\n');
+        const char* p = line;
+        line = next ? next + 1 : NULL;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p++ != '#') continue;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncmp(p, "include", 7) != 0) continue;
+        p += 7;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p != '"') continue;
+        const char* close = p + 1 + strcspn(p + 1, "\"\n");
+        if (*close != '"' || close == p + 1) continue;
+        *cursor = line;
+        *len = (size_t)(close - p - 1);
+        return p + 1;
+    }
+    *cursor = NULL;
+    return NULL;
+}
+
+static void compile_cache_dir(char* out, size_t out_sz) {
+    char program_dir[1024];
+    get_main_project_dir(program_dir, sizeof(program_dir));
+    snprintf(out, out_sz, "%s\\data\\cache\\compile", program_dir);
+}
+
+static void compile_cache_file(const char* name, char* out, size_t out_sz) {
+    char dir[1024];
+    compile_cache_dir(dir, sizeof(dir));
+    snprintf(out, out_sz, "%s\\%s", dir, name);
+}
+
+static BOOL compile_cache_push(const char* key, unsigned long long size, double seconds) {
+    if (g_compileCacheCount == g_compileCacheCap) {
+        int cap = g_compileCacheCap ? g_compileCacheCap * 2 : 16;
+        CompileCacheEntry* bigger = (CompileCacheEntry*)realloc(g_compileCache, (size_t)cap * sizeof(*bigger));
+        if (!bigger) return FALSE;
+        g_compileCache = bigger;
+        g_compileCacheCap = cap;
+    }
+    CompileCacheEntry* e = &g_compileCache[g_compileCacheCount++];
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    e->size = size;
+    e->seconds = seconds;
+    return TRUE;
+}
+
+static void compile_cache_load(void) {
+    if (g_compileCacheLoaded) return;
+    g_compileCacheLoaded = TRUE;
+    char path[1024];
+    compile_cache_file("index.dat", path, sizeof(path));
+    FILE* f = pf_fopen(path, "r");
+    if (!f) return;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char key[33];
+        unsigned long long size;
+        double seconds;
+        if (strncmp(line, "STATS:", 6) == 0) {
+            sscanf(line + 6, "%ld|%ld|%lf", &g_compileCacheHits, &g_compileCacheMisses, &g_compileCacheSaved);
+        } else if (sscanf(line, "ENTRY:%32[0-9a-f]|%llu|%lf", key, &size, &seconds) == 3 && strlen(key) == 32) {
+            compile_cache_push(key, size, seconds);
+        }
+    }
+    fclose(f);
+}
+
+static void compile_cache_save(void) {
+    char dir[1024], path[1024];
+    compile_cache_dir(dir, sizeof(dir));
+    mkdir_p(dir);
+    compile_cache_file("index.dat", path, sizeof(path));
+    FILE* f = pf_fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "STATS:%ld|%ld|%.3f\n", g_compileCacheHits, g_compileCacheMisses, g_compileCacheSaved);
+    for (int i = 0; i < g_compileCacheCount; i++) {
+        const CompileCacheEntry* e = &g_compileCache[i];
+        fprintf(f, "ENTRY:%s|%llu|%.3f\n", e->key, e->size, e->seconds);
+    }
+    fclose(f);
+}
+
+static int compile_cache_find(const char* key) {
+    for (int i = 0; i < g_compileCacheCount; i++) {
+        if (strcmp(g_compileCache[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+static void compile_cache_drop(int index) {
+    char name[64], path[1024];
+    snprintf(name, sizeof(name), "%s.exe", g_compileCache[index].key);
+    compile_cache_file(name, path, sizeof(path));
+    pf_remove(path);
+    memmove(&g_compileCache[index], &g_compileCache[index + 1],
+            (size_t)(g_compileCacheCount - index - 1) * sizeof(g_compileCache[0]));
+    g_compileCacheCount--;
+}
+
+// Hashes a file's content, then the local headers it includes. Where the
+// source lives is left out, so a copy elsewhere hits the same entry; headers
+// that are not beside it are hashed by name only, since the compiler finds
+// those on its own include path.
+static BOOL compile_cache_hash_file(HashState* state, const char* path, int depth, int* files) {
+    if (depth > COMPILE_CACHE_INCLUDE_DEPTH || ++*files > COMPILE_CACHE_MAX_HEADERS) return TRUE;
+    PfStat st;
+    if (!pf_stat(path, &st) || st.kind != PF_PATH_FILE) return FALSE;
+    FILE* f = pf_fopen(path, "rb");
+    if (!f) return FALSE;
+    char* text = (char*)malloc((size_t)st.size + 1);
+    size_t len = text ? fread(text, 1, (size_t)st.size, f) : 0;
+    fclose(f);
+    if (!text) return FALSE;
+    text[len] = '\0';
+
+    unsigned long long size = len;
+    hash_update(state, &size, sizeof(size));
+    hash_update(state, text, len);
+
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char* slash = strrchr(dir, '\\');
+    if (slash) *slash = '\0';
+
+    BOOL ok = TRUE;
+    const char* cursor = text;
+    size_t name_len;
+    for (const char* name; ok && (name = next_local_include(&cursor, &name_len)) != NULL;) {
+        char header[1024];
+        snprintf(header, sizeof(header), "%s\\%.*s", dir, (int)name_len, name);
+        for (char* c = header; *c; c++) if (*c == '/') *c = '\\';
+        hash_update(state, name, name_len);
+        if (pf_path_kind(header) == PF_PATH_FILE) {
+            ok = compile_cache_hash_file(state, header, depth + 1, files);
+        }
+    }
+    free(text);
+    return ok;
+}
+
+// FALSE when there is nothing to key on: no compiler on PATH, or a source
+// that cannot be read. The build then runs uncached.
+static BOOL compile_cache_key(const char* source, char key[33]) {
+    char compiler[1024];
+    PfStat st;
+    if (!pf_find_program("g++", compiler, sizeof(compiler)) || !pf_stat(compiler, &st)) return FALSE;
+
+    HashState state;
+    hash_init(&state);
+    hash_update(&state, "compile", 8);
+    hash_update(&state, compiler, strlen(compiler) + 1);
+    hash_update(&state, &st.size, sizeof(st.size));
+    hash_update(&state, &st.mtime, sizeof(st.mtime));
+    hash_update(&state, CPP_COMPILE_LINE, sizeof(CPP_COMPILE_LINE));
+    int files = 0;
+    if (!compile_cache_hash_file(&state, source, 0, &files)) return FALSE;
+    hash128_to_hex(hash_final128(&state), key);
+    return TRUE;
+}
+
+// On a hit, puts the cached program where the compiler would have written
+// it and returns the seconds of compiling that spared
+static BOOL compile_cache_fetch(const char* key, const char* dir, const char* exe_name, double* saved) {
+    compile_cache_load();
+    int i = compile_cache_find(key);
+    if (i < 0) return FALSE;
+
+    char name[64], cached[1024], target[2048];
+    snprintf(name, sizeof(name), "%s.exe", key);
+    compile_cache_file(name, cached, sizeof(cached));
+    snprintf(target, sizeof(target), "%s\\%s.exe", dir, exe_name);
+    if (!pf_copy_file(cached, target)) {
+        // Gone from the folder, or the old program is still running
+        if (pf_path_kind(cached) == PF_PATH_NONE) compile_cache_drop(i);
+        return FALSE;
+    }
+
+    // Most recently used now
+    CompileCacheEntry hit = g_compileCache[i];
+    memmove(&g_compileCache[i], &g_compileCache[i + 1],
+            (size_t)(g_compileCacheCount - i - 1) * sizeof(g_compileCache[0]));
+    g_compileCache[g_compileCacheCount - 1] = hit;
+    *saved = hit.seconds;
+    return TRUE;
+}
+
+static void compile_cache_store(const char* key, const char* dir, const char* exe_name, double seconds) {
+    compile_cache_load();
+    char built[2048], name[64], cached[1024], cache_dir[1024];
+    snprintf(built, sizeof(built), "%s\\%s.exe", dir, exe_name);
+    snprintf(name, sizeof(name), "%s.exe", key);
+    compile_cache_dir(cache_dir, sizeof(cache_dir));
+    compile_cache_file(name, cached, sizeof(cached));
+
+    PfStat st;
+    if (!mkdir_p(cache_dir) || !pf_stat(built, &st) || !pf_copy_file(built, cached)) return;
+    int old = compile_cache_find(key);
+    if (old >= 0) {
+        memmove(&g_compileCache[old], &g_compileCache[old + 1],
+                (size_t)(g_compileCacheCount - old - 1) * sizeof(g_compileCache[0]));
+        g_compileCacheCount--;
+    }
+    if (!compile_cache_push(key, st.size, seconds)) {
+        pf_remove(cached);
+        return;
+    }
+
+    // Evict from the old end, never the program just stored
+    unsigned long long total = 0;
+    for (int i = 0; i < g_compileCacheCount; i++) total += g_compileCache[i].size;
+    while (g_compileCacheCount > 1 &&
+           (total > COMPILE_CACHE_MAX_BYTES || g_compileCacheCount > COMPILE_CACHE_MAX_ENTRIES)) {
+        total -= g_compileCache[0].size;
+        compile_cache_drop(0);
+    }
+}
+
+static void cmd_cache_stats(void) {
+    compile_cache_load();
+    char dir[1024];
+    compile_cache_dir(dir, sizeof(dir));
+    unsigned long long total = 0;
+    for (int i = 0; i < g_compileCacheCount; i++) total += g_compileCache[i].size;
+    long lookups = g_compileCacheHits + g_compileCacheMisses;
+
+    gui_printf("Compile cache: %s", dir);
+    gui_printf("  Programs:   %d (%.1f MB of %.0f MB)", g_compileCacheCount,
+               total / (1024.0 * 1024.0), COMPILE_CACHE_MAX_BYTES / (1024.0 * 1024.0));
+    gui_printf("  Builds:     %ld (%ld hits, %ld misses)", lookups, g_compileCacheHits, g_compileCacheMisses);
+    gui_printf("  Hit rate:   %.1f%%", lookups ? 100.0 * g_compileCacheHits / lookups : 0.0);
+    gui_printf("  Time saved: %.2f s", g_compileCacheSaved);
+}
+
+static void cmd_cache_clear(void) {
+    compile_cache_load();
+    int programs = g_compileCacheCount;
+    unsigned long long total = 0;
+    while (g_compileCacheCount > 0) {
+        total += g_compileCache[g_compileCacheCount - 1].size;
+        compile_cache_drop(g_compileCacheCount - 1);
+    }
+    g_compileCacheHits = 0;
+    g_compileCacheMisses = 0;
+    g_compileCacheSaved = 0.0;
+    char path[1024];
+    compile_cache_file("index.dat", path, sizeof(path));
+    pf_remove(path);
+    gui_printf("Compile cache cleared: %d program(s), %.1f MB.", programs, total / (1024.0 * 1024.0));
+}
+
+static void cmd_cache_usage(const char* args) {
+    (void)args;
+    gui_error("Usage: CACHE STATS | CACHE CLEAR");
+    gui_println("RUN and COMPILE keep built programs and skip the compiler when nothing changed.");
+}
+
+static void cpp_run_done(Job* job, int exit_code) {
+    if (exit_code == 0) {
+        gui_printf("Program execution completed (%s).", job_cost(job));
+    } else {
+        gui_errorf("Program failed with exit code: %d (%s)", exit_code, job_cost(job));
+    }
+}
+
+// ---------------- Build ----------------
+static BuildJob* g_buildJob = NULL;
+
+// dir\name with "." and ".." worked out, so every route to a header gives
+// the same path. A ".." above dir is kept.
+static void build_join_path(const char* dir, const char* name, size_t name_len, char* out, size_t size) {
+    char joined[1024];
+    snprintf(joined, sizeof(joined), "%s%s%.*s", dir, *dir ? "\\" : "", (int)name_len, name);
+    char* parts[128];
+    int count = 0, kept_up = 0;
+    for (char* p = joined; *p;) {
+        char* part = p;
+        p += strcspn(p, "\\/");
+        if (*p) *p++ = '\0';
+        if (!*part || strcmp(part, ".") == 0) continue;
+        if (strcmp(part, "..") == 0 && count > kept_up) {
+            count--;
+        } else if (count < (int)(sizeof(parts) / sizeof(parts[0]))) {
+            if (strcmp(part, "..") == 0) kept_up++;
+            parts[count++] = part;
+        }
+    }
+    size_t len = 0;
+    out[0] = '\0';
+    for (int i = 0; i < count && len < size; i++) {
+        len += (size_t)snprintf(out + len, size - len, i ? "\\%s" : "%s", parts[i]);
+    }
+}
+
+// ---- Database ----
+static void build_db_path(const char* dir, char* out, size_t size) {
+    snprintf(out, size, "%s\\" BUILD_DIR "\\build.db", dir);
+}
+
+static int build_db_slot(const BuildDb* db, const char* path) {
+    unsigned int mask = (unsigned int)db->index_size - 1;
+    unsigned int i = (unsigned int)hash64(path, strlen(path)) & mask;
+    while (db->index[i] >= 0 && strcmp(db->files[db->index[i]].path, path) != 0) i = (i + 1) & mask;
+    return (int)i;
+}
+
+static int build_db_find(const BuildDb* db, const char* path) {
+    if (db->index_size == 0) return -1;
+    return db->index[build_db_slot(db, path)];
+}
+
+static BOOL build_db_reindex(BuildDb* db, int size) {
+    int* index = (int*)malloc((size_t)size * sizeof(int));
+    if (!index) return FALSE;
+    free(db->index);
+    db->index = index;
+    db->index_size = size;
+    for (int i = 0; i < size; i++) index[i] = -1;
+    for (int i = 0; i < db->count; i++) index[build_db_slot(db, db->files[i].path)] = i;
+    return TRUE;
+}
+
+static int build_db_add(BuildDb* db, const char* path) {
+    if ((db->count + 1) * 2 > db->index_size && !build_db_reindex(db, db->index_size ? db->index_size * 2 : 256)) {
+        return -1;
+    }
+    if (db->count == db->capacity) {
+        int cap = db->capacity ? db->capacity * 2 : 64;
+        BuildFile* bigger = (BuildFile*)realloc(db->files, (size_t)cap * sizeof(BuildFile));
+        if (!bigger) return -1;
+        db->files = bigger;
+        db->capacity = cap;
+    }
+    BuildFile* f = &db->files[db->count];
+    memset(f, 0, sizeof(*f));
+    f->path = _strdup(path);
+    if (!f->path) return -1;
+    db->index[build_db_slot(db, path)] = db->count;
+    return db->count++;
+}
+
+static void build_file_clear_includes(BuildFile* f) {
+    for (int i = 0; i < f->include_count; i++) free(f->includes[i]);
+    free(f->includes);
+    f->includes = NULL;
+    f->include_count = 0;
+}
+
+static BOOL build_file_add_include(BuildFile* f, const char* name, size_t len) {
+    char** bigger = (char**)realloc(f->includes, (size_t)(f->include_count + 1) * sizeof(char*));
+    if (!bigger) return FALSE;
+    f->includes = bigger;
+    f->includes[f->include_count] = (char*)malloc(len + 1);
+    if (!f->includes[f->include_count]) return FALSE;
+    memcpy(f->includes[f->include_count], name, len);
+    f->includes[f->include_count++][len] = '\0';
+    return TRUE;
+}
+
+static BuildObject* build_db_object(BuildDb* db, const char* source, BOOL create) {
+    for (int i = 0; i < db->object_count; i++) {
+        if (strcmp(db->objects[i].source, source) == 0) return &db->objects[i];
+    }
+    if (!create) return NULL;
+    if (db->object_count == db->object_capacity) {
+        int cap = db->object_capacity ? db->object_capacity * 2 : 32;
+        BuildObject* bigger = (BuildObject*)realloc(db->objects, (size_t)cap * sizeof(BuildObject));
+        if (!bigger) return NULL;
+        db->objects = bigger;
+        db->object_capacity = cap;
+    }
+    BuildObject* o = &db->objects[db->object_count];
+    o->source = _strdup(source);
+    if (!o->source) return NULL;
+    o->sig = 0;
+    db->object_count++;
+    return o;
+}
+
+static void build_db_free(BuildDb* db) {
+    for (int i = 0; i < db->count; i++) {
+        free(db->files[i].path);
+        build_file_clear_includes(&db->files[i]);
+    }
+    for (int i = 0; i < db->object_count; i++) free(db->objects[i].source);
+    free(db->files);
+    free(db->index);
+    free(db->objects);
+    memset(db, 0, sizeof(*db));
+}
+
+// FILE:<path>|<size>|<mtime>|<read at>|<hash>[|<include>...]
+// OBJ:<source>|<signature>
+// LINK:<signature>
+static void build_db_load(BuildDb* db, const char* dir) {
+    char path[1024];
+    build_db_path(dir, path, sizeof(path));
+    FILE* f = pf_fopen(path, "r");
+    if (!f) return;
+    static char line[8192];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, "FILE:", 5) == 0) {
+            char* fields[5];
+            char* p = line + 5;
+            int n = 0;
+            for (; n < 5 && p; n++) {
+                fields[n] = p;
+                p = strchr(p, '|');
+                if (p) *p++ = '\0';
+            }
+            if (n < 5 || build_db_find(db, fields[0]) >= 0) continue;
+            int i = build_db_add(db, fields[0]);
+            if (i < 0) break;
+            BuildFile* file = &db->files[i];
+            file->size = strtoull(fields[1], NULL, 10);
+            file->mtime = strtoll(fields[2], NULL, 10);
+            file->scanned_at = strtoll(fields[3], NULL, 10);
+            file->hash = strtoull(fields[4], NULL, 16);
+            while (p) {
+                char* name = p;
+                p = strchr(p, '|');
+                if (p) *p++ = '\0';
+                build_file_add_include(file, name, strlen(name));
+            }
+        } else if (strncmp(line, "OBJ:", 4) == 0) {
+            char* sep = strrchr(line + 4, '|');
+            if (!sep) continue;
+            *sep = '\0';
+            BuildObject* o = build_db_object(db, line + 4, TRUE);
+            if (o) o->sig = strtoull(sep + 1, NULL, 16);
+        } else if (strncmp(line, "LINK:", 5) == 0) {
+            db->link_sig = strtoull(line + 5, NULL, 16);
+        }
+    }
+    fclose(f);
+}
+
+// Files no build reached this time are dropped, so the database follows
+// the project as it changes
+static void build_db_save(const BuildDb* db, const char* dir) {
+    char path[1024];
+    build_db_path(dir, path, sizeof(path));
+    FILE* f = pf_fopen(path, "w");
+    if (!f) return;
+    for (int i = 0; i < db->count; i++) {
+        const BuildFile* file = &db->files[i];
+        if (!file->checked || !file->exists) continue;
+        fprintf(f, "FILE:%s|%llu|%lld|%lld|%016llx", file->path, file->size, file->mtime, file->scanned_at, file->hash);
+        for (int j = 0; j < file->include_count; j++) fprintf(f, "|%s", file->includes[j]);
+        fputc('\n', f);
+    }
+    for (int i = 0; i < db->object_count; i++) {
+        if (db->objects[i].sig) fprintf(f, "OBJ:%s|%016llx\n", db->objects[i].source, db->objects[i].sig);
+    }
+    fprintf(f, "LINK:%016llx\n", db->link_sig);
+    fclose(f);
+}
+
+// ---- Dependencies ----
+// The file's record, read again if it changed since the last build. -1 if
+// it is not there.
+static int build_db_check(BuildDb* db, const char* dir, const char* rel) {
+    int i = build_db_find(db, rel);
+    if (i >= 0 && db->files[i].checked) return db->files[i].exists ? i : -1;
+
+    char real[2048];
+    snprintf(real, sizeof(real), "%s\\%s", dir, rel);
+    PfStat st;
+    BOOL exists = pf_stat(real, &st) && st.kind == PF_PATH_FILE;
+    if (!exists && i < 0) return -1;
+    if (i < 0 && (i = build_db_add(db, rel)) < 0) return -1;
+    BuildFile* f = &db->files[i];
+    f->checked = TRUE;
+    f->exists = exists;
+    if (!exists) return -1;
+    if (f->scanned_at && f->size == st.size && f->mtime == st.mtime && st.mtime < f->scanned_at) return i;
+
+    FILE* in = pf_fopen(real, "rb");
+    char* text = in ? (char*)malloc((size_t)st.size + 1) : NULL;
+    size_t len = text ? fread(text, 1, (size_t)st.size, in) : 0;
+    if (in) fclose(in);
+    if (!text) {
+        f->exists = FALSE;
+        return -1;
+    }
+    text[len] = '\0';
+    f->size = st.size;
+    f->mtime = st.mtime;
+    f->scanned_at = (long long)time(NULL);
+    f->hash = hash64(text, len);
+    build_file_clear_includes(f);
+    const char* cursor = text;
+    size_t name_len;
+    for (const char* name; (name = next_local_include(&cursor, &name_len)) != NULL;) {
+        build_file_add_include(f, name, name_len);
+    }
+    free(text);
+    db->dirty = TRUE;
+    return i;
+}
+
+// Feeds the file and everything it includes from the folder into state,
+// each file once. An include that is not there is hashed by name: the
+// compiler finds it on its own include path.
+static void build_hash_deps(BuildDb* db, const char* dir, int file, HashState* state, int depth) {
+    BuildFile* f = &db->files[file];
+    if (f->visit == db->visit || depth > BUILD_MAX_INCLUDE_DEPTH) return;
+    f->visit = db->visit;
+    hash_update(state, f->path, strlen(f->path) + 1);
+    hash_update(state, &f->hash, sizeof(f->hash));
+
+    char base[1024];
+    snprintf(base, sizeof(base), "%s", f->path);
+    char* slash = strrchr(base, '\\');
+    if (slash) *slash = '\0'; else base[0] = '\0';
+
+    // The array may move as headers are added; the include list does not
+    char** includes = f->includes;
+    int count = f->include_count;
+    for (int i = 0; i < count; i++) {
+        char rel[1024];
+        build_join_path(base, includes[i], strlen(includes[i]), rel, sizeof(rel));
+        int header = build_db_check(db, dir, rel);
+        if (header >= 0) {
+            build_hash_deps(db, dir, header, state, depth + 1);
+        } else {
+            hash_update(state, includes[i], strlen(includes[i]) + 1);
+        }
+    }
+}
+
+// What an object depends on: its compile command, its source and every
+// local header the source reaches
+static unsigned long long build_unit_sig(BuildDb* db, const char* dir, int source, const char* command) {
+    HashState state;
+    hash_init(&state);
+    hash_update(&state, command, strlen(command) + 1);
+    db->visit++;
+    build_hash_deps(db, dir, source, &state, 0);
+    unsigned long long sig = hash_final64(&state);
+    return sig ? sig : 1;
+}
+
+static BOOL build_is_source(const char* name) {
+    const char* ext = strrchr(name, '.');
+    return ext && (str_icmp(ext, ".cpp") == 0 || str_icmp(ext, ".c") == 0);
+}
+
+static int build_compare_names(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// ---- Running ----
+// Queues head and then text, together, for the UI thread
+static void build_output(BuildJob* job, const char* head, size_t head_len, const char* text, size_t len) {
+    pf_mutex_lock(job->lock);
+    BOOL wake = job->out_len == 0;
+    size_t need = job->out_len + head_len + len;
+    if (need > job->out_cap) {
+        size_t cap = job->out_cap ? job->out_cap : 8192;
+        while (cap < need) cap *= 2;
+        char* bigger = (char*)realloc(job->out, cap);
+        if (bigger) {
+            job->out = bigger;
+            job->out_cap = cap;
+        }
+    }
+    if (need <= job->out_cap) {
+        memcpy(job->out + job->out_len, head, head_len);
+        if (len) memcpy(job->out + job->out_len + head_len, text, len);
+        job->out_len = need;
+    }
+    pf_mutex_unlock(job->lock);
+    if (wake && job->thread) gui_job_wake();
+}
+
+// Runs one compiler, or the linker when unit is FALSE, in slot. Its output
+// is passed on whole, under a header line numbered in the order units end,
+// once it exits, so parallel compilers never mix.
+static int build_run(BuildJob* job, int slot, const char* command, const char* title, BOOL unit) {
+    double start = pf_seconds();
+    PfProcess* proc = pf_spawn(command, job->dir, PF_SPAWN_CAPTURE | job->spawn_flags);
+    if (proc) {
+        pf_mutex_lock(job->lock);
+        job->running[slot] = proc;
+        pf_mutex_unlock(job->lock);
+    }
+
+    char* text = NULL;
+    size_t len = 0, cap = 0;
+    char buf[4096];
+    int n;
+    while (proc && (n = pf_process_read(proc, buf, sizeof(buf))) > 0) {
+        if (len + (size_t)n + 2 > cap) {
+            size_t bigger_cap = cap ? cap * 2 : 8192;
+            while (bigger_cap < len + (size_t)n + 2) bigger_cap *= 2;
+            char* bigger = (char*)realloc(text, bigger_cap);
+            if (!bigger) continue;
+            text = bigger;
+            cap = bigger_cap;
+        }
+        memcpy(text + len, buf, (size_t)n);
+        len += (size_t)n;
+    }
+    int exit_code = -1;
+    if (proc) {
+        pf_process_join(proc);
+        pf_mutex_lock(job->lock);
+        job->running[slot] = NULL;
+        pf_mutex_unlock(job->lock);
+        exit_code = pf_process_wait(proc);
+    }
+
+    char prefix[32] = "";
+    if (unit) {
+        pf_mutex_lock(job->lock);
+        long done = ++job->completed;
+        pf_mutex_unlock(job->lock);
+        snprintf(prefix, sizeof(prefix), "[%ld/%d] ", done, job->unit_count);
+    }
+    char head[1400];
+    int head_len;
+    if (!proc) {
+        head_len = snprintf(head, sizeof(head), "%s%s: could not start %s\n", prefix, title, command);
+    } else if (exit_code == 0) {
+        head_len = snprintf(head, sizeof(head), "%s%s (%.2f s)\n", prefix, title, pf_seconds() - start);
+    } else if (pf_atomic_get(&job->cancel)) {
+        head_len = snprintf(head, sizeof(head), "%s%s: stopped\n", prefix, title);
+    } else {
+        head_len = snprintf(head, sizeof(head), "%s%s: exit code %d\n", prefix, title, exit_code);
+    }
+    if (head_len >= (int)sizeof(head)) head_len = (int)sizeof(head) - 1;
+    if (text && len > 0 && text[len - 1] != '\n') text[len++] = '\n';
+    build_output(job, head, (size_t)head_len, text, text ? len : 0);
+    free(text);
+    return exit_code;
+}
+
+static int build_worker(void* param) {
+    BuildWorker* worker = (BuildWorker*)param;
+    BuildJob* job = worker->job;
+    for (;;) {
+        pf_mutex_lock(job->lock);
+        int i = job->next;
+        BOOL stop = job->failed || pf_atomic_get(&job->cancel) || i >= job->unit_count;
+        if (!stop) job->next++;
+        pf_mutex_unlock(job->lock);
+        if (stop) break;
+
+        BuildUnit* unit = &job->units[i];
+        unit->exit_code = build_run(job, worker->slot, unit->command, unit->source, TRUE);
+        unit->done = TRUE;
+        if (unit->exit_code != 0) {
+            pf_mutex_lock(job->lock);
+            job->failed = TRUE;
+            pf_mutex_unlock(job->lock);
+        }
+    }
+    return 0;
+}
+
+// The builder: compile on worker_count threads, this one among them, then link
+static void build_job_run(BuildJob* job) {
+    for (int i = 1; i < job->worker_count; i++) {
+        job->workers[i].thread = pf_thread_start(build_worker, &job->workers[i]);
+    }
+    build_worker(&job->workers[0]);
+    for (int i = 1; i < job->worker_count; i++) {
+        if (job->workers[i].thread) pf_thread_join(job->workers[i].thread);
+        job->workers[i].thread = NULL;
+    }
+    job->link_exit = -1;
+    if (job->link_command && !job->failed && !pf_atomic_get(&job->cancel)) {
+        char title[MAX_NAME + 64];
+        snprintf(title, sizeof(title), "Linking %s", job->exe);
+        job->link_exit = build_run(job, 0, job->link_command, title, FALSE);
+    }
+}
+
+static int build_job_thread(void* param) {
+    BuildJob* job = (BuildJob*)param;
+    build_job_run(job);
+    pf_atomic_set(&job->finished, 1);
+    gui_job_wake();
+    return 0;
+}
+
+static void build_job_free(BuildJob* job) {
+    for (int i = 0; i < job->unit_count; i++) {
+        free(job->units[i].source);
+        free(job->units[i].command);
+    }
+    free(job->units);
+    free(job->link_command);
+    free(job->out);
+    build_db_free(&job->db);
+    pf_mutex_free(job->lock);
+    free(job);
+}
+
+static void build_job_take_output(BuildJob* job) {
+    pf_mutex_lock(job->lock);
+    char* out = job->out;
+    size_t len = job->out_len;
+    job->out = NULL;
+    job->out_len = job->out_cap = 0;
+    pf_mutex_unlock(job->lock);
+    if (!out) return;
+    for (size_t start = 0; start < len;) {
+        size_t end = start;
+        while (end < len && out[end] != '\n') end++;
+        size_t line_end = end;
+        if (line_end > start && out[line_end - 1] == '\r') line_end--;
+        out[line_end] = '\0';
+        gui_println(out + start);
+        start = end + 1;
+    }
+    free(out);
+}
+
+// Compilers done: print the rest and record what was built
+static void build_job_finish(void) {
+    BuildJob* job = g_buildJob;
+    if (!job) return;
+    if (job->thread) {
+        pf_thread_join(job->thread);
+        job->thread = NULL;
+        gui_job_end();
+    }
+    if (job->status_shown) gui_status_line(NULL);
+    g_buildJob = NULL;
+    build_job_take_output(job);
+
+    int compiled = 0, errors = 0;
+    for (int i = 0; i < job->unit_count; i++) {
+        BuildUnit* unit = &job->units[i];
+        if (!unit->done) continue;
+        BuildObject* o = build_db_object(&job->db, unit->source, TRUE);
+        if (unit->exit_code == 0) {
+            compiled++;
+            if (o) o->sig = unit->sig;
+        } else {
+            errors++;
+            if (o) o->sig = 0;
+        }
+    }
+    BOOL linked = job->link_command && job->link_exit == 0;
+    job->db.link_sig = linked ? job->link_sig : 0;
+    build_db_save(&job->db, job->dir);
+
+    double seconds = pf_seconds() - job->start;
+    if (pf_atomic_get(&job->cancel)) {
+        gui_printf("Build cancelled: %d of %d compiled; BUILD again picks up from there.", compiled, job->unit_count);
+    } else if (errors > 0) {
+        gui_errorf("Build failed: %d error(s), %d compiled, %d up to date (%.2f s)", errors, compiled, job->up_to_date, seconds);
+    } else if (job->link_command && !linked) {
+        gui_errorf("Build failed: linking %s exited with code %d (%.2f s)", job->exe, job->link_exit, seconds);
+    } else {
+        gui_printf("Built %s: %d compiled, %d up to date (%.2f s)", job->exe, compiled, job->up_to_date, seconds);
+    }
+
+    BOOL prompt = job->prompt_pending;
+    build_job_free(job);
+    if (prompt) gui_show_prompt_when_idle();
+}
+
+static BOOL build_job_active(void) {
+    return g_buildJob != NULL;
+}
+
+// From jobs_wake: print what the compilers wrote, and finish once done
+static void build_job_wake(void) {
+    if (!g_buildJob) return;
+    if (pf_atomic_get(&g_buildJob->finished)) {
+        build_job_finish();
+    } else {
+        build_job_take_output(g_buildJob);
+    }
+}
+
+static void build_job_poll(void) {
+    BuildJob* job = g_buildJob;
+    if (!job || !job->thread) return;
+    BOOL cancelling = pf_atomic_get(&job->cancel) != 0;
+    unsigned long elapsed = pf_ticks_ms() - job->started;
+    if (elapsed < BUILD_STATUS_DELAY_MS && !cancelling) return;
+
+    char text[256];
+    if (cancelling) {
+        snprintf(text, sizeof(text), "Stopping the build...");
+    } else if (job->completed < job->unit_count) {
+        snprintf(text, sizeof(text), "Building: %ld/%d compiled on %d worker(s) (%lu:%02lu) - Ctrl+C to stop",
+                 job->completed, job->unit_count, job->worker_count, elapsed / 60000, elapsed / 1000 % 60);
+    } else {
+        snprintf(text, sizeof(text), "Linking %s (%lu:%02lu) - Ctrl+C to stop", job->exe, elapsed / 60000, elapsed / 1000 % 60);
+    }
+    gui_status_line(text);
+    job->status_shown = TRUE;
+}
+
+// Ctrl+C: no new compiles, and the running ones are stopped
+static void build_job_cancel(void) {
+    BuildJob* job = g_buildJob;
+    if (!job) return;
+    pf_atomic_set(&job->cancel, 1);
+    pf_mutex_lock(job->lock);
+    for (int i = 0; i < job->worker_count; i++) {
+        if (job->running[i]) pf_process_kill(job->running[i]);
+    }
+    pf_mutex_unlock(job->lock);
+    build_job_poll();
+}
+
+static void build_job_abandon(void) {
+    BuildJob* job = g_buildJob;
+    if (!job) return;
+    build_job_cancel();
+    if (job->thread) {
+        pf_thread_join(job->thread);
+        gui_job_end();
+    }
+    g_buildJob = NULL;
+    build_job_free(job);
+}
+
+// The prompt waits for the running build
+static void build_job_hold_prompt(void) {
+    if (g_buildJob) g_buildJob->prompt_pending = TRUE;
+}
+
+// ---- BUILD ----
+// Objects go to build\<source>.o and the program to build\<name>.exe, where
+// the default name is the folder's; the link reads the object list from
+// build\objects.rsp so it stays short however many sources there are.
+static void cmd_build(const char* args) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", args ? args : "");
+    int workers = pf_cpu_count();
+    char name[MAX_NAME] = "";
+    for (char* p = buf; *p;) {
+        char* rest = NULL;
+        char* word = p;
+        if (!parse_first_token(word, &rest)) break;
+        p = rest;
+        char* value = NULL;
+        if ((str_icmp(word, "-j") == 0 || str_icmp(word, "-o") == 0) && *p) {
+            value = p;
+            parse_first_token(value, &rest);
+            p = rest;
+        }
+        if (str_icmp(word, "-j") == 0 && value && atoi(value) > 0) {
+            workers = atoi(value);
+        } else if (str_icmp(word, "-o") == 0 && value && !strpbrk(value, "\\/:*?\"<>|")) {
+            snprintf(name, sizeof(name), "%s", value);
+        } else {
+            gui_error("Usage: BUILD [-j <workers>] [-o <name>]");
+            gui_println("Compiles the .c and .cpp files in this folder that changed, then links build\\<name>.exe.");
+            gui_println("Example: BUILD -j 4");
+            return;
+        }
+    }
+    if (workers > BUILD_MAX_WORKERS) workers = BUILD_MAX_WORKERS;
+    if (g_buildJob) {
+        gui_println("A build is already running.");
+        return;
+    }
+
+    double start = pf_seconds();
+    char rel[1024], dir[1024];
+    vfs_rel_path(g_cwd, rel, sizeof(rel));
+    sync_real_path(rel, dir, sizeof(dir));
+    if (!name[0]) snprintf(name, sizeof(name), "%s", g_cwd->name);
+
+    // Sources: the folder on disk, which may hold files too big for the VFS
+    char* sources[1024];
+    int source_count = 0;
+    PfDir* listing = pf_dir_open(dir);
+    PfDirEntry entry;
+    while (listing && pf_dir_next(listing, &entry)) {
+        if (entry.is_dir || !build_is_source(entry.name)) continue;
+        if (source_count == (int)(sizeof(sources) / sizeof(sources[0]))) break;
+        if ((sources[source_count] = _strdup(entry.name)) != NULL) source_count++;
+    }
+    if (listing) pf_dir_close(listing);
+    if (source_count == 0) {
+        gui_println("Nothing to build: no .c or .cpp files in this folder.");
+        return;
+    }
+    qsort(sources, (size_t)source_count, sizeof(char*), build_compare_names);
+
+    BuildJob* job = (BuildJob*)calloc(1, sizeof(BuildJob));
+    job->units = job ? (BuildUnit*)calloc((size_t)source_count, sizeof(BuildUnit)) : NULL;
+    job->lock = job ? pf_mutex_create() : NULL;
+    if (!job || !job->units || !job->lock) {
+        gui_error("Out of memory.");
+        if (job) build_job_free(job);
+        for (int i = 0; i < source_count; i++) free(sources[i]);
+        return;
+    }
+    snprintf(job->dir, sizeof(job->dir), "%s", dir);
+    snprintf(job->exe, sizeof(job->exe), BUILD_DIR "\\%s.exe", name);
+    job->start = start;
+    build_db_load(&job->db, dir);
+
+    char out_dir[1100];
+    snprintf(out_dir, sizeof(out_dir), "%s\\" BUILD_DIR, dir);
+    mkdir_p(out_dir);
+
+    // Every object's signature; the stale ones become units
+    BOOL cpp = FALSE, missing = FALSE;
+    HashState link_state;
+    hash_init(&link_state);
+    for (int i = 0; i < source_count; i++) {
+        const char* source = sources[i];
+        BOOL is_c = str_icmp(strrchr(source, '.'), ".c") == 0;
+        if (!is_c) cpp = TRUE;
+        char command[1200];
+        snprintf(command, sizeof(command), "%s -c \"%s\" -o \"" BUILD_DIR "\\%s.o\"", is_c ? "gcc" : "g++", source, source);
+        int file = build_db_check(&job->db, dir, source);
+        if (file < 0) {
+            gui_errorf("Cannot read %s", source);
+            missing = TRUE;
+            continue;
+        }
+        unsigned long long sig = build_unit_sig(&job->db, dir, file, command);
+        hash_update(&link_state, source, strlen(source) + 1);
+        hash_update(&link_state, &sig, sizeof(sig));
+
+        char object[1200];
+        snprintf(object, sizeof(object), "%s\\%s.o", out_dir, source);
+        BuildObject* o = build_db_object(&job->db, source, FALSE);
+        if (o && o->sig == sig && pf_path_kind(object) == PF_PATH_FILE) {
+            job->up_to_date++;
+            continue;
+        }
+        BuildUnit* unit = &job->units[job->unit_count];
+        unit->source = _strdup(source);
+        unit->command = _strdup(command);
+        unit->sig = sig;
+        if (unit->source && unit->command) job->unit_count++;
+    }
+    // Objects of sources that are gone
+    for (int i = 0; i < job->db.object_count; i++) {
+        const char* source = job->db.objects[i].source;
+        if (!bsearch(&source, sources, (size_t)source_count, sizeof(char*), build_compare_names)) {
+            job->db.objects[i].sig = 0;
+        }
+    }
+
+    if (missing) {
+        build_db_save(&job->db, dir);
+        build_job_free(job);
+        for (int i = 0; i < source_count; i++) free(sources[i]);
+        return;
+    }
+
+    // The link: the object list goes in a response file, '/' separated as
+    // gcc reads it on every platform
+    char link_line[1400], rsp_path[1200];
+    snprintf(link_line, sizeof(link_line), "%s -o \"%s\" @" BUILD_DIR "\\objects.rsp", cpp ? "g++" : "gcc", job->exe);
+    hash_update(&link_state, link_line, strlen(link_line) + 1);
+    job->link_sig = hash_final64(&link_state);
+    if (!job->link_sig) job->link_sig = 1;
+    char exe_path[2048];
+    snprintf(exe_path, sizeof(exe_path), "%s\\%s", dir, job->exe);
+    if (job->unit_count > 0 || job->db.link_sig != job->link_sig || pf_path_kind(exe_path) != PF_PATH_FILE) {
+        snprintf(rsp_path, sizeof(rsp_path), "%s\\objects.rsp", out_dir);
+        FILE* rsp = pf_fopen(rsp_path, "w");
+        if (rsp) {
+            for (int i = 0; i < source_count; i++) fprintf(rsp, "\"" BUILD_DIR "/%s.o\"\n", sources[i]);
+            fclose(rsp);
+        }
+        job->link_command = _strdup(link_line);
+    }
+    for (int i = 0; i < source_count; i++) free(sources[i]);
+
+    if (!job->link_command) {
+        if (job->db.dirty) build_db_save(&job->db, dir);
+        gui_printf("%s is up to date (%d source(s) checked in %.1f ms)", job->exe, job->up_to_date,
+                   (pf_seconds() - start) * 1000.0);
+        build_job_free(job);
         return;
     }
-    
-    if (str_icmp(ext, ".cpp") == 0 || str_icmp(ext, ".c") == 0) {
-        execute_cpp_file(filename);
-    } else if (str_icmp(ext, ".py") == 0) {
-        execute_python_file(filename);
-    } else {
-        gui_printf("Unsupported file type: %s\n", ext);
-        gui_println("Supported types: .cpp, .c, .py");
+
+    job->worker_count = workers < job->unit_count ? workers : job->unit_count;
+    if (job->worker_count < 1) job->worker_count = 1;
+    for (int i = 0; i < job->worker_count; i++) {
+        job->workers[i].job = job;
+        job->workers[i].slot = i;
+    }
+    if (job->unit_count > 0) {
+        gui_printf("Compiling %d of %d source(s) on %d worker(s)...", job->unit_count, job->unit_count + job->up_to_date,
+                   job->worker_count);
+    }
+    job->started = pf_ticks_ms();
+    g_buildJob = job;
+
+    // A script's next line must see the build finished
+    if (!script_running() && gui_job_begin()) {
+        job->spawn_flags = PF_SPAWN_GROUP;
+        job->thread = pf_thread_start(build_job_thread, job);
+        if (!job->thread) {
+            job->spawn_flags = 0;
+            gui_job_end();
+        }
+    }
+    if (!job->thread) {
+        build_job_run(job);
+        pf_atomic_set(&job->finished, 1);
+        build_job_finish();
     }
 }
 
-static void cmd_compile(const char* filename) {
-    if (!filename || strlen(filename) == 0) {
-        gui_println("Usage: COMPILE <filename>");
-        gui_println("Example: COMPILE main.cpp");
-        return;
+// The program's output comes back through the job, like any other command's
+static void cpp_start_program(const char* dir, const char* exe_name) {
+    char run_line[2048];
+    snprintf(run_line, sizeof(run_line), "\"%s\\%s.exe\"", dir, exe_name);
+    if (!job_start(run_line, dir, PF_SPAWN_CAPTURE | PF_SPAWN_STDIN, cpp_run_done, NULL)) {
+        gui_error("Failed to run executable.");
     }
-    
-    // Check if file exists
-    File* file = fs_find_file(g_cwd, filename);
-    if (!file) {
-        gui_printf("File '%s' not found in current directory.\n", filename);
+}
+
+// Compiled: keep the program in the cache, then run it. arg is
+// "<key>|<exe name>", the key empty when the build could not be keyed.
+static void cpp_compile_done(Job* job, int exit_code) {
+    if (exit_code != 0) {
+        gui_errorf("Compilation failed with exit code: %d\n", exit_code);
         return;
     }
-    
-    // Check if it's a C++ file
-    const char* ext = strrchr(filename, '.');
-    if (!ext || (str_icmp(ext, ".cpp") != 0 && str_icmp(ext, ".c") != 0)) {
-        gui_println("COMPILE command only works with .cpp and .c files.");
-        return;
+    gui_printf("Compilation successful! (%s)", job_cost(job));
+    char key[33] = "";
+    const char* exe_name = job->arg;
+    const char* bar = strchr(job->arg, '|');
+    if (bar) {
+        if (bar - job->arg == 32) {
+            memcpy(key, job->arg, 32);
+            key[32] = '\0';
+        }
+        exe_name = bar + 1;
     }
-    
-    execute_cpp_file(filename);
+    if (key[0]) {
+        compile_cache_store(key, job->dir, exe_name, job->seconds);
+        compile_cache_save();
+    }
+    cpp_start_program(job->dir, exe_name);
 }
 
 static void execute_cpp_file(const char* filename) {
@@ -5455,20 +12212,6 @@ static void execute_cpp_file(const char* filename) {
         strncpy(exe_name, filename, sizeof(exe_name) - 1);
     }
     
-    // Compile command
-    char compile_cmd[1024];
-    snprintf(compile_cmd, sizeof(compile_cmd), "g++ -o %s.exe %s", exe_name, real_path);
-    
-    // Execute compilation
-    STARTUPINFOA si = {0};
-    PROCESS_INFORMATION pi = {0};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    
-    char cmd_line[1024];
-    snprintf(cmd_line, sizeof(cmd_line), "g++ -o %s.exe %s", exe_name, real_path);
-    
     // Get the directory where the file is located
     char working_dir[1024];
     strncpy(working_dir, real_path, sizeof(working_dir) - 1);
@@ -5478,51 +12221,170 @@ static void execute_cpp_file(const char* filename) {
         *last_slash = '\0';
     }
     
-    BOOL success = CreateProcessA(NULL, cmd_line, NULL, NULL, FALSE, CREATE_NO_WINDOW, 
-                                 NULL, working_dir, &si, &pi);
-    
-    if (success) {
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        
-        DWORD exit_code;
-        GetExitCodeProcess(pi.hProcess, &exit_code);
-        
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-        
-        if (exit_code == 0) {
-            gui_println("Compilation successful!");
-            
-            // Run the executable
-            char run_cmd[1024];
-            snprintf(run_cmd, sizeof(run_cmd), "%s.exe", exe_name);
-            
-            STARTUPINFOA si2 = {0};
-            PROCESS_INFORMATION pi2 = {0};
-            si2.cb = sizeof(si2);
-            si2.dwFlags = STARTF_USESHOWWINDOW;
-            si2.wShowWindow = SW_SHOW; // Show the console for output
-            
-            char run_line[1024];
-            snprintf(run_line, sizeof(run_line), "%s.exe", exe_name);
-            
-            BOOL run_success = CreateProcessA(NULL, run_line, NULL, NULL, FALSE, 0, 
-                                            NULL, working_dir, &si2, &pi2);
-            
-            if (run_success) {
-                WaitForSingleObject(pi2.hProcess, INFINITE);
-                CloseHandle(pi2.hProcess);
-                CloseHandle(pi2.hThread);
-                gui_println("Program execution completed.");
-            } else {
-                gui_println("Failed to run executable.");
-            }
+    // Same source, headers, compiler and flags as a program already built
+    double lookup_start = pf_seconds();
+    char key[33] = "";
+    if (compile_cache_key(real_path, key)) {
+        double compile_seconds = 0.0;
+        if (compile_cache_fetch(key, working_dir, exe_name, &compile_seconds)) {
+            double saved = compile_seconds - (pf_seconds() - lookup_start);
+            if (saved < 0.0) saved = 0.0;
+            g_compileCacheHits++;
+            g_compileCacheSaved += saved;
+            compile_cache_save();
+            gui_printf("Up to date: using the cached build (%.2f s saved).", saved);
+            cpp_start_program(working_dir, exe_name);
+            return;
+        }
+        g_compileCacheMisses++;
+        compile_cache_save();
+    }
+
+    // Compile hidden, next to the source; the compiler's messages stream in
+    char cmd_line[1024];
+    char arg[600];
+    snprintf(cmd_line, sizeof(cmd_line), CPP_COMPILE_LINE, exe_name, real_path);
+    snprintf(arg, sizeof(arg), "%s|%s", key, exe_name);
+    if (!job_start(cmd_line, working_dir, PF_SPAWN_CAPTURE, cpp_compile_done, arg)) {
+        gui_error("Failed to start compilation process.");
+    }
+}
+
+// ---- Python ----
+// The interpreter is looked up once, python3 before python. With the
+// python_worker setting on, RUN hands scripts to one long-lived interpreter
+// instead of starting a new one each time: it reads script paths on stdin,
+// runs each with runpy in a fresh __main__ namespace, in the script's
+// folder, and ends its output with a line carrying a per-worker token and
+// the exit code. Modules imported from the script's folder are dropped
+// afterwards so edits to them are seen. The worker's stdin is not the
+// user's, so scripts that prompt for input belong to the normal mode.
+static char g_pythonPath[1024];
+static const char* g_pythonName = NULL;   // "python3" or "python", for argv
+static BOOL g_pythonProbed = FALSE;
+static PfProcess* g_pythonWorker = NULL;
+static char g_pythonMark[JOB_MARK_MAX];   // what starts the worker's end-of-run line
+
+static const char g_pythonBootstrap[] =
+    "import os, sys, runpy, traceback\n"
+    "mark = '\\x1enexus:' + sys.argv[1] + ' '\n"
+    "requests = sys.stdin\n"
+    "sys.stdin = open(os.devnull)\n"
+    "home = os.getcwd()\n"
+    "for line in requests:\n"
+    "    path = os.path.abspath(line.rstrip('\\r\\n').replace('\\\\', os.sep))\n"
+    "    folder = os.path.dirname(path)\n"
+    "    saved = (sys.argv, list(sys.path), set(sys.modules))\n"
+    "    code = 0\n"
+    "    try:\n"
+    "        os.chdir(folder)\n"
+    "        sys.argv = [path]\n"
+    "        sys.path.insert(0, folder)\n"
+    "        runpy.run_path(path, run_name='__main__')\n"
+    "    except SystemExit as e:\n"
+    "        if isinstance(e.code, int):\n"
+    "            code = e.code\n"
+    "        elif e.code is not None:\n"
+    "            print(e.code, file=sys.stderr)\n"
+    "            code = 1\n"
+    "    except BaseException:\n"
+    "        kind, value, tb = sys.exc_info()\n"
+    "        while tb and tb.tb_frame.f_code.co_filename != path:\n"
+    "            tb = tb.tb_next\n"
+    "        traceback.print_exception(kind, value, tb)\n"
+    "        code = 1\n"
+    "    sys.argv, sys.path[:] = saved[0], saved[1]\n"
+    "    for name in set(sys.modules) - saved[2]:\n"
+    "        where = getattr(sys.modules[name], '__file__', None) or ''\n"
+    "        if os.path.abspath(where).startswith(folder + os.sep):\n"
+    "            del sys.modules[name]\n"
+    "    os.chdir(home)\n"
+    "    sys.stdout, sys.stderr = sys.__stdout__, sys.__stderr__\n"
+    "    sys.stderr.flush()\n"
+    "    sys.stdout.write('%s%d\\n' % (mark, code))\n"
+    "    sys.stdout.flush()\n";
+
+// Full path of python3 or python; NULL when neither is on PATH
+static const char* python_interpreter(void) {
+    if (!g_pythonProbed) {
+        g_pythonProbed = TRUE;
+        if (pf_find_program("python3", g_pythonPath, sizeof(g_pythonPath))) {
+            g_pythonName = "python3";
+        } else if (pf_find_program("python", g_pythonPath, sizeof(g_pythonPath))) {
+            g_pythonName = "python";
         } else {
-            gui_printf("Compilation failed with exit code: %d\n", exit_code);
+            g_pythonPath[0] = '\0';
         }
+    }
+    return g_pythonPath[0] ? g_pythonPath : NULL;
+}
+
+static void python_worker_stop(void) {
+    if (!g_pythonWorker) return;
+    pf_process_kill(g_pythonWorker);
+    pf_process_wait(g_pythonWorker);
+    g_pythonWorker = NULL;
+}
+
+// The running worker, started (again) if need be; NULL if it cannot start.
+// argv is not translated the way a command line is, so it names the
+// interpreter rather than giving its engine path.
+static PfProcess* python_worker(void) {
+    if (g_pythonWorker && pf_process_exited(g_pythonWorker)) python_worker_stop();
+    if (g_pythonWorker) return g_pythonWorker;
+
+    unsigned char raw[8];
+    char token[17];
+    if (!pf_random_bytes(raw, sizeof(raw))) return NULL;
+    for (int i = 0; i < 8; i++) snprintf(token + i * 2, 3, "%02x", raw[i]);
+    const char* argv[] = { g_pythonName, "-u", "-c", g_pythonBootstrap, token, NULL };
+    g_pythonWorker = pf_spawn_argv(argv, NULL, NULL, PF_SPAWN_CAPTURE | PF_SPAWN_STDIN | PF_SPAWN_GROUP);
+    if (!g_pythonWorker) return NULL;
+    snprintf(g_pythonMark, sizeof(g_pythonMark), "\x1enexus:%s ", token);
+    return g_pythonWorker;
+}
+
+static BOOL python_worker_busy(void) {
+    for (Job* job = g_jobs; job; job = job->next) {
+        if (job->proc == g_pythonWorker) return TRUE;
+    }
+    return FALSE;
+}
+
+static void python_done(Job* job, int exit_code) {
+    if (exit_code == 0) {
+        gui_printf("Python script executed successfully (%s).", job_cost(job));
+    } else {
+        gui_errorf("Python script failed with exit code: %d", exit_code);
+    }
+}
+
+static void python_worker_done(Job* job, int exit_code) {
+    if (exit_code < 0) {
+        python_worker_stop();
+        gui_error("Error: the Python worker stopped during the script; the next RUN starts a new one.");
+    } else if (exit_code == 0) {
+        gui_printf("Python script executed successfully (%.2f s, warm worker).", job->seconds);
     } else {
-        gui_println("Failed to start compilation process.");
+        gui_errorf("Python script failed with exit code: %d", exit_code);
+    }
+}
+
+// Hands real_path to the worker; FALSE if it is busy or will not start
+static BOOL python_run_warm(const char* real_path, const char* working_dir) {
+    if (g_pythonWorker && python_worker_busy()) return FALSE;
+    PfProcess* worker = python_worker();
+    if (!worker) return FALSE;
+
+    char request[1100];
+    snprintf(request, sizeof(request), "%s\n", real_path);
+    if (!pf_process_write(worker, request, strlen(request))) {
+        python_worker_stop();
+        return FALSE;
     }
+    char label[1100];
+    snprintf(label, sizeof(label), "python %s", real_path);
+    return job_attach(worker, label, g_pythonMark, working_dir, python_worker_done, real_path);
 }
 
 static void execute_python_file(const char* filename) {
@@ -5553,10 +12415,6 @@ static void execute_python_file(const char* filename) {
         }
     }
     
-    // Try python3 first, then python
-    char python_cmd[1024];
-    snprintf(python_cmd, sizeof(python_cmd), "python3 %s", real_path);
-    
     // Get the directory where the file is located
     char working_dir[1024];
     strncpy(working_dir, real_path, sizeof(working_dir) - 1);
@@ -5566,63 +12424,18 @@ static void execute_python_file(const char* filename) {
         *last_slash = '\0';
     }
     
-    STARTUPINFOA si = {0};
-    PROCESS_INFORMATION pi = {0};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_SHOW; // Show the console for output
-    
-    char cmd_line[1024];
-    snprintf(cmd_line, sizeof(cmd_line), "python3 %s", real_path);
-    
-    BOOL success = CreateProcessA(NULL, cmd_line, NULL, NULL, FALSE, 0, 
-                                 NULL, working_dir, &si, &pi);
-    
-    if (success) {
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        
-        DWORD exit_code;
-        GetExitCodeProcess(pi.hProcess, &exit_code);
-        
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-        
-        if (exit_code == 0) {
-            gui_println("Python script executed successfully.");
-        } else {
-            gui_printf("Python script failed with exit code: %d\n", exit_code);
-            gui_println("Trying with 'python' instead of 'python3'...");
-            
-            // Try with just 'python'
-            snprintf(python_cmd, sizeof(python_cmd), "python %s", real_path);
-            snprintf(cmd_line, sizeof(cmd_line), "python %s", real_path);
-            
-            STARTUPINFOA si2 = {0};
-            PROCESS_INFORMATION pi2 = {0};
-            si2.cb = sizeof(si2);
-            si2.dwFlags = STARTF_USESHOWWINDOW;
-            si2.wShowWindow = SW_SHOW;
-            
-            BOOL success2 = CreateProcessA(NULL, cmd_line, NULL, NULL, FALSE, 0, 
-                                         NULL, working_dir, &si2, &pi2);
-            
-            if (success2) {
-                WaitForSingleObject(pi2.hProcess, INFINITE);
-                GetExitCodeProcess(pi2.hProcess, &exit_code);
-                CloseHandle(pi2.hProcess);
-                CloseHandle(pi2.hThread);
-                
-                if (exit_code == 0) {
-                    gui_println("Python script executed successfully with 'python'.");
-                } else {
-                    gui_printf("Python script failed with both 'python3' and 'python'.\n");
-                }
-            } else {
-                gui_println("Failed to run Python script with both 'python3' and 'python'.");
-            }
-        }
-    } else {
-        gui_println("Failed to start Python process.");
+    const char* python = python_interpreter();
+    if (!python) {
+        gui_error("Error: Python was not found. Install python3 (or python) and put it on PATH.");
+        return;
+    }
+    if (g_settings.python_worker && python_run_warm(real_path, working_dir)) return;
+
+    // A fresh interpreter, its output read back like the worker's
+    char cmd_line[2100];
+    snprintf(cmd_line, sizeof(cmd_line), "\"%s\" -u \"%s\"", python, real_path);
+    if (!job_start(cmd_line, working_dir, PF_SPAWN_CAPTURE | PF_SPAWN_STDIN, python_done, real_path)) {
+        gui_error("Failed to start Python process.");
     }
 }
 
@@ -5662,99 +12475,6 @@ static int find_python_files(char files[][256], int max_files) {
     return count;
 }
 
-// ================ COMMAND HISTORY FUNCTIONS ================
-
-static void add_to_history(const char* command) {
-    // Don't add empty commands or duplicate of last command
-    if (strlen(command) == 0) return;
-    if (g_historyCount > 0 && strcmp(g_commandHistory[g_historyCount - 1], command) == 0) return;
-    
-    // Shift history if we're at max capacity
-    if (g_historyCount >= MAX_HISTORY) {
-        for (int i = 0; i < MAX_HISTORY - 1; i++) {
-            strcpy(g_commandHistory[i], g_commandHistory[i + 1]);
-        }
-        g_historyCount = MAX_HISTORY - 1;
-    }
-    
-    // Add new command
-    strncpy(g_commandHistory[g_historyCount], command, 255);
-    g_commandHistory[g_historyCount][255] = '\0';
-    g_historyCount++;
-    g_historyIndex = g_historyCount; // Reset to "new command" position
-}
-
-static void navigate_history(int direction) {
-    if (g_historyCount == 0) return;
-    
-    // Save current input if we're at the "new command" position
-    if (g_historyIndex == g_historyCount) {
-        int totalLen = GetWindowTextLengthA(g_hOut);
-        int cmdLen = totalLen - g_inputStart;
-        if (cmdLen > 0 && cmdLen < 256) {
-            char* all = (char*)malloc((size_t)totalLen + 1);
-            if (all) {
-                GetWindowTextA(g_hOut, all, totalLen + 1);
-                memcpy(g_currentInput, all + g_inputStart, (size_t)cmdLen);
-                g_currentInput[cmdLen] = '\0';
-                free(all);
-            }
-        }
-    }
-    
-    // Navigate through history
-    if (direction < 0) { // Up arrow - go to older commands
-        if (g_historyIndex > 0) {
-            g_historyIndex--;
-        }
-    } else { // Down arrow - go to newer commands
-        if (g_historyIndex < g_historyCount) {
-            g_historyIndex++;
-        }
-    }
-    
-    // Update the input field
-    if (g_historyIndex < g_historyCount) {
-        update_input_field(g_commandHistory[g_historyIndex]);
-    } else {
-        update_input_field(g_currentInput);
-    }
-}
-
-static void update_input_field(const char* text) {
-    if (!g_hOut) return;
-    
-    // Get current text up to input start
-    int totalLen = GetWindowTextLengthA(g_hOut);
-    char* all = (char*)malloc((size_t)totalLen + 1);
-    if (!all) return;
-    
-    GetWindowTextA(g_hOut, all, totalLen + 1);
-    
-    // Replace the input part with the new text
-    int newLen = g_inputStart + (int)strlen(text);
-    char* newText = (char*)malloc((size_t)newLen + 1);
-    if (!newText) {
-        free(all);
-        return;
-    }
-    
-    // Copy text up to input start
-    memcpy(newText, all, (size_t)g_inputStart);
-    // Copy the new command
-    strcpy(newText + g_inputStart, text);
-    
-    // Update the edit control
-    SetWindowTextA(g_hOut, newText);
-    
-    // Set cursor to end
-    SendMessageA(g_hOut, EM_SETSEL, (WPARAM)newLen, (LPARAM)newLen);
-    SendMessageA(g_hOut, EM_SCROLLCARET, 0, 0);
-    
-    free(all);
-    free(newText);
-}
-
 // ================ SYSTEM MAINTENANCE FUNCTIONS ================
 // These functions provide administrative access to system maintenance operations
 // Used for debugging, file system access, and administrative tasks
@@ -5829,30 +12549,25 @@ static void cmd_system_ls(const char* path) {
     
     log_system_access("LS", target_path);
     
-    WIN32_FIND_DATAA findData;
-    char search_path[1024];
-    snprintf(search_path, sizeof(search_path), "%s\\*", target_path);
-    
-    HANDLE hFind = FindFirstFileA(search_path, &findData);
-    if (hFind == INVALID_HANDLE_VALUE) {
-        gui_println("Directory not found or access denied.");
+    PfDir* dir = pf_dir_open(target_path);
+    if (!dir) {
+        gui_error("Directory not found or access denied.");
         return;
     }
     
     gui_printf("Contents of %s:\n", target_path);
     gui_println("==================");
     
-    do {
-        if (strcmp(findData.cFileName, ".") != 0 && strcmp(findData.cFileName, "..") != 0) {
-            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                gui_printf("[DIR]  %s\n", findData.cFileName);
-            } else {
-                gui_printf("[FILE] %s\n", findData.cFileName);
-            }
+    PfDirEntry entry;
+    while (pf_dir_next(dir, &entry)) {
+        if (entry.is_dir) {
+            gui_printf("[DIR]  %s\n", entry.name);
+        } else {
+            gui_printf("[FILE] %s\n", entry.name);
         }
-    } while (FindNextFileA(hFind, &findData));
+    }
     
-    FindClose(hFind);
+    pf_dir_close(dir);
 }
 
 static void cmd_system_cd(const char* path) {
@@ -5890,16 +12605,10 @@ static void cmd_system_cd(const char* path) {
     }
     
     // Verify directory exists
-    WIN32_FIND_DATAA findData;
-    char test_path[1024];
-    snprintf(test_path, sizeof(test_path), "%s\\*", new_path);
-    
-    HANDLE hFind = FindFirstFileA(test_path, &findData);
-    if (hFind == INVALID_HANDLE_VALUE) {
-        gui_println("Directory not found or access denied.");
+    if (pf_path_kind(new_path) != PF_PATH_DIR) {
+        gui_error("Directory not found or access denied.");
         return;
     }
-    FindClose(hFind);
     
     strcpy(g_systemMaintenancePath, new_path);
     log_system_access("CD", new_path);
@@ -5920,7 +12629,7 @@ static void cmd_system_cat(const char* path) {
     }
     
     if (!path || !*path) {
-        gui_println("Usage: SYSTEM_CAT <file_path>");
+        gui_error("Usage: SYSTEM_CAT <file_path>");
         return;
     }
     
@@ -5934,38 +12643,40 @@ static void cmd_system_cat(const char* path) {
     
     log_system_access("CAT", target_path);
     
-    HANDLE hFile = CreateFileA(target_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile == INVALID_HANDLE_VALUE) {
-        gui_println("File not found or access denied.");
+    PfStat st;
+    FILE* fp = NULL;
+    if (pf_stat(target_path, &st) && st.kind == PF_PATH_FILE) fp = pf_fopen(target_path, "rb");
+    if (!fp) {
+        gui_error("File not found or access denied.");
         return;
     }
     
-    DWORD fileSize = GetFileSize(hFile, NULL);
+    size_t fileSize = (size_t)st.size;
     if (fileSize > 10240) { // 10KB limit for maintenance operations
         gui_println("File too large to display (over 10KB).");
-        CloseHandle(hFile);
+        fclose(fp);
         return;
     }
     
     char* buffer = (char*)malloc(fileSize + 1);
     if (!buffer) {
-        gui_println("Memory allocation failed.");
-        CloseHandle(hFile);
+        gui_error("Memory allocation failed.");
+        fclose(fp);
         return;
     }
     
-    DWORD bytesRead;
-    if (ReadFile(hFile, buffer, fileSize, &bytesRead, NULL)) {
+    size_t bytesRead = fread(buffer, 1, fileSize, fp);
+    if (!ferror(fp)) {
         buffer[bytesRead] = '\0';
         gui_printf("Contents of %s:\n", target_path);
         gui_println("==================");
         gui_println(buffer);
     } else {
-        gui_println("Failed to read file.");
+        gui_error("Failed to read file.");
     }
     
     free(buffer);
-    CloseHandle(hFile);
+    fclose(fp);
 }
 
 static void cmd_system_copy(const char* args) {
@@ -5981,13 +12692,13 @@ static void cmd_system_copy(const char* args) {
     }
     
     if (!args || !*args) {
-        gui_println("Usage: BACKDOOR_COPY <source_path> <dest_name>");
+        gui_error("Usage: BACKDOOR_COPY <source_path> <dest_name>");
         return;
     }
     
     char src_path[512], dest_name[256];
     if (sscanf(args, "%511s %255s", src_path, dest_name) != 2) {
-        gui_println("Usage: BACKDOOR_COPY <source_path> <dest_name>");
+        gui_error("Usage: BACKDOOR_COPY <source_path> <dest_name>");
         return;
     }
     
@@ -6002,40 +12713,42 @@ static void cmd_system_copy(const char* args) {
     log_system_access("COPY", full_src_path);
     
     // Read the source file
-    HANDLE hFile = CreateFileA(full_src_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile == INVALID_HANDLE_VALUE) {
-        gui_println("Source file not found or access denied.");
+    PfStat st;
+    FILE* fp = NULL;
+    if (pf_stat(full_src_path, &st) && st.kind == PF_PATH_FILE) fp = pf_fopen(full_src_path, "rb");
+    if (!fp) {
+        gui_error("Source file not found or access denied.");
         return;
     }
     
-    DWORD fileSize = GetFileSize(hFile, NULL);
+    size_t fileSize = (size_t)st.size;
     if (fileSize > 10240) { // 10KB limit
         gui_println("File too large to copy (over 10KB).");
-        CloseHandle(hFile);
+        fclose(fp);
         return;
     }
     
     char* buffer = (char*)malloc(fileSize + 1);
     if (!buffer) {
-        gui_println("Memory allocation failed.");
-        CloseHandle(hFile);
+        gui_error("Memory allocation failed.");
+        fclose(fp);
         return;
     }
     
-    DWORD bytesRead;
-    if (!ReadFile(hFile, buffer, fileSize, &bytesRead, NULL)) {
-        gui_println("Failed to read source file.");
+    size_t bytesRead = fread(buffer, 1, fileSize, fp);
+    if (ferror(fp)) {
+        gui_error("Failed to read source file.");
         free(buffer);
-        CloseHandle(hFile);
+        fclose(fp);
         return;
     }
     buffer[bytesRead] = '\0';
-    CloseHandle(hFile);
+    fclose(fp);
     
     // Create file in virtual filesystem
     File* new_file = fs_create_file(dest_name);
     if (!new_file) {
-        gui_println("Failed to create destination file.");
+        gui_error("Failed to create destination file.");
         free(buffer);
         return;
     }
@@ -6084,7 +12797,7 @@ static void cmd_system_log(void) {
         }
     }
     
-    gui_println("Access log not found.");
+    gui_error("Access log not found.");
 }
 
 static void log_system_access(const char* action, const char* path) {
@@ -6114,6 +12827,7 @@ static void log_system_access(const char* action, const char* path) {
     size_t entry_len = strlen(log_entry);
     if (current_len + entry_len < sizeof(log_file->content) - 1) {
         strcat(log_file->content, log_entry);
+        vfs_changed(VFS_FILE_WRITTEN, backdoor, log_file);
     }
 }
 
@@ -6126,7 +12840,7 @@ static BOOL is_system_session_valid(void) {
 
 // ================ PROJECT DETECTION FUNCTIONS ================
 
-static void detect_project_type(void) {
+void detect_project_type(void) {
     // Reset project info
     memset(&g_currentProject, 0, sizeof(ProjectInfo));
     
@@ -6151,22 +12865,24 @@ static ProjectType scan_directory_for_project_type(Directory* dir) {
     int has_react = 0;
     int has_vue = 0;
     int has_angular = 0;
-    int has_cpp = 0;
-    int has_python = 0;
+    
+    const ProjectStats* stats = project_stats(dir);
+    g_currentProject.has_requirements_txt = (stats->marks & PROJECT_MARK_REQUIREMENTS) != 0;
+    g_currentProject.has_cmake = (stats->marks & PROJECT_MARK_CMAKE) != 0;
+    g_currentProject.has_makefile = (stats->marks & PROJECT_MARK_MAKEFILE) != 0;
     
     // Check for package.json
-    if (has_package_json(dir)) {
+    if ((stats->marks & PROJECT_MARK_PACKAGE_JSON) && has_package_json(dir)) {
         has_nodejs = 1;
-        if (has_react_dependency(dir)) has_react = 1;
-        if (has_vue_dependency(dir)) has_vue = 1;
-        if (has_angular_dependency(dir)) has_angular = 1;
+        int uses = package_info(fs_find_file(dir, "package.json"))->uses;
+        if (uses & PACKAGE_USES_REACT) has_react = 1;
+        if (uses & PACKAGE_USES_VUE) has_vue = 1;
+        if (uses & PACKAGE_USES_ANGULAR) has_angular = 1;
     }
     
-    // Check for C++ files
-    if (has_cpp_files(dir)) has_cpp = 1;
-    
-    // Check for Python files
-    if (has_python_files(dir)) has_python = 1;
+    // C++ and Python files anywhere below, ignored subtrees left out
+    int has_cpp = stats->sources[SOURCE_C] + stats->sources[SOURCE_CPP] > 0;
+    int has_python = stats->sources[SOURCE_PYTHON] > 0;
     
     // Determine project type
     if (has_react) return PROJECT_REACT;
@@ -6180,6 +12896,81 @@ static ProjectType scan_directory_for_project_type(Directory* dir) {
     return PROJECT_NONE;
 }
 
+// ---- Folder tallies ----
+// Every folder keeps its ProjectStats, so classifying one on CD is a
+// lookup. A change in a folder marks it and the folders above it stale
+// (vfs_changed), and the next lookup recounts only those, reusing the tallies
+// of everything below them that did not change. A rules file changing can
+// change what is ignored anywhere, so then every tally goes stale at once.
+static unsigned g_projectStatsEpoch = 1;
+
+static int source_kind(const char* name) {
+    const char* dot = strrchr(name, '.');
+    if (!dot) return -1;
+    if (strcmp(dot, ".c") == 0) return SOURCE_C;
+    if (strcmp(dot, ".cpp") == 0) return SOURCE_CPP;
+    if (strcmp(dot, ".h") == 0 || strcmp(dot, ".hpp") == 0) return SOURCE_HEADER;
+    if (strcmp(dot, ".py") == 0) return SOURCE_PYTHON;
+    if (strcmp(dot, ".js") == 0 || strcmp(dot, ".jsx") == 0) return SOURCE_JS;
+    if (strcmp(dot, ".ts") == 0 || strcmp(dot, ".tsx") == 0) return SOURCE_TS;
+    return -1;
+}
+
+static int project_mark(const char* name) {
+    if (strcmp(name, "package.json") == 0) return PROJECT_MARK_PACKAGE_JSON;
+    if (strcmp(name, "CMakeLists.txt") == 0) return PROJECT_MARK_CMAKE;
+    if (strcmp(name, "Makefile") == 0 || strcmp(name, "makefile") == 0) return PROJECT_MARK_MAKEFILE;
+    if (strcmp(name, "requirements.txt") == 0) return PROJECT_MARK_REQUIREMENTS;
+    return 0;
+}
+
+// walk is at dir
+static const ProjectStats* project_stats_count(Directory* dir, IgnoreWalk* walk) {
+    if (dir->stats_epoch == g_projectStatsEpoch) return &dir->stats;
+    ProjectStats stats;
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < dir->file_count; i++) {
+        const char* name = dir->files[i]->name;
+        stats.marks |= project_mark(name);
+        int kind = source_kind(name);
+        if (kind >= 0 && !ignore_walk_check(walk, name, FALSE)) stats.sources[kind]++;
+    }
+    for (int i = 0; i < dir->child_count; i++) {
+        Directory* child = dir->children[i];
+        if (ignore_walk_check(walk, child->name, TRUE)) continue;
+        IgnoreMark mark;
+        ignore_walk_enter_dir(walk, child, &mark);
+        const ProjectStats* below = project_stats_count(child, walk);
+        ignore_walk_leave(walk, &mark);
+        for (int k = 0; k < SOURCE_KINDS; k++) stats.sources[k] += below->sources[k];
+    }
+    dir->stats = stats;
+    dir->stats_epoch = g_projectStatsEpoch;
+    return &dir->stats;
+}
+
+static const ProjectStats* project_stats(Directory* dir) {
+    if (dir->stats_epoch == g_projectStatsEpoch) return &dir->stats;
+    IgnoreWalk walk;
+    ignore_walk_begin_at(&walk, dir);
+    const ProjectStats* stats = project_stats_count(dir, &walk);
+    ignore_walk_end(&walk);
+    return stats;
+}
+
+// A stale folder's parents are stale too, so marking can stop at the first
+// one that already is
+static void project_stats_changed(VfsChange what, Directory* dir, File* file) {
+    if (file && (strcmp(file->name, ".gitignore") == 0 || strcmp(file->name, "ignore.dat") == 0)) {
+        if (++g_projectStatsEpoch == 0) g_projectStatsEpoch = 1;
+        return;
+    }
+    // Only a name matters, so rewriting a file leaves the counts alone
+    if (what == VFS_FILE_WRITTEN) return;
+    Directory* d = (what == VFS_DIR_ADDED || what == VFS_DIR_REMOVED) ? dir->parent : dir;
+    for (; d && d->stats_epoch != 0; d = d->parent) d->stats_epoch = 0;
+}
+
 static int has_package_json(Directory* dir) {
     if (!dir) return 0;
     
@@ -6196,168 +12987,122 @@ static int has_package_json(Directory* dir) {
     return 0;
 }
 
-static int has_react_dependency(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, "package.json") == 0) {
-            // Simple check for "react" in package.json content
-            if (strstr(dir->files[i]->content, "\"react\"") != NULL ||
-                strstr(dir->files[i]->content, "'react'") != NULL) {
-                return 1;
-            }
-        }
-    }
-    return 0;
-}
+// ---- package.json ----
+// package_info reads the file with the JSON tokenizer in a single pass and
+// keeps the result keyed by a hash of the text, so CD, PROJECT_INFO and NPM
+// RUN ask again for free until the file changes. Only the top-level
+// "scripts", "dependencies" and "devDependencies" objects count; a name
+// anywhere else (a script's command, a description) no longer does.
+static PackageInfo g_packageCache[PACKAGE_CACHE_SLOTS];
+static int g_packageCacheNext = 0;
 
-static int has_vue_dependency(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, "package.json") == 0) {
-            if (strstr(dir->files[i]->content, "\"vue\"") != NULL ||
-                strstr(dir->files[i]->content, "'vue'") != NULL) {
-                return 1;
-            }
-        }
-    }
-    return 0;
-}
+enum { PACKAGE_OTHER, PACKAGE_SCRIPTS, PACKAGE_DEPENDENCIES, PACKAGE_DEV_DEPENDENCIES };
 
-static int has_angular_dependency(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, "package.json") == 0) {
-            if (strstr(dir->files[i]->content, "\"@angular/core\"") != NULL ||
-                strstr(dir->files[i]->content, "'@angular/core'") != NULL) {
-                return 1;
+static void package_add_dependency(PackageInfo* info, const JsonToken* name, BOOL dev) {
+    if (json_equals(name, "react")) info->uses |= PACKAGE_USES_REACT;
+    if (json_equals(name, "vue")) info->uses |= PACKAGE_USES_VUE;
+    if (json_equals(name, "@angular/core")) info->uses |= PACKAGE_USES_ANGULAR;
+    if (dev) {
+        info->dev_count++;
+    } else {
+        info->runtime_count++;
+    }
+    if (info->dependency_count == MAX_DEPENDENCIES) return;
+    PackageDependency* dep = &info->dependencies[info->dependency_count++];
+    json_string(name, dep->name, sizeof(dep->name));
+    dep->dev = dev;
+}
+
+static void package_info_read(PackageInfo* info, const char* text, size_t len) {
+    JsonReader reader;
+    JsonToken token;
+    json_init(&reader, text, len);
+    JsonType type = json_next(&reader, &token);
+    if (type == JSON_OBJECT_BEGIN) {
+        while ((type = json_next(&reader, &token)) == JSON_KEY) {
+            int section = json_equals(&token, "scripts") ? PACKAGE_SCRIPTS
+                        : json_equals(&token, "dependencies") ? PACKAGE_DEPENDENCIES
+                        : json_equals(&token, "devDependencies") ? PACKAGE_DEV_DEPENDENCIES
+                        : PACKAGE_OTHER;
+            type = json_next(&reader, &token);
+            if (section == PACKAGE_OTHER || type != JSON_OBJECT_BEGIN) {
+                if (!json_skip(&reader, &token)) break;
+                continue;
+            }
+            while ((type = json_next(&reader, &token)) == JSON_KEY) {
+                JsonToken name = token;
+                type = json_next(&reader, &token);
+                if (section != PACKAGE_SCRIPTS) {
+                    package_add_dependency(info, &name, section == PACKAGE_DEV_DEPENDENCIES);
+                } else if (type == JSON_STRING && info->script_count < MAX_PACKAGE_SCRIPTS) {
+                    PackageScript* script = &info->scripts[info->script_count++];
+                    json_string(&name, script->name, sizeof(script->name));
+                    json_string(&token, script->command, sizeof(script->command));
+                }
+                if (!json_skip(&reader, &token)) break;
             }
         }
+        if (type == JSON_OBJECT_END) type = json_next(&reader, &token);
     }
-    return 0;
-}
-
-static int has_cpp_files(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        char* name = dir->files[i]->name;
-        int len = strlen(name);
-        if (len >= 4 && strcmp(name + len - 4, ".cpp") == 0) {
-            return 1;
-        }
-        if (len >= 2 && strcmp(name + len - 2, ".c") == 0) {
-            return 1;
-        }
-    }
-    
-    // Check subdirectories
-    for (int i = 0; i < dir->child_count; i++) {
-        if (has_cpp_files(dir->children[i])) {
-            return 1;
-        }
-    }
-    
-    return 0;
-}
 
-static int has_python_files(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        char* name = dir->files[i]->name;
-        int len = strlen(name);
-        if (len >= 3 && strcmp(name + len - 3, ".py") == 0) {
-            return 1;
-        }
-    }
-    
-    // Check subdirectories
-    for (int i = 0; i < dir->child_count; i++) {
-        if (has_python_files(dir->children[i])) {
-            return 1;
-        }
+    info->valid = (type == JSON_END);
+    if (info->valid) return;
+    // npm will not run anything from it, so neither is anything listed
+    memset(info, 0, sizeof(*info));
+    if (reader.error) {
+        snprintf(info->error, sizeof(info->error), "line %d: %s",
+                 json_line_of(text, reader.error_at), reader.error);
+    } else {
+        snprintf(info->error, sizeof(info->error), "not a JSON object");
     }
-    
-    return 0;
 }
 
-static int has_requirements_txt(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, "requirements.txt") == 0) {
-            g_currentProject.has_requirements_txt = 1;
-            return 1;
-        }
+// Points into a small cache: use it before asking about another file
+static const PackageInfo* package_info(const File* file) {
+    size_t len = strlen(file->content);
+    unsigned long long hash = hash64(file->content, len);
+    for (int i = 0; i < PACKAGE_CACHE_SLOTS; i++) {
+        if (g_packageCache[i].used && g_packageCache[i].hash == hash) return &g_packageCache[i];
     }
-    return 0;
+    PackageInfo* info = &g_packageCache[g_packageCacheNext];
+    g_packageCacheNext = (g_packageCacheNext + 1) % PACKAGE_CACHE_SLOTS;
+    memset(info, 0, sizeof(*info));
+    package_info_read(info, file->content, len);
+    info->used = TRUE;
+    info->hash = hash;
+    return info;
 }
 
-static int has_cmake_files(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, "CMakeLists.txt") == 0) {
-            g_currentProject.has_cmake = 1;
-            return 1;
-        }
+static const PackageScript* package_script(const PackageInfo* info, const char* name) {
+    for (int i = 0; i < info->script_count; i++) {
+        if (strcmp(info->scripts[i].name, name) == 0) return &info->scripts[i];
     }
-    return 0;
+    return NULL;
 }
 
-static int has_makefile(Directory* dir) {
-    if (!dir) return 0;
-    
-    for (int i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, "Makefile") == 0 || 
-            strcmp(dir->files[i]->name, "makefile") == 0) {
-            g_currentProject.has_makefile = 1;
-            return 1;
-        }
+// The package.json npm would use from dir: the nearest one at or above it
+static File* package_json_find(Directory* dir) {
+    for (; dir; dir = dir->parent) {
+        File* file = fs_find_file(dir, "package.json");
+        if (file) return file;
     }
-    return 0;
+    return NULL;
 }
 
 static void load_package_json_info(void) {
     if (g_currentProject.package_json_path[0] == '\0') return;
-    
-    // Find the package.json file in the virtual filesystem
-    Directory* dir = g_cwd;
-    while (dir) {
-        for (int i = 0; i < dir->file_count; i++) {
-            if (strcmp(dir->files[i]->name, "package.json") == 0) {
-                char* content = dir->files[i]->content;
-                
-                // Simple JSON parsing for scripts
-                if (strstr(content, "\"scripts\"")) {
-                    // Look for common scripts
-                    if (strstr(content, "\"start\"")) {
-                        strcpy(g_currentProject.run_command, "npm start");
-                    }
-                    if (strstr(content, "\"build\"")) {
-                        strcpy(g_currentProject.build_command, "npm run build");
-                    }
-                    if (strstr(content, "\"test\"")) {
-                        strcpy(g_currentProject.test_command, "npm test");
-                    }
-                    if (strstr(content, "\"dev\"")) {
-                        strcpy(g_currentProject.dev_command, "npm run dev");
-                    }
-                }
-                
-                // Check for node_modules
-                if (strstr(content, "\"dependencies\"") || strstr(content, "\"devDependencies\"")) {
-                    g_currentProject.has_node_modules = 1;
-                }
-                
-                return;
-            }
-        }
-        dir = dir->parent;
-    }
+    File* file = package_json_find(g_cwd);
+    if (!file) return;
+    const PackageInfo* package = package_info(file);
+
+    // npm runs "start" and "test" without RUN
+    if (package_script(package, "start")) strcpy(g_currentProject.run_command, "npm start");
+    if (package_script(package, "build")) strcpy(g_currentProject.build_command, "npm run build");
+    if (package_script(package, "test")) strcpy(g_currentProject.test_command, "npm test");
+    if (package_script(package, "dev")) strcpy(g_currentProject.dev_command, "npm run dev");
+
+    // Dependencies to install
+    g_currentProject.has_node_modules = package->runtime_count + package->dev_count > 0;
 }
 
 static void find_main_files(void) {
@@ -6444,44 +13189,46 @@ static void cmd_project_info(void) {
         gui_printf("Dev Command: %s\n", g_currentProject.dev_command);
     }
     
+    File* package_json = g_currentProject.package_json_path[0] ? package_json_find(g_cwd) : NULL;
+    if (package_json) {
+        const PackageInfo* package = package_info(package_json);
+        if (!package->valid) {
+            gui_printf("package.json is not valid JSON (%s)\n", package->error);
+        } else {
+            char names[512] = "";
+            size_t len = 0;
+            for (int i = 0; i < package->script_count && len < sizeof(names); i++) {
+                len += (size_t)snprintf(names + len, sizeof(names) - len, "%s%s", i ? ", " : "",
+                                        package->scripts[i].name);
+            }
+            gui_printf("Scripts: %s\n", names[0] ? names : "none");
+            for (int dev = 0; dev <= 1; dev++) {
+                names[0] = '\0';
+                len = 0;
+                for (int i = 0; i < package->dependency_count && len < sizeof(names); i++) {
+                    if (package->dependencies[i].dev != dev) continue;
+                    len += (size_t)snprintf(names + len, sizeof(names) - len, "%s%s", len ? ", " : "",
+                                            package->dependencies[i].name);
+                }
+                int count = dev ? package->dev_count : package->runtime_count;
+                if (count) gui_printf("%s: %d (%s)\n", dev ? "Dev Dependencies" : "Dependencies", count, names);
+            }
+        }
+    }
+    
     gui_printf("Has node_modules: %s\n", g_currentProject.has_node_modules ? "Yes" : "No");
     gui_printf("Has requirements.txt: %s\n", g_currentProject.has_requirements_txt ? "Yes" : "No");
     gui_printf("Has CMakeLists.txt: %s\n", g_currentProject.has_cmake ? "Yes" : "No");
     gui_printf("Has Makefile: %s\n", g_currentProject.has_makefile ? "Yes" : "No");
-}
-
-int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE hPrev, LPSTR lpCmdLine, int nCmdShow) {
-    WNDCLASSA wc = {0};
-    wc.style = CS_HREDRAW | CS_VREDRAW;
-    wc.lpfnWndProc = WndProc;
-    wc.hInstance = hInst;
-    wc.hCursor = LoadCursor(NULL, IDC_IBEAM);
-    wc.hIcon = LoadIcon(NULL, IDI_APPLICATION);
-    if (!g_hbrBlack) g_hbrBlack = CreateSolidBrush(RGB(0,0,0));
-    wc.hbrBackground = g_hbrBlack;
-    wc.lpszClassName = "SimpleGuiTermClass";
-    if (!RegisterClassA(&wc)) return 1;
-
-    HWND hWnd = CreateWindowExA(0, wc.lpszClassName, "NEXUS TERMINAL", WS_OVERLAPPEDWINDOW, 100, 100, 800, 500, NULL, NULL, hInst, NULL);
-    if (!hWnd) return 1;
-    
-    // Initialize security and theme systems
-    init_security_system();
-    init_theme_system();
     
-    // Initialize project detection
-    detect_project_type();
-    
-    ShowWindow(hWnd, SW_SHOW);
-    UpdateWindow(hWnd);
-    SetForegroundWindow(hWnd);
-    BringWindowToTop(hWnd);
-
-    MSG msg;
-    while (GetMessage(&msg, NULL, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+    static const char* const kinds[SOURCE_KINDS] = { ".c", ".cpp", ".h", ".py", ".js", ".ts" };
+    const ProjectStats* stats = project_stats(g_cwd);
+    char sources[256] = "";
+    size_t len = 0;
+    for (int k = 0; k < SOURCE_KINDS && len < sizeof(sources); k++) {
+        if (stats->sources[k] == 0) continue;
+        len += (size_t)snprintf(sources + len, sizeof(sources) - len, "%s%d %s", len ? ", " : "",
+                                stats->sources[k], kinds[k]);
     }
-    return (int)msg.wParam;
+    gui_printf("Source files: %s\n", sources[0] ? sources : "none");
 }
-